@@ -74,9 +74,36 @@ atpl360_hal_wrapper_t sx_atpl360_hal_wrapper;
 #define ATPL360_REG_GET_RSP_PKT_SIZE              (div8_ceil(ATPL360_REG_PHY_PARAM_MAX_SIZE) << 3)
 #define ATPL360_REG_SET_REQ_PKT_SIZE              (div8_ceil(ATPL360_REG_PHY_PARAM_MAX_SIZE + 6) << 3)
 
+/* Number of received frames that can wait for atpl360_handle_events() (power of 2) */
+#ifndef ATPL360_RX_IND_SLOTS
+#define ATPL360_RX_IND_SLOTS                      4
+#endif
+
+#if (ATPL360_RX_IND_SLOTS == 0) || (ATPL360_RX_IND_SLOTS > 128) || (ATPL360_RX_IND_SLOTS & (ATPL360_RX_IND_SLOTS - 1))
+#error ATPL360_RX_IND_SLOTS must be a power of 2 up to 128
+#endif
+
+/* Number of SPI reads (confirms and register responses) deferred from the ISR to atpl360_handle_events() (power of 2) */
+#ifndef ATPL360_SPI_TRANS_SLOTS
+#define ATPL360_SPI_TRANS_SLOTS                   4
+#endif
+
+#if (ATPL360_SPI_TRANS_SLOTS < (NUM_TX_BUFFERS + 1)) || (ATPL360_SPI_TRANS_SLOTS > 128) || (ATPL360_SPI_TRANS_SLOTS & (ATPL360_SPI_TRANS_SLOTS - 1))
+#error ATPL360_SPI_TRANS_SLOTS must be a power of 2 up to 128, holding one read per TX buffer plus one register response
+#endif
+
+/* Deferred SPI read descriptor */
+typedef struct atpl360_spi_trans {
+	uint8_t *puc_data_buf;
+	uint16_t us_mem_id;
+	uint16_t us_len;
+	uint8_t uc_ev_type;
+	uint8_t uc_idx;
+} atpl360_spi_trans_t;
+
 /* Buffer definition to communicate with ATPL360 */
 static uint8_t spuc_tx_buffer[ATPL360_TX_PKT_SIZE];
-static uint8_t spuc_ind_buffer[ATPL360_RX_PKT_SIZE];
+static uint8_t spuc_ind_buffer[ATPL360_RX_IND_SLOTS][ATPL360_RX_PKT_SIZE];
 static uint8_t spuc_cfm_buffer[NUM_TX_BUFFERS][div8_ceil(ATPL360_CMF_PKT_SIZE) << 3];
 static uint8_t spuc_reg_get_rsp_buffer[ATPL360_REG_GET_RSP_PKT_SIZE];
 static uint8_t spuc_reg_set_req_buffer[ATPL360_REG_SET_REQ_PKT_SIZE];
@@ -92,6 +119,17 @@ static volatile bool sb_report_tx_cfm_error_by_rst;
 static volatile bool spb_cfm_event_enable[NUM_TX_BUFFERS];
 static volatile bool sb_data_ind_event_enable;
 static volatile bool sb_param_ind_event_enable;
+static volatile bool sb_ind_overflow;
+
+/* RX indication ring: the ISR fills the slot at suc_ind_wr_idx, atpl360_handle_events() */
+/* drains from suc_ind_rd_idx. Each index is written by one side only (free running) */
+static volatile uint8_t suc_ind_wr_idx;
+static volatile uint8_t suc_ind_rd_idx;
+
+/* Deferred SPI read queue: the ISR fills it, atpl360_handle_events() runs the reads */
+static atpl360_spi_trans_t spx_spi_trans[ATPL360_SPI_TRANS_SLOTS];
+static volatile uint8_t suc_spi_trans_wr_idx;
+static volatile uint8_t suc_spi_trans_rd_idx;
 static volatile uint16_t sus_reg_event_len;
 
 /* Device Enable/Disable Status */
@@ -100,6 +138,9 @@ static bool sb_component_enabled;
 /* Sleep mode Status */
 static bool sb_sleep_enabled;
 
+/* PLC interrupt status, as last set through _plc_enable_int() */
+static volatile bool sb_plc_int_enabled;
+
 /* Debug mode Status */
 static bool sb_debug_enabled;
 static uint32_t sul_dbg_addr;
@@ -116,9 +157,17 @@ static pf_handle_cb_t _debug_mode_cb_handler;
 /* Counters of interrupt */
 static uint32_t ul_int_cnt;
 static uint32_t ul_int_rx_data_cnt;
+static uint32_t ul_int_rx_ovf_cnt;
+static uint32_t ul_int_rx_max_pending;
 static uint32_t ul_int_rx_qpar_cnt;
 static uint32_t ul_int_tx_cnt;
 static uint32_t ul_int_reg_cnt;
+static uint32_t ul_int_trans_sync_cnt;
+#ifdef ATPL360_ISR_PROFILE
+/* ISR duration in core cycles (DWT cycle counter) */
+static uint32_t ul_int_last_cycles;
+static uint32_t ul_int_max_cycles;
+#endif
 
 static uint16_t sus_prod_info;
 
@@ -128,6 +177,17 @@ static uint16_t sus_prod_info;
 
 static bool _set_config(uint16_t us_param_id, void *px_value, uint16_t us_len);
 
+/**
+ * \brief Enable/disable PLC interrupt, keeping track of its status
+ *
+ * \param b_enable   True to enable PLC interrupt
+ */
+static void _plc_enable_int(bool b_enable)
+{
+	sb_plc_int_enabled = b_enable;
+	sx_atpl360_hal_wrapper.plc_enable_int(b_enable);
+}
+
 /**
  * \brief Function to read/write through SPI
  *
@@ -234,8 +294,120 @@ static void _get_interrupt_info(atpl360_events_t *px_events_info, atpl360_spi_st
 	}
 }
 
+/**
+ * \brief Post the event related to a completed SPI read
+ *
+ * \param px_trans   Pointer to SPI read descriptor
+ * \param uc_res     Result of the SPI read
+ */
+static void _spi_trans_complete(atpl360_spi_trans_t *px_trans, atpl360_res_t uc_res)
+{
+	if (px_trans->uc_ev_type == MSG_CFM_EV_TYPE) {
+		if (uc_res == ATPL360_SUCCESS) {
+			spb_cfm_event_enable[px_trans->uc_idx] = true;
+			ul_int_tx_cnt++;
+		}
+	} else {
+		/* Register response is always reported, as it is waited by _get_config() */
+		sus_reg_event_len = px_trans->us_len;
+		ul_int_reg_cnt++;
+	}
+}
+
+/**
+ * \brief Run a SPI read and post its event
+ *
+ * \param px_trans   Pointer to SPI read descriptor
+ */
+static void _spi_trans_run(atpl360_spi_trans_t *px_trans)
+{
+	atpl360_spi_data_t x_spi_data;
+
+	x_spi_data.us_mem_id = px_trans->us_mem_id;
+	x_spi_data.puc_data_buf = px_trans->puc_data_buf;
+	x_spi_data.us_len = px_trans->us_len;
+	_spi_trans_complete(px_trans, _spi_send_cmd(SPI_RD_CMD, &x_spi_data));
+}
+
+/**
+ * \brief Queue a SPI read to be run out of the ISR. If there is no free slot, the read is run immediately.
+ *
+ * \param uc_ev_type     Event type
+ * \param uc_idx         TX buffer index (confirms only)
+ * \param puc_data_buf   Pointer to destination buffer
+ * \param us_len         Length of the read
+ */
+static void _spi_trans_queue(uint8_t uc_ev_type, uint8_t uc_idx, uint8_t *puc_data_buf, uint16_t us_len)
+{
+	atpl360_spi_trans_t x_trans;
+	atpl360_spi_trans_t *px_trans;
+	bool b_queued;
+
+	b_queued = ((uint8_t)(suc_spi_trans_wr_idx - suc_spi_trans_rd_idx) < ATPL360_SPI_TRANS_SLOTS);
+	if (b_queued) {
+		px_trans = &spx_spi_trans[suc_spi_trans_wr_idx % ATPL360_SPI_TRANS_SLOTS];
+	} else {
+		px_trans = &x_trans;
+	}
+
+	px_trans->us_mem_id = atpl360_comm_get_event_id((enum atpl360_event_type)uc_ev_type, uc_idx);
+	px_trans->puc_data_buf = puc_data_buf;
+	px_trans->us_len = us_len;
+	px_trans->uc_ev_type = uc_ev_type;
+	px_trans->uc_idx = uc_idx;
+
+	if (b_queued) {
+		suc_spi_trans_wr_idx++;
+	} else {
+		_spi_trans_run(px_trans);
+		ul_int_trans_sync_cnt++;
+	}
+}
+
+/**
+ * \brief Run the SPI reads queued by the ISR, in order
+ *
+ * The PLC interrupt is disabled around each read, so the ISR can not start
+ * its own SPI transfer in the middle of it. If it was enabled, it is enabled
+ * again between reads, so that events are not held for the whole flush, and
+ * at the end. Nothing is done in debug mode, where it stays disabled.
+ */
+static void _spi_trans_flush(void)
+{
+	bool b_int_enabled;
+
+	if ((suc_spi_trans_rd_idx == suc_spi_trans_wr_idx) || sb_debug_enabled) {
+		return;
+	}
+
+	/* Disable PLC interrupt */
+	b_int_enabled = sb_plc_int_enabled;
+	_plc_enable_int(false);
+
+	while (suc_spi_trans_rd_idx != suc_spi_trans_wr_idx) {
+		_spi_trans_run(&spx_spi_trans[suc_spi_trans_rd_idx % ATPL360_SPI_TRANS_SLOTS]);
+		suc_spi_trans_rd_idx++;
+
+		if (b_int_enabled) {
+			/* Let pending PLC interrupt in between reads */
+			_plc_enable_int(true);
+			_plc_enable_int(false);
+		}
+	}
+
+	/* Restore PLC interrupt */
+	_plc_enable_int(b_int_enabled);
+}
+
 /**
  * \brief External interrupt handler
+ *
+ * Only the event status and the RX indication are read here. Confirms and
+ * register responses are queued and read from atpl360_handle_events(). The
+ * RX indication is not deferred: the device overwrites it with the next
+ * received frame, which may come before atpl360_handle_events() runs, so
+ * the ISR time of a reception (status plus up to ATPL360_DATA_PKT_SIZE data
+ * bytes on SPI) is the same as before.
  */
 static void _handler_atpl360_ext_int(void)
 {
@@ -243,6 +415,11 @@ static void _handler_atpl360_ext_int(void)
 	atpl360_spi_data_t x_spi_data;
 	atpl360_spi_status_info_t x_spi_status_info;
 	uint8_t uc_i;
+#ifdef ATPL360_ISR_PROFILE
+	uint32_t ul_cycles;
+
+	ul_cycles = DWT->CYCCNT;
+#endif
 
 	ul_int_cnt++;
 
@@ -256,66 +433,92 @@ static void _handler_atpl360_ext_int(void)
 		/* Check MSG_CFM_EV_TYPE event */
 		for (uc_i = 0; uc_i < NUM_TX_BUFFERS; uc_i++) {
 			if (x_events_info.b_cfm_event_enable[uc_i]) {
-				/* Read confirm message */
-				x_spi_data.us_mem_id = atpl360_comm_get_event_id(MSG_CFM_EV_TYPE, uc_i);
-				x_spi_data.puc_data_buf = spuc_cfm_buffer[uc_i];
-				x_spi_data.us_len = ATPL360_CMF_PKT_SIZE;
-				if (_spi_send_cmd(SPI_RD_CMD, &x_spi_data) == ATPL360_SUCCESS) {
-					spb_cfm_event_enable[uc_i] = true;
-					ul_int_tx_cnt++;
-				}
+				/* Queue read of confirm message */
+				_spi_trans_queue(MSG_CFM_EV_TYPE, uc_i, spuc_cfm_buffer[uc_i], ATPL360_CMF_PKT_SIZE);
 			}
 		}
 
 		/* Check MSG_IND_DATA_EV_TYPE event (First event in rx) */
 		if (x_events_info.b_data_ind_event_enable) {
-			/* Read DATA from indication message */
-			x_spi_data.us_mem_id = atpl360_comm_get_event_id(MSG_IND_DATA_EV_TYPE, NULL);
-			x_spi_data.puc_data_buf = spuc_ind_buffer + ATPL360_RX_PARAMS_SIZE;
-			x_spi_data.us_len = ATPL360_GET_EV_DAT_LEN_INFO(x_events_info.ul_event_info);
-			if ((x_spi_data.us_len == 0) || (x_spi_data.us_len > ATPL360_DATA_PKT_SIZE)) {
-				x_spi_data.us_len = 1;
-			}
+			if ((uint8_t)(suc_ind_wr_idx - suc_ind_rd_idx) >= ATPL360_RX_IND_SLOTS) {
+				/* No free slot: drop the frame, its params are dropped too */
+				sb_ind_overflow = true;
+				ul_int_rx_ovf_cnt++;
+			} else {
+				/* Read DATA from indication message */
+				x_spi_data.us_mem_id = atpl360_comm_get_event_id(MSG_IND_DATA_EV_TYPE, NULL);
+				x_spi_data.puc_data_buf = spuc_ind_buffer[suc_ind_wr_idx % ATPL360_RX_IND_SLOTS] + ATPL360_RX_PARAMS_SIZE;
+				x_spi_data.us_len = ATPL360_GET_EV_DAT_LEN_INFO(x_events_info.ul_event_info);
+				if ((x_spi_data.us_len == 0) || (x_spi_data.us_len > ATPL360_DATA_PKT_SIZE)) {
+					x_spi_data.us_len = 1;
+				}
 
-			if (_spi_send_cmd(SPI_RD_CMD, &x_spi_data) == ATPL360_SUCCESS) {
-				sb_data_ind_event_enable = true;
-				ul_int_rx_data_cnt++;
+				if (_spi_send_cmd(SPI_RD_CMD, &x_spi_data) == ATPL360_SUCCESS) {
+					sb_ind_overflow = false;
+					sb_data_ind_event_enable = true;
+					ul_int_rx_data_cnt++;
+				}
 			}
 		}
 
 		/* Check MSG_IND_PARAM_EV_TYPE event (Second event in rx) */
 		if (x_events_info.b_qpar_ind_event_enable) {
-			/* Read PARAMS from indication message */
-			x_spi_data.us_mem_id = atpl360_comm_get_event_id(MSG_IND_PARAM_EV_TYPE, NULL);
-			x_spi_data.puc_data_buf = spuc_ind_buffer;
-			x_spi_data.us_len = ATPL360_RX_PARAMS_SIZE;
-			if (_spi_send_cmd(SPI_RD_CMD, &x_spi_data) == ATPL360_SUCCESS) {
-				sb_param_ind_event_enable = true;
-				ul_int_rx_qpar_cnt++;
+			if (sb_ind_overflow) {
+				/* Params of a dropped frame */
+				sb_ind_overflow = false;
+			} else {
+				/* Read PARAMS from indication message */
+				x_spi_data.us_mem_id = atpl360_comm_get_event_id(MSG_IND_PARAM_EV_TYPE, NULL);
+				x_spi_data.puc_data_buf = spuc_ind_buffer[suc_ind_wr_idx % ATPL360_RX_IND_SLOTS];
+				x_spi_data.us_len = ATPL360_RX_PARAMS_SIZE;
+				if (_spi_send_cmd(SPI_RD_CMD, &x_spi_data) == ATPL360_SUCCESS) {
+					sb_param_ind_event_enable = true;
+					ul_int_rx_qpar_cnt++;
+				}
+			}
+		}
+
+		/* Frame complete: hand the slot over to atpl360_handle_events() */
+		if (sb_data_ind_event_enable && sb_param_ind_event_enable) {
+			uint8_t uc_pending;
+
+			sb_data_ind_event_enable = false;
+			sb_param_ind_event_enable = false;
+			suc_ind_wr_idx++;
+
+			uc_pending = (uint8_t)(suc_ind_wr_idx - suc_ind_rd_idx);
+			if (uc_pending > ul_int_rx_max_pending) {
+				ul_int_rx_max_pending = uc_pending;
 			}
 		}
 
 		/* Check REG_RSP_EV_TYPE event */
 		if (x_events_info.b_reg_data_enable) {
+			uint16_t us_reg_len;
+
 			/* Extract data and pkt len from event info */
-			sus_reg_event_len = ATPL360_GET_EV_REG_LEN_INFO(x_events_info.ul_event_info);
-			if ((sus_reg_event_len == 0) || (sus_reg_event_len > ATPL360_REG_PHY_PARAM_MAX_SIZE)) {
-				sus_reg_event_len = 1;
+			us_reg_len = ATPL360_GET_EV_REG_LEN_INFO(x_events_info.ul_event_info);
+			if ((us_reg_len == 0) || (us_reg_len > ATPL360_REG_PHY_PARAM_MAX_SIZE)) {
+				us_reg_len = 1;
 			}
 
-			x_spi_data.us_mem_id = atpl360_comm_get_event_id(REG_EV_TYPE, NULL);
-			x_spi_data.puc_data_buf = spuc_reg_get_rsp_buffer;
-			x_spi_data.us_len = sus_reg_event_len;
-			_spi_send_cmd(SPI_RD_CMD, &x_spi_data);
-			ul_int_reg_cnt++;
+			/* Queue read of register response */
+			_spi_trans_queue(REG_EV_TYPE, 0, spuc_reg_get_rsp_buffer, us_reg_len);
 		}
 
 		/* Time guard */
 		sx_atpl360_hal_wrapper.plc_delay(DELAY_TREF_US, 20);
 	} else {
 		/* Disable EXT INT */
-		sx_atpl360_hal_wrapper.plc_enable_int(false);
+		_plc_enable_int(false);
 	}
+
+#ifdef ATPL360_ISR_PROFILE
+	ul_int_last_cycles = DWT->CYCCNT - ul_cycles;
+	if (ul_int_last_cycles > ul_int_max_cycles) {
+		ul_int_max_cycles = ul_int_last_cycles;
+	}
+#endif
 }
 
 /**
@@ -410,6 +613,8 @@ static bool _get_config(uint16_t us_param_id, void *px_value, uint8_t uc_len, bo
 
 				/* Wait to the response */
 				while (!sus_reg_event_len) {
+					/* Register response is read out of the ISR */
+					_spi_trans_flush();
 					if (!us_sec_cnt--) {
 						/* Restore interrupt system */
 						if (ul_base_int) {
@@ -758,6 +963,11 @@ static void _init_system(void)
 	memset((uint8_t *)spb_cfm_event_enable, false, NUM_TX_BUFFERS);
 	sb_data_ind_event_enable = false;
 	sb_param_ind_event_enable = false;
+	sb_ind_overflow = false;
+	suc_ind_wr_idx = 0;
+	suc_ind_rd_idx = 0;
+	suc_spi_trans_wr_idx = 0;
+	suc_spi_trans_rd_idx = 0;
 	sus_reg_event_len = 0;
 
 	/* Init internal buffers */
@@ -802,8 +1012,20 @@ void atpl360_init(atpl360_descriptor_t *const px_descr, atpl360_hal_wrapper_t *p
 
 	/* Init int counter */
 	ul_int_rx_data_cnt = 0;
+	ul_int_rx_ovf_cnt = 0;
+	ul_int_rx_max_pending = 0;
 	ul_int_tx_cnt = 0;
 	ul_int_reg_cnt = 0;
+	ul_int_trans_sync_cnt = 0;
+
+#ifdef ATPL360_ISR_PROFILE
+	/* Enable DWT cycle counter to measure ISR duration */
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CYCCNT = 0;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+	ul_int_last_cycles = 0;
+	ul_int_max_cycles = 0;
+#endif
 
 	/* Init TX cfm flag */
 	suc_waiting_tx_cfm = 0;
@@ -833,10 +1055,13 @@ atpl360_res_t atpl360_enable(uint32_t ul_binary_address, uint32_t ul_binary_len)
 	uint8_t puc_int_buffer[ATPL360_EVENT_DATA_LENGTH];
 
 	/* Disable EXT INT */
-	sx_atpl360_hal_wrapper.plc_enable_int(false);
+	_plc_enable_int(false);
 
 	atpl360_boot_init(ul_binary_address, ul_binary_len);
 
+	/* Reads queued before the device was booted are lost */
+	suc_spi_trans_rd_idx = suc_spi_trans_wr_idx;
+
 	/* Read Time Ref to get SPI status */
 	x_spi_data.us_mem_id = ATPL360_STATUS_INFO_ID;
 	x_spi_data.us_len = sizeof(puc_int_buffer);
@@ -857,7 +1082,7 @@ atpl360_res_t atpl360_enable(uint32_t ul_binary_address, uint32_t ul_binary_len)
 	sul_dbg_len = 0;
 
 	/* Enable EXT INT */
-	sx_atpl360_hal_wrapper.plc_enable_int(true);
+	_plc_enable_int(true);
 
 	return ATPL360_SUCCESS;
 }
@@ -873,7 +1098,7 @@ void atpl360_disable(void)
 	sb_component_enabled = false;
 
 	/* Disable EXT INT by default */
-	sx_atpl360_hal_wrapper.plc_enable_int(false);
+	_plc_enable_int(false);
 
 	/* PL360 reset */
 	sx_atpl360_hal_wrapper.plc_reset();
@@ -912,6 +1137,9 @@ void atpl360_handle_events(void)
 			return;
 		}
 
+		/* Run SPI reads queued by the ISR */
+		_spi_trans_flush();
+
 		/* Check msg cfm events */
 		for (uc_i = 0; uc_i < NUM_TX_BUFFERS; uc_i++) {
 			if (spb_cfm_event_enable[uc_i]) {
@@ -949,12 +1177,12 @@ void atpl360_handle_events(void)
 			}
 		}
 
-		/* Check quality parameters and data msg ind events */
-		if (sb_param_ind_event_enable && sb_data_ind_event_enable) {
+		/* Check quality parameters and data msg ind events, in reception order */
+		while (suc_ind_rd_idx != suc_ind_wr_idx) {
 			rx_msg_t x_rx_msg;
 			uint8_t uc_ret;
 
-			uc_ret = atpl360_comm_parse((void *)&x_rx_msg, spuc_ind_buffer, sizeof(rx_msg_t));
+			uc_ret = atpl360_comm_parse((void *)&x_rx_msg, spuc_ind_buffer[suc_ind_rd_idx % ATPL360_RX_IND_SLOTS], sizeof(rx_msg_t));
 
 #ifdef ATPL360_ADDONS_ENABLE
 			/* Check Addons */
@@ -978,9 +1206,8 @@ void atpl360_handle_events(void)
 				}
 			}
 
-			/* Reset events flag */
-			sb_param_ind_event_enable = false;
-			sb_data_ind_event_enable = false;
+			/* Release slot */
+			suc_ind_rd_idx++;
 		}
 
 #ifdef ATPL360_ADDONS_ENABLE
@@ -1031,7 +1258,7 @@ void atpl360_set_sleep(bool sleep)
 		}
 
 		/* Disable PLC interrupts */
-		sx_atpl360_hal_wrapper.plc_enable_int(false);
+		_plc_enable_int(false);
 
 		/* Set PL360 STBY pin */
 		b_result = sx_atpl360_hal_wrapper.plc_set_stby_mode(true);
@@ -1041,7 +1268,7 @@ void atpl360_set_sleep(bool sleep)
 			sb_sleep_enabled = true;
 		} else {
 			/* STBY pin not available */
-			sx_atpl360_hal_wrapper.plc_enable_int(true);
+			_plc_enable_int(true);
 		}
 	} else {
 		/* Disable Sleep Mode */
@@ -1059,7 +1286,7 @@ void atpl360_set_sleep(bool sleep)
 		atpl360_boot_without_load();
 
 		/* Enable PLC interrupts */
-		sx_atpl360_hal_wrapper.plc_enable_int(true);
+		_plc_enable_int(true);
 
 		/* Update status var */
 		sb_sleep_enabled = false;
@@ -1099,10 +1326,11 @@ void atpl360_set_debug(bool debug)
 		}
 
 		/* Disable PLC interrupts */
-		sx_atpl360_hal_wrapper.plc_enable_int(false);
+		_plc_enable_int(false);
 
-		/* Reset PL360 */
+		/* Reset PL360: reads queued by the ISR are lost */
 		sx_atpl360_hal_wrapper.plc_reset();
+		suc_spi_trans_rd_idx = suc_spi_trans_wr_idx;
 
 		/* Enable CPU Wait */
 		atpl360_spi_boot_write_cmd_enable();
@@ -1120,8 +1348,9 @@ void atpl360_set_debug(bool debug)
 		/* Disable CPU Wait */
 		atpl360_boot_without_load();
 
-		/* Enable PLC interrupts */
-		sx_atpl360_hal_wrapper.plc_enable_int(true);
+		/* Drop reads queued while in debug mode, then enable PLC interrupts */
+		suc_spi_trans_rd_idx = suc_spi_trans_wr_idx;
+		_plc_enable_int(true);
 
 		/* Update status var */
 		sb_debug_enabled = false;
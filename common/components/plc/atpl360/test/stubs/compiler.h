@@ -0,0 +1,26 @@
+#ifndef COMPILER_H_INCLUDED
+#define COMPILER_H_INCLUDED
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define UNUSED(v)                 (void)(v)
+#define COMPILER_WORD_ALIGNED
+#define COMPILER_PACK_SET(alignment)
+#define COMPILER_PACK_RESET()
+#define div4_ceil(a)              (((a) + 3) >> 2)
+#define div8_ceil(a)              (((a) + 7) >> 3)
+
+static inline uint32_t __get_BASEPRI(void)
+{
+	return 0;
+}
+
+static inline void __set_BASEPRI(uint32_t ul_basepri)
+{
+	(void)ul_basepri;
+}
+
+#endif
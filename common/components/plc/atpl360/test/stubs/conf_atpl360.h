@@ -0,0 +1,6 @@
+#ifndef CONF_ATPL360_H_INCLUDED
+#define CONF_ATPL360_H_INCLUDED
+
+#define ATPL360_RST_WAIT_MS    1
+
+#endif
@@ -0,0 +1,469 @@
+/**
+ * \file
+ *
+ * \brief Host test of the ATPL360 driver over a mock SPI HAL.
+ *
+ * The mock device raises events through the driver ISR, pending them while
+ * the PLC interrupt is disabled, and counts the SPI bytes moved inside the
+ * ISR. Bursts of receptions with TX confirms and synchronous register reads
+ * must all be delivered intact, confirms and register responses must not be
+ * read in the ISR, and running the deferred reads must leave the PLC
+ * interrupt as it was (disabled in debug mode).
+ *
+ * More frames than ATPL360_RX_IND_SLOTS before the driver runs fill the RX
+ * indication ring: the oldest frames are delivered in order, the others are
+ * not read from the device and are counted as overflows.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../atpl360.c"
+
+#define BURSTS         100000
+#define RX_LEN         494
+/* Frames received with the RX indication ring full */
+#define OVF_FRAMES     3
+/* Bytes moved by a SPI transfer besides its data (command header) */
+#define SPI_HEADER     4
+
+static int si_failures;
+
+#define CHECK(cond) do { \
+		if (!(cond)) { \
+			printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+			si_failures++; \
+		} \
+	} while (0)
+
+/* Mock device */
+static void (*spf_isr)(void);
+static bool sb_int_enabled;
+static uint32_t sul_int_calls;
+static uint16_t sus_dev_flags;
+static uint32_t sul_dev_ev_info;
+static bool sb_in_isr;
+static bool sb_reg_pending;
+static uint32_t sul_reg_val;
+static uint16_t sus_rx_seq;
+
+/* SPI bytes moved in the last ISR run, and in the longest one */
+static uint32_t sul_isr_bytes;
+static uint32_t sul_isr_bytes_max;
+static uint32_t sul_isr_calls;
+
+/* Driver callbacks */
+static uint32_t sul_cfms;
+static uint32_t sul_inds;
+static uint32_t sul_bad_inds;
+static uint16_t sus_expected_seq;
+
+static void _run_isr(void)
+{
+	sb_in_isr = true;
+	sul_isr_bytes = 0;
+	spf_isr();
+	sb_in_isr = false;
+	sul_isr_calls++;
+	if (sul_isr_bytes > sul_isr_bytes_max) {
+		sul_isr_bytes_max = sul_isr_bytes;
+	}
+}
+
+/* Device raises events: the ISR runs now, or once the interrupt is enabled */
+static void _raise(uint16_t us_flags, uint32_t ul_ev_info)
+{
+	sus_dev_flags |= us_flags;
+	sul_dev_ev_info = ul_ev_info;
+	if (sb_int_enabled) {
+		_run_isr();
+	}
+}
+
+static void _hal_enable_int(bool b_enable)
+{
+	sul_int_calls++;
+	sb_int_enabled = b_enable;
+	if (b_enable && sus_dev_flags && !sb_in_isr) {
+		_run_isr();
+	}
+}
+
+void atpl360_spi_write_buf(atpl360_spi_data_t *px_data)
+{
+	if (sb_in_isr) {
+		sul_isr_bytes += px_data->us_len + SPI_HEADER;
+	}
+
+	if (px_data->us_mem_id == ATPL360_REG_INFO_ID) {
+		/* Register read request: response event once the transfer is done */
+		sb_reg_pending = true;
+	}
+}
+
+bool atpl360_spi_read_buf(atpl360_spi_data_t *px_data)
+{
+	uint16_t us_i;
+
+	if (sb_in_isr) {
+		sul_isr_bytes += px_data->us_len + SPI_HEADER;
+	}
+
+	memset(px_data->puc_data_buf, 0, px_data->us_len);
+	switch (px_data->us_mem_id) {
+	case ATPL360_STATUS_INFO_ID:
+		if (px_data->us_len >= 8) {
+			memcpy(px_data->puc_data_buf + 4, &sul_dev_ev_info, 4);
+		}
+		break;
+
+	case ATPL360_RX_PARAM_ID:
+		px_data->puc_data_buf[10] = (uint8_t)RX_LEN;
+		px_data->puc_data_buf[11] = (uint8_t)(RX_LEN >> 8);
+		break;
+
+	case ATPL360_RX_DATA_ID:
+		for (us_i = 0; us_i < px_data->us_len; us_i++) {
+			px_data->puc_data_buf[us_i] = (uint8_t)(sus_rx_seq + us_i);
+		}
+		break;
+
+	case ATPL360_REG_INFO_ID:
+		memcpy(px_data->puc_data_buf, &sul_reg_val, (px_data->us_len < 4) ? px_data->us_len : 4);
+		break;
+
+	default:
+		break;
+	}
+
+	return true;
+}
+
+atpl360_spi_status_t atpl360_spi_get_status(void)
+{
+	if (sb_reg_pending && !sb_in_isr) {
+		sb_reg_pending = false;
+		_raise(ATPL360_REG_RSP_MASK, (uint32_t)4 << 16);
+	}
+
+	return ATPL360_SPI_STATUS_CORTEX;
+}
+
+void atpl360_spi_get_status_info(atpl360_spi_status_info_t *px_status_info)
+{
+	px_status_info->us_header_id = 0x1122;
+	px_status_info->ul_flags = sus_dev_flags;
+	sus_dev_flags = 0;
+}
+
+void atpl360_spi_initialize(void)
+{
+}
+
+uint16_t atpl360_spi_boot_read_mem(uint32_t ul_addr, uint8_t *puc_data, uint16_t us_len)
+{
+	return us_len;
+}
+
+void atpl360_spi_boot_config_sys(void)
+{
+}
+
+void atpl360_spi_boot_write_cmd_enable(void)
+{
+}
+
+void atpl360_boot_without_load(void)
+{
+}
+
+void atpl360_boot_init(uint32_t ul_binary_address, uint32_t ul_binary_len)
+{
+}
+
+void atpl360_ib_init(void)
+{
+}
+
+bool atpl360_ib_get_param(atpl360_id_param_t us_id, void *px_value, uint8_t uc_size)
+{
+	memset(px_value, 0, uc_size);
+	return true;
+}
+
+bool atpl360_ib_set_param(atpl360_id_param_t us_id, void *px_value, uint8_t uc_size)
+{
+	return true;
+}
+
+static void _hal_nop(void)
+{
+}
+
+static void _hal_set_handler(void (*p_handler)(void))
+{
+	spf_isr = p_handler;
+}
+
+static void _hal_delay(uint8_t uc_tref, uint32_t ul_delay)
+{
+}
+
+static bool _hal_get_thw(void)
+{
+	return false;
+}
+
+static bool _hal_set_stby_mode(bool b_sleep)
+{
+	return true;
+}
+
+static bool _hal_send_boot_cmd(uint16_t us_cmd, uint32_t ul_addr, uint32_t ul_data_len, uint8_t *puc_data_buf, uint8_t *puc_data_read)
+{
+	return true;
+}
+
+static bool _hal_write_read_cmd(uint8_t uc_cmd, void *px_cmd, void *px_data)
+{
+	return true;
+}
+
+static void _data_confirm(tx_cfm_t *px_msg)
+{
+	sul_cfms++;
+}
+
+static void _data_indication(rx_msg_t *px_msg)
+{
+	/* Data as read into the slot: the parser places it by the target rx_msg_t layout */
+	uint8_t *puc_data = spuc_ind_buffer[suc_ind_rd_idx % ATPL360_RX_IND_SLOTS] + ATPL360_RX_PARAMS_SIZE;
+
+	if ((px_msg->us_data_len != RX_LEN) || (puc_data[0] != (uint8_t)sus_expected_seq) ||
+			(puc_data[RX_LEN - 1] != (uint8_t)(sus_expected_seq + RX_LEN - 1))) {
+		sul_bad_inds++;
+	}
+
+	sus_expected_seq++;
+	sul_inds++;
+}
+
+static atpl360_descriptor_t sx_desc;
+
+static void _start(void)
+{
+	atpl360_hal_wrapper_t x_hal;
+	atpl360_dev_callbacks_t x_cbs;
+
+	x_hal.plc_init = _hal_nop;
+	x_hal.plc_reset = _hal_nop;
+	x_hal.plc_set_stby_mode = _hal_set_stby_mode;
+	x_hal.plc_set_handler = _hal_set_handler;
+	x_hal.plc_send_boot_cmd = _hal_send_boot_cmd;
+	x_hal.plc_write_read_cmd = _hal_write_read_cmd;
+	x_hal.plc_enable_int = _hal_enable_int;
+	x_hal.plc_delay = _hal_delay;
+	x_hal.plc_get_thw = _hal_get_thw;
+	atpl360_init(&sx_desc, &x_hal);
+
+	memset(&x_cbs, 0, sizeof(x_cbs));
+	x_cbs.data_confirm = _data_confirm;
+	x_cbs.data_indication = _data_indication;
+	sx_desc.set_callbacks(&x_cbs);
+	CHECK(atpl360_enable(0, 0) == ATPL360_SUCCESS);
+	CHECK(sb_int_enabled);
+}
+
+/* Bursts of receptions with TX confirms, and register reads in between */
+static void test_bursts(void)
+{
+	uint32_t ul_i;
+	uint32_t ul_frames;
+	uint32_t ul_burst;
+	uint32_t ul_sent = 0;
+	uint32_t ul_cfms = 0;
+	uint32_t ul_regs = 0;
+	uint32_t ul_regs_ok = 0;
+	uint32_t ul_val;
+
+	srand(1);
+	for (ul_i = 0; ul_i < BURSTS; ul_i++) {
+		if ((ul_i % 7) == 0) {
+			sul_reg_val = ul_i;
+			ul_val = 0;
+			ul_regs++;
+			if (sx_desc.get_config(ATPL360_REG_MASK | 1, &ul_val, 4, true) && (ul_val == ul_i)) {
+				ul_regs_ok++;
+			}
+		}
+
+		/* 1 to 3 frames before the driver runs, the first one with a TX confirm */
+		ul_burst = 1 + (uint32_t)(rand() % ((ATPL360_RX_IND_SLOTS < 3) ? ATPL360_RX_IND_SLOTS : 3));
+		for (ul_frames = 0; ul_frames < ul_burst; ul_frames++) {
+			_raise((ul_frames ? 0 : ATPL360_TX_CFM_FLAG_MASK) | ATPL360_RX_DATA_IND_FLAG_MASK |
+					ATPL360_RX_QPAR_IND_FLAG_MASK, RX_LEN);
+			ul_cfms += ul_frames ? 0 : 1;
+			sus_rx_seq++;
+			ul_sent++;
+		}
+
+		atpl360_handle_events();
+	}
+
+	CHECK(sul_cfms == ul_cfms);
+	CHECK(sul_inds == ul_sent);
+	CHECK(sul_bad_inds == 0);
+	CHECK(ul_regs_ok == ul_regs);
+	CHECK(ul_int_rx_ovf_cnt == 0);
+	CHECK(sb_int_enabled);
+	printf("%u ISR runs, %u confirms, %u indications, %u/%u register reads\n", (unsigned)sul_isr_calls, (unsigned)sul_cfms,
+			(unsigned)sul_inds, (unsigned)ul_regs_ok, (unsigned)ul_regs);
+}
+
+/* SPI bytes moved in the ISR for each kind of event */
+static void test_isr_spi(void)
+{
+	uint32_t ul_status = ATPL360_EVENT_DATA_LENGTH + SPI_HEADER;
+	uint32_t ul_cfm;
+	uint32_t ul_reg;
+	uint32_t ul_rx;
+	uint32_t ul_val;
+
+	_raise(ATPL360_TX_CFM_FLAG_MASK, 0);
+	ul_cfm = sul_isr_bytes;
+	atpl360_handle_events();
+
+	sx_desc.get_config(ATPL360_REG_MASK | 1, &ul_val, 4, false);
+	atpl360_spi_get_status();
+	ul_reg = sul_isr_bytes;
+	atpl360_handle_events();
+
+	_raise(ATPL360_RX_DATA_IND_FLAG_MASK | ATPL360_RX_QPAR_IND_FLAG_MASK, RX_LEN);
+	ul_rx = sul_isr_bytes;
+	sus_rx_seq++;
+	atpl360_handle_events();
+
+	/* Confirm and register response are read out of the ISR */
+	CHECK(ul_cfm == ul_status);
+	CHECK(ul_reg == ul_status);
+	/* RX indication is still read in the ISR */
+	CHECK(ul_rx == ul_status + RX_LEN + SPI_HEADER + ATPL360_RX_PARAMS_SIZE + SPI_HEADER);
+	printf("SPI bytes in ISR: confirm %u (read out of ISR: %u), register %u, reception of %u bytes %u\n",
+			(unsigned)ul_cfm, (unsigned)(ATPL360_CMF_PKT_SIZE + SPI_HEADER), (unsigned)ul_reg, RX_LEN, (unsigned)ul_rx);
+}
+
+/* Deferred reads leave the PLC interrupt as it was */
+static void test_flush_int(void)
+{
+	uint32_t ul_calls;
+	uint32_t ul_cfms;
+
+	/* Nothing queued: interrupt not touched */
+	ul_calls = sul_int_calls;
+	atpl360_handle_events();
+	atpl360_handle_events();
+	CHECK(sul_int_calls == ul_calls);
+
+	/* Disabled by the caller: still disabled after the reads */
+	ul_cfms = sul_cfms;
+	_raise(ATPL360_TX_CFM_FLAG_MASK, 0);
+	_plc_enable_int(false);
+	_spi_trans_flush();
+	CHECK(!sb_int_enabled);
+	CHECK(suc_spi_trans_rd_idx == suc_spi_trans_wr_idx);
+	_plc_enable_int(true);
+	atpl360_handle_events();
+	CHECK(sul_cfms == ul_cfms + 1);
+
+	/* Debug mode: interrupt stays disabled, reads queued before are dropped */
+	_raise(ATPL360_TX_CFM_FLAG_MASK, 0);
+	atpl360_set_debug(true);
+	CHECK(!sb_int_enabled);
+	/* Interrupt that was already being served */
+	ul_cfms = sul_cfms;
+	sus_dev_flags = ATPL360_TX_CFM_FLAG_MASK;
+	_run_isr();
+	atpl360_handle_events();
+	_spi_trans_flush();
+	CHECK(!sb_int_enabled);
+	CHECK(sul_cfms == ul_cfms);
+	atpl360_set_debug(false);
+	CHECK(sb_int_enabled);
+	CHECK(suc_spi_trans_rd_idx == suc_spi_trans_wr_idx);
+}
+
+/* Raise frames with the data and params events in one interrupt, or in two */
+static void _raise_frames(uint32_t ul_frames, bool b_split)
+{
+	uint32_t ul_i;
+
+	for (ul_i = 0; ul_i < ul_frames; ul_i++) {
+		if (b_split) {
+			_raise(ATPL360_RX_DATA_IND_FLAG_MASK, RX_LEN);
+			_raise(ATPL360_RX_QPAR_IND_FLAG_MASK, RX_LEN);
+		} else {
+			_raise(ATPL360_RX_DATA_IND_FLAG_MASK | ATPL360_RX_QPAR_IND_FLAG_MASK, RX_LEN);
+		}
+
+		sus_rx_seq++;
+	}
+}
+
+/* Ring full: the oldest frames are delivered in order, the others counted */
+static void test_ring_overflow(void)
+{
+	uint32_t ul_data_cnt;
+	uint32_t ul_ovf_cnt;
+	uint32_t ul_inds;
+	uint8_t uc_split;
+
+	sul_bad_inds = 0;
+
+	for (uc_split = 0; uc_split < 2; uc_split++) {
+		ul_data_cnt = ul_int_rx_data_cnt;
+		ul_ovf_cnt = ul_int_rx_ovf_cnt;
+		ul_inds = sul_inds;
+		ul_int_rx_max_pending = 0;
+
+		_raise_frames(ATPL360_RX_IND_SLOTS + OVF_FRAMES, uc_split);
+		CHECK(ul_int_rx_max_pending == ATPL360_RX_IND_SLOTS);
+		CHECK(ul_int_rx_data_cnt == ul_data_cnt + ATPL360_RX_IND_SLOTS);
+		CHECK(ul_int_rx_ovf_cnt == ul_ovf_cnt + OVF_FRAMES);
+
+		/* Params of a dropped frame are not read either */
+		if (uc_split) {
+			CHECK(sul_isr_bytes == ATPL360_EVENT_DATA_LENGTH + SPI_HEADER);
+		}
+
+		atpl360_handle_events();
+		CHECK(sul_inds == ul_inds + ATPL360_RX_IND_SLOTS);
+		sus_expected_seq += OVF_FRAMES;
+
+		/* Room again: the next frame is delivered */
+		_raise_frames(1, uc_split);
+		atpl360_handle_events();
+		CHECK(sul_inds == ul_inds + ATPL360_RX_IND_SLOTS + 1);
+		CHECK(ul_int_rx_ovf_cnt == ul_ovf_cnt + OVF_FRAMES);
+	}
+
+	CHECK(sul_bad_inds == 0);
+	printf("RX ring of %u slot(s) full: %u more frames counted as overflow\n", ATPL360_RX_IND_SLOTS, OVF_FRAMES);
+}
+
+int main(void)
+{
+	_start();
+	test_bursts();
+	test_isr_spi();
+	test_flush_int();
+	test_ring_overflow();
+
+	if (si_failures) {
+		printf("%d failure(s)\n", si_failures);
+		return 1;
+	}
+
+	printf("OK\n");
+	return 0;
+}
@@ -50,6 +50,13 @@
 #include "conf_buart_if.h"
 #include "conf_board.h"
 
+/* Hook called from the RX interrupt when data is stored in the RX queue. */
+/* Define it in conf_buart_if.h, e.g. to wake the G3 app loop with */
+/* oss_notify_from_isr(OSS_EVENT_USI_RX) */
+#ifndef BUART_RX_NOTIFY
+#define BUART_RX_NOTIFY()
+#endif
+
 /* @cond 0 */
 /**INDENT-OFF**/
 #ifdef __cplusplus
@@ -367,6 +374,9 @@ static void _BUART_RX0_buffer_proc(void)
 			tc_start(TC_UART, TC_UART_CHN);
 		}
 
+		/* Signal received data */
+		BUART_RX_NOTIFY();
+
 		/* change RX buffer */
 		gs_ul_size_uart_buf0 = UART_BUFFER_SIZE;
 
@@ -443,6 +453,9 @@ static void _BUART_RX1_buffer_proc(void)
 			tc_start(TC_UART, TC_UART_CHN);
 		}
 
+		/* Signal received data */
+		BUART_RX_NOTIFY();
+
 		/* change RX buffer */
 		gs_ul_size_uart_buf1 = UART_BUFFER_SIZE;
 
@@ -518,6 +531,9 @@ static void _BUART_RX2_buffer_proc(void)
 			tc_start(TC_UART, TC_UART_CHN);
 		}
 
+		/* Signal received data */
+		BUART_RX_NOTIFY();
+
 		/* change RX buffer */
 		gs_ul_size_uart_buf2 = UART_BUFFER_SIZE;
 
@@ -593,6 +609,9 @@ static void _BUART_RX4_buffer_proc(void)
 			tc_start(TC_UART, TC_UART_CHN);
 		}
 
+		/* Signal received data */
+		BUART_RX_NOTIFY();
+
 		/* change RX buffer */
 		gs_ul_size_uart_buf4 = UART_BUFFER_SIZE;
 
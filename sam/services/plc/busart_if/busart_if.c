@@ -52,6 +52,13 @@
 #include "conf_board.h"
 #include "pdc.h"
 
+/* Hook called from the RX interrupt when data is stored in the RX queue. */
+/* Define it in conf_busart_if.h, e.g. to wake the G3 app loop with */
+/* oss_notify_from_isr(OSS_EVENT_USI_RX) */
+#ifndef BUSART_RX_NOTIFY
+#define BUSART_RX_NOTIFY()
+#endif
+
 /* @cond 0 */
 /**INDENT-OFF**/
 #ifdef __cplusplus
@@ -272,6 +279,9 @@ static void _BUSART_RX0_buffer_proc(void)
 		tc_start(TC_USART, TC_USART_CHN);
 	}
 
+	/* Signal received data */
+	BUSART_RX_NOTIFY();
+
 	/* change RX buffer */
 	gs_ul_size_usart_buf0 = USART_BUFFER_SIZE;
 
@@ -353,6 +363,9 @@ static void _BUSART_RX1_buffer_proc(void)
 		tc_start(TC_USART, TC_USART_CHN);
 	}
 
+	/* Signal received data */
+	BUSART_RX_NOTIFY();
+
 	/* change RX buffer */
 	gs_ul_size_usart_buf1 = USART_BUFFER_SIZE;
 
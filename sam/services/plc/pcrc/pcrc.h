@@ -44,6 +44,9 @@
 #ifndef PCRC_H_INCLUDED
 #define PCRC_H_INCLUDED
 
+#include <stdbool.h>
+#include <stdint.h>
+
 /* @cond 0 */
 /**INDENT-OFF**/
 #ifdef __cplusplus
@@ -90,6 +93,27 @@ enum PCRC_CRC_types {
 #define PCRC_HT_USI                   3
 /* @} */
 
+/* Number of bytes folded per iteration by the software kernels (1, 4 or 8) */
+#ifndef PCRC_SLICE_BY
+#define PCRC_SLICE_BY 4
+#endif
+
+#if (PCRC_SLICE_BY != 1) && (PCRC_SLICE_BY != 4) && (PCRC_SLICE_BY != 8)
+#error "PCRC_SLICE_BY must be 1, 4 or 8"
+#endif
+
+/* Minimum length to use the hardware CRC hook, if set */
+#ifndef PCRC_HW_MIN_LEN
+#define PCRC_HW_MIN_LEN 64
+#endif
+
+/**
+ * Hardware CRC hook. On entry *pul_crc holds the partial CRC, and on exit
+ * the updated one. Returns false if the request is not handled.
+ */
+typedef bool (*pcrc_hw_hook_t)(uint8_t uc_crc_type, const uint8_t *puc_buf,
+		uint32_t ul_len, uint32_t *pul_crc);
+
 /* Invalid CRC */
 #define PCRC_CRC_INVALID 0xFFFFFFFF
 
@@ -101,6 +125,15 @@ enum PCRC_CRC_types {
 uint32_t pcrc_calculate_crc(uint8_t *puc_buf, uint32_t ul_len,
 		uint8_t uc_header_type, uint8_t uc_crc_type);
 void pcrc_configure_sna(uint8_t *sna);
+uint16_t pcrc_crc16_ccitt_update(uint16_t us_crc, const uint8_t *puc_buf,
+		uint32_t ul_len);
+uint16_t pcrc_crc16_x25_update(uint16_t us_crc, const uint8_t *puc_buf,
+		uint32_t ul_len);
+uint32_t pcrc_crc32_update(uint32_t ul_crc, const uint8_t *puc_buf,
+		uint32_t ul_len);
+void pcrc_set_hw_hook(pcrc_hw_hook_t pf_hook);
+uint32_t pcrc_update_usi_crc(uint32_t ul_crc, const uint8_t *puc_buf,
+		uint32_t ul_len, uint8_t uc_crc_type);
 
 /* @} */
 
@@ -0,0 +1,7 @@
+#ifndef COMPILER_H_INCLUDED
+#define COMPILER_H_INCLUDED
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#endif
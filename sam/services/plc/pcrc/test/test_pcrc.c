@@ -0,0 +1,432 @@
+/**
+ * \file
+ *
+ * \brief Host test of the pcrc CRC engine, built once per PCRC_SLICE_BY.
+ *
+ * CRC16-CCITT, X.25, CRC32 and the USI CRCs are checked against the former
+ * byte-at-a-time loops and tables of MAC-RT, HyAL, HDLC, storage and pcrc,
+ * and against bitwise references, over random lengths, alignments, initial
+ * values and chunk splits. The hardware hook must be used from
+ * PCRC_HW_MIN_LEN bytes on, and software must take over when it declines.
+ * Then measures the throughput of every variant in MB/s.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../pcrc.c"
+
+#define BUF_SIZE          4096
+#define RANDOM_RUNS       100000
+#define BENCH_SIZE        65536
+#define BENCH_BYTES       (256UL * 1024 * 1024)
+
+static int si_failures;
+
+#define CHECK(cond) do { \
+		if (!(cond)) { \
+			printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+			si_failures++; \
+		} \
+	} while (0)
+
+static uint32_t sul_rng = 0x12345678;
+static uint8_t sauc_buf[BUF_SIZE + 8];
+static uint8_t sauc_bench[BENCH_SIZE];
+
+/* Hardware hook: number of calls, and whether it handles them */
+static uint32_t sul_hook_calls;
+static bool sb_hook_handles;
+
+static uint32_t _rand(void)
+{
+	sul_rng ^= sul_rng << 13;
+	sul_rng ^= sul_rng >> 17;
+	sul_rng ^= sul_rng << 5;
+	return sul_rng;
+}
+
+/* Former g_Crc16 of MacRt.c (crc16_tab of hyal.c was the same table) */
+static const uint16_t saus_former_ccitt_table[256] = {
+	0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50a5, 0x60c6, 0x70e7,
+	0x8108, 0x9129, 0xa14a, 0xb16b, 0xc18c, 0xd1ad, 0xe1ce, 0xf1ef,
+	0x1231, 0x0210, 0x3273, 0x2252, 0x52b5, 0x4294, 0x72f7, 0x62d6,
+	0x9339, 0x8318, 0xb37b, 0xa35a, 0xd3bd, 0xc39c, 0xf3ff, 0xe3de,
+	0x2462, 0x3443, 0x0420, 0x1401, 0x64e6, 0x74c7, 0x44a4, 0x5485,
+	0xa56a, 0xb54b, 0x8528, 0x9509, 0xe5ee, 0xf5cf, 0xc5ac, 0xd58d,
+	0x3653, 0x2672, 0x1611, 0x0630, 0x76d7, 0x66f6, 0x5695, 0x46b4,
+	0xb75b, 0xa77a, 0x9719, 0x8738, 0xf7df, 0xe7fe, 0xd79d, 0xc7bc,
+	0x48c4, 0x58e5, 0x6886, 0x78a7, 0x0840, 0x1861, 0x2802, 0x3823,
+	0xc9cc, 0xd9ed, 0xe98e, 0xf9af, 0x8948, 0x9969, 0xa90a, 0xb92b,
+	0x5af5, 0x4ad4, 0x7ab7, 0x6a96, 0x1a71, 0x0a50, 0x3a33, 0x2a12,
+	0xdbfd, 0xcbdc, 0xfbbf, 0xeb9e, 0x9b79, 0x8b58, 0xbb3b, 0xab1a,
+	0x6ca6, 0x7c87, 0x4ce4, 0x5cc5, 0x2c22, 0x3c03, 0x0c60, 0x1c41,
+	0xedae, 0xfd8f, 0xcdec, 0xddcd, 0xad2a, 0xbd0b, 0x8d68, 0x9d49,
+	0x7e97, 0x6eb6, 0x5ed5, 0x4ef4, 0x3e13, 0x2e32, 0x1e51, 0x0e70,
+	0xff9f, 0xefbe, 0xdfdd, 0xcffc, 0xbf1b, 0xaf3a, 0x9f59, 0x8f78,
+	0x9188, 0x81a9, 0xb1ca, 0xa1eb, 0xd10c, 0xc12d, 0xf14e, 0xe16f,
+	0x1080, 0x00a1, 0x30c2, 0x20e3, 0x5004, 0x4025, 0x7046, 0x6067,
+	0x83b9, 0x9398, 0xa3fb, 0xb3da, 0xc33d, 0xd31c, 0xe37f, 0xf35e,
+	0x02b1, 0x1290, 0x22f3, 0x32d2, 0x4235, 0x5214, 0x6277, 0x7256,
+	0xb5ea, 0xa5cb, 0x95a8, 0x8589, 0xf56e, 0xe54f, 0xd52c, 0xc50d,
+	0x34e2, 0x24c3, 0x14a0, 0x0481, 0x7466, 0x6447, 0x5424, 0x4405,
+	0xa7db, 0xb7fa, 0x8799, 0x97b8, 0xe75f, 0xf77e, 0xc71d, 0xd73c,
+	0x26d3, 0x36f2, 0x0691, 0x16b0, 0x6657, 0x7676, 0x4615, 0x5634,
+	0xd94c, 0xc96d, 0xf90e, 0xe92f, 0x99c8, 0x89e9, 0xb98a, 0xa9ab,
+	0x5844, 0x4865, 0x7806, 0x6827, 0x18c0, 0x08e1, 0x3882, 0x28a3,
+	0xcb7d, 0xdb5c, 0xeb3f, 0xfb1e, 0x8bf9, 0x9bd8, 0xabbb, 0xbb9a,
+	0x4a75, 0x5a54, 0x6a37, 0x7a16, 0x0af1, 0x1ad0, 0x2ab3, 0x3a92,
+	0xfd2e, 0xed0f, 0xdd6c, 0xcd4d, 0xbdaa, 0xad8b, 0x9de8, 0x8dc9,
+	0x7c26, 0x6c07, 0x5c64, 0x4c45, 0x3ca2, 0x2c83, 0x1ce0, 0x0cc1,
+	0xef1f, 0xff3e, 0xcf5d, 0xdf7c, 0xaf9b, 0xbfba, 0x8fd9, 0x9ff8,
+	0x6e17, 0x7e36, 0x4e55, 0x5e74, 0x2e93, 0x3eb2, 0x0ed1, 0x1ef0,
+};
+
+/* Former FCSTable of hdlc.c */
+static const uint16_t saus_former_x25_table[256] = {
+	0x0000, 0x1189, 0x2312, 0x329b, 0x4624, 0x57ad, 0x6536, 0x74bf,
+	0x8c48, 0x9dc1, 0xaf5a, 0xbed3, 0xca6c, 0xdbe5, 0xe97e, 0xf8f7,
+	0x1081, 0x0108, 0x3393, 0x221a, 0x56a5, 0x472c, 0x75b7, 0x643e,
+	0x9cc9, 0x8d40, 0xbfdb, 0xae52, 0xdaed, 0xcb64, 0xf9ff, 0xe876,
+	0x2102, 0x308b, 0x0210, 0x1399, 0x6726, 0x76af, 0x4434, 0x55bd,
+	0xad4a, 0xbcc3, 0x8e58, 0x9fd1, 0xeb6e, 0xfae7, 0xc87c, 0xd9f5,
+	0x3183, 0x200a, 0x1291, 0x0318, 0x77a7, 0x662e, 0x54b5, 0x453c,
+	0xbdcb, 0xac42, 0x9ed9, 0x8f50, 0xfbef, 0xea66, 0xd8fd, 0xc974,
+	0x4204, 0x538d, 0x6116, 0x709f, 0x0420, 0x15a9, 0x2732, 0x36bb,
+	0xce4c, 0xdfc5, 0xed5e, 0xfcd7, 0x8868, 0x99e1, 0xab7a, 0xbaf3,
+	0x5285, 0x430c, 0x7197, 0x601e, 0x14a1, 0x0528, 0x37b3, 0x263a,
+	0xdecd, 0xcf44, 0xfddf, 0xec56, 0x98e9, 0x8960, 0xbbfb, 0xaa72,
+	0x6306, 0x728f, 0x4014, 0x519d, 0x2522, 0x34ab, 0x0630, 0x17b9,
+	0xef4e, 0xfec7, 0xcc5c, 0xddd5, 0xa96a, 0xb8e3, 0x8a78, 0x9bf1,
+	0x7387, 0x620e, 0x5095, 0x411c, 0x35a3, 0x242a, 0x16b1, 0x0738,
+	0xffcf, 0xee46, 0xdcdd, 0xcd54, 0xb9eb, 0xa862, 0x9af9, 0x8b70,
+	0x8408, 0x9581, 0xa71a, 0xb693, 0xc22c, 0xd3a5, 0xe13e, 0xf0b7,
+	0x0840, 0x19c9, 0x2b52, 0x3adb, 0x4e64, 0x5fed, 0x6d76, 0x7cff,
+	0x9489, 0x8500, 0xb79b, 0xa612, 0xd2ad, 0xc324, 0xf1bf, 0xe036,
+	0x18c1, 0x0948, 0x3bd3, 0x2a5a, 0x5ee5, 0x4f6c, 0x7df7, 0x6c7e,
+	0xa50a, 0xb483, 0x8618, 0x9791, 0xe32e, 0xf2a7, 0xc03c, 0xd1b5,
+	0x2942, 0x38cb, 0x0a50, 0x1bd9, 0x6f66, 0x7eef, 0x4c74, 0x5dfd,
+	0xb58b, 0xa402, 0x9699, 0x8710, 0xf3af, 0xe226, 0xd0bd, 0xc134,
+	0x39c3, 0x284a, 0x1ad1, 0x0b58, 0x7fe7, 0x6e6e, 0x5cf5, 0x4d7c,
+	0xc60c, 0xd785, 0xe51e, 0xf497, 0x8028, 0x91a1, 0xa33a, 0xb2b3,
+	0x4a44, 0x5bcd, 0x6956, 0x78df, 0x0c60, 0x1de9, 0x2f72, 0x3efb,
+	0xd68d, 0xc704, 0xf59f, 0xe416, 0x90a9, 0x8120, 0xb3bb, 0xa232,
+	0x5ac5, 0x4b4c, 0x79d7, 0x685e, 0x1ce1, 0x0d68, 0x3ff3, 0x2e7a,
+	0xe70e, 0xf687, 0xc41c, 0xd595, 0xa12a, 0xb0a3, 0x8238, 0x93b1,
+	0x6b46, 0x7acf, 0x4854, 0x59dd, 0x2d62, 0x3ceb, 0x0e70, 0x1ff9,
+	0xf78f, 0xe606, 0xd49d, 0xc514, 0xb1ab, 0xa022, 0x92b9, 0x8330,
+	0x7bc7, 0x6a4e, 0x58d5, 0x495c, 0x3de3, 0x2c6a, 0x1ef1, 0x0f78,
+};
+
+/* Former Crc16Ccitt() of MacRt.c, also _HyALCrc16() with a zero initial value */
+static uint16_t _former_crc16_ccitt(const uint8_t *pu8Data, uint32_t u32Length, uint16_t u16Crc)
+{
+	while (u32Length--) {
+		u16Crc = saus_former_ccitt_table[(u16Crc >> 8) ^ (*pu8Data++)] ^ ((u16Crc & 0xFF) << 8);
+	}
+
+	return u16Crc;
+}
+
+/* Former Crc16() of storage.c, bit by bit */
+static uint16_t _former_storage_crc16(const uint8_t *pu8Data, uint32_t u32Length, uint16_t u16Poly, uint16_t u16Crc)
+{
+	uint8_t u8Index;
+
+	while (u32Length--) {
+		u16Crc ^= (*pu8Data++) << 8;
+		for (u8Index = 0; u8Index < 8; u8Index++) {
+			u16Crc = (u16Crc << 1) ^ ((u16Crc & 0x8000U) ? u16Poly : 0);
+		}
+	}
+
+	return u16Crc;
+}
+
+/* Former hdlc_ChksumCalculate(), without its 255 byte limit */
+static uint16_t _former_hdlc_fcs(uint16_t _fcs, const uint8_t *cp_p, uint32_t len)
+{
+	while (len != 0) {
+		_fcs = (uint16_t)((_fcs >> 8) ^ saus_former_x25_table[(_fcs ^ *cp_p++) & 0xff]);
+		len--;
+	}
+
+	return _fcs;
+}
+
+/* Former _eval_crc_32() of pcrc.c */
+static uint32_t _former_crc32(const uint8_t *puc_buf_ptr, uint32_t ul_len, uint32_t ul_crc_init)
+{
+	uint8_t uc_idx;
+	uint32_t ul_crc;
+
+	ul_crc = ul_crc_init;
+	while (ul_len--) {
+		uc_idx = (uint8_t)(ul_crc >> 24) ^ *puc_buf_ptr++;
+		ul_crc = (ul_crc << 8) ^ pul_crc32_table[uc_idx];
+	}
+
+	return ul_crc;
+}
+
+/* Former _eval_crc_16() of pcrc.c, for USI */
+static uint16_t _former_usi_crc16(const uint8_t *puc_buf_ptr, uint32_t ul_len, uint32_t ul_crc_init)
+{
+	uint16_t us_crc;
+
+	us_crc = ul_crc_init;
+	while (ul_len--) {
+		us_crc = (uint16_t)(pus_crc16_table[(us_crc >> 8) & 0xff] ^ (us_crc << 8) ^ (*puc_buf_ptr++ & 0x00ff));
+	}
+
+	return us_crc;
+}
+
+/* Bitwise CRC32, polynom 0x04C11DB7, MSB first */
+static uint32_t _bitwise_crc32(const uint8_t *puc_buf, uint32_t ul_len, uint32_t ul_crc)
+{
+	uint8_t uc_bit;
+
+	while (ul_len--) {
+		ul_crc ^= (uint32_t)*puc_buf++ << 24;
+		for (uc_bit = 0; uc_bit < 8; uc_bit++) {
+			ul_crc = (ul_crc << 1) ^ ((ul_crc & 0x80000000UL) ? 0x04C11DB7UL : 0);
+		}
+	}
+
+	return ul_crc;
+}
+
+/* Bitwise reflected CRC16, polynom 0x8408 */
+static uint16_t _bitwise_x25(const uint8_t *puc_buf, uint32_t ul_len, uint16_t us_crc)
+{
+	uint8_t uc_bit;
+
+	while (ul_len--) {
+		us_crc ^= *puc_buf++;
+		for (uc_bit = 0; uc_bit < 8; uc_bit++) {
+			us_crc = (us_crc >> 1) ^ ((us_crc & 1) ? 0x8408 : 0);
+		}
+	}
+
+	return us_crc;
+}
+
+/* Hardware hook computing with the former loops, or declining */
+static bool _hw_hook(uint8_t uc_crc_type, const uint8_t *puc_buf, uint32_t ul_len, uint32_t *pul_crc)
+{
+	sul_hook_calls++;
+	if (!sb_hook_handles) {
+		/* A declining hook may leave garbage behind */
+		*pul_crc = 0xDEADBEEF;
+		return false;
+	}
+
+	if (uc_crc_type == PCRC_CRC_TYPE_32) {
+		*pul_crc = _former_crc32(puc_buf, ul_len, *pul_crc);
+	} else {
+		*pul_crc = _former_crc16_ccitt(puc_buf, ul_len, (uint16_t)*pul_crc);
+	}
+
+	return true;
+}
+
+/* One-shot results against the former loops, any length, alignment and initial value */
+static void test_against_former(void)
+{
+	const uint8_t *puc_data;
+	uint32_t ul_run;
+	uint32_t ul_len;
+	uint32_t ul_init;
+	uint32_t ul_mismatches = 0;
+	uint32_t ul_i;
+
+	for (ul_i = 0; ul_i < sizeof(sauc_buf); ul_i++) {
+		sauc_buf[ul_i] = (uint8_t)_rand();
+	}
+
+	/* Former tables against the bitwise references */
+	for (ul_i = 0; ul_i < 256; ul_i++) {
+		sauc_buf[0] = (uint8_t)ul_i;
+		if ((saus_former_ccitt_table[ul_i] != _former_storage_crc16(sauc_buf, 1, 0x1021, 0)) ||
+				(saus_former_ccitt_table[ul_i] != pus_crc16_table[ul_i]) ||
+				(saus_former_x25_table[ul_i] != _bitwise_x25(sauc_buf, 1, 0)) ||
+				(pul_crc32_table[ul_i] != _bitwise_crc32(sauc_buf, 1, 0))) {
+			ul_mismatches++;
+		}
+	}
+
+	for (ul_run = 0; ul_run < RANDOM_RUNS; ul_run++) {
+		ul_len = (_rand() % 4) ? _rand() % 80 : _rand() % BUF_SIZE;
+		puc_data = &sauc_buf[_rand() % 8];
+		ul_init = (_rand() % 4) ? _rand() : 0;
+
+		if ((pcrc_crc16_ccitt_update((uint16_t)ul_init, puc_data, ul_len) !=
+				_former_crc16_ccitt(puc_data, ul_len, (uint16_t)ul_init)) ||
+				(pcrc_crc16_ccitt_update((uint16_t)ul_init, puc_data, ul_len) !=
+				_former_storage_crc16(puc_data, ul_len, 0x1021, (uint16_t)ul_init)) ||
+				(pcrc_crc16_x25_update((uint16_t)ul_init, puc_data, ul_len) !=
+				_former_hdlc_fcs((uint16_t)ul_init, puc_data, ul_len)) ||
+				(pcrc_crc32_update(ul_init, puc_data, ul_len) != _former_crc32(puc_data, ul_len, ul_init)) ||
+				(pcrc_update_usi_crc(ul_init & 0xFFFF, puc_data, ul_len, PCRC_CRC_TYPE_16) !=
+				_former_usi_crc16(puc_data, ul_len, ul_init & 0xFFFF)) ||
+				(pcrc_update_usi_crc(ul_init, puc_data, ul_len, PCRC_CRC_TYPE_32) !=
+				_former_crc32(puc_data, ul_len, ul_init))) {
+			ul_mismatches++;
+		}
+	}
+
+	CHECK(ul_mismatches == 0);
+	printf("slice-by-%d: %u random buffers, %u mismatches with the former loops\n", PCRC_SLICE_BY, (unsigned)RANDOM_RUNS,
+			(unsigned)ul_mismatches);
+}
+
+/* USI CRCs chained over random chunk splits give the one-shot result */
+static void test_chunks(void)
+{
+	static const uint8_t cauc_types[] = {PCRC_CRC_TYPE_8, PCRC_CRC_TYPE_16, PCRC_CRC_TYPE_32};
+	uint32_t ul_run;
+	uint32_t ul_len;
+	uint32_t ul_pos;
+	uint32_t ul_chunk;
+	uint32_t ul_crc;
+	uint32_t ul_mismatches = 0;
+	uint8_t uc_type;
+
+	for (ul_run = 0; ul_run < RANDOM_RUNS / 10; ul_run++) {
+		ul_len = 1 + _rand() % BUF_SIZE;
+		uc_type = cauc_types[_rand() % 3];
+		ul_crc = 0;
+		for (ul_pos = 0; ul_pos < ul_len; ul_pos += ul_chunk) {
+			ul_chunk = 1 + _rand() % ((_rand() % 2) ? 8 : 300);
+			if (ul_chunk > ul_len - ul_pos) {
+				ul_chunk = ul_len - ul_pos;
+			}
+
+			ul_crc = pcrc_update_usi_crc(ul_crc, &sauc_buf[ul_pos], ul_chunk, uc_type);
+		}
+
+		if (ul_crc != pcrc_calculate_crc(sauc_buf, ul_len, PCRC_HT_USI, uc_type)) {
+			ul_mismatches++;
+		}
+	}
+
+	CHECK(ul_mismatches == 0);
+	CHECK(pcrc_update_usi_crc(0, sauc_buf, 16, PCRC_CRC_TYPE_24) == PCRC_CRC_INVALID);
+}
+
+/* Hook used from PCRC_HW_MIN_LEN bytes, software taking over when it declines */
+static void test_hw_hook(void)
+{
+	uint32_t ul_calls;
+
+	pcrc_set_hw_hook(_hw_hook);
+
+	sb_hook_handles = true;
+	sul_hook_calls = 0;
+	CHECK(pcrc_crc32_update(0x1234, sauc_buf, PCRC_HW_MIN_LEN) == _former_crc32(sauc_buf, PCRC_HW_MIN_LEN, 0x1234));
+	CHECK(pcrc_crc16_ccitt_update(0x1234, sauc_buf, BUF_SIZE) == _former_crc16_ccitt(sauc_buf, BUF_SIZE, 0x1234));
+	CHECK(sul_hook_calls == 2);
+
+	ul_calls = sul_hook_calls;
+	CHECK(pcrc_crc32_update(0x1234, sauc_buf, PCRC_HW_MIN_LEN - 1) == _former_crc32(sauc_buf, PCRC_HW_MIN_LEN - 1, 0x1234));
+	CHECK(pcrc_crc16_x25_update(0x1234, sauc_buf, BUF_SIZE) == _former_hdlc_fcs(0x1234, sauc_buf, BUF_SIZE));
+	CHECK(sul_hook_calls == ul_calls);
+
+	sb_hook_handles = false;
+	CHECK(pcrc_crc32_update(0x1234, sauc_buf, BUF_SIZE) == _former_crc32(sauc_buf, BUF_SIZE, 0x1234));
+	CHECK(pcrc_crc16_ccitt_update(0x1234, sauc_buf, BUF_SIZE) == _former_crc16_ccitt(sauc_buf, BUF_SIZE, 0x1234));
+	CHECK(pcrc_update_usi_crc(0x1234, sauc_buf, BUF_SIZE, PCRC_CRC_TYPE_16) == _former_usi_crc16(sauc_buf, BUF_SIZE, 0x1234));
+	CHECK(sul_hook_calls == ul_calls + 3);
+
+	pcrc_set_hw_hook(NULL);
+}
+
+/* MB/s of a CRC function over BENCH_BYTES */
+static double _bench(uint32_t (*pf_crc)(const uint8_t *, uint32_t))
+{
+	volatile uint32_t ul_sink = 0;
+	struct timespec x_start;
+	struct timespec x_end;
+	uint32_t ul_round;
+
+	clock_gettime(CLOCK_MONOTONIC, &x_start);
+	for (ul_round = 0; ul_round < BENCH_BYTES / BENCH_SIZE; ul_round++) {
+		ul_sink += pf_crc(sauc_bench, BENCH_SIZE);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &x_end);
+	return BENCH_BYTES / ((double)(x_end.tv_sec - x_start.tv_sec) * 1e6 + (double)(x_end.tv_nsec - x_start.tv_nsec) / 1e3);
+}
+
+static uint32_t _bench_crc32(const uint8_t *puc_buf, uint32_t ul_len)
+{
+	return pcrc_crc32_update(0, puc_buf, ul_len);
+}
+
+static uint32_t _bench_ccitt(const uint8_t *puc_buf, uint32_t ul_len)
+{
+	return pcrc_crc16_ccitt_update(0, puc_buf, ul_len);
+}
+
+static uint32_t _bench_usi16(const uint8_t *puc_buf, uint32_t ul_len)
+{
+	return pcrc_update_usi_crc(0, puc_buf, ul_len, PCRC_CRC_TYPE_16);
+}
+
+static uint32_t _bench_x25(const uint8_t *puc_buf, uint32_t ul_len)
+{
+	return pcrc_crc16_x25_update(0xFFFF, puc_buf, ul_len);
+}
+
+static uint32_t _bench_former_crc32(const uint8_t *puc_buf, uint32_t ul_len)
+{
+	return _former_crc32(puc_buf, ul_len, 0);
+}
+
+static uint32_t _bench_former_ccitt(const uint8_t *puc_buf, uint32_t ul_len)
+{
+	return _former_crc16_ccitt(puc_buf, ul_len, 0);
+}
+
+static uint32_t _bench_former_usi16(const uint8_t *puc_buf, uint32_t ul_len)
+{
+	return _former_usi_crc16(puc_buf, ul_len, 0);
+}
+
+static uint32_t _bench_former_storage(const uint8_t *puc_buf, uint32_t ul_len)
+{
+	return _former_storage_crc16(puc_buf, ul_len, 0x1021, 0xFFFF);
+}
+
+static void test_bench(void)
+{
+	uint32_t ul_i;
+
+	for (ul_i = 0; ul_i < BENCH_SIZE; ul_i++) {
+		sauc_bench[ul_i] = (uint8_t)_rand();
+	}
+
+	printf("slice-by-%d MB/s: crc32 %.0f, crc16-ccitt %.0f, usi crc16 %.0f, x25 %.0f\n", PCRC_SLICE_BY,
+			_bench(_bench_crc32), _bench(_bench_ccitt), _bench(_bench_usi16), _bench(_bench_x25));
+	printf("former MB/s: crc32 %.0f, crc16-ccitt %.0f, usi crc16 %.0f, storage bitwise %.0f\n",
+			_bench(_bench_former_crc32), _bench(_bench_former_ccitt), _bench(_bench_former_usi16), _bench(_bench_former_storage));
+}
+
+int main(void)
+{
+	test_against_former();
+	test_chunks();
+	test_hw_hook();
+	test_bench();
+
+	if (si_failures) {
+		printf("%d failure(s)\n", si_failures);
+		return 1;
+	}
+
+	printf("OK\n");
+	return 0;
+}
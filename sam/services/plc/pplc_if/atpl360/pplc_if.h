@@ -103,9 +103,12 @@ typedef struct spi_status_info {
 /* \name PPLC interrupt priority */
 
 /* \note In case of use of FreeRTOS, GROUP_PRIO is greater value than
- * configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY */
+ * configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY if the handler calls FreeRTOS
+ * API (e.g. OSS event-driven mode). PPLC_PRIO can be redefined in conf_board.h */
 /* @{ */
+#ifndef PPLC_PRIO
 #define PPLC_PRIO          9 /* < PPLC interrupt group priority */
+#endif
 #define PPLC_ADC_PRIO      1 /* < PPLC PVDD monitor (ADC) interrupt group priority */
 /* @} */
 
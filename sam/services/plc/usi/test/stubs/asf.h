@@ -0,0 +1,10 @@
+#ifndef ASF_H_INCLUDED
+#define ASF_H_INCLUDED
+
+#include "compiler.h"
+#include "pcrc.h"
+
+#define Disable_global_interrupt()
+#define Enable_global_interrupt()
+
+#endif
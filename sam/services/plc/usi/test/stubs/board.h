@@ -0,0 +1,8 @@
+#ifndef BOARD_H_INCLUDED
+#define BOARD_H_INCLUDED
+
+#define SAME70_XPLAINED 1
+#define USER_BOARD      99
+#define BOARD           USER_BOARD
+
+#endif
@@ -0,0 +1,10 @@
+#ifndef COMPILER_H_INCLUDED
+#define COMPILER_H_INCLUDED
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define __REV(x) __builtin_bswap32(x)
+
+#endif
@@ -0,0 +1 @@
+/* Host stub: nothing needed */
@@ -0,0 +1,9 @@
+#ifndef CONF_USI_H_INCLUDED
+#define CONF_USI_H_INCLUDED
+
+#define USI_PORT_0      0
+
+#define NUM_PORTS       1
+#define PORT_0 CONF_PORT(UART_TYPE, USI_PORT_0, 115200, 1024, 1024)
+
+#endif
@@ -0,0 +1,509 @@
+/**
+ * \file
+ *
+ * \brief Host test of the USI frame decoder over a loopback serial port.
+ *
+ * Frames are encoded with usi_send_cmd() and fed back to usi_process() in
+ * reads of 1 byte up to the whole stream. Payloads range from plain bytes
+ * to only 0x7E/0x7D, whose escaped form is twice the RX buffer size. Some
+ * frames have garbage in front, are corrupted, are cut short, have a bad
+ * escape sequence or do not fit the RX buffer. Every good frame must be
+ * delivered once, in order and unchanged, and no bad frame may be
+ * delivered. Then times the decoder on escape-heavy frames against the
+ * former shift-based decoder.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../usi.c"
+
+#define RX_SIZE           1024
+#define MAX_PAYLOAD       1000
+#define FUZZ_FRAMES       40000
+#define BATCH_FRAMES      64
+#define STREAM_SIZE       (BATCH_FRAMES * 4 * (MAX_PAYLOAD + 8))
+#define BENCH_ROUNDS      20000
+
+/* Frame fates in the fuzz test */
+enum {
+	FRAME_OK,
+	FRAME_CORRUPT,
+	FRAME_CUT,
+	FRAME_BAD_ESCAPE,
+	FRAME_OVERSIZE
+};
+
+static int si_failures;
+
+#define CHECK(cond) do { \
+		if (!(cond)) { \
+			printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+			si_failures++; \
+		} \
+	} while (0)
+
+static uint32_t sul_rng = 0x12345678;
+
+/* Loopback stream: usi_send_cmd() writes at the end, usi_process() reads from sul_stream_pos */
+static uint8_t sauc_stream[STREAM_SIZE];
+static uint32_t sul_stream_len;
+static uint32_t sul_stream_pos;
+/* Largest read returned to usi_process() */
+static uint16_t sus_read_max;
+
+/* Frames expected in the current batch, in order */
+static uint32_t saul_expected[BATCH_FRAMES];
+static uint16_t sus_expected_count;
+static uint16_t sus_expected_pos;
+static uint32_t sul_delivered;
+static uint32_t sul_rx_mismatches;
+static bool sb_bench;
+
+static uint32_t _rand(void)
+{
+	sul_rng ^= sul_rng << 13;
+	sul_rng ^= sul_rng >> 17;
+	sul_rng ^= sul_rng << 5;
+	return sul_rng;
+}
+
+int8_t buart_if_open(uint8_t chn, uint32_t bauds)
+{
+	return 0;
+}
+
+bool buart_if_is_free(uint8_t chn)
+{
+	return true;
+}
+
+uint16_t buart_if_write(uint8_t chn, const void *buffer, uint16_t len)
+{
+	if (sul_stream_len + len > STREAM_SIZE) {
+		return 0;
+	}
+
+	memcpy(&sauc_stream[sul_stream_len], buffer, len);
+	sul_stream_len += len;
+	return len;
+}
+
+uint16_t buart_if_read(uint8_t chn, void *buffer, uint16_t len)
+{
+	uint32_t ul_len = 1 + _rand() % sus_read_max;
+
+	if (ul_len > len) {
+		ul_len = len;
+	}
+
+	if (ul_len > sul_stream_len - sul_stream_pos) {
+		ul_len = sul_stream_len - sul_stream_pos;
+	}
+
+	memcpy(buffer, &sauc_stream[sul_stream_pos], ul_len);
+	sul_stream_pos += ul_len;
+	return ul_len;
+}
+
+int8_t busart_if_open(uint8_t chn, uint32_t bauds)
+{
+	return 0;
+}
+
+bool busart_if_is_free(uint8_t chn)
+{
+	return true;
+}
+
+uint16_t busart_if_write(uint8_t chn, const void *buffer, uint16_t len)
+{
+	return 0;
+}
+
+uint16_t busart_if_read(uint8_t chn, void *buffer, uint16_t len)
+{
+	return 0;
+}
+
+/*
+ * Payload of frame ul_idx, rebuilt on delivery. Escape density: none, half
+ * or every byte but the command. The command fits in the XLEN byte.
+ */
+static uint16_t _frame(uint32_t ul_idx, uint16_t us_len, uint8_t *puc_buf, uint8_t *puc_type)
+{
+	uint32_t ul_rng = sul_rng;
+	uint8_t uc_density;
+	uint16_t us_i;
+
+	sul_rng = ul_idx * 2654435761UL + 1;
+	*puc_type = (_rand() % 8) ? PROTOCOL_ADP_G3 : PROTOCOL_PRIME_API;
+	uc_density = _rand() % 4;
+	if (us_len == 0) {
+		us_len = 1 + _rand() % MAX_PAYLOAD;
+	}
+
+	puc_buf[0] = _rand() & CMD_PROTOCOL_MSK;
+	for (us_i = 1; us_i < us_len; us_i++) {
+		if ((uc_density >= 2) || ((uc_density == 1) && (_rand() & 1))) {
+			puc_buf[us_i] = (_rand() & 1) ? MSGMARK : ESCMARK;
+		} else {
+			puc_buf[us_i] = (uint8_t)_rand();
+		}
+	}
+
+	sul_rng = ul_rng;
+	return us_len;
+}
+
+static void _check_rx(uint8_t uc_type, uint8_t *puc_rx_msg, uint16_t us_len)
+{
+	uint8_t auc_payload[MAX_PAYLOAD];
+	uint16_t us_exp_len;
+	uint8_t uc_exp_type;
+
+	sul_delivered++;
+	if (sb_bench) {
+		return;
+	}
+
+	if (sus_expected_pos >= sus_expected_count) {
+		sul_rx_mismatches++;
+		return;
+	}
+
+	us_exp_len = _frame(saul_expected[sus_expected_pos++], 0, auc_payload, &uc_exp_type);
+	if ((uc_type != uc_exp_type) || (us_len != us_exp_len) || memcmp(puc_rx_msg, auc_payload, us_len)) {
+		sul_rx_mismatches++;
+	}
+}
+
+static uint8_t _adp_cb(uint8_t *puc_rx_msg, uint16_t us_len)
+{
+	_check_rx(PROTOCOL_ADP_G3, puc_rx_msg, us_len);
+	return true;
+}
+
+static uint8_t _api_cb(uint8_t *puc_rx_msg, uint16_t us_len)
+{
+	_check_rx(PROTOCOL_PRIME_API, puc_rx_msg, us_len);
+	return true;
+}
+
+/* Encodes a frame at the end of the stream */
+static void _send(uint8_t uc_type, uint8_t *puc_buf, uint16_t us_len)
+{
+	cmd_params_t x_cmd;
+
+	x_cmd.uc_p_type = uc_type;
+	x_cmd.puc_buf = puc_buf;
+	x_cmd.us_len = us_len;
+	CHECK(usi_send_cmd(&x_cmd) == USI_STATUS_OK);
+}
+
+/* Bytes that are neither marks nor turn into one when bit 0 flips */
+static bool _can_flip(uint8_t uc_byte)
+{
+	return (uc_byte & 0xFE) != 0x7C && (uc_byte & 0xFE) != 0x7E && uc_byte != ESC_MSGMARK && uc_byte != ESC_ESCMARK;
+}
+
+/* Garbage before a frame: no marks, and an unknown protocol if taken as a message */
+static void _garbage(void)
+{
+	uint8_t uc_len = 2 + _rand() % 15;
+	uint8_t uc_i;
+	uint8_t uc_byte;
+
+	for (uc_i = 0; uc_i < uc_len; uc_i++) {
+		uc_byte = (uint8_t)_rand();
+		if ((uc_byte == MSGMARK) || (uc_byte == ESCMARK)) {
+			uc_byte = 0;
+		}
+
+		sauc_stream[sul_stream_len++] = (uc_i == 1) ? 0xBE : uc_byte;
+	}
+}
+
+static void test_fuzz(void)
+{
+	static const uint16_t caus_read_max[] = {1, 7, 64, RX_SIZE};
+	uint8_t auc_payload[MAX_PAYLOAD + 500];
+	uint32_t ul_frame = 0;
+	uint32_t ul_start;
+	uint32_t ul_pos;
+	uint32_t ul_good = 0;
+	uint32_t ul_bad = 0;
+	uint16_t us_len;
+	uint16_t us_i;
+	uint8_t uc_type;
+	uint8_t uc_fate;
+
+	usi_init();
+	CHECK(usi_set_callback(PROTOCOL_ADP_G3, _adp_cb, USI_PORT_0) == USI_STATUS_OK);
+	CHECK(usi_set_callback(PROTOCOL_PRIME_API, _api_cb, USI_PORT_0) == USI_STATUS_OK);
+	sul_delivered = 0;
+	sul_rx_mismatches = 0;
+
+	while (ul_frame < FUZZ_FRAMES) {
+		sul_stream_len = 0;
+		sul_stream_pos = 0;
+		sus_expected_count = 0;
+		sus_expected_pos = 0;
+		sus_read_max = caus_read_max[(ul_frame / BATCH_FRAMES) % 4];
+
+		for (us_i = 0; us_i < BATCH_FRAMES; us_i++, ul_frame++) {
+			us_len = _frame(ul_frame, 0, auc_payload, &uc_type);
+			uc_fate = FRAME_OK;
+			if (uc_type == PROTOCOL_ADP_G3) {
+				switch (_rand() % 32) {
+				case 0:
+				case 1:
+					uc_fate = FRAME_CORRUPT;
+					break;
+
+				case 2:
+				case 3:
+					uc_fate = FRAME_CUT;
+					break;
+
+				case 4:
+				case 5:
+					uc_fate = FRAME_BAD_ESCAPE;
+					break;
+
+				case 6:
+					uc_fate = FRAME_OVERSIZE;
+					us_len = _frame(ul_frame, RX_SIZE + _rand() % 400, auc_payload, &uc_type);
+					break;
+
+				default:
+					break;
+				}
+			}
+
+			if ((_rand() % 8) == 0) {
+				_garbage();
+			}
+
+			ul_start = sul_stream_len;
+			_send(uc_type, auc_payload, us_len);
+
+			if (uc_fate == FRAME_CORRUPT) {
+				/* Flip bit 0 of a payload byte, if any can be */
+				uc_fate = FRAME_OK;
+				for (ul_pos = ul_start + 5; ul_pos + 4 < sul_stream_len; ul_pos++) {
+					if (_can_flip(sauc_stream[ul_pos]) && (_rand() % 4 == 0)) {
+						sauc_stream[ul_pos] ^= 0x01;
+						uc_fate = FRAME_CORRUPT;
+						break;
+					}
+				}
+			} else if (uc_fate == FRAME_CUT) {
+				/* Drop the second half and the end mark: the next start mark ends it */
+				sul_stream_len = ul_start + 1 + (sul_stream_len - ul_start - 2) / 2;
+			} else if (uc_fate == FRAME_BAD_ESCAPE) {
+				/* Unknown escaped byte inside, or escape mark just before the end mark */
+				if (_rand() & 1) {
+					ul_pos = ul_start + 1 + _rand() % (sul_stream_len - ul_start - 1);
+					memmove(&sauc_stream[ul_pos + 2], &sauc_stream[ul_pos], sul_stream_len - ul_pos);
+					sauc_stream[ul_pos] = ESCMARK;
+					sauc_stream[ul_pos + 1] = (uint8_t)_rand() & 0x3F;
+					sul_stream_len += 2;
+				} else {
+					sauc_stream[sul_stream_len - 1] = ESCMARK;
+					sauc_stream[sul_stream_len++] = MSGMARK;
+				}
+			}
+
+			if (uc_fate == FRAME_OK) {
+				saul_expected[sus_expected_count++] = ul_frame;
+				ul_good++;
+			} else {
+				ul_bad++;
+			}
+		}
+
+		while (sul_stream_pos < sul_stream_len) {
+			usi_process();
+		}
+
+		/* The last frame ends the batch with its end mark */
+		if (sus_expected_pos != sus_expected_count) {
+			sul_rx_mismatches++;
+		}
+	}
+
+	CHECK(sul_rx_mismatches == 0);
+	CHECK(sul_delivered == ul_good);
+	printf("%u frames: %u good delivered, %u bad dropped, %u mismatches\n", (unsigned)FUZZ_FRAMES, (unsigned)sul_delivered,
+			(unsigned)ul_bad, (unsigned)sul_rx_mismatches);
+}
+
+/* Former _usi_shift_buffer_left() */
+static void _former_shift_buffer_left(uint8_t *puc_buf, int16_t us_n, int16_t us_len)
+{
+	uint16_t i = us_n;
+
+	while (i < us_len) {
+		puc_buf[i - us_n] = puc_buf[i];
+		i++;
+	}
+
+	i = us_len - us_n;
+	while (i < us_len) {
+		puc_buf[i++] = 0;
+	}
+}
+
+/* Former _decode_copy() */
+static uint16_t _former_decode_copy(uint8_t *puc_start, uint8_t *puc_end)
+{
+	uint16_t i = 0;
+	uint16_t us_curr_size;
+
+	us_curr_size = puc_end - puc_start - 1;
+	if (!us_curr_size) {
+		return 0;
+	}
+
+	while (i < us_curr_size) {
+		if (puc_start[i] == ESCMARK) {
+			if (puc_start[i + 1] == ESC_MSGMARK) {
+				puc_start[i] = MSGMARK;
+				_former_shift_buffer_left(&puc_start[i + 1], 1, us_curr_size - i);
+				us_curr_size--;
+				i++;
+			} else if (puc_start[i + 1] == ESC_ESCMARK) {
+				puc_start[i] = ESCMARK;
+				_former_shift_buffer_left(&puc_start[i + 1], 1, us_curr_size - i);
+				us_curr_size--;
+				i++;
+			} else {
+				return 0;
+			}
+		} else {
+			i++;
+		}
+	}
+
+	return(us_curr_size);
+}
+
+/* Former usi_process() on one whole frame already in the RX buffer */
+static void _former_process(uint8_t *puc_rx_start, uint16_t us_msg_size_pending)
+{
+	uint8_t *puc_first_token;
+	uint8_t *puc_last_token;
+	uint16_t us_msg_size;
+	uint16_t us_msg_dec_size;
+
+	puc_first_token = memchr(puc_rx_start, (uint8_t)MSGMARK, us_msg_size_pending);
+	puc_last_token = memchr(puc_first_token + 1, (uint8_t)MSGMARK, us_msg_size_pending - 1);
+	us_msg_size = puc_last_token - puc_rx_start + 1;
+	us_msg_dec_size = _former_decode_copy(puc_first_token, puc_last_token);
+	if (_doEoMsg(puc_first_token + 1, us_msg_dec_size)) {
+		_process_msg(puc_first_token + 1);
+	}
+
+	_former_shift_buffer_left(puc_rx_start, us_msg_size, us_msg_size_pending);
+}
+
+static double _elapsed_ns(struct timespec *px_start, struct timespec *px_end)
+{
+	return (double)(px_end->tv_sec - px_start->tv_sec) * 1e9 + (double)(px_end->tv_nsec - px_start->tv_nsec);
+}
+
+/* Decoding time of one frame with us_len payload bytes, uc_escapes percent of them escaped */
+static void _bench(uint16_t us_len, uint8_t uc_escapes)
+{
+	static uint8_t sauc_former_buf[RX_SIZE];
+	uint8_t auc_payload[MAX_PAYLOAD];
+	struct timespec x_start;
+	struct timespec x_end;
+	uint32_t ul_raw_len;
+	uint32_t ul_round;
+	uint32_t ul_delivered;
+	uint16_t us_i;
+	double d_stream;
+	double d_former;
+
+	auc_payload[0] = 0x01;
+	for (us_i = 1; us_i < us_len; us_i++) {
+		if ((_rand() % 100) < uc_escapes) {
+			auc_payload[us_i] = (_rand() & 1) ? MSGMARK : ESCMARK;
+		} else {
+			do {
+				auc_payload[us_i] = (uint8_t)_rand();
+			} while ((auc_payload[us_i] == MSGMARK) || (auc_payload[us_i] == ESCMARK));
+		}
+	}
+
+	sul_stream_len = 0;
+	_send(PROTOCOL_ADP_G3, auc_payload, us_len);
+	ul_raw_len = sul_stream_len;
+	sus_read_max = RX_SIZE;
+
+	sul_delivered = 0;
+	clock_gettime(CLOCK_MONOTONIC, &x_start);
+	for (ul_round = 0; ul_round < BENCH_ROUNDS; ul_round++) {
+		sul_stream_pos = 0;
+		while (sul_stream_pos < sul_stream_len) {
+			usi_process();
+		}
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &x_end);
+	d_stream = _elapsed_ns(&x_start, &x_end) / BENCH_ROUNDS;
+	ul_delivered = sul_delivered;
+
+	sul_delivered = 0;
+	clock_gettime(CLOCK_MONOTONIC, &x_start);
+	for (ul_round = 0; ul_round < BENCH_ROUNDS; ul_round++) {
+		memcpy(sauc_former_buf, sauc_stream, ul_raw_len);
+		_former_process(sauc_former_buf, ul_raw_len);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &x_end);
+	d_former = _elapsed_ns(&x_start, &x_end) / BENCH_ROUNDS;
+
+	CHECK(ul_delivered == BENCH_ROUNDS);
+	CHECK(sul_delivered == BENCH_ROUNDS);
+	printf("%7u  %7u%%  %6u  %9.0f  %6.1f  %9.0f  %6.1f\n", (unsigned)us_len, (unsigned)uc_escapes, (unsigned)ul_raw_len,
+			d_stream, ul_raw_len * 1e3 / d_stream, d_former, ul_raw_len * 1e3 / d_former);
+}
+
+static void test_bench(void)
+{
+	static const uint16_t caus_len[] = {64, 256, 500};
+	static const uint8_t cauc_escapes[] = {0, 50, 100};
+	uint8_t uc_i;
+	uint8_t uc_j;
+
+	usi_init();
+	usi_set_callback(PROTOCOL_ADP_G3, _adp_cb, USI_PORT_0);
+	sb_bench = true;
+	printf("payload  escapes  raw B  stream ns    MB/s  former ns    MB/s\n");
+	for (uc_i = 0; uc_i < sizeof(caus_len) / sizeof(caus_len[0]); uc_i++) {
+		for (uc_j = 0; uc_j < sizeof(cauc_escapes); uc_j++) {
+			_bench(caus_len[uc_i], cauc_escapes[uc_j]);
+		}
+	}
+
+	sb_bench = false;
+}
+
+int main(void)
+{
+	test_fuzz();
+	test_bench();
+
+	if (si_failures) {
+		printf("%d failure(s)\n", si_failures);
+		return 1;
+	}
+
+	printf("OK\n");
+	return 0;
+}
@@ -187,12 +187,27 @@ typedef struct {
 	uint16_t us_len;
 } cmd_params_t;
 
+/** Fragment of a message to be encoded (header, payload or CRC) */
+typedef struct {
+	/** Pointer to fragment data */
+	const uint8_t *puc_data;
+	/** Length of fragment data */
+	uint16_t us_len;
+} usi_frag_t;
+
+/** Number of fragments of an encoded message (header, payload and CRC) */
+#define USI_NUM_FRAGS 3
+
 /** USI communication control parameters structure */
 typedef struct {
-	/** Buffer index */
+	/** Number of encoded bytes staged in the TX buffer */
 	uint16_t us_idx_in;
 	/** Buffer data length */
 	uint16_t us_len;
+	/** Reception state (RX_IDLE, RX_MSG or RX_ESC) */
+	uint8_t uc_rx_state;
+	/** Frame in progress spans several reads: check its length on end */
+	bool b_rx_check_len;
 } USI_param_t;
 
 /** Reception states */
@@ -218,9 +233,6 @@ enum {
 /** USI communication control parameters (one entry per port) */
 static USI_param_t usi_cfg_param[NUM_PORTS];
 
-/** Flag to check len integrity in usi process */
-static bool sb_check_len;
-
 /** \brief Types of serial port */
 /* @{ */
 #define UART_TYPE   0
@@ -694,41 +706,84 @@ static uint8_t _doEoMsg(uint8_t *puc_rx_buf, uint16_t us_msg_size)
 }
 
 /**
- * \brief     Shifts the transmission buffer one byte to the right, starting
- *            from the byte following the byte to escape, and thus creating
- *            room for the escaped byte.
- *            Note that the check to see if there is enough space for it
- *            must be done previous to calling this function.
+ * \brief     Writes a chunk of encoded data through the port, retrying
+ *            until the driver has taken all of it.
+ *
+ *  \param    uc_port_idx  Port to transmit through
+ *  \param    puc_buf      Pointer to encoded data
+ *  \param    us_len       Length of encoded data
  *
+ *  \return   Result of operation:  USI_OK: Sent
+ *                                  USI_STATUS_UART_ERROR: Not sent
  */
-static void _usi_shift_buffer_right(uint8_t *puc_tx_buf, uint16_t us_idx, uint16_t us_len)
+static usi_status_t _usi_write(uint8_t uc_port_idx, uint8_t *puc_buf, uint16_t us_len)
 {
-	uint16_t us_orig, i;
-	uint8_t uc_backup_chars[2];
-	uint8_t uc_backup_char_idx;
-
-	/* Get current buffer index (byte following the character to escape)*/
-	us_orig = us_idx;
-
-	/* Start with the second element in the backup char array */
-	uc_backup_char_idx = 1;
-	uc_backup_chars[uc_backup_char_idx] = puc_tx_buf[us_orig++];
-	/* Toggle backup char index */
-	uc_backup_char_idx = 1 - uc_backup_char_idx;
-	i = 0;
-	while (i < us_len) {
-		uc_backup_chars[uc_backup_char_idx] = puc_tx_buf[us_orig + i];
-		/* Toggle backup char index */
-		uc_backup_char_idx = 1 - uc_backup_char_idx;
-		/* Write the stored char in its adjacent position to the right */
-		puc_tx_buf[us_orig + i] = uc_backup_chars[uc_backup_char_idx];
-		i++;
+	uint16_t us_sent_chars;
+
+	/* Check if there is something to transmit */
+	if (usi_cfg_map_ports[uc_port_idx].uc_s_type == UART_TYPE) {
+		while (!buart_if_is_free(usi_cfg_map_ports[uc_port_idx].uc_chn)) {
+			/* Wait last tx end */
+		}
+	} else if (usi_cfg_map_ports[uc_port_idx].uc_s_type == USART_TYPE) {
+		while (!busart_if_is_free(usi_cfg_map_ports[uc_port_idx].uc_chn)) {
+			/* Wait last tx end */
+		}
+	} else if (usi_cfg_map_ports[uc_port_idx].uc_s_type == USB_TYPE) {
+#ifdef UDI_CDC_PORT_NB
+		while (!usb_wrp_udc_is_tx_ready()) {
+			/* Wait last tx end */
+		}
+#endif
+	}
+
+	while (us_len) {
+		/* Send chars to device, checking how many have been
+		 * really processed by device */
+		if (usi_cfg_map_ports[uc_port_idx].uc_s_type == UART_TYPE) {
+			us_sent_chars = buart_if_write(usi_cfg_map_ports[uc_port_idx].uc_chn, puc_buf, us_len);
+		} else if (usi_cfg_map_ports[uc_port_idx].uc_s_type == USART_TYPE) {
+			us_sent_chars = busart_if_write(usi_cfg_map_ports[uc_port_idx].uc_chn, puc_buf, us_len);
+#ifdef UDI_CDC_PORT_NB
+		} else if (usi_cfg_map_ports[uc_port_idx].uc_s_type == USB_TYPE) {
+			us_sent_chars = usb_wrp_udc_write_buf(puc_buf, us_len);
+#endif
+		} else {
+			/* Port wrongly mapped: can't send. Do not retry */
+			us_sent_chars = us_len;
+		}
+
+		#if AD_HOC_USI_DEBUG
+		printf("us_sent_chars\r\n\r\n");
+		printf("%d", us_sent_chars);
+		printf("\r\n\r\n");
+		#endif
+
+		if (us_sent_chars == 0) {
+			/* Discard msg */
+			/* USI_ERROR: UART/USART error */
+			printf("USI_STATUS_UART_ERROR\r\n\r\n");
+			return USI_STATUS_UART_ERROR;
+		}
+
+		/* Adjust buffer values depending on sent chars */
+		puc_buf += us_sent_chars;
+		us_len -= us_sent_chars;
 	}
+
+	return USI_STATUS_OK;
 }
 
 /**
  * \brief     Encodes the escape characters and transmits the message
  *
+ *  The message is described as a list of fragments (header, payload and
+ *  CRC) that are escaped straight from their original location into the
+ *  TX buffer of the port. The TX buffer is only a staging area: it is
+ *  handed to the driver every time it fills up, so the payload is never
+ *  copied as a whole and the buffer does not need to hold the worst-case
+ *  escaped message.
+ *
  *  \param    uc_port_idx  Port to transmit through
  *  \param    msg       Pointer to data to be transmitted
  *
@@ -738,22 +793,22 @@ static void _usi_shift_buffer_right(uint8_t *puc_tx_buf, uint16_t us_idx, uint16
  */
 static usi_status_t _usi_encode_and_send(uint8_t uc_port_idx, cmd_params_t *msg)
 {
-	uint32_t ul_idx_in_orig;
-	uint32_t ul_idx_aux = 0;
+	usi_frag_t px_frags[USI_NUM_FRAGS];
+	uint8_t puc_header[HEADER_LEN + 1];
+	uint8_t puc_crc[CRC32_LEN];
 	uint32_t ul_crc;
-	uint32_t ul_size_coded = 0;
-	uint16_t us_len = 0;
-	uint16_t us_len_token = 0;
-	uint16_t us_sent_chars;
+	const uint8_t *puc_data;
+	const uint8_t *puc_data_end;
 	uint8_t *puc_tx_buf;
-	uint8_t *puc_tx_buf_ini;
-	uint8_t *puc_next_token = NULL;
-	uint8_t *puc_aux_next_token = NULL;
+	uint16_t us_tx_size;
+	uint16_t us_len;
+	uint8_t uc_crc_type;
+	uint8_t uc_crc_len;
 	uint8_t uc_cmd;
-	uint8_t uc_delimiter = MSGMARK;
-	uint8_t uc_escape    = ESCMARK;
-	uint8_t uc_escaped_byte = 0;
+	uint8_t uc_frag;
+	uint8_t uc_byte;
 	uint8_t uc_p_type = msg->uc_p_type;
+	usi_status_t uc_result;
 
 	/* Len protection */
 	if (msg->us_len == 0) {
@@ -762,45 +817,30 @@ static usi_status_t _usi_encode_and_send(uint8_t uc_port_idx, cmd_params_t *msg)
 
 	us_len = msg->us_len;
 
-	/* Get ptr to TxBuffer */
-	puc_tx_buf = usi_cfg_tx_buf[uc_port_idx].puc_buf;
-	puc_tx_buf_ini = puc_tx_buf;
-
-	/* Start Escape */
-	ul_idx_in_orig = usi_cfg_param[uc_port_idx].us_idx_in;
-	ul_idx_aux = usi_cfg_param[uc_port_idx].us_idx_in;
-	*puc_tx_buf++ = MSGMARK;
-	/* Copy message to TX buffer including header */
-	*puc_tx_buf++ = LEN_HI_PROTOCOL(us_len);
-	*puc_tx_buf++ = LEN_LO_PROTOCOL(us_len) + TYPE_PROTOCOL(uc_p_type);
-
-	memcpy(puc_tx_buf, msg->puc_buf, us_len);
-	/* Adjust XLEN if uc_p_type is internal protocol */
+	/* Header: LEN + protocol, and first payload byte (holds XLEN if needed) */
+	puc_header[0] = LEN_HI_PROTOCOL(us_len);
+	puc_header[1] = LEN_LO_PROTOCOL(us_len) + TYPE_PROTOCOL(uc_p_type);
 	uc_cmd = msg->puc_buf[0];
 	if ((uc_p_type == PROTOCOL_PRIME_API) || (uc_p_type == PROTOCOL_ADP_G3) || (uc_p_type == PROTOCOL_COORD_G3)) {
-		puc_tx_buf[0] = LEN_EX_PROTOCOL(us_len) + CMD_PROTOCOL(uc_cmd);
+		puc_header[2] = LEN_EX_PROTOCOL(us_len) + CMD_PROTOCOL(uc_cmd);
 	} else if (uc_p_type == PROTOCOL_PHY_MICROPLC) {
-		puc_tx_buf[0] = LEN_EX2_PROTOCOL(us_len) + CMD2_PROTOCOL(uc_cmd);
+		puc_header[2] = LEN_EX2_PROTOCOL(us_len) + CMD2_PROTOCOL(uc_cmd);
+	} else {
+		puc_header[2] = uc_cmd;
 	}
 
-	puc_tx_buf += us_len;
-	
 	#if AD_HOC_USI_DEBUG
 	printf("UART SEND PACKET LEN\r\n\r\n");
 	printf("%d", us_len);
 	printf("\r\n\r\n");
 	#endif
 
-	/* Update the index to the end of the data to send */
-	ul_idx_aux = puc_tx_buf - puc_tx_buf_ini;
-
-	/* Add 1 MSGMARK + 2 header bytes to LEN */
-	us_len += 3;
-
-	/* Calculate CRC */
+	/* Select CRC depending on protocol */
 	switch (uc_p_type) {
 	case PROTOCOL_PHY_MICROPLC:
 		/* No CRC */
+		uc_crc_type = PCRC_CRC_TYPE_8;
+		uc_crc_len = 0;
 		break;
 
 	case PROTOCOL_MNGP_PRIME_GETQRY:
@@ -811,12 +851,8 @@ static usi_status_t _usi_encode_and_send(uint8_t uc_port_idx, cmd_params_t *msg)
 	case PROTOCOL_MNGP_PRIME_FU:
 	case PROTOCOL_MNGP_PRIME_GETQRY_EN:
 	case PROTOCOL_MNGP_PRIME_GETRSP_EN:
-		ul_crc = pcrc_calculate_crc(&puc_tx_buf_ini[ul_idx_in_orig + 1], msg->us_len + 2, PCRC_HT_USI, PCRC_CRC_TYPE_32);
-		*puc_tx_buf++ = (uint8_t)((ul_crc >> 24) & 0xFF);
-		*puc_tx_buf++ = (uint8_t)((ul_crc >> 16) & 0xFF);
-		*puc_tx_buf++ = (uint8_t)((ul_crc >> 8) & 0xFF);
-		*puc_tx_buf++ = (uint8_t)(ul_crc & 0xFF);
-		us_len += 4;
+		uc_crc_type = PCRC_CRC_TYPE_32;
+		uc_crc_len = CRC32_LEN;
 		break;
 
 	case PROTOCOL_SNIF_PRIME:
@@ -828,249 +864,97 @@ static usi_status_t _usi_encode_and_send(uint8_t uc_port_idx, cmd_params_t *msg)
 	case PROTOCOL_ADP_G3:
 	case PROTOCOL_COORD_G3:
 	case PROTOCOL_USER_DEFINED:
-		ul_crc = pcrc_calculate_crc(&puc_tx_buf_ini[ul_idx_in_orig + 1], msg->us_len + 2, PCRC_HT_USI, PCRC_CRC_TYPE_16);
-		*puc_tx_buf++ = (uint8_t)(ul_crc >> 8);
-		*puc_tx_buf++ = (uint8_t)(ul_crc & 0xFF);
-		us_len += 2;
+		uc_crc_type = PCRC_CRC_TYPE_16;
+		uc_crc_len = CRC16_LEN;
 		break;
 
 	case PROTOCOL_PRIME_API:
 	default:
-		ul_crc = pcrc_calculate_crc(&puc_tx_buf_ini[ul_idx_in_orig + 1], msg->us_len + 2, PCRC_HT_USI, PCRC_CRC_TYPE_8);
-		*puc_tx_buf++ = (uint8_t)(ul_crc);
-		us_len += 1;
+		uc_crc_type = PCRC_CRC_TYPE_8;
+		uc_crc_len = CRC8_LEN;
 		break;
 	}
 
-	/* Fill tx buffer adding required escapes */
-	/* +1 for the still missing end MSGMARKs */
-	ul_size_coded = us_len + 1;
-	/* Check if there is still room */
-	if (ul_idx_in_orig + ul_size_coded > usi_cfg_tx_buf[uc_port_idx].us_size) {
-		/* No Room. Return error */
-		printf("USI_STATUS_TX_BUFFER_OVERFLOW\r\n\r\n");
-		return USI_STATUS_TX_BUFFER_OVERFLOW;
+	/* Calculate CRC over header and payload, without joining them */
+	if (uc_crc_len) {
+		ul_crc = pcrc_update_usi_crc(0, puc_header, sizeof(puc_header), uc_crc_type);
+		ul_crc = pcrc_update_usi_crc(ul_crc, &msg->puc_buf[1], us_len - 1, uc_crc_type);
+		for (uc_frag = 0; uc_frag < uc_crc_len; uc_frag++) {
+			puc_crc[uc_frag] = (uint8_t)(ul_crc >> ((uc_crc_len - 1 - uc_frag) << 3));
+		}
 	}
 
-	/* Reposition the index to the beginning of the data to send */
-	ul_idx_aux = ul_idx_in_orig + 1; /* Skip the initial MSGMARK */
-	us_len--; /* Skip the initial MSGMARK */
+	px_frags[0].puc_data = puc_header;
+	px_frags[0].us_len = sizeof(puc_header);
+	px_frags[1].puc_data = &msg->puc_buf[1];
+	px_frags[1].us_len = us_len - 1;
+	px_frags[2].puc_data = puc_crc;
+	px_frags[2].us_len = uc_crc_len;
 
-	puc_tx_buf = puc_tx_buf_ini;
-	while (us_len) {
-		/* Look for the next MSGMARK present within the data */
-		puc_next_token = memchr(&puc_tx_buf[ul_idx_in_orig + ul_idx_aux], uc_delimiter, us_len);
-		if (puc_next_token == NULL) {
-			/* MSGMARK not found -> look for the next ESCMARK
-			 * present within the data */
-			puc_next_token = memchr(&puc_tx_buf[ul_idx_in_orig + ul_idx_aux], uc_escape, us_len);
-			if (puc_next_token != NULL) {
-				uc_escaped_byte = ESC_ESCMARK;
-			}
-		} else {
-			/* Check if there is an ESCMARK before the MSGMARK */
-			puc_aux_next_token = memchr(&puc_tx_buf[ul_idx_in_orig + ul_idx_aux],
-					uc_escape,
-					puc_next_token - &puc_tx_buf[ul_idx_in_orig + ul_idx_aux]);
-			if (puc_aux_next_token != NULL) {
-				uc_escaped_byte = ESC_ESCMARK;
-				puc_next_token = puc_aux_next_token;
-			} else {
-				uc_escaped_byte = ESC_MSGMARK;
+	/* Stream escaped fragments through the TX staging buffer */
+	puc_tx_buf = usi_cfg_tx_buf[uc_port_idx].puc_buf;
+	us_tx_size = usi_cfg_tx_buf[uc_port_idx].us_size;
+	usi_cfg_param[uc_port_idx].us_idx_in = 0;
+	puc_tx_buf[usi_cfg_param[uc_port_idx].us_idx_in++] = MSGMARK;
+
+	for (uc_frag = 0; uc_frag < USI_NUM_FRAGS; uc_frag++) {
+		puc_data = px_frags[uc_frag].puc_data;
+		puc_data_end = puc_data + px_frags[uc_frag].us_len;
+		while (puc_data < puc_data_end) {
+			/* Keep room for an escaped byte */
+			if (usi_cfg_param[uc_port_idx].us_idx_in + 2 > us_tx_size) {
+				uc_result = _usi_write(uc_port_idx, puc_tx_buf, usi_cfg_param[uc_port_idx].us_idx_in);
+				usi_cfg_param[uc_port_idx].us_idx_in = 0;
+				if (uc_result != USI_STATUS_OK) {
+					return uc_result;
+				}
 			}
-		}
-
-		/* Perform the codification of the MSGMARK or the ESCMARK */
-		if (puc_next_token != NULL) {
-			ul_size_coded++;
 
-			/* Check if there is still room */
-			if (ul_idx_in_orig + ul_size_coded > usi_cfg_tx_buf[uc_port_idx].us_size) {
-				/* No Room. Reset index and return error */
-				printf("USI_STATUS_TX_BUFFER_OVERFLOW\r\n\r\n");
-				return USI_STATUS_TX_BUFFER_OVERFLOW;
+			uc_byte = *puc_data++;
+			if (uc_byte == MSGMARK) {
+				puc_tx_buf[usi_cfg_param[uc_port_idx].us_idx_in++] = ESCMARK;
+				puc_tx_buf[usi_cfg_param[uc_port_idx].us_idx_in++] = ESC_MSGMARK;
+			} else if (uc_byte == ESCMARK) {
+				puc_tx_buf[usi_cfg_param[uc_port_idx].us_idx_in++] = ESCMARK;
+				puc_tx_buf[usi_cfg_param[uc_port_idx].us_idx_in++] = ESC_ESCMARK;
+			} else {
+				puc_tx_buf[usi_cfg_param[uc_port_idx].us_idx_in++] = uc_byte;
 			}
-
-			us_len_token = puc_next_token - &puc_tx_buf[ul_idx_in_orig + ul_idx_aux];
-			/* Encode the special character */
-			ul_idx_aux += us_len_token;
-			puc_tx_buf[ul_idx_aux++] = ESCMARK;
-			us_len -= us_len_token + 1;
-
-			/* Shift the whole buffer by one byte to make room for
-			 * the escape character */
-			_usi_shift_buffer_right(puc_tx_buf, ul_idx_aux, us_len);
-
-			puc_tx_buf[ul_idx_aux++] = uc_escaped_byte;
-		} else { /* No MSGMARK or ESCMARK found. The buffer is complete */
-			ul_idx_aux += us_len;
-			us_len = 0;
 		}
 	}
 
-	puc_tx_buf[ul_idx_aux++] = MSGMARK;
+	/* There is always room for the end MSGMARK after the last check */
+	puc_tx_buf[usi_cfg_param[uc_port_idx].us_idx_in++] = MSGMARK;
 
 	#if AD_HOC_USI_DEBUG
 	uint32_t localCunter;
 	printf("UART SEND RAW DATA\r\n\r\n");
-	for(localCunter = 0; localCunter < ul_idx_aux; localCunter++)
+	for(localCunter = 0; localCunter < usi_cfg_param[uc_port_idx].us_idx_in; localCunter++)
 	{
 		printf("%02X", puc_tx_buf[localCunter]);
 	}
 	printf("\r\n\r\n");
 	#endif
-	
-	/* Message ready to be sent */
-	usi_cfg_param[uc_port_idx].us_idx_in = ul_idx_aux;
-	us_len = ul_idx_aux;
 
-	/* Check if there is something to transmit */
-	if (usi_cfg_map_ports[uc_port_idx].uc_s_type == UART_TYPE) {
-		while (!buart_if_is_free(usi_cfg_map_ports[uc_port_idx].uc_chn)) {
-			/* Wait last tx end */
-		}
-	} else if (usi_cfg_map_ports[uc_port_idx].uc_s_type == USART_TYPE) {
-		while (!busart_if_is_free(usi_cfg_map_ports[uc_port_idx].uc_chn)) {
-			/* Wait last tx end */
-		}
-	} else if (usi_cfg_map_ports[uc_port_idx].uc_s_type == USB_TYPE) {
-#ifdef UDI_CDC_PORT_NB
-		while (!usb_wrp_udc_is_tx_ready()) {
-			/* Wait last tx end */
-		}
-#endif
-	}
+	uc_result = _usi_write(uc_port_idx, puc_tx_buf, usi_cfg_param[uc_port_idx].us_idx_in);
+	usi_cfg_param[uc_port_idx].us_idx_in = 0;
 
-	while (usi_cfg_param[uc_port_idx].us_idx_in) {
-		/* Send chars to device, checking how many have been
-		 * really processed by device */
-		if (usi_cfg_map_ports[uc_port_idx].uc_s_type == UART_TYPE) {
-			us_sent_chars = buart_if_write(usi_cfg_map_ports[uc_port_idx].uc_chn,
-					usi_cfg_tx_buf[uc_port_idx].puc_buf,
-					us_len);
-		} else if (usi_cfg_map_ports[uc_port_idx].uc_s_type == USART_TYPE) {
-			us_sent_chars = busart_if_write(usi_cfg_map_ports[uc_port_idx].uc_chn,
-					usi_cfg_tx_buf[uc_port_idx].puc_buf,
-					us_len);
-#ifdef UDI_CDC_PORT_NB
-		} else if (usi_cfg_map_ports[uc_port_idx].uc_s_type == USB_TYPE) {
-			us_sent_chars = usb_wrp_udc_write_buf(usi_cfg_tx_buf[uc_port_idx].puc_buf, us_len);
-#endif
-		} else {
-			/* Port wrongly mapped: can't send. Do not retry */
-			us_sent_chars = us_len;
-		}
-
-		#if AD_HOC_USI_DEBUG
-		printf("us_sent_chars\r\n\r\n");
-		printf("%d", us_sent_chars);
-		printf("\r\n\r\n");
-		#endif
-
-		if (us_sent_chars > 0) {
-			/* Adjust buffer values depending on sent chars */
-			usi_cfg_param[uc_port_idx].us_idx_in -= us_sent_chars;
-		} else {
-			/* Discard msg */
-			usi_cfg_param[uc_port_idx].us_idx_in -= us_len;
-			/* USI_ERROR: UART/USART error */
-			printf("USI_STATUS_UART_ERROR\r\n\r\n");
-			return USI_STATUS_UART_ERROR;
-		}
-	}
-
-	return USI_STATUS_OK;
-}
-
-/**
- * \brief     Shifts the given buffer us_n bytes to the left, starting from
- *            the us_n-th + 1 byte (that will then become the first one).
- *            The us_n last positions of the buffer are padded with 0.
- *
- *  \param    puc_buf  Pointer to the byte to de-escape.
- *  \param    us_n     Number pf bytes to shift.
- *  \param    us_len   Size of the buffer to shift.
- *
- */
-static void _usi_shift_buffer_left(uint8_t *puc_buf, int16_t us_n, int16_t us_len)
-{
-	uint16_t i = us_n;
-
-	/* Start with the us_n-th element in the array */
-	while (i < us_len) {
-		puc_buf[i - us_n] = puc_buf[i];
-		i++;
-	}
-	/* Zero pad the end of the buffer */
-	i = us_len - us_n;
-	while (i < us_len) {
-		puc_buf[i++] = 0;
-	}
-}
-
-/** \brief   Decodes the escape sequences and updates the input buffer
- *           accordingly.
- *
- *  \param   puc_start  pointer to the input buffer
- *  \param   puc_end    pointer to the output buffer
- *
- *  \return  Updated length of the decoded array,
- *           0 if error.
- */
-static uint16_t _decode_copy(uint8_t *puc_start, uint8_t *puc_end)
-{
-	uint16_t i = 0;
-	uint16_t us_curr_size;
-
-	us_curr_size = puc_end - puc_start - 1;
-	if (!us_curr_size) {
-		return 0;
-	}
-
-	while (i < us_curr_size) {
-		if (puc_start[i] == ESCMARK) {
-			/* If the escaped byte is the MSGMARK, */
-			/* copy it to the destination buffer */
-			if (puc_start[i + 1] == ESC_MSGMARK) {
-				puc_start[i] = MSGMARK;
-				_usi_shift_buffer_left(&puc_start[i + 1], 1, us_curr_size - i);
-				us_curr_size--;
-				i++;
-			} else if (puc_start[i + 1] == ESC_ESCMARK) {
-				/* Idem, for ESCMARK */
-				puc_start[i] = ESCMARK;
-				_usi_shift_buffer_left(&puc_start[i + 1], 1, us_curr_size - i);
-				us_curr_size--;
-				i++;
-			} else { /* Error: unknown escaped character */
-				return 0;
-			}
-		} else {
-			/* No escape mark: continue */
-			i++;
-		}
-	}
-
-	return(us_curr_size);
+	return uc_result;
 }
 
 /**
  * \brief  This function checks len of the received message
  *
- *  \param  puc_rx_start       Pointer to start msg
+ *  \param  puc_data           Pointer to the decoded msg (after start mark)
  *  \param  us_msg_len         Message len to check
  *  \return true      if message is OK
  *          false     if message is not OK
  */
-static bool _check_integrity_len(uint8_t *puc_rx_start, uint16_t us_msg_len)
+static bool _check_integrity_len(uint8_t *puc_data, uint16_t us_msg_len)
 {
-	uint8_t *puc_data;
 	uint16_t us_len;
 	uint8_t uc_type;
 
-	/* get msg size */
-	puc_data = puc_rx_start + 1;
-
 	/* Get buffer and number of bytes */
 	if (us_msg_len < 4) {    /* insufficient data */
 		return false;
@@ -1137,34 +1021,162 @@ static bool _check_integrity_len(uint8_t *puc_rx_start, uint16_t us_msg_len)
 	}
 }
 
+/**
+ * \brief  Checks and dispatches a complete decoded message.
+ *
+ *  \param  uc_port_idx     Port the message has been received through
+ *  \param  puc_rx_msg      Pointer to the decoded message (without marks)
+ *  \param  us_msg_len      Decoded message length
+ */
+static void _usi_rx_msg(uint8_t uc_port_idx, uint8_t *puc_rx_msg, uint16_t us_msg_len)
+{
+	/* Check integrity len to resync frames received in several reads */
+	if (usi_cfg_param[uc_port_idx].b_rx_check_len) {
+		usi_cfg_param[uc_port_idx].b_rx_check_len = false;
+		if (!_check_integrity_len(puc_rx_msg, us_msg_len)) {
+			#if AD_HOC_USI_DEBUG
+				printf("ERROR: LEN, discard message\r\n");
+			#endif
+			return;
+		}
+	}
+
+	#if AD_HOC_USI_DEBUG
+	uint32_t localCunter;
+	printf("UART REC DATA\r\n\r\n");
+	for(localCunter = 0; localCunter < us_msg_len; localCunter++)
+	{
+		printf("%02X", puc_rx_msg[localCunter]);
+	}
+	printf("\r\n\r\n");
+	#endif
+
+	/* Calculate CRC */
+	if (_doEoMsg(puc_rx_msg, us_msg_len)) {
+		#if AD_HOC_USI_DEBUG
+			printf("OK CRC\r\n");
+		#endif
+		/* CRC is OK: process the message */
+		_process_msg(puc_rx_msg);
+	} else {
+		#if AD_HOC_USI_DEBUG
+			printf("Error CRC\r\n");
+		#endif
+	}
+}
+
+/**
+ * \brief  Decodes in place the raw bytes just read into the reception
+ *         buffer of a port, dispatching every complete message found.
+ *
+ *  Raw bytes are stored right after the decoded bytes of the message in
+ *  progress, so a single read pointer and a single write pointer are
+ *  enough: unescaping only shrinks data, and the write pointer never
+ *  overtakes the read pointer. The decoder state is kept per port, so
+ *  messages may be split across any number of reads.
+ *
+ *  \param  uc_port_idx     Port index
+ *  \param  us_new_len      Number of raw bytes read after the decoded ones
+ */
+static void _usi_rx_decode(uint8_t uc_port_idx, uint16_t us_new_len)
+{
+	uint8_t *puc_buf;
+	uint8_t *puc_rd;
+	uint8_t *puc_rd_end;
+	uint8_t *puc_wr;
+	uint8_t uc_state;
+	uint8_t uc_byte;
+
+	puc_buf = usi_cfg_rx_buf[uc_port_idx].puc_buf;
+	puc_wr = puc_buf + usi_cfg_rx_buf[uc_port_idx].us_size;
+	puc_rd = puc_wr;
+	puc_rd_end = puc_rd + us_new_len;
+	uc_state = usi_cfg_param[uc_port_idx].uc_rx_state;
+
+	while (puc_rd < puc_rd_end) {
+		uc_byte = *puc_rd++;
+
+		if (uc_state == RX_IDLE) {
+			/* Discard everything until a start mark */
+			if (uc_byte == MSGMARK) {
+				uc_state = RX_MSG;
+				puc_wr = puc_buf;
+			}
+		} else if (uc_byte == MSGMARK) {
+			if ((uc_state == RX_MSG) && (puc_wr != puc_buf)) {
+				/* End mark: message complete */
+				_usi_rx_msg(uc_port_idx, puc_buf, puc_wr - puc_buf);
+			}
+
+			/* Mark may also start the next message: resync on it */
+			usi_cfg_param[uc_port_idx].b_rx_check_len = false;
+			uc_state = RX_MSG;
+			puc_wr = puc_buf;
+		} else if (uc_state == RX_ESC) {
+			if (uc_byte == ESC_MSGMARK) {
+				*puc_wr++ = MSGMARK;
+				uc_state = RX_MSG;
+			} else if (uc_byte == ESC_ESCMARK) {
+				*puc_wr++ = ESCMARK;
+				uc_state = RX_MSG;
+			} else {
+				/* Error: unknown escaped character. Discard message */
+				usi_cfg_param[uc_port_idx].b_rx_check_len = false;
+				uc_state = RX_IDLE;
+			}
+		} else if (uc_byte == ESCMARK) {
+			uc_state = RX_ESC;
+		} else {
+			*puc_wr++ = uc_byte;
+		}
+	}
+
+	if (uc_state == RX_IDLE) {
+		usi_cfg_rx_buf[uc_port_idx].us_size = 0;
+	} else if (puc_wr - puc_buf >= usi_cfg_map_ports[uc_port_idx].us_rx_size) {
+		/* Message does not fit in the buffer. Discard it */
+		#if AD_HOC_USI_DEBUG
+			printf("ERROR: RX buffer full. Discard message\r\n");
+		#endif
+		usi_cfg_param[uc_port_idx].b_rx_check_len = false;
+		usi_cfg_rx_buf[uc_port_idx].us_size = 0;
+		uc_state = RX_IDLE;
+	} else {
+		/* Message pending: wait and check integrity through msg len on end */
+		if (puc_wr != puc_buf) {
+			usi_cfg_param[uc_port_idx].b_rx_check_len = true;
+		}
+
+		usi_cfg_rx_buf[uc_port_idx].us_size = puc_wr - puc_buf;
+	}
+
+	usi_cfg_param[uc_port_idx].uc_rx_state = uc_state;
+}
+
 /**
  * \brief Function to perform the USI RX process.
  */
 void usi_process(void)
 {
-	uint8_t *puc_rx_start;
 	uint8_t *puc_rx_aux;
-	uint8_t *puc_first_token;
-	uint8_t *puc_last_token;
-	uint16_t us_msg_size;
 	uint16_t us_msg_size_new = 0;
-	uint16_t us_msg_size_pending;
+	uint16_t us_rx_free;
 	uint8_t uc_port_idx;
-	
+
 	/* Check reception on every port */
 	for (uc_port_idx = 0; uc_port_idx < NUM_PORTS; uc_port_idx++) {
-		us_msg_size_pending = usi_cfg_rx_buf[uc_port_idx].us_size;
-		puc_rx_aux = &usi_cfg_rx_buf[uc_port_idx].puc_buf[0] + us_msg_size_pending;
-		puc_rx_start = &usi_cfg_rx_buf[uc_port_idx].puc_buf[0];
+		/* New raw data is appended to the decoded part of the pending message */
+		puc_rx_aux = usi_cfg_rx_buf[uc_port_idx].puc_buf + usi_cfg_rx_buf[uc_port_idx].us_size;
+		us_rx_free = usi_cfg_map_ports[uc_port_idx].us_rx_size - usi_cfg_rx_buf[uc_port_idx].us_size;
 
 		/* Read all the data in the respective buffer (UART or USART) */
 		if (usi_cfg_map_ports[uc_port_idx].uc_s_type == UART_TYPE) {
-			us_msg_size_new = buart_if_read(usi_cfg_map_ports[uc_port_idx].uc_chn, puc_rx_aux, usi_cfg_map_ports[uc_port_idx].us_rx_size);
+			us_msg_size_new = buart_if_read(usi_cfg_map_ports[uc_port_idx].uc_chn, puc_rx_aux, us_rx_free);
 		} else if (usi_cfg_map_ports[uc_port_idx].uc_s_type == USART_TYPE) {
-			us_msg_size_new = busart_if_read(usi_cfg_map_ports[uc_port_idx].uc_chn, puc_rx_aux, usi_cfg_map_ports[uc_port_idx].us_rx_size);
+			us_msg_size_new = busart_if_read(usi_cfg_map_ports[uc_port_idx].uc_chn, puc_rx_aux, us_rx_free);
 #ifdef UDI_CDC_PORT_NB
 		} else if (usi_cfg_map_ports[uc_port_idx].uc_s_type == USB_TYPE) {
-			us_msg_size_new = usb_wrp_udc_read_buf(puc_rx_aux, usi_cfg_map_ports[uc_port_idx].us_rx_size);
+			us_msg_size_new = usb_wrp_udc_read_buf(puc_rx_aux, us_rx_free);
 #endif
 		}
 
@@ -1183,77 +1195,8 @@ void usi_process(void)
 		us_msg_size_previous = us_msg_size_new;
 		#endif
 
-		/* Find first byte 0x7E */
-		us_msg_size_pending += us_msg_size_new;
-
-		if (us_msg_size_pending) {
-			puc_first_token = memchr(puc_rx_start, (uint8_t)MSGMARK, us_msg_size_pending);
-			if (puc_first_token) {
-				/* Update RX pointer to first decoded data byte */
-				puc_rx_aux = puc_first_token + 1;
-				/* Process received data */
-				puc_last_token = memchr(puc_rx_aux, (uint8_t)MSGMARK, us_msg_size_pending);
-				if (puc_last_token) {
-					uint16_t us_msg_dec_size;
-					/* Decode message */
-					us_msg_size = puc_last_token - puc_rx_start + 1;
-					us_msg_dec_size = _decode_copy(puc_first_token, puc_last_token);
-					/* Check integrity len to resync frames */
-					if (sb_check_len) {
-						sb_check_len = false;
-						/* Check integrity LEN */
-						if (!_check_integrity_len(puc_first_token, us_msg_dec_size)) {
-							/* printf("ERROR: discard message\r\n"); */
-							#if AD_HOC_USI_DEBUG
-								printf("ERROR: LEN, discard message\r\n");
-							#endif
-							/* ERROR: discard message except last 0x7E. It is the first token of the next frame */
-							_usi_shift_buffer_left(puc_rx_start, us_msg_size - 1, us_msg_size_pending);
-							usi_cfg_rx_buf[uc_port_idx].us_size = us_msg_size_pending - (us_msg_size - 1);
-							return;
-						}
-					}
-					#if AD_HOC_USI_DEBUG
-					uint32_t localCunter;
-					printf("UART REC DATA\r\n\r\n");
-					for(localCunter = 0; localCunter < us_msg_dec_size; localCunter++)
-					{
-						printf("%02X", puc_rx_aux[localCunter]);
-					}
-					printf("\r\n\r\n");
-					#endif
-					/* Calculate CRC */
-					if (_doEoMsg(puc_rx_aux, us_msg_dec_size)) {
-						#if AD_HOC_USI_DEBUG
-							printf("OK CRC\r\n");
-						#endif
-						/* CRC is OK: process the message */
-						_process_msg(puc_rx_aux);
-					}  else {
-						#if AD_HOC_USI_DEBUG
-					    printf("Error CRC\r\n");
-						#endif
-					  }
-
-					/* Update RX pointer to next process */
-					_usi_shift_buffer_left(puc_rx_start, us_msg_size, us_msg_size_pending);
-					usi_cfg_rx_buf[uc_port_idx].us_size = us_msg_size_pending - us_msg_size;
-				} else {
-					#if AD_HOC_USI_DEBUG
-						printf("ERROR: Not 0x7E as last byte. Wait and check integrity through msg len in next process\r\n");
-					#endif
-					/* ERROR: Not 0x7E as last byte. Wait and check integrity through msg len in next process */
-					sb_check_len = true;
-					usi_cfg_rx_buf[uc_port_idx].us_size = us_msg_size_pending;
-				}
-			} else {
-				#if AD_HOC_USI_DEBUG
-					printf("ERROR: Not 0x7E as first byte. Discard RX\r\n");
-				#endif
-				/* ERROR: Not 0x7E as first byte. Discard RX */
-				memset(puc_rx_start, 0, us_msg_size_pending);
-				usi_cfg_rx_buf[uc_port_idx].us_size = 0;
-			}
+		if (us_msg_size_new) {
+			_usi_rx_decode(uc_port_idx, us_msg_size_new);
 		}
 	}
 }
@@ -1276,6 +1219,11 @@ void usi_init(void)
 		/* Init Tx Parameters */
 		usi_cfg_param[i].us_idx_in = 0;
 
+		/* Init Rx Parameters */
+		usi_cfg_param[i].uc_rx_state = RX_IDLE;
+		usi_cfg_param[i].b_rx_check_len = false;
+		usi_cfg_rx_buf[i].us_size = 0;
+
 		/* Start USI port */
 		if (usi_cfg_map_ports[i].uc_s_type == UART_TYPE) {
 			buart_if_open(usi_cfg_map_ports[i].uc_chn, usi_cfg_map_ports[i].ul_speed);
@@ -1288,8 +1236,6 @@ void usi_init(void)
 		}
 	}
 
-	/* Init internal flag */
-	sb_check_len = false;
 }
 
 /** @brief  Function to transmit data through USI
@@ -1300,8 +1246,6 @@ void usi_init(void)
  */
 usi_status_t usi_send_cmd(void *msg)
 {
-	uint16_t us_available_len;
-	uint16_t us_len = ((cmd_params_t *)msg)->us_len;
 	uint8_t uc_p_type = ((cmd_params_t *)msg)->uc_p_type;
 	uint8_t uc_port_idx;
 	uint8_t uc_protocol_idx;
@@ -1318,18 +1262,16 @@ usi_status_t usi_send_cmd(void *msg)
 		return USI_STATUS_PROTOCOL_NOT_REGISTERED;
 	}
 
-	/* Get available length in buffer */
-	us_available_len = usi_cfg_tx_buf[uc_port_idx].us_size - usi_cfg_param[uc_port_idx].us_idx_in;
-
-	/* First checking, available length at least equal to minimum required space */
-	if (us_available_len < (us_len + MIN_OVERHEAD)) {
-		printf("USI_STATUS_RX_BUFFER_OVERFLOW\r\n\r\n");
-		return USI_STATUS_RX_BUFFER_OVERFLOW;
+	/* The TX buffer only stages encoded chunks, so the message does not
+	 * need to fit in it, but it must not be in use by another message */
+	if (usi_cfg_param[uc_port_idx].us_idx_in) {
+		printf("USI_STATUS_TX_BUFFER_OVERFLOW\r\n\r\n");
+		return USI_STATUS_TX_BUFFER_OVERFLOW;
 	}
 	#if AD_HOC_USI_DEBUG
 	uint32_t localCunter;
 	printf("UART PRE-SEND RAW DATA\r\n\r\n");
-	for(localCunter = 0; localCunter < us_len; localCunter++)
+	for(localCunter = 0; localCunter < ((cmd_params_t *)msg)->us_len; localCunter++)
 	{
 		printf("%02X", ((cmd_params_t *)msg)->puc_buf[localCunter]);
 	}
@@ -45,17 +45,146 @@
 //Use fixed-size blocks allocation?
 #if (NET_MEM_POOL_SUPPORT == ENABLED)
 
+/**
+ * @brief Size class of the memory pool
+ **/
+
+typedef struct
+{
+   uint8_t *pool;
+   bool_t *allocTable;
+   size_t blockSize;
+   uint_t blockCount;
+   uint_t currentUsage;
+   uint_t maxUsage;
+   uint_t failures;
+} MemPoolClass;
+
 //Mutex preventing simultaneous access to the memory pool
 static OsMutex memPoolMutex;
 //Memory pool
 static uint8_t memPool[NET_MEM_POOL_BUFFER_COUNT][NET_MEM_POOL_BUFFER_SIZE];
 //Allocation table
 static bool_t memPoolAllocTable[NET_MEM_POOL_BUFFER_COUNT];
+
+#if (NET_MEM_POOL_SMALL_BUFFER_COUNT > 0)
+//Small buffers
+static uint8_t memPoolSmall[NET_MEM_POOL_SMALL_BUFFER_COUNT][NET_MEM_POOL_SMALL_BUFFER_SIZE];
+static bool_t memPoolSmallAllocTable[NET_MEM_POOL_SMALL_BUFFER_COUNT];
+#endif
+
+#if (NET_MEM_POOL_MEDIUM_BUFFER_COUNT > 0)
+//Medium buffers
+static uint8_t memPoolMedium[NET_MEM_POOL_MEDIUM_BUFFER_COUNT][NET_MEM_POOL_MEDIUM_BUFFER_SIZE];
+static bool_t memPoolMediumAllocTable[NET_MEM_POOL_MEDIUM_BUFFER_COUNT];
+#endif
+
+//Size classes, sorted by increasing block size
+static MemPoolClass memPoolClass[NET_MEM_POOL_CLASS_COUNT] =
+{
+#if (NET_MEM_POOL_SMALL_BUFFER_COUNT > 0)
+   {memPoolSmall[0], memPoolSmallAllocTable,
+      NET_MEM_POOL_SMALL_BUFFER_SIZE, NET_MEM_POOL_SMALL_BUFFER_COUNT, 0, 0, 0},
+#endif
+#if (NET_MEM_POOL_MEDIUM_BUFFER_COUNT > 0)
+   {memPoolMedium[0], memPoolMediumAllocTable,
+      NET_MEM_POOL_MEDIUM_BUFFER_SIZE, NET_MEM_POOL_MEDIUM_BUFFER_COUNT, 0, 0, 0},
+#endif
+   {memPool[0], memPoolAllocTable,
+      NET_MEM_POOL_BUFFER_SIZE, NET_MEM_POOL_BUFFER_COUNT, 0, 0, 0}
+};
+
 //Number of buffers currently allocated
 uint_t memPoolCurrentUsage;
 //Maximum number of buffers that have been allocated so far
 uint_t memPoolMaxUsage;
 
+
+/**
+ * @brief Allocate a free block from a given size class
+ * @param[in] c Size class
+ * @return Pointer to the allocated block or NULL if the class is exhausted
+ **/
+
+static void *memPoolClassAlloc(MemPoolClass *c)
+{
+   uint_t i;
+
+   //Loop through allocation table
+   for(i = 0; i < c->blockCount; i++)
+   {
+      //Check whether the current block is free
+      if(!c->allocTable[i])
+      {
+         //Mark the current entry as used
+         c->allocTable[i] = TRUE;
+
+         //Update statistics
+         c->currentUsage++;
+         c->maxUsage = MAX(c->currentUsage, c->maxUsage);
+         memPoolCurrentUsage++;
+         memPoolMaxUsage = MAX(memPoolCurrentUsage, memPoolMaxUsage);
+
+         //Point to the corresponding memory block
+         return c->pool + i * c->blockSize;
+      }
+   }
+
+   //The size class is exhausted
+   return NULL;
+}
+
+
+/**
+ * @brief Allocate the smallest block that can hold the requested size
+ * @param[in] size Bytes to allocate
+ * @param[in] partial Fall back to the largest smaller block if no block fits
+ * @param[out] blockSize Size of the allocated block
+ * @return Pointer to the allocated block or NULL if there is insufficient memory available
+ **/
+
+static void *memPoolAllocBlock(size_t size, bool_t partial, size_t *blockSize)
+{
+   uint_t i;
+   void *p = NULL;
+
+   //Acquire exclusive access to the memory pool
+   osAcquireMutex(&memPoolMutex);
+
+   //Best fit, then larger classes when the best one is exhausted
+   for(i = 0; i < NET_MEM_POOL_CLASS_COUNT && p == NULL; i++)
+   {
+      if(memPoolClass[i].blockSize >= size)
+      {
+         p = memPoolClassAlloc(&memPoolClass[i]);
+
+         //Keep track of exhausted size classes
+         if(p == NULL)
+            memPoolClass[i].failures++;
+         else
+            *blockSize = memPoolClass[i].blockSize;
+      }
+   }
+
+   //Chain smaller blocks when no block can hold the requested size
+   for(i = NET_MEM_POOL_CLASS_COUNT; partial && i > 0 && p == NULL; i--)
+   {
+      if(memPoolClass[i - 1].blockSize < size)
+      {
+         p = memPoolClassAlloc(&memPoolClass[i - 1]);
+
+         if(p != NULL)
+            *blockSize = memPoolClass[i - 1].blockSize;
+      }
+   }
+
+   //Release exclusive access to the memory pool
+   osReleaseMutex(&memPoolMutex);
+
+   //Return a pointer to the allocated memory block
+   return p;
+}
+
 #endif
 
 
@@ -68,6 +197,8 @@ error_t memPoolInit(void)
 {
 //Use fixed-size blocks allocation?
 #if (NET_MEM_POOL_SUPPORT == ENABLED)
+   uint_t i;
+
    //Create a mutex to prevent simultaneous access to the memory pool
    if(!osCreateMutex(&memPoolMutex))
    {
@@ -75,8 +206,18 @@ error_t memPoolInit(void)
       return ERROR_OUT_OF_RESOURCES;
    }
 
-   //Clear allocation table
-   memset(memPoolAllocTable, 0, sizeof(memPoolAllocTable));
+   //Loop through size classes
+   for(i = 0; i < NET_MEM_POOL_CLASS_COUNT; i++)
+   {
+      //Clear allocation table
+      memset(memPoolClass[i].allocTable, 0,
+         memPoolClass[i].blockCount * sizeof(bool_t));
+
+      //Clear statistics
+      memPoolClass[i].currentUsage = 0;
+      memPoolClass[i].maxUsage = 0;
+      memPoolClass[i].failures = 0;
+   }
 
    //Clear statistics
    memPoolCurrentUsage = 0;
@@ -97,7 +238,7 @@ error_t memPoolInit(void)
 void *memPoolAlloc(size_t size)
 {
 #if (NET_MEM_POOL_SUPPORT == ENABLED)
-   uint_t i;
+   size_t blockSize;
 #endif
 
    //Pointer to the allocated memory block
@@ -108,36 +249,8 @@ void *memPoolAlloc(size_t size)
 
 //Use fixed-size blocks allocation?
 #if (NET_MEM_POOL_SUPPORT == ENABLED)
-   //Acquire exclusive access to the memory pool
-   osAcquireMutex(&memPoolMutex);
-
-   //Enforce block size
-   if(size <= NET_MEM_POOL_BUFFER_SIZE)
-   {
-      //Loop through allocation table
-      for(i = 0; i < NET_MEM_POOL_BUFFER_COUNT; i++)
-      {
-         //Check whether the current block is free
-         if(!memPoolAllocTable[i])
-         {
-            //Mark the current entry as used
-            memPoolAllocTable[i] = TRUE;
-            //Point to the corresponding memory block
-            p = memPool[i];
-
-            //Update statistics
-            memPoolCurrentUsage++;
-            //Maximum number of buffers that have been allocated so far
-            memPoolMaxUsage = MAX(memPoolCurrentUsage, memPoolMaxUsage);
-
-            //Exit immediately
-            break;
-         }
-      }
-   }
-
-   //Release exclusive access to the memory pool
-   osReleaseMutex(&memPoolMutex);
+   //Pick the smallest size class that can hold the requested size
+   p = memPoolAllocBlock(size, FALSE, &blockSize);
 #else
    //Allocate a memory block
    p = osAllocMem(size);
@@ -165,20 +278,33 @@ void memPoolFree(void *p)
 //Use fixed-size blocks allocation?
 #if (NET_MEM_POOL_SUPPORT == ENABLED)
    uint_t i;
+   uint_t n;
+   MemPoolClass *c;
 
    //Acquire exclusive access to the memory pool
    osAcquireMutex(&memPoolMutex);
 
-   //Loop through allocation table
-   for(i = 0; i < NET_MEM_POOL_BUFFER_COUNT; i++)
+   //Loop through size classes
+   for(i = 0; i < NET_MEM_POOL_CLASS_COUNT; i++)
    {
-      if(memPool[i] == p)
+      c = &memPoolClass[i];
+
+      //The block belongs to the current size class?
+      if((uint8_t *) p >= c->pool &&
+         (uint8_t *) p < (c->pool + c->blockCount * c->blockSize))
       {
-         //Mark the current block as free
-         memPoolAllocTable[i] = FALSE;
+         //Index of the block in the size class
+         n = ((uint8_t *) p - c->pool) / c->blockSize;
 
-         //Update statistics
-         memPoolCurrentUsage--;
+         if(c->allocTable[n])
+         {
+            //Mark the current block as free
+            c->allocTable[n] = FALSE;
+
+            //Update statistics
+            c->currentUsage--;
+            memPoolCurrentUsage--;
+         }
 
          //Exit immediately
          break;
@@ -215,7 +341,10 @@ void memPoolGetStats(uint_t *currentUsage, uint_t *maxUsage, uint_t *size)
 
    //Total number of buffers in the memory pool
    if(size != NULL)
-      *size = NET_MEM_POOL_BUFFER_COUNT;
+   {
+      *size = NET_MEM_POOL_BUFFER_COUNT + NET_MEM_POOL_SMALL_BUFFER_COUNT +
+         NET_MEM_POOL_MEDIUM_BUFFER_COUNT;
+   }
 #else
    //Memory pool is not used...
    if(currentUsage != NULL)
@@ -230,6 +359,48 @@ void memPoolGetStats(uint_t *currentUsage, uint_t *maxUsage, uint_t *size)
 }
 
 
+/**
+ * @brief Get memory pool usage for a given size class
+ * @param[in] index Size class index, from the smallest block size
+ *   (0 to NET_MEM_POOL_CLASS_COUNT - 1)
+ * @param[out] stats Usage and high-water mark of the size class
+ * @return Error code
+ **/
+
+error_t memPoolGetClassStats(uint_t index, MemPoolClassStats *stats)
+{
+   //Check parameters
+   if(stats == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+//Use fixed-size blocks allocation?
+#if (NET_MEM_POOL_SUPPORT == ENABLED)
+   //Make sure the size class is valid
+   if(index >= NET_MEM_POOL_CLASS_COUNT)
+      return ERROR_INVALID_PARAMETER;
+
+   //Acquire exclusive access to the memory pool
+   osAcquireMutex(&memPoolMutex);
+
+   stats->blockSize = memPoolClass[index].blockSize;
+   stats->blockCount = memPoolClass[index].blockCount;
+   stats->currentUsage = memPoolClass[index].currentUsage;
+   stats->maxUsage = memPoolClass[index].maxUsage;
+   stats->failures = memPoolClass[index].failures;
+
+   //Release exclusive access to the memory pool
+   osReleaseMutex(&memPoolMutex);
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //Memory pool is not used...
+   (void) index;
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
 /**
  * @brief Allocate a multi-part buffer
  * @param[in] length Desired length
@@ -242,8 +413,20 @@ NetBuffer *netBufferAlloc(size_t length)
    error_t error;
    NetBuffer *buffer;
 
+   size_t size;
+
+//Use fixed-size blocks allocation?
+#if (NET_MEM_POOL_SUPPORT == ENABLED)
+   //Allocate the smallest block that holds the header and the data, up to
+   //a full buffer. Any remaining data is chained in additional chunks
+   buffer = memPoolAllocBlock(MIN(CHUNKED_BUFFER_HEADER_SIZE + length,
+      NET_MEM_POOL_BUFFER_SIZE), FALSE, &size);
+#else
    //Allocate memory to hold the multi-part buffer
-   buffer = memPoolAlloc(NET_MEM_POOL_BUFFER_SIZE);
+   size = NET_MEM_POOL_BUFFER_SIZE;
+   buffer = memPoolAlloc(size);
+#endif
+
    //Failed to allocate memory?
    if(buffer == NULL)
       return NULL;
@@ -252,7 +435,7 @@ NetBuffer *netBufferAlloc(size_t length)
    buffer->chunkCount = 1;
    buffer->maxChunkCount = MAX_CHUNK_COUNT;
    buffer->chunk[0].address = (uint8_t *) buffer + CHUNKED_BUFFER_HEADER_SIZE;
-   buffer->chunk[0].length = NET_MEM_POOL_BUFFER_SIZE - CHUNKED_BUFFER_HEADER_SIZE;
+   buffer->chunk[0].length = size - CHUNKED_BUFFER_HEADER_SIZE;
    buffer->chunk[0].size = 0;
 
    //Adjust the length of the buffer
@@ -318,6 +501,7 @@ error_t netBufferSetLength(NetBuffer *buffer, size_t length)
 {
    uint_t i;
    uint_t chunkCount;
+   size_t size;
    ChunkDesc *chunk;
 
    //Get the actual number of chunks
@@ -377,16 +561,25 @@ error_t netBufferSetLength(NetBuffer *buffer, size_t length)
          //Point to the chunk descriptor;
          chunk = &buffer->chunk[i];
 
+//Use fixed-size blocks allocation?
+#if (NET_MEM_POOL_SUPPORT == ENABLED)
+         //Allocate memory to hold a new chunk. Full buffers keep the number
+         //of chunks low, smaller blocks are chained when none is left
+         chunk->address = memPoolAllocBlock(NET_MEM_POOL_BUFFER_SIZE,
+            TRUE, &size);
+#else
          //Allocate memory to hold a new chunk
-         chunk->address = memPoolAlloc(NET_MEM_POOL_BUFFER_SIZE);
+         size = NET_MEM_POOL_BUFFER_SIZE;
+         chunk->address = memPoolAlloc(size);
+#endif
          //Failed to allocate memory?
          if(!chunk->address)
             return ERROR_OUT_OF_MEMORY;
 
          //Allocated memory
-         chunk->size = NET_MEM_POOL_BUFFER_SIZE;
+         chunk->size = (uint16_t) size;
          //Actual length of the data chunk
-         chunk->length = MIN(length, NET_MEM_POOL_BUFFER_SIZE);
+         chunk->length = (uint16_t) MIN(length, size);
 
          //Prepare to process next chunk
          length -= chunk->length;
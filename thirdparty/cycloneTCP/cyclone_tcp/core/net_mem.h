@@ -54,6 +54,42 @@
    #error NET_MEM_POOL_BUFFER_SIZE parameter is not valid
 #endif
 
+//Number of small buffers available (0 to disable the size class)
+#ifndef NET_MEM_POOL_SMALL_BUFFER_COUNT
+   #define NET_MEM_POOL_SMALL_BUFFER_COUNT 0
+#elif (NET_MEM_POOL_SMALL_BUFFER_COUNT < 0)
+   #error NET_MEM_POOL_SMALL_BUFFER_COUNT parameter is not valid
+#endif
+
+//Size of the small buffers
+#ifndef NET_MEM_POOL_SMALL_BUFFER_SIZE
+   #define NET_MEM_POOL_SMALL_BUFFER_SIZE 256
+#elif (NET_MEM_POOL_SMALL_BUFFER_SIZE < 64 || (NET_MEM_POOL_SMALL_BUFFER_SIZE % 4) != 0)
+   #error NET_MEM_POOL_SMALL_BUFFER_SIZE parameter is not valid
+#endif
+
+//Number of medium buffers available (0 to disable the size class)
+#ifndef NET_MEM_POOL_MEDIUM_BUFFER_COUNT
+   #define NET_MEM_POOL_MEDIUM_BUFFER_COUNT 0
+#elif (NET_MEM_POOL_MEDIUM_BUFFER_COUNT < 0)
+   #error NET_MEM_POOL_MEDIUM_BUFFER_COUNT parameter is not valid
+#endif
+
+//Size of the medium buffers
+#ifndef NET_MEM_POOL_MEDIUM_BUFFER_SIZE
+   #define NET_MEM_POOL_MEDIUM_BUFFER_SIZE 512
+#elif (NET_MEM_POOL_MEDIUM_BUFFER_SIZE <= NET_MEM_POOL_SMALL_BUFFER_SIZE || (NET_MEM_POOL_MEDIUM_BUFFER_SIZE % 4) != 0)
+   #error NET_MEM_POOL_MEDIUM_BUFFER_SIZE parameter is not valid
+#endif
+
+#if (NET_MEM_POOL_MEDIUM_BUFFER_SIZE >= NET_MEM_POOL_BUFFER_SIZE)
+   #error NET_MEM_POOL_MEDIUM_BUFFER_SIZE must be lower than NET_MEM_POOL_BUFFER_SIZE
+#endif
+
+//Number of size classes in the memory pool
+#define NET_MEM_POOL_CLASS_COUNT ((NET_MEM_POOL_SMALL_BUFFER_COUNT > 0) + \
+   (NET_MEM_POOL_MEDIUM_BUFFER_COUNT > 0) + 1)
+
 //Size of the header part of the buffer
 #define CHUNKED_BUFFER_HEADER_SIZE (sizeof(NetBuffer) + MAX_CHUNK_COUNT * sizeof(ChunkDesc))
 
@@ -98,11 +134,26 @@ typedef struct
 } NetBuffer1;
 
 
+/**
+ * @brief Memory pool statistics for a given size class
+ **/
+
+typedef struct
+{
+   size_t blockSize;
+   uint_t blockCount;
+   uint_t currentUsage;
+   uint_t maxUsage;
+   uint_t failures;
+} MemPoolClassStats;
+
+
 //Memory management functions
 error_t memPoolInit(void);
 void *memPoolAlloc(size_t size);
 void memPoolFree(void *p);
 void memPoolGetStats(uint_t *currentUsage, uint_t *maxUsage, uint_t *size);
+error_t memPoolGetClassStats(uint_t index, MemPoolClassStats *stats);
 
 NetBuffer *netBufferAlloc(size_t length);
 void netBufferFree(NetBuffer *buffer);
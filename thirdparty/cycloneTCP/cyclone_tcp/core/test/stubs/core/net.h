@@ -0,0 +1,31 @@
+#ifndef _NET_H
+#define _NET_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+typedef unsigned int uint_t;
+typedef int bool_t;
+
+#define TRUE 1
+#define FALSE 0
+#define ENABLED 1
+#define DISABLED 0
+
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+#define arraysize(a) (sizeof(a) / sizeof(a[0]))
+#define PRIuSIZE "zu"
+
+#define IPV4_SUPPORT DISABLED
+#define IPV6_SUPPORT ENABLED
+
+//As in module_config/net_config.h
+#define IPV6_MAX_FRAG_DATAGRAM_SIZE 8192
+
+#include "os_port.h"
+#include "core/net_mem.h"
+
+#endif
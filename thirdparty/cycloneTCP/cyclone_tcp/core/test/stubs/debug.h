@@ -0,0 +1,10 @@
+#ifndef _DEBUG_H
+#define _DEBUG_H
+
+#define TRACE_LEVEL_DEBUG 4
+
+#define TRACE_DEBUG(...)
+#define TRACE_WARNING(...)
+#define TRACE_INFO(...)
+
+#endif
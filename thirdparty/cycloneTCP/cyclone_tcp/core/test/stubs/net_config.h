@@ -0,0 +1,26 @@
+#ifndef _NET_CONFIG_H
+#define _NET_CONFIG_H
+
+//Memory pool of the PLC applications (module_config/net_config.h)
+#define NET_MEM_POOL_SUPPORT ENABLED
+#define NET_MEM_POOL_BUFFER_SIZE 1536
+#define NET_MEM_POOL_SMALL_BUFFER_SIZE 256
+#define NET_MEM_POOL_MEDIUM_BUFFER_SIZE 512
+
+#ifndef CONF_NET_MEM_POOL_BUFFER_COUNT
+   #define CONF_NET_MEM_POOL_BUFFER_COUNT 4
+#endif
+
+#ifndef CONF_NET_MEM_POOL_SMALL_BUFFER_COUNT
+   #define CONF_NET_MEM_POOL_SMALL_BUFFER_COUNT 8
+#endif
+
+#ifndef CONF_NET_MEM_POOL_MEDIUM_BUFFER_COUNT
+   #define CONF_NET_MEM_POOL_MEDIUM_BUFFER_COUNT 4
+#endif
+
+#define NET_MEM_POOL_BUFFER_COUNT CONF_NET_MEM_POOL_BUFFER_COUNT
+#define NET_MEM_POOL_SMALL_BUFFER_COUNT CONF_NET_MEM_POOL_SMALL_BUFFER_COUNT
+#define NET_MEM_POOL_MEDIUM_BUFFER_COUNT CONF_NET_MEM_POOL_MEDIUM_BUFFER_COUNT
+
+#endif
@@ -0,0 +1,591 @@
+/**
+ * @file test_net_mem.c
+ * @brief Host test and DLMS polling stress of the NetBuffer memory pool
+ *
+ * Blocks are allocated, released and exhausted class by class to check the
+ * best fit, the fall back to larger classes and the per-class statistics.
+ * Buffers grown while the full-size class is exhausted are chained from
+ * smaller blocks, then written and read back. A run of random buffers checks
+ * that the pool never leaks blocks.
+ *
+ * The stress test replays the polling cycle of a data concentrator with 500
+ * meters. DLMS requests wait in the PLC transmit queue, responses of 40 to
+ * 1200 bytes wait for the DLMS client to read them over the serial line, and
+ * ICMPv6 traffic comes in between. A packet that cannot be allocated is
+ * dropped and its poll fails. The cycle is replayed with a single class of
+ * full-size buffers, with the same RAM split across the three classes, and
+ * with the configuration of the PLC applications.
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../net_mem.c"
+
+//Meters polled in a cycle
+#define METER_COUNT 500
+//Polling cycles
+#define CYCLE_COUNT 20
+//Meters polled at once by the DLMS client
+#define POLL_BATCH 8
+//ICMPv6 packets held at once, at most
+#define MAX_ICMPV6_HELD 16
+//Largest packet
+#define MAX_PACKET_SIZE 3000
+
+//Size class of full-size buffers
+#define LARGE_CLASS (NET_MEM_POOL_CLASS_COUNT - 1)
+
+static int failures;
+
+#define CHECK(cond) do { \
+      if(!(cond)) { \
+         printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+         failures++; \
+      } \
+   } while(0)
+
+systime_t simTime;
+
+static uint8_t packet[MAX_PACKET_SIZE];
+static uint8_t readBack[MAX_PACKET_SIZE];
+
+//Packet held by the stack
+typedef struct
+{
+   NetBuffer *buffer;
+   uint32_t id;
+   size_t length;
+   systime_t time;
+} HeldPacket;
+
+//State of a DLMS poll
+typedef enum
+{
+   POLL_REQUEST,
+   POLL_WAITING,
+   POLL_RESPONSE,
+   POLL_DONE
+} PollState;
+
+typedef struct
+{
+   PollState state;
+   HeldPacket packet;
+} Poll;
+
+//Outcome of a polling run
+typedef struct
+{
+   long polls;
+   long failedPolls;
+   long packets;
+   long dropped;
+   long corrupted;
+   MemPoolClassStats classStats[NET_MEM_POOL_CLASS_COUNT];
+} PollingStats;
+
+static void fillPacket(uint32_t id, size_t length)
+{
+   size_t i;
+
+   for(i = 0; i < length; i++)
+      packet[i] = (uint8_t) (id * 31 + i * 7 + (i >> 8));
+}
+
+static NetBuffer *allocPacket(uint32_t id, size_t length)
+{
+   NetBuffer *buffer;
+
+   buffer = netBufferAlloc(length);
+
+   if(buffer != NULL)
+   {
+      fillPacket(id, length);
+      netBufferWrite(buffer, 0, packet, length);
+   }
+
+   return buffer;
+}
+
+static bool_t checkPacket(const NetBuffer *buffer, uint32_t id, size_t length)
+{
+   fillPacket(id, length);
+
+   if(netBufferGetLength(buffer) != length)
+      return FALSE;
+
+   if(netBufferRead(readBack, buffer, 0, length) != length)
+      return FALSE;
+
+   return !memcmp(readBack, packet, length);
+}
+
+static uint_t poolBuffersInUse(void)
+{
+   uint_t currentUsage;
+
+   memPoolGetStats(&currentUsage, NULL, NULL);
+   return currentUsage;
+}
+
+//Limit the blocks of each class used, at most the configured counts
+static void setClassCounts(uint_t small, uint_t medium, uint_t large)
+{
+#if (NET_MEM_POOL_CLASS_COUNT == 3)
+   memPoolClass[0].blockCount = small;
+   memPoolClass[1].blockCount = medium;
+#endif
+   memPoolClass[LARGE_CLASS].blockCount = large;
+   memPoolInit();
+}
+
+#if (NET_MEM_POOL_CLASS_COUNT == 3)
+
+static uint_t classUsage(uint_t index)
+{
+   MemPoolClassStats stats;
+
+   memPoolGetClassStats(index, &stats);
+   return stats.currentUsage;
+}
+
+//Smallest class that fits, larger classes once it is exhausted
+static void testSizeClasses(void)
+{
+   static void *small[NET_MEM_POOL_SMALL_BUFFER_COUNT];
+   MemPoolClassStats stats;
+   uint_t currentUsage;
+   uint_t maxUsage;
+   uint_t size;
+   NetBuffer *buffer;
+   void *p;
+   void *q;
+   void *r;
+   uint_t i;
+
+   memPoolInit();
+
+   p = memPoolAlloc(60);
+   q = memPoolAlloc(400);
+   r = memPoolAlloc(1000);
+   CHECK(p != NULL && q != NULL && r != NULL);
+   CHECK(classUsage(0) == 1);
+   CHECK(classUsage(1) == 1);
+   CHECK(classUsage(2) == 1);
+   CHECK(memPoolAlloc(NET_MEM_POOL_BUFFER_SIZE + 1) == NULL);
+
+   //Blocks go back to their own class
+   memPoolFree(q);
+   CHECK(classUsage(1) == 0);
+   CHECK(classUsage(0) == 1);
+   memPoolFree(r);
+   memPoolFree(p);
+   CHECK(poolBuffersInUse() == 0);
+
+   //A short packet takes a small block, header included
+   buffer = netBufferAlloc(NET_MEM_POOL_SMALL_BUFFER_SIZE - CHUNKED_BUFFER_HEADER_SIZE);
+   CHECK(buffer != NULL && buffer->chunkCount == 1);
+   CHECK(classUsage(0) == 1);
+
+   if(buffer != NULL)
+      netBufferFree(buffer);
+
+   for(i = 0; i < NET_MEM_POOL_SMALL_BUFFER_COUNT; i++)
+      small[i] = memPoolAlloc(60);
+
+   CHECK(classUsage(0) == NET_MEM_POOL_SMALL_BUFFER_COUNT);
+
+   //Small class exhausted: a medium block is used
+   p = memPoolAlloc(60);
+   CHECK(p != NULL);
+   CHECK(classUsage(1) == 1);
+   memPoolFree(p);
+
+   for(i = 0; i < NET_MEM_POOL_SMALL_BUFFER_COUNT; i++)
+      memPoolFree(small[i]);
+
+   //High-water marks and exhaustion counts outlive the blocks
+   memPoolGetClassStats(0, &stats);
+   CHECK(stats.blockSize == NET_MEM_POOL_SMALL_BUFFER_SIZE);
+   CHECK(stats.blockCount == NET_MEM_POOL_SMALL_BUFFER_COUNT);
+   CHECK(stats.currentUsage == 0);
+   CHECK(stats.maxUsage == NET_MEM_POOL_SMALL_BUFFER_COUNT);
+   CHECK(stats.failures == 1);
+
+   memPoolGetStats(&currentUsage, &maxUsage, &size);
+   CHECK(currentUsage == 0);
+   CHECK(maxUsage == NET_MEM_POOL_SMALL_BUFFER_COUNT + 1);
+   CHECK(size == NET_MEM_POOL_BUFFER_COUNT + NET_MEM_POOL_SMALL_BUFFER_COUNT +
+      NET_MEM_POOL_MEDIUM_BUFFER_COUNT);
+
+   CHECK(memPoolGetClassStats(NET_MEM_POOL_CLASS_COUNT, &stats) == ERROR_INVALID_PARAMETER);
+}
+
+//Full-size class exhausted: a growing buffer is chained from smaller blocks
+static void testChaining(void)
+{
+   static void *large[NET_MEM_POOL_BUFFER_COUNT];
+   NetBuffer *buffer;
+   uint_t i;
+
+   memPoolInit();
+
+   for(i = 0; i < NET_MEM_POOL_BUFFER_COUNT; i++)
+      large[i] = memPoolAlloc(NET_MEM_POOL_BUFFER_SIZE);
+
+   buffer = allocPacket(1, 100);
+   CHECK(buffer != NULL);
+
+   if(buffer == NULL)
+      return;
+
+   CHECK(netBufferSetLength(buffer, 1200) == NO_ERROR);
+   CHECK(buffer->chunkCount > 2);
+   CHECK(classUsage(1) > 0);
+
+   fillPacket(2, 1200);
+   CHECK(netBufferWrite(buffer, 0, packet, 1200) == 1200);
+   CHECK(checkPacket(buffer, 2, 1200));
+
+   //Shrinking gives the chained blocks back
+   CHECK(netBufferSetLength(buffer, 50) == NO_ERROR);
+   CHECK(buffer->chunkCount == 1);
+   CHECK(classUsage(1) == 0);
+   CHECK(poolBuffersInUse() == NET_MEM_POOL_BUFFER_COUNT + 1);
+
+   //Out of blocks or chunk descriptors: the buffer is still released whole
+   CHECK(netBufferSetLength(buffer, IPV6_MAX_FRAG_DATAGRAM_SIZE) != NO_ERROR);
+   CHECK(classUsage(1) == NET_MEM_POOL_MEDIUM_BUFFER_COUNT);
+   netBufferFree(buffer);
+
+   for(i = 0; i < NET_MEM_POOL_BUFFER_COUNT; i++)
+      memPoolFree(large[i]);
+
+   CHECK(poolBuffersInUse() == 0);
+}
+
+#endif
+
+//Random buffers allocated, resized and released: contents kept, nothing leaks
+static void testRandomBuffers(void)
+{
+   static HeldPacket held[12];
+   MemPoolClassStats stats;
+   size_t length;
+   uint32_t id = 0;
+   uint_t n;
+   uint_t i;
+   long k;
+
+   memPoolInit();
+   memset(held, 0, sizeof(held));
+   srand(1);
+
+   for(k = 0; k < 300000; k++)
+   {
+      n = rand() % arraysize(held);
+      length = 1 + rand() % MAX_PACKET_SIZE;
+
+      if(held[n].buffer == NULL)
+      {
+         held[n].id = id++;
+         held[n].length = length;
+         held[n].buffer = allocPacket(held[n].id, length);
+      }
+      else if(rand() % 2)
+      {
+         CHECK(checkPacket(held[n].buffer, held[n].id, held[n].length));
+         netBufferFree(held[n].buffer);
+         held[n].buffer = NULL;
+      }
+      else if(netBufferSetLength(held[n].buffer, length) == NO_ERROR)
+      {
+         //New data is written, what was kept is checked again
+         if(length > held[n].length)
+         {
+            held[n].id = id++;
+            fillPacket(held[n].id, length);
+            netBufferWrite(held[n].buffer, 0, packet, length);
+         }
+         else
+         {
+            CHECK(checkPacket(held[n].buffer, held[n].id, length));
+         }
+
+         held[n].length = length;
+      }
+      else
+      {
+         //Failed growth: the buffer is shrunk back
+         CHECK(netBufferSetLength(held[n].buffer, held[n].length) == NO_ERROR);
+         CHECK(checkPacket(held[n].buffer, held[n].id, held[n].length));
+      }
+   }
+
+   for(n = 0; n < arraysize(held); n++)
+   {
+      if(held[n].buffer != NULL)
+      {
+         CHECK(checkPacket(held[n].buffer, held[n].id, held[n].length));
+         netBufferFree(held[n].buffer);
+      }
+   }
+
+   CHECK(poolBuffersInUse() == 0);
+
+   for(i = 0; i < NET_MEM_POOL_CLASS_COUNT; i++)
+   {
+      memPoolGetClassStats(i, &stats);
+      CHECK(stats.maxUsage == stats.blockCount);
+   }
+}
+
+//DLMS response: mostly register reads, some profile reads
+static size_t responseLength(void)
+{
+   uint_t n = rand() % 100;
+
+   if(n < 60)
+      return 40 + rand() % 160;
+   else if(n < 85)
+      return 200 + rand() % 300;
+   else
+      return 500 + rand() % 701;
+}
+
+static void releasePacket(HeldPacket *p, PollingStats *stats)
+{
+   if(!checkPacket(p->buffer, p->id, p->length))
+      stats->corrupted++;
+
+   netBufferFree(p->buffer);
+   p->buffer = NULL;
+}
+
+static bool_t holdPacket(HeldPacket *p, uint32_t id, size_t length, PollingStats *stats)
+{
+   p->id = id;
+   p->length = length;
+   p->buffer = allocPacket(id, length);
+
+   stats->packets++;
+   if(p->buffer == NULL)
+      stats->dropped++;
+
+   return p->buffer != NULL;
+}
+
+/**
+ * @brief Replays the polling cycles, 1 ms per step
+ *
+ * The PLC transmit queue and the serial line to the DLMS client each handle
+ * one packet at a time: a packet is held until the ones queued before it
+ * have gone.
+ **/
+
+static void runPolling(PollingStats *stats)
+{
+   static Poll polls[POLL_BATCH];
+   static HeldPacket icmpv6[MAX_ICMPV6_HELD];
+   systime_t txFree = 0;
+   systime_t serialFree = 0;
+   uint32_t id = 0;
+   uint_t cycle;
+   uint_t meter;
+   uint_t batch;
+   uint_t pending;
+   uint_t i;
+   Poll *poll;
+
+   memset(stats, 0, sizeof(PollingStats));
+   memset(icmpv6, 0, sizeof(icmpv6));
+   simTime = 0;
+   srand(1);
+
+   for(cycle = 0; cycle < CYCLE_COUNT; cycle++)
+   {
+      for(meter = 0; meter < METER_COUNT; meter += batch)
+      {
+         batch = MIN(POLL_BATCH, METER_COUNT - meter);
+
+         //The DLMS client polls a batch of meters at once
+         for(i = 0; i < batch; i++)
+         {
+            poll = &polls[i];
+            stats->polls++;
+
+            if(holdPacket(&poll->packet, id++, 70 + rand() % 30, stats))
+            {
+               //About 0.3 ms per byte on the PLC line, plus channel access
+               txFree = MAX(txFree, simTime) + 20 + poll->packet.length * 3 / 10;
+               poll->packet.time = txFree;
+               poll->state = POLL_REQUEST;
+            }
+            else
+            {
+               stats->failedPolls++;
+               poll->state = POLL_DONE;
+            }
+         }
+
+         do
+         {
+            simTime++;
+            pending = 0;
+
+            for(i = 0; i < batch; i++)
+            {
+               poll = &polls[i];
+
+               if(poll->state == POLL_REQUEST && timeCompare(simTime, poll->packet.time) >= 0)
+               {
+                  //Request sent, the meter answers across the mesh
+                  releasePacket(&poll->packet, stats);
+                  poll->packet.time = simTime + 100 + rand() % 700;
+                  poll->state = POLL_WAITING;
+               }
+               else if(poll->state == POLL_WAITING && timeCompare(simTime, poll->packet.time) >= 0)
+               {
+                  if(holdPacket(&poll->packet, id++, responseLength(), stats))
+                  {
+                     //Forwarded to the DLMS client at 115200 bit/s
+                     serialFree = MAX(serialFree, simTime) + 2 + poll->packet.length / 11;
+                     poll->packet.time = serialFree;
+                     poll->state = POLL_RESPONSE;
+                  }
+                  else
+                  {
+                     stats->failedPolls++;
+                     poll->state = POLL_DONE;
+                  }
+               }
+               else if(poll->state == POLL_RESPONSE && timeCompare(simTime, poll->packet.time) >= 0)
+               {
+                  releasePacket(&poll->packet, stats);
+                  poll->state = POLL_DONE;
+               }
+
+               if(poll->state != POLL_DONE)
+                  pending++;
+            }
+
+            //ICMPv6 answered by the stack, replies go through the PLC transmit queue
+            for(i = 0; i < MAX_ICMPV6_HELD; i++)
+            {
+               if(icmpv6[i].buffer != NULL && timeCompare(simTime, icmpv6[i].time) >= 0)
+                  releasePacket(&icmpv6[i], stats);
+            }
+
+            if((rand() % 200) == 0)
+            {
+               for(i = 0; i < MAX_ICMPV6_HELD && icmpv6[i].buffer != NULL; i++);
+
+               if(i < MAX_ICMPV6_HELD && holdPacket(&icmpv6[i], id++, 72 + rand() % 33, stats))
+               {
+                  if(rand() % 2)
+                  {
+                     txFree = MAX(txFree, simTime) + 20 + icmpv6[i].length * 3 / 10;
+                     icmpv6[i].time = txFree;
+                  }
+                  else
+                  {
+                     icmpv6[i].time = simTime + 2;
+                  }
+               }
+            }
+         } while(pending > 0);
+      }
+   }
+
+   for(i = 0; i < MAX_ICMPV6_HELD; i++)
+   {
+      if(icmpv6[i].buffer != NULL)
+         releasePacket(&icmpv6[i], stats);
+   }
+
+   for(i = 0; i < NET_MEM_POOL_CLASS_COUNT; i++)
+      memPoolGetClassStats(i, &stats->classStats[i]);
+}
+
+static void printPolling(const char *name, const PollingStats *stats)
+{
+   uint_t i;
+
+   printf("  %-26s %5.1f%% of %ld packets dropped, %ld/%ld polls failed, high-water",
+      name, stats->dropped * 100.0 / stats->packets, stats->packets,
+      stats->failedPolls, stats->polls);
+
+   for(i = 0; i < NET_MEM_POOL_CLASS_COUNT; i++)
+   {
+      if(stats->classStats[i].blockCount > 0)
+      {
+         printf(" %u/%u x %" PRIuSIZE, stats->classStats[i].maxUsage,
+            stats->classStats[i].blockCount, stats->classStats[i].blockSize);
+      }
+   }
+
+   printf("\n");
+}
+
+//500 meters polled 20 times: no packet is corrupted or leaked
+static void testDlmsPolling(void)
+{
+   PollingStats single;
+#if (NET_MEM_POOL_CLASS_COUNT == 3)
+   PollingStats sameRam;
+   PollingStats classes;
+#endif
+
+   printf("DLMS polling of %u meters, %u cycles, %u meters at once:\n",
+      METER_COUNT, CYCLE_COUNT, POLL_BATCH);
+
+   //Full-size buffers only
+   setClassCounts(0, 0, NET_MEM_POOL_BUFFER_COUNT);
+   runPolling(&single);
+   CHECK(single.corrupted == 0);
+   CHECK(single.polls == METER_COUNT * CYCLE_COUNT);
+   CHECK(poolBuffersInUse() == 0);
+   printPolling("full-size buffers only", &single);
+
+#if (NET_MEM_POOL_CLASS_COUNT == 3)
+   //The RAM of the full-size buffers split across the three classes
+   setClassCounts(8, 2, NET_MEM_POOL_BUFFER_COUNT - 2);
+   runPolling(&sameRam);
+   CHECK(sameRam.corrupted == 0);
+   CHECK(poolBuffersInUse() == 0);
+   printPolling("same RAM in three classes", &sameRam);
+
+   setClassCounts(NET_MEM_POOL_SMALL_BUFFER_COUNT, NET_MEM_POOL_MEDIUM_BUFFER_COUNT,
+      NET_MEM_POOL_BUFFER_COUNT);
+   runPolling(&classes);
+   CHECK(classes.corrupted == 0);
+   CHECK(poolBuffersInUse() == 0);
+   printPolling("PLC configuration", &classes);
+
+   CHECK(sameRam.dropped < single.dropped);
+   CHECK(classes.dropped < sameRam.dropped);
+#endif
+
+   setClassCounts(NET_MEM_POOL_SMALL_BUFFER_COUNT, NET_MEM_POOL_MEDIUM_BUFFER_COUNT,
+      NET_MEM_POOL_BUFFER_COUNT);
+}
+
+int main(void)
+{
+#if (NET_MEM_POOL_CLASS_COUNT == 3)
+   testSizeClasses();
+   testChaining();
+#endif
+   testRandomBuffers();
+   testDlmsPolling();
+
+   if(failures)
+   {
+      printf("%d failure(s)\n", failures);
+      return 1;
+   }
+
+   printf("OK\n");
+   return 0;
+}
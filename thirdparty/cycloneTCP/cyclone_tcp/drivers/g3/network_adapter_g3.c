@@ -45,6 +45,7 @@
 #include "net_config.h"
 #define TRACE_LEVEL PPP_TRACE_LEVEL
 
+#include <string.h>
 #include <hal/hal.h>
 #include "debug.h"
 #include "Logger.h"
@@ -58,15 +59,66 @@
 
 #ifdef __G3_GATEWAY__
 extern bool bs_get_short_addr_by_ext (uint8_t *puc_extended_address, uint16_t *pus_short_address);
+extern uint32_t bs_lbp_get_lbds_generation (void);
+
+/* IID to short address cache (direct mapped), size must be a power of 2 */
+#ifndef G3_ADAPTER_ADDR_CACHE_SIZE
+#define G3_ADAPTER_ADDR_CACHE_SIZE 32
+#endif
+
+typedef struct {
+	uint8_t puc_iid[8];
+	uint16_t us_short_addr;
+	bool b_valid;
+} g3_addr_cache_entry_t;
+
+static g3_addr_cache_entry_t sx_addr_cache[G3_ADAPTER_ADDR_CACHE_SIZE];
+/* Bootstrap LBDs list generation the cache was filled with */
+static uint32_t sul_addr_cache_generation;
+
+/* ULA destination short address currently set in ADP IB */
+static uint16_t sus_ula_dest_short_addr;
+static bool sb_ula_dest_valid = false;
 #endif
 
 
 #define G3_ADP_MAX_DATA_LENGTH 1280
 
+/* Define if the ADP copies the NSDU inside AdpDataRequest(). Contiguous
+ * NetBuffers are then passed without copy and no SDU is held until confirm */
+/* #define G3_ADP_NSDU_COPIED */
+
+/* Number of SDU buffers that can be in flight towards ADP */
+#ifndef G3_ADP_SDU_POOL_SIZE
+#define G3_ADP_SDU_POOL_SIZE 4
+#endif
+
+/* SDU buffers not confirmed after this time (ms) are reclaimed */
+#ifndef G3_ADP_SDU_TIMEOUT
+#define G3_ADP_SDU_TIMEOUT 60000
+#endif
+
 /* Global variables */
 const NetBuffer*  mp_buffer = NULL;
 size_t                mp_offset = 0;
+#ifdef G3_ADP_NSDU_COPIED
 uint8_t adp_sdu[G3_ADP_MAX_DATA_LENGTH];
+#else
+/* SDU buffer held from AdpDataRequest() until its AdpDataConfirm */
+typedef struct {
+	uint8_t puc_data[G3_ADP_MAX_DATA_LENGTH];
+	systime_t x_time;
+	uint8_t uc_nsdu_handle;
+	bool b_used;
+} g3_adp_sdu_t;
+
+/* Allocated from the TX path, released from AdpDataConfirm (G3 stack task):
+ * b_used is the only shared state, each side only writes one value */
+static g3_adp_sdu_t sx_adp_sdu_pool[G3_ADP_SDU_POOL_SIZE];
+#endif
+
+/* G3 interface, signaled when an SDU buffer is released */
+static NetInterface *sp_g3_interface = NULL;
 
 /* Structure to define the G3 network adapter */
 NicDriver g3_adapter = { NIC_TYPE_6LOWPAN,
@@ -86,9 +138,146 @@ NicDriver g3_adapter = { NIC_TYPE_6LOWPAN,
 						 TRUE,
 						 TRUE };
 
+#ifdef __G3_GATEWAY__
+/* Flush the IID to short address cache and the ULA destination set in ADP.
+ * Must be called after AdpInitialize() and on AdpResetConfirm, as the ADP IB
+ * goes back to defaults. */
+void g3_adapter_flush_addr_cache (void)
+{
+	memset(sx_addr_cache, 0, sizeof(sx_addr_cache));
+	sul_addr_cache_generation = bs_lbp_get_lbds_generation();
+	sb_ula_dest_valid = false;
+}
+
+static uint8_t _addr_cache_index (const uint8_t *puc_iid)
+{
+	uint32_t ul_hash = 0;
+	uint8_t uc_i;
+
+	for (uc_i = 0; uc_i < 8; uc_i++) {
+		ul_hash = (ul_hash * 31U) + puc_iid[uc_i];
+	}
+
+	return (uint8_t)(ul_hash & (G3_ADAPTER_ADDR_CACHE_SIZE - 1));
+}
+
+/* Get short address of a joined device from its IID, through the cache.
+ * The cache is flushed when a device leaves the network (LBDs generation) */
+static bool _get_short_addr_by_iid (const uint8_t *puc_iid, uint16_t *pus_short_addr)
+{
+	g3_addr_cache_entry_t *px_entry;
+
+	if (bs_lbp_get_lbds_generation() != sul_addr_cache_generation) {
+		memset(sx_addr_cache, 0, sizeof(sx_addr_cache));
+		sul_addr_cache_generation = bs_lbp_get_lbds_generation();
+	}
+
+	px_entry = &sx_addr_cache[_addr_cache_index(puc_iid)];
+	if (px_entry->b_valid && (memcmp(px_entry->puc_iid, puc_iid, 8) == 0)) {
+		*pus_short_addr = px_entry->us_short_addr;
+		return true;
+	}
+
+	if (!bs_get_short_addr_by_ext((uint8_t *)puc_iid, pus_short_addr)) {
+		return false;
+	}
+
+	memcpy(px_entry->puc_iid, puc_iid, 8);
+	px_entry->us_short_addr = *pus_short_addr;
+	px_entry->b_valid = true;
+
+	return true;
+}
+
+/* ADP data request to a ULA destination short address. The ADP IB holding
+ * the destination is only set when it differs from the last one set */
+static void _adp_data_request_to (uint16_t us_short_addr, uint16_t us_data_length, const uint8_t *puc_sdu, uint8_t uc_nsdu_handle)
+{
+	struct TAdpSetConfirm x_set_confirm;
+
+	if (!sb_ula_dest_valid || (sus_ula_dest_short_addr != us_short_addr)) {
+		AdpSetRequestSync(ADP_IB_MANUF_IPV6_ULA_DEST_SHORT_ADDRESS, 0, sizeof(us_short_addr), (uint8_t *)&us_short_addr, &x_set_confirm);
+		sb_ula_dest_valid = (x_set_confirm.m_u8Status == G3_SUCCESS);
+		sus_ula_dest_short_addr = us_short_addr;
+	}
+
+	AdpDataRequest(us_data_length, puc_sdu, uc_nsdu_handle, true, 0x00);
+}
+#endif
+
+#ifdef G3_ADP_NSDU_COPIED
+/* Get a contiguous view of the packet if it is held in a single chunk */
+static const uint8_t *_net_buffer_contiguous (const NetBuffer *buffer, size_t offset, size_t length)
+{
+	uint_t i;
+
+	for (i = 0; i < buffer->chunkCount; i++) {
+		if (offset < buffer->chunk[i].length) {
+			if ((buffer->chunk[i].length - offset) >= length) {
+				return (const uint8_t *)buffer->chunk[i].address + offset;
+			}
+
+			return NULL;
+		}
+
+		offset -= buffer->chunk[i].length;
+	}
+
+	return NULL;
+}
+#else
+static g3_adp_sdu_t *_adp_sdu_alloc (uint8_t uc_nsdu_handle)
+{
+	uint8_t uc_i;
+
+	for (uc_i = 0; uc_i < G3_ADP_SDU_POOL_SIZE; uc_i++) {
+		if (!sx_adp_sdu_pool[uc_i].b_used) {
+			sx_adp_sdu_pool[uc_i].b_used = true;
+			sx_adp_sdu_pool[uc_i].uc_nsdu_handle = uc_nsdu_handle;
+			sx_adp_sdu_pool[uc_i].x_time = osGetSystemTime();
+			return &sx_adp_sdu_pool[uc_i];
+		}
+	}
+
+	return NULL;
+}
+
+static bool _adp_sdu_available (void)
+{
+	uint8_t uc_i;
+
+	for (uc_i = 0; uc_i < G3_ADP_SDU_POOL_SIZE; uc_i++) {
+		if (!sx_adp_sdu_pool[uc_i].b_used) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static void _adp_sdu_release (g3_adp_sdu_t *px_sdu)
+{
+	px_sdu->b_used = false;
+
+	/* The transmitter can accept a new packet */
+	if (sp_g3_interface != NULL) {
+		osSetEvent(&sp_g3_interface->nicTxEvent);
+	}
+}
+#endif
+
 /* G3 driver initialization */
 error_t Init (NetInterface* interface)
 {
+	sp_g3_interface = interface;
+#ifndef G3_ADP_NSDU_COPIED
+	memset(sx_adp_sdu_pool, 0, sizeof(sx_adp_sdu_pool));
+#endif
+
+#ifdef __G3_GATEWAY__
+	g3_adapter_flush_addr_cache();
+#endif
+
 	if (interface != NULL)
 	{
 		/* Force the TCP/IP stack to check the link state */
@@ -128,19 +317,39 @@ error_t ipv6_send_packet (NetInterface*        interface,
 	static uint8_t uc_nsdu_handle = 0;
 	error_t  sendPacketError;
 	uint16_t us_data_length = netBufferGetLength(buffer) - offset;
+	const uint8_t *adp_nsdu;
+#ifndef G3_ADP_NSDU_COPIED
+	g3_adp_sdu_t *px_sdu = NULL;
+#endif
 
-	if(us_data_length <= G3_ADP_MAX_DATA_LENGTH) {
-		(void)netBufferRead((uint8_t *)adp_sdu, buffer, offset, us_data_length);
+	if(us_data_length > G3_ADP_MAX_DATA_LENGTH) {
+		sendPacketError = ERROR_WRONG_LENGTH;
+	} else {
+#ifdef G3_ADP_NSDU_COPIED
+		/* Zero copy if the packet is contiguous, ADP takes its own copy */
+		adp_nsdu = _net_buffer_contiguous(buffer, offset, us_data_length);
+		if (adp_nsdu == NULL) {
+			(void)netBufferRead((uint8_t *)adp_sdu, buffer, offset, us_data_length);
+			adp_nsdu = adp_sdu;
+		}
+#else
+		/* SDU is held until AdpDataConfirm; nicTxEvent is only set while one is free */
+		px_sdu = _adp_sdu_alloc(uc_nsdu_handle);
+		if (px_sdu == NULL) {
+			return ERROR_TRANSMITTER_BUSY;
+		}
+
+		(void)netBufferRead(px_sdu->puc_data, buffer, offset, us_data_length);
+		adp_nsdu = px_sdu->puc_data;
+#endif
 #ifdef __G3_GATEWAY__
                 /* Check if IPv6 Dest is ULA*/
                 Ipv6Header *ipHeader;
                 uint16_t us_short_addr;
-                struct TAdpSetConfirm pSetConfirm;
                 //Retrieve the length of the IPv6 packet
                 ipHeader = netBufferAt(buffer, offset);
-                if (bs_get_short_addr_by_ext(ipHeader->destAddr.b+8, &us_short_addr) == true) {
-                  AdpSetRequestSync(ADP_IB_MANUF_IPV6_ULA_DEST_SHORT_ADDRESS, 0, sizeof(us_short_addr),(uint8_t*)&us_short_addr, &pSetConfirm);
-                  AdpDataRequest(us_data_length, adp_sdu, uc_nsdu_handle++, true, 0x00);
+                if (_get_short_addr_by_iid(ipHeader->destAddr.b+8, &us_short_addr) == true) {
+                  _adp_data_request_to(us_short_addr, us_data_length, adp_nsdu, uc_nsdu_handle++);
 		  sendPacketError = NO_ERROR;
                 } else {
                   if ((ipHeader->destAddr.b[8] == ((uint8_t) (G3_COORDINATOR_PAN_ID >> 8))) 
@@ -148,35 +357,72 @@ error_t ipv6_send_packet (NetInterface*        interface,
                     //ULA 2nd address
                     us_short_addr = ipHeader->destAddr.b[14] << 8;    
                     us_short_addr += ipHeader->destAddr.b[15];    
-                    AdpSetRequestSync(ADP_IB_MANUF_IPV6_ULA_DEST_SHORT_ADDRESS, 0, sizeof(us_short_addr),(uint8_t*)&us_short_addr, &pSetConfirm);
-                    AdpDataRequest(us_data_length, adp_sdu, uc_nsdu_handle++, true, 0x00);
+                    _adp_data_request_to(us_short_addr, us_data_length, adp_nsdu, uc_nsdu_handle++);
                     sendPacketError = NO_ERROR;
                   } else {
                     TRACE_ERROR("DEST IP ADDRESS not in BS database!\r\n");
                     sendPacketError = ERROR_ADDRESS_NOT_FOUND;
+#ifndef G3_ADP_NSDU_COPIED
+                    px_sdu->b_used = false;
+#endif
                   }
                 }
 #else
 #ifdef DUMP_CONSOLE
-                LogDump(adp_sdu, us_data_length);
+                LogDump(adp_nsdu, us_data_length);
 #endif /* DUMP_CONSOLE */                   
-                AdpDataRequest(us_data_length, adp_sdu, uc_nsdu_handle++, true, 0x00);               
+                AdpDataRequest(us_data_length, adp_nsdu, uc_nsdu_handle++, true, 0x00);               
 		sendPacketError = NO_ERROR;
 #endif  		
-	} else {
-		sendPacketError = ERROR_WRONG_LENGTH;
 	}
 
+#ifndef G3_ADP_NSDU_COPIED
+	if (!_adp_sdu_available()) {
+		/* Wait for an AdpDataConfirm to release an SDU */
+		return sendPacketError;
+	}
+#endif
+
 	osSetEvent(&interface->nicTxEvent);
 	return sendPacketError;
 }
 
-/* Empty callbacks (functionality not needed within G3 network adapter) */
+/* TX confirm routine, to be called from the AdpDataConfirm handler */
+void ipv6_send_confirm (struct TAdpDataConfirm *pDataConfirm)
+{
+#ifdef G3_ADP_NSDU_COPIED
+	(void)pDataConfirm;
+#else
+	uint8_t uc_i;
+
+	for (uc_i = 0; uc_i < G3_ADP_SDU_POOL_SIZE; uc_i++) {
+		if (sx_adp_sdu_pool[uc_i].b_used && (sx_adp_sdu_pool[uc_i].uc_nsdu_handle == pDataConfirm->m_u8NsduHandle)) {
+			_adp_sdu_release(&sx_adp_sdu_pool[uc_i]);
+			break;
+		}
+	}
+#endif
+}
+
+/* Periodic tick: reclaim SDUs whose AdpDataConfirm never arrived */
 void Tick (NetInterface* interface)
 {
+#ifndef G3_ADP_NSDU_COPIED
+	uint8_t uc_i;
+
+	for (uc_i = 0; uc_i < G3_ADP_SDU_POOL_SIZE; uc_i++) {
+		if (sx_adp_sdu_pool[uc_i].b_used &&
+				(timeCompare(osGetSystemTime(), sx_adp_sdu_pool[uc_i].x_time + G3_ADP_SDU_TIMEOUT) >= 0)) {
+			TRACE_ERROR("ADP SDU not confirmed, released\r\n");
+			_adp_sdu_release(&sx_adp_sdu_pool[uc_i]);
+		}
+	}
+#endif
 	(void)interface;
 }
 
+/* Empty callbacks (functionality not needed within G3 network adapter) */
+
 void RxEventHandler (NetInterface* interface)
 {
 	(void)interface;
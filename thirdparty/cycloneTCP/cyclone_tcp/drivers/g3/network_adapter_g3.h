@@ -53,7 +53,11 @@ extern NicDriver g3_adapter;
 
 void ipv6_receive_packet (struct TAdpDataIndication *pDataIndication);
 error_t ipv6_send_packet (NetInterface* interface, const NetBuffer* buffer, size_t offset);
+void ipv6_send_confirm (struct TAdpDataConfirm *pDataConfirm);
 error_t Init (NetInterface* interface);
+#ifdef __G3_GATEWAY__
+void g3_adapter_flush_addr_cache (void);
+#endif
 
 void 		Tick (NetInterface* interface);
 void        RxEventHandler (NetInterface* interface);
@@ -0,0 +1,9 @@
+/* Host stub of the G3 logger */
+#ifndef LOGGER_STUB_H
+#define LOGGER_STUB_H
+
+#include <stdint.h>
+
+void LogDump(const uint8_t *pu8Data, uint16_t u16Length);
+
+#endif /* LOGGER_STUB_H */
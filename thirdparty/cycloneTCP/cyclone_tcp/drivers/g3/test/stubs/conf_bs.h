@@ -0,0 +1,7 @@
+#ifndef CONF_BS_H_INCLUDE
+#define CONF_BS_H_INCLUDE
+
+/* PAN ID */
+#define G3_COORDINATOR_PAN_ID                   0x781D
+
+#endif  /* CONF_BS_H_INCLUDE */
@@ -0,0 +1,87 @@
+#ifndef _NET_H
+#define _NET_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+typedef unsigned int uint_t;
+typedef int bool_t;
+typedef char char_t;
+
+#define TRUE 1
+#define FALSE 0
+#define ENABLED 1
+#define DISABLED 0
+
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+#define arraysize(a) (sizeof(a) / sizeof(a[0]))
+#define PRIuSIZE "zu"
+
+#define __start_packed
+#define __end_packed __attribute__((packed))
+
+#define IPV4_SUPPORT DISABLED
+#define IPV6_SUPPORT ENABLED
+#define IPV6_MAX_FRAG_DATAGRAM_SIZE 8192
+
+#include "os_port.h"
+#include "core/net_mem.h"
+
+typedef __start_packed union
+{
+   uint8_t b[16];
+   uint16_t w[8];
+   uint32_t dw[4];
+} __end_packed Ipv6Addr;
+
+typedef __start_packed struct
+{
+   uint8_t vtf[4];
+   uint16_t payloadLen;
+   uint8_t nextHeader;
+   uint8_t hopLimit;
+   Ipv6Addr srcAddr;
+   Ipv6Addr destAddr;
+   uint8_t payload[];
+} __end_packed Ipv6Header;
+
+typedef struct _NetInterface
+{
+   bool_t nicEvent;
+   OsEvent nicTxEvent;
+} NetInterface;
+
+typedef enum
+{
+   NIC_TYPE_6LOWPAN = 3
+} NicType;
+
+typedef struct
+{
+   NicType type;
+   size_t mtu;
+   error_t (*init)(NetInterface *interface);
+   void (*tick)(NetInterface *interface);
+   void (*enableIrq)(NetInterface *interface);
+   void (*disableIrq)(NetInterface *interface);
+   void (*eventHandler)(NetInterface *interface);
+   error_t (*sendPacket)(NetInterface *interface, const NetBuffer *buffer, size_t offset);
+   error_t (*updateMacAddrFilter)(NetInterface *interface);
+   error_t (*updateMacConfig)(NetInterface *interface);
+   void (*writePhyReg)(uint8_t opcode, uint8_t phyAddr, uint8_t regAddr, uint16_t data);
+   uint16_t (*readPhyReg)(uint8_t opcode, uint8_t phyAddr, uint8_t regAddr);
+   bool_t autoPadding;
+   bool_t autoCrcCalc;
+   bool_t autoCrcVerif;
+   bool_t autoCrcStrip;
+} NicDriver;
+
+extern OsEvent netEvent;
+extern NetInterface netInterface[];
+
+void nicProcessPacket(NetInterface *interface, uint8_t *packet, size_t length);
+
+#endif
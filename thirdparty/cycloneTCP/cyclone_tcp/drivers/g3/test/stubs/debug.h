@@ -0,0 +1,9 @@
+#ifndef _DEBUG_H
+#define _DEBUG_H
+
+#define TRACE_ERROR(...)
+#define TRACE_WARNING(...)
+#define TRACE_INFO(...)
+#define TRACE_DEBUG(...)
+
+#endif
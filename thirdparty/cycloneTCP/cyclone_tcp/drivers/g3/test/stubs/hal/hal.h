@@ -0,0 +1 @@
+/* Host stub: the network adapter uses no HAL function */
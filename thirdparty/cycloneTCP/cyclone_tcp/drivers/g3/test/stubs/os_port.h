@@ -0,0 +1,25 @@
+#ifndef _OS_PORT_H
+#define _OS_PORT_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+typedef int OsMutex;
+typedef uint32_t OsEvent;
+typedef uint32_t systime_t;
+
+//Simulated time, driven by the test
+extern systime_t simTime;
+
+#define osCreateMutex(mutex) (*(mutex) = 0, 1)
+#define osAcquireMutex(mutex)
+#define osReleaseMutex(mutex)
+#define osAllocMem malloc
+#define osFreeMem free
+#define osGetSystemTime() simTime
+#define timeCompare(t1, t2) ((int32_t) ((t1) - (t2)))
+
+//Events count how many times they were set
+#define osSetEvent(event) ((*(event))++)
+
+#endif
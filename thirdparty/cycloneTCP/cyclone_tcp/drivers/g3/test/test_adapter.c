@@ -0,0 +1,676 @@
+/**
+ * \file
+ *
+ * \brief Host test of the G3 network adapter TX path (gateway build).
+ *
+ * Random IPv6 packets to joined devices, to ULA addresses built from a short
+ * address and to unknown devices go through ipv6_send_packet() over a stub
+ * bootstrap and a stub ADP. Devices leave and join again with a new short
+ * address, the ADP is reset and IB sets fail at random. Every packet handed
+ * to AdpDataRequest() must carry the right payload with the right ULA
+ * destination set in the ADP IB. Then times the TX path against the former
+ * one, that looked the device up and set the IB on every packet.
+ *
+ * A second run holds the SDUs in the stub ADP until it confirms them, some
+ * confirms being lost. SDUs must not change before their confirm, the
+ * transmitter must only be signaled when a packet can be taken and Tick()
+ * must reclaim the SDUs never confirmed. Then measures the packets per
+ * second with the ADP holding up to 8 frames, against the former single SDU
+ * buffer. Built once with the SDU pool and once with G3_ADP_NSDU_COPIED.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../network_adapter_g3.c"
+#undef TRACE_LEVEL
+#include "../../../core/net_mem.c"
+
+/* Joined devices in the bootstrap stub */
+#define DEVICES           500
+#define RANDOM_OPS        200000
+#define PACKET_MAX_LEN    1280
+/* Destinations of the benchmark traffic */
+#define BENCH_DESTS       20
+#define BENCH_PACKETS     400000
+#define BENCH_LEN         100
+/* Frames held by the stub ADP before it must confirm the oldest */
+#define ADP_QUEUE_SIZE    8
+#define HOLD_PACKETS      100000
+#define PPS_PACKETS       2000000
+#define PPS_LEN           600
+/* Default value of the ULA destination in the ADP IB */
+#define ULA_DEST_DEFAULT  0x0000
+
+static int si_failures;
+
+#define CHECK(cond) do { \
+		if (!(cond)) { \
+			printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+			si_failures++; \
+		} \
+	} while (0)
+
+systime_t simTime;
+OsEvent netEvent;
+NetInterface netInterface[2];
+
+static uint32_t sul_rng = 0x12345678;
+
+/* Bootstrap stub: joined devices, looked up by a linear scan */
+static uint8_t sauc_iid[DEVICES][8];
+static uint16_t saus_short[DEVICES];
+static uint32_t sul_lbds_generation;
+static uint32_t sul_lookups;
+
+/* ADP stub */
+static uint16_t sus_ib_ula_dest = ULA_DEST_DEFAULT;
+static bool sb_ib_set_fail;
+static uint32_t sul_ib_sets;
+static uint32_t sul_data_requests;
+static uint16_t sus_sent_dest;
+static uint16_t sus_sent_len;
+static uint8_t suc_sent_handle;
+static uint8_t sauc_sent[PACKET_MAX_LEN];
+
+/* ADP stub frames held until confirmed, when sb_adp_hold is set */
+typedef struct {
+	/* NSDU as given by the adapter, NULL if the ADP took its own copy */
+	const uint8_t *puc_nsdu;
+	uint8_t auc_copy[PACKET_MAX_LEN];
+	uint16_t us_len;
+	uint8_t uc_handle;
+} adp_frame_t;
+
+static bool sb_adp_hold;
+static adp_frame_t sax_adp_queue[ADP_QUEUE_SIZE];
+static uint8_t suc_adp_head;
+static uint8_t suc_adp_count;
+/* SDUs that changed between AdpDataRequest() and AdpDataConfirm */
+static uint32_t sul_corrupted;
+
+static uint32_t _rand(void)
+{
+	sul_rng ^= sul_rng << 13;
+	sul_rng ^= sul_rng >> 17;
+	sul_rng ^= sul_rng << 5;
+	return sul_rng;
+}
+
+bool bs_get_short_addr_by_ext(uint8_t *puc_extended_address, uint16_t *pus_short_address)
+{
+	uint16_t us_i;
+
+	sul_lookups++;
+	for (us_i = 0; us_i < DEVICES; us_i++) {
+		if ((saus_short[us_i] != 0) && (memcmp(sauc_iid[us_i], puc_extended_address, 8) == 0)) {
+			*pus_short_address = saus_short[us_i];
+			return true;
+		}
+	}
+
+	return false;
+}
+
+uint32_t bs_lbp_get_lbds_generation(void)
+{
+	return sul_lbds_generation;
+}
+
+void AdpSetRequestSync(uint32_t u32AttributeId, uint16_t u16AttributeIndex, uint8_t u8AttributeLength,
+		const uint8_t *pu8AttributeValue, struct TAdpSetConfirm *pSetConfirm)
+{
+	sul_ib_sets++;
+	pSetConfirm->m_u32AttributeId = u32AttributeId;
+	pSetConfirm->m_u16AttributeIndex = u16AttributeIndex;
+	if (sb_ib_set_fail || (u32AttributeId != ADP_IB_MANUF_IPV6_ULA_DEST_SHORT_ADDRESS) || (u8AttributeLength != 2)) {
+		pSetConfirm->m_u8Status = G3_INVALID_PARAMETER;
+		return;
+	}
+
+	memcpy(&sus_ib_ula_dest, pu8AttributeValue, 2);
+	pSetConfirm->m_u8Status = G3_SUCCESS;
+}
+
+void AdpDataRequest(uint16_t u16NsduLength, const uint8_t *pNsdu, uint8_t u8NsduHandle, bool bDiscoverRoute,
+		uint8_t u8QualityOfService)
+{
+	adp_frame_t *px_frame;
+
+	sul_data_requests++;
+	sus_sent_dest = sus_ib_ula_dest;
+	sus_sent_len = u16NsduLength;
+	suc_sent_handle = u8NsduHandle;
+	if (!sb_adp_hold) {
+		memcpy(sauc_sent, pNsdu, u16NsduLength);
+		return;
+	}
+
+	/* Full queue: the test must confirm before sending more */
+	if (suc_adp_count == ADP_QUEUE_SIZE) {
+		sul_corrupted++;
+		return;
+	}
+
+	px_frame = &sax_adp_queue[(suc_adp_head + suc_adp_count) % ADP_QUEUE_SIZE];
+	suc_adp_count++;
+	memcpy(px_frame->auc_copy, pNsdu, u16NsduLength);
+#ifdef G3_ADP_NSDU_COPIED
+	px_frame->puc_nsdu = NULL;
+#else
+	px_frame->puc_nsdu = pNsdu;
+#endif
+	px_frame->us_len = u16NsduLength;
+	px_frame->uc_handle = u8NsduHandle;
+}
+
+/* ADP is done with its oldest frame, its confirm may be lost */
+static void _adp_confirm_oldest(bool b_lost)
+{
+	adp_frame_t *px_frame = &sax_adp_queue[suc_adp_head];
+	struct TAdpDataConfirm x_confirm;
+
+	if ((px_frame->puc_nsdu != NULL) && (memcmp(px_frame->puc_nsdu, px_frame->auc_copy, px_frame->us_len) != 0)) {
+		sul_corrupted++;
+	}
+
+	suc_adp_head = (suc_adp_head + 1) % ADP_QUEUE_SIZE;
+	suc_adp_count--;
+	if (!b_lost) {
+		x_confirm.m_u8Status = G3_SUCCESS;
+		x_confirm.m_u8NsduHandle = px_frame->uc_handle;
+		ipv6_send_confirm(&x_confirm);
+	}
+}
+
+void nicProcessPacket(NetInterface *interface, uint8_t *packet, size_t length)
+{
+}
+
+void LogDump(const uint8_t *pu8Data, uint16_t u16Length)
+{
+}
+
+/* ADP reset as handled by the gateway application */
+static void _adp_reset(void)
+{
+	sus_ib_ula_dest = ULA_DEST_DEFAULT;
+	g3_adapter_flush_addr_cache();
+}
+
+/* IPv6 packet to the IID, with a random payload */
+static NetBuffer *_build_packet(const uint8_t *puc_iid, uint16_t us_len)
+{
+	NetBuffer *px_buffer;
+	Ipv6Header *px_header;
+	uint16_t us_i;
+
+	px_buffer = netBufferAlloc(us_len);
+	px_header = netBufferAt(px_buffer, 0);
+	memset(px_header, 0, sizeof(Ipv6Header));
+	px_header->destAddr.b[0] = 0xFD;
+	memcpy(&px_header->destAddr.b[8], puc_iid, 8);
+	for (us_i = sizeof(Ipv6Header); us_i < us_len; us_i++) {
+		*(uint8_t *)netBufferAt(px_buffer, us_i) = (uint8_t)_rand();
+	}
+
+	return px_buffer;
+}
+
+/* Same packet in two chunks, IPv6 header apart, as built by the IP layer */
+static NetBuffer *_chain_packet(const NetBuffer *px_packet, NetBuffer **ppx_payload)
+{
+	NetBuffer *px_buffer;
+	size_t ul_len = netBufferGetLength(px_packet) - sizeof(Ipv6Header);
+
+	px_buffer = netBufferAlloc(sizeof(Ipv6Header));
+	netBufferCopy(px_buffer, 0, px_packet, 0, sizeof(Ipv6Header));
+	*ppx_payload = netBufferAlloc(ul_len);
+	netBufferCopy(*ppx_payload, 0, px_packet, sizeof(Ipv6Header), ul_len);
+	netBufferConcat(px_buffer, *ppx_payload, 0, ul_len);
+
+	return px_buffer;
+}
+
+/* IID of the ULA address built from PAN ID and short address */
+static void _ula_iid(uint16_t us_short, uint8_t *puc_iid)
+{
+	puc_iid[0] = (uint8_t)(G3_COORDINATOR_PAN_ID >> 8);
+	puc_iid[1] = (uint8_t)G3_COORDINATOR_PAN_ID;
+	puc_iid[2] = 0x00;
+	puc_iid[3] = 0xFF;
+	puc_iid[4] = 0xFE;
+	puc_iid[5] = 0x00;
+	puc_iid[6] = (uint8_t)(us_short >> 8);
+	puc_iid[7] = (uint8_t)us_short;
+}
+
+static void _random_iid(uint8_t *puc_iid)
+{
+	uint8_t uc_i;
+
+	for (uc_i = 0; uc_i < 8; uc_i++) {
+		puc_iid[uc_i] = (uint8_t)_rand();
+	}
+
+	/* Never mistaken for a ULA address */
+	puc_iid[0] = (uint8_t)(G3_COORDINATOR_PAN_ID >> 8) ^ 0x80;
+}
+
+static void _init_devices(void)
+{
+	uint16_t us_i;
+
+	for (us_i = 0; us_i < DEVICES; us_i++) {
+		_random_iid(sauc_iid[us_i]);
+		saus_short[us_i] = us_i + 1;
+	}
+
+	sul_lbds_generation++;
+}
+
+/* Packets reach ADP with the destination short address set in the IB */
+static void test_random_traffic(void)
+{
+	uint8_t auc_iid[8];
+	uint8_t auc_packet[PACKET_MAX_LEN];
+	NetBuffer *px_buffer;
+	struct TAdpDataConfirm x_confirm;
+	uint32_t ul_op;
+	uint32_t ul_requests;
+	uint32_t ul_mismatches = 0;
+	uint32_t ul_unchecked = 0;
+	uint32_t ul_sets = 0;
+	uint32_t ul_sent = 0;
+	uint16_t us_dev;
+	uint16_t us_len;
+	uint16_t us_expected;
+	uint16_t us_next_short = DEVICES + 1;
+	uint8_t uc_kind;
+	bool b_known;
+	error_t x_error;
+
+	_init_devices();
+	Init(&netInterface[1]);
+
+	for (ul_op = 0; ul_op < RANDOM_OPS; ul_op++) {
+		uc_kind = _rand() % 100;
+		if (uc_kind < 2) {
+			/* Device leaves and joins again with a new short address */
+			us_dev = _rand() % DEVICES;
+			saus_short[us_dev] = us_next_short++;
+			sul_lbds_generation++;
+			continue;
+		}
+
+		if (uc_kind < 3) {
+			_adp_reset();
+			continue;
+		}
+
+		/* Mostly a few active destinations, as a head end polling meters */
+		us_dev = (_rand() % 4) ? (_rand() % 16) : (_rand() % DEVICES);
+		b_known = true;
+		if (uc_kind < 80) {
+			memcpy(auc_iid, sauc_iid[us_dev], 8);
+			us_expected = saus_short[us_dev];
+		} else if (uc_kind < 95) {
+			us_expected = _rand() % 0x8000;
+			_ula_iid(us_expected, auc_iid);
+		} else {
+			_random_iid(auc_iid);
+			b_known = false;
+			us_expected = 0;
+		}
+
+		us_len = sizeof(Ipv6Header) + (_rand() % (PACKET_MAX_LEN - sizeof(Ipv6Header) + 1));
+		px_buffer = _build_packet(auc_iid, us_len);
+		netBufferRead(auc_packet, px_buffer, 0, us_len);
+
+		sb_ib_set_fail = ((_rand() % 50) == 0);
+		ul_requests = sul_data_requests;
+		ul_sets = sul_ib_sets;
+		x_error = ipv6_send_packet(&netInterface[1], px_buffer, 0);
+		netBufferFree(px_buffer);
+
+		if (!b_known) {
+			if ((x_error != ERROR_ADDRESS_NOT_FOUND) || (sul_data_requests != ul_requests)) {
+				ul_mismatches++;
+			}
+
+			continue;
+		}
+
+		if ((x_error != NO_ERROR) || (sul_data_requests != ul_requests + 1) || (sus_sent_len != us_len) ||
+				(memcmp(sauc_sent, auc_packet, us_len) != 0)) {
+			ul_mismatches++;
+		} else if (sb_ib_set_fail && (sul_ib_sets != ul_sets)) {
+			/* Sent with whatever the IB held: the next packet must set it again */
+			ul_unchecked++;
+		} else if (sus_sent_dest != us_expected) {
+			ul_mismatches++;
+		}
+
+		ul_sent++;
+		x_confirm.m_u8Status = G3_SUCCESS;
+		x_confirm.m_u8NsduHandle = suc_sent_handle;
+		ipv6_send_confirm(&x_confirm);
+	}
+
+	sb_ib_set_fail = false;
+
+#ifndef G3_ADP_NSDU_COPIED
+	/* Every SDU went back to the pool */
+	for (us_dev = 0; us_dev < G3_ADP_SDU_POOL_SIZE; us_dev++) {
+		CHECK(!sx_adp_sdu_pool[us_dev].b_used);
+	}
+#endif
+
+	CHECK(ul_mismatches == 0);
+	printf("%u packets sent, %u with a failed IB set, %u mismatches\n", (unsigned)ul_sent, (unsigned)ul_unchecked,
+			(unsigned)ul_mismatches);
+}
+
+/* Former TX path: bootstrap lookup and IB set on every packet */
+static uint8_t sauc_former_sdu[G3_ADP_MAX_DATA_LENGTH];
+
+static error_t _former_send_packet(NetInterface *interface, const NetBuffer *buffer, size_t offset)
+{
+	static uint8_t uc_nsdu_handle = 0;
+	error_t sendPacketError;
+	uint16_t us_data_length = netBufferGetLength(buffer) - offset;
+	Ipv6Header *ipHeader;
+	uint16_t us_short_addr;
+	struct TAdpSetConfirm pSetConfirm;
+
+	if (us_data_length <= G3_ADP_MAX_DATA_LENGTH) {
+		(void)netBufferRead((uint8_t *)sauc_former_sdu, buffer, offset, us_data_length);
+		ipHeader = netBufferAt(buffer, offset);
+		if (bs_get_short_addr_by_ext(ipHeader->destAddr.b + 8, &us_short_addr) == true) {
+			AdpSetRequestSync(ADP_IB_MANUF_IPV6_ULA_DEST_SHORT_ADDRESS, 0, sizeof(us_short_addr), (uint8_t *)&us_short_addr, &pSetConfirm);
+			AdpDataRequest(us_data_length, sauc_former_sdu, uc_nsdu_handle++, true, 0x00);
+			sendPacketError = NO_ERROR;
+		} else {
+			sendPacketError = ERROR_ADDRESS_NOT_FOUND;
+		}
+	} else {
+		sendPacketError = ERROR_WRONG_LENGTH;
+	}
+
+	osSetEvent(&interface->nicTxEvent);
+	return sendPacketError;
+}
+
+/* Packets per second, in bursts of uc_burst packets to the same destination */
+static double _bench(bool b_former, uint8_t uc_burst, double *pd_lookups, double *pd_sets)
+{
+	NetBuffer *apx_packets[BENCH_DESTS];
+	struct TAdpDataConfirm x_confirm;
+	struct timespec x_start;
+	struct timespec x_end;
+	uint32_t ul_i;
+	uint32_t ul_lookups = sul_lookups;
+	uint32_t ul_sets = sul_ib_sets;
+	uint32_t ul_errors = 0;
+	uint16_t us_dest;
+
+	/* Destinations spread over the whole joined devices list */
+	for (us_dest = 0; us_dest < BENCH_DESTS; us_dest++) {
+		apx_packets[us_dest] = _build_packet(sauc_iid[(us_dest * (DEVICES / BENCH_DESTS)) + (DEVICES / BENCH_DESTS) - 1],
+				BENCH_LEN);
+	}
+
+	_adp_reset();
+	x_confirm.m_u8Status = G3_SUCCESS;
+	clock_gettime(CLOCK_MONOTONIC, &x_start);
+	for (ul_i = 0; ul_i < BENCH_PACKETS; ul_i++) {
+		us_dest = (ul_i / uc_burst) % BENCH_DESTS;
+		if (b_former) {
+			ul_errors += (_former_send_packet(&netInterface[1], apx_packets[us_dest], 0) != NO_ERROR);
+		} else {
+			ul_errors += (ipv6_send_packet(&netInterface[1], apx_packets[us_dest], 0) != NO_ERROR);
+			x_confirm.m_u8NsduHandle = suc_sent_handle;
+			ipv6_send_confirm(&x_confirm);
+		}
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &x_end);
+	CHECK(ul_errors == 0);
+
+	for (us_dest = 0; us_dest < BENCH_DESTS; us_dest++) {
+		netBufferFree(apx_packets[us_dest]);
+	}
+
+	*pd_lookups = (double)(sul_lookups - ul_lookups) / BENCH_PACKETS;
+	*pd_sets = (double)(sul_ib_sets - ul_sets) / BENCH_PACKETS;
+	return BENCH_PACKETS / ((double)(x_end.tv_sec - x_start.tv_sec) + (double)(x_end.tv_nsec - x_start.tv_nsec) / 1e9);
+}
+
+static void test_bench(void)
+{
+	static const uint8_t cauc_bursts[] = {1, 8};
+	double d_new;
+	double d_former;
+	double d_new_lookups;
+	double d_former_lookups;
+	double d_new_sets;
+	double d_former_sets;
+	uint8_t uc_i;
+
+	printf("burst  pkt/s         lookups/pkt  IB sets/pkt  (former)\n");
+	for (uc_i = 0; uc_i < sizeof(cauc_bursts); uc_i++) {
+		d_new = _bench(false, cauc_bursts[uc_i], &d_new_lookups, &d_new_sets);
+		d_former = _bench(true, cauc_bursts[uc_i], &d_former_lookups, &d_former_sets);
+		printf("%5u  %5.2fM (%5.2fM)  %4.2f (%4.2f)  %4.2f (%4.2f)\n", (unsigned)cauc_bursts[uc_i], d_new / 1e6,
+				d_former / 1e6, d_new_lookups, d_former_lookups, d_new_sets, d_former_sets);
+	}
+}
+
+/* ADP holds the SDUs until it confirms them, some confirms are lost */
+static void test_hold(void)
+{
+	uint8_t auc_packet[PACKET_MAX_LEN];
+	NetBuffer *px_packet;
+	NetBuffer *px_payload;
+	NetBuffer *px_buffer;
+	adp_frame_t *px_frame;
+	uint32_t ul_sent = 0;
+	uint32_t ul_busy = 0;
+	uint32_t ul_lost = 0;
+	uint32_t ul_reclaims = 0;
+	uint32_t ul_mismatches = 0;
+	uint16_t us_len;
+	uint8_t uc_max_held = 0;
+#ifndef G3_ADP_NSDU_COPIED
+	uint8_t uc_i;
+#endif
+	bool b_chained;
+	bool b_lost;
+	bool b_stalled = false;
+	error_t x_error;
+
+	_adp_reset();
+	sb_adp_hold = true;
+	sul_corrupted = 0;
+	Init(&netInterface[1]);
+
+	while ((ul_sent < HOLD_PACKETS) && !b_stalled) {
+		if ((netInterface[1].nicTxEvent == 0) || (suc_adp_count == ADP_QUEUE_SIZE) ||
+				((suc_adp_count > 0) && ((_rand() % 3) == 0))) {
+			if (suc_adp_count > 0) {
+				/* ADP is done with a frame */
+				b_lost = ((_rand() % 500) == 0);
+				ul_lost += b_lost;
+				_adp_confirm_oldest(b_lost);
+			} else {
+				/* Nothing held, transmitter still waiting: only lost confirms are left */
+				simTime += G3_ADP_SDU_TIMEOUT;
+				Tick(&netInterface[1]);
+				ul_reclaims++;
+				b_stalled = (netInterface[1].nicTxEvent == 0);
+			}
+
+			continue;
+		}
+
+		/* Transmitter signaled, the IP layer sends a packet */
+		netInterface[1].nicTxEvent = 0;
+		us_len = sizeof(Ipv6Header) + 1 + (_rand() % (PACKET_MAX_LEN - sizeof(Ipv6Header)));
+		px_packet = _build_packet(sauc_iid[_rand() % 16], us_len);
+		netBufferRead(auc_packet, px_packet, 0, us_len);
+		b_chained = (_rand() % 2);
+		px_buffer = b_chained ? _chain_packet(px_packet, &px_payload) : px_packet;
+
+		x_error = ipv6_send_packet(&netInterface[1], px_buffer, 0);
+
+		if (b_chained) {
+			netBufferFree(px_buffer);
+			netBufferFree(px_payload);
+		}
+
+		netBufferFree(px_packet);
+
+		if (x_error == ERROR_TRANSMITTER_BUSY) {
+			ul_busy++;
+			continue;
+		}
+
+		px_frame = &sax_adp_queue[(suc_adp_head + suc_adp_count + ADP_QUEUE_SIZE - 1) % ADP_QUEUE_SIZE];
+		if ((x_error != NO_ERROR) || (px_frame->us_len != us_len) || (memcmp(px_frame->auc_copy, auc_packet, us_len) != 0)) {
+			ul_mismatches++;
+		}
+
+		ul_sent++;
+		if (suc_adp_count > uc_max_held) {
+			uc_max_held = suc_adp_count;
+		}
+	}
+
+	while (suc_adp_count > 0) {
+		_adp_confirm_oldest(false);
+	}
+
+	simTime += G3_ADP_SDU_TIMEOUT;
+	Tick(&netInterface[1]);
+	sb_adp_hold = false;
+
+	CHECK(!b_stalled);
+	CHECK(ul_busy == 0);
+	CHECK(ul_mismatches == 0);
+	CHECK(sul_corrupted == 0);
+	CHECK(ul_lost > 0);
+#ifdef G3_ADP_NSDU_COPIED
+	CHECK(uc_max_held == ADP_QUEUE_SIZE);
+#else
+	CHECK(uc_max_held == G3_ADP_SDU_POOL_SIZE);
+	CHECK(ul_reclaims > 0);
+	for (uc_i = 0; uc_i < G3_ADP_SDU_POOL_SIZE; uc_i++) {
+		CHECK(!sx_adp_sdu_pool[uc_i].b_used);
+	}
+#endif
+	printf("%u packets held by ADP (up to %u), %u confirms lost, %u busy, %u changed before confirm, %u mismatches\n",
+			(unsigned)ul_sent, (unsigned)uc_max_held, (unsigned)ul_lost, (unsigned)ul_busy, (unsigned)sul_corrupted,
+			(unsigned)ul_mismatches);
+}
+
+/* Packets per second with the ADP holding frames; SDUs changed before their confirm in pul_corrupted */
+static double _pps(bool b_former, bool b_chained, uint32_t *pul_corrupted)
+{
+	NetBuffer *px_packet;
+	NetBuffer *px_payload = NULL;
+	NetBuffer *px_buffer;
+	struct timespec x_start;
+	struct timespec x_end;
+	uint32_t ul_sent = 0;
+	error_t x_error;
+
+	px_packet = _build_packet(sauc_iid[0], PPS_LEN);
+	px_buffer = b_chained ? _chain_packet(px_packet, &px_payload) : px_packet;
+
+	_adp_reset();
+	sb_adp_hold = true;
+	sul_corrupted = 0;
+	Init(&netInterface[1]);
+
+	clock_gettime(CLOCK_MONOTONIC, &x_start);
+	while (ul_sent < PPS_PACKETS) {
+		if ((netInterface[1].nicTxEvent == 0) || (suc_adp_count == ADP_QUEUE_SIZE)) {
+			if (suc_adp_count == 0) {
+				/* Transmitter never signaled again */
+				break;
+			}
+
+			_adp_confirm_oldest(false);
+			continue;
+		}
+
+		netInterface[1].nicTxEvent = 0;
+		/* The IP layer builds every packet in a new buffer: here the same one, with a new last byte */
+		*(uint8_t *)netBufferAt(px_buffer, PPS_LEN - 1) = (uint8_t)ul_sent;
+		if (b_former) {
+			x_error = _former_send_packet(&netInterface[1], px_buffer, 0);
+		} else {
+			x_error = ipv6_send_packet(&netInterface[1], px_buffer, 0);
+		}
+
+		ul_sent += (x_error == NO_ERROR);
+	}
+
+	while (suc_adp_count > 0) {
+		_adp_confirm_oldest(false);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &x_end);
+	sb_adp_hold = false;
+	CHECK(ul_sent == PPS_PACKETS);
+
+	if (b_chained) {
+		netBufferFree(px_buffer);
+		netBufferFree(px_payload);
+	}
+
+	netBufferFree(px_packet);
+
+	*pul_corrupted = sul_corrupted;
+	return PPS_PACKETS / ((double)(x_end.tv_sec - x_start.tv_sec) + (double)(x_end.tv_nsec - x_start.tv_nsec) / 1e9);
+}
+
+static void test_pps(void)
+{
+	uint32_t ul_corrupted;
+	uint32_t ul_former_corrupted;
+	double d_contiguous;
+	double d_chained;
+	double d_former;
+
+	d_contiguous = _pps(false, false, &ul_corrupted);
+	CHECK(ul_corrupted == 0);
+	d_chained = _pps(false, true, &ul_corrupted);
+	CHECK(ul_corrupted == 0);
+	d_former = _pps(true, false, &ul_former_corrupted);
+
+	printf("%u-byte packets, ADP holding up to %u frames: contiguous %.2fM pkt/s, chained %.2fM pkt/s\n",
+			(unsigned)PPS_LEN, (unsigned)ADP_QUEUE_SIZE, d_contiguous / 1e6, d_chained / 1e6);
+	printf("former single SDU buffer: %.2fM pkt/s, %u of %u SDUs changed before confirm\n", d_former / 1e6,
+			(unsigned)ul_former_corrupted, (unsigned)PPS_PACKETS);
+}
+
+int main(void)
+{
+	memPoolInit();
+
+	test_random_traffic();
+	test_bench();
+	test_hold();
+	test_pps();
+
+	if (si_failures) {
+		printf("%d failure(s)\n", si_failures);
+		return 1;
+	}
+
+	printf("OK\n");
+	return 0;
+}
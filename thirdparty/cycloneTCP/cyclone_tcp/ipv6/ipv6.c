@@ -129,6 +129,8 @@ error_t ipv6Init(NetInterface *interface)
    context->identification = 0;
    //Initialize the reassembly queue
    memset(context->fragQueue, 0, sizeof(context->fragQueue));
+   //Clear reassembly statistics
+   memset(&context->fragStats, 0, sizeof(context->fragStats));
 #endif
 
    //Successful initialization
@@ -471,6 +471,7 @@ typedef struct
 #if (IPV6_FRAG_SUPPORT == ENABLED)
    uint32_t identification;                                     ///<IPv6 fragment identification field
    Ipv6FragDesc fragQueue[IPV6_MAX_FRAG_DATAGRAMS];             ///<IPv6 fragment reassembly queue
+   Ipv6FragStats fragStats;                                     ///<IPv6 fragment reassembly statistics
 #endif
 } Ipv6Context;
 
@@ -178,9 +178,9 @@ void ipv6ParseFragmentHeader(NetInterface *interface, const NetBuffer *ipPacket,
    uint16_t offset;
    uint16_t dataFirst;
    uint16_t dataLast;
+   uint_t blockFirst;
+   uint_t blockLast;
    Ipv6FragDesc *frag;
-   Ipv6HoleDesc *hole;
-   Ipv6HoleDesc *prevHole;
    Ipv6Header *ipHeader;
    Ipv6FragmentHeader *fragHeader;
 
@@ -285,20 +285,20 @@ void ipv6ParseFragmentHeader(NetInterface *interface, const NetBuffer *ipPacket,
             ICMPV6_CODE_INVALID_HEADER_FIELD, n, ipPacket, ipPacketOffset);
 
          //Drop the reconstructed datagram
-         netBufferSetLength((NetBuffer *) &frag->buffer, 0);
+         ipv6ReleaseFragDesc(frag);
          //Exit immediately
          return;
       }
 
       //Make sure the unfragmentable part entirely fits in the first chunk
-      if(frag->unfragPartLength > frag->buffer.chunk[0].size)
+      if(frag->unfragPartLength > IPV6_FRAG_HEADER_BUFFER_SIZE)
       {
          //Number of failures detected by the IP reassembly algorithm
          IP_MIB_INC_COUNTER32(ipv6SystemStats.ipSystemStatsReasmFails, 1);
          IP_MIB_INC_COUNTER32(ipv6IfStatsTable[interface->index].ipIfStatsReasmFails, 1);
 
          //Drop the reconstructed datagram
-         netBufferSetLength((NetBuffer *) &frag->buffer, 0);
+         ipv6ReleaseFragDesc(frag);
          //Exit immediately
          return;
       }
@@ -322,6 +322,23 @@ void ipv6ParseFragmentHeader(NetInterface *interface, const NetBuffer *ipPacket,
       *p = fragHeader->nextHeader;
    }
 
+   //The last fragment determines the length of the fragmentable part. Any
+   //fragment inconsistent with that length invalidates the whole datagram
+   if((!(offset & IPV6_FLAG_M) && (dataLast < frag->fragPartLength ||
+      (frag->lastFragReceived && dataLast != frag->fragPartLength))) ||
+      ((offset & IPV6_FLAG_M) && frag->lastFragReceived &&
+      dataLast > frag->fragPartLength))
+   {
+      //Number of failures detected by the IP reassembly algorithm
+      IP_MIB_INC_COUNTER32(ipv6SystemStats.ipSystemStatsReasmFails, 1);
+      IP_MIB_INC_COUNTER32(ipv6IfStatsTable[interface->index].ipIfStatsReasmFails, 1);
+
+      //Drop the reconstructed datagram
+      ipv6ReleaseFragDesc(frag);
+      //Exit immediately
+      return;
+   }
+
    //It may be necessary to increase the size of the buffer...
    if(dataLast > frag->fragPartLength)
    {
@@ -344,14 +361,28 @@ void ipv6ParseFragmentHeader(NetInterface *interface, const NetBuffer *ipPacket,
             ICMPV6_CODE_INVALID_HEADER_FIELD, n, ipPacket, ipPacketOffset);
 
          //Drop the reconstructed datagram
-         netBufferSetLength((NetBuffer *) &frag->buffer, 0);
+         ipv6ReleaseFragDesc(frag);
          //Exit immediately
          return;
       }
 
-      //Adjust the size of the reconstructed datagram
-      error = netBufferSetLength((NetBuffer *) &frag->buffer,
-         frag->unfragPartLength + dataLast + sizeof(Ipv6HoleDesc));
+      //Adjust the size of the reconstructed datagram. When the memory pool
+      //is exhausted, the least recently used idle datagrams are dropped.
+      //Datagrams still receiving fragments are never evicted, so that
+      //overload does not turn into datagrams evicting each other
+      do
+      {
+         error = netBufferSetLength((NetBuffer *) &frag->buffer,
+            frag->unfragPartLength + dataLast);
+      } while(error && ipv6EvictFragDesc(interface, frag));
+
+      //The reassembly queue must also stay within its memory budget
+      while(!error && ipv6GetFragMemUsage(interface) > IPV6_FRAG_MEM_BUDGET)
+      {
+         //No idle datagram can be dropped?
+         if(!ipv6EvictFragDesc(interface, frag))
+            error = ERROR_OUT_OF_MEMORY;
+      }
 
       //Any error to report?
       if(error)
@@ -361,153 +392,89 @@ void ipv6ParseFragmentHeader(NetInterface *interface, const NetBuffer *ipPacket,
          IP_MIB_INC_COUNTER32(ipv6IfStatsTable[interface->index].ipIfStatsReasmFails, 1);
 
          //Drop the reconstructed datagram
-         netBufferSetLength((NetBuffer *) &frag->buffer, 0);
+         ipv6ReleaseFragDesc(frag);
          //Exit immediately
          return;
       }
 
       //Actual length of the fragmentable part
       frag->fragPartLength = dataLast;
-   }
-
-   //Select the first hole descriptor from the list
-   hole = ipv6FindHole(frag, frag->firstHole);
-   //Keep track of the previous hole in the list
-   prevHole = NULL;
-
-   //Iterate through the hole descriptors
-   while(hole != NULL)
-   {
-      //Save lower and upper boundaries for later use
-      uint16_t holeFirst = hole->first;
-      uint16_t holeLast = hole->last;
 
-      //Check whether the newly arrived fragment interacts with this hole
-      //in some way
-      if(dataFirst < holeLast && dataLast > holeFirst)
-      {
-#if (IPV6_OVERLAPPING_FRAG_SUPPORT == DISABLED)
-         //When reassembling an IPv6 datagram, if one or more its constituent
-         //fragments is determined to be an overlapping fragment, the entire
-         //datagram must be silently discarded (refer to RFC 5722, section 4)
-         if(dataFirst < holeFirst || dataLast > holeLast)
-         {
-            //Number of failures detected by the IP reassembly algorithm
-            IP_MIB_INC_COUNTER32(ipv6SystemStats.ipSystemStatsReasmFails, 1);
-            IP_MIB_INC_COUNTER32(ipv6IfStatsTable[interface->index].ipIfStatsReasmFails, 1);
+      //Keep track of the maximum memory usage
+      interface->ipv6Context.fragStats.maxMemUsage =
+         MAX(ipv6GetFragMemUsage(interface), interface->ipv6Context.fragStats.maxMemUsage);
+   }
 
-            //Drop the reconstructed datagram
-            netBufferSetLength((NetBuffer *) &frag->buffer, 0);
-            //Exit immediately
-            return;
-         }
-#endif
-         //The current descriptor is no longer valid. We will destroy it,
-         //and in the next two steps, we will determine whether or not it
-         //is necessary to create any new hole descriptors
-         if(prevHole != NULL)
-            prevHole->next = hole->next;
-         else
-            frag->firstHole = hole->next;
-
-         //Is there still a hole at the beginning of the segment?
-         if(dataFirst > holeFirst)
-         {
-            //Create a new entry that describes this hole
-            hole = ipv6FindHole(frag, holeFirst);
-            hole->first = holeFirst;
-            hole->last = dataFirst;
+   //The length of the fragmentable part is now known
+   if(!(offset & IPV6_FLAG_M))
+      frag->lastFragReceived = TRUE;
 
-            //Insert the newly created entry into the hole descriptor list
-            if(prevHole != NULL)
-            {
-               hole->next = prevHole->next;
-               prevHole->next = hole->first;
-            }
-            else
-            {
-               hole->next = frag->firstHole;
-               frag->firstHole = hole->first;
-            }
+   //Range of 8-byte blocks covered by the fragment
+   blockFirst = dataFirst / 8;
+   blockLast = (dataLast + 7) / 8;
 
-            //Always keep track of the previous hole
-            prevHole = hole;
-         }
+   //Update the bitmap of received blocks
+   n = ipv6MarkFragBlocks(frag, blockFirst, blockLast);
 
-         //Is there still a hole at the end of the segment?
-         if(dataLast < holeLast && (offset & IPV6_FLAG_M))
-         {
-            //Create a new entry that describes this hole
-            hole = ipv6FindHole(frag, dataLast);
-            hole->first = dataLast;
-            hole->last = holeLast;
-
-            //Insert the newly created entry into the hole descriptor list
-            if(prevHole != NULL)
-            {
-               hole->next = prevHole->next;
-               prevHole->next = hole->first;
-            }
-            else
-            {
-               hole->next = frag->firstHole;
-               frag->firstHole = hole->first;
-            }
-
-            //Always keep track of the previous hole
-            prevHole = hole;
-         }
-      }
-      else
+   //The fragment does not carry any new data?
+   if(n == 0 && blockLast > blockFirst)
+   {
+      //Exact duplicates are silently ignored
+      interface->ipv6Context.fragStats.duplicates++;
+   }
+   else
+   {
+#if (IPV6_OVERLAPPING_FRAG_SUPPORT == DISABLED)
+      //When reassembling an IPv6 datagram, if one or more its constituent
+      //fragments is determined to be an overlapping fragment, the entire
+      //datagram must be silently discarded (refer to RFC 5722, section 4)
+      if(n != (blockLast - blockFirst))
       {
-         //The newly arrived fragment does not interact with the current hole
-         prevHole = hole;
+         //Number of failures detected by the IP reassembly algorithm
+         IP_MIB_INC_COUNTER32(ipv6SystemStats.ipSystemStatsReasmFails, 1);
+         IP_MIB_INC_COUNTER32(ipv6IfStatsTable[interface->index].ipIfStatsReasmFails, 1);
+
+         //Drop the reconstructed datagram
+         ipv6ReleaseFragDesc(frag);
+         //Exit immediately
+         return;
       }
+#endif
+      //Copy data from the fragment to the reassembly buffer
+      netBufferCopy((NetBuffer *) &frag->buffer, frag->unfragPartLength + dataFirst,
+         ipPacket, fragHeaderOffset + sizeof(Ipv6FragmentHeader), length);
 
-      //Select the next hole descriptor from the list
-      hole = ipv6FindHole(frag, prevHole ? prevHole->next : frag->firstHole);
+      //Update the number of blocks received so far
+      frag->receivedBlocks += n;
    }
 
-   //Copy data from the fragment to the reassembly buffer
-   netBufferCopy((NetBuffer *) &frag->buffer, frag->unfragPartLength + dataFirst,
-      ipPacket, fragHeaderOffset + sizeof(Ipv6FragmentHeader), length);
+   //Keep track of the most recently used datagram
+   frag->lastUpdate = osGetSystemTime();
 
-   //Dump hole descriptor list
-   ipv6DumpHoleList(frag);
+   //Dump the bitmap of received blocks
+   ipv6DumpFragBlocks(frag);
 
-   //If the hole descriptor list is empty, the reassembly process is now complete
-   if(!ipv6FindHole(frag, frag->firstHole))
+   //The reassembly process is complete when all the blocks up to the last
+   //fragment have been received
+   if(frag->lastFragReceived &&
+      frag->receivedBlocks == ((frag->fragPartLength + 7) / 8))
    {
-      //Discard the extra hole descriptor that follows the reconstructed datagram
-      error = netBufferSetLength((NetBuffer *) &frag->buffer,
-         frag->unfragPartLength + frag->fragPartLength);
-
-      //Check status code
-      if(error)
-      {
-         //Number of failures detected by the IP reassembly algorithm
-         IP_MIB_INC_COUNTER32(ipv6SystemStats.ipSystemStatsReasmFails, 1);
-         IP_MIB_INC_COUNTER32(ipv6IfStatsTable[interface->index].ipIfStatsReasmFails, 1);
-      }
-      else
-      {
-         //Point to the IPv6 header
-         Ipv6Header *datagram = netBufferAt((NetBuffer *) &frag->buffer, 0);
+      //Point to the IPv6 header
+      Ipv6Header *datagram = netBufferAt((NetBuffer *) &frag->buffer, 0);
 
-         //Fix the Payload Length field
-         datagram->payloadLen = htons(frag->unfragPartLength +
-            frag->fragPartLength - sizeof(Ipv6Header));
+      //Fix the Payload Length field
+      datagram->payloadLen = htons(frag->unfragPartLength +
+         frag->fragPartLength - sizeof(Ipv6Header));
 
-         //Number of IP datagrams successfully reassembled
-         IP_MIB_INC_COUNTER32(ipv6SystemStats.ipSystemStatsReasmOKs, 1);
-         IP_MIB_INC_COUNTER32(ipv6IfStatsTable[interface->index].ipIfStatsReasmOKs, 1);
+      //Number of IP datagrams successfully reassembled
+      IP_MIB_INC_COUNTER32(ipv6SystemStats.ipSystemStatsReasmOKs, 1);
+      IP_MIB_INC_COUNTER32(ipv6IfStatsTable[interface->index].ipIfStatsReasmOKs, 1);
 
-         //Pass the original IPv6 datagram to the higher protocol layer
-         ipv6ProcessPacket(interface, (NetBuffer *) &frag->buffer, 0);
-      }
+      //Pass the original IPv6 datagram to the higher protocol layer
+      ipv6ProcessPacket(interface, (NetBuffer *) &frag->buffer, 0);
 
       //Release previously allocated memory
-      netBufferSetLength((NetBuffer *) &frag->buffer, 0);
+      ipv6ReleaseFragDesc(frag);
    }
 }
 
@@ -525,8 +492,8 @@ void ipv6FragTick(NetInterface *interface)
 {
    error_t error;
    uint_t i;
+   uint_t n;
    systime_t time;
-   Ipv6HoleDesc *hole;
 
    //Get current time
    time = osGetSystemTime();
@@ -552,17 +519,23 @@ void ipv6FragTick(NetInterface *interface)
             //Number of failures detected by the IP reassembly algorithm
             IP_MIB_INC_COUNTER32(ipv6SystemStats.ipSystemStatsReasmFails, 1);
             IP_MIB_INC_COUNTER32(ipv6IfStatsTable[interface->index].ipIfStatsReasmFails, 1);
+            //Number of datagrams dropped on timeout
+            interface->ipv6Context.fragStats.timeouts++;
 
-            //Point to the first hole descriptor
-            hole = ipv6FindHole(frag, frag->firstHole);
+            //Count the blocks received without gap from the beginning
+            for(n = 0; n < (frag->fragPartLength + 7) / 8; n++)
+            {
+               if(!(frag->blockMap[n / 32] & (1UL << (n % 32))))
+                  break;
+            }
 
             //Make sure the fragment zero has been received
             //before sending an ICMPv6 message
-            if(hole != NULL && hole->first > 0)
+            if(n > 0)
             {
                //Fix the size of the reconstructed datagram
                error = netBufferSetLength((NetBuffer *) &frag->buffer,
-                  frag->unfragPartLength + hole->first);
+                  frag->unfragPartLength + MIN(n * 8, frag->fragPartLength));
 
                //Check status code
                if(!error)
@@ -574,7 +547,7 @@ void ipv6FragTick(NetInterface *interface)
             }
 
             //Drop the partially reconstructed datagram
-            netBufferSetLength((NetBuffer *) &frag->buffer, 0);
+            ipv6ReleaseFragDesc(frag);
          }
       }
    }
@@ -592,11 +565,10 @@ void ipv6FragTick(NetInterface *interface)
 Ipv6FragDesc *ipv6SearchFragQueue(NetInterface *interface,
    Ipv6Header *packet, Ipv6FragmentHeader *header)
 {
-   error_t error;
    uint_t i;
+   void *p;
    Ipv6Header *datagram;
    Ipv6FragDesc *frag;
-   Ipv6HoleDesc *hole;
 
    //Search for a matching IP datagram being reassembled
    for(i = 0; i < IPV6_MAX_FRAG_DATAGRAMS; i++)
@@ -624,6 +596,17 @@ Ipv6FragDesc *ipv6SearchFragQueue(NetInterface *interface,
       }
    }
 
+   //Allocate memory to hold the unfragmentable part. When the memory pool
+   //is exhausted, idle datagrams are dropped first
+   do
+   {
+      p = memPoolAlloc(IPV6_FRAG_HEADER_BUFFER_SIZE);
+   } while(p == NULL && ipv6EvictFragDesc(interface, NULL));
+
+   //Failed to allocate memory?
+   if(p == NULL)
+      return NULL;
+
    //If the current packet does not match an existing entry
    //in the reassembly queue, then create a new entry
    for(i = 0; i < IPV6_MAX_FRAG_DATAGRAMS; i++)
@@ -633,57 +616,62 @@ Ipv6FragDesc *ipv6SearchFragQueue(NetInterface *interface,
 
       //The current entry is free?
       if(!frag->buffer.chunkCount)
-      {
-         //Number of chunks that comprise the reassembly buffer
-         frag->buffer.maxChunkCount = arraysize(frag->buffer.chunk);
+         break;
+   }
 
-         //Allocate sufficient memory to hold the IPv6 header and
-         //the first hole descriptor
-         error = netBufferSetLength((NetBuffer *) &frag->buffer,
-            NET_MEM_POOL_BUFFER_SIZE + sizeof(Ipv6HoleDesc));
+   //The reassembly queue is full?
+   if(i >= IPV6_MAX_FRAG_DATAGRAMS)
+   {
+      //Make room by dropping the least recently used idle datagram
+      if(!ipv6EvictFragDesc(interface, NULL))
+      {
+         //Release the unfragmentable part
+         memPoolFree(p);
+         //The reassembly queue is full
+         return NULL;
+      }
 
-         //Failed to allocate memory?
-         if(error)
-         {
-            //Clean up side effects
-            netBufferSetLength((NetBuffer *) &frag->buffer, 0);
-            //Exit immediately
-            return NULL;
-         }
+      //Retrieve the entry that has been released
+      for(i = 0; i < IPV6_MAX_FRAG_DATAGRAMS; i++)
+      {
+         frag = &interface->ipv6Context.fragQueue[i];
 
-         //Initial length of the reconstructed datagram
-         frag->unfragPartLength = sizeof(Ipv6Header);
-         frag->fragPartLength = 0;
-
-         //Fix the length of the first chunk
-         frag->buffer.chunk[0].length = (uint16_t) frag->unfragPartLength;
-         //Copy IPv6 header from the incoming fragment
-         netBufferWrite((NetBuffer *) &frag->buffer, 0, packet, frag->unfragPartLength);
-
-         //Save current time
-         frag->timestamp = osGetSystemTime();
-         //Record fragment identification field
-         frag->identification = header->identification;
-         //Create a new entry in the hole descriptor list
-         frag->firstHole = 0;
-
-         //Point to first hole descriptor
-         hole = ipv6FindHole(frag, frag->firstHole);
-         //The entry describes the datagram as being completely missing
-         hole->first = 0;
-         hole->last = IPV6_INFINITY;
-         hole->next = IPV6_INFINITY;
-
-         //Dump hole descriptor list
-         ipv6DumpHoleList(frag);
-
-         //Return the matching fragment descriptor
-         return frag;
+         if(!frag->buffer.chunkCount)
+            break;
       }
    }
 
-   //The reassembly queue is full
-   return NULL;
+   //Number of chunks that comprise the reassembly buffer
+   frag->buffer.maxChunkCount = arraysize(frag->buffer.chunk);
+
+   //The first chunk holds the unfragmentable part. It is not owned by the
+   //multi-part buffer, so that it never grows into the fragmentable part
+   frag->buffer.chunkCount = 1;
+   frag->buffer.chunk[0].address = p;
+   frag->buffer.chunk[0].size = 0;
+
+   //Initial length of the reconstructed datagram
+   frag->unfragPartLength = sizeof(Ipv6Header);
+   frag->fragPartLength = 0;
+
+   //Fix the length of the first chunk
+   frag->buffer.chunk[0].length = (uint16_t) frag->unfragPartLength;
+   //Copy IPv6 header from the incoming fragment
+   netBufferWrite((NetBuffer *) &frag->buffer, 0, packet, frag->unfragPartLength);
+
+   //Save current time
+   frag->timestamp = osGetSystemTime();
+   frag->lastUpdate = frag->timestamp;
+   //Record fragment identification field
+   frag->identification = header->identification;
+
+   //The datagram is completely missing
+   frag->lastFragReceived = FALSE;
+   frag->receivedBlocks = 0;
+   memset(frag->blockMap, 0, sizeof(frag->blockMap));
+
+   //Return the matching fragment descriptor
+   return frag;
 }
 
 
@@ -700,49 +688,222 @@ void ipv6FlushFragQueue(NetInterface *interface)
    for(i = 0; i < IPV6_MAX_FRAG_DATAGRAMS; i++)
    {
       //Drop any partially reconstructed datagram
-      netBufferSetLength((NetBuffer *) &interface->ipv6Context.fragQueue[i].buffer, 0);
+      ipv6ReleaseFragDesc(&interface->ipv6Context.fragQueue[i]);
    }
 }
 
 
 /**
- * @brief Retrieve hole descriptor
+ * @brief Release the memory held by a datagram being reassembled
  * @param[in] frag IPv6 fragment descriptor
- * @param[in] offset Offset of the hole
- * @return A pointer to the hole descriptor is returned if the
- *   specified offset is valid. Otherwise NULL is returned
  **/
 
-Ipv6HoleDesc *ipv6FindHole(Ipv6FragDesc *frag, uint16_t offset)
+void ipv6ReleaseFragDesc(Ipv6FragDesc *frag)
 {
-   //Return a pointer to the hole descriptor
-   return netBufferAt((NetBuffer *) &frag->buffer, frag->unfragPartLength + offset);
+   //Make sure the entry is currently in use
+   if(frag->buffer.chunkCount > 0)
+   {
+      //Release the unfragmentable part
+      memPoolFree(frag->buffer.chunk[0].address);
+      //Release the fragmentable part
+      netBufferSetLength((NetBuffer *) &frag->buffer, 0);
+   }
+}
+
+
+/**
+ * @brief Drop the least recently used idle datagram of the reassembly queue
+ * @param[in] interface Underlying network interface
+ * @param[in] current Datagram that must be kept (may be NULL)
+ * @return TRUE if a datagram has been dropped, else FALSE
+ **/
+
+bool_t ipv6EvictFragDesc(NetInterface *interface, Ipv6FragDesc *current)
+{
+   uint_t i;
+   systime_t time;
+   Ipv6FragDesc *frag;
+   Ipv6FragDesc *oldest;
+
+   //Get current time
+   time = osGetSystemTime();
+   //Least recently used datagram
+   oldest = NULL;
+
+   //Loop through the reassembly queue
+   for(i = 0; i < IPV6_MAX_FRAG_DATAGRAMS; i++)
+   {
+      //Point to the current entry in the reassembly queue
+      frag = &interface->ipv6Context.fragQueue[i];
+
+      //Skip free entries and the datagram being processed
+      if(frag->buffer.chunkCount == 0 || frag == current)
+         continue;
+      //Skip datagrams that are still receiving fragments
+      if((time - frag->lastUpdate) < IPV6_FRAG_IDLE_TIME)
+         continue;
+
+      //Keep track of the least recently used datagram
+      if(oldest == NULL || timeCompare(frag->lastUpdate, oldest->lastUpdate) < 0)
+         oldest = frag;
+   }
+
+   //No datagram can be dropped?
+   if(oldest == NULL)
+      return FALSE;
+
+   //Debug message
+   TRACE_INFO("IPv6 reassembly queue full, dropping idle datagram...\r\n");
+
+   //Number of failures detected by the IP reassembly algorithm
+   IP_MIB_INC_COUNTER32(ipv6SystemStats.ipSystemStatsReasmFails, 1);
+   IP_MIB_INC_COUNTER32(ipv6IfStatsTable[interface->index].ipIfStatsReasmFails, 1);
+   //Number of datagrams dropped to make room for newer ones
+   interface->ipv6Context.fragStats.evictions++;
+
+   //Drop the partially reconstructed datagram
+   ipv6ReleaseFragDesc(oldest);
+
+   //A datagram has been dropped
+   return TRUE;
+}
+
+
+/**
+ * @brief Get the memory held by the reassembly queue
+ * @param[in] interface Underlying network interface
+ * @return Number of bytes allocated to the datagrams being reassembled
+ **/
+
+size_t ipv6GetFragMemUsage(NetInterface *interface)
+{
+   uint_t i;
+   uint_t j;
+   size_t n;
+   Ipv6FragDesc *frag;
+
+   //Total memory
+   n = 0;
+
+   //Loop through the reassembly queue
+   for(i = 0; i < IPV6_MAX_FRAG_DATAGRAMS; i++)
+   {
+      //Point to the current entry in the reassembly queue
+      frag = &interface->ipv6Context.fragQueue[i];
+
+      //Make sure the entry is currently in use
+      if(frag->buffer.chunkCount > 0)
+      {
+         //Unfragmentable part
+         n += IPV6_FRAG_HEADER_BUFFER_SIZE;
+
+         //Chunks holding the fragmentable part
+         for(j = 1; j < frag->buffer.chunkCount; j++)
+            n += frag->buffer.chunk[j].size;
+      }
+   }
+
+   //Return the memory held by the reassembly queue
+   return n;
+}
+
+
+/**
+ * @brief Get reassembly statistics
+ * @param[in] interface Underlying network interface
+ * @param[out] stats Timeouts, evictions, duplicates and memory usage
+ * @return Error code
+ **/
+
+error_t ipv6GetFragStats(NetInterface *interface, Ipv6FragStats *stats)
+{
+   //Check parameters
+   if(interface == NULL || stats == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Get exclusive access
+   osAcquireMutex(&netMutex);
+
+   //Copy statistics
+   *stats = interface->ipv6Context.fragStats;
+   //Memory currently held by the reassembly queue
+   stats->memUsage = ipv6GetFragMemUsage(interface);
+
+   //Release exclusive access
+   osReleaseMutex(&netMutex);
+
+   //Successful processing
+   return NO_ERROR;
 }
 
 
 /**
- * @brief Dump hole descriptor list
+ * @brief Mark a range of 8-byte blocks as received
  * @param[in] frag IPv6 fragment descriptor
+ * @param[in] first Index of the first block
+ * @param[in] last Index immediately following the last block
+ * @return Number of blocks that were not received yet
  **/
 
-void ipv6DumpHoleList(Ipv6FragDesc *frag)
+uint_t ipv6MarkFragBlocks(Ipv6FragDesc *frag, uint_t first, uint_t last)
+{
+   uint_t n;
+   uint32_t mask;
+   uint32_t value;
+
+   //Number of newly received blocks
+   n = 0;
+
+   //Process the range one 32-bit word at a time
+   while(first < last)
+   {
+      //Blocks of the current word covered by the range
+      mask = 0xFFFFFFFFUL << (first % 32);
+
+      //The range ends within the current word?
+      if((last - (first & ~31U)) < 32)
+         mask &= 0xFFFFFFFFUL >> (32 - (last % 32));
+
+      //Count the blocks that were not received yet
+      value = mask & ~frag->blockMap[first / 32];
+      value = value - ((value >> 1) & 0x55555555UL);
+      value = (value & 0x33333333UL) + ((value >> 2) & 0x33333333UL);
+      value = (value + (value >> 4)) & 0x0F0F0F0FUL;
+      value = (uint32_t) (value * 0x01010101UL);
+      n += value >> 24;
+
+      //Mark the blocks as received
+      frag->blockMap[first / 32] |= mask;
+
+      //Next word
+      first = (first & ~31U) + 32;
+   }
+
+   //Return the number of newly received blocks
+   return n;
+}
+
+
+/**
+ * @brief Dump the bitmap of received blocks
+ * @param[in] frag IPv6 fragment descriptor
+ **/
+
+void ipv6DumpFragBlocks(Ipv6FragDesc *frag)
 {
 //Check debugging level
 #if (TRACE_LEVEL >= TRACE_LEVEL_DEBUG)
-   Ipv6HoleDesc *hole;
+   uint_t i;
 
    //Debug message
-   TRACE_DEBUG("Hole descriptor list:\r\n");
-   //Select the first hole descriptor from the list
-   hole = ipv6FindHole(frag, frag->firstHole);
+   TRACE_DEBUG("Received blocks: %u/%u%s\r\n", frag->receivedBlocks,
+      (frag->fragPartLength + 7) / 8, frag->lastFragReceived ? "" : "+");
 
-   //Loop through the hole descriptor list
-   while(hole != NULL)
+   //Loop through the bitmap
+   for(i = 0; i < (frag->fragPartLength + 255) / 256; i++)
    {
-      //Display current hole
-      TRACE_DEBUG("  %" PRIu16 " - %" PRIu16 "\r\n", hole->first, hole->last);
-      //Select the next hole descriptor from the list
-      hole = ipv6FindHole(frag, hole->next);
+      //Display current word
+      TRACE_DEBUG("  %04u: %08" PRIX32 "\r\n", i * 256, frag->blockMap[i]);
    }
 #else
    (void)(frag);
@@ -75,36 +75,33 @@
    #error IPV6_FRAG_TIME_TO_LIVE parameter is not valid
 #endif
 
-//Infinity is implemented by a very large integer
-#define IPV6_INFINITY 0xFFFF
-
-//C++ guard
-#ifdef __cplusplus
-   extern "C" {
+//Size of the buffer holding the unfragmentable part of a datagram
+#ifndef IPV6_FRAG_HEADER_BUFFER_SIZE
+   #define IPV6_FRAG_HEADER_BUFFER_SIZE 256
+#elif (IPV6_FRAG_HEADER_BUFFER_SIZE < 64)
+   #error IPV6_FRAG_HEADER_BUFFER_SIZE parameter is not valid
 #endif
 
-
-//CodeWarrior or Win32 compiler?
-#if defined(__CWCC__) || defined(_WIN32)
-   #pragma pack(push, 1)
+//Memory budget shared by all the datagrams being reassembled
+#ifndef IPV6_FRAG_MEM_BUDGET
+   #define IPV6_FRAG_MEM_BUDGET (2 * IPV6_MAX_FRAG_DATAGRAM_SIZE)
+#elif (IPV6_FRAG_MEM_BUDGET < 1280)
+   #error IPV6_FRAG_MEM_BUDGET parameter is not valid
 #endif
 
+//Datagrams that received no fragment for this time can be evicted
+#ifndef IPV6_FRAG_IDLE_TIME
+   #define IPV6_FRAG_IDLE_TIME 5000
+#elif (IPV6_FRAG_IDLE_TIME < 100)
+   #error IPV6_FRAG_IDLE_TIME parameter is not valid
+#endif
 
-/**
- * @brief Hole descriptor
- **/
-
-typedef __start_packed struct
-{
-   uint16_t first;
-   uint16_t last;
-   uint16_t next;
-} __end_packed Ipv6HoleDesc;
-
+//Size of the bitmap of received 8-byte blocks, in 32-bit words
+#define IPV6_FRAG_BLOCK_MAP_SIZE ((IPV6_MAX_FRAG_DATAGRAM_SIZE + 255) / 256)
 
-//CodeWarrior or Win32 compiler?
-#if defined(__CWCC__) || defined(_WIN32)
-   #pragma pack(pop)
+//C++ guard
+#ifdef __cplusplus
+   extern "C" {
 #endif
 
 
@@ -130,11 +127,28 @@ typedef struct
    uint32_t identification;     ///<Fragment identification field
    size_t unfragPartLength;     ///<Length of the unfragmentable part
    size_t fragPartLength;       ///<Length of the fragmentable part
-   uint16_t firstHole;          ///<Index of the first hole
+   systime_t lastUpdate;        ///<Time at which the last fragment was received
+   bool_t lastFragReceived;     ///<The fragment with M flag cleared has been received
+   uint_t receivedBlocks;       ///<Number of 8-byte blocks received
+   uint32_t blockMap[IPV6_FRAG_BLOCK_MAP_SIZE]; ///<Bitmap of received 8-byte blocks
    Ipv6ReassemblyBuffer buffer; ///<Buffer containing the reassembled datagram
 } Ipv6FragDesc;
 
 
+/**
+ * @brief Reassembly statistics
+ **/
+
+typedef struct
+{
+   uint32_t timeouts;   ///<Datagrams dropped because the reassembly timer ran out
+   uint32_t evictions;  ///<Datagrams dropped to make room for newer ones
+   uint32_t duplicates; ///<Fragments carrying no new data
+   size_t memUsage;     ///<Memory currently held by the reassembly queue
+   size_t maxMemUsage;  ///<Maximum memory held by the reassembly queue so far
+} Ipv6FragStats;
+
+
 //Tick counter to handle periodic operations
 extern systime_t ipv6FragTickCounter;
 
@@ -152,9 +166,13 @@ Ipv6FragDesc *ipv6SearchFragQueue(NetInterface *interface,
    Ipv6Header *packet, Ipv6FragmentHeader *header);
 
 void ipv6FlushFragQueue(NetInterface *interface);
+void ipv6ReleaseFragDesc(Ipv6FragDesc *frag);
+bool_t ipv6EvictFragDesc(NetInterface *interface, Ipv6FragDesc *current);
+size_t ipv6GetFragMemUsage(NetInterface *interface);
+error_t ipv6GetFragStats(NetInterface *interface, Ipv6FragStats *stats);
 
-Ipv6HoleDesc *ipv6FindHole(Ipv6FragDesc *frag, uint16_t offset);
-void ipv6DumpHoleList(Ipv6FragDesc *frag);
+uint_t ipv6MarkFragBlocks(Ipv6FragDesc *frag, uint_t first, uint_t last);
+void ipv6DumpFragBlocks(Ipv6FragDesc *frag);
 
 //C++ guard
 #ifdef __cplusplus
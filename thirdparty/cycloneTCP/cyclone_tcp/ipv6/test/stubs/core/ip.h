@@ -0,0 +1,6 @@
+#ifndef _IP_H
+#define _IP_H
+
+NetBuffer *ipAllocBuffer(size_t length, size_t *offset);
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef _NET_H
+#define _NET_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+typedef unsigned int uint_t;
+typedef int bool_t;
+
+#define TRUE 1
+#define FALSE 0
+#define ENABLED 1
+#define DISABLED 0
+
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+#define arraysize(a) (sizeof(a) / sizeof(a[0]))
+#define PRIuSIZE "zu"
+
+#define htons(value) __builtin_bswap16(value)
+#define ntohs(value) __builtin_bswap16(value)
+
+#define __start_packed
+#define __end_packed __attribute__((packed))
+
+#define IPV4_SUPPORT DISABLED
+#define IPV6_SUPPORT ENABLED
+
+#include "os_port.h"
+#include "core/net_mem.h"
+
+typedef struct _NetInterface NetInterface;
+
+extern OsMutex netMutex;
+
+#include "ipv6/ipv6.h"
+
+struct _NetInterface
+{
+   uint_t index;
+   Ipv6Context ipv6Context;
+};
+
+#endif
@@ -0,0 +1,12 @@
+#ifndef _ICMPV6_H
+#define _ICMPV6_H
+
+#define ICMPV6_TYPE_TIME_EXCEEDED 3
+#define ICMPV6_TYPE_PARAM_PROBLEM 4
+#define ICMPV6_CODE_REASSEMBLY_TIME_EXCEEDED 1
+#define ICMPV6_CODE_INVALID_HEADER_FIELD 0
+
+error_t icmpv6SendErrorMessage(NetInterface *interface, uint8_t type, uint8_t code,
+   uint32_t parameter, const NetBuffer *ipPacket, size_t ipPacketOffset);
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef _IPV6_H
+#define _IPV6_H
+
+typedef struct
+{
+   uint8_t b[16];
+} Ipv6Addr;
+
+typedef __start_packed struct
+{
+   uint32_t vtf;
+   uint16_t payloadLen;
+   uint8_t nextHeader;
+   uint8_t hopLimit;
+   Ipv6Addr srcAddr;
+   Ipv6Addr destAddr;
+} __end_packed Ipv6Header;
+
+typedef __start_packed struct
+{
+   uint8_t nextHeader;
+   uint8_t reserved;
+   uint16_t fragmentOffset;
+   uint32_t identification;
+} __end_packed Ipv6FragmentHeader;
+
+typedef struct
+{
+   int unused;
+} Ipv6PseudoHeader;
+
+#define IPV6_DEFAULT_MTU 1280
+#define IPV6_OFFSET_MASK 0xFFF8
+#define IPV6_FLAG_M 0x0001
+
+#define ipv6CompAddr(ipAddr1, ipAddr2) (!memcmp(ipAddr1, ipAddr2, sizeof(Ipv6Addr)))
+#define ipv6DumpHeader(header)
+
+#include "ipv6/ipv6_frag.h"
+
+typedef struct
+{
+   uint32_t identification;
+   Ipv6FragDesc fragQueue[IPV6_MAX_FRAG_DATAGRAMS];
+   Ipv6FragStats fragStats;
+} Ipv6Context;
+
+//Called with each reassembled datagram
+void ipv6ProcessPacket(NetInterface *interface, NetBuffer *buffer, size_t offset);
+
+error_t ipv6SendPacket(NetInterface *interface, Ipv6PseudoHeader *pseudoHeader,
+   uint32_t fragId, size_t fragOffset, NetBuffer *buffer, size_t offset,
+   uint_t flags);
+
+#endif
@@ -0,0 +1,6 @@
+#ifndef _IP_MIB_MODULE_H
+#define _IP_MIB_MODULE_H
+
+#define IP_MIB_INC_COUNTER32(name, value)
+
+#endif
@@ -0,0 +1,12 @@
+#ifndef _NET_CONFIG_H
+#define _NET_CONFIG_H
+
+#define NET_MEM_POOL_SUPPORT ENABLED
+#define NET_MEM_POOL_BUFFER_SIZE 1536
+#define NET_MEM_POOL_BUFFER_COUNT 8
+#define NET_MEM_POOL_SMALL_BUFFER_SIZE 256
+#define NET_MEM_POOL_SMALL_BUFFER_COUNT 8
+#define NET_MEM_POOL_MEDIUM_BUFFER_SIZE 512
+#define NET_MEM_POOL_MEDIUM_BUFFER_COUNT 4
+
+#endif
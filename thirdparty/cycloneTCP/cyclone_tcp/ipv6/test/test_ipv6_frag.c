@@ -0,0 +1,435 @@
+/**
+ * @file test_ipv6_frag.c
+ * @brief Host test and benchmark of the IPv6 fragment reassembly
+ *
+ * Datagrams of 1.3 to 4 KB are cut into fragments of random sizes, shuffled,
+ * partly duplicated and optionally lost, then fed to ipv6ParseFragmentHeader()
+ * with the real memory pool. Every datagram delivered to ipv6ProcessPacket()
+ * is checked against the one sent. A run of random fragments (offsets,
+ * lengths and M flags) checks that the queue never leaks pool buffers.
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../ipv6_frag.c"
+#undef TRACE_LEVEL
+#include "../../core/net_mem.c"
+
+//Datagrams sent at once, at most
+#define MAX_DATAGRAMS 6
+//Largest datagram sent
+#define MAX_DATAGRAM_SIZE 4096
+
+static int failures;
+
+#define CHECK(cond) do { \
+      if(!(cond)) { \
+         printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+         failures++; \
+      } \
+   } while(0)
+
+systime_t simTime;
+OsMutex netMutex;
+
+//Datagrams in flight
+static struct
+{
+   uint32_t id;
+   size_t length;
+   uint8_t data[MAX_DATAGRAM_SIZE];
+   bool_t delivered;
+} datagrams[MAX_DATAGRAMS];
+
+static uint_t datagramCount;
+static long delivered;
+static long repeated;
+static long corrupted;
+static long timeExceeded;
+
+//Fragment to send
+typedef struct
+{
+   uint_t datagram;
+   uint16_t offset;
+   uint16_t length;
+   bool_t more;
+} Fragment;
+
+static Fragment fragments[MAX_DATAGRAMS * 2 * (MAX_DATAGRAM_SIZE / 8)];
+
+NetBuffer *ipAllocBuffer(size_t length, size_t *offset)
+{
+   *offset = 0;
+   return netBufferAlloc(length);
+}
+
+error_t ipv6SendPacket(NetInterface *interface, Ipv6PseudoHeader *pseudoHeader,
+   uint32_t fragId, size_t fragOffset, NetBuffer *buffer, size_t offset,
+   uint_t flags)
+{
+   return NO_ERROR;
+}
+
+error_t icmpv6SendErrorMessage(NetInterface *interface, uint8_t type, uint8_t code,
+   uint32_t parameter, const NetBuffer *ipPacket, size_t ipPacketOffset)
+{
+   if(type == ICMPV6_TYPE_TIME_EXCEEDED)
+      timeExceeded++;
+
+   return NO_ERROR;
+}
+
+void ipv6ProcessPacket(NetInterface *interface, NetBuffer *buffer, size_t offset)
+{
+   static uint8_t packet[sizeof(Ipv6Header) + IPV6_MAX_FRAG_DATAGRAM_SIZE];
+   size_t length = netBufferGetLength(buffer);
+   uint32_t id;
+   uint_t i;
+
+   CHECK(length <= sizeof(packet));
+   if(length > sizeof(packet))
+   {
+      corrupted++;
+      return;
+   }
+
+   netBufferRead(packet, buffer, 0, length);
+   memcpy(&id, ((Ipv6Header *) packet)->srcAddr.b, sizeof(id));
+
+   for(i = 0; i < datagramCount; i++)
+   {
+      if(datagrams[i].id == id)
+      {
+         if(length - sizeof(Ipv6Header) != datagrams[i].length ||
+            memcmp(packet + sizeof(Ipv6Header), datagrams[i].data, datagrams[i].length))
+         {
+            corrupted++;
+         }
+         else if(datagrams[i].delivered)
+         {
+            //Late duplicates of every fragment make a new datagram
+            repeated++;
+         }
+         else
+         {
+            datagrams[i].delivered = TRUE;
+            delivered++;
+         }
+
+         return;
+      }
+   }
+
+   //Not a datagram sent
+   corrupted++;
+}
+
+static void sendFragment(NetInterface *interface, uint32_t id, const uint8_t *data,
+   uint16_t offset, uint16_t length, bool_t more)
+{
+   static uint8_t packet[sizeof(Ipv6Header) + sizeof(Ipv6FragmentHeader) + 1280];
+   Ipv6Header *header = (Ipv6Header *) packet;
+   Ipv6FragmentHeader *fragHeader = (Ipv6FragmentHeader *) (packet + sizeof(Ipv6Header));
+   NetBuffer1 buffer;
+
+   memset(packet, 0, sizeof(Ipv6Header) + sizeof(Ipv6FragmentHeader));
+   //Source address tells the datagram apart
+   header->nextHeader = 44;
+   memcpy(header->srcAddr.b, &id, sizeof(id));
+   header->payloadLen = htons(sizeof(Ipv6FragmentHeader) + length);
+   fragHeader->nextHeader = 17;
+   fragHeader->fragmentOffset = htons(offset | (more ? IPV6_FLAG_M : 0));
+   fragHeader->identification = id;
+   memcpy(packet + sizeof(Ipv6Header) + sizeof(Ipv6FragmentHeader), data, length);
+
+   buffer.chunkCount = 1;
+   buffer.maxChunkCount = 1;
+   buffer.chunk[0].address = packet;
+   buffer.chunk[0].length = sizeof(Ipv6Header) + sizeof(Ipv6FragmentHeader) + length;
+   buffer.chunk[0].size = 0;
+
+   ipv6ParseFragmentHeader(interface, (NetBuffer *) &buffer, 0, sizeof(Ipv6Header), 6);
+}
+
+static void makeDatagram(uint_t d, uint32_t id, size_t length)
+{
+   size_t i;
+
+   datagrams[d].id = id;
+   datagrams[d].length = length;
+   datagrams[d].delivered = FALSE;
+
+   for(i = 0; i < length; i++)
+      datagrams[d].data[i] = (uint8_t) rand();
+}
+
+static uint_t poolBuffersInUse(void)
+{
+   uint_t currentUsage;
+
+   memPoolGetStats(&currentUsage, NULL, NULL);
+   return currentUsage;
+}
+
+static void reset(NetInterface *interface)
+{
+   memset(interface, 0, sizeof(*interface));
+   delivered = 0;
+   repeated = 0;
+   corrupted = 0;
+   timeExceeded = 0;
+   srand(1);
+}
+
+/**
+ * @brief Sends rounds of concurrent datagrams, fragments shuffled
+ * @return Time spent in reassembly per fragment (ns)
+ **/
+
+static double runRounds(NetInterface *interface, uint_t rounds, uint_t concurrent,
+   uint_t duplicatePct, uint_t lossPct)
+{
+   static uint32_t nextId = 1;
+   struct timespec t0;
+   struct timespec t1;
+   double busy = 0;
+   long fragmentTotal = 0;
+   uint_t round;
+   uint_t d;
+   uint_t n;
+   uint_t i;
+   uint_t j;
+   size_t offset;
+   size_t length;
+   Fragment temp;
+
+   datagramCount = concurrent;
+
+   for(round = 0; round < rounds; round++)
+   {
+      n = 0;
+
+      for(d = 0; d < concurrent; d++)
+      {
+         makeDatagram(d, nextId++, 1281 + rand() % (MAX_DATAGRAM_SIZE - 1281));
+
+         //Fragments of 8 to 1232 bytes, all but the last one a multiple of 8
+         for(offset = 0; offset < datagrams[d].length; offset += length)
+         {
+            length = 8 + (rand() % 154) * 8;
+            if(offset + length >= datagrams[d].length)
+               length = datagrams[d].length - offset;
+
+            fragments[n].datagram = d;
+            fragments[n].offset = (uint16_t) offset;
+            fragments[n].length = (uint16_t) length;
+            fragments[n].more = (offset + length < datagrams[d].length);
+            n++;
+
+            if((uint_t) (rand() % 100) < duplicatePct)
+            {
+               fragments[n] = fragments[n - 1];
+               n++;
+            }
+         }
+      }
+
+      for(i = n - 1; i > 0; i--)
+      {
+         j = rand() % (i + 1);
+         temp = fragments[i];
+         fragments[i] = fragments[j];
+         fragments[j] = temp;
+      }
+
+      clock_gettime(CLOCK_MONOTONIC, &t0);
+
+      for(i = 0; i < n; i++)
+      {
+         simTime++;
+         if((uint_t) (rand() % 100) >= lossPct)
+         {
+            d = fragments[i].datagram;
+            sendFragment(interface, datagrams[d].id, datagrams[d].data + fragments[i].offset,
+               fragments[i].offset, fragments[i].length, fragments[i].more);
+         }
+
+         if((simTime % IPV6_FRAG_TICK_INTERVAL) == 0)
+            ipv6FragTick(interface);
+      }
+
+      clock_gettime(CLOCK_MONOTONIC, &t1);
+      busy += (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+      fragmentTotal += n;
+
+      //Pause between rounds, longer than the reassembly timeout
+      simTime += IPV6_FRAG_TIME_TO_LIVE + IPV6_FRAG_TICK_INTERVAL;
+      ipv6FragTick(interface);
+   }
+
+   return busy * 1e9 / fragmentTotal;
+}
+
+//As many datagrams as the queue holds, shuffled and duplicated: all delivered
+static void testOutOfOrder(NetInterface *interface)
+{
+   Ipv6FragStats stats;
+   double nsPerFragment;
+
+   reset(interface);
+   nsPerFragment = runRounds(interface, 2000, IPV6_MAX_FRAG_DATAGRAMS, 10, 0);
+
+   ipv6GetFragStats(interface, &stats);
+   CHECK(corrupted == 0);
+   CHECK(delivered >= 2000 * IPV6_MAX_FRAG_DATAGRAMS * 95 / 100);
+   CHECK(stats.duplicates > 0);
+   CHECK(stats.maxMemUsage <= IPV6_FRAG_MEM_BUDGET);
+   CHECK(stats.memUsage == 0);
+   CHECK(poolBuffersInUse() == 0);
+
+   printf("out of order: %ld/%u delivered (%ld again), %u duplicates, %.0f ns/fragment\n",
+      delivered, 2000 * IPV6_MAX_FRAG_DATAGRAMS, repeated, stats.duplicates, nsPerFragment);
+}
+
+//More datagrams than the queue holds: no mix-up, memory stays in the budget
+static void testOverload(NetInterface *interface)
+{
+   Ipv6FragStats stats;
+
+   reset(interface);
+   runRounds(interface, 2000, MAX_DATAGRAMS, 20, 0);
+
+   ipv6GetFragStats(interface, &stats);
+   CHECK(corrupted == 0);
+   CHECK(delivered >= 2000 * MAX_DATAGRAMS / 2);
+   CHECK(stats.maxMemUsage <= IPV6_FRAG_MEM_BUDGET);
+
+   ipv6FlushFragQueue(interface);
+   CHECK(poolBuffersInUse() == 0);
+
+   printf("overload: %ld/%u delivered\n", delivered, 2000 * MAX_DATAGRAMS);
+}
+
+//Lost fragments: incomplete datagrams give way once idle
+static void testLoss(NetInterface *interface)
+{
+   Ipv6FragStats stats;
+
+   reset(interface);
+   runRounds(interface, 2000, 3, 10, 3);
+
+   ipv6GetFragStats(interface, &stats);
+   CHECK(corrupted == 0);
+   CHECK(delivered > 0);
+   CHECK(stats.timeouts + stats.evictions > 0);
+   //Only datagrams whose first fragment came are reported to the source
+   CHECK(timeExceeded <= (long) stats.timeouts);
+   CHECK(stats.maxMemUsage <= IPV6_FRAG_MEM_BUDGET);
+
+   ipv6FlushFragQueue(interface);
+   CHECK(poolBuffersInUse() == 0);
+
+   printf("3%% loss: %ld/%u delivered, %u timeouts, %u evictions\n",
+      delivered, 2000 * 3, stats.timeouts, stats.evictions);
+}
+
+//Queue full of stalled datagrams: they are evicted once idle, not before
+static void testIdleEviction(NetInterface *interface)
+{
+   Ipv6FragStats stats;
+   uint_t d;
+
+   reset(interface);
+   datagramCount = IPV6_MAX_FRAG_DATAGRAMS + 1;
+
+   for(d = 0; d < datagramCount; d++)
+      makeDatagram(d, 100 + d, 2000);
+
+   //First fragment only
+   for(d = 0; d < IPV6_MAX_FRAG_DATAGRAMS; d++)
+      sendFragment(interface, datagrams[d].id, datagrams[d].data, 0, 1232, TRUE);
+
+   //Still active: the new datagram is dropped
+   d = IPV6_MAX_FRAG_DATAGRAMS;
+   simTime += IPV6_FRAG_IDLE_TIME / 2;
+   sendFragment(interface, datagrams[d].id, datagrams[d].data, 0, 1232, TRUE);
+   sendFragment(interface, datagrams[d].id, datagrams[d].data + 1232, 1232, 2000 - 1232, FALSE);
+   ipv6GetFragStats(interface, &stats);
+   CHECK(stats.evictions == 0);
+   CHECK(delivered == 0);
+
+   //Idle: the new datagram takes the place of the oldest one
+   simTime += IPV6_FRAG_IDLE_TIME;
+   sendFragment(interface, datagrams[d].id, datagrams[d].data, 0, 1232, TRUE);
+   sendFragment(interface, datagrams[d].id, datagrams[d].data + 1232, 1232, 2000 - 1232, FALSE);
+   ipv6GetFragStats(interface, &stats);
+   CHECK(stats.evictions == 1);
+   CHECK(delivered == 1);
+   CHECK(datagrams[d].delivered);
+   CHECK(corrupted == 0);
+
+   ipv6FlushFragQueue(interface);
+   CHECK(poolBuffersInUse() == 0);
+}
+
+//Random fragments of 8 datagrams: nothing leaks
+static void testRandomFragments(NetInterface *interface)
+{
+   static uint8_t data[1280];
+   Ipv6FragStats stats;
+   uint32_t id;
+   uint16_t offset;
+   uint16_t length;
+   long i;
+
+   reset(interface);
+   datagramCount = 0;
+
+   for(i = 0; i < 300000; i++)
+   {
+      id = rand() % 8;
+      length = rand() % 1281;
+      if(rand() % 2)
+         length &= ~7;
+      offset = (rand() % 1100) * 8;
+
+      simTime += rand() % 50;
+      sendFragment(interface, id, data, offset, length, (rand() % 3) != 0);
+
+      if((i % 1000) == 0)
+         ipv6FragTick(interface);
+
+      ipv6GetFragStats(interface, &stats);
+      CHECK(stats.memUsage <= IPV6_FRAG_MEM_BUDGET);
+   }
+
+   ipv6FlushFragQueue(interface);
+   ipv6GetFragStats(interface, &stats);
+   CHECK(stats.memUsage == 0);
+   CHECK(poolBuffersInUse() == 0);
+}
+
+int main(void)
+{
+   static NetInterface interface;
+
+   memPoolInit();
+
+   testOutOfOrder(&interface);
+   testOverload(&interface);
+   testLoss(&interface);
+   testIdleEviction(&interface);
+   testRandomFragments(&interface);
+
+   if(failures)
+   {
+      printf("%d failure(s)\n", failures);
+      return 1;
+   }
+
+   printf("OK\n");
+   return 0;
+}
@@ -130,6 +130,9 @@
 #define IPV6_MAX_FRAG_DATAGRAMS 4
 /* Maximum datagram size the host will accept when reassembling fragments */
 #define IPV6_MAX_FRAG_DATAGRAM_SIZE 8192
+/* Memory the reassembly queue may hold, one full buffer is always left */
+/* for the rest of the stack */
+#define IPV6_FRAG_MEM_BUDGET ((NET_MEM_POOL_BUFFER_COUNT - 1) * NET_MEM_POOL_BUFFER_SIZE)
 
 /* MLD support */
 #define MLD_SUPPORT DISABLED
@@ -194,6 +197,24 @@
 
 #define NET_MEM_POOL_BUFFER_COUNT   CONF_NET_MEM_POOL_BUFFER_COUNT
 
+/* Small buffers for short PLC packets (ICMPv6, UDP acks, socket queue items) */
+#define NET_MEM_POOL_SMALL_BUFFER_SIZE 256
+
+#ifndef CONF_NET_MEM_POOL_SMALL_BUFFER_COUNT
+  #define CONF_NET_MEM_POOL_SMALL_BUFFER_COUNT   8
+#endif
+
+#define NET_MEM_POOL_SMALL_BUFFER_COUNT   CONF_NET_MEM_POOL_SMALL_BUFFER_COUNT
+
+/* Medium buffers for DLMS requests and responses */
+#define NET_MEM_POOL_MEDIUM_BUFFER_SIZE 512
+
+#ifndef CONF_NET_MEM_POOL_MEDIUM_BUFFER_COUNT
+  #define CONF_NET_MEM_POOL_MEDIUM_BUFFER_COUNT   4
+#endif
+
+#define NET_MEM_POOL_MEDIUM_BUFFER_COUNT   CONF_NET_MEM_POOL_MEDIUM_BUFFER_COUNT
+
 /* Enable Static Memory Pool for PLC application */
 #define NET_MEM_POOL_SUPPORT  ENABLED
 
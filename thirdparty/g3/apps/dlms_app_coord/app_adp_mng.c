@@ -195,6 +195,9 @@ static void SetConfirm(uint8_t u8Status, uint32_t u32AttributeId, uint16_t u16At
 
 static void AppAdpDataConfirm(struct TAdpDataConfirm *pDataConfirm)
 {
+	/* Release the SDU held by the network adapter */
+	ipv6_send_confirm(pDataConfirm);
+
 	UNUSED(pDataConfirm);
 }
 
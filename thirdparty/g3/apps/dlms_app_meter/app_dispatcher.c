@@ -166,6 +166,10 @@ void dispatcher_timers_update(void)
 	if (HDLC_iframe_tout) {
 		HDLC_iframe_tout--;
 	}
+
+#ifdef DLMS_MGMT
+	hdlc_TimersUpdate();
+#endif /* DLMS_MGMT */
 }
 
 /**
@@ -176,6 +180,12 @@ static void transparent_dlms_to_serial(void)
 {
 	/* If there is something to tx in dlms buffer, copy to serial buffer*/
 	if (app_ptr_tx_dlms_msg->todo == 1) {
+		if (app_ptr_tx_dlms_msg->length > SERIAL_BUF_SIZE) {
+			/* Not sent through HDLC: it has to fit in a serial message */
+			app_ptr_tx_dlms_msg->todo = 0;
+			return;
+		}
+
 		memcpy(app_tx_serial.msg[app_tx_serial.ptr_wr].buf, app_ptr_tx_dlms_msg->buf, app_ptr_tx_dlms_msg->length);
 		app_tx_serial.msg[app_tx_serial.ptr_wr].length = app_ptr_tx_dlms_msg->length;
 		app_tx_serial.msg[app_tx_serial.ptr_wr].todo = 1;
@@ -190,12 +200,13 @@ static void transparent_dlms_to_serial(void)
 #ifdef DLMS_MGMT
 void hdlc_dlms_to_serial(void)
 {
-	hdlc_TxProcess(&app_tx_serial.msg[app_tx_serial.ptr_wr], app_ptr_tx_dlms_msg);
-	if (++app_tx_serial.ptr_wr == MSG_BUF_SIZE) {
-		app_tx_serial.ptr_wr = 0;
+	/* Long APDUs are sent as several HDLC segments, as many as the window */
+	/* allows. HDLC clears todo once they are all acknowledged */
+	while (hdlc_TxProcess(&app_tx_serial.msg[app_tx_serial.ptr_wr], app_ptr_tx_dlms_msg)) {
+		if (++app_tx_serial.ptr_wr == MSG_BUF_SIZE) {
+			app_tx_serial.ptr_wr = 0;
+		}
 	}
-
-	app_ptr_tx_dlms_msg->todo = 0;
 }
 
 #endif /* DLMS_MGMT */
@@ -217,19 +228,28 @@ void dispatcher_app_process(void)
 #endif
 #ifdef DLMS_MGMT
 		if (app_rx_serial.msg[app_rx_serial.ptr_rd].buf[0] == HDLC_START_END_FLAG) {
-			/* HDLC RESPONSE */
-			hdlc_RxProcess(app_ptr_rx_dlms_msg, &app_rx_serial.msg[app_rx_serial.ptr_rd]);
-			if (app_ptr_rx_dlms_msg->todo == 1) {
-				/* Pass the data to DLMS Server (DLMS over HDLC comes without wrapper) */
-				/* #ifdef DLMS_DEBUG_CONSOLE */
-				/*        LogBuffer(app_ptr_rx_dlms_msg->buf, app_ptr_rx_dlms_msg->length, "\r\n*** dlms_srv_data_ind(): "); */
-				/*        printf("\r\n"); */
-				/* #endif */
-				/* ToDo: Extract addresses from HDLC */
-				dlms_srv_data_ind(DLMS_MGMT_DST_PORT /* us_dst_wport */, DLMS_MGMT_SRC_PORT /* us_src_wport */, app_ptr_rx_dlms_msg->buf, app_ptr_rx_dlms_msg->length);
-				app_ptr_rx_dlms_msg->todo = 0;
-				dlms_srv_process();
-			}
+			/* HDLC RESPONSE (several APDUs may come in the same serial message) */
+			do {
+				hdlc_RxProcess(app_ptr_rx_dlms_msg, &app_rx_serial.msg[app_rx_serial.ptr_rd]);
+				/* Acknowledge received I-frames, if needed */
+				if (hdlc_AckProcess(&app_tx_serial.msg[app_tx_serial.ptr_wr])) {
+					if (++app_tx_serial.ptr_wr == MSG_BUF_SIZE) {
+						app_tx_serial.ptr_wr = 0;
+					}
+				}
+
+				if (app_ptr_rx_dlms_msg->todo == 1) {
+					/* Pass the data to DLMS Server (DLMS over HDLC comes without wrapper) */
+					/* #ifdef DLMS_DEBUG_CONSOLE */
+					/*        LogBuffer(app_ptr_rx_dlms_msg->buf, app_ptr_rx_dlms_msg->length, "\r\n*** dlms_srv_data_ind(): "); */
+					/*        printf("\r\n"); */
+					/* #endif */
+					/* ToDo: Extract addresses from HDLC */
+					dlms_srv_data_ind(DLMS_MGMT_DST_PORT /* us_dst_wport */, DLMS_MGMT_SRC_PORT /* us_src_wport */, app_ptr_rx_dlms_msg->buf, app_ptr_rx_dlms_msg->length);
+					app_ptr_rx_dlms_msg->todo = 0;
+					dlms_srv_process();
+				}
+			} while (app_rx_serial.msg[app_rx_serial.ptr_rd].todo == 1);
 		}
 #endif /* #ifdef DLMS_MGMT */
 
@@ -261,6 +281,13 @@ void dispatcher_app_process(void)
 		/* If there is something to tx, it is dlms wrapper, not mgmt. Copy to serial buffer to tx */
 		transparent_dlms_to_serial();
 	}
+
+	/* Run again for pending serial messages: RX now, TX after the interframe timeout */
+	if (app_rx_serial.ptr_rd != app_rx_serial.ptr_wr) {
+		oss_notify(OSS_EVENT_USER);
+	} else if (app_tx_serial.ptr_rd != app_tx_serial.ptr_wr) {
+		oss_notify_after(OSS_EVENT_TIMER, HDLC_iframe_tout);
+	}
 }
 
 /**
@@ -284,6 +311,9 @@ void dispatcher_app_init(void)
 	app_ptr_tx_dlms_msg = &app_tx_dlms_msg;
 	app_rx_dlms_msg.todo = 0;
 	app_tx_dlms_msg.todo = 0;
+#ifdef DLMS_MGMT
+	hdlc_init();
+#endif /* DLMS_MGMT */
 
 	/* Get MAC / Meter-id */
 	platform_init_eui64(g_auc_ext_address);
@@ -56,6 +56,11 @@
 #define DLMS_MGMT_SRC_PORT 0xFF00
 #define DLMS_MGMT_DST_PORT 0x0000
 
+/* Event-driven OSS: wake events of the dispatcher and maximum time (ms) */
+/* between runs, to process the DLMS server */
+#define DISPATCHER_WAKE_EVENTS  (OSS_EVENT_USI_RX | OSS_EVENT_TIMER | OSS_EVENT_USER)
+#define DISPATCHER_POLL_PERIOD  10
+
 uint8_t *dispatcher_get_tx_buff(void);
 uint8_t *dispatcher_get_rx_buff(void);
 
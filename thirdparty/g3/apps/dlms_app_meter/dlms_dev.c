@@ -89,6 +89,12 @@ static void _dlms_app_data_request(uint16_t us_dst_wport, uint16_t us_src_wport,
 {
 	bool success;
 
+	/* Room for the 8-byte wrapper header */
+	if (us_buff_len > DLMS_BUF_SIZE - 8) {
+		dlms_srv_data_cfm(us_dst_wport, us_src_wport, false);
+		return;
+	}
+
 	if ((us_dst_wport == DLMS_MGMT_SRC_PORT) && (us_src_wport == DLMS_MGMT_DST_PORT)) {
 		/* Sent over HDLC: NO wrapper required */
 		memcpy(app_ptr_tx_dlms_msg->buf, puc_buff, us_buff_len);
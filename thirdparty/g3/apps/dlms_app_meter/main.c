@@ -89,6 +89,8 @@ int main( void )
 	x_task.task_init = dispatcher_app_init;
 	x_task.task_process = dispatcher_app_process;
 	x_task.task_1ms_timer_cb = dispatcher_timers_update;
+	x_task.ul_wake_events = DISPATCHER_WAKE_EVENTS;
+	x_task.ul_poll_period = DISPATCHER_POLL_PERIOD;
 	oss_register_task(&x_task);
 
 #ifdef BOARD_SUPPORTS_METERING
@@ -96,6 +98,8 @@ int main( void )
 	x_task.task_init = metering_app_init;
 	x_task.task_process = metering_app_process;
 	x_task.task_1ms_timer_cb = metering_app_timers_update;
+	x_task.ul_wake_events = 0;
+	x_task.ul_poll_period = 0;
 	oss_register_task(&x_task);
 #endif /* BOARD_SUPPORTS_METERING */
 
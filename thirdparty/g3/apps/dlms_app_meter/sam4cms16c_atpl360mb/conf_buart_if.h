@@ -60,4 +60,8 @@
 #define RX_UART_BUF1_SIZE       1024
 #define TX_UART_BUF1_SIZE       1024
 
+/** RX hook: wake the app processes as soon as serial data is received */
+#include "oss_if.h"
+#define BUART_RX_NOTIFY()       oss_notify_from_isr(OSS_EVENT_USI_RX)
+
 #endif  /* CONF_BUART_IF_H_INCLUDED */
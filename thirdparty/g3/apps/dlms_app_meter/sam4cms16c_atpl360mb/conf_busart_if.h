@@ -47,4 +47,8 @@
 #ifndef CONF_BUSART_IF_H_INCLUDED
 #define CONF_BUSART_IF_H_INCLUDED
 
+/** RX hook: wake the app processes as soon as serial data is received */
+#include "oss_if.h"
+#define BUSART_RX_NOTIFY()       oss_notify_from_isr(OSS_EVENT_USI_RX)
+
 #endif  /* CONF_BUSART_IF_H_INCLUDED */
@@ -60,4 +60,8 @@
 #define BUSART0_Handler          FLEXCOM4_Handler
 #define RX_BUSART0_SIZE          1024
 #define TX_BUSART0_SIZE          1024
+/** RX hook: wake the app processes as soon as serial data is received */
+#include "oss_if.h"
+#define BUSART_RX_NOTIFY()       oss_notify_from_isr(OSS_EVENT_USI_RX)
+
 #endif  /* CONF_BUSART_IF_H_INCLUDED */
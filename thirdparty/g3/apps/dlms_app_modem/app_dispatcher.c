@@ -302,6 +302,10 @@ void dispatcher_timers_update(void)
 	if (HDLC_iframe_tout) {
 		HDLC_iframe_tout--;
 	}
+
+#ifdef DLMS_MGMT
+	hdlc_TimersUpdate();
+#endif /* DLMS_MGMT */
 }
 
 #if defined(SIMPLE_MGMT)
@@ -314,6 +318,12 @@ static void transparent_dlms_to_serial(void)
 {
 	/* If there is something to tx in dlms buffer, copy to serial buffer*/
 	if (app_ptr_tx_dlms_msg->todo == 1) {
+		if (app_ptr_tx_dlms_msg->length > SERIAL_BUF_SIZE) {
+			/* Not sent through HDLC: it has to fit in a serial message */
+			app_ptr_tx_dlms_msg->todo = 0;
+			return;
+		}
+
 		memcpy(app_tx_serial.msg[app_tx_serial.ptr_wr].buf, app_ptr_tx_dlms_msg->buf, app_ptr_tx_dlms_msg->length);
 		app_tx_serial.msg[app_tx_serial.ptr_wr].length = app_ptr_tx_dlms_msg->length;
 		app_tx_serial.msg[app_tx_serial.ptr_wr].todo = 1;
@@ -330,12 +340,13 @@ static void transparent_dlms_to_serial(void)
 #ifdef DLMS_MGMT
 void hdlc_dlms_to_serial(void)
 {
-	hdlc_TxProcess(&app_tx_serial.msg[app_tx_serial.ptr_wr], app_ptr_tx_dlms_msg);
-	if (++app_tx_serial.ptr_wr == MSG_BUF_SIZE) {
-		app_tx_serial.ptr_wr = 0;
+	/* Long APDUs are sent as several HDLC segments, as many as the window */
+	/* allows. HDLC clears todo once they are all acknowledged */
+	while (hdlc_TxProcess(&app_tx_serial.msg[app_tx_serial.ptr_wr], app_ptr_tx_dlms_msg)) {
+		if (++app_tx_serial.ptr_wr == MSG_BUF_SIZE) {
+			app_tx_serial.ptr_wr = 0;
+		}
 	}
-
-	app_ptr_tx_dlms_msg->todo = 0;
 }
 
 #endif /* DLMS_MGMT */
@@ -401,12 +412,21 @@ void dispatcher_app_process(void)
 #endif
 #ifdef DLMS_MGMT
 			if (app_rx_serial.msg[app_rx_serial.ptr_rd].buf[0] == HDLC_START_END_FLAG) {
-				/* HDLC RESPONSE */
-				hdlc_RxProcess(app_ptr_rx_dlms_msg, &app_rx_serial.msg[app_rx_serial.ptr_rd]);
-				if (app_ptr_rx_dlms_msg->todo == 1) {
-					dlms_mgmt_decode(app_ptr_rx_dlms_msg->buf, app_ptr_rx_dlms_msg->length);
-					app_ptr_rx_dlms_msg->todo = 0;
-				}
+				/* HDLC RESPONSE (several APDUs may come in the same serial message) */
+				do {
+					hdlc_RxProcess(app_ptr_rx_dlms_msg, &app_rx_serial.msg[app_rx_serial.ptr_rd]);
+					/* Acknowledge received I-frames, if needed */
+					if (hdlc_AckProcess(&app_tx_serial.msg[app_tx_serial.ptr_wr])) {
+						if (++app_tx_serial.ptr_wr == MSG_BUF_SIZE) {
+							app_tx_serial.ptr_wr = 0;
+						}
+					}
+
+					if (app_ptr_rx_dlms_msg->todo == 1) {
+						dlms_mgmt_decode(app_ptr_rx_dlms_msg->buf, app_ptr_rx_dlms_msg->length);
+						app_ptr_rx_dlms_msg->todo = 0;
+					}
+				} while (app_rx_serial.msg[app_rx_serial.ptr_rd].todo == 1);
 			} else {
 				/* MESSAGE DISCARD */
 				app_rx_serial.msg[app_rx_serial.ptr_rd].todo = 0;
@@ -458,6 +478,11 @@ void dispatcher_app_process(void)
 		}
 	}
 
+#ifdef DLMS_MGMT
+	/* Segments waiting for acknowledgement of previous ones, or to be sent again */
+	hdlc_dlms_to_serial();
+#endif /* #ifdef DLMS_MGMT */
+
 	if (ipv6_mng_ready()) {
 		if (b_is_dlms_socket_open && udp_socket_is_open(spx_dlms_socket)) {
 			/* Process IPv6 */
@@ -490,6 +515,13 @@ void dispatcher_app_init(void)
 	app_ptr_tx_dlms_msg = &app_tx_dlms_msg;
 	app_rx_dlms_msg.todo = 0;
 	app_tx_dlms_msg.todo = 0;
+#ifdef DLMS_MGMT
+	hdlc_init();
+#ifdef HDLC_CONNECT
+	/* Numbered mode if the meter answers SNRM, UI frames otherwise */
+	hdlc_Connect();
+#endif /* HDLC_CONNECT */
+#endif /* DLMS_MGMT */
 
 	g_bHasMeterId = false;
 	u32DelayMeterIdReq = 0;
@@ -11,6 +11,10 @@
 /* #define SIMPLE_MGMT */
 #define DLMS_MGMT
 
+/* Set up the HDLC link to the meter with SNRM/UA, for acknowledged and windowed */
+/* transfer. Meters that do not answer it are served with UI frames */
+/* #define HDLC_CONNECT */
+
 /* Generic G3 IPv6 local-link address */
 #define APP_IPV6_GENERIC_LINK_LOCAL_ADDR "fe80:0:0:0:781D:ff:fe00:0001"
 
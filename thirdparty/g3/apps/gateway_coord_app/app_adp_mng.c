@@ -154,6 +154,9 @@ static void SetConfirm(uint8_t u8Status, uint32_t u32AttributeId, uint16_t u16At
 
 static void AppAdpDataConfirm(struct TAdpDataConfirm *pDataConfirm)
 {
+	/* Release the SDU held by the network adapter */
+	ipv6_send_confirm(pDataConfirm);
+
 	UNUSED(pDataConfirm);
 #ifdef DLMS_REPORT
 	if (pDataConfirm->m_u8Status != G3_SUCCESS) {
@@ -265,6 +268,9 @@ static void AppAdpNetworkLeaveConfirm(struct TAdpNetworkLeaveConfirm *pLeaveConf
 static void AppAdpResetConfirm(struct TAdpResetConfirm *pResetConfirm)
 {
 	UNUSED(pResetConfirm);
+
+	/* ADP IB is back to defaults: drop adapter address caches */
+	g3_adapter_flush_addr_cache();
 }
 
 static void AppAdpSetConfirm(struct TAdpSetConfirm *pSetConfirm)
@@ -703,6 +709,9 @@ static void InitializeStack(void)
 #else
 	AdpInitialize(&notifications, ADP_BAND_CENELEC_A);
 #endif
+
+	/* ADP IB starts from defaults: drop adapter address caches */
+	g3_adapter_flush_addr_cache();
 }
 
 static void InitializeModemParameters(void)
@@ -39,8 +39,56 @@ struct TQueueElement {
   struct TQueueElement *m_pNext; // pointer to next element in the queue (private member)
   void *m_pUserData;    // pointer to user data
   uint8_t m_u8DataType; // information about data type (optional information if needed)
+  uint8_t m_u8Queued;   // element is in a queue (private member, set up by Queue_InitElement)
 };
 
+/**********************************************************************************************************************/
+/** Defines a FIFO queue with O(1) push and pop. Elements belong to at most one TQueue at a time.
+ ** Unlike Queue_Push/Queue_Pop, the root is not a queue element.
+ **********************************************************************************************************************/
+struct TQueue {
+  struct TQueueElement *m_pHead; // first element (private member)
+  struct TQueueElement *m_pTail; // last element (private member)
+  uint16_t m_u16Count;           // number of queued elements
+};
+
+/**********************************************************************************************************************/
+/** Initializes an empty queue
+ **********************************************************************************************************************/
+void Queue_Init(
+  struct TQueue *pQueue
+  );
+
+/**********************************************************************************************************************/
+/** Initializes an element that is not in any queue. Must be called once before the element is first pushed.
+ **********************************************************************************************************************/
+void Queue_InitElement(
+  struct TQueueElement *pQueueElement,
+  void *pUserData
+  );
+
+/**********************************************************************************************************************/
+/** Adds an element at the end of the queue. Returns false if the element is already queued.
+ **********************************************************************************************************************/
+bool Queue_PushTail(
+  struct TQueue *pQueue,
+  struct TQueueElement *pQueueElement
+  );
+
+/**********************************************************************************************************************/
+/** Removes the first element from the queue. If no element in the queue, returns NULL
+ **********************************************************************************************************************/
+struct TQueueElement *Queue_PopHead(
+  struct TQueue *pQueue
+  );
+
+/**********************************************************************************************************************/
+/** Returns true if the element is in a TQueue
+ **********************************************************************************************************************/
+bool Queue_IsQueued(
+  struct TQueueElement *pQueueElement
+  );
+
 #endif
 
 /**********************************************************************************************************************/
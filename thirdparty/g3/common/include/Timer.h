@@ -34,6 +34,12 @@ void Timer_ResetAll(void);
  **********************************************************************************************************************/
 bool Timer_IsRegistered(struct TTimer *pTimer);
 
+/**********************************************************************************************************************/
+/** Returns false if no timer is registered. Otherwise returns true and the tenths of seconds until Timer_EventHandler
+ ** has to be called again (0: at once), so that callers can sleep until then
+ **********************************************************************************************************************/
+bool Timer_GetNextExpiration(uint32_t *pu32TenthsSeconds);
+
 /**********************************************************************************************************************/
 /** Returns true if the time value from the parameter is in the past
  **********************************************************************************************************************/
@@ -28,6 +28,7 @@ void Queue_Push(
       // add the timer at the end of the list
       pTEnd->m_pNext = pQueueElement;
       pQueueElement->m_pNext = 0L;
+      pQueueElement->m_u8Queued = 1;
     }
     // else element already in the queue
   }
@@ -46,7 +47,95 @@ struct TQueueElement *Queue_Pop(
     pRet = pQueueRoot->m_pNext;
     pQueueRoot->m_pNext = pRet->m_pNext;
     pRet->m_pNext = NULL;
+    pRet->m_u8Queued = 0;
   }
 
   return pRet;
 }
+
+/**********************************************************************************************************************/
+/**
+ **********************************************************************************************************************/
+void Queue_Init(
+  struct TQueue *pQueue
+  )
+{
+  pQueue->m_pHead = NULL;
+  pQueue->m_pTail = NULL;
+  pQueue->m_u16Count = 0;
+}
+
+/**********************************************************************************************************************/
+/**
+ **********************************************************************************************************************/
+void Queue_InitElement(
+  struct TQueueElement *pQueueElement,
+  void *pUserData
+  )
+{
+  pQueueElement->m_pNext = NULL;
+  pQueueElement->m_pUserData = pUserData;
+  pQueueElement->m_u8Queued = 0;
+}
+
+/**********************************************************************************************************************/
+/**
+ **********************************************************************************************************************/
+bool Queue_PushTail(
+  struct TQueue *pQueue,
+  struct TQueueElement *pQueueElement
+  )
+{
+  if ((pQueue == NULL) || (pQueueElement == NULL) || pQueueElement->m_u8Queued) {
+    // element already in a queue
+    return false;
+  }
+
+  pQueueElement->m_pNext = NULL;
+  pQueueElement->m_u8Queued = 1;
+
+  if (pQueue->m_pTail == NULL) {
+    pQueue->m_pHead = pQueueElement;
+  }
+  else {
+    pQueue->m_pTail->m_pNext = pQueueElement;
+  }
+  pQueue->m_pTail = pQueueElement;
+  pQueue->m_u16Count++;
+
+  return true;
+}
+
+/**********************************************************************************************************************/
+/**
+ **********************************************************************************************************************/
+struct TQueueElement *Queue_PopHead(
+  struct TQueue *pQueue
+  )
+{
+  struct TQueueElement *pRet = NULL;
+
+  if ((pQueue != NULL) && (pQueue->m_pHead != NULL)) {
+    pRet = pQueue->m_pHead;
+    pQueue->m_pHead = pRet->m_pNext;
+    if (pQueue->m_pHead == NULL) {
+      pQueue->m_pTail = NULL;
+    }
+    pQueue->m_u16Count--;
+
+    pRet->m_pNext = NULL;
+    pRet->m_u8Queued = 0;
+  }
+
+  return pRet;
+}
+
+/**********************************************************************************************************************/
+/**
+ **********************************************************************************************************************/
+bool Queue_IsQueued(
+  struct TQueueElement *pQueueElement
+  )
+{
+  return (pQueueElement != NULL) && (pQueueElement->m_u8Queued != 0);
+}
@@ -6,81 +6,292 @@
 #define LOG_LEVEL LOG_LEVEL_ADP
 #include <Logger.h>
 
-// The head of the timers list
-struct TTimer *g_pRootTimer = NULL;
+// Hierarchical timing wheel. Timers are kept in singly linked lists (m_pNextTimer), one per bucket. A timer fires at
+// tick m_i32ExpirationTime + 1 (first tick where Timer_IsPast() is true). Ticks are handled as uint32_t, wrapping
+// around, and compared through their difference (_Timer_Diff), so the wheel keeps working when the uptime wraps. Level L holds the timers firing between 64^L
+// and 64^(L+1) ticks after the current wheel time, in bucket ((fire tick) >> (6 * L)) & 63. When the wheel reaches a
+// multiple of 64^L ticks, the matching bucket of level L is cascaded to the lower levels. The bucket of a registered timer
+// is found from its expiration time, so struct TTimer needs no extra members.
+#define TIMER_WHEEL_LEVELS 5
+#define TIMER_WHEEL_BITS 6
+#define TIMER_WHEEL_SIZE (1 << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_MASK (TIMER_WHEEL_SIZE - 1)
+
+static struct TTimer *s_apWheel[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SIZE];
+// Timers already due when inserted
+static struct TTimer *s_pPendingTimers = NULL;
+// Timers beyond the last level
+static struct TTimer *s_pOverflowTimers = NULL;
+// Last processed tick
+static uint32_t s_u32WheelTime = 0;
+static uint32_t s_u32RegisteredTimers = 0;
 
 extern uint32_t oss_get_up_time_100ms(void);
 extern uint32_t oss_get_up_time_10s(void);
 
+/**********************************************************************************************************************/
+/** Returns the ticks from u32Time2 to u32Time1 (negative if u32Time1 is older), whatever wrap-around happened between
+ ** them as long as they are less than 2^31 ticks apart
+ **********************************************************************************************************************/
+static int32_t _Timer_Diff(uint32_t u32Time1, uint32_t u32Time2)
+{
+  return (int32_t)(u32Time1 - u32Time2);
+}
+
+/**********************************************************************************************************************/
+/** Returns the tick where a timer fires
+ **********************************************************************************************************************/
+static uint32_t _Timer_FireTime(struct TTimer *pTimer)
+{
+  return (uint32_t)pTimer->m_i32ExpirationTime + 1;
+}
+
+/**********************************************************************************************************************/
+/** Returns the list where a timer is (or must be) stored
+ **********************************************************************************************************************/
+static struct TTimer **_Timer_GetList(uint32_t u32FireTime, uint8_t *pu8Level)
+{
+  int32_t i32Delta = _Timer_Diff(u32FireTime, s_u32WheelTime);
+  uint8_t u8Level;
+
+  if (i32Delta <= 0) {
+    *pu8Level = TIMER_WHEEL_LEVELS;
+    return &s_pPendingTimers;
+  }
+
+  for (u8Level = 0; u8Level < TIMER_WHEEL_LEVELS; u8Level++) {
+    if ((uint32_t)i32Delta < (1UL << (TIMER_WHEEL_BITS * (u8Level + 1)))) {
+      *pu8Level = u8Level;
+      return &s_apWheel[u8Level][(u32FireTime >> (TIMER_WHEEL_BITS * u8Level)) & TIMER_WHEEL_MASK];
+    }
+  }
+
+  *pu8Level = TIMER_WHEEL_LEVELS + 1;
+  return &s_pOverflowTimers;
+}
+
+/**********************************************************************************************************************/
+/** Inserts a timer in the wheel
+ **********************************************************************************************************************/
+static void _Timer_Insert(struct TTimer *pTimer)
+{
+  uint8_t u8Level;
+  struct TTimer **ppList = _Timer_GetList(_Timer_FireTime(pTimer), &u8Level);
+
+  pTimer->m_pNextTimer = *ppList;
+  *ppList = pTimer;
+}
+
+/**********************************************************************************************************************/
+/** Removes a timer from a list; returns true if the timer was found
+ **********************************************************************************************************************/
+static bool _Timer_ListRemove(struct TTimer **ppList, struct TTimer *pTimer)
+{
+  while (*ppList != NULL) {
+    if (*ppList == pTimer) {
+      *ppList = pTimer->m_pNextTimer;
+      pTimer->m_pNextTimer = NULL;
+      return true;
+    }
+    ppList = &(*ppList)->m_pNextTimer;
+  }
+  return false;
+}
+
+/**********************************************************************************************************************/
+/** Returns true if the timer is in the list
+ **********************************************************************************************************************/
+static bool _Timer_ListContains(struct TTimer *pList, struct TTimer *pTimer)
+{
+  while ((pList != NULL) && (pList != pTimer)) {
+    pList = pList->m_pNextTimer;
+  }
+  return (pList != NULL);
+}
+
+/**********************************************************************************************************************/
+/** Looks for a registered timer in the lists where it can be; returns the list containing it or NULL
+ **********************************************************************************************************************/
+static struct TTimer **_Timer_Find(struct TTimer *pTimer)
+{
+  uint32_t u32FireTime = _Timer_FireTime(pTimer);
+  struct TTimer **ppList;
+  uint8_t u8Level;
+
+  for (u8Level = 0; u8Level < TIMER_WHEEL_LEVELS; u8Level++) {
+    ppList = &s_apWheel[u8Level][(u32FireTime >> (TIMER_WHEEL_BITS * u8Level)) & TIMER_WHEEL_MASK];
+    if (_Timer_ListContains(*ppList, pTimer)) {
+      return ppList;
+    }
+  }
+
+  if (_Timer_ListContains(s_pPendingTimers, pTimer)) {
+    return &s_pPendingTimers;
+  }
+
+  if (_Timer_ListContains(s_pOverflowTimers, pTimer)) {
+    return &s_pOverflowTimers;
+  }
+
+  return NULL;
+}
+
+/**********************************************************************************************************************/
+/** Moves all the timers of a list to the lists matching the current wheel time
+ **********************************************************************************************************************/
+static void _Timer_Cascade(struct TTimer **ppList)
+{
+  struct TTimer *pT = *ppList;
+  struct TTimer *pNext;
+
+  *ppList = NULL;
+  while (pT != NULL) {
+    pNext = pT->m_pNextTimer;
+    _Timer_Insert(pT);
+    pT = pNext;
+  }
+}
+
+/**********************************************************************************************************************/
+/** Calls the callbacks of all the timers of a list. Timers are removed one by one, so callbacks can register or
+ ** unregister any timer (including the ones still in the list)
+ **********************************************************************************************************************/
+static void _Timer_Fire(struct TTimer **ppList)
+{
+  struct TTimer *pT;
+
+  while (*ppList != NULL) {
+    pT = *ppList;
+    *ppList = pT->m_pNextTimer;
+    pT->m_pNextTimer = NULL;
+    s_u32RegisteredTimers--;
+
+    pT->m_fnctCallback(pT);
+  }
+}
+
 /**********************************************************************************************************************/
 /**
  **********************************************************************************************************************/
 void Timer_EventHandler(void)
 {
-  bool bRestart = false;
+  uint32_t u32Now = (uint32_t)Timer_SignedSysGetUpTimeTenthsSeconds();
+  uint8_t u8Level;
 
-  do {
-    struct TTimer *pT = g_pRootTimer;
-    bRestart = false;
+  if (s_u32RegisteredTimers == 0) {
+    // nothing to walk through
+    s_u32WheelTime = u32Now;
+    return;
+  }
 
-    while (pT != 0L) {
-      if (Timer_IsPast(pT->m_i32ExpirationTime)) {
-        // Timer expired: remove it from the list and call the callback
-        Timer_Unregister(pT);
+  _Timer_Fire(&s_pPendingTimers);
 
-        pT->m_fnctCallback(pT);
+  while (_Timer_Diff(u32Now, s_u32WheelTime) > 0) {
+    s_u32WheelTime++;
 
-        // restart
-        bRestart = true;
-        break;
+    // cascade higher levels first, so their timers can reach level 0 in the same tick
+    if ((s_u32WheelTime & ((1UL << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS)) - 1)) == 0) {
+      _Timer_Cascade(&s_pOverflowTimers);
+    }
+    for (u8Level = TIMER_WHEEL_LEVELS - 1; u8Level > 0; u8Level--) {
+      if ((s_u32WheelTime & ((1UL << (TIMER_WHEEL_BITS * u8Level)) - 1)) == 0) {
+        _Timer_Cascade(&s_apWheel[u8Level][(s_u32WheelTime >> (TIMER_WHEEL_BITS * u8Level)) & TIMER_WHEEL_MASK]);
       }
+    }
+
+    _Timer_Fire(&s_apWheel[0][s_u32WheelTime & TIMER_WHEEL_MASK]);
+    // timers inserted as due by cascade or by callbacks
+    _Timer_Fire(&s_pPendingTimers);
 
-      pT = pT->m_pNextTimer;
+    if (s_u32RegisteredTimers == 0) {
+      s_u32WheelTime = u32Now;
     }
-  } while (bRestart);
+  }
 }
 
 /**********************************************************************************************************************/
-/**
+/** Timers of a higher level or of the overflow list are only known to fire after their cascade, which is taken as
+ ** their deadline: the caller may then be woken before the first expiration, never after it
  **********************************************************************************************************************/
-void Timer_Register(struct TTimer *pTimer, uint32_t u32TenthsSeconds)
+bool Timer_GetNextExpiration(uint32_t *pu32TenthsSeconds)
 {
-  struct TTimer *pT = g_pRootTimer, *pTEnd = NULL;
+  uint32_t u32Now = (uint32_t)Timer_SignedSysGetUpTimeTenthsSeconds();
+  uint32_t u32Next;
+  uint32_t u32Slot;
+  int32_t i32Left;
+  bool bFound = false;
+  uint8_t u8Level;
+  uint32_t u32Idx;
 
-  // compute the expiration time; please note that if the timer is already registered, it's expiration time will be
-  // update
-  pTimer->m_i32ExpirationTime = Timer_SignedSysGetUpTimeTenthsSeconds() + u32TenthsSeconds;
+  if (s_u32RegisteredTimers == 0) {
+    return false;
+  }
 
-  // check if the timer already registered
-  while ((pT != NULL) && (pT != pTimer)) {
-    pTEnd = pT;
-    pT = pT->m_pNextTimer;
+  if (s_pPendingTimers != NULL) {
+    *pu32TenthsSeconds = 0;
+    return true;
   }
 
-  // if timer not found, register it
-  if (pT == 0L) {
-    // add the timer at the end of the list
-    if (g_pRootTimer == NULL) {
-      g_pRootTimer = pTimer;
+  // first non empty bucket of each level, in firing order from the current wheel time
+  u32Next = 0;
+  for (u8Level = 0; u8Level < TIMER_WHEEL_LEVELS; u8Level++) {
+    for (u32Idx = 1; u32Idx <= TIMER_WHEEL_SIZE; u32Idx++) {
+      u32Slot = (s_u32WheelTime >> (TIMER_WHEEL_BITS * u8Level)) + u32Idx;
+      if (s_apWheel[u8Level][u32Slot & TIMER_WHEEL_MASK] != NULL) {
+        u32Slot <<= (TIMER_WHEEL_BITS * u8Level);
+        if (!bFound || (_Timer_Diff(u32Slot, u32Next) < 0)) {
+          u32Next = u32Slot;
+          bFound = true;
+        }
+        break;
+      }
     }
-    else {
-      pTEnd->m_pNextTimer = pTimer;
+  }
+
+  if (s_pOverflowTimers != NULL) {
+    u32Slot = ((s_u32WheelTime >> (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS)) + 1) << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS);
+    if (!bFound || (_Timer_Diff(u32Slot, u32Next) < 0)) {
+      u32Next = u32Slot;
     }
-    pTimer->m_pNextTimer = 0L;
   }
-  // else timer already registered; m_i32ExpirationTime already updated
+
+  i32Left = _Timer_Diff(u32Next, u32Now);
+  *pu32TenthsSeconds = (i32Left > 0) ? (uint32_t)i32Left : 0;
+  return true;
 }
 
 /**********************************************************************************************************************/
 /**
  **********************************************************************************************************************/
-bool Timer_IsRegistered(struct TTimer *pTimer)
+void Timer_Register(struct TTimer *pTimer, uint32_t u32TenthsSeconds)
 {
-  struct TTimer *pT = g_pRootTimer;
-  while ((pT != NULL) && (pT != pTimer)) {
-    pT = pT->m_pNextTimer;
+  struct TTimer **ppList;
+
+  // if the timer is already registered, remove it from its current list; it's expiration time will be updated
+  ppList = _Timer_Find(pTimer);
+  if (ppList != NULL) {
+    _Timer_ListRemove(ppList, pTimer);
+  }
+  else {
+    if (s_u32RegisteredTimers == 0) {
+      // wheel time may be outdated if no timer was running
+      s_u32WheelTime = (uint32_t)Timer_SignedSysGetUpTimeTenthsSeconds();
+    }
+    s_u32RegisteredTimers++;
   }
-  return (pT == pTimer);
+
+  // compute the expiration time
+  pTimer->m_i32ExpirationTime = (int32_t)((uint32_t)Timer_SignedSysGetUpTimeTenthsSeconds() + u32TenthsSeconds);
+
+  _Timer_Insert(pTimer);
+}
+
+/**********************************************************************************************************************/
+/**
+ **********************************************************************************************************************/
+bool Timer_IsRegistered(struct TTimer *pTimer)
+{
+  return (_Timer_Find(pTimer) != NULL);
 }
 
 /**********************************************************************************************************************/
@@ -88,22 +299,13 @@ bool Timer_IsRegistered(struct TTimer *pTimer)
  **********************************************************************************************************************/
 void Timer_Unregister(struct TTimer *pTimer)
 {
-  if (g_pRootTimer == pTimer) {
-    g_pRootTimer = g_pRootTimer->m_pNextTimer;
-  }
-  else {
-    struct TTimer *pT = g_pRootTimer;
-    // search the timer
-    while ((pT != 0L) && (pT->m_pNextTimer != pTimer)) {
-      pT = pT->m_pNextTimer;
-    }
+  struct TTimer **ppList = _Timer_Find(pTimer);
 
-    if ((pT != 0L) && (pT->m_pNextTimer == pTimer)) {
-      // remove the timer from the list
-      pT->m_pNextTimer = pTimer->m_pNextTimer;
-    }
-    // else the timer is not registered
+  if (ppList != NULL) {
+    _Timer_ListRemove(ppList, pTimer);
+    s_u32RegisteredTimers--;
   }
+  // else the timer is not registered
 
   pTimer->m_pNextTimer = 0L;
 }
@@ -113,7 +315,11 @@ void Timer_Unregister(struct TTimer *pTimer)
  **********************************************************************************************************************/
 void Timer_ResetAll(void)
 {
-  g_pRootTimer = 0L;
+  memset(s_apWheel, 0, sizeof(s_apWheel));
+  s_pPendingTimers = NULL;
+  s_pOverflowTimers = NULL;
+  s_u32RegisteredTimers = 0;
+  s_u32WheelTime = (uint32_t)Timer_SignedSysGetUpTimeTenthsSeconds();
 }
 
 /**********************************************************************************************************************/
@@ -121,7 +327,7 @@ void Timer_ResetAll(void)
  **********************************************************************************************************************/
 bool Timer_IsPast(int32_t i32TimeValue)
 {
-  return (Timer_SignedSysGetUpTimeTenthsSeconds() - i32TimeValue > 0);
+  return (_Timer_Diff((uint32_t)Timer_SignedSysGetUpTimeTenthsSeconds(), (uint32_t)i32TimeValue) > 0);
 }
 
 /**********************************************************************************************************************/
@@ -129,7 +335,7 @@ bool Timer_IsPast(int32_t i32TimeValue)
  **********************************************************************************************************************/
 bool Timer_IsPast10Seconds(int32_t i32TimeValue)
 {
-  return (Timer_SignedSysGetUpTime10Seconds() - i32TimeValue > 0);
+  return (_Timer_Diff((uint32_t)Timer_SignedSysGetUpTime10Seconds(), (uint32_t)i32TimeValue) > 0);
 }
 
 /**********************************************************************************************************************/
@@ -137,7 +343,7 @@ bool Timer_IsPast10Seconds(int32_t i32TimeValue)
  **********************************************************************************************************************/
 bool Timer_IsPastCmp(int32_t i32Time1, int32_t i32Time2)
 {
-  return (i32Time1 - i32Time2 > 0);
+  return (_Timer_Diff((uint32_t)i32Time1, (uint32_t)i32Time2) > 0);
 }
 
 /**********************************************************************************************************************/
@@ -0,0 +1,229 @@
+/**
+ * \file
+ *
+ * \brief Host test of the G3 common queue module.
+ *
+ * Random pushes and pops on a TQueue must give the same elements, order and
+ * count as a reference FIFO, refuse elements already queued and keep the
+ * membership flag in step with the legacy Queue_Push/Queue_Pop. Then times
+ * one push and one pop at queue depths from 1 to 512, through TQueue and
+ * through the legacy queue.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../source/QueueMng.c"
+
+#define MAX_ELEMENTS      512
+#define RANDOM_OPS        500000
+#define BENCH_OPS         2000000
+/* Legacy pushes walk the whole queue: timed over fewer operations */
+#define BENCH_LEGACY_OPS  (200000000 / MAX_ELEMENTS)
+
+static int si_failures;
+
+#define CHECK(cond) do { \
+		if (!(cond)) { \
+			printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+			si_failures++; \
+		} \
+	} while (0)
+
+static uint32_t sul_rng = 0x12345678;
+static struct TQueueElement sax_elements[MAX_ELEMENTS];
+/* Reference FIFO of element indexes */
+static uint16_t saus_fifo[MAX_ELEMENTS];
+static uint16_t sus_fifo_head;
+static uint16_t sus_fifo_count;
+static bool sab_queued[MAX_ELEMENTS];
+
+static uint32_t _rand(void)
+{
+	sul_rng ^= sul_rng << 13;
+	sul_rng ^= sul_rng >> 17;
+	sul_rng ^= sul_rng << 5;
+	return sul_rng;
+}
+
+static void _init_elements(void)
+{
+	uint16_t us_i;
+
+	for (us_i = 0; us_i < MAX_ELEMENTS; us_i++) {
+		Queue_InitElement(&sax_elements[us_i], &sax_elements[us_i]);
+	}
+}
+
+/* Same elements, order and count as the reference FIFO */
+static void test_random_ops(void)
+{
+	struct TQueue x_queue;
+	struct TQueueElement *px_element;
+	uint32_t ul_op;
+	uint32_t ul_mismatches = 0;
+	uint16_t us_max_count = 0;
+	uint16_t us_idx;
+	bool b_pushed;
+
+	_init_elements();
+	Queue_Init(&x_queue);
+	memset(sab_queued, 0, sizeof(sab_queued));
+	sus_fifo_head = 0;
+	sus_fifo_count = 0;
+
+	CHECK(Queue_PopHead(&x_queue) == NULL);
+	CHECK(!Queue_PushTail(NULL, &sax_elements[0]));
+	CHECK(!Queue_PushTail(&x_queue, NULL));
+
+	for (ul_op = 0; ul_op < RANDOM_OPS; ul_op++) {
+		/* Pushes (of queued elements too) and pops, the depth drifting over the whole range */
+		if ((_rand() % 1024) < ((ul_op / 50000) % 2 ? 300 : 900)) {
+			us_idx = _rand() % MAX_ELEMENTS;
+			b_pushed = Queue_PushTail(&x_queue, &sax_elements[us_idx]);
+			if (b_pushed != !sab_queued[us_idx]) {
+				ul_mismatches++;
+			}
+
+			if (b_pushed) {
+				saus_fifo[(sus_fifo_head + sus_fifo_count) % MAX_ELEMENTS] = us_idx;
+				sus_fifo_count++;
+				sab_queued[us_idx] = true;
+				if (sus_fifo_count > us_max_count) {
+					us_max_count = sus_fifo_count;
+				}
+			}
+		} else {
+			px_element = Queue_PopHead(&x_queue);
+			if (sus_fifo_count == 0) {
+				if (px_element != NULL) {
+					ul_mismatches++;
+				}
+			} else {
+				us_idx = saus_fifo[sus_fifo_head];
+				sus_fifo_head = (sus_fifo_head + 1) % MAX_ELEMENTS;
+				sus_fifo_count--;
+				sab_queued[us_idx] = false;
+				if ((px_element != &sax_elements[us_idx]) || (px_element->m_pUserData != px_element) ||
+						(px_element->m_pNext != NULL)) {
+					ul_mismatches++;
+				}
+			}
+		}
+
+		us_idx = _rand() % MAX_ELEMENTS;
+		if ((x_queue.m_u16Count != sus_fifo_count) || (Queue_IsQueued(&sax_elements[us_idx]) != sab_queued[us_idx]) ||
+				((x_queue.m_pHead == NULL) != (sus_fifo_count == 0)) || ((x_queue.m_pTail == NULL) != (sus_fifo_count == 0))) {
+			ul_mismatches++;
+		}
+	}
+
+	CHECK(ul_mismatches == 0);
+	CHECK(us_max_count > MAX_ELEMENTS / 2);
+	printf("%u pushes and pops, up to %u queued, %u mismatches\n", (unsigned)RANDOM_OPS, (unsigned)us_max_count,
+			(unsigned)ul_mismatches);
+}
+
+/* An element moves between a legacy queue and a TQueue, never in both */
+static void test_legacy_interop(void)
+{
+	struct TQueueElement x_root;
+	struct TQueue x_queue;
+
+	_init_elements();
+	Queue_InitElement(&x_root, NULL);
+	Queue_Init(&x_queue);
+
+	Queue_Push(&x_root, &sax_elements[0]);
+	Queue_Push(&x_root, &sax_elements[1]);
+	/* Already queued: not linked twice */
+	Queue_Push(&x_root, &sax_elements[0]);
+	CHECK(Queue_IsQueued(&sax_elements[0]));
+	CHECK(!Queue_PushTail(&x_queue, &sax_elements[0]));
+
+	CHECK(Queue_Pop(&x_root) == &sax_elements[0]);
+	CHECK(!Queue_IsQueued(&sax_elements[0]));
+	CHECK(Queue_PushTail(&x_queue, &sax_elements[0]));
+	CHECK(Queue_Pop(&x_root) == &sax_elements[1]);
+	CHECK(Queue_Pop(&x_root) == NULL);
+
+	CHECK(Queue_PopHead(&x_queue) == &sax_elements[0]);
+	Queue_Push(&x_root, &sax_elements[0]);
+	CHECK(Queue_Pop(&x_root) == &sax_elements[0]);
+	CHECK(Queue_Pop(&x_root) == NULL);
+}
+
+/* Nanoseconds per push and pop pair, the queue holding us_depth elements */
+static double _bench(bool b_legacy, uint16_t us_depth, uint32_t ul_ops)
+{
+	struct TQueueElement x_root;
+	struct TQueue x_queue;
+	struct TQueueElement *px_element;
+	struct timespec x_start;
+	struct timespec x_end;
+	uint32_t ul_i;
+	uint32_t ul_popped = 0;
+
+	_init_elements();
+	Queue_InitElement(&x_root, NULL);
+	Queue_Init(&x_queue);
+	for (ul_i = 0; ul_i + 1 < us_depth; ul_i++) {
+		if (b_legacy) {
+			Queue_Push(&x_root, &sax_elements[ul_i]);
+		} else {
+			Queue_PushTail(&x_queue, &sax_elements[ul_i]);
+		}
+	}
+
+	px_element = &sax_elements[us_depth - 1];
+	clock_gettime(CLOCK_MONOTONIC, &x_start);
+	for (ul_i = 0; ul_i < ul_ops; ul_i++) {
+		if (b_legacy) {
+			Queue_Push(&x_root, px_element);
+			px_element = Queue_Pop(&x_root);
+		} else {
+			Queue_PushTail(&x_queue, px_element);
+			px_element = Queue_PopHead(&x_queue);
+		}
+
+		ul_popped += (px_element != NULL);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &x_end);
+	CHECK(ul_popped == ul_ops);
+	CHECK(b_legacy || (x_queue.m_u16Count == us_depth - 1));
+
+	return ((double)(x_end.tv_sec - x_start.tv_sec) * 1e9 + (double)(x_end.tv_nsec - x_start.tv_nsec)) / ul_ops;
+}
+
+static void test_bench(void)
+{
+	static const uint16_t caus_depths[] = {1, 8, 64, 512};
+	double d_queue;
+	double d_legacy;
+	uint8_t uc_i;
+
+	printf("depth  TQueue ns  legacy ns\n");
+	for (uc_i = 0; uc_i < sizeof(caus_depths) / sizeof(caus_depths[0]); uc_i++) {
+		d_queue = _bench(false, caus_depths[uc_i], BENCH_OPS);
+		d_legacy = _bench(true, caus_depths[uc_i], BENCH_LEGACY_OPS);
+		printf("%5u  %9.1f  %9.1f\n", (unsigned)caus_depths[uc_i], d_queue, d_legacy);
+	}
+}
+
+int main(void)
+{
+	test_random_ops();
+	test_legacy_interop();
+	test_bench();
+
+	if (si_failures) {
+		printf("%d failure(s)\n", si_failures);
+		return 1;
+	}
+
+	printf("OK\n");
+	return 0;
+}
@@ -0,0 +1,515 @@
+/**
+ * \file
+ *
+ * \brief Host test of the G3 common Timer module (timing wheel).
+ *
+ * The wheel and the former timer list are run side by side over the same
+ * random registrations, unregistrations, late event handler calls and
+ * uptime wrap-around, with callbacks registering their own timer again:
+ * every timer must fire at the same tick in both. Then sleeps from one
+ * Timer_GetNextExpiration() deadline to the next, as a tickless caller
+ * does: no timer may fire late. Then times the event handler with 10, 100
+ * and 1000 live timers for both implementations.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../source/Timer.c"
+
+#define MAX_TIMERS        1000
+#define RANDOM_TICKS      300000
+#define RANDOM_TIMERS     200
+#define BENCH_TICKS       100000
+
+static int si_failures;
+
+#define CHECK(cond) do { \
+		if (!(cond)) { \
+			printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+			si_failures++; \
+		} \
+	} while (0)
+
+/* Uptime in tenths of seconds */
+static uint32_t sul_now;
+static uint32_t sul_rng = 0x12345678;
+
+/* Wheel timers and list timers, same index in both */
+static struct TTimer sax_wheel[MAX_TIMERS];
+static struct TTimer sax_list[MAX_TIMERS];
+/* Fires and tick of the last fire of each timer */
+static uint32_t saul_wheel_fires[MAX_TIMERS];
+static uint32_t saul_wheel_tick[MAX_TIMERS];
+static uint32_t saul_list_fires[MAX_TIMERS];
+static uint32_t saul_list_tick[MAX_TIMERS];
+/* Delay given by bench callbacks when registering their timer again */
+static uint32_t sul_bench_max_delay;
+
+uint32_t oss_get_up_time_100ms(void)
+{
+	return sul_now;
+}
+
+uint32_t oss_get_up_time_10s(void)
+{
+	return sul_now / 100;
+}
+
+static uint32_t _rand(void)
+{
+	sul_rng ^= sul_rng << 13;
+	sul_rng ^= sul_rng >> 17;
+	sul_rng ^= sul_rng << 5;
+	return sul_rng;
+}
+
+/* Former timer list */
+static struct TTimer *spx_list_root;
+
+static bool _list_is_past(int32_t i32TimeValue)
+{
+	return (Timer_SignedSysGetUpTimeTenthsSeconds() - i32TimeValue > 0);
+}
+
+static void _list_unregister(struct TTimer *pTimer)
+{
+	if (spx_list_root == pTimer) {
+		spx_list_root = spx_list_root->m_pNextTimer;
+	} else {
+		struct TTimer *pT = spx_list_root;
+
+		while ((pT != 0L) && (pT->m_pNextTimer != pTimer)) {
+			pT = pT->m_pNextTimer;
+		}
+
+		if ((pT != 0L) && (pT->m_pNextTimer == pTimer)) {
+			pT->m_pNextTimer = pTimer->m_pNextTimer;
+		}
+	}
+
+	pTimer->m_pNextTimer = 0L;
+}
+
+static void _list_register(struct TTimer *pTimer, uint32_t u32TenthsSeconds)
+{
+	struct TTimer *pT = spx_list_root, *pTEnd = NULL;
+
+	pTimer->m_i32ExpirationTime = Timer_SignedSysGetUpTimeTenthsSeconds() + u32TenthsSeconds;
+
+	while ((pT != NULL) && (pT != pTimer)) {
+		pTEnd = pT;
+		pT = pT->m_pNextTimer;
+	}
+
+	if (pT == 0L) {
+		if (spx_list_root == NULL) {
+			spx_list_root = pTimer;
+		} else {
+			pTEnd->m_pNextTimer = pTimer;
+		}
+
+		pTimer->m_pNextTimer = 0L;
+	}
+}
+
+static bool _list_is_registered(struct TTimer *pTimer)
+{
+	struct TTimer *pT = spx_list_root;
+
+	while ((pT != NULL) && (pT != pTimer)) {
+		pT = pT->m_pNextTimer;
+	}
+
+	return (pT == pTimer);
+}
+
+static void _list_event_handler(void)
+{
+	bool bRestart = false;
+
+	do {
+		struct TTimer *pT = spx_list_root;
+		bRestart = false;
+
+		while (pT != 0L) {
+			if (_list_is_past(pT->m_i32ExpirationTime)) {
+				_list_unregister(pT);
+				pT->m_fnctCallback(pT);
+				bRestart = true;
+				break;
+			}
+
+			pT = pT->m_pNextTimer;
+		}
+	} while (bRestart);
+}
+
+/* Delay a timer registers itself again with, from its index and fires (0: not registered again) */
+static uint32_t _again_delay(uint32_t ul_idx, uint32_t ul_fires)
+{
+	uint32_t ul_mix = (ul_idx * 2654435761UL) ^ (ul_fires * 40503UL);
+
+	switch (ul_mix % 5) {
+	case 0:
+		return 0;
+
+	case 1:
+		/* Due on next tick */
+		return 1 + (ul_mix >> 8) % 2;
+
+	case 2:
+		return (ul_mix >> 8) % 64;
+
+	case 3:
+		return (ul_mix >> 8) % 5000;
+
+	default:
+		return (ul_mix >> 8) % 300000;
+	}
+}
+
+static void _wheel_cb(struct TTimer *pTimer)
+{
+	uint32_t ul_idx = pTimer - sax_wheel;
+	uint32_t ul_delay;
+
+	saul_wheel_fires[ul_idx]++;
+	saul_wheel_tick[ul_idx] = sul_now;
+	ul_delay = _again_delay(ul_idx, saul_wheel_fires[ul_idx]);
+	if (ul_delay) {
+		Timer_Register(pTimer, ul_delay - 1);
+	}
+}
+
+static void _list_cb(struct TTimer *pTimer)
+{
+	uint32_t ul_idx = pTimer - sax_list;
+	uint32_t ul_delay;
+
+	saul_list_fires[ul_idx]++;
+	saul_list_tick[ul_idx] = sul_now;
+	ul_delay = _again_delay(ul_idx, saul_list_fires[ul_idx]);
+	if (ul_delay) {
+		_list_register(pTimer, ul_delay - 1);
+	}
+}
+
+/* Random delay from the next tick to beyond the last wheel level */
+static uint32_t _random_delay(void)
+{
+	switch (_rand() % 8) {
+	case 0:
+		return 0;
+
+	case 1:
+	case 2:
+		return _rand() % 64;
+
+	case 3:
+	case 4:
+		return _rand() % 4096;
+
+	case 5:
+		return _rand() % 262144;
+
+	case 6:
+		return _rand() % 20000000;
+
+	default:
+		/* Beyond the last level, only if rare: it never fires in this test */
+		return (_rand() % 64) ? _rand() % 1000 : (1UL << 30) + _rand() % 1000;
+	}
+}
+
+/* Same fires in both, starting 20000 ticks before the uptime wraps around */
+static void test_against_list(void)
+{
+	uint32_t ul_tick;
+	uint32_t ul_idx;
+	uint32_t ul_delay;
+	uint32_t ul_fires = 0;
+	uint32_t ul_mismatches = 0;
+	uint32_t ul_i;
+
+	sul_now = 0xFFFFFFFFUL - 20000;
+	Timer_ResetAll();
+	spx_list_root = NULL;
+	for (ul_i = 0; ul_i < RANDOM_TIMERS; ul_i++) {
+		sax_wheel[ul_i].m_fnctCallback = _wheel_cb;
+		sax_list[ul_i].m_fnctCallback = _list_cb;
+	}
+
+	for (ul_tick = 0; ul_tick < RANDOM_TICKS; ul_tick++) {
+		/* Registrations (or updates) and unregistrations in between */
+		ul_idx = _rand() % RANDOM_TIMERS;
+		switch (_rand() % 8) {
+		case 0:
+		case 1:
+		case 2:
+			ul_delay = _random_delay();
+			Timer_Register(&sax_wheel[ul_idx], ul_delay);
+			_list_register(&sax_list[ul_idx], ul_delay);
+			break;
+
+		case 3:
+			Timer_Unregister(&sax_wheel[ul_idx]);
+			_list_unregister(&sax_list[ul_idx]);
+			break;
+
+		default:
+			break;
+		}
+
+		if (Timer_IsRegistered(&sax_wheel[ul_idx]) != _list_is_registered(&sax_list[ul_idx])) {
+			ul_mismatches++;
+		}
+
+		/* Event handler mostly every tick, sometimes late */
+		sul_now += (_rand() % 50) ? 1 : 1 + _rand() % 3000;
+		Timer_EventHandler();
+		_list_event_handler();
+		if (memcmp(saul_wheel_fires, saul_list_fires, sizeof(saul_wheel_fires)) ||
+				memcmp(saul_wheel_tick, saul_list_tick, sizeof(saul_wheel_tick))) {
+			ul_mismatches++;
+		}
+	}
+
+	for (ul_i = 0; ul_i < RANDOM_TIMERS; ul_i++) {
+		ul_fires += saul_wheel_fires[ul_i];
+		if (Timer_IsRegistered(&sax_wheel[ul_i]) != _list_is_registered(&sax_list[ul_i])) {
+			ul_mismatches++;
+		}
+	}
+
+	CHECK(ul_mismatches == 0);
+	CHECK(sul_now < 0xFFFFFFFFUL - 20000);
+	printf("%u ticks, %u timers fired %u times, %u mismatches\n", (unsigned)RANDOM_TICKS, (unsigned)RANDOM_TIMERS,
+			(unsigned)ul_fires, (unsigned)ul_mismatches);
+}
+
+/* Bench timers register themselves again, up to one minute later */
+/*
+ * Tickless caller: the event handler only runs at the reported deadlines
+ */
+#define SLEEP_STEPS       50000
+
+static uint32_t sul_sleep_fires;
+static uint32_t sul_sleep_late;
+
+/* Delays reaching every wheel level, bounded so that the handler catches up quickly */
+static uint32_t _sleep_delay(void)
+{
+	switch (_rand() % 8) {
+	case 0:
+		return 0;
+
+	case 1:
+	case 2:
+	case 3:
+		return _rand() % 64;
+
+	case 4:
+	case 5:
+		return _rand() % 4096;
+
+	case 6:
+		return _rand() % 262144;
+
+	default:
+		return (_rand() % 256) ? _rand() % 1000 : (1UL << 24) + _rand() % 1000;
+	}
+}
+
+static void _sleep_cb(struct TTimer *pTimer)
+{
+	sul_sleep_fires++;
+	if ((uint32_t)pTimer->m_i32ExpirationTime + 1 != sul_now) {
+		sul_sleep_late++;
+	}
+
+	if (_rand() % 2) {
+		Timer_Register(pTimer, _sleep_delay());
+	}
+}
+
+/* Ticks until the first registered timer fires, as the former list finds it */
+static bool _sleep_first_fire(uint32_t *pul_ticks)
+{
+	int32_t sl_left;
+	bool b_found = false;
+	uint32_t ul_i;
+
+	for (ul_i = 0; ul_i < RANDOM_TIMERS; ul_i++) {
+		if (Timer_IsRegistered(&sax_wheel[ul_i])) {
+			sl_left = (int32_t)((uint32_t)sax_wheel[ul_i].m_i32ExpirationTime + 1 - sul_now);
+			if (sl_left < 0) {
+				sl_left = 0;
+			}
+
+			if (!b_found || ((uint32_t)sl_left < *pul_ticks)) {
+				*pul_ticks = (uint32_t)sl_left;
+				b_found = true;
+			}
+		}
+	}
+
+	return b_found;
+}
+
+static void test_next_expiration(void)
+{
+	uint32_t ul_step;
+	uint32_t ul_next;
+	uint32_t ul_first = 0;
+	uint32_t ul_start;
+	uint32_t ul_handler_runs = 0;
+	uint32_t ul_early = 0;
+	uint32_t ul_mismatches = 0;
+	uint32_t ul_i;
+	bool b_next;
+
+	sul_now = 0xFFFFFFFFUL - 5000;
+	ul_start = sul_now;
+	sul_sleep_fires = 0;
+	sul_sleep_late = 0;
+	Timer_ResetAll();
+	for (ul_i = 0; ul_i < RANDOM_TIMERS; ul_i++) {
+		sax_wheel[ul_i].m_fnctCallback = _sleep_cb;
+	}
+
+	CHECK(!Timer_GetNextExpiration(&ul_next));
+	for (ul_step = 0; ul_step < SLEEP_STEPS; ul_step++) {
+		/* Registrations and unregistrations at wake-up */
+		ul_i = _rand() % RANDOM_TIMERS;
+		switch (_rand() % 4) {
+		case 0:
+			Timer_Register(&sax_wheel[ul_i], _sleep_delay());
+			break;
+
+		case 1:
+			Timer_Unregister(&sax_wheel[ul_i]);
+			break;
+
+		default:
+			break;
+		}
+
+		b_next = Timer_GetNextExpiration(&ul_next);
+		if (b_next != _sleep_first_fire(&ul_first)) {
+			ul_mismatches++;
+		}
+
+		if (!b_next) {
+			/* Nothing registered: sleep for a while */
+			sul_now += 1 + _rand() % 100;
+			continue;
+		}
+
+		/* The deadline may only be earlier than the first fire, at a cascade */
+		if (ul_next > ul_first) {
+			ul_mismatches++;
+		} else if (ul_next < ul_first) {
+			ul_early++;
+		}
+
+		sul_now += ul_next;
+		Timer_EventHandler();
+		ul_handler_runs++;
+	}
+
+	CHECK(ul_mismatches == 0);
+	CHECK(sul_sleep_late == 0);
+	CHECK(sul_sleep_fires > SLEEP_STEPS / 10);
+	printf("%u handler runs over %u ticks, %u timers fired (%u late), %u wake-ups before the first fire\n",
+			(unsigned)ul_handler_runs, (unsigned)(sul_now - ul_start), (unsigned)sul_sleep_fires,
+			(unsigned)sul_sleep_late, (unsigned)ul_early);
+}
+
+static void _bench_wheel_cb(struct TTimer *pTimer)
+{
+	Timer_Register(pTimer, 1 + _rand() % sul_bench_max_delay);
+}
+
+static void _bench_list_cb(struct TTimer *pTimer)
+{
+	_list_register(pTimer, 1 + _rand() % sul_bench_max_delay);
+}
+
+/*
+ * Nanoseconds per tick with ul_timers live timers: event handler on every
+ * tick, and a timer registered again (refreshed) on every tick
+ */
+static double _bench(bool b_wheel, uint32_t ul_timers)
+{
+	struct timespec x_start;
+	struct timespec x_end;
+	struct TTimer *px_timers = b_wheel ? sax_wheel : sax_list;
+	uint32_t ul_i;
+
+	sul_rng = 0x12345678;
+	sul_now = 0;
+	sul_bench_max_delay = 600;
+	Timer_ResetAll();
+	spx_list_root = NULL;
+	for (ul_i = 0; ul_i < ul_timers; ul_i++) {
+		px_timers[ul_i].m_fnctCallback = b_wheel ? _bench_wheel_cb : _bench_list_cb;
+		if (b_wheel) {
+			Timer_Register(&px_timers[ul_i], 1 + _rand() % sul_bench_max_delay);
+		} else {
+			_list_register(&px_timers[ul_i], 1 + _rand() % sul_bench_max_delay);
+		}
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &x_start);
+	for (ul_i = 0; ul_i < BENCH_TICKS; ul_i++) {
+		sul_now++;
+		if (b_wheel) {
+			Timer_Register(&px_timers[_rand() % ul_timers], 1 + _rand() % sul_bench_max_delay);
+			Timer_EventHandler();
+		} else {
+			_list_register(&px_timers[_rand() % ul_timers], 1 + _rand() % sul_bench_max_delay);
+			_list_event_handler();
+		}
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &x_end);
+
+	for (ul_i = 0; ul_i < ul_timers; ul_i++) {
+		CHECK(b_wheel ? Timer_IsRegistered(&px_timers[ul_i]) : _list_is_registered(&px_timers[ul_i]));
+	}
+
+	return ((double)(x_end.tv_sec - x_start.tv_sec) * 1e9 + (double)(x_end.tv_nsec - x_start.tv_nsec)) / BENCH_TICKS;
+}
+
+static void test_bench(void)
+{
+	static const uint32_t caul_timers[] = {10, 100, 1000};
+	double d_wheel;
+	double d_list;
+	uint8_t uc_i;
+
+	printf("timers  wheel ns/tick  list ns/tick\n");
+	for (uc_i = 0; uc_i < sizeof(caul_timers) / sizeof(caul_timers[0]); uc_i++) {
+		d_wheel = _bench(true, caul_timers[uc_i]);
+		d_list = _bench(false, caul_timers[uc_i]);
+		printf("%6u  %13.1f  %12.1f\n", (unsigned)caul_timers[uc_i], d_wheel, d_list);
+	}
+}
+
+int main(void)
+{
+	test_against_list();
+	test_next_expiration();
+	test_bench();
+
+	if (si_failures) {
+		printf("%d failure(s)\n", si_failures);
+		return 1;
+	}
+
+	printf("OK\n");
+	return 0;
+}
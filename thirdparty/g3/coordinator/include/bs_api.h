@@ -56,6 +56,9 @@ typedef struct {
 typedef void (*pf_app_leave_ind_cb_t)(uint16_t u16SrcAddr, bool bSecurityEnabled, uint8_t u8LinkQualityIndicator, uint8_t *pNsdu, uint16_t u16NsduLength);
 /* User-defined callback for ADPM-NETWORK-JOIN indication */
 typedef void (*pf_app_join_ind_cb_t)(uint8_t *puc_extended_address, uint16_t us_short_address);
+/* User-defined callback for first joining requests declined because all bootstrap slots are busy.
+ * The bootstrap server already sends the LBP_DECLINE through the LBA */
+typedef void (*pf_app_slots_full_ind_cb_t)(uint16_t us_lba_address, uint8_t *puc_extended_address);
 
 /* Bootstrap module initialization */
 void bs_init(TBootstrapConfiguration s_bs_conf);
@@ -71,6 +74,7 @@ void bs_lbp_kick_device(uint16_t us_short_address);
 
 /* LBP parameters external access */
 uint16_t bs_lbp_get_lbds_counter(void);
+uint32_t bs_lbp_get_lbds_generation(void);
 uint16_t bs_lbp_get_lbds_address(uint16_t i);
 bool bs_lbp_get_lbds_ex_address(uint16_t us_short_address, uint8_t *puc_extended_address);
 void bs_lbp_get_param(uint32_t ul_attribute_id, uint16_t us_attribute_idx, struct t_bs_lbp_get_param_confirm *p_get_confirm);
@@ -81,5 +85,7 @@ bool bs_get_short_addr_by_ext(uint8_t *puc_extended_address, uint16_t *pus_short
 
 void bs_lbp_leave_ind_set_cb(pf_app_leave_ind_cb_t pf_handler);
 void bs_lbp_join_ind_set_cb(pf_app_join_ind_cb_t pf_handler);
+void bs_lbp_slots_full_ind_set_cb(pf_app_slots_full_ind_cb_t pf_handler);
+uint16_t bs_lbp_get_free_slots(void);
 
 #endif /* BS_API_H */
@@ -26,9 +26,6 @@ static bool bGetShortAddressFromExtended;
 
 static uint16_t us_msg_timeout_in_s = 40;
 
-uint16_t us_blacklist_size = 0;
-uint8_t puc_blacklist[MAX_LBDS][ADP_ADDRESS_64BITS];
-
 t_context g_current_context;
 
 t_bootstrap_slot bootstrap_slots[BOOTSTRAP_NUM_SLOTS];
@@ -40,6 +37,16 @@ static struct TEapPskKey g_EapPskKey = {
 	{0xAB, 0x10, 0x34, 0x11, 0x45, 0x11, 0x1B, 0xC3, 0xC1, 0x2D, 0xE8, 0xFF, 0x11, 0x14, 0x22, 0x04}
 };
 
+/** EAP-PSK context holding AK and KDK derived from g_EapPskKey
+ * Every joining device starts from it instead of deriving AK and KDK again.
+ * It belongs to g_EapPskKey, which is only written by set_psk(): no copy of the
+ * PSK is kept to check it. The rest of the EAP-PSK work depends on the random
+ * values of each device and is done per message as it arrives; it is not
+ * batched across slots, as the AES peripheral takes one block at a time.
+ ************************************************************************************/
+static struct TEapPskContext g_EapPskInitialContext;
+static bool g_bEapPskInitialContextValid = false;
+
 struct TEapPskNetworkAccessIdentifierS g_IdS;
 
 const struct TEapPskNetworkAccessIdentifierS x_ids_arib = { NETWORK_ACCESS_IDENTIFIER_SIZE_S_ARIB,
@@ -63,8 +70,106 @@ static TBootstrapConfiguration g_s_bs_conf;
 lbds_list_entry_t g_lbds_list[MAX_LBDS];
 /* Active LBDs counter */
 static uint16_t g_lbds_counter = 0;
+/* Incremented whenever an extended to short address mapping is released or changed */
+static uint32_t g_lbds_generation = 0;
 static uint16_t g_lbds_list_size = 0;
 
+/** Extended address hash indexes
+ * Open addressing (linear probing) index from extended address to position in
+ * a table of addresses. Each bucket stores the position plus one, 0 means empty
+ * bucket. The size must be a power of 2 greater than the indexed table; it can
+ * be overridden in conf_bs.h.
+ ************************************************************************************/
+#ifndef BS_LBDS_HASH_SIZE
+#if (MAX_LBDS <= 256)
+#define BS_LBDS_HASH_SIZE  512
+#elif (MAX_LBDS <= 512)
+#define BS_LBDS_HASH_SIZE  1024
+#elif (MAX_LBDS <= 1024)
+#define BS_LBDS_HASH_SIZE  2048
+#elif (MAX_LBDS <= 2048)
+#define BS_LBDS_HASH_SIZE  4096
+#elif (MAX_LBDS <= 4096)
+#define BS_LBDS_HASH_SIZE  8192
+#else
+#error "MAX_LBDS too big: define BS_LBDS_HASH_SIZE in conf_bs.h"
+#endif
+#endif
+
+#define BS_LBDS_HASH_MASK  (BS_LBDS_HASH_SIZE - 1)
+
+typedef struct {
+	uint16_t *pus_buckets;     /* Buckets (power of 2) */
+	uint16_t us_mask;          /* Number of buckets minus one */
+	const uint8_t *puc_keys;   /* First extended address of the indexed table */
+	uint16_t us_key_stride;    /* Distance in bytes between table entries */
+} t_addr_index;
+
+#define ADDR_INDEX_KEY(p_index, us_position)  ((p_index)->puc_keys + (uint32_t)(us_position) * (p_index)->us_key_stride)
+
+/* LBDs hash index */
+static uint16_t g_lbds_hash[BS_LBDS_HASH_SIZE];
+static const t_addr_index sx_lbds_index = {g_lbds_hash, BS_LBDS_HASH_MASK, (const uint8_t *)g_lbds_list, sizeof(lbds_list_entry_t)};
+
+/* Bitmap of used positions in LBDs table (1: position in use) */
+#define BS_LBDS_BITMAP_WORDS  ((MAX_LBDS + 31) / 32)
+static uint32_t g_lbds_bitmap[BS_LBDS_BITMAP_WORDS];
+
+/************************************************************************************/
+
+/** Blacklist
+ * Compact table (no holes) of blacklisted extended addresses, with a hash index
+ * and a Bloom filter to discard non blacklisted devices without any lookup.
+ ************************************************************************************/
+#define BS_BLACKLIST_BLOOM_BITS    (BS_LBDS_HASH_SIZE * 4)
+#define BS_BLACKLIST_BLOOM_MASK    (BS_BLACKLIST_BLOOM_BITS - 1)
+#define BS_BLACKLIST_BLOOM_HASHES  3
+
+uint16_t us_blacklist_size = 0;
+uint8_t puc_blacklist[MAX_LBDS][ADP_ADDRESS_64BITS];
+
+static uint16_t g_blacklist_hash[BS_LBDS_HASH_SIZE];
+static const t_addr_index sx_blacklist_index = {g_blacklist_hash, BS_LBDS_HASH_MASK, (const uint8_t *)puc_blacklist, ADP_ADDRESS_64BITS};
+static uint32_t g_blacklist_bloom[BS_BLACKLIST_BLOOM_BITS / 32];
+
+/************************************************************************************/
+
+/** Bootstrap slots engine
+ * Busy slots are kept in a min-heap ordered by timeout, so only expired slots are
+ * visited on update. Free slots (BS_STATE_WAITING_JOINNING) are kept in a list and
+ * slots are indexed by extended address. State, timeout and address of a slot must
+ * be changed through set_bootstrap_slot_state/timeout/addr to keep them in sync.
+ ************************************************************************************/
+#if (BOOTSTRAP_NUM_SLOTS <= 8)
+#define BS_SLOTS_HASH_SIZE  16
+#elif (BOOTSTRAP_NUM_SLOTS <= 32)
+#define BS_SLOTS_HASH_SIZE  64
+#elif (BOOTSTRAP_NUM_SLOTS <= 128)
+#define BS_SLOTS_HASH_SIZE  256
+#elif (BOOTSTRAP_NUM_SLOTS <= 512)
+#define BS_SLOTS_HASH_SIZE  1024
+#elif (BOOTSTRAP_NUM_SLOTS <= 1024)
+#define BS_SLOTS_HASH_SIZE  2048
+#else
+#error "BOOTSTRAP_NUM_SLOTS too big"
+#endif
+
+#define BS_SLOT_NO_POS  0xFFFF
+
+static uint16_t g_slots_hash[BS_SLOTS_HASH_SIZE];
+static const t_addr_index sx_slots_index = {g_slots_hash, BS_SLOTS_HASH_SIZE - 1, bootstrap_slots[0].m_LbdAddress.m_au8Value, sizeof(t_bootstrap_slot)};
+
+/* Busy slots, min-heap by timeout */
+static t_bootstrap_slot *g_slots_heap[BOOTSTRAP_NUM_SLOTS];
+static uint16_t g_slots_heap_size;
+/* Free slots */
+static t_bootstrap_slot *g_free_slots[BOOTSTRAP_NUM_SLOTS];
+static uint16_t g_free_slots_size;
+/* First joining requests ignored because all slots were busy */
+static uint32_t g_slots_full_cnt;
+/* Slot each NSDU handle was last given to, to find the slot of a confirm without scanning */
+static t_bootstrap_slot *g_nsdu_handle_slots[256];
+
 /************************************************************************************/
 
 /** Parameters transferred
@@ -97,8 +202,8 @@ static bool _is_valid_address(uint16_t us_short_address)
 	if (us_short_address < g_current_context.initialShortAddr) {
 		LOG_BOOTSTRAP(("[BS] Error encoding us_short_address < g_current_context.initialShortAddr\r\n"));
 		return false;
-	} else if (us_short_address - g_current_context.initialShortAddr > MAX_LBDS) {
-		LOG_BOOTSTRAP(("[BS] Error encoding us_short_address - g_current_context.initialShortAddr > MAX_LBDS\r\n"));
+	} else if (us_short_address - g_current_context.initialShortAddr >= MAX_LBDS) {
+		LOG_BOOTSTRAP(("[BS] Error encoding us_short_address - g_current_context.initialShortAddr >= MAX_LBDS\r\n"));
 		return false;
 	} else {
 		return true;
@@ -127,22 +232,202 @@ bool is_null_address(uint8_t *puc_extended_address)
 }
 
 /**
- * \brief Returns the number of active LBDs
+ * \brief Returns the hash of an extended address (FNV-1a)
  *
- * \return number of active LBDs
+ * \param puc_extended_address  Extended address
+ *
+ * \return 32-bit hash
  */
-uint16_t get_lbds_count(void)
+static uint32_t _addr_hash(const uint8_t *puc_extended_address)
 {
-	uint16_t lbd_count, us_idx;
+	uint32_t ul_hash = 2166136261UL;
+	uint8_t i;
+
+	for (i = 0; i < ADP_ADDRESS_64BITS; i++) {
+		ul_hash ^= puc_extended_address[i];
+		ul_hash *= 16777619UL;
+	}
+
+	return ul_hash;
+}
+
+/**
+ * \brief Returns the hash index bucket of an extended address
+ *
+ * \param p_index               Hash index
+ * \param puc_extended_address  Extended address
+ *
+ * \return bucket index
+ */
+static uint16_t _addr_index_bucket(const t_addr_index *p_index, const uint8_t *puc_extended_address)
+{
+	uint32_t ul_hash = _addr_hash(puc_extended_address);
+
+	return (uint16_t)((ul_hash ^ (ul_hash >> 16)) & p_index->us_mask);
+}
 
-	lbd_count = 0;
-	for (us_idx = 0; us_idx < MAX_LBDS; us_idx++) {
-		if (!(is_null_address(g_lbds_list[us_idx].puc_extended_address))) {
-			lbd_count++;
+/**
+ * \brief Looks for an extended address in a hash index
+ *
+ * \param p_index               Hash index
+ * \param puc_extended_address  Extended address
+ * \param pus_bucket            Bucket where the address is stored
+ *
+ * \return true if found, false otherwise.
+ */
+static bool _addr_index_find(const t_addr_index *p_index, const uint8_t *puc_extended_address, uint16_t *pus_bucket)
+{
+	uint16_t us_bucket;
+	uint16_t us_entry;
+
+	us_bucket = _addr_index_bucket(p_index, puc_extended_address);
+	/* Index is bigger than the table, so there is always an empty bucket */
+	while ((us_entry = p_index->pus_buckets[us_bucket]) != 0) {
+		if (!memcmp(ADDR_INDEX_KEY(p_index, us_entry - 1), puc_extended_address, ADP_ADDRESS_64BITS)) {
+			*pus_bucket = us_bucket;
+			return true;
 		}
+
+		us_bucket = (us_bucket + 1) & p_index->us_mask;
 	}
 
-	return lbd_count;
+	return false;
+}
+
+/**
+ * \brief Adds a table position to a hash index.
+ * The extended address must be already copied in the table.
+ *
+ * \param p_index      Hash index
+ * \param us_position  Position in the table
+ */
+static void _addr_index_insert(const t_addr_index *p_index, uint16_t us_position)
+{
+	uint16_t us_bucket;
+
+	us_bucket = _addr_index_bucket(p_index, ADDR_INDEX_KEY(p_index, us_position));
+	while (p_index->pus_buckets[us_bucket] != 0) {
+		us_bucket = (us_bucket + 1) & p_index->us_mask;
+	}
+
+	p_index->pus_buckets[us_bucket] = us_position + 1;
+}
+
+/**
+ * \brief Removes an extended address from a hash index. Following entries
+ * of the probe sequence are shifted back, so no tombstones are needed.
+ * Must be called before clearing the address in the table.
+ *
+ * \param p_index               Hash index
+ * \param puc_extended_address  Extended address
+ */
+static void _addr_index_remove(const t_addr_index *p_index, const uint8_t *puc_extended_address)
+{
+	uint16_t *pus_buckets = p_index->pus_buckets;
+	uint16_t us_hole;
+	uint16_t us_next;
+	uint16_t us_home;
+
+	if (!_addr_index_find(p_index, puc_extended_address, &us_hole)) {
+		return;
+	}
+
+	pus_buckets[us_hole] = 0;
+	us_next = us_hole;
+	while (1) {
+		us_next = (us_next + 1) & p_index->us_mask;
+		if (pus_buckets[us_next] == 0) {
+			break;
+		}
+
+		us_home = _addr_index_bucket(p_index, ADDR_INDEX_KEY(p_index, pus_buckets[us_next] - 1));
+		/* Entry stays if its home bucket is cyclically in (hole, next] */
+		if (us_hole <= us_next) {
+			if ((us_home > us_hole) && (us_home <= us_next)) {
+				continue;
+			}
+		} else {
+			if ((us_home > us_hole) || (us_home <= us_next)) {
+				continue;
+			}
+		}
+
+		pus_buckets[us_hole] = pus_buckets[us_next];
+		pus_buckets[us_next] = 0;
+		us_hole = us_next;
+	}
+}
+
+/**
+ * \brief Returns if a position of the LBDs list is in use
+ *
+ * \param us_position  Position in LBDs list
+ *
+ * \return true / false.
+ */
+static bool _lbds_bitmap_is_set(uint16_t us_position)
+{
+	return ((g_lbds_bitmap[us_position >> 5] & (1UL << (us_position & 0x1F))) != 0);
+}
+
+/**
+ * \brief Looks for the first free position of the LBDs list
+ *
+ * \param pus_position  Free position found
+ *
+ * \return true if found, false if the list is full.
+ */
+static bool _lbds_bitmap_find_free(uint16_t *pus_position)
+{
+	uint16_t us_word;
+	uint16_t us_position;
+	uint32_t ul_free;
+
+	for (us_word = 0; us_word < BS_LBDS_BITMAP_WORDS; us_word++) {
+		ul_free = ~g_lbds_bitmap[us_word];
+		if (ul_free == 0) {
+			continue;
+		}
+
+		us_position = us_word << 5;
+		while (!(ul_free & 1UL)) {
+			ul_free >>= 1;
+			us_position++;
+		}
+
+		if (us_position < MAX_LBDS) {
+			*pus_position = us_position;
+			return true;
+		}
+
+		/* Free bits beyond MAX_LBDS in the last word */
+		break;
+	}
+
+	return false;
+}
+
+/**
+ * \brief Returns the number of active LBDs
+ *
+ * \return number of active LBDs
+ */
+uint16_t get_lbds_count(void)
+{
+	/* Counter is kept in sync with the used positions bitmap */
+	return g_lbds_counter;
+}
+
+/**
+ * \brief Returns the LBDs list generation, incremented whenever a device
+ *        leaves or the extended to short address mapping changes.
+ *        Lets users cache address lookups and flush them on change.
+ *
+ * \return LBDs list generation
+ */
+uint32_t get_lbds_generation(void)
+{
+	return g_lbds_generation;
 }
 
 /**
@@ -222,12 +507,16 @@ void remove_lbds_list_entry(uint16_t us_short_address)
 		LOG_BOOTSTRAP(("[BS] Error: attempted to deactivate an address out of range [0x%04x]\r\n", us_short_address));
 		return;
 	} else {
+		uint16_t us_position = us_short_address - g_current_context.initialShortAddr;
+
 		/* Check if the address is active */
-		if (!is_null_address(g_lbds_list[us_short_address - g_current_context.initialShortAddr].puc_extended_address)) {
+		if (_lbds_bitmap_is_set(us_position)) {
 			/* Deactivate address */
-			memset(&g_lbds_list[us_short_address -
-					g_current_context.initialShortAddr].puc_extended_address, 0, ADP_ADDRESS_64BITS * sizeof(uint8_t));
+			_addr_index_remove(&sx_lbds_index, g_lbds_list[us_position].puc_extended_address);
+			memset(&g_lbds_list[us_position].puc_extended_address, 0, ADP_ADDRESS_64BITS * sizeof(uint8_t));
+			g_lbds_bitmap[us_position >> 5] &= ~(1UL << (us_position & 0x1F));
 			g_lbds_counter--;
+			g_lbds_generation++;
 		} else {
 			/* The address is not active -> The device hasn't joined */
 			LOG_BOOTSTRAP(("[BS] Error: attempted to deactivate an inactive address [0x%04x]\r\n", us_short_address));
@@ -259,7 +548,7 @@ uint16_t get_new_address(struct TAdpExtendedAddress lbdAddress)
 
 		return us_short_address;
 	} else {
-		uint16_t i = 0;
+		uint16_t us_position;
 
 		/* If the end of the list is not reached, give the next address & increase list size */
 		if (g_lbds_list_size < MAX_LBDS) {
@@ -267,16 +556,11 @@ uint16_t get_new_address(struct TAdpExtendedAddress lbdAddress)
 			g_lbds_list_size++;
 			return (us_short_address);
 		} else {
-			/* End of the list reached: Go through the list to find free positions */
-			while ((i < MAX_LBDS)) {
-				/* Check if the position is free (null extended address) */
-				if (is_null_address(g_lbds_list[i].puc_extended_address)) {
-					/* Free position: Return the address (calculated with the index and the initial short address) */
-					us_short_address = i + g_current_context.initialShortAddr;
-					return (us_short_address);
-				}
-
-				i++;
+			/* End of the list reached: Look for free positions in the bitmap */
+			if (_lbds_bitmap_find_free(&us_position)) {
+				/* Free position: Return the address (calculated with the index and the initial short address) */
+				us_short_address = us_position + g_current_context.initialShortAddr;
+				return (us_short_address);
 			}
 		}
 
@@ -306,8 +590,14 @@ bool add_lbds_list_entry(const uint8_t *puc_extended_address, uint16_t us_short_
 	uint16_t us_position = us_short_address - g_current_context.initialShortAddr;
 	uint16_t us_dummy_short_address;
 
+	/* Null extended address is used to mark free positions */
+	if (is_null_address((uint8_t *)puc_extended_address)) {
+		LOG_BOOTSTRAP(("[BS] Null extended address, not added to list\r\n"));
+		return false;
+	}
+
 	/* Check if the short address is already in use */
-	if (!is_null_address(g_lbds_list[us_position].puc_extended_address)) {
+	if (_lbds_bitmap_is_set(us_position)) {
 		LOG_BOOTSTRAP(("[BS] Short address already in use [0x%04x], not added to list\r\n", us_short_address));
 		return false;
 	}
@@ -323,6 +613,8 @@ bool add_lbds_list_entry(const uint8_t *puc_extended_address, uint16_t us_short_
 
 	memcpy(g_lbds_list[us_position].puc_extended_address, puc_extended_address, 8);
 	g_lbds_list[us_position].uc_lbp_hops = uc_lbp_hops;
+	g_lbds_bitmap[us_position >> 5] |= (1UL << (us_position & 0x1F));
+	_addr_index_insert(&sx_lbds_index, us_position);
 	LOG_BOOTSTRAP(("[BS] Added address [0x%04x]  LBP HOPS = %d\r\n", us_short_address, uc_lbp_hops));
 	g_lbds_counter++;
 	LOG_BOOTSTRAP(("[BS] Total num. devices: %d.\r\n", g_lbds_counter));
@@ -371,7 +663,7 @@ bool bs_get_ext_addr_by_short(uint16_t us_short_address, uint8_t *puc_extended_a
 
 /**
  * \brief Function to handle joined devices list as a hash, indexed
- *        by extended address
+ *        by extended address. Lookup is done through the LBDs hash index.
  *
  * \param
  *
@@ -379,29 +671,12 @@ bool bs_get_ext_addr_by_short(uint16_t us_short_address, uint8_t *puc_extended_a
  */
 bool bs_get_short_addr_by_ext(uint8_t *puc_extended_address, uint16_t *pus_short_address)
 {
-	uint16_t i = 0;
-	uint16_t j = 0;
+	uint16_t us_bucket;
 	bool found = false;
 
-	while (j < g_lbds_list_size) {
-		if (!is_null_address(g_lbds_list[j].puc_extended_address)) {
-			/* Check if the short address matches */
-			found = true;
-			for (i = 0; i < ADP_ADDRESS_64BITS; i++) {
-				/* If any of the bytes of the address isn't null, go on. */
-				if (puc_extended_address[i] != g_lbds_list[j].puc_extended_address[i]) {
-					found = false;
-					break;
-				}
-			}
-		}
-
-		if (found) {
-			*pus_short_address = j + g_current_context.initialShortAddr;
-			break;
-		}
-
-		j++;
+	if (_addr_index_find(&sx_lbds_index, puc_extended_address, &us_bucket)) {
+		*pus_short_address = (g_lbds_hash[us_bucket] - 1) + g_current_context.initialShortAddr;
+		found = true;
 	}
 
 	if (found) {
@@ -465,6 +740,7 @@ bool set_initial_short_address(uint16_t us_short_addr)
 			return false;
 		} else {
 			g_current_context.initialShortAddr = us_short_addr;
+			g_lbds_generation++;
 			return true;
 		}
 	}
@@ -564,6 +840,7 @@ void set_psk(uint8_t *puc_new_psk)
 {
 	if (puc_new_psk != NULL) {
 		memcpy(g_EapPskKey.m_au8Value, puc_new_psk, 16);
+		g_bEapPskInitialContextValid = false;
 	}
 }
 
@@ -583,11 +860,16 @@ void lbp_init_functions(void)
 	/* Initialize LBP blacklist */
 	us_blacklist_size = 0;
 	memset(puc_blacklist, 0, MAX_LBDS * ADP_ADDRESS_64BITS);
+	memset(g_blacklist_hash, 0, sizeof(g_blacklist_hash));
+	memset(g_blacklist_bloom, 0, sizeof(g_blacklist_bloom));
 
 	/* Initialize LBP list */
 	g_lbds_counter = 0;
 	g_lbds_list_size = 0;
 	memset(g_lbds_list, 0, MAX_LBDS * sizeof(lbds_list_entry_t));
+	memset(g_lbds_hash, 0, sizeof(g_lbds_hash));
+	memset(g_lbds_bitmap, 0, sizeof(g_lbds_bitmap));
+	g_lbds_generation++;
 
 	if (g_s_bs_conf.m_u8BandInfo == ADP_BAND_ARIB) {
 		g_IdS.uc_size = NETWORK_ACCESS_IDENTIFIER_MAX_SIZE_S;
@@ -622,7 +904,12 @@ void Process_Joining0(struct TAdpExtendedAddress pLBPEUI64Address, t_bootstrap_s
 
 	LOG_BOOTSTRAP(("[BS] Process Joining 0.\r\n"));
 
-	EAP_PSK_Initialize(&g_EapPskKey, &p_bs_slot->m_PskContext);
+	if (!g_bEapPskInitialContextValid) {
+		EAP_PSK_Initialize(&g_EapPskKey, &g_EapPskInitialContext);
+		g_bEapPskInitialContextValid = true;
+	}
+
+	p_bs_slot->m_PskContext = g_EapPskInitialContext;
 
 	/* initialize RandS */
 	uint8_t i;
@@ -711,20 +998,29 @@ uint8_t process_accepted_GMK_activation(struct TAdpExtendedAddress au8LBPEUI64Ad
 	return(uc_result);
 }
 
+/**
+ * \brief Logs the busy slots (free slots have nothing to show)
+ *
+ */
 void log_show_slots_status(void)
 {
-	uint8_t uc_i;
-	for (uc_i = 0; uc_i < BOOTSTRAP_NUM_SLOTS; uc_i++) {
+#ifdef BOOTSTRAP_DEBUG_ENABLE
+	t_bootstrap_slot *p_bs_slot;
+	uint16_t us_i;
+
+	for (us_i = 0; us_i < g_slots_heap_size; us_i++) {
+		p_bs_slot = g_slots_heap[us_i];
 		LOG_BOOTSTRAP((
 					"[BS] Updating slot %hu with LBD_ADDR: %02X:%02X:%02X:%02X:%02X:%02X:%02X:%02X, \
 					state: %hu, handler: %hu  pending_cfrms: %hu  Timeout: %u, Current_Time: %u \r\n",
-					uc_i, bootstrap_slots[uc_i].m_LbdAddress.m_au8Value[0], bootstrap_slots[uc_i].m_LbdAddress.m_au8Value[1],
-					bootstrap_slots[uc_i].m_LbdAddress.m_au8Value[2], bootstrap_slots[uc_i].m_LbdAddress.m_au8Value[3],
-					bootstrap_slots[uc_i].m_LbdAddress.m_au8Value[4], bootstrap_slots[uc_i].m_LbdAddress.m_au8Value[5],
-					bootstrap_slots[uc_i].m_LbdAddress.m_au8Value[6], bootstrap_slots[uc_i].m_LbdAddress.m_au8Value[7],
-					bootstrap_slots[uc_i].e_state, bootstrap_slots[uc_i].uc_tx_handle, bootstrap_slots[uc_i].uc_pending_confirms,
-					bootstrap_slots[uc_i].ul_timeout, oss_get_up_time_ms()));
+					(uint16_t)(p_bs_slot - bootstrap_slots), p_bs_slot->m_LbdAddress.m_au8Value[0], p_bs_slot->m_LbdAddress.m_au8Value[1],
+					p_bs_slot->m_LbdAddress.m_au8Value[2], p_bs_slot->m_LbdAddress.m_au8Value[3],
+					p_bs_slot->m_LbdAddress.m_au8Value[4], p_bs_slot->m_LbdAddress.m_au8Value[5],
+					p_bs_slot->m_LbdAddress.m_au8Value[6], p_bs_slot->m_LbdAddress.m_au8Value[7],
+					p_bs_slot->e_state, p_bs_slot->uc_tx_handle, p_bs_slot->uc_pending_confirms,
+					p_bs_slot->ul_timeout, oss_get_up_time_ms()));
 	}
+#endif
 }
 
 /**
@@ -894,18 +1190,64 @@ static bool Process_Joining_EAP_T3(struct TAdpExtendedAddress au8LBPEUI64Address
 	}
 }
 
+/**
+ * \brief Adds an extended address to the blacklist Bloom filter
+ *
+ */
+static void _blacklist_bloom_add(const uint8_t *puc_address)
+{
+	uint32_t ul_hash = _addr_hash(puc_address);
+	uint32_t ul_step = (ul_hash >> 16) | 1;
+	uint32_t ul_bit;
+	uint8_t i;
+
+	for (i = 0; i < BS_BLACKLIST_BLOOM_HASHES; i++) {
+		ul_bit = (ul_hash + i * ul_step) & BS_BLACKLIST_BLOOM_MASK;
+		g_blacklist_bloom[ul_bit >> 5] |= (1UL << (ul_bit & 0x1F));
+	}
+}
+
+/**
+ * \brief Checks an extended address against the blacklist Bloom filter
+ *
+ * \return false if the address is surely not in the blacklist
+ */
+static bool _blacklist_bloom_check(const uint8_t *puc_address)
+{
+	uint32_t ul_hash = _addr_hash(puc_address);
+	uint32_t ul_step = (ul_hash >> 16) | 1;
+	uint32_t ul_bit;
+	uint8_t i;
+
+	for (i = 0; i < BS_BLACKLIST_BLOOM_HASHES; i++) {
+		ul_bit = (ul_hash + i * ul_step) & BS_BLACKLIST_BLOOM_MASK;
+		if (!(g_blacklist_bloom[ul_bit >> 5] & (1UL << (ul_bit & 0x1F)))) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
 /**
  * \brief Add to blacklist
  *
+ * \return 1 if the device is in the blacklist, 0 if the blacklist is full
  */
 uint8_t add_to_blacklist(uint8_t *puc_address)
 {
-	/* TO DO: advanced list management (defragment list, etc...) */
-
+	uint16_t us_bucket;
 	uint8_t uc_status = 1;
 
+	if (_addr_index_find(&sx_blacklist_index, puc_address, &us_bucket)) {
+		/* Already blacklisted */
+		return uc_status;
+	}
+
 	if (us_blacklist_size < MAX_LBDS) {
 		memcpy(puc_blacklist[us_blacklist_size], puc_address, ADP_ADDRESS_64BITS);
+		_addr_index_insert(&sx_blacklist_index, us_blacklist_size);
+		_blacklist_bloom_add(puc_address);
 		us_blacklist_size++;
 	} else {
 		/* Blacklist full - error */
@@ -916,20 +1258,67 @@ uint8_t add_to_blacklist(uint8_t *puc_address)
 }
 
 /**
- * \brief Remove from blacklist
+ * \brief Remove from blacklist. The last entry is moved to the freed position,
+ * so the blacklist is kept without holes and entry indexes may change.
+ *
+ * \param us_index  Index in the blacklist
  *
+ * \return 1 if removed, 0 if the index is not in use
  */
 uint8_t remove_from_blacklist(uint16_t us_index)
 {
-	uint8_t uc_status = 0;
+	uint16_t us_last;
+	uint16_t us_bucket;
+	uint16_t i;
 
-	/* TO DO: advanced list management (defragment list, etc...) */
-	if (us_index < MAX_LBDS) {
-		memset(puc_blacklist[us_index], 0, ADP_ADDRESS_64BITS);
-		uc_status = 1;
+	if (us_index >= us_blacklist_size) {
+		return 0;
 	}
 
-	return uc_status;
+	us_last = us_blacklist_size - 1;
+	_addr_index_remove(&sx_blacklist_index, puc_blacklist[us_index]);
+	if (us_index != us_last) {
+		/* Move last entry to the freed position and update its bucket */
+		_addr_index_find(&sx_blacklist_index, puc_blacklist[us_last], &us_bucket);
+		memcpy(puc_blacklist[us_index], puc_blacklist[us_last], ADP_ADDRESS_64BITS);
+		g_blacklist_hash[us_bucket] = us_index + 1;
+	}
+
+	memset(puc_blacklist[us_last], 0, ADP_ADDRESS_64BITS);
+	us_blacklist_size--;
+
+	/* Bloom filter does not support deletion: rebuild it (removal is rare) */
+	memset(g_blacklist_bloom, 0, sizeof(g_blacklist_bloom));
+	for (i = 0; i < us_blacklist_size; i++) {
+		_blacklist_bloom_add(puc_blacklist[i]);
+	}
+
+	return 1;
+}
+
+/**
+ * \brief Remove a device from blacklist by its extended address
+ *
+ * \return 1 if removed, 0 if the device is not in the blacklist
+ */
+uint8_t remove_address_from_blacklist(uint8_t *puc_address)
+{
+	uint16_t us_bucket;
+
+	if (!_addr_index_find(&sx_blacklist_index, puc_address, &us_bucket)) {
+		return 0;
+	}
+
+	return remove_from_blacklist(g_blacklist_hash[us_bucket] - 1);
+}
+
+/**
+ * \brief Returns the number of blacklisted devices
+ *
+ */
+uint16_t get_blacklist_count(void)
+{
+	return us_blacklist_size;
 }
 
 /**
@@ -938,19 +1327,13 @@ uint8_t remove_from_blacklist(uint16_t us_index)
  */
 static uint8_t _dev_is_in_blacklist(uint8_t *puc_address)
 {
-	uint16_t i = 0;
-	uint8_t uc_found = 0;
-
-	while (i < us_blacklist_size) {
-		if (!memcmp(puc_address, puc_blacklist[i], ADP_ADDRESS_64BITS)) {
-			uc_found = 1;
-			break;
-		}
+	uint16_t us_bucket;
 
-		i++;
+	if (!_blacklist_bloom_check(puc_address)) {
+		return 0;
 	}
 
-	return uc_found;
+	return _addr_index_find(&sx_blacklist_index, puc_address, &us_bucket) ? 1 : 0;
 }
 
 /**
@@ -1019,9 +1402,8 @@ enum lbp_indications ProcessLBPMessage(struct TAdpLbpIndication *pLbpIndication)
 				/* Check if the joining device is blacklisted */
 				if (_dev_is_in_blacklist(m_current_LbdAddress.m_au8Value)) {
 					p_bs_slot->us_data_length = Encode_decline(m_current_LbdAddress.m_au8Value, p_bs_slot);
-					p_bs_slot->e_state = BS_STATE_SENT_EAP_MSG_DECLINED;
-					memcpy(p_bs_slot->m_LbdAddress.m_au8Value, m_current_LbdAddress.m_au8Value,
-							sizeof(m_current_LbdAddress.m_au8Value));
+					set_bootstrap_slot_state(p_bs_slot, BS_STATE_SENT_EAP_MSG_DECLINED);
+					set_bootstrap_slot_addr(p_bs_slot, m_current_LbdAddress.m_au8Value);
 					LOG_BOOTSTRAP(("[BS] Slot updated to BS_STATE_SENT_EAP_MSG_DECLINED\r\n"));
 				} else {
 					if (p_bs_slot->e_state == BS_STATE_WAITING_JOINNING) {
@@ -1048,10 +1430,9 @@ enum lbp_indications ProcessLBPMessage(struct TAdpLbpIndication *pLbpIndication)
 							p_bs_slot->us_lba_src_addr = pLbpIndication->m_u16SrcAddr;
 							memcpy(ext_address_in_process.m_au8Value, m_current_LbdAddress.m_au8Value,
 									sizeof(m_current_LbdAddress.m_au8Value));
-							memcpy(p_bs_slot->m_LbdAddress.m_au8Value, m_current_LbdAddress.m_au8Value,
-									sizeof(m_current_LbdAddress.m_au8Value));
+							set_bootstrap_slot_addr(p_bs_slot, m_current_LbdAddress.m_au8Value);
 							Process_Joining0(m_current_LbdAddress, p_bs_slot);
-							p_bs_slot->e_state = BS_STATE_SENT_EAP_MSG_1;
+							set_bootstrap_slot_state(p_bs_slot, BS_STATE_SENT_EAP_MSG_1);
 							LOG_BOOTSTRAP(("[BS] Slot updated to BS_STATE_SENT_EAP_MSG_1\r\n"));
 						} else {
 							LOG_BOOTSTRAP(("[BS] LBP JOINNING IGNORED due to level restriction\r\n"));
@@ -1063,10 +1444,9 @@ enum lbp_indications ProcessLBPMessage(struct TAdpLbpIndication *pLbpIndication)
 						p_bs_slot->us_lba_src_addr = pLbpIndication->m_u16SrcAddr;
 						memcpy(ext_address_in_process.m_au8Value, m_current_LbdAddress.m_au8Value,
 								sizeof(m_current_LbdAddress.m_au8Value));
-						memcpy(p_bs_slot->m_LbdAddress.m_au8Value, m_current_LbdAddress.m_au8Value,
-								sizeof(m_current_LbdAddress.m_au8Value));
+						set_bootstrap_slot_addr(p_bs_slot, m_current_LbdAddress.m_au8Value);
 						Process_Joining0(m_current_LbdAddress, p_bs_slot);
-						p_bs_slot->e_state = BS_STATE_SENT_EAP_MSG_1;
+						set_bootstrap_slot_state(p_bs_slot, BS_STATE_SENT_EAP_MSG_1);
 						LOG_BOOTSTRAP(("[BS] Slot updated to BS_STATE_SENT_EAP_MSG_1\r\n"));
 #endif
 					} else {
@@ -1075,6 +1455,9 @@ enum lbp_indications ProcessLBPMessage(struct TAdpLbpIndication *pLbpIndication)
 				}
 			} else {
 				LOG_BOOTSTRAP(("[BS] No slots available to process the request. Ignored.\r\n"));
+				/* Notify upper layer so it can throttle LBAs */
+				g_slots_full_cnt++;
+				lbp_indication = LBS_SLOTS_FULL;
 			}
 		} else {
 			/* Check if the message comes from a device currently under BS */
@@ -1101,13 +1484,13 @@ enum lbp_indications ProcessLBPMessage(struct TAdpLbpIndication *pLbpIndication)
 								if (Process_Joining_EAP_T1(m_current_LbdAddress, u16EAPDataLength, pEAPData, p_bs_slot) != 1) {
 									/* Abort current BS process */
 									LOG_BOOTSTRAP(("[BS] LBP error processing EAP T1.\r\n"));
-									p_bs_slot->e_state = BS_STATE_WAITING_JOINNING;
+									set_bootstrap_slot_state(p_bs_slot, BS_STATE_WAITING_JOINNING);
 									p_bs_slot->uc_pending_confirms = 0;
 									p_bs_slot->ul_nonce =  0;
 
 									LOG_BOOTSTRAP(("[BS] Slot updated to BS_STATE_WAITING_JOINNING\r\n"));
 								} else {
-									p_bs_slot->e_state = BS_STATE_SENT_EAP_MSG_3;
+									set_bootstrap_slot_state(p_bs_slot, BS_STATE_SENT_EAP_MSG_3);
 									LOG_BOOTSTRAP(("[BS] Slot updated to BS_STATE_SENT_EAP_MSG_3\r\n"));
 								}
 							} else if (u8TSubfield == EAP_PSK_T3 &&
@@ -1115,11 +1498,11 @@ enum lbp_indications ProcessLBPMessage(struct TAdpLbpIndication *pLbpIndication)
 									BS_STATE_SENT_EAP_MSG_3)) {
 								if (Process_Joining_EAP_T3(m_current_LbdAddress, pBootStrappingData, u16EAPDataLength, pEAPData,
 										p_bs_slot)) {
-									p_bs_slot->e_state = BS_STATE_SENT_EAP_MSG_ACCEPTED;
+									set_bootstrap_slot_state(p_bs_slot, BS_STATE_SENT_EAP_MSG_ACCEPTED);
 									LOG_BOOTSTRAP(("[BS] Slot updated to BS_STATE_SENT_EAP_MSG_ACCEPTED\r\n"));
 								} else {
 									LOG_BOOTSTRAP(("[BS] LBP error processing EAP T3.\r\n"));
-									p_bs_slot->e_state = BS_STATE_WAITING_JOINNING;
+									set_bootstrap_slot_state(p_bs_slot, BS_STATE_WAITING_JOINNING);
 									p_bs_slot->uc_pending_confirms = 0;
 									p_bs_slot->ul_nonce =  0;
 									LOG_BOOTSTRAP(("[BS] Slot updated to BS_STATE_WAITING_JOINNING\r\n"));
@@ -1127,7 +1510,7 @@ enum lbp_indications ProcessLBPMessage(struct TAdpLbpIndication *pLbpIndication)
 							} else {
 								/* Abort current BS process */
 								LOG_BOOTSTRAP(("[BS] LBP protocol error.\r\n"));
-								p_bs_slot->e_state = BS_STATE_WAITING_JOINNING;
+								set_bootstrap_slot_state(p_bs_slot, BS_STATE_WAITING_JOINNING);
 								p_bs_slot->uc_pending_confirms = 0;
 								p_bs_slot->ul_nonce =  0;
 								LOG_BOOTSTRAP(("[BS] Slot updated to BS_STATE_WAITING_JOINNING\r\n"));
@@ -1136,7 +1519,7 @@ enum lbp_indications ProcessLBPMessage(struct TAdpLbpIndication *pLbpIndication)
 					} else {
 						/* Abort current BS process */
 						LOG_BOOTSTRAP(("[BS] ERROR decoding message.\r\n"));
-						p_bs_slot->e_state = BS_STATE_WAITING_JOINNING;
+						set_bootstrap_slot_state(p_bs_slot, BS_STATE_WAITING_JOINNING);
 						p_bs_slot->uc_pending_confirms = 0;
 						p_bs_slot->ul_nonce =  0;
 						LOG_BOOTSTRAP(("[BS] Slot updated to BS_STATE_WAITING_JOINNING\r\n"));
@@ -1164,25 +1547,21 @@ enum lbp_indications ProcessLBPMessage(struct TAdpLbpIndication *pLbpIndication)
 				dstAddr.m_u16ShortAddr = pLbpIndication->m_u16SrcAddr;
 			}
 
-			if (p_bs_slot->uc_pending_confirms > 0) {
-				p_bs_slot->uc_pending_tx_handler = p_bs_slot->uc_tx_handle;
-			}
-
-			p_bs_slot->uc_tx_handle = get_next_nsdu_handler();
-			p_bs_slot->ul_timeout = oss_get_up_time_ms() + 1000 * us_msg_timeout_in_s * 10;
+			set_bootstrap_slot_timeout(p_bs_slot, oss_get_up_time_ms() + 1000 * us_msg_timeout_in_s * 10);
 			p_bs_slot->uc_tx_attemps = 0;
-			p_bs_slot->uc_pending_confirms++;
-
-			log_show_slots_status();
-			LOG_BOOTSTRAP(("[BS] AdpLbpRequest Called, handler: %d \r\n", p_bs_slot->uc_tx_handle));
-			AdpLbpRequest((struct TAdpAddress const *)&dstAddr,         /* Destination address */
-					p_bs_slot->us_data_length,                  /* NSDU length */
-					&p_bs_slot->auc_data[0],                    /* NSDU */
-					p_bs_slot->uc_tx_handle,                    /* NSDU handle */
-					g_s_bs_conf.m_u8MaxHop,                     /* Max. Hops */
-					true,                                       /* Discover route */
-					0,                                          /* QoS */
-					false);                                     /* Security enable */
+			/* Without a free handle the message is sent again on timeout */
+			if (set_bootstrap_slot_tx_handle(p_bs_slot)) {
+				log_show_slots_status();
+				LOG_BOOTSTRAP(("[BS] AdpLbpRequest Called, handler: %d \r\n", p_bs_slot->uc_tx_handle));
+				AdpLbpRequest((struct TAdpAddress const *)&dstAddr,         /* Destination address */
+						p_bs_slot->us_data_length,                  /* NSDU length */
+						&p_bs_slot->auc_data[0],                    /* NSDU */
+						p_bs_slot->uc_tx_handle,                    /* NSDU handle */
+						g_s_bs_conf.m_u8MaxHop,                     /* Max. Hops */
+						true,                                       /* Discover route */
+						0,                                          /* QoS */
+						false);                                     /* Security enable */
+			}
 		}
 	}
 
@@ -1217,17 +1596,24 @@ uint16_t Encode_kick_to_LBD(uint8_t *p_ext_addr, uint16_t u16MessageLength, uint
  */
 uint16_t Encode_decline(uint8_t *p_ext_addr, t_bootstrap_slot *p_bs_slot)
 {
-	uint8_t *pMessageBuffer = &p_bs_slot->auc_data[0];
-	uint16_t u16MessageLength = sizeof(p_bs_slot->auc_data);
+#ifdef G3_HYBRID_PROFILE
+	return Encode_decline_to_LBD(p_ext_addr, (p_bs_slot->m_u8MediaType << 3) | (p_bs_slot->m_u8DisableBackupMedium << 2),
+			sizeof(p_bs_slot->auc_data), &p_bs_slot->auc_data[0]);
+#else
+	return Encode_decline_to_LBD(p_ext_addr, 0, sizeof(p_bs_slot->auc_data), &p_bs_slot->auc_data[0]);
+#endif
+}
 
+/**
+ * \brief Encode decline to LBD, with the media type flags of the first byte
+ *
+ */
+uint16_t Encode_decline_to_LBD(uint8_t *p_ext_addr, uint8_t u8MediaFlags, uint16_t u16MessageLength, uint8_t *pMessageBuffer)
+{
 	uint16_t u16EncodedLength = 0;
 
 	if (u16MessageLength >= ADP_ADDRESS_64BITS + 2) {
-#ifdef G3_HYBRID_PROFILE
-		pMessageBuffer[0] = (LBP_DECLINE  << 4) | (p_bs_slot->m_u8MediaType << 3) | (p_bs_slot->m_u8DisableBackupMedium << 2);
-#else
-		pMessageBuffer[0] = (LBP_DECLINE  << 4);
-#endif
+		pMessageBuffer[0] = (LBP_DECLINE  << 4) | u8MediaFlags;
 		pMessageBuffer[1] = 0; /* transaction id is reserved */
 
 		memcpy(&pMessageBuffer[2], p_ext_addr, ADP_ADDRESS_64BITS);
@@ -1247,48 +1633,317 @@ uint16_t Encode_decline(uint8_t *p_ext_addr, t_bootstrap_slot *p_bs_slot)
 	return u16EncodedLength;
 }
 
+/**
+ * \brief Returns true if a slot waits for the confirm of this NSDU handle
+ *
+ */
+static bool _nsdu_handle_is_pending(uint8_t uc_handle)
+{
+	t_bootstrap_slot *p_bs_slot = g_nsdu_handle_slots[uc_handle];
+
+	if ((p_bs_slot == NULL) || (p_bs_slot->uc_pending_confirms == 0)) {
+		return false;
+	}
+
+	return (p_bs_slot->uc_tx_handle == uc_handle) ||
+	       ((p_bs_slot->uc_pending_confirms > 1) && (p_bs_slot->uc_pending_tx_handler == uc_handle));
+}
+
+/**
+ * \brief Takes the next NSDU handle no slot waits a confirm for
+ *
+ * \return false if every handle waits for a confirm
+ */
+static bool _get_free_nsdu_handle(uint8_t *puc_handle)
+{
+	uint16_t us_tries;
+
+	for (us_tries = 0; us_tries < 256; us_tries++) {
+		*puc_handle = uc_nsdu_handle++;
+		if (!_nsdu_handle_is_pending(*puc_handle)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool get_free_nsdu_handler(uint8_t *puc_handle)
+{
+	return _get_free_nsdu_handle(puc_handle);
+}
+
 uint8_t get_next_nsdu_handler(void)
 {
-	return uc_nsdu_handle++;
+	uint8_t uc_handle;
+
+	/* With all handles pending (more than 256 joins on air) this one is shared */
+	_get_free_nsdu_handle(&uc_handle);
+	return uc_handle;
+}
+
+/**
+ * \brief Gives the slot a new NSDU handle, unique among the pending confirms,
+ * and counts the confirm as pending
+ *
+ * \return false if every handle waits for a confirm: the message must not be
+ * sent now, it is sent again when the slot times out
+ */
+bool set_bootstrap_slot_tx_handle(t_bootstrap_slot *p_bs_slot)
+{
+	uint8_t uc_handle;
+
+	if (!_get_free_nsdu_handle(&uc_handle)) {
+		LOG_BOOTSTRAP(("[BS] No free NSDU handle, message delayed to timeout\r\n"));
+		return false;
+	}
+
+	if (p_bs_slot->uc_pending_confirms > 0) {
+		p_bs_slot->uc_pending_tx_handler = p_bs_slot->uc_tx_handle;
+	}
+
+	p_bs_slot->uc_tx_handle = uc_handle;
+	p_bs_slot->uc_pending_confirms++;
+	g_nsdu_handle_slots[uc_handle] = p_bs_slot;
+
+	return true;
+}
+
+t_bootstrap_slot *get_bootstrap_slot_by_nsdu_handle(uint8_t uc_handle)
+{
+	return g_nsdu_handle_slots[uc_handle];
+}
+
+/**
+ * \brief Returns if a timeout happens before another one (wrap around safe)
+ *
+ */
+static bool _slot_timeout_before(uint32_t ul_timeout_a, uint32_t ul_timeout_b)
+{
+	return ((int32_t)(ul_timeout_a - ul_timeout_b) < 0);
+}
+
+/**
+ * \brief Places a slot in a position of the timeout heap
+ *
+ */
+static void _slots_heap_set(uint16_t us_pos, t_bootstrap_slot *p_bs_slot)
+{
+	g_slots_heap[us_pos] = p_bs_slot;
+	p_bs_slot->us_heap_pos = us_pos;
+}
+
+/**
+ * \brief Moves a slot up in the timeout heap until heap order is restored
+ *
+ */
+static void _slots_heap_up(uint16_t us_pos)
+{
+	t_bootstrap_slot *p_bs_slot = g_slots_heap[us_pos];
+	uint16_t us_parent;
+
+	while (us_pos > 0) {
+		us_parent = (us_pos - 1) >> 1;
+		if (!_slot_timeout_before(p_bs_slot->ul_timeout, g_slots_heap[us_parent]->ul_timeout)) {
+			break;
+		}
+
+		_slots_heap_set(us_pos, g_slots_heap[us_parent]);
+		us_pos = us_parent;
+	}
+
+	_slots_heap_set(us_pos, p_bs_slot);
+}
+
+/**
+ * \brief Moves a slot down in the timeout heap until heap order is restored
+ *
+ */
+static void _slots_heap_down(uint16_t us_pos)
+{
+	t_bootstrap_slot *p_bs_slot = g_slots_heap[us_pos];
+	uint16_t us_child;
+
+	while (1) {
+		us_child = (us_pos << 1) + 1;
+		if (us_child >= g_slots_heap_size) {
+			break;
+		}
+
+		if ((us_child + 1 < g_slots_heap_size) &&
+				_slot_timeout_before(g_slots_heap[us_child + 1]->ul_timeout, g_slots_heap[us_child]->ul_timeout)) {
+			us_child++;
+		}
+
+		if (!_slot_timeout_before(g_slots_heap[us_child]->ul_timeout, p_bs_slot->ul_timeout)) {
+			break;
+		}
+
+		_slots_heap_set(us_pos, g_slots_heap[us_child]);
+		us_pos = us_child;
+	}
+
+	_slots_heap_set(us_pos, p_bs_slot);
+}
+
+/**
+ * \brief Removes a slot from the timeout heap
+ *
+ */
+static void _slots_heap_remove(t_bootstrap_slot *p_bs_slot)
+{
+	t_bootstrap_slot *p_moved_slot;
+	uint16_t us_pos = p_bs_slot->us_heap_pos;
+
+	p_bs_slot->us_heap_pos = BS_SLOT_NO_POS;
+	g_slots_heap_size--;
+	if (us_pos != g_slots_heap_size) {
+		/* Fill the gap with the last slot and restore heap order */
+		p_moved_slot = g_slots_heap[g_slots_heap_size];
+		_slots_heap_set(us_pos, p_moved_slot);
+		_slots_heap_up(us_pos);
+		_slots_heap_down(p_moved_slot->us_heap_pos);
+	}
+}
+
+/**
+ * \brief Removes a slot from the free slots list
+ *
+ */
+static void _free_slots_remove(t_bootstrap_slot *p_bs_slot)
+{
+	uint16_t us_pos = p_bs_slot->us_free_pos;
+
+	p_bs_slot->us_free_pos = BS_SLOT_NO_POS;
+	g_free_slots_size--;
+	if (us_pos != g_free_slots_size) {
+		g_free_slots[us_pos] = g_free_slots[g_free_slots_size];
+		g_free_slots[us_pos]->us_free_pos = us_pos;
+	}
+}
+
+/**
+ * \brief Returns if the address of a slot is the unused one (all 0xFF)
+ *
+ */
+static bool _is_unused_slot_addr(const uint8_t *puc_extended_address)
+{
+	uint8_t i;
+
+	for (i = 0; i < ADP_ADDRESS_64BITS; i++) {
+		if (puc_extended_address[i] != 0xFF) {
+			return false;
+		}
+	}
+
+	return true;
 }
 
 void  init_bootstrap_slots(void)
 {
-	uint8_t uc_i;
+	uint16_t us_i;
+
+	memset(g_slots_hash, 0, sizeof(g_slots_hash));
+	g_slots_heap_size = 0;
+	g_free_slots_size = 0;
+	g_slots_full_cnt = 0;
+	memset(g_nsdu_handle_slots, 0, sizeof(g_nsdu_handle_slots));
+
+	for (us_i = 0; us_i < BOOTSTRAP_NUM_SLOTS; us_i++) {
+		bootstrap_slots[us_i].e_state =  BS_STATE_WAITING_JOINNING;
+		bootstrap_slots[us_i].uc_pending_confirms = 0;
+		bootstrap_slots[us_i].uc_tx_handle =  0xff;
+		bootstrap_slots[us_i].ul_nonce =  0;
+		bootstrap_slots[us_i].uc_lbp_hops =  0;
+		bootstrap_slots[us_i].ul_timeout = 0xFFFFFFFF;
+
+		memset(bootstrap_slots[us_i].m_LbdAddress.m_au8Value, 0xff, 8);
+
+		bootstrap_slots[us_i].us_heap_pos = BS_SLOT_NO_POS;
+		bootstrap_slots[us_i].us_free_pos = g_free_slots_size;
+		g_free_slots[g_free_slots_size++] = &bootstrap_slots[us_i];
+	}
+}
+
+/**
+ * \brief Changes the state of a bootstrap slot, moving it between the free
+ * slots list and the timeout heap when needed
+ *
+ */
+void set_bootstrap_slot_state(t_bootstrap_slot *p_bs_slot, enum e_bootstrap_slot_state e_state)
+{
+	bool b_was_free = (p_bs_slot->e_state == BS_STATE_WAITING_JOINNING);
+	bool b_is_free = (e_state == BS_STATE_WAITING_JOINNING);
+
+	p_bs_slot->e_state = e_state;
+
+	if (b_was_free && !b_is_free) {
+		_free_slots_remove(p_bs_slot);
+		_slots_heap_set(g_slots_heap_size, p_bs_slot);
+		g_slots_heap_size++;
+		_slots_heap_up(p_bs_slot->us_heap_pos);
+	} else if (!b_was_free && b_is_free) {
+		_slots_heap_remove(p_bs_slot);
+		p_bs_slot->us_free_pos = g_free_slots_size;
+		g_free_slots[g_free_slots_size++] = p_bs_slot;
+	}
+}
+
+/**
+ * \brief Changes the timeout of a bootstrap slot, keeping the timeout heap sorted
+ *
+ */
+void set_bootstrap_slot_timeout(t_bootstrap_slot *p_bs_slot, uint32_t ul_timeout)
+{
+	uint32_t ul_old_timeout = p_bs_slot->ul_timeout;
+
+	p_bs_slot->ul_timeout = ul_timeout;
+
+	if (p_bs_slot->us_heap_pos != BS_SLOT_NO_POS) {
+		if (_slot_timeout_before(ul_timeout, ul_old_timeout)) {
+			_slots_heap_up(p_bs_slot->us_heap_pos);
+		} else {
+			_slots_heap_down(p_bs_slot->us_heap_pos);
+		}
+	}
+}
+
+/**
+ * \brief Changes the LBD address of a bootstrap slot, keeping the slots index updated
+ *
+ */
+void set_bootstrap_slot_addr(t_bootstrap_slot *p_bs_slot, const uint8_t *puc_extended_address)
+{
+	if (!memcmp(p_bs_slot->m_LbdAddress.m_au8Value, puc_extended_address, ADP_ADDRESS_64BITS)) {
+		return;
+	}
 
-	for (uc_i = 0; uc_i < BOOTSTRAP_NUM_SLOTS; uc_i++) {
-		bootstrap_slots[uc_i].e_state =  BS_STATE_WAITING_JOINNING;
-		bootstrap_slots[uc_i].uc_pending_confirms = 0;
-		bootstrap_slots[uc_i].uc_tx_handle =  0xff;
-		bootstrap_slots[uc_i].ul_nonce =  0;
-		bootstrap_slots[uc_i].uc_lbp_hops =  0;
+	if (!_is_unused_slot_addr(p_bs_slot->m_LbdAddress.m_au8Value)) {
+		_addr_index_remove(&sx_slots_index, p_bs_slot->m_LbdAddress.m_au8Value);
+	}
 
-		memset(bootstrap_slots[uc_i].m_LbdAddress.m_au8Value, 0xff, 8);
+	memcpy(p_bs_slot->m_LbdAddress.m_au8Value, puc_extended_address, ADP_ADDRESS_64BITS);
+
+	if (!_is_unused_slot_addr(puc_extended_address)) {
+		_addr_index_insert(&sx_slots_index, (uint16_t)(p_bs_slot - bootstrap_slots));
 	}
 }
 
 t_bootstrap_slot *get_bootstrap_slot_by_addr(uint8_t *p_eui64)
 {
-	uint8_t uc_i;
+	uint16_t us_bucket;
 	t_bootstrap_slot *p_out_slot = NULL;
 
 	/* Check if the lbd is already started */
-	for (uc_i = 0; uc_i < BOOTSTRAP_NUM_SLOTS; uc_i++) {
-		if (!memcmp(bootstrap_slots[uc_i].m_LbdAddress.m_au8Value, p_eui64, 8)) {
-			p_out_slot = &bootstrap_slots[uc_i];
-			LOG_BOOTSTRAP(("[BS] get_bootstrap_slot_by_addr --> Slot in use found: %d \r\n", uc_i));
-			break;
-		}
+	if (!_is_unused_slot_addr(p_eui64) && _addr_index_find(&sx_slots_index, p_eui64, &us_bucket)) {
+		p_out_slot = &bootstrap_slots[g_slots_hash[us_bucket] - 1];
+		LOG_BOOTSTRAP(("[BS] get_bootstrap_slot_by_addr --> Slot in use found: %d \r\n", g_slots_hash[us_bucket] - 1));
 	}
+
 	/* If lbd not in progress find free slot */
-	if (!p_out_slot) {
-		for (uc_i = 0; uc_i < BOOTSTRAP_NUM_SLOTS; uc_i++) {
-			if (bootstrap_slots[uc_i].e_state ==  BS_STATE_WAITING_JOINNING) {
-				p_out_slot = &bootstrap_slots[uc_i];
-				LOG_BOOTSTRAP(("[BS] get_bootstrap_slot_by_addr --> Slot free found: %d \r\n", uc_i));
-				break;
-			}
-		}
+	if (!p_out_slot && (g_free_slots_size > 0)) {
+		p_out_slot = g_free_slots[g_free_slots_size - 1];
+		LOG_BOOTSTRAP(("[BS] get_bootstrap_slot_by_addr --> Slot free found: %d \r\n", (int)(p_out_slot - bootstrap_slots)));
 	}
 
 	if (!p_out_slot) {
@@ -1298,93 +1953,115 @@ t_bootstrap_slot *get_bootstrap_slot_by_addr(uint8_t *p_eui64)
 	return p_out_slot;
 }
 
-t_bootstrap_slot *get_bootstrap_slot_by_index(uint8_t uc_index)
+t_bootstrap_slot *get_bootstrap_slot_by_index(uint16_t us_index)
 {
-	return &bootstrap_slots[uc_index];
+	return &bootstrap_slots[us_index];
 }
 
-void  update_bootstrap_slots(void)
+uint16_t get_free_bootstrap_slots(void)
 {
-	uint8_t uc_i;
-	for (uc_i = 0; uc_i < BOOTSTRAP_NUM_SLOTS; uc_i++) {
-		/* log_show_slots_status(); */
-		if (bootstrap_slots[uc_i].e_state != BS_STATE_WAITING_JOINNING) {
-			if (timeout_is_past(bootstrap_slots[uc_i].ul_timeout)) {
-				if (bootstrap_slots[uc_i].uc_pending_confirms == 0) {
-					if (bootstrap_slots[uc_i].uc_tx_attemps < BOOTSTRAP_MSG_MAX_RETRIES) {
-						bootstrap_slots[uc_i].uc_tx_attemps++;
-						if (bootstrap_slots[uc_i].e_state == BS_STATE_WAITING_EAP_MSG_2) {
-							bootstrap_slots[uc_i].e_state = BS_STATE_SENT_EAP_MSG_1;
-							LOG_BOOTSTRAP(("[BS] Slot updated to BS_STATE_SENT_EAP_MSG_1\r\n"));
-							log_show_slots_status();
-						} else if (bootstrap_slots[uc_i].e_state == BS_STATE_WAITING_EAP_MSG_4) {
-							bootstrap_slots[uc_i].e_state = BS_STATE_SENT_EAP_MSG_3;
-							LOG_BOOTSTRAP(("[BS] Slot updated to BS_STATE_SENT_EAP_MSG_3\r\n"));
-							log_show_slots_status();
-						}
+	return g_free_slots_size;
+}
 
-						struct TAddress dstAddr;
+uint32_t get_slots_full_counter(void)
+{
+	return g_slots_full_cnt;
+}
 
-						if (bootstrap_slots[uc_i].us_data_length > 0) {
-							if (bootstrap_slots[uc_i].us_lba_src_addr == 0xFFFF) {
-								dstAddr.m_u8AddrLength = 8;
-								memcpy(dstAddr.m_u8ExtendedAddr, &bootstrap_slots[uc_i].m_LbdAddress.m_au8Value, 8);
-							} else {
-								dstAddr.m_u8AddrLength = 2;
-								dstAddr.m_u16ShortAddr = bootstrap_slots[uc_i].us_lba_src_addr;
-							}
+/**
+ * \brief Handles the timeout of a busy bootstrap slot
+ *
+ */
+static void _process_slot_timeout(t_bootstrap_slot *p_bs_slot)
+{
+	if (p_bs_slot->uc_pending_confirms == 0) {
+		if (p_bs_slot->uc_tx_attemps < BOOTSTRAP_MSG_MAX_RETRIES) {
+			p_bs_slot->uc_tx_attemps++;
+			if (p_bs_slot->e_state == BS_STATE_WAITING_EAP_MSG_2) {
+				set_bootstrap_slot_state(p_bs_slot, BS_STATE_SENT_EAP_MSG_1);
+				LOG_BOOTSTRAP(("[BS] Slot updated to BS_STATE_SENT_EAP_MSG_1\r\n"));
+				log_show_slots_status();
+			} else if (p_bs_slot->e_state == BS_STATE_WAITING_EAP_MSG_4) {
+				set_bootstrap_slot_state(p_bs_slot, BS_STATE_SENT_EAP_MSG_3);
+				LOG_BOOTSTRAP(("[BS] Slot updated to BS_STATE_SENT_EAP_MSG_3\r\n"));
+				log_show_slots_status();
+			}
 
-							if (bootstrap_slots[uc_i].uc_pending_confirms > 0) {
-								bootstrap_slots[uc_i].uc_pending_tx_handler = bootstrap_slots[uc_i].uc_tx_handle;
-							}
+			struct TAddress dstAddr;
 
-							bootstrap_slots[uc_i].uc_tx_handle = get_next_nsdu_handler();
-							bootstrap_slots[uc_i].ul_timeout = oss_get_up_time_ms() + 1000 * us_msg_timeout_in_s * 10;
-							bootstrap_slots[uc_i].uc_pending_confirms++;
-
-							LOG_BOOTSTRAP(("[BS] Timeout detected. Re-sending MSG for slot: %d Attempt: %d \r\n", uc_i,
-									bootstrap_slots[uc_i].uc_tx_attemps));
-							log_show_slots_status();
-							LOG_BOOTSTRAP(("[BS] AdpLbpRequest Called, handler: %d \r\n", bootstrap_slots[uc_i].uc_tx_handle));
-							AdpLbpRequest((struct TAdpAddress const *)&dstAddr,         /* Destination address */
-									bootstrap_slots[uc_i].us_data_length,       /* NSDU length */
-									&bootstrap_slots[uc_i].auc_data[0],         /* NSDU */
-									bootstrap_slots[uc_i].uc_tx_handle,         /* NSDU handle */
-									g_s_bs_conf.m_u8MaxHop,                     /* Max. Hops */
-									true,                                       /* Discover route */
-									0,                                          /* QoS */
-									false);                                     /* Security enable */
-						}
-					} else {
-						LOG_BOOTSTRAP(("[BS] Reset slot %d:  \r\n", uc_i));
-						bootstrap_slots[uc_i].e_state = BS_STATE_WAITING_JOINNING;
-						bootstrap_slots[uc_i].uc_pending_confirms = 0;
-						bootstrap_slots[uc_i].ul_nonce =  0;
-						bootstrap_slots[uc_i].ul_timeout = 0xFFFFFFFF;
-					}
-				} else { /* Pending confirm then increase timeout time */
-					LOG_BOOTSTRAP(("[BS] NEVER SHOUL BE HERE --> Reset slot %d:  \r\n", uc_i));
-					bootstrap_slots[uc_i].e_state = BS_STATE_WAITING_JOINNING;
-					bootstrap_slots[uc_i].uc_pending_confirms = 0;
-					bootstrap_slots[uc_i].ul_nonce =  0;
-					bootstrap_slots[uc_i].ul_timeout = 0xFFFFFFFF;
+			if (p_bs_slot->us_data_length > 0) {
+				if (p_bs_slot->us_lba_src_addr == 0xFFFF) {
+					dstAddr.m_u8AddrLength = 8;
+					memcpy(dstAddr.m_u8ExtendedAddr, &p_bs_slot->m_LbdAddress.m_au8Value, 8);
+				} else {
+					dstAddr.m_u8AddrLength = 2;
+					dstAddr.m_u16ShortAddr = p_bs_slot->us_lba_src_addr;
+				}
+
+				set_bootstrap_slot_timeout(p_bs_slot, oss_get_up_time_ms() + 1000 * us_msg_timeout_in_s * 10);
+				if (set_bootstrap_slot_tx_handle(p_bs_slot)) {
+					LOG_BOOTSTRAP(("[BS] Timeout detected. Re-sending MSG for slot: %d Attempt: %d \r\n", (int)(p_bs_slot - bootstrap_slots),
+							p_bs_slot->uc_tx_attemps));
+					log_show_slots_status();
+					LOG_BOOTSTRAP(("[BS] AdpLbpRequest Called, handler: %d \r\n", p_bs_slot->uc_tx_handle));
+					AdpLbpRequest((struct TAdpAddress const *)&dstAddr,         /* Destination address */
+							p_bs_slot->us_data_length,                  /* NSDU length */
+							&p_bs_slot->auc_data[0],                    /* NSDU */
+							p_bs_slot->uc_tx_handle,                    /* NSDU handle */
+							g_s_bs_conf.m_u8MaxHop,                     /* Max. Hops */
+							true,                                       /* Discover route */
+							0,                                          /* QoS */
+							false);                                     /* Security enable */
+				} else {
+					/* No free handle: not sent, not counted, tried again on next timeout */
+					p_bs_slot->uc_tx_attemps--;
 				}
 			}
+		} else {
+			LOG_BOOTSTRAP(("[BS] Reset slot %d:  \r\n", (int)(p_bs_slot - bootstrap_slots)));
+			set_bootstrap_slot_state(p_bs_slot, BS_STATE_WAITING_JOINNING);
+			p_bs_slot->uc_pending_confirms = 0;
+			p_bs_slot->ul_nonce =  0;
+			set_bootstrap_slot_timeout(p_bs_slot, 0xFFFFFFFF);
+		}
+	} else { /* Pending confirm then increase timeout time */
+		LOG_BOOTSTRAP(("[BS] NEVER SHOUL BE HERE --> Reset slot %d:  \r\n", (int)(p_bs_slot - bootstrap_slots)));
+		set_bootstrap_slot_state(p_bs_slot, BS_STATE_WAITING_JOINNING);
+		p_bs_slot->uc_pending_confirms = 0;
+		p_bs_slot->ul_nonce =  0;
+		set_bootstrap_slot_timeout(p_bs_slot, 0xFFFFFFFF);
+	}
+}
+
+void  update_bootstrap_slots(void)
+{
+	t_bootstrap_slot *p_bs_slot;
+
+	/* Only slots with expired timeout are visited, in timeout order */
+	while (g_slots_heap_size > 0) {
+		p_bs_slot = g_slots_heap[0];
+		if (!timeout_is_past(p_bs_slot->ul_timeout)) {
+			break;
+		}
+
+		_process_slot_timeout(p_bs_slot);
+
+		/* Still busy and expired (nothing re-sent): push its timeout forward so the slots behind it are processed */
+		if ((p_bs_slot->us_heap_pos != BS_SLOT_NO_POS) && timeout_is_past(p_bs_slot->ul_timeout)) {
+			set_bootstrap_slot_timeout(p_bs_slot, oss_get_up_time_ms() + 1000 * us_msg_timeout_in_s);
 		}
 	}
 }
 
 uint8_t  get_max_hops_from_nodes_under_registering(void)
 {
-	uint8_t uc_i;
+	uint16_t us_i;
 	uint8_t uc_result = 0;
-	for (uc_i = 0; uc_i < BOOTSTRAP_NUM_SLOTS; uc_i++) {
-		/* log_show_slots_status(); */
-		if (bootstrap_slots[uc_i].e_state != BS_STATE_WAITING_JOINNING) {
-			if (!timeout_is_past(bootstrap_slots[uc_i].ul_timeout)) {
-				if (bootstrap_slots[uc_i].uc_lbp_hops > uc_result) {
-					uc_result = bootstrap_slots[uc_i].uc_lbp_hops;
-				}
+	/* Busy slots are the ones in the timeout heap */
+	for (us_i = 0; us_i < g_slots_heap_size; us_i++) {
+		if (!timeout_is_past(g_slots_heap[us_i]->ul_timeout)) {
+			if (g_slots_heap[us_i]->uc_lbp_hops > uc_result) {
+				uc_result = g_slots_heap[us_i]->uc_lbp_hops;
 			}
 		}
 	}
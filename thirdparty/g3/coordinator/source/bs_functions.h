@@ -4,6 +4,7 @@
 #include <stdbool.h>
 #include <bs_api.h>
 #include <BootstrapWrapper.h>
+#include "conf_bs.h"
 
 #define BS_MAX_JOIN_TIME  250000
 
@@ -40,8 +41,11 @@ enum e_bootstrap_slot_state {
 	BS_STATE_SENT_EAP_MSG_DECLINED,
 };
 
-/* BOOTSTRAP_NUM_SLOTS defines the number of parallel bootstrap procedures that must be carried out */
+/* BOOTSTRAP_NUM_SLOTS defines the number of parallel bootstrap procedures that must be carried out.
+ * It can be overridden in conf_bs.h (up to 1024) */
+#ifndef BOOTSTRAP_NUM_SLOTS
 #define BOOTSTRAP_NUM_SLOTS 5
+#endif
 #define BOOTSTRAP_MSG_MAX_RETRIES 1
 
 typedef struct {
@@ -64,6 +68,8 @@ typedef struct {
   	uint8_t m_u8MediaType;
   	uint8_t m_u8DisableBackupMedium;
 #endif
+	uint16_t us_heap_pos; /* Position in timeout heap (busy slots) */
+	uint16_t us_free_pos; /* Position in free slots list (BS_STATE_WAITING_JOINNING) */
 } t_bootstrap_slot;
 
 struct TAddress {
@@ -85,7 +91,8 @@ enum ELbsStatus {
 /* Indications to be notified to the upper layers */
 enum lbp_indications {
 	LBS_NONE = 0,
-	LBS_KICK
+	LBS_KICK,
+	LBS_SLOTS_FULL
 };
 
 #define MAC_SET_REQUEST_VALUE_LEN    16
@@ -182,6 +189,7 @@ typedef struct {
 #define LBP_REKEYING_PHASE_ACTIVATE      1
 
 uint16_t get_lbds_count(void);
+uint32_t get_lbds_generation(void);
 bool is_null_address(uint8_t *puc_extended_address);
 uint16_t get_lbd_address(uint16_t i);
 uint8_t device_is_in_list(uint16_t us_short_address);
@@ -199,11 +207,14 @@ void lbp_init_functions(void);
 void initialize_bootstrap_message(t_bootstrap_slot *p_bs_slot);
 uint8_t add_to_blacklist(uint8_t *puc_address);
 uint8_t remove_from_blacklist(uint16_t us_index);
+uint8_t remove_address_from_blacklist(uint8_t *puc_address);
+uint16_t get_blacklist_count(void);
 enum lbp_indications ProcessLBPMessage(struct TAdpLbpIndication *pLbpIndication);
 void Process_Joining0(struct TAdpExtendedAddress pLBPEUI64Address, t_bootstrap_slot *p_bs_slot );
 uint8_t process_accepted_GMK_activation(struct TAdpExtendedAddress au8LBPEUI64Address, t_bootstrap_slot *p_bs_slot);
 uint16_t Encode_kick_to_LBD(uint8_t *p_ext_addr, uint16_t u16MessageLength, uint8_t *pMessageBuffer);
 uint16_t Encode_decline(uint8_t *p_ext_addr, t_bootstrap_slot *p_bs_slot);
+uint16_t Encode_decline_to_LBD(uint8_t *p_ext_addr, uint8_t u8MediaFlags, uint16_t u16MessageLength, uint8_t *pMessageBuffer);
 uint16_t get_initial_short_address(void);
 bool set_initial_short_address(uint16_t us_short_addr);
 bool get_ib_short_address_from_extended(void);
@@ -221,13 +232,21 @@ void set_psk(uint8_t *puc_new_psk);
 void lbp_set_rekeying(uint8_t on_off);
 uint16_t lbp_get_rekeying(void);
 uint8_t get_next_nsdu_handler(void);
+bool get_free_nsdu_handler(uint8_t *puc_handle);
 
 void set_bs_configuration(TBootstrapConfiguration s_bs_conf);
 TBootstrapConfiguration *get_bs_configuration(void);
 
 void  init_bootstrap_slots(void);
 t_bootstrap_slot *get_bootstrap_slot_by_addr(uint8_t *p_eui64);
-t_bootstrap_slot *get_bootstrap_slot_by_index(uint8_t uc_index);
+t_bootstrap_slot *get_bootstrap_slot_by_index(uint16_t us_index);
+t_bootstrap_slot *get_bootstrap_slot_by_nsdu_handle(uint8_t uc_handle);
+bool set_bootstrap_slot_tx_handle(t_bootstrap_slot *p_bs_slot);
+void set_bootstrap_slot_state(t_bootstrap_slot *p_bs_slot, enum e_bootstrap_slot_state e_state);
+void set_bootstrap_slot_timeout(t_bootstrap_slot *p_bs_slot, uint32_t ul_timeout);
+void set_bootstrap_slot_addr(t_bootstrap_slot *p_bs_slot, const uint8_t *puc_extended_address);
+uint16_t get_free_bootstrap_slots(void);
+uint32_t get_slots_full_counter(void);
 
 void  update_bootstrap_slots(void);
 bool timeout_is_past(uint32_t ul_timeout_value);
@@ -28,6 +28,7 @@ extern lbds_list_entry_t g_lbds_list[MAX_LBDS];
 
 static pf_app_leave_ind_cb_t pf_app_leave_ind_cb;
 static pf_app_join_ind_cb_t pf_app_join_ind_cb;
+static pf_app_slots_full_ind_cb_t pf_app_slots_full_ind_cb;
 
 static void _set_keying_table(uint8_t u8KeyIndex, uint8_t *key)
 {
@@ -57,7 +58,6 @@ static void _rekeying_process(void)
 {
 	struct TAddress dstAddr;
 	struct TAdpExtendedAddress x_ext_address;
-	uint8_t uc_handle;
 
 	memcpy(x_ext_address.m_au8Value, g_lbds_list[us_rekey_idx].puc_extended_address, ADP_ADDRESS_64BITS);
 
@@ -75,11 +75,11 @@ static void _rekeying_process(void)
 			/* If re-keying in GMK distribution phase */
 			/* Send ADPM-LBP.Request(EAPReq(mes1)) to each registered device */
 			Process_Joining0(x_ext_address, p_bs_slot);
-			p_bs_slot->e_state = BS_STATE_SENT_EAP_MSG_1;
-			memcpy(p_bs_slot->m_LbdAddress.m_au8Value, g_lbds_list[us_rekey_idx].puc_extended_address, ADP_ADDRESS_64BITS);
+			set_bootstrap_slot_state(p_bs_slot, BS_STATE_SENT_EAP_MSG_1);
+			set_bootstrap_slot_addr(p_bs_slot, g_lbds_list[us_rekey_idx].puc_extended_address);
 		} else { /* GMK activation phase (LBP_REKEYING_PHASE_ACTIVATE) */
 			process_accepted_GMK_activation(x_ext_address, p_bs_slot);
-			p_bs_slot->e_state = BS_STATE_SENT_EAP_MSG_ACCEPTED;
+			set_bootstrap_slot_state(p_bs_slot, BS_STATE_SENT_EAP_MSG_ACCEPTED);
 		}
 
 		/* Send the previously prepared message */
@@ -87,25 +87,59 @@ static void _rekeying_process(void)
 		/* The short address is calculated using the index and the initial short address */
 		dstAddr.m_u16ShortAddr = us_rekey_idx + get_initial_short_address();
 
-		if (p_bs_slot->uc_pending_confirms > 0) {
-			p_bs_slot->uc_pending_tx_handler = p_bs_slot->uc_tx_handle;
+		set_bootstrap_slot_timeout(p_bs_slot, oss_get_up_time_ms() + 1000 * get_msg_timeout_value() * 10);
+		p_bs_slot->uc_tx_attemps = 0;
+		/* Without a free handle the message is sent again on timeout */
+		if (set_bootstrap_slot_tx_handle(p_bs_slot)) {
+			LOG_BOOTSTRAP(("[BS] AdpLbpRequest Called, handler: %d \r\n", p_bs_slot->uc_tx_handle));
+			AdpLbpRequest((struct TAdpAddress const *)&dstAddr,          /* Destination address */
+					p_bs_slot->us_data_length,                   /* NSDU length */
+					&p_bs_slot->auc_data[0],                     /* NSDU */
+					p_bs_slot->uc_tx_handle,                     /* NSDU handle */
+					get_bs_configuration()->m_u8MaxHop,          /* Max. Hops */
+					true,                                        /* Discover route */
+					0,                                           /* QoS */
+					false);                                      /* Security enable */
 		}
+	}
+}
 
-		uc_handle = get_next_nsdu_handler();
-		p_bs_slot->ul_timeout = oss_get_up_time_ms() + 1000 * get_msg_timeout_value() * 10;
-		p_bs_slot->uc_tx_handle = uc_handle;
-		p_bs_slot->uc_tx_attemps = 0;
-		p_bs_slot->uc_pending_confirms++;
-		LOG_BOOTSTRAP(("[BS] AdpLbpRequest Called, handler: %d \r\n", p_bs_slot->uc_tx_handle));
-		AdpLbpRequest((struct TAdpAddress const *)&dstAddr,          /* Destination address */
-				p_bs_slot->us_data_length,                   /* NSDU length */
-				&p_bs_slot->auc_data[0],                     /* NSDU */
-				uc_handle,                                   /* NSDU handle */
-				get_bs_configuration()->m_u8MaxHop,          /* Max. Hops */
-				true,                                        /* Discover route */
-				0,                                           /* QoS */
-				false);                                      /* Security enable */
+static void _send_slots_full_decline(struct TAdpLbpIndication *pLbpIndication)
+{
+	struct TAdpAddress dstAddr;
+	uint8_t uc_handle;
+	uint8_t uc_media_flags = 0;
+
+	/* Not sent if every handle waits for a confirm: it would be taken for the confirm of a slot */
+	if (!get_free_nsdu_handler(&uc_handle)) {
+		return;
 	}
+
+#ifdef G3_HYBRID_PROFILE
+	uc_media_flags = pLbpIndication->m_pNsdu[0] & 0x0C;
+#endif
+	g_us_length = Encode_decline_to_LBD(&pLbpIndication->m_pNsdu[2], uc_media_flags, sizeof(g_puc_data), g_puc_data);
+	if (g_us_length == 0) {
+		return;
+	}
+
+	if (pLbpIndication->m_u16SrcAddr == 0xFFFF) {
+		dstAddr.m_u8AddrSize = ADP_ADDRESS_64BITS;
+		memcpy(dstAddr.m_ExtendedAddress.m_au8Value, &pLbpIndication->m_pNsdu[2], ADP_ADDRESS_64BITS);
+	} else {
+		dstAddr.m_u8AddrSize = 2;
+		dstAddr.m_u16ShortAddr = pLbpIndication->m_u16SrcAddr;
+	}
+
+	LOG_BOOTSTRAP(("[BS] No slots available, LBP_DECLINE sent, handler: %d \r\n", uc_handle));
+	AdpLbpRequest((struct TAdpAddress const *)&dstAddr,     /* Destination address */
+			g_us_length,                            /* NSDU length */
+			g_puc_data,                             /* NSDU */
+			uc_handle,                              /* NSDU handle */
+			get_bs_configuration()->m_u8MaxHop,     /* Max. Hops */
+			true,                                   /* Discover route */
+			0,                                      /* QoS */
+			false);                                 /* Security enable */
 }
 
 static void AdpNotification_LbpIndication(struct TAdpLbpIndication *pLbpIndication)
@@ -128,22 +162,28 @@ static void AdpNotification_LbpIndication(struct TAdpLbpIndication *pLbpIndicati
 
 		/* Remove the device from the joined devices list */
 		remove_lbds_list_entry(pLbpIndication->m_u16SrcAddr);
+	} else if (indication == LBS_SLOTS_FULL) {
+		/* Decline the joining through its LBA: the LBD tries again later instead of waiting for its join timeout */
+		_send_slots_full_decline(pLbpIndication);
+
+		if (pf_app_slots_full_ind_cb != NULL) {
+			pf_app_slots_full_ind_cb(pLbpIndication->m_u16SrcAddr, &pLbpIndication->m_pNsdu[2]);
+		}
 	}
 }
 
 static void AdpNotification_LbpConfirm(struct TAdpLbpConfirm *pLbpConfirm)
 {
-	uint8_t uc_i;
-
+	t_bootstrap_slot *p_slot;
 	t_bootstrap_slot *p_current_slot = NULL;
 
 	bool b_is_accepted_confirm = false;
 	
 	LOG_BOOTSTRAP(("[BS] AdpNotification_LbpConfirm \r\n"));
 
-	for (uc_i = 0; uc_i < BOOTSTRAP_NUM_SLOTS; uc_i++) {
-		t_bootstrap_slot *p_slot = get_bootstrap_slot_by_index(uc_i);
-
+	/* Handles are unique among pending confirms: only the slot that was given it can match */
+	p_slot = get_bootstrap_slot_by_nsdu_handle(pLbpConfirm->m_u8NsduHandle);
+	if (p_slot != NULL) {
 		if (p_slot->uc_pending_confirms == 1 && pLbpConfirm->m_u8NsduHandle == p_slot->uc_tx_handle && p_slot->e_state != BS_STATE_WAITING_JOINNING) {
 			LOG_BOOTSTRAP(("[BS] AdpNotification_LbpConfirm (%02X:%02X:%02X:%02X:%02X:%02X:%02X:%02X).\r\n",
 					p_slot->m_LbdAddress.m_au8Value[0], p_slot->m_LbdAddress.m_au8Value[1],
@@ -156,19 +196,19 @@ static void AdpNotification_LbpConfirm(struct TAdpLbpConfirm *pLbpConfirm)
 			if (pLbpConfirm->m_u8Status == G3_SUCCESS) {
 				switch (p_slot->e_state) {
 				case BS_STATE_SENT_EAP_MSG_1:
-					p_slot->e_state = BS_STATE_WAITING_EAP_MSG_2;
+					set_bootstrap_slot_state(p_slot, BS_STATE_WAITING_EAP_MSG_2);
 					LOG_BOOTSTRAP(("[BS] Slot updated to BS_STATE_WAITING_EAP_MSG_2\r\n"));
 					log_show_slots_status();
 					break;
 
 				case BS_STATE_SENT_EAP_MSG_3:
-					p_slot->e_state = BS_STATE_WAITING_EAP_MSG_4;
+					set_bootstrap_slot_state(p_slot, BS_STATE_WAITING_EAP_MSG_4);
 					LOG_BOOTSTRAP(("[BS] Slot updated to BS_STATE_WAITING_EAP_MSG_4\r\n"));
 					log_show_slots_status();
 					break;
 
 				case BS_STATE_SENT_EAP_MSG_ACCEPTED:
-					p_slot->e_state = BS_STATE_WAITING_JOINNING;
+					set_bootstrap_slot_state(p_slot, BS_STATE_WAITING_JOINNING);
 					p_slot->ul_nonce =  0;
 					LOG_BOOTSTRAP(("[BS] Slot updated to BS_STATE_WAITING_JOINNING\r\n"));
 					log_show_slots_status();
@@ -176,21 +216,21 @@ static void AdpNotification_LbpConfirm(struct TAdpLbpConfirm *pLbpConfirm)
 					break;
 
 				case BS_STATE_SENT_EAP_MSG_DECLINED:
-					p_slot->e_state = BS_STATE_WAITING_JOINNING;
+					set_bootstrap_slot_state(p_slot, BS_STATE_WAITING_JOINNING);
 					p_slot->ul_nonce =  0;
 					LOG_BOOTSTRAP(("[BS] Slot updated to BS_STATE_WAITING_JOINNING\r\n"));
 					log_show_slots_status();
 					break;
 
 				default:
-					p_slot->e_state = BS_STATE_WAITING_JOINNING;
+					set_bootstrap_slot_state(p_slot, BS_STATE_WAITING_JOINNING);
 					p_slot->ul_nonce =  0;
 					LOG_BOOTSTRAP(("[BS] Slot updated to BS_STATE_WAITING_JOINNING\r\n"));
 					log_show_slots_status();
 					break;
 				}
 			} else {
-				p_slot->e_state = BS_STATE_WAITING_JOINNING;
+				set_bootstrap_slot_state(p_slot, BS_STATE_WAITING_JOINNING);
 				p_slot->ul_nonce =  0;
 				LOG_BOOTSTRAP(("[BS] Slot updated to BS_STATE_WAITING_JOINNING\r\n"));
 				log_show_slots_status();
@@ -225,7 +265,7 @@ static void AdpNotification_LbpConfirm(struct TAdpLbpConfirm *pLbpConfirm)
 		log_show_slots_status();
 		return;
 	} else {
-		p_current_slot->ul_timeout = oss_get_up_time_ms() + 1000 * get_msg_timeout_value();
+		set_bootstrap_slot_timeout(p_current_slot, oss_get_up_time_ms() + 1000 * get_msg_timeout_value());
 	}
 
 	if (pLbpConfirm->m_u8Status == G3_SUCCESS && b_is_accepted_confirm) {
@@ -287,6 +327,7 @@ void bs_init(TBootstrapConfiguration s_bs_conf)
 	/* Init function pointers */
 	pf_app_leave_ind_cb = NULL;
 	pf_app_join_ind_cb = NULL;
+	pf_app_slots_full_ind_cb = NULL;
 }
 
 /**
@@ -381,6 +422,15 @@ uint16_t bs_lbp_get_lbds_counter(void)
 	return get_lbds_count();
 }
 
+/**
+ * bs_lbp_get_lbds_generation.
+ *
+ */
+uint32_t bs_lbp_get_lbds_generation(void)
+{
+	return get_lbds_generation();
+}
+
 /**
  * bs_lbp_get_lbds_address.
  *
@@ -616,3 +666,21 @@ void bs_lbp_join_ind_set_cb(pf_app_join_ind_cb_t pf_handler)
 {
 	pf_app_join_ind_cb = pf_handler;
 }
+
+/**
+ * bs_lbp_slots_full_ind_set_cb.
+ *
+ */
+void bs_lbp_slots_full_ind_set_cb(pf_app_slots_full_ind_cb_t pf_handler)
+{
+	pf_app_slots_full_ind_cb = pf_handler;
+}
+
+/**
+ * bs_lbp_get_free_slots.
+ *
+ */
+uint16_t bs_lbp_get_free_slots(void)
+{
+	return get_free_bootstrap_slots();
+}
@@ -0,0 +1,21 @@
+#ifndef CONF_BS_H_INCLUDE
+#define CONF_BS_H_INCLUDE
+
+/* PAN ID */
+#define G3_COORDINATOR_PAN_ID                   0x781D
+
+/* Maximum number of devices that can join the network */
+#ifndef MAX_LBDS
+#define MAX_LBDS                                1200
+#endif
+
+/* Invalid short address (0 can be only the coordinator) */
+#define LBS_INVALID_SHORT_ADDRESS               0
+
+/* Joins in progress at the same time, more than there are NSDU handles */
+#define BOOTSTRAP_NUM_SLOTS                     1000
+
+/* Initial key index (0 or 1) */
+#define INITIAL_KEY_INDEX                       0
+
+#endif  /* CONF_BS_H_INCLUDE */
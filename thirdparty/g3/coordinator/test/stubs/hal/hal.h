@@ -0,0 +1,8 @@
+#ifndef HAL_H_INCLUDED
+#define HAL_H_INCLUDED
+
+#include <stdint.h>
+
+uint32_t platform_random_32(void);
+
+#endif
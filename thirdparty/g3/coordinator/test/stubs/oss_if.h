@@ -0,0 +1,8 @@
+#ifndef OSS_IF_H_INCLUDED
+#define OSS_IF_H_INCLUDED
+
+#include <stdint.h>
+
+uint32_t oss_get_up_time_ms(void);
+
+#endif
@@ -0,0 +1 @@
+/* mbedtls_config.h includes the device header: nothing needed on the host */
@@ -0,0 +1,303 @@
+/**
+ * \file
+ *
+ * \brief Host test of the coordinator LBP blacklist.
+ *
+ * Random additions and removals, by address and by index, must keep the
+ * blacklist compact and give the same membership and count as a reference
+ * set. Then 10000 first joining requests are replayed through
+ * ProcessLBPMessage() against a 2000 entry blacklist: blacklisted devices
+ * must be declined and the others challenged. The blacklist check is timed
+ * against the former linear scan.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* Bootstrap traces are enabled in this header: keep the output readable */
+#include <BootstrapWrapper.h>
+#undef BOOTSTRAP_DEBUG_ENABLE
+
+#include "../source/bs_functions.c"
+
+#define DEVICES           12000
+#define RANDOM_OPS        200000
+#define BLACKLISTED       2000
+#define JOIN_ATTEMPTS     10000
+/* One join attempt out of 5 from a blacklisted device */
+#define BLACKLISTED_RATIO 5
+#define BENCH_ROUNDS      20
+
+static int si_failures;
+
+#define CHECK(cond) do { \
+		if (!(cond)) { \
+			printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+			si_failures++; \
+		} \
+	} while (0)
+
+static uint32_t sul_rng = 0x12345678;
+static uint8_t sauc_addr[DEVICES][ADP_ADDRESS_64BITS];
+static bool sab_blacklisted[DEVICES];
+static uint16_t saus_attempts[JOIN_ATTEMPTS];
+/* LBP message type of the last message sent by the coordinator */
+static uint8_t suc_sent_type;
+static uint32_t sul_sent;
+
+uint32_t oss_get_up_time_ms(void)
+{
+	return 0;
+}
+
+uint32_t platform_random_32(void)
+{
+	sul_rng ^= sul_rng << 13;
+	sul_rng ^= sul_rng >> 17;
+	sul_rng ^= sul_rng << 5;
+	return sul_rng;
+}
+
+void AdpLbpRequest(const struct TAdpAddress *pDstAddr, uint16_t u16NsduLength, uint8_t *pNsdu, uint8_t u8NsduHandle, uint8_t u8MaxHops,
+		bool bDiscoveryRoute, uint8_t u8QualityOfService, bool bSecurityEnable)
+{
+	suc_sent_type = pNsdu[0] >> 4;
+	sul_sent++;
+}
+
+/* Former _dev_is_in_blacklist() */
+static uint8_t _linear_is_in_blacklist(uint8_t *puc_address)
+{
+	uint16_t i = 0;
+	uint8_t uc_found = 0;
+
+	while (i < us_blacklist_size) {
+		if (!memcmp(puc_address, puc_blacklist[i], ADP_ADDRESS_64BITS)) {
+			uc_found = 1;
+			break;
+		}
+
+		i++;
+	}
+
+	return uc_found;
+}
+
+static void _reset(void)
+{
+	uint16_t us_i;
+	uint8_t uc_j;
+
+	lbp_init_functions();
+	memset(sab_blacklisted, 0, sizeof(sab_blacklisted));
+	for (us_i = 0; us_i < DEVICES; us_i++) {
+		for (uc_j = 0; uc_j < ADP_ADDRESS_64BITS - 2; uc_j++) {
+			sauc_addr[us_i][uc_j] = (uint8_t)platform_random_32();
+		}
+
+		sauc_addr[us_i][6] = (uint8_t)(us_i >> 8);
+		sauc_addr[us_i][7] = (uint8_t)us_i;
+	}
+}
+
+/* Entries [0, count) in use, the rest cleared */
+static bool _is_compact(void)
+{
+	uint16_t us_i;
+
+	for (us_i = 0; us_i < MAX_LBDS; us_i++) {
+		if (is_null_address(puc_blacklist[us_i]) != (us_i >= get_blacklist_count())) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/* Random additions and removals against a reference set */
+static void test_random_ops(void)
+{
+	uint32_t ul_op;
+	uint32_t ul_mismatches = 0;
+	uint16_t us_count = 0;
+	uint16_t us_dev;
+	uint16_t us_index;
+
+	_reset();
+	for (ul_op = 0; ul_op < RANDOM_OPS; ul_op++) {
+		us_dev = platform_random_32() % DEVICES;
+		switch (platform_random_32() % 4) {
+		case 0:
+		case 1:
+			CHECK(add_to_blacklist(sauc_addr[us_dev]) == ((us_count < MAX_LBDS) || sab_blacklisted[us_dev]));
+			if (!sab_blacklisted[us_dev] && (us_count < MAX_LBDS)) {
+				sab_blacklisted[us_dev] = true;
+				us_count++;
+			}
+
+			break;
+
+		case 2:
+			CHECK(remove_address_from_blacklist(sauc_addr[us_dev]) == sab_blacklisted[us_dev]);
+			if (sab_blacklisted[us_dev]) {
+				sab_blacklisted[us_dev] = false;
+				us_count--;
+			}
+
+			break;
+
+		default:
+			/* Removal by index, as done through the LBP IB */
+			us_index = platform_random_32() % (MAX_LBDS + 1);
+			if (us_index < us_count) {
+				us_dev = ((uint16_t)puc_blacklist[us_index][6] << 8) | puc_blacklist[us_index][7];
+				sab_blacklisted[us_dev] = false;
+				us_count--;
+				CHECK(remove_from_blacklist(us_index) == 1);
+			} else {
+				CHECK(remove_from_blacklist(us_index) == 0);
+			}
+
+			break;
+		}
+
+		us_dev = platform_random_32() % DEVICES;
+		if ((_dev_is_in_blacklist(sauc_addr[us_dev]) != sab_blacklisted[us_dev]) || (get_blacklist_count() != us_count)) {
+			ul_mismatches++;
+		}
+
+		if ((ul_op % 1000) == 0) {
+			CHECK(_is_compact());
+		}
+	}
+
+	CHECK(ul_mismatches == 0);
+	CHECK(_is_compact());
+	printf("%u additions and removals, %u blacklisted at the end, %u mismatches\n", (unsigned)RANDOM_OPS, (unsigned)us_count,
+			(unsigned)ul_mismatches);
+}
+
+/* First joining request through ProcessLBPMessage(): LBP message type sent back */
+static uint8_t _join_attempt(uint16_t us_dev)
+{
+	struct TAdpLbpIndication x_ind;
+	struct TAdpExtendedAddress x_addr;
+	uint8_t auc_buf[APD_LBP_REQUEST_BUFF_LEN];
+	t_bootstrap_slot *p_bs_slot;
+
+	memcpy(x_addr.m_au8Value, sauc_addr[us_dev], ADP_ADDRESS_64BITS);
+	x_ind.m_u16SrcAddr = 0xFFFF;
+	x_ind.m_u16NsduLength = LBP_Encode_JoiningRequest(&x_addr, 0, sizeof(auc_buf), auc_buf);
+	x_ind.m_pNsdu = auc_buf;
+	x_ind.m_u8LinkQualityIndicator = 0xFF;
+	x_ind.m_bSecurityEnabled = false;
+	suc_sent_type = 0xFF;
+	ProcessLBPMessage(&x_ind);
+
+	/* Attempt over: release its slot */
+	p_bs_slot = get_bootstrap_slot_by_addr(x_addr.m_au8Value);
+	p_bs_slot->uc_pending_confirms = 0;
+	set_bootstrap_slot_state(p_bs_slot, BS_STATE_WAITING_JOINNING);
+
+	return suc_sent_type;
+}
+
+static double _time_checks(uint8_t (*pf_check)(uint8_t *), uint32_t *pul_found)
+{
+	struct timespec x_start;
+	struct timespec x_end;
+	uint32_t ul_round;
+	uint32_t ul_i;
+
+	*pul_found = 0;
+	clock_gettime(CLOCK_MONOTONIC, &x_start);
+	for (ul_round = 0; ul_round < BENCH_ROUNDS; ul_round++) {
+		for (ul_i = 0; ul_i < JOIN_ATTEMPTS; ul_i++) {
+			*pul_found += pf_check(sauc_addr[saus_attempts[ul_i]]);
+		}
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &x_end);
+	return ((double)(x_end.tv_sec - x_start.tv_sec) * 1e9 + (double)(x_end.tv_nsec - x_start.tv_nsec)) /
+			(BENCH_ROUNDS * JOIN_ATTEMPTS);
+}
+
+/* 10000 join attempts against a 2000 entry blacklist */
+static void test_join_replay(void)
+{
+	struct timespec x_start;
+	struct timespec x_end;
+	uint32_t ul_declined = 0;
+	uint32_t ul_challenged = 0;
+	uint32_t ul_wrong = 0;
+	uint32_t ul_found;
+	uint32_t ul_found_linear;
+	uint32_t ul_i;
+	uint16_t us_dev;
+	uint8_t uc_type;
+	double d_replay;
+	double d_bloom;
+	double d_linear;
+
+	_reset();
+	/* Devices [0, BLACKLISTED) blacklisted */
+	for (us_dev = 0; us_dev < BLACKLISTED; us_dev++) {
+		CHECK(add_to_blacklist(sauc_addr[us_dev]) == 1);
+		sab_blacklisted[us_dev] = true;
+	}
+
+	CHECK(get_blacklist_count() == BLACKLISTED);
+	for (ul_i = 0; ul_i < JOIN_ATTEMPTS; ul_i++) {
+		if ((platform_random_32() % BLACKLISTED_RATIO) == 0) {
+			saus_attempts[ul_i] = platform_random_32() % BLACKLISTED;
+		} else {
+			saus_attempts[ul_i] = BLACKLISTED + platform_random_32() % (DEVICES - BLACKLISTED);
+		}
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &x_start);
+	for (ul_i = 0; ul_i < JOIN_ATTEMPTS; ul_i++) {
+		us_dev = saus_attempts[ul_i];
+		uc_type = _join_attempt(us_dev);
+		if (uc_type == LBP_DECLINE) {
+			ul_declined++;
+		} else if (uc_type == LBP_CHALLENGE) {
+			ul_challenged++;
+		}
+
+		if ((uc_type == LBP_DECLINE) != sab_blacklisted[us_dev]) {
+			ul_wrong++;
+		}
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &x_end);
+	d_replay = ((double)(x_end.tv_sec - x_start.tv_sec) * 1e3 + (double)(x_end.tv_nsec - x_start.tv_nsec) / 1e6);
+
+	CHECK(ul_wrong == 0);
+	CHECK(ul_declined + ul_challenged == JOIN_ATTEMPTS);
+	CHECK(sul_sent == JOIN_ATTEMPTS);
+
+	d_bloom = _time_checks(_dev_is_in_blacklist, &ul_found);
+	d_linear = _time_checks(_linear_is_in_blacklist, &ul_found_linear);
+	CHECK(ul_found == ul_found_linear);
+	CHECK(ul_found == BENCH_ROUNDS * ul_declined);
+	printf("%u join attempts, %u blacklisted: %u declined, %u challenged in %.1f ms\n", (unsigned)JOIN_ATTEMPTS,
+			(unsigned)BLACKLISTED, (unsigned)ul_declined, (unsigned)ul_challenged, d_replay);
+	printf("blacklist check per attempt: %.1f ns, former linear scan %.1f ns\n", d_bloom, d_linear);
+}
+
+int main(void)
+{
+	test_random_ops();
+	test_join_replay();
+
+	if (si_failures) {
+		printf("%d failure(s)\n", si_failures);
+		return 1;
+	}
+
+	printf("OK\n");
+	return 0;
+}
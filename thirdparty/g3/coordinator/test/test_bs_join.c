@@ -0,0 +1,630 @@
+/**
+ * \file
+ *
+ * \brief Host test of the coordinator bootstrap (LBP server).
+ *
+ * Joining devices are emulated with the EAP-PSK peer primitives of
+ * bootstrap_lbp over real AES (mbedTLS). Every message the coordinator sends
+ * through AdpLbpRequest() is queued, confirmed and then handed to the device
+ * it is addressed to, whose answer goes back as an LBP indication. NSDU
+ * handles are checked to be unique among the messages waiting for a confirm.
+ * Also measures the time for 1000 devices starting at once to join, frames
+ * taking their air time one after the other.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* Bootstrap traces are enabled in this header: keep the output readable */
+#include <BootstrapWrapper.h>
+#undef BOOTSTRAP_DEBUG_ENABLE
+
+#include "../source/bs_functions.c"
+#include "../source/bs_main.c"
+
+#define MAX_DEVICES       1000
+#define MAX_FRAMES        (2 * MAX_DEVICES)
+/* Air time of an LBP frame on CENELEC-A, all frames sharing one channel */
+#define FRAME_MS          100
+/* Formation given up after one simulated day */
+#define FORMATION_MAX_MS  (24 * 3600 * 1000UL)
+
+/* EAP-PSK extension with configuration parameters (see ProcessLbp.c) */
+#define EAP_EXT_TYPE_CONFIGURATION_PARAMETERS   0x02
+#define CONF_PARAM_RESULT                       0x31
+#define RESULT_PARAMETER_SUCCESS                0x00
+
+static int si_failures;
+
+#define CHECK(cond) do { \
+		if (!(cond)) { \
+			printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+			si_failures++; \
+		} \
+	} while (0)
+
+/* Emulated device */
+struct device {
+	struct TAdpExtendedAddress x_addr;
+	struct TEapPskKey x_psk;
+	struct TEapPskContext x_ctx;
+	struct TEapPskRand x_rand_s;
+	uint16_t us_short_addr;
+	bool b_joined;
+	bool b_declined;
+};
+
+/* Message sent by the coordinator, waiting for its confirm */
+struct frame {
+	uint8_t uc_handle;
+	uint16_t us_len;
+	uint8_t auc_data[APD_LBP_REQUEST_BUFF_LEN];
+};
+
+static const struct TEapPskKey sx_default_psk = {
+	{0xAB, 0x10, 0x34, 0x11, 0x45, 0x11, 0x1B, 0xC3, 0xC1, 0x2D, 0xE8, 0xFF, 0x11, 0x14, 0x22, 0x04}
+};
+
+/* One more device than bootstrap slots */
+static struct device sx_devices[MAX_DEVICES + 1];
+static struct frame sx_frames[MAX_FRAMES];
+static uint32_t sul_frame_head;
+static uint32_t sul_frame_tail;
+/* NSDU handles waiting for their confirm */
+static bool sab_handle_pending[256];
+static uint16_t sus_handles_pending;
+static uint16_t sus_handles_pending_max;
+
+/* Set by the application in the firmware */
+uint8_t auc_chip_id_container[16];
+
+static TBootstrapAdpNotifications *spx_notifications;
+static uint32_t sul_now;
+static uint32_t sul_rng = 0x12345678;
+/* Time spent in the coordinator handlers */
+static double sd_coordinator_s;
+/* Air time added to the clock by each frame, 0 outside the formation test */
+static uint32_t sul_air_ms;
+static uint16_t sus_joined;
+/* Emulates the former behaviour: AK and KDK derived again on every join */
+static bool sb_derive_per_join;
+
+uint32_t oss_get_up_time_ms(void)
+{
+	return sul_now;
+}
+
+uint32_t platform_random_32(void)
+{
+	sul_rng ^= sul_rng << 13;
+	sul_rng ^= sul_rng >> 17;
+	sul_rng ^= sul_rng << 5;
+	return sul_rng;
+}
+
+void AdpMacSetRequest(uint32_t u32AttributeId, uint16_t u16AttributeIndex, uint8_t u8AttributeLength, const uint8_t *pu8AttributeValue)
+{
+}
+
+void AdpSetRequest(uint32_t u32AttributeId, uint16_t u16AttributeIndex, uint8_t u8AttributeLength, const uint8_t *pu8AttributeValue)
+{
+}
+
+void AdpLbpRequest(const struct TAdpAddress *pDstAddr, uint16_t u16NsduLength, uint8_t *pNsdu, uint8_t u8NsduHandle, uint8_t u8MaxHops,
+		bool bDiscoveryRoute, uint8_t u8QualityOfService, bool bSecurityEnable)
+{
+	struct frame *px_frame = &sx_frames[sul_frame_tail % MAX_FRAMES];
+
+	CHECK(sul_frame_tail - sul_frame_head < MAX_FRAMES);
+	CHECK(u16NsduLength <= sizeof(px_frame->auc_data));
+	CHECK(!sab_handle_pending[u8NsduHandle]);
+	sab_handle_pending[u8NsduHandle] = true;
+	if (++sus_handles_pending > sus_handles_pending_max) {
+		sus_handles_pending_max = sus_handles_pending;
+	}
+
+	px_frame->uc_handle = u8NsduHandle;
+	px_frame->us_len = u16NsduLength;
+	memcpy(px_frame->auc_data, pNsdu, u16NsduLength);
+	sul_frame_tail++;
+}
+
+static double _elapsed_s(const struct timespec *px_start)
+{
+	struct timespec x_now;
+
+	clock_gettime(CLOCK_MONOTONIC, &x_now);
+	return (double)(x_now.tv_sec - px_start->tv_sec) + (double)(x_now.tv_nsec - px_start->tv_nsec) / 1e9;
+}
+
+/* LBP message from a device to the coordinator */
+static void _indication(uint16_t us_len, uint8_t *puc_msg)
+{
+	struct TAdpLbpIndication x_ind;
+	struct timespec x_start;
+
+	x_ind.m_u16SrcAddr = 0xFFFF;
+	x_ind.m_u16NsduLength = us_len;
+	x_ind.m_pNsdu = puc_msg;
+	x_ind.m_u8LinkQualityIndicator = 0xFF;
+	x_ind.m_bSecurityEnabled = false;
+	sul_now += sul_air_ms;
+
+	if (sb_derive_per_join) {
+		g_bEapPskInitialContextValid = false;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &x_start);
+	spx_notifications->fnctAdpLbpIndication(&x_ind);
+	sd_coordinator_s += _elapsed_s(&x_start);
+}
+
+static void _confirm(uint8_t uc_handle, uint8_t uc_status)
+{
+	struct TAdpLbpConfirm x_cfm;
+	struct timespec x_start;
+
+	x_cfm.m_u8Status = uc_status;
+	x_cfm.m_u8NsduHandle = uc_handle;
+	sab_handle_pending[uc_handle] = false;
+	sus_handles_pending--;
+
+	clock_gettime(CLOCK_MONOTONIC, &x_start);
+	spx_notifications->fnctAdpLbpConfirm(&x_cfm);
+	sd_coordinator_s += _elapsed_s(&x_start);
+}
+
+static struct device *_device_by_addr(const struct TAdpExtendedAddress *px_addr)
+{
+	uint16_t us_idx = ((uint16_t)px_addr->m_au8Value[6] << 8) | px_addr->m_au8Value[7];
+
+	if ((us_idx > MAX_DEVICES) || memcmp(px_addr->m_au8Value, sx_devices[us_idx].x_addr.m_au8Value, ADP_ADDRESS_64BITS)) {
+		return NULL;
+	}
+
+	return &sx_devices[us_idx];
+}
+
+static void _device_send_joining(struct device *px_dev, uint16_t us_eap_len, uint8_t *puc_buf, uint16_t us_buf_len)
+{
+	uint16_t us_len = LBP_Encode_JoiningRequest(&px_dev->x_addr, us_eap_len, us_buf_len, puc_buf);
+
+	_indication(us_len, puc_buf);
+}
+
+/* First EAP-PSK message: answer with the second one */
+static void _device_rx_message1(struct device *px_dev, uint8_t uc_identifier, uint16_t us_eap_len, uint8_t *puc_eap)
+{
+	struct TEapPskNetworkAccessIdentifier x_id_s;
+	struct TEapPskNetworkAccessIdentifier x_id_p;
+	struct TEapPskRand x_rand_p;
+	uint8_t auc_buf[APD_LBP_REQUEST_BUFF_LEN];
+	uint16_t us_len;
+	uint8_t uc_i;
+
+	if (!EAP_PSK_Decode_Message1(us_eap_len, puc_eap, &px_dev->x_rand_s, &x_id_s)) {
+		return;
+	}
+
+	x_id_p.m_u8Length = ADP_ADDRESS_64BITS;
+	memcpy(x_id_p.m_au8Value, px_dev->x_addr.m_au8Value, ADP_ADDRESS_64BITS);
+	for (uc_i = 0; uc_i < sizeof(x_rand_p.m_au8Value); uc_i++) {
+		x_rand_p.m_au8Value[uc_i] = (uint8_t)platform_random_32();
+	}
+
+	/* Message 3 is checked against IdS and RandP kept in the context */
+	EAP_PSK_Initialize(&px_dev->x_psk, &px_dev->x_ctx);
+	px_dev->x_ctx.m_IdS = x_id_s;
+	px_dev->x_ctx.m_RandP = x_rand_p;
+	EAP_PSK_InitializeTEK(&x_rand_p, &px_dev->x_ctx);
+	us_len = EAP_PSK_Encode_Message2(&px_dev->x_ctx, uc_identifier, &px_dev->x_rand_s, &x_rand_p, &x_id_s, &x_id_p,
+			sizeof(auc_buf), auc_buf);
+	_device_send_joining(px_dev, us_len, auc_buf, sizeof(auc_buf));
+}
+
+/* Third EAP-PSK message: take the short address and answer with the fourth one */
+static void _device_rx_message3(struct device *px_dev, uint8_t uc_identifier, uint8_t *puc_header, uint16_t us_eap_len,
+		uint8_t *puc_eap)
+{
+	struct TEapPskRand x_rand_s;
+	uint32_t ul_nonce = 0;
+	uint8_t uc_result = 0;
+	uint16_t us_pchannel_len = 0;
+	uint8_t *puc_pchannel = NULL;
+	uint8_t auc_param_result[] = {EAP_EXT_TYPE_CONFIGURATION_PARAMETERS, CONF_PARAM_RESULT, 2, RESULT_PARAMETER_SUCCESS, 0};
+	uint8_t auc_buf[APD_LBP_REQUEST_BUFF_LEN];
+	uint16_t us_len;
+
+	if (!EAP_PSK_Decode_Message3(us_eap_len, puc_eap, &px_dev->x_ctx, 22, puc_header, &x_rand_s, &ul_nonce, &uc_result,
+			&us_pchannel_len, &puc_pchannel)) {
+		return;
+	}
+
+	CHECK(uc_result == PCHANNEL_RESULT_DONE_SUCCESS);
+	CHECK(memcmp(x_rand_s.m_au8Value, px_dev->x_rand_s.m_au8Value, sizeof(x_rand_s.m_au8Value)) == 0);
+	/* Extension, then short address first */
+	CHECK(us_pchannel_len >= 5);
+	CHECK(puc_pchannel[0] == EAP_EXT_TYPE_CONFIGURATION_PARAMETERS);
+	CHECK(puc_pchannel[1] == CONF_PARAM_SHORT_ADDR);
+	px_dev->us_short_addr = ((uint16_t)puc_pchannel[3] << 8) | puc_pchannel[4];
+
+	us_len = EAP_PSK_Encode_Message4(&px_dev->x_ctx, uc_identifier, &x_rand_s, ul_nonce + 1, PCHANNEL_RESULT_DONE_SUCCESS,
+			sizeof(auc_param_result), auc_param_result, sizeof(auc_buf), auc_buf);
+	_device_send_joining(px_dev, us_len, auc_buf, sizeof(auc_buf));
+}
+
+static void _device_rx(uint16_t us_len, uint8_t *puc_msg)
+{
+	struct TAdpExtendedAddress x_addr;
+	struct device *px_dev;
+	uint8_t uc_type;
+	uint16_t us_bs_len;
+	uint8_t *puc_bs;
+	uint8_t uc_code;
+	uint8_t uc_identifier;
+	uint8_t uc_t;
+	uint16_t us_eap_len;
+	uint8_t *puc_eap;
+
+	if (!LBP_Decode_Message(us_len, puc_msg, &uc_type, &x_addr, &us_bs_len, &puc_bs)) {
+		return;
+	}
+
+	px_dev = _device_by_addr(&x_addr);
+	CHECK(px_dev != NULL);
+	if (px_dev == NULL) {
+		return;
+	}
+
+	if (uc_type == LBP_ACCEPTED) {
+		sus_joined += !px_dev->b_joined;
+		px_dev->b_joined = true;
+		return;
+	}
+
+	if (uc_type == LBP_DECLINE) {
+		px_dev->b_declined = true;
+		return;
+	}
+
+	if ((uc_type != LBP_CHALLENGE) ||
+			!EAP_PSK_Decode_Message(us_bs_len, puc_bs, &uc_code, &uc_identifier, &uc_t, &us_eap_len, &puc_eap) ||
+			(uc_code != EAP_REQUEST)) {
+		return;
+	}
+
+	if (uc_t == EAP_PSK_T0) {
+		_device_rx_message1(px_dev, uc_identifier, us_eap_len, puc_eap);
+	} else if (uc_t == EAP_PSK_T2) {
+		_device_rx_message3(px_dev, uc_identifier, puc_bs, us_eap_len, puc_eap);
+	}
+}
+
+/* Confirms and delivers every queued message, and the ones they trigger */
+static void _run(void)
+{
+	struct frame x_frame;
+
+	while (sul_frame_head != sul_frame_tail) {
+		x_frame = sx_frames[sul_frame_head % MAX_FRAMES];
+		sul_frame_head++;
+		sul_now++;
+		_confirm(x_frame.uc_handle, G3_SUCCESS);
+		_device_rx(x_frame.us_len, x_frame.auc_data);
+	}
+}
+
+/* Same, the messages queued at each pass confirmed and delivered in random order */
+static void _run_scrambled(void)
+{
+	static struct frame sax_batch[MAX_FRAMES];
+	struct frame x_frame;
+	uint32_t ul_count;
+	uint32_t ul_i;
+	uint32_t ul_j;
+
+	while (sul_frame_head != sul_frame_tail) {
+		ul_count = 0;
+		while (sul_frame_head != sul_frame_tail) {
+			sax_batch[ul_count++] = sx_frames[sul_frame_head % MAX_FRAMES];
+			sul_frame_head++;
+		}
+
+		for (ul_i = ul_count - 1; ul_i > 0; ul_i--) {
+			ul_j = platform_random_32() % (ul_i + 1);
+			x_frame = sax_batch[ul_i];
+			sax_batch[ul_i] = sax_batch[ul_j];
+			sax_batch[ul_j] = x_frame;
+		}
+
+		for (ul_i = 0; ul_i < ul_count; ul_i++) {
+			sul_now++;
+			_confirm(sax_batch[ul_i].uc_handle, G3_SUCCESS);
+			_device_rx(sax_batch[ul_i].us_len, sax_batch[ul_i].auc_data);
+		}
+	}
+}
+
+static bool _join(struct device *px_dev)
+{
+	uint8_t auc_buf[APD_LBP_REQUEST_BUFF_LEN];
+
+	px_dev->b_joined = false;
+	px_dev->us_short_addr = 0;
+	_device_send_joining(px_dev, 0, auc_buf, sizeof(auc_buf));
+	_run();
+	return px_dev->b_joined;
+}
+
+static void _reset(void)
+{
+	TBootstrapConfiguration x_conf = {ADP_BAND_CENELEC_A, 10};
+	uint16_t us_i;
+
+	bs_init(x_conf);
+	set_psk((uint8_t *)sx_default_psk.m_au8Value);
+	spx_notifications = bs_get_not_handlers();
+	sul_frame_head = sul_frame_tail = 0;
+	sb_derive_per_join = false;
+	sul_air_ms = 0;
+	sus_joined = 0;
+	memset(sab_handle_pending, 0, sizeof(sab_handle_pending));
+	sus_handles_pending = 0;
+	sus_handles_pending_max = 0;
+
+	for (us_i = 0; us_i <= MAX_DEVICES; us_i++) {
+		memset(&sx_devices[us_i], 0, sizeof(sx_devices[us_i]));
+		sx_devices[us_i].x_addr.m_au8Value[0] = 0x00;
+		sx_devices[us_i].x_addr.m_au8Value[1] = 0x80;
+		sx_devices[us_i].x_addr.m_au8Value[2] = 0xE1;
+		sx_devices[us_i].x_addr.m_au8Value[6] = (uint8_t)(us_i >> 8);
+		sx_devices[us_i].x_addr.m_au8Value[7] = (uint8_t)us_i;
+		sx_devices[us_i].x_psk = sx_default_psk;
+	}
+}
+
+/* Every device joins with AK and KDK taken from the context derived once */
+static void test_join(void)
+{
+	struct TEapPskContext x_ctx;
+	uint16_t us_i;
+
+	_reset();
+	for (us_i = 0; us_i < 3; us_i++) {
+		CHECK(_join(&sx_devices[us_i]));
+		CHECK(sx_devices[us_i].us_short_addr != 0);
+		CHECK(device_is_in_list(sx_devices[us_i].us_short_addr));
+	}
+
+	CHECK(sx_devices[0].us_short_addr != sx_devices[1].us_short_addr);
+	CHECK(sx_devices[1].us_short_addr != sx_devices[2].us_short_addr);
+	CHECK(get_lbds_count() == 3);
+	CHECK(get_free_bootstrap_slots() == BOOTSTRAP_NUM_SLOTS);
+
+	EAP_PSK_Initialize(&sx_default_psk, &x_ctx);
+	CHECK(g_bEapPskInitialContextValid);
+	CHECK(memcmp(&x_ctx, &g_EapPskInitialContext, sizeof(x_ctx)) == 0);
+}
+
+/* A new PSK takes effect on the next join */
+static void test_set_psk(void)
+{
+	struct TEapPskKey x_new_psk = {{0x10, 0x21, 0x32, 0x43, 0x54, 0x65, 0x76, 0x87, 0x98, 0xA9, 0xBA, 0xCB, 0xDC, 0xED, 0xFE, 0x0F}};
+
+	_reset();
+	CHECK(_join(&sx_devices[0]));
+
+	set_psk(x_new_psk.m_au8Value);
+	/* Still on the old PSK: message 2 does not authenticate */
+	CHECK(!_join(&sx_devices[1]));
+	CHECK(get_free_bootstrap_slots() == BOOTSTRAP_NUM_SLOTS);
+
+	sx_devices[1].x_psk = x_new_psk;
+	sx_devices[2].x_psk = x_new_psk;
+	CHECK(_join(&sx_devices[1]));
+	CHECK(_join(&sx_devices[2]));
+	CHECK(get_lbds_count() == 3);
+
+	/* And back */
+	set_psk((uint8_t *)sx_default_psk.m_au8Value);
+	CHECK(!_join(&sx_devices[2]));
+	CHECK(_join(&sx_devices[3]));
+}
+
+/* All devices start joining at once: more joins in progress than NSDU handles */
+static void test_concurrent_join(void)
+{
+	static bool sab_short_addr_used[0x10000];
+	uint8_t auc_buf[APD_LBP_REQUEST_BUFF_LEN];
+	uint16_t us_joined = 0;
+	uint16_t us_round;
+	uint16_t us_i;
+
+	_reset();
+	memset(sab_short_addr_used, 0, sizeof(sab_short_addr_used));
+	for (us_i = 0; us_i < MAX_DEVICES; us_i++) {
+		_device_send_joining(&sx_devices[us_i], 0, auc_buf, sizeof(auc_buf));
+	}
+
+	/* One slot per device, but only one message 1 per free handle is sent */
+	CHECK(get_free_bootstrap_slots() == BOOTSTRAP_NUM_SLOTS - MAX_DEVICES);
+	CHECK(sul_frame_tail - sul_frame_head == 256);
+
+	for (us_round = 0; (us_round < 10) && (us_joined < MAX_DEVICES); us_round++) {
+		_run_scrambled();
+		/* The others are sent when their slot times out */
+		sul_now += 1000 * get_msg_timeout_value() * 10 + 1;
+		update_bootstrap_slots();
+
+		us_joined = 0;
+		for (us_i = 0; us_i < MAX_DEVICES; us_i++) {
+			us_joined += sx_devices[us_i].b_joined;
+		}
+	}
+
+	CHECK(us_joined == MAX_DEVICES);
+	CHECK(sul_frame_head == sul_frame_tail);
+	CHECK(sus_handles_pending == 0);
+	CHECK(sus_handles_pending_max == 256);
+	CHECK(get_lbds_count() == MAX_DEVICES);
+	CHECK(get_free_bootstrap_slots() == BOOTSTRAP_NUM_SLOTS);
+	for (us_i = 0; us_i < MAX_DEVICES; us_i++) {
+		CHECK(!sab_short_addr_used[sx_devices[us_i].us_short_addr]);
+		sab_short_addr_used[sx_devices[us_i].us_short_addr] = true;
+	}
+}
+
+/* All slots busy: the extra joining device is declined through its LBA, then joins */
+static void test_slots_full(void)
+{
+	uint8_t auc_buf[APD_LBP_REQUEST_BUFF_LEN];
+	struct device *px_extra = &sx_devices[MAX_DEVICES];
+	uint16_t us_i;
+
+	_reset();
+	for (us_i = 0; us_i < MAX_DEVICES; us_i++) {
+		_device_send_joining(&sx_devices[us_i], 0, auc_buf, sizeof(auc_buf));
+	}
+
+	CHECK(get_free_bootstrap_slots() == 0);
+
+	/* Every handle waits for a confirm: nothing sent */
+	_device_send_joining(px_extra, 0, auc_buf, sizeof(auc_buf));
+	CHECK(get_slots_full_counter() == 1);
+	CHECK(sul_frame_tail - sul_frame_head == 256);
+
+	/* Messages 1 confirmed but lost: handles free, slots still busy */
+	while (sul_frame_head != sul_frame_tail) {
+		_confirm(sx_frames[sul_frame_head % MAX_FRAMES].uc_handle, G3_SUCCESS);
+		sul_frame_head++;
+	}
+
+	_device_send_joining(px_extra, 0, auc_buf, sizeof(auc_buf));
+	CHECK(get_slots_full_counter() == 2);
+	CHECK(sul_frame_tail - sul_frame_head == 1);
+	_run();
+	CHECK(px_extra->b_declined);
+	CHECK(!px_extra->b_joined);
+	CHECK(sus_handles_pending == 0);
+
+	/* Slots freed as the others join */
+	while (get_free_bootstrap_slots() < BOOTSTRAP_NUM_SLOTS) {
+		sul_now += 1000 * get_msg_timeout_value() * 10 + 1;
+		update_bootstrap_slots();
+		_run();
+	}
+
+	CHECK(_join(px_extra));
+}
+
+/* A slot that stays expired after its timeout is processed does not hold back the others */
+static void test_stuck_slot(void)
+{
+	uint8_t auc_buf[APD_LBP_REQUEST_BUFF_LEN];
+	t_bootstrap_slot *p_stuck_slot;
+	uint16_t us_i;
+
+	_reset();
+	for (us_i = 0; us_i < 3; us_i++) {
+		_device_send_joining(&sx_devices[us_i], 0, auc_buf, sizeof(auc_buf));
+		sul_now++;
+	}
+
+	/* Messages 1 confirmed but lost */
+	while (sul_frame_head != sul_frame_tail) {
+		_confirm(sx_frames[sul_frame_head % MAX_FRAMES].uc_handle, G3_SUCCESS);
+		sul_frame_head++;
+	}
+
+	/* First to expire, with nothing to send again */
+	p_stuck_slot = get_bootstrap_slot_by_addr(sx_devices[0].x_addr.m_au8Value);
+	p_stuck_slot->us_data_length = 0;
+	set_bootstrap_slot_timeout(p_stuck_slot, sul_now);
+
+	sul_now += 1000 * get_msg_timeout_value() * 10 + 10;
+	update_bootstrap_slots();
+	CHECK(sul_frame_tail - sul_frame_head == 2);
+	CHECK(!timeout_is_past(p_stuck_slot->ul_timeout));
+	CHECK(p_stuck_slot->e_state != BS_STATE_WAITING_JOINNING);
+
+	/* The other two join */
+	_run();
+	CHECK(!sx_devices[0].b_joined);
+	CHECK(sx_devices[1].b_joined);
+	CHECK(sx_devices[2].b_joined);
+}
+
+/*
+ * Time for all devices, starting at once, to join. Frames are sent one after
+ * the other and slot timeouts are checked every second, as bs_process() does.
+ */
+static uint32_t _form_network(bool b_derive_per_join)
+{
+	uint8_t auc_buf[APD_LBP_REQUEST_BUFF_LEN];
+	struct frame x_frame;
+	uint32_t ul_start;
+	uint32_t ul_second;
+	uint16_t us_i;
+
+	_reset();
+	sb_derive_per_join = b_derive_per_join;
+	sul_air_ms = FRAME_MS;
+	sd_coordinator_s = 0;
+	ul_start = sul_now;
+	ul_second = sul_now / 1000;
+	for (us_i = 0; us_i < MAX_DEVICES; us_i++) {
+		_device_send_joining(&sx_devices[us_i], 0, auc_buf, sizeof(auc_buf));
+	}
+
+	while ((sus_joined < MAX_DEVICES) && (sul_now - ul_start < FORMATION_MAX_MS)) {
+		if (sul_frame_head != sul_frame_tail) {
+			x_frame = sx_frames[sul_frame_head % MAX_FRAMES];
+			sul_frame_head++;
+			sul_now += FRAME_MS;
+			_confirm(x_frame.uc_handle, G3_SUCCESS);
+			_device_rx(x_frame.us_len, x_frame.auc_data);
+		} else {
+			/* Channel idle until the next bs_process() */
+			sul_now += 1000 - sul_now % 1000;
+		}
+
+		if (sul_now / 1000 != ul_second) {
+			ul_second = sul_now / 1000;
+			update_bootstrap_slots();
+		}
+	}
+
+	CHECK(sus_joined == MAX_DEVICES);
+	CHECK(get_lbds_count() == MAX_DEVICES);
+	return sul_now - ul_start;
+}
+
+int main(void)
+{
+	uint32_t ul_formation_ms;
+	double d_derive_s;
+
+	crypto_init();
+	test_join();
+	test_set_psk();
+	test_concurrent_join();
+	test_stuck_slot();
+	test_slots_full();
+
+	_form_network(true);
+	d_derive_s = sd_coordinator_s;
+	ul_formation_ms = _form_network(false);
+	printf("%u joining at once, %u slots, %u ms frames: network formed in %.1f s (%u coordinator frames), coordinator CPU %.1f ms "
+			"(AK/KDK derived per join: %.1f ms)\n", MAX_DEVICES, BOOTSTRAP_NUM_SLOTS, FRAME_MS, ul_formation_ms / 1000.0,
+			(unsigned)sul_frame_tail, sd_coordinator_s * 1e3, d_derive_s * 1e3);
+
+	if (si_failures) {
+		printf("%d failure(s)\n", si_failures);
+		return 1;
+	}
+
+	printf("OK\n");
+	return 0;
+}
@@ -0,0 +1,281 @@
+/**
+ * \file
+ *
+ * \brief Host test of the coordinator joined devices (LBDs) table.
+ *
+ * Random joins and leaves, also once the table has wrapped around, must give
+ * the same extended to short address lookups, device count and new short
+ * addresses as the former linear scans of g_lbds_list. Then times lookups
+ * by extended address with 100 to 4000 joined devices, through the hash
+ * index and through the former linear scan.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* Bootstrap traces are enabled in this header: keep the output readable */
+#include <BootstrapWrapper.h>
+#undef BOOTSTRAP_DEBUG_ENABLE
+
+#include "../source/bs_functions.c"
+
+#define RANDOM_OPS        200000
+#define BENCH_LOOKUPS     2000000
+/* Linear scans are timed over fewer lookups */
+#define BENCH_SCANS       (200000000 / MAX_LBDS)
+/* Average buckets visited per lookup, whatever the number of devices */
+#define MAX_AVG_PROBES    2.0
+
+static int si_failures;
+
+#define CHECK(cond) do { \
+		if (!(cond)) { \
+			printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+			si_failures++; \
+		} \
+	} while (0)
+
+static uint32_t sul_rng = 0x12345678;
+/* Extended addresses, the device index in the last two bytes */
+static uint8_t sauc_addr[MAX_LBDS][ADP_ADDRESS_64BITS];
+/* Short address of each device, 0 if not joined */
+static uint16_t saus_short[MAX_LBDS];
+
+uint32_t oss_get_up_time_ms(void)
+{
+	return 0;
+}
+
+uint32_t platform_random_32(void)
+{
+	sul_rng ^= sul_rng << 13;
+	sul_rng ^= sul_rng >> 17;
+	sul_rng ^= sul_rng << 5;
+	return sul_rng;
+}
+
+void AdpLbpRequest(const struct TAdpAddress *pDstAddr, uint16_t u16NsduLength, uint8_t *pNsdu, uint8_t u8NsduHandle, uint8_t u8MaxHops,
+		bool bDiscoveryRoute, uint8_t u8QualityOfService, bool bSecurityEnable)
+{
+}
+
+/* Former bs_get_short_addr_by_ext() */
+static bool _linear_short_addr_by_ext(uint8_t *puc_extended_address, uint16_t *pus_short_address)
+{
+	uint16_t i = 0;
+	uint16_t j = 0;
+	bool found = false;
+
+	while (j < g_lbds_list_size) {
+		if (!is_null_address(g_lbds_list[j].puc_extended_address)) {
+			found = true;
+			for (i = 0; i < ADP_ADDRESS_64BITS; i++) {
+				if (puc_extended_address[i] != g_lbds_list[j].puc_extended_address[i]) {
+					found = false;
+					break;
+				}
+			}
+		}
+
+		if (found) {
+			*pus_short_address = j + g_current_context.initialShortAddr;
+			break;
+		}
+
+		j++;
+	}
+
+	return found;
+}
+
+/* Former get_lbds_count() */
+static uint16_t _linear_count(void)
+{
+	uint16_t us_count = 0;
+	uint16_t us_idx;
+
+	for (us_idx = 0; us_idx < MAX_LBDS; us_idx++) {
+		if (!is_null_address(g_lbds_list[us_idx].puc_extended_address)) {
+			us_count++;
+		}
+	}
+
+	return us_count;
+}
+
+/* Former get_new_address() once the end of the list is reached */
+static uint16_t _linear_first_free(void)
+{
+	uint16_t us_idx;
+
+	for (us_idx = 0; us_idx < MAX_LBDS; us_idx++) {
+		if (is_null_address(g_lbds_list[us_idx].puc_extended_address)) {
+			return us_idx + g_current_context.initialShortAddr;
+		}
+	}
+
+	return 0;
+}
+
+static void _reset(void)
+{
+	uint16_t us_i;
+	uint8_t uc_j;
+
+	lbp_init_functions();
+	memset(saus_short, 0, sizeof(saus_short));
+	for (us_i = 0; us_i < MAX_LBDS; us_i++) {
+		for (uc_j = 0; uc_j < ADP_ADDRESS_64BITS - 2; uc_j++) {
+			sauc_addr[us_i][uc_j] = (uint8_t)platform_random_32();
+		}
+
+		sauc_addr[us_i][6] = (uint8_t)(us_i >> 8);
+		sauc_addr[us_i][7] = (uint8_t)us_i;
+	}
+}
+
+static bool _join(uint16_t us_dev)
+{
+	struct TAdpExtendedAddress x_addr;
+	uint16_t us_short;
+
+	memcpy(x_addr.m_au8Value, sauc_addr[us_dev], ADP_ADDRESS_64BITS);
+	us_short = get_new_address(x_addr);
+	if ((us_short == 0) || !add_lbds_list_entry(sauc_addr[us_dev], us_short, 1)) {
+		return false;
+	}
+
+	saus_short[us_dev] = us_short;
+	return true;
+}
+
+static void _leave(uint16_t us_dev)
+{
+	remove_lbds_list_entry(saus_short[us_dev]);
+	saus_short[us_dev] = 0;
+}
+
+/* Average number of buckets visited to find each indexed address */
+static double _avg_probes(void)
+{
+	uint32_t ul_probes = 0;
+	uint16_t us_bucket;
+	uint16_t us_home;
+
+	for (us_bucket = 0; us_bucket < BS_LBDS_HASH_SIZE; us_bucket++) {
+		if (g_lbds_hash[us_bucket] != 0) {
+			us_home = _addr_index_bucket(&sx_lbds_index, g_lbds_list[g_lbds_hash[us_bucket] - 1].puc_extended_address);
+			ul_probes += ((us_bucket - us_home) & BS_LBDS_HASH_MASK) + 1;
+		}
+	}
+
+	return g_lbds_counter ? (double)ul_probes / g_lbds_counter : 0;
+}
+
+/* Random joins and leaves give the same results as the linear scans */
+static void test_random_ops(void)
+{
+	struct TAdpExtendedAddress x_addr;
+	uint32_t ul_op;
+	uint32_t ul_mismatches = 0;
+	uint16_t us_dev;
+	uint16_t us_hash_short;
+	uint16_t us_linear_short;
+	bool b_hash;
+	bool b_linear;
+	bool b_room;
+
+	_reset();
+	for (ul_op = 0; ul_op < RANDOM_OPS; ul_op++) {
+		us_dev = platform_random_32() % MAX_LBDS;
+		/* Mostly joins until the table is full, then as many leaves as joins */
+		if (saus_short[us_dev] == 0) {
+			b_room = (g_lbds_counter < MAX_LBDS);
+			if ((g_lbds_list_size == MAX_LBDS) && b_room) {
+				memcpy(x_addr.m_au8Value, sauc_addr[us_dev], ADP_ADDRESS_64BITS);
+				CHECK(get_new_address(x_addr) == _linear_first_free());
+			}
+
+			CHECK(_join(us_dev) == b_room);
+		} else if ((g_lbds_list_size == MAX_LBDS) || (platform_random_32() % 4 == 0)) {
+			_leave(us_dev);
+		}
+
+		us_dev = platform_random_32() % MAX_LBDS;
+		b_hash = bs_get_short_addr_by_ext(sauc_addr[us_dev], &us_hash_short);
+		b_linear = _linear_short_addr_by_ext(sauc_addr[us_dev], &us_linear_short);
+		if ((b_hash != b_linear) || (b_hash && (us_hash_short != us_linear_short)) ||
+				(b_hash != (saus_short[us_dev] != 0)) || (get_lbds_count() != _linear_count())) {
+			ul_mismatches++;
+		}
+	}
+
+	CHECK(ul_mismatches == 0);
+	CHECK(g_lbds_list_size == MAX_LBDS);
+	CHECK(_avg_probes() < MAX_AVG_PROBES);
+	printf("%u joins and leaves, %u joined at the end, %u mismatches\n", (unsigned)RANDOM_OPS, (unsigned)get_lbds_count(),
+			(unsigned)ul_mismatches);
+}
+
+static double _time_lookups(bool (*pf_lookup)(uint8_t *, uint16_t *), uint16_t us_devices, uint32_t ul_lookups)
+{
+	volatile uint32_t ul_sink = 0;
+	struct timespec x_start;
+	struct timespec x_end;
+	uint16_t us_short = 0;
+	uint32_t ul_i;
+
+	clock_gettime(CLOCK_MONOTONIC, &x_start);
+	for (ul_i = 0; ul_i < ul_lookups; ul_i++) {
+		ul_sink += pf_lookup(sauc_addr[(ul_i * 7919) % us_devices], &us_short);
+		ul_sink += us_short;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &x_end);
+	return ((double)(x_end.tv_sec - x_start.tv_sec) * 1e9 + (double)(x_end.tv_nsec - x_start.tv_nsec)) / ul_lookups;
+}
+
+/* Lookup cost by number of joined devices */
+static void test_bench(void)
+{
+	static const uint16_t caus_devices[] = {100, 250, 500, 1000, 2000, 4000};
+	double d_hash;
+	double d_linear;
+	double d_probes;
+	uint16_t us_n;
+	uint16_t us_i;
+
+	printf("devices  hash ns  probes  linear ns\n");
+	for (us_n = 0; us_n < sizeof(caus_devices) / sizeof(caus_devices[0]); us_n++) {
+		if (caus_devices[us_n] > MAX_LBDS) {
+			break;
+		}
+
+		_reset();
+		for (us_i = 0; us_i < caus_devices[us_n]; us_i++) {
+			CHECK(_join(us_i));
+		}
+
+		d_probes = _avg_probes();
+		CHECK(d_probes < MAX_AVG_PROBES);
+		d_hash = _time_lookups(bs_get_short_addr_by_ext, caus_devices[us_n], BENCH_LOOKUPS);
+		d_linear = _time_lookups(_linear_short_addr_by_ext, caus_devices[us_n], BENCH_SCANS);
+		printf("%7u  %7.1f  %6.2f  %9.1f\n", caus_devices[us_n], d_hash, d_probes, d_linear);
+	}
+}
+
+int main(void)
+{
+	test_random_ops();
+	test_bench();
+
+	if (si_failures) {
+		printf("%d failure(s)\n", si_failures);
+		return 1;
+	}
+
+	printf("OK\n");
+	return 0;
+}
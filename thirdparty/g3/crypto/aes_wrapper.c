@@ -53,21 +53,113 @@ extern "C"
 {
 #endif
 
+unsigned char mbedtls_buf[512];
+
+#if defined(MBEDTLS_AES_ALT)
+
+/* Hardware AES: there is no key schedule to keep, and the peripheral is */
+/* only enabled between init and free, so it is triggered on every block */
+
 /** Key in byte format */
-static uint8_t spuc_key[256];
+static uint8_t spuc_key[32];
 /** Key size in bits */
 static uint16_t sus_key_size;
 
 mbedtls_aes_context aes_ctx;
 
-unsigned char mbedtls_buf[512];
+#else
+
+/** Number of keys whose schedule is kept expanded */
+#ifndef AES_WRAPPER_KEY_SLOTS
+#define AES_WRAPPER_KEY_SLOTS   2
+#endif
+
+/** Keyed context: key and its expanded schedules */
+typedef struct {
+	mbedtls_aes_context x_enc_ctx;
+	mbedtls_aes_context x_dec_ctx;
+	uint8_t puc_key[32];
+	uint16_t us_key_size;
+	uint8_t uc_age;
+	bool b_used;
+	bool b_dec_ready;
+} aes_key_slot_t;
+
+/** Keyed contexts */
+static aes_key_slot_t sx_key_slots[AES_WRAPPER_KEY_SLOTS];
+/** Keyed context selected by last call to aes_key() */
+static aes_key_slot_t *spx_key_slot;
+
+/**
+ * \brief Select the keyed context for a key, expanding its schedule only
+ * if the key is not already cached. The least recently used context is
+ * replaced when all are in use.
+ */
+static aes_key_slot_t *_select_key_slot(const unsigned char *key, uint16_t us_key_size)
+{
+	aes_key_slot_t *px_slot;
+	aes_key_slot_t *px_found = NULL;
+	uint8_t uc_i;
 
+	for (uc_i = 0; uc_i < AES_WRAPPER_KEY_SLOTS; uc_i++) {
+		px_slot = &sx_key_slots[uc_i];
+		if (px_slot->b_used && (px_slot->us_key_size == us_key_size) &&
+				(memcmp(px_slot->puc_key, key, us_key_size >> 3) == 0)) {
+			px_found = px_slot;
+			break;
+		}
+	}
+
+	if (px_found == NULL) {
+		/* Not cached: replace free or least recently used context */
+		px_found = &sx_key_slots[0];
+		for (uc_i = 0; uc_i < AES_WRAPPER_KEY_SLOTS; uc_i++) {
+			px_slot = &sx_key_slots[uc_i];
+			if (!px_slot->b_used) {
+				px_found = px_slot;
+				break;
+			}
+
+			if (px_slot->uc_age > px_found->uc_age) {
+				px_found = px_slot;
+			}
+		}
+
+		if (px_found->b_used) {
+			mbedtls_aes_free(&px_found->x_enc_ctx);
+			mbedtls_aes_free(&px_found->x_dec_ctx);
+		}
+
+		memcpy(px_found->puc_key, key, us_key_size >> 3);
+		px_found->us_key_size = us_key_size;
+		px_found->b_used = true;
+		px_found->b_dec_ready = false;
+		mbedtls_aes_init(&px_found->x_enc_ctx);
+		mbedtls_aes_init(&px_found->x_dec_ctx);
+		mbedtls_aes_setkey_enc(&px_found->x_enc_ctx, px_found->puc_key, us_key_size);
+	}
+
+	/* Age the other contexts */
+	for (uc_i = 0; uc_i < AES_WRAPPER_KEY_SLOTS; uc_i++) {
+		px_slot = &sx_key_slots[uc_i];
+		if ((px_slot != px_found) && px_slot->b_used && (px_slot->uc_age < 0xFF)) {
+			px_slot->uc_age++;
+		}
+	}
+	px_found->uc_age = 0;
+
+	return px_found;
+}
+
+#endif
 
 void crypto_init(void)
 {
 	mbedtls_memory_buffer_alloc_init(mbedtls_buf, sizeof(mbedtls_buf));
 }
 
+#if defined(MBEDTLS_AES_ALT)
+
 AES_RETURN aes_encrypt(const unsigned char *in, unsigned char *out)
 {
 	/* Initialize the AES */
@@ -101,6 +193,10 @@ AES_RETURN aes_decrypt(const unsigned char *in, unsigned char *out)
 
 AES_RETURN aes_key(const unsigned char *key, int key_len)
 {
+	if ((key_len != 16) && (key_len != 24) && (key_len != 32)) {
+		return EXIT_FAILURE;
+	}
+
 	/* Store the key */
 	memcpy(spuc_key, key, key_len);
 
@@ -110,6 +206,53 @@ AES_RETURN aes_key(const unsigned char *key, int key_len)
 	return EXIT_SUCCESS;
 }
 
+#else
+
+AES_RETURN aes_encrypt(const unsigned char *in, unsigned char *out)
+{
+	if (spx_key_slot == NULL) {
+		return EXIT_FAILURE;
+	}
+
+	/* Trigger the AES with the cached schedule */
+	mbedtls_aes_crypt_ecb(&spx_key_slot->x_enc_ctx, MBEDTLS_AES_ENCRYPT, in, out);
+
+	return EXIT_SUCCESS;
+}
+
+
+AES_RETURN aes_decrypt(const unsigned char *in, unsigned char *out)
+{
+	if (spx_key_slot == NULL) {
+		return EXIT_FAILURE;
+	}
+
+	/* Decryption schedule is only expanded when first needed */
+	if (!spx_key_slot->b_dec_ready) {
+		mbedtls_aes_setkey_dec(&spx_key_slot->x_dec_ctx, spx_key_slot->puc_key, spx_key_slot->us_key_size);
+		spx_key_slot->b_dec_ready = true;
+	}
+
+	/* Trigger the AES with the cached schedule */
+	mbedtls_aes_crypt_ecb(&spx_key_slot->x_dec_ctx, MBEDTLS_AES_DECRYPT, in, out);
+
+	return EXIT_SUCCESS;
+}
+
+AES_RETURN aes_key(const unsigned char *key, int key_len)
+{
+	if ((key_len != 16) && (key_len != 24) && (key_len != 32)) {
+		return EXIT_FAILURE;
+	}
+
+	/* Select cached schedule for the key, expanding it if needed */
+	spx_key_slot = _select_key_slot(key, key_len * 8);
+
+	return EXIT_SUCCESS;
+}
+
+#endif
+
 void aes_wrapper_aes_init(aes_wrapper_context *ctx)
 {
 	mbedtls_aes_init((mbedtls_aes_context *)ctx);
@@ -0,0 +1,12 @@
+/**
+ * \file
+ *
+ * \brief mbedTLS configuration for the host test: software AES and the
+ * buffer allocator used by crypto_init().
+ *
+ */
+
+#define MBEDTLS_AES_C
+#define MBEDTLS_MEMORY_BUFFER_ALLOC_C
+#define MBEDTLS_PLATFORM_C
+#define MBEDTLS_PLATFORM_MEMORY
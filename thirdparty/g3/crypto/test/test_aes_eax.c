@@ -0,0 +1,401 @@
+/**
+ * \file
+ *
+ * \brief Host test of the AES wrapper and EAX mode.
+ *
+ * Checks the FIPS-197 appendix C block vectors, the EAX paper vectors and
+ * that the least recently used key schedule is the one replaced. Then
+ * encrypts and decrypts random blocks and EAX messages under more keys than
+ * there are cached key schedules, against the former wrapper that ran
+ * init/setkey/free on every block. Then times 64-byte EAX messages, each
+ * with its own eax_init_and_key() as in the EAP-PSK bootstrap, through both
+ * wrappers.
+ *
+ */
+
+#include <stdio.h>
+#include <time.h>
+
+#include "../aes_wrapper.c"
+#include "../eax.c"
+
+/* Former wrapper, and EAX built a second time on top of it */
+
+static uint8_t spuc_former_key[256];
+static uint16_t sus_former_key_size;
+static mbedtls_aes_context sx_former_ctx;
+
+static AES_RETURN former_aes_encrypt(const unsigned char *in, unsigned char *out)
+{
+	mbedtls_aes_init(&sx_former_ctx);
+	mbedtls_aes_setkey_enc(&sx_former_ctx, spuc_former_key, sus_former_key_size);
+	mbedtls_aes_crypt_ecb(&sx_former_ctx, MBEDTLS_AES_ENCRYPT, in, out);
+	mbedtls_aes_free(&sx_former_ctx);
+
+	return EXIT_SUCCESS;
+}
+
+static AES_RETURN former_aes_decrypt(const unsigned char *in, unsigned char *out)
+{
+	mbedtls_aes_init(&sx_former_ctx);
+	mbedtls_aes_setkey_dec(&sx_former_ctx, spuc_former_key, sus_former_key_size);
+	mbedtls_aes_crypt_ecb(&sx_former_ctx, MBEDTLS_AES_DECRYPT, in, out);
+	mbedtls_aes_free(&sx_former_ctx);
+
+	return EXIT_SUCCESS;
+}
+
+static AES_RETURN former_aes_key(const unsigned char *key, int key_len)
+{
+	memcpy(spuc_former_key, key, key_len);
+	sus_former_key_size = key_len * 8;
+
+	return EXIT_SUCCESS;
+}
+
+#define aes_key              former_aes_key
+#define aes_encrypt          former_aes_encrypt
+#define aes_decrypt          former_aes_decrypt
+#define eax_init_and_key     former_eax_init_and_key
+#define eax_init_message     former_eax_init_message
+#define eax_auth_header      former_eax_auth_header
+#define eax_auth_data        former_eax_auth_data
+#define eax_crypt_data       former_eax_crypt_data
+#define eax_compute_tag      former_eax_compute_tag
+#define eax_end              former_eax_end
+#define eax_encrypt          former_eax_encrypt
+#define eax_decrypt          former_eax_decrypt
+#define eax_encrypt_message  former_eax_encrypt_message
+#define eax_decrypt_message  former_eax_decrypt_message
+#include "../eax.c"
+#undef aes_key
+#undef aes_encrypt
+#undef aes_decrypt
+#undef eax_init_and_key
+#undef eax_init_message
+#undef eax_auth_header
+#undef eax_auth_data
+#undef eax_crypt_data
+#undef eax_compute_tag
+#undef eax_end
+#undef eax_encrypt
+#undef eax_decrypt
+#undef eax_encrypt_message
+#undef eax_decrypt_message
+
+#define NUM_KEYS          (AES_WRAPPER_KEY_SLOTS + 1)
+#define RANDOM_OPS        20000
+#define RANDOM_MSG_LEN    100
+#define BENCH_MSG_LEN     64
+#define BENCH_MSGS        200000
+
+static int si_failures;
+
+#define CHECK(cond) do { \
+		if (!(cond)) { \
+			printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+			si_failures++; \
+		} \
+	} while (0)
+
+static uint32_t sul_rng = 0x12345678;
+
+static uint32_t _rand(void)
+{
+	sul_rng ^= sul_rng << 13;
+	sul_rng ^= sul_rng >> 17;
+	sul_rng ^= sul_rng << 5;
+	return sul_rng;
+}
+
+static void _rand_fill(uint8_t *puc_buf, uint16_t us_len)
+{
+	while (us_len--) {
+		*puc_buf++ = (uint8_t)_rand();
+	}
+}
+
+/* FIPS-197 appendix C: AES-128, AES-192 and AES-256 */
+static void test_fips197(void)
+{
+	static const uint8_t cauc_plain[16] = {
+		0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff
+	};
+	static const uint8_t cauc_cipher[3][16] = {
+		{0x69, 0xc4, 0xe0, 0xd8, 0x6a, 0x7b, 0x04, 0x30, 0xd8, 0xcd, 0xb7, 0x80, 0x70, 0xb4, 0xc5, 0x5a},
+		{0xdd, 0xa9, 0x7c, 0xa4, 0x86, 0x4c, 0xdf, 0xe0, 0x6e, 0xaf, 0x70, 0xa0, 0xec, 0x0d, 0x71, 0x91},
+		{0x8e, 0xa2, 0xb7, 0xca, 0x51, 0x67, 0x45, 0xbf, 0xea, 0xfc, 0x49, 0x90, 0x4b, 0x49, 0x60, 0x89}
+	};
+	uint8_t auc_key[32];
+	uint8_t auc_out[16];
+	uint8_t uc_i;
+
+	for (uc_i = 0; uc_i < sizeof(auc_key); uc_i++) {
+		auc_key[uc_i] = uc_i;
+	}
+
+	for (uc_i = 0; uc_i < 3; uc_i++) {
+		CHECK(aes_key(auc_key, 16 + 8 * uc_i) == EXIT_SUCCESS);
+		CHECK(aes_encrypt(cauc_plain, auc_out) == EXIT_SUCCESS);
+		CHECK(memcmp(auc_out, cauc_cipher[uc_i], 16) == 0);
+		CHECK(aes_decrypt(cauc_cipher[uc_i], auc_out) == EXIT_SUCCESS);
+		CHECK(memcmp(auc_out, cauc_plain, 16) == 0);
+	}
+
+	/* Invalid key length keeps the selected key */
+	CHECK(aes_key(auc_key, 20) == EXIT_FAILURE);
+	CHECK(aes_encrypt(cauc_plain, auc_out) == EXIT_SUCCESS);
+	CHECK(memcmp(auc_out, cauc_cipher[2], 16) == 0);
+}
+
+/* EAX paper (Bellare, Rogaway, Wagner) test vectors */
+typedef struct {
+	uint8_t auc_key[16];
+	uint8_t auc_nonce[16];
+	uint8_t auc_header[8];
+	uint8_t auc_msg[17];
+	uint8_t uc_msg_len;
+	uint8_t auc_cipher[17];
+	uint8_t auc_tag[16];
+} eax_vector_t;
+
+static const eax_vector_t cax_eax_vectors[] = {
+	{
+		{0x23, 0x39, 0x52, 0xDE, 0xE4, 0xD5, 0xED, 0x5F, 0x9B, 0x9C, 0x6D, 0x6F, 0xF8, 0x0F, 0xF4, 0x78},
+		{0x62, 0xEC, 0x67, 0xF9, 0xC3, 0xA4, 0xA4, 0x07, 0xFC, 0xB2, 0xA8, 0xC4, 0x90, 0x31, 0xA8, 0xB3},
+		{0x6B, 0xFB, 0x91, 0x4F, 0xD0, 0x7E, 0xAE, 0x6B},
+		{0}, 0, {0},
+		{0xE0, 0x37, 0x83, 0x0E, 0x83, 0x89, 0xF2, 0x7B, 0x02, 0x5A, 0x2D, 0x65, 0x27, 0xE7, 0x9D, 0x01}
+	},
+	{
+		{0x91, 0x94, 0x5D, 0x3F, 0x4D, 0xCB, 0xEE, 0x0B, 0xF4, 0x5E, 0xF5, 0x22, 0x55, 0xF0, 0x95, 0xA4},
+		{0xBE, 0xCA, 0xF0, 0x43, 0xB0, 0xA2, 0x3D, 0x84, 0x31, 0x94, 0xBA, 0x97, 0x2C, 0x66, 0xDE, 0xBD},
+		{0xFA, 0x3B, 0xFD, 0x48, 0x06, 0xEB, 0x53, 0xFA},
+		{0xF7, 0xFB}, 2, {0x19, 0xDD},
+		{0x5C, 0x4C, 0x93, 0x31, 0x04, 0x9D, 0x0B, 0xDA, 0xB0, 0x27, 0x74, 0x08, 0xF6, 0x79, 0x67, 0xE5}
+	},
+	{
+		{0xD0, 0x7C, 0xF6, 0xCB, 0xB7, 0xF3, 0x13, 0xBD, 0xDE, 0x66, 0xB7, 0x27, 0xAF, 0xD3, 0xC5, 0xE8},
+		{0x84, 0x08, 0xDF, 0xFF, 0x3C, 0x1A, 0x2B, 0x12, 0x92, 0xDC, 0x19, 0x9E, 0x46, 0xB7, 0xD6, 0x17},
+		{0x33, 0xCC, 0xE2, 0xEA, 0xBF, 0xF5, 0xA7, 0x9D},
+		{0x48, 0x1C, 0x9E, 0x39, 0xB1}, 5, {0x63, 0x2A, 0x9D, 0x13, 0x1A},
+		{0xD4, 0xC1, 0x68, 0xA4, 0x22, 0x5D, 0x8E, 0x1F, 0xF7, 0x55, 0x93, 0x99, 0x74, 0xA7, 0xBE, 0xDE}
+	},
+	{
+		{0x7C, 0x77, 0xD6, 0xE8, 0x13, 0xBE, 0xD5, 0xAC, 0x98, 0xBA, 0xA4, 0x17, 0x47, 0x7A, 0x2E, 0x7D},
+		{0x1A, 0x8C, 0x98, 0xDC, 0xD7, 0x3D, 0x38, 0x39, 0x3B, 0x2B, 0xF1, 0x56, 0x9D, 0xEE, 0xFC, 0x19},
+		{0x65, 0xD2, 0x01, 0x79, 0x90, 0xD6, 0x25, 0x28},
+		{0x8B, 0x0A, 0x79, 0x30, 0x6C, 0x9C, 0xE7, 0xED, 0x99, 0xDA, 0xE4, 0xF8, 0x7F, 0x8D, 0xD6, 0x16, 0x36}, 17,
+		{0x02, 0x08, 0x3E, 0x39, 0x79, 0xDA, 0x01, 0x48, 0x12, 0xF5, 0x9F, 0x11, 0xD5, 0x26, 0x30, 0xDA, 0x30},
+		{0x13, 0x73, 0x27, 0xD1, 0x06, 0x49, 0xB0, 0xAA, 0x6E, 0x1C, 0x18, 0x1D, 0xB6, 0x17, 0xD7, 0xF2}
+	}
+};
+
+static void test_eax_vectors(void)
+{
+	const eax_vector_t *px_vector;
+	eax_ctx x_ctx;
+	uint8_t auc_msg[17];
+	uint8_t auc_tag[16];
+	uint8_t uc_i;
+
+	for (uc_i = 0; uc_i < sizeof(cax_eax_vectors) / sizeof(cax_eax_vectors[0]); uc_i++) {
+		px_vector = &cax_eax_vectors[uc_i];
+
+		memcpy(auc_msg, px_vector->auc_msg, px_vector->uc_msg_len);
+		CHECK(eax_init_and_key(px_vector->auc_key, 16, &x_ctx) == RETURN_GOOD);
+		CHECK(eax_encrypt_message(px_vector->auc_nonce, 16, px_vector->auc_header, 8, auc_msg, px_vector->uc_msg_len,
+				auc_tag, 16, &x_ctx) == RETURN_GOOD);
+		CHECK(memcmp(auc_msg, px_vector->auc_cipher, px_vector->uc_msg_len) == 0);
+		CHECK(memcmp(auc_tag, px_vector->auc_tag, 16) == 0);
+
+		CHECK(eax_init_and_key(px_vector->auc_key, 16, &x_ctx) == RETURN_GOOD);
+		CHECK(eax_decrypt_message(px_vector->auc_nonce, 16, px_vector->auc_header, 8, auc_msg, px_vector->uc_msg_len,
+				px_vector->auc_tag, 16, &x_ctx) == RETURN_GOOD);
+		CHECK(memcmp(auc_msg, px_vector->auc_msg, px_vector->uc_msg_len) == 0);
+
+		/* Tampered tag is refused */
+		memcpy(auc_tag, px_vector->auc_tag, 16);
+		auc_tag[15] ^= 0x01;
+		memcpy(auc_msg, px_vector->auc_cipher, px_vector->uc_msg_len);
+		CHECK(eax_init_and_key(px_vector->auc_key, 16, &x_ctx) == RETURN_GOOD);
+		CHECK(eax_decrypt_message(px_vector->auc_nonce, 16, px_vector->auc_header, 8, auc_msg, px_vector->uc_msg_len,
+				auc_tag, 16, &x_ctx) == RETURN_ERROR);
+	}
+}
+
+/* Recently used keys keep their schedule, the least recently used one is replaced */
+static void test_key_slots(void)
+{
+	uint8_t auc_keys[NUM_KEYS][16];
+	aes_key_slot_t *apx_slots[NUM_KEYS];
+	uint8_t uc_key;
+
+	/* Start from empty contexts: the software schedules hold no heap memory */
+	memset(sx_key_slots, 0, sizeof(sx_key_slots));
+	spx_key_slot = NULL;
+
+	for (uc_key = 0; uc_key < NUM_KEYS; uc_key++) {
+		memset(auc_keys[uc_key], 0xA0 + uc_key, sizeof(auc_keys[uc_key]));
+		aes_key(auc_keys[uc_key], sizeof(auc_keys[uc_key]));
+		apx_slots[uc_key] = spx_key_slot;
+	}
+
+	/* Last AES_WRAPPER_KEY_SLOTS keys are all cached, in distinct contexts */
+	for (uc_key = 1; uc_key < NUM_KEYS; uc_key++) {
+		aes_key(auc_keys[uc_key], sizeof(auc_keys[uc_key]));
+		CHECK(spx_key_slot == apx_slots[uc_key]);
+		CHECK((uc_key == 1) || (apx_slots[uc_key] != apx_slots[uc_key - 1]));
+	}
+
+	/* Key 0 replaces key 1, now the least recently used */
+	aes_key(auc_keys[0], sizeof(auc_keys[0]));
+	CHECK(spx_key_slot == apx_slots[1]);
+	aes_key(auc_keys[NUM_KEYS - 1], sizeof(auc_keys[NUM_KEYS - 1]));
+	CHECK(spx_key_slot == apx_slots[NUM_KEYS - 1]);
+
+	/* Using key 0 again leaves key 2 the least recently used */
+	aes_key(auc_keys[0], sizeof(auc_keys[0]));
+	CHECK(spx_key_slot == apx_slots[1]);
+	aes_key(auc_keys[1], sizeof(auc_keys[1]));
+	CHECK(spx_key_slot == apx_slots[2]);
+}
+
+/* More keys than cached schedules, switched at random, against the former wrapper */
+static void test_key_switching(void)
+{
+	uint8_t auc_keys[NUM_KEYS][32];
+	uint8_t auc_key_lens[NUM_KEYS];
+	uint8_t auc_nonce[16];
+	uint8_t auc_header[16];
+	uint8_t auc_msg[RANDOM_MSG_LEN];
+	uint8_t auc_new[RANDOM_MSG_LEN];
+	uint8_t auc_former[RANDOM_MSG_LEN];
+	uint8_t auc_new_tag[16];
+	uint8_t auc_former_tag[16];
+	eax_ctx x_ctx;
+	uint32_t ul_op;
+	uint32_t ul_mismatches = 0;
+	uint16_t us_len;
+	uint8_t uc_key;
+
+	for (uc_key = 0; uc_key < NUM_KEYS; uc_key++) {
+		_rand_fill(auc_keys[uc_key], sizeof(auc_keys[uc_key]));
+		auc_key_lens[uc_key] = 16 + 8 * (uc_key % 3);
+	}
+
+	for (ul_op = 0; ul_op < RANDOM_OPS; ul_op++) {
+		uc_key = _rand() % NUM_KEYS;
+
+		if (_rand() % 2) {
+			/* Single blocks, in both directions */
+			_rand_fill(auc_msg, 16);
+			aes_key(auc_keys[uc_key], auc_key_lens[uc_key]);
+			former_aes_key(auc_keys[uc_key], auc_key_lens[uc_key]);
+			if (_rand() % 2) {
+				aes_encrypt(auc_msg, auc_new);
+				former_aes_encrypt(auc_msg, auc_former);
+			} else {
+				aes_decrypt(auc_msg, auc_new);
+				former_aes_decrypt(auc_msg, auc_former);
+			}
+
+			if (memcmp(auc_new, auc_former, 16) != 0) {
+				ul_mismatches++;
+			}
+		} else {
+			/* EAX message with a 128-bit key, as the bootstrap TEK, then decrypted back */
+			us_len = _rand() % (RANDOM_MSG_LEN + 1);
+			_rand_fill(auc_nonce, sizeof(auc_nonce));
+			_rand_fill(auc_header, sizeof(auc_header));
+			_rand_fill(auc_msg, us_len);
+			memcpy(auc_new, auc_msg, us_len);
+			memcpy(auc_former, auc_msg, us_len);
+
+			eax_init_and_key(auc_keys[uc_key], 16, &x_ctx);
+			eax_encrypt_message(auc_nonce, 16, auc_header, 16, auc_new, us_len, auc_new_tag, 16, &x_ctx);
+			former_eax_init_and_key(auc_keys[uc_key], 16, &x_ctx);
+			former_eax_encrypt_message(auc_nonce, 16, auc_header, 16, auc_former, us_len, auc_former_tag, 16, &x_ctx);
+			if ((memcmp(auc_new, auc_former, us_len) != 0) || (memcmp(auc_new_tag, auc_former_tag, 16) != 0)) {
+				ul_mismatches++;
+			}
+
+			eax_init_and_key(auc_keys[uc_key], 16, &x_ctx);
+			if ((eax_decrypt_message(auc_nonce, 16, auc_header, 16, auc_new, us_len, auc_new_tag, 16, &x_ctx) != RETURN_GOOD) ||
+					(memcmp(auc_new, auc_msg, us_len) != 0)) {
+				ul_mismatches++;
+			}
+		}
+	}
+
+	CHECK(ul_mismatches == 0);
+	printf("%u random blocks and EAX messages over %u keys, %u mismatches\n", (unsigned)RANDOM_OPS,
+			(unsigned)NUM_KEYS, (unsigned)ul_mismatches);
+}
+
+/* EAX messages per second, each with its own key setup */
+static double _bench(bool b_former)
+{
+	uint8_t auc_key[16];
+	uint8_t auc_nonce[16];
+	uint8_t auc_header[16];
+	uint8_t auc_msg[BENCH_MSG_LEN];
+	uint8_t auc_tag[16];
+	eax_ctx x_ctx;
+	struct timespec x_start;
+	struct timespec x_end;
+	uint32_t ul_i;
+	uint32_t ul_good = 0;
+
+	_rand_fill(auc_key, sizeof(auc_key));
+	_rand_fill(auc_nonce, sizeof(auc_nonce));
+	_rand_fill(auc_header, sizeof(auc_header));
+	_rand_fill(auc_msg, sizeof(auc_msg));
+
+	clock_gettime(CLOCK_MONOTONIC, &x_start);
+	for (ul_i = 0; ul_i < BENCH_MSGS; ul_i++) {
+		auc_nonce[15] = (uint8_t)ul_i;
+		if (b_former) {
+			former_eax_init_and_key(auc_key, sizeof(auc_key), &x_ctx);
+			ul_good += (former_eax_encrypt_message(auc_nonce, 16, auc_header, 16, auc_msg, sizeof(auc_msg), auc_tag, 16,
+					&x_ctx) == RETURN_GOOD);
+		} else {
+			eax_init_and_key(auc_key, sizeof(auc_key), &x_ctx);
+			ul_good += (eax_encrypt_message(auc_nonce, 16, auc_header, 16, auc_msg, sizeof(auc_msg), auc_tag, 16,
+					&x_ctx) == RETURN_GOOD);
+		}
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &x_end);
+	CHECK(ul_good == BENCH_MSGS);
+
+	return BENCH_MSGS / ((double)(x_end.tv_sec - x_start.tv_sec) + (double)(x_end.tv_nsec - x_start.tv_nsec) / 1e9);
+}
+
+static void test_bench(void)
+{
+	double d_new = _bench(false);
+	double d_former = _bench(true);
+
+	printf("%u-byte EAX messages: %.0fk msg/s, former %.0fk msg/s\n", (unsigned)BENCH_MSG_LEN, d_new / 1000,
+			d_former / 1000);
+}
+
+int main(void)
+{
+	crypto_init();
+
+	test_fips197();
+	test_eax_vectors();
+	test_key_slots();
+	test_key_switching();
+	test_bench();
+
+	if (si_failures) {
+		printf("%d failure(s)\n", si_failures);
+		return 1;
+	}
+
+	printf("OK\n");
+	return 0;
+}
@@ -246,6 +246,7 @@ void platform_random_init(void)
 {
 #if !(SAM4C || SAM4CP || SAM4CM || SAME70 || PIC32CX)
 	uint32_t ul_random_num;
+	uint32_t ul_i;
 #endif
 
 	platform_init_storage();
@@ -266,6 +267,13 @@ void platform_random_init(void)
 #endif
 	LOG_PLATFORM(("TRNG init\r\n"));
 #else
+	/* The counter at the start of the storage is only rewritten when it is */
+	/* erased, but a record is appended to the storage on every boot: fold */
+	/* the whole page so the seed differs between boots */
+	for (ul_i = sizeof(mem.u32StartUpCounter); ul_i < sizeof(mem); ul_i++) {
+		mem.u32StartUpCounter = (mem.u32StartUpCounter ^ mem.u8MemPage[ul_i]) * 16777619UL;
+	}
+
 	ul_random_num = DWT->CYCCNT;
 
 	ul_random_num = 36969 * (ul_random_num & 65535) + (ul_random_num >> 16);
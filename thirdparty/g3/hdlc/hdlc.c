@@ -51,50 +51,77 @@
 #include "Logger.h"
 #include "serial_buffer.h"
 #include "hdlc.h"
+#include "pcrc.h"
 
 /* Global variables */
 uint16_t hcs, fcs;
-uint8_t hdlc_tail_pos;
+uint16_t hdlc_tail_pos;
 
+#if ((HDLC_MAX_INFO_TX + 9) > HDLC_FRAME_LENGTH_MASK)
+#error "HDLC_MAX_INFO_TX too big for the frame length field"
+#endif
 
-/*
- * FCS Look up table
- */
-uint16_t FCSTable[ 256 ] =
-    {
-        0x0000, 0x1189, 0x2312, 0x329b, 0x4624, 0x57ad, 0x6536, 0x74bf,
-        0x8c48, 0x9dc1, 0xaf5a, 0xbed3, 0xca6c, 0xdbe5, 0xe97e, 0xf8f7,
-        0x1081, 0x0108, 0x3393, 0x221a, 0x56a5, 0x472c, 0x75b7, 0x643e,
-        0x9cc9, 0x8d40, 0xbfdb, 0xae52, 0xdaed, 0xcb64, 0xf9ff, 0xe876,
-        0x2102, 0x308b, 0x0210, 0x1399, 0x6726, 0x76af, 0x4434, 0x55bd,
-        0xad4a, 0xbcc3, 0x8e58, 0x9fd1, 0xeb6e, 0xfae7, 0xc87c, 0xd9f5,
-        0x3183, 0x200a, 0x1291, 0x0318, 0x77a7, 0x662e, 0x54b5, 0x453c,
-        0xbdcb, 0xac42, 0x9ed9, 0x8f50, 0xfbef, 0xea66, 0xd8fd, 0xc974,
-        0x4204, 0x538d, 0x6116, 0x709f, 0x0420, 0x15a9, 0x2732, 0x36bb,
-        0xce4c, 0xdfc5, 0xed5e, 0xfcd7, 0x8868, 0x99e1, 0xab7a, 0xbaf3,
-        0x5285, 0x430c, 0x7197, 0x601e, 0x14a1, 0x0528, 0x37b3, 0x263a,
-        0xdecd, 0xcf44, 0xfddf, 0xec56, 0x98e9, 0x8960, 0xbbfb, 0xaa72,
-        0x6306, 0x728f, 0x4014, 0x519d, 0x2522, 0x34ab, 0x0630, 0x17b9,
-        0xef4e, 0xfec7, 0xcc5c, 0xddd5, 0xa96a, 0xb8e3, 0x8a78, 0x9bf1,
-        0x7387, 0x620e, 0x5095, 0x411c, 0x35a3, 0x242a, 0x16b1, 0x0738,
-        0xffcf, 0xee46, 0xdcdd, 0xcd54, 0xb9eb, 0xa862, 0x9af9, 0x8b70,
-        0x8408, 0x9581, 0xa71a, 0xb693, 0xc22c, 0xd3a5, 0xe13e, 0xf0b7,
-        0x0840, 0x19c9, 0x2b52, 0x3adb, 0x4e64, 0x5fed, 0x6d76, 0x7cff,
-        0x9489, 0x8500, 0xb79b, 0xa612, 0xd2ad, 0xc324, 0xf1bf, 0xe036,
-        0x18c1, 0x0948, 0x3bd3, 0x2a5a, 0x5ee5, 0x4f6c, 0x7df7, 0x6c7e,
-        0xa50a, 0xb483, 0x8618, 0x9791, 0xe32e, 0xf2a7, 0xc03c, 0xd1b5,
-        0x2942, 0x38cb, 0x0a50, 0x1bd9, 0x6f66, 0x7eef, 0x4c74, 0x5dfd,
-        0xb58b, 0xa402, 0x9699, 0x8710, 0xf3af, 0xe226, 0xd0bd, 0xc134,
-        0x39c3, 0x284a, 0x1ad1, 0x0b58, 0x7fe7, 0x6e6e, 0x5cf5, 0x4d7c,
-        0xc60c, 0xd785, 0xe51e, 0xf497, 0x8028, 0x91a1, 0xa33a, 0xb2b3,
-        0x4a44, 0x5bcd, 0x6956, 0x78df, 0x0c60, 0x1de9, 0x2f72, 0x3efb,
-        0xd68d, 0xc704, 0xf59f, 0xe416, 0x90a9, 0x8120, 0xb3bb, 0xa232,
-        0x5ac5, 0x4b4c, 0x79d7, 0x685e, 0x1ce1, 0x0d68, 0x3ff3, 0x2e7a,
-        0xe70e, 0xf687, 0xc41c, 0xd595, 0xa12a, 0xb0a3, 0x8238, 0x93b1,
-        0x6b46, 0x7acf, 0x4854, 0x59dd, 0x2d62, 0x3ceb, 0x0e70, 0x1ff9,
-        0xf78f, 0xe606, 0xd49d, 0xc514, 0xb1ab, 0xa022, 0x92b9, 0x8330,
-        0x7bc7, 0x6a4e, 0x58d5, 0x495c, 0x3de3, 0x2c6a, 0x1ef1, 0x0f78
-    };
+#if ((HDLC_MAX_INFO_TX + 11) > SERIAL_BUF_SIZE)
+#error "HDLC_MAX_INFO_TX too big for the serial buffer"
+#endif
+
+/* Maximum header length: format, 4-byte addresses, control and HCS */
+#define HDLC_MAX_HEADER_LEN 			14
+/* LLC header at the beginning of the information field of the first segment */
+#define HDLC_LLC_LEN 				3
+
+#if ((HDLC_TX_WINDOW < 1) || (HDLC_TX_WINDOW > 7))
+#error "HDLC_TX_WINDOW must be between 1 and 7"
+#endif
+
+/* Reception states */
+enum hdlc_rx_state {
+	HDLC_RX_HUNT,
+	HDLC_RX_FLAG,
+	HDLC_RX_HEADER,
+	HDLC_RX_INFO
+};
+
+/* Reception context. Frames do not span serial messages, segmented APDUs do */
+static struct {
+	enum hdlc_rx_state state;
+	uint8_t header[HDLC_MAX_HEADER_LEN];
+	uint8_t header_len;     /* Header bytes received */
+	uint8_t header_size;    /* Header length once known, including HCS */
+	uint16_t frame_len;     /* Frame length from format field (flags excluded) */
+	uint16_t frame_pos;     /* Frame bytes received */
+	uint16_t crc;           /* Running FCS */
+	uint16_t apdu_len;      /* APDU bytes reassembled from previous segments */
+	uint16_t apdu_tout;     /* Time left (ms) for next segment of the APDU */
+	uint16_t seg_len;       /* APDU bytes received in current segment */
+	uint8_t llc_skip;       /* LLC bytes still to be skipped */
+	uint8_t seg_bad;        /* Current segment has no LLC or does not fit */
+	uint8_t vr;             /* Receive sequence variable V(R) */
+	uint8_t unacked;        /* I-frames received and not acknowledged */
+	uint8_t ack_pending;    /* RR has to be sent */
+	uint8_t lost;           /* A frame has been dropped since the last good one */
+	uint8_t discard;        /* Segments up to the last one of the APDU have to be discarded */
+} hdlc_rx;
+
+/* Link context */
+static struct {
+	uint8_t numbered;       /* Numbered mode: I-frames, acknowledged */
+	uint8_t snrm_pending;   /* SNRM has to be sent before next APDU */
+	uint8_t ua_pending;     /* UA has to be sent (SNRM or DISC received) */
+	uint16_t ua_tout;       /* Time left (ms) for UA after SNRM, 0 if not waiting */
+} hdlc_link;
+
+/* Transmission context. The APDU is kept (todo set) until all its I-frames are acknowledged */
+static struct {
+	struct dlms_msg *apdu;  /* APDU being sent, NULL if none */
+	uint16_t offset;        /* APDU bytes already sent */
+	uint16_t seg_offset[8]; /* APDU offset of the segment sent with each N(S) */
+	uint16_t ack_tout;      /* Time left (ms) for acknowledgement */
+	uint8_t vs;             /* Send sequence variable V(S) */
+	uint8_t va;             /* Oldest N(S) not acknowledged */
+	uint8_t acked;          /* A segment of the APDU has been acknowledged */
+	uint8_t retries;        /* Times unacknowledged segments have been sent again */
+} hdlc_tx;
 
 //*** Functions  **********************************************************
 /*
@@ -109,15 +136,9 @@ uint16_t FCSTable[ 256 ] =
  * Returns:
  *  static - checksum
  */
-static uint16_t hdlc_ChksumCalculate( uint16_t _fcs, uint8_t *cp_p, uint8_t len )
+static uint16_t hdlc_ChksumCalculate( uint16_t _fcs, uint8_t *cp_p, uint16_t len )
 {
-    while ( len != 0 )
-    {
-        _fcs = (uint16_t) ((_fcs >> 8) ^ FCSTable[ ( _fcs ^ *cp_p++ ) & 0xff ]);
-        len--;
-    }
-
-    return _fcs;
+    return pcrc_crc16_x25_update(_fcs, cp_p, len);
 }
 
 /*
@@ -143,117 +164,693 @@ void HDLC_iframe_tout_init(uint16_t *ptr_HDLC_iframe_tout)
  */
 void hdlc_init(void)
 {
-	/* DO NOTHING */
+	memset(&hdlc_rx, 0, sizeof(hdlc_rx));
+	hdlc_rx.state = HDLC_RX_HUNT;
+	memset(&hdlc_tx, 0, sizeof(hdlc_tx));
+	memset(&hdlc_link, 0, sizeof(hdlc_link));
+}
+
+/*
+ * Function: hdlc_Connect
+ *  Description: Requests numbered mode: SNRM is sent before next APDU. If
+ *  the peer does not answer UA in time, APDUs go on in UI frames.
+ * Arguments:
+ *  void
+ * Returns:
+ *  void
+ */
+void hdlc_Connect(void)
+{
+	hdlc_link.snrm_pending = 1;
+}
+
+/*
+ * Function: _hdlc_link_reset
+ *  Description: Enters numbered or UI mode with sequence numbers reset. The
+ *  APDU being sent, if any, is sent again from the beginning.
+ * Arguments:
+ *  uint8_t numbered - 1 for numbered mode, 0 for UI mode
+ * Returns:
+ *  static - void
+ */
+static void _hdlc_link_reset(uint8_t numbered)
+{
+	hdlc_link.numbered = numbered;
+	hdlc_link.ua_tout = 0;
+	hdlc_rx.vr = 0;
+	hdlc_rx.unacked = 0;
+	hdlc_rx.ack_pending = 0;
+	hdlc_tx.vs = 0;
+	hdlc_tx.va = 0;
+	hdlc_tx.offset = 0;
+	hdlc_tx.acked = 0;
+	hdlc_tx.retries = 0;
+	hdlc_tx.ack_tout = 0;
+}
+
+/*
+ * Function: hdlc_TimersUpdate
+ *  Description: Runs HDLC timeouts, to be called every ms. A segmented APDU
+ *  whose next segment does not come in time is dropped, I-frames not
+ *  acknowledged in time are sent again, and UI mode is kept if SNRM is not
+ *  answered in time.
+ * Arguments:
+ *  void
+ * Returns:
+ *  void
+ */
+void hdlc_TimersUpdate(void)
+{
+	if (hdlc_rx.apdu_tout && !--hdlc_rx.apdu_tout) {
+		hdlc_rx.apdu_len = 0;
+		hdlc_rx.discard = 0;
+	}
+
+	if (hdlc_link.ua_tout && !--hdlc_link.ua_tout) {
+		/* No UA: peer only takes UI frames */
+		_hdlc_link_reset(0);
+	}
+
+	if (hdlc_tx.ack_tout && !--hdlc_tx.ack_tout && (hdlc_tx.apdu != NULL)) {
+		if (++hdlc_tx.retries > HDLC_TX_MAX_RETRIES) {
+			/* Peer does not answer: APDU lost. Frames sent are taken as done, */
+			/* RR to the next one tells where the peer really is */
+			hdlc_tx.apdu->todo = 0;
+			hdlc_tx.apdu = NULL;
+			hdlc_tx.va = hdlc_tx.vs;
+			return;
+		}
+
+		/* Go back to the first segment not acknowledged */
+		hdlc_tx.offset = hdlc_tx.seg_offset[hdlc_tx.va];
+		hdlc_tx.vs = hdlc_tx.va;
+	}
+}
+
+/*
+ * Function: _hdlc_tx_ack
+ *  Description: Takes N(R) received in an I-frame or RR: frames up to N(R)-1
+ *  are acknowledged. The APDU is done when all its segments are.
+ * Arguments:
+ *  uint8_t nr - N(R) received
+ * Returns:
+ *  static - void
+ */
+static void _hdlc_tx_ack(uint8_t nr)
+{
+	if (((nr - hdlc_tx.va) & 0x07) > ((hdlc_tx.vs - hdlc_tx.va) & 0x07)) {
+		/* Not a frame sent. If no frame of the APDU has been acknowledged */
+		/* yet, peer lost the sequence (restart): follow it from N(R) */
+		if ((hdlc_tx.apdu == NULL) || !hdlc_tx.acked) {
+			hdlc_tx.va = nr;
+			hdlc_tx.vs = nr;
+			hdlc_tx.offset = 0;
+		}
+
+		return;
+	}
+
+	if (nr != hdlc_tx.va) {
+		hdlc_tx.va = nr;
+		hdlc_tx.acked = 1;
+		hdlc_tx.retries = 0;
+		hdlc_tx.ack_tout = HDLC_TX_ACK_TIMEOUT;
+	}
+
+	if ((hdlc_tx.apdu != NULL) && (hdlc_tx.va == hdlc_tx.vs) && (hdlc_tx.offset >= hdlc_tx.apdu->length)) {
+		/* All segments acknowledged */
+		hdlc_tx.apdu->todo = 0;
+		hdlc_tx.apdu = NULL;
+		hdlc_tx.ack_tout = 0;
+	}
+}
+
+/*
+ * Function: _hdlc_header_size
+ *  Description: Gets the header length (up to HCS) from the bytes received so
+ *  far. Addresses are variable length, ended by a byte with LSB set.
+ * Arguments:
+ *  uint8_t *header - header bytes received
+ *  uint8_t len - number of header bytes received
+ * Returns:
+ *  static - header length, or 0 if not known yet
+ */
+static uint8_t _hdlc_header_size(uint8_t *header, uint8_t len)
+{
+	uint8_t pos = 2;
+	uint8_t addr;
+
+	/* Destination and source addresses */
+	for (addr = 0; addr < 2; addr++) {
+		do {
+			if (pos >= len) {
+				return 0;
+			}
+		} while (!(header[pos++] & 0x01));
+	}
+
+	/* Control and HCS */
+	return pos + 3;
+}
+
+/*
+ * Function: _hdlc_rx_link
+ *  Description: Handles link setup frames received: SNRM and DISC are
+ *  answered with UA, UA or DM answer our SNRM
+ * Arguments:
+ *  uint8_t control - control field, poll/final bit cleared
+ * Returns:
+ *  static - void
+ */
+static void _hdlc_rx_link(uint8_t control)
+{
+	switch (control) {
+	case HDLC_CONTROL_SNRM:
+		_hdlc_link_reset(1);
+		hdlc_link.ua_pending = 1;
+		break;
+
+	case HDLC_CONTROL_DISC:
+		_hdlc_link_reset(0);
+		hdlc_link.ua_pending = 1;
+		break;
+
+	case HDLC_CONTROL_UA:
+		if (hdlc_link.ua_tout) {
+			_hdlc_link_reset(1);
+		}
+		break;
+
+	case HDLC_CONTROL_DM:
+		if (hdlc_link.ua_tout) {
+			_hdlc_link_reset(0);
+		}
+		break;
+
+	default:
+		break;
+	}
+}
+
+/*
+ * Function: _hdlc_rx_frame
+ *  Description: Handles a frame received with valid FCS: link setup,
+ *  acknowledgement of sent frames, sequence check of I-frames and segment
+ *  reassembly
+ * Arguments:
+ *  struct dlms_msg *ptr_rx_dlms_msg - reassembled APDU
+ * Returns:
+ *  static - void
+ */
+static void _hdlc_rx_frame(struct dlms_msg *ptr_rx_dlms_msg)
+{
+	uint8_t control = hdlc_rx.header[hdlc_rx.header_size - 3];
+	uint8_t lost = hdlc_rx.lost;
+
+	hdlc_rx.lost = 0;
+
+	if ((control & 0x03) == 0x03) {
+		/* Unnumbered frame */
+		if ((control & ~HDLC_CONTROL_PF) != HDLC_CONTROL_UI) {
+			_hdlc_rx_link(control & ~HDLC_CONTROL_PF);
+			return;
+		}
+	} else if (!(control & 0x01) && !hdlc_link.numbered) {
+		/* Peer sends I-frames: numbered mode, its sequence starts here */
+		_hdlc_link_reset(1);
+		hdlc_rx.vr = (control >> 1) & 0x07;
+	}
+
+	if (!(control & 0x01) || ((control & HDLC_CONTROL_S_MASK) == HDLC_CONTROL_RR)) {
+		/* I-frame or RR: N(R) acknowledges sent frames */
+		_hdlc_tx_ack(control >> 5);
+	}
+
+	if (hdlc_rx.frame_len <= hdlc_rx.header_size) {
+		/* No information field (supervisory frames) */
+		return;
+	}
+
+	if (!(control & 0x01)) {
+		/* I-frame: check N(S) against V(R) */
+		if (((control >> 1) & 0x07) != hdlc_rx.vr) {
+			/* Lost or repeated frame: drop it, RR tells the peer which one is expected */
+			hdlc_rx.ack_pending = 1;
+			return;
+		}
+
+		hdlc_rx.vr = (hdlc_rx.vr + 1) & 0x07;
+		if ((++hdlc_rx.unacked >= HDLC_RX_WINDOW) || (control & HDLC_CONTROL_PF)) {
+			hdlc_rx.ack_pending = 1;
+		}
+	} else if (lost && (hdlc_rx.apdu_len != 0)) {
+		/* Unnumbered segment after a dropped frame: APDU is broken */
+		hdlc_rx.discard = 1;
+	}
+
+	if (hdlc_rx.seg_bad) {
+		hdlc_rx.discard = 1;
+	}
+
+	hdlc_rx.apdu_tout = 0;
+	if (hdlc_rx.discard) {
+		/* APDU lost or too long: drop segments up to the last one */
+		if (!(hdlc_rx.header[0] & HDLC_FRAME_FORMAT_SEGMENTATION)) {
+			hdlc_rx.discard = 0;
+		} else {
+			hdlc_rx.apdu_tout = HDLC_RX_APDU_TIMEOUT;
+		}
+
+		hdlc_rx.apdu_len = 0;
+		return;
+	}
+
+	hdlc_rx.apdu_len += hdlc_rx.seg_len;
+	if (!(hdlc_rx.header[0] & HDLC_FRAME_FORMAT_SEGMENTATION)) {
+		/* Last segment: APDU complete */
+		ptr_rx_dlms_msg->length = hdlc_rx.apdu_len;
+		ptr_rx_dlms_msg->todo = 1;
+		hdlc_rx.apdu_len = 0;
+	} else {
+		hdlc_rx.apdu_tout = HDLC_RX_APDU_TIMEOUT;
+	}
+}
+
+/*
+ * Function: _hdlc_rx_error
+ *  Description: Drops the frame being received. I-frames are sent again by
+ *  the peer; for unnumbered segments, the APDU is dropped on the next one.
+ * Arguments:
+ *  void
+ * Returns:
+ *  static - void
+ */
+static void _hdlc_rx_error(void)
+{
+	hdlc_rx.lost = 1;
+	hdlc_rx.state = HDLC_RX_HUNT;
 }
 
+/*
+ * Function: hdlc_RxProcess
+ *  Description: Processes a serial message starting with a flag. It may hold
+ *  several frames: FCS is computed as bytes are taken and the information
+ *  field is copied straight to the APDU buffer, reassembling segmented
+ *  frames. A frame cut at the end of the message is dropped.
+ * Arguments:
+ *  struct dlms_msg *ptr_rx_dlms_msg - APDU received
+ *  struct serial_msg *ptr_rx_serial - serial data. If a complete APDU is
+ *  received before its end, the rest is moved to the beginning and todo is
+ *  left set, so it has to be processed again once the APDU is served.
+ * Returns:
+ *  uint8_t - 1 if a complete APDU has been received
+ */
 uint8_t hdlc_RxProcess(struct dlms_msg *ptr_rx_dlms_msg, struct serial_msg *ptr_rx_serial)
 {
-	uint16_t rx_hcs, rx_fcs;
-  	
+	uint16_t pos = 0;
+	uint16_t run;
+	uint16_t info_left;
+	uint16_t copy;
+	uint8_t data;
+
 	ptr_rx_dlms_msg->todo = 0;
-	
-	if (ptr_rx_serial->length != 0){
+
+	if ((hdlc_rx.state == HDLC_RX_HEADER) || (hdlc_rx.state == HDLC_RX_INFO)) {
+		/* Previous message ended in the middle of a frame */
+		_hdlc_rx_error();
+	}
+
 #ifdef DUMP_HDLC
-    LogDump(ptr_rx_serial->buf, ptr_rx_serial->length);
-#endif /* DUMP_HDLC */ 
-    
-    /* Length_DLMS_APDU =  LENGTH HDLC - HDLC_header(12bytes) [Excluded FLAGs] */
-		ptr_rx_dlms_msg->length = (uint16_t) ptr_rx_serial->buf[2] - 12;
-    
-		/* CHECK HCS */
-		rx_hcs = (uint16_t) ptr_rx_serial->buf[6];
-		rx_hcs = (uint16_t)(ptr_rx_serial->buf[7] << 8) | rx_hcs;
-		hcs = hdlc_ChksumCalculate(0xFFFF, &ptr_rx_serial->buf[1], 5);
-		hcs ^= 0xffff;		/* Complement */
-		
-		if (hcs != rx_hcs){
-		  	/* ERROR HCS */
-		  	ptr_rx_serial->todo = 0;
-			return ptr_rx_dlms_msg->todo;
-		}
-		
-		/* CHECK FCS */
-		hdlc_tail_pos = ptr_rx_serial->length - 3;
-		
-		rx_fcs = (uint16_t) ptr_rx_serial->buf[hdlc_tail_pos];
-		rx_fcs = (uint16_t)(ptr_rx_serial->buf[hdlc_tail_pos + 1] << 8) | rx_fcs;
-		fcs = hdlc_ChksumCalculate(0xFFFF, &ptr_rx_serial->buf[1], ptr_rx_serial->length - 4);
-		fcs ^= 0xffff;		/* Complement */
-		
-		if (fcs != rx_fcs){
-		 	/* ERROR FCS */
-		  	ptr_rx_serial->todo = 0;
-			return ptr_rx_dlms_msg->todo;
+	if (ptr_rx_serial->length != 0) {
+		LogDump(ptr_rx_serial->buf, ptr_rx_serial->length);
+	}
+#endif /* DUMP_HDLC */
+
+	/* Stop after a complete APDU, so it is not overwritten before being served */
+	while ((pos < ptr_rx_serial->length) && !ptr_rx_dlms_msg->todo) {
+		switch (hdlc_rx.state) {
+		case HDLC_RX_HUNT:
+			if (ptr_rx_serial->buf[pos++] == HDLC_START_END_FLAG) {
+				hdlc_rx.state = HDLC_RX_FLAG;
+			}
+			break;
+
+		case HDLC_RX_FLAG:
+			data = ptr_rx_serial->buf[pos++];
+			if (data == HDLC_START_END_FLAG) {
+				/* Consecutive flags */
+				break;
+			}
+
+			if ((data & HDLC_FRAME_FORMAT_TYPE_MASK) != HDLC_FRAME_FORMAT_WITHOUT_SEGMENTATION) {
+				hdlc_rx.state = HDLC_RX_HUNT;
+				break;
+			}
+
+			hdlc_rx.header[0] = data;
+			hdlc_rx.header_len = 1;
+			hdlc_rx.header_size = 0;
+			hdlc_rx.frame_pos = 1;
+			hdlc_rx.crc = hdlc_ChksumCalculate(0xFFFF, &data, 1);
+			hdlc_rx.state = HDLC_RX_HEADER;
+			break;
+
+		case HDLC_RX_HEADER:
+			data = ptr_rx_serial->buf[pos++];
+			hdlc_rx.header[hdlc_rx.header_len++] = data;
+			hdlc_rx.frame_pos++;
+			hdlc_rx.crc = hdlc_ChksumCalculate(hdlc_rx.crc, &data, 1);
+
+			if (hdlc_rx.header_len == 2) {
+				hdlc_rx.frame_len = (((uint16_t)hdlc_rx.header[0] << 8) | data) & HDLC_FRAME_LENGTH_MASK;
+				break;
+			}
+
+			if (hdlc_rx.header_size == 0) {
+				hdlc_rx.header_size = _hdlc_header_size(hdlc_rx.header, hdlc_rx.header_len);
+				if ((hdlc_rx.header_size == 0) && (hdlc_rx.header_len >= HDLC_MAX_HEADER_LEN - 3)) {
+					/* Address too long */
+					_hdlc_rx_error();
+				}
+
+				if ((hdlc_rx.header_size != 0) && (hdlc_rx.header_size > hdlc_rx.frame_len)) {
+					/* Length inconsistent with header */
+					_hdlc_rx_error();
+				}
+
+				break;
+			}
+
+			if (hdlc_rx.header_len < hdlc_rx.header_size) {
+				break;
+			}
+
+			/* Header complete: check HCS (or FCS if there is no information field) */
+			if (hdlc_rx.crc != HDLC_FCS_GOOD) {
+				/* ERROR HCS */
+				_hdlc_rx_error();
+				break;
+			}
+
+			if (hdlc_rx.frame_len == hdlc_rx.header_size) {
+				_hdlc_rx_frame(ptr_rx_dlms_msg);
+				hdlc_rx.state = HDLC_RX_FLAG;
+				/* Closing flag expected */
+				if ((pos < ptr_rx_serial->length) && (ptr_rx_serial->buf[pos] == HDLC_START_END_FLAG)) {
+					pos++;
+				} else {
+					hdlc_rx.state = HDLC_RX_HUNT;
+				}
+
+				break;
+			}
+
+			if (hdlc_rx.frame_len < hdlc_rx.header_size + 2) {
+				_hdlc_rx_error();
+				break;
+			}
+
+			/* Information field follows */
+			hdlc_rx.seg_len = 0;
+			hdlc_rx.seg_bad = 0;
+			hdlc_rx.llc_skip = (hdlc_rx.apdu_len == 0) ? HDLC_LLC_LEN : 0;
+			hdlc_rx.state = HDLC_RX_INFO;
+			break;
+
+		case HDLC_RX_INFO:
+			/* Take as many bytes of the frame as available at once */
+			run = ptr_rx_serial->length - pos;
+			if (run > hdlc_rx.frame_len - hdlc_rx.frame_pos) {
+				run = hdlc_rx.frame_len - hdlc_rx.frame_pos;
+			}
+
+			hdlc_rx.crc = hdlc_ChksumCalculate(hdlc_rx.crc, &ptr_rx_serial->buf[pos], run);
+
+			/* Copy information bytes (FCS excluded) to the APDU buffer */
+			info_left = 0;
+			if (hdlc_rx.frame_pos < hdlc_rx.frame_len - 2) {
+				info_left = hdlc_rx.frame_len - 2 - hdlc_rx.frame_pos;
+			}
+
+			copy = (run < info_left) ? run : info_left;
+			while ((copy > 0) && (hdlc_rx.llc_skip > 0)) {
+				/* First segment starts with LLC, otherwise beginning of the APDU was lost */
+				data = ptr_rx_serial->buf[pos];
+				if (((hdlc_rx.llc_skip == 3) && (data != HDLC_LLC_DESTINATION_LSAP)) ||
+						((hdlc_rx.llc_skip == 2) && ((data & 0xFE) != HDLC_LLC_SOURCE_COMMAND_LSAP)) ||
+						((hdlc_rx.llc_skip == 1) && (data != HDLC_LLC_CONTROL))) {
+					hdlc_rx.seg_bad = 1;
+				}
+
+				hdlc_rx.llc_skip--;
+				copy--;
+				pos++;
+				hdlc_rx.frame_pos++;
+				run--;
+			}
+
+			if (hdlc_rx.apdu_len + hdlc_rx.seg_len + copy > DLMS_BUF_SIZE) {
+				hdlc_rx.seg_bad = 1;
+			}
+
+			if (!hdlc_rx.discard && !hdlc_rx.seg_bad) {
+				memcpy(&ptr_rx_dlms_msg->buf[hdlc_rx.apdu_len + hdlc_rx.seg_len], &ptr_rx_serial->buf[pos], copy);
+				hdlc_rx.seg_len += copy;
+			}
+
+			pos += run;
+			hdlc_rx.frame_pos += run;
+
+			if (hdlc_rx.frame_pos < hdlc_rx.frame_len) {
+				break;
+			}
+
+			/* CHECK FCS */
+			if (hdlc_rx.crc == HDLC_FCS_GOOD) {
+				_hdlc_rx_frame(ptr_rx_dlms_msg);
+			} else {
+				/* ERROR FCS. Header is good: for an I-frame, RR tells the peer which one is expected */
+				hdlc_rx.lost = 1;
+				if (!(hdlc_rx.header[hdlc_rx.header_size - 3] & 0x01)) {
+					hdlc_rx.ack_pending = 1;
+				}
+			}
+
+			/* Closing flag expected, that can also open next frame */
+			hdlc_rx.state = HDLC_RX_HUNT;
+			break;
 		}
-		
-		memcpy(&ptr_rx_dlms_msg->buf, &ptr_rx_serial->buf[11], ptr_rx_dlms_msg->length);	  
-		ptr_rx_dlms_msg->todo = 1;    
 	}
 
-	ptr_rx_serial->todo = 0; 
+	if (pos < ptr_rx_serial->length) {
+		/* Keep bytes of next frame: serial message has to be processed again */
+		memmove(ptr_rx_serial->buf, &ptr_rx_serial->buf[pos], ptr_rx_serial->length - pos);
+		ptr_rx_serial->length -= pos;
+		ptr_rx_serial->todo = 1;
+	} else {
+		ptr_rx_serial->todo = 0;
+	}
+
 	return ptr_rx_dlms_msg->todo;
 }
 
+/*
+ * Function: _hdlc_build_short
+ *  Description: Builds a frame without information field
+ * Arguments:
+ *  struct serial_msg *ptr_tx_serial - serial buffer to fill
+ *  uint8_t control - control field
+ * Returns:
+ *  static - void
+ */
+static void _hdlc_build_short(struct serial_msg *ptr_tx_serial, uint8_t control)
+{
+	ptr_tx_serial->buf[0] = HDLC_START_END_FLAG;
+	ptr_tx_serial->buf[1] = HDLC_FRAME_FORMAT_WITHOUT_SEGMENTATION;
+	ptr_tx_serial->buf[2] = 7;
+	ptr_tx_serial->buf[3] = HDLC_ADDR_METER; /* DEST ADDR */
+	ptr_tx_serial->buf[4] = HDLC_ADDR_MODEM; /* SOURCE ADDR */
+	ptr_tx_serial->buf[5] = control;
+	fcs = hdlc_ChksumCalculate(0xFFFF, &ptr_tx_serial->buf[1], 5);
+	fcs ^= 0xffff;		/* Complement */
+	ptr_tx_serial->buf[6] = (uint8_t) (fcs & 0x00FF);
+	ptr_tx_serial->buf[7] = (uint8_t) ((fcs & 0xFF00) >> 8);
+	ptr_tx_serial->buf[8] = HDLC_START_END_FLAG;
+	ptr_tx_serial->length = 9;
+	ptr_tx_serial->todo = 1;
+}
+
+/*
+ * Function: hdlc_AckProcess
+ *  Description: Builds a UA frame answering link setup, or a RR frame
+ *  acknowledging received I-frames, if needed
+ * Arguments:
+ *  struct serial_msg *ptr_tx_serial - serial buffer to fill
+ * Returns:
+ *  uint8_t - 1 if the serial buffer has been filled
+ */
+uint8_t hdlc_AckProcess(struct serial_msg *ptr_tx_serial)
+{
+	if (hdlc_link.ua_pending) {
+		/* Answer to SNRM or DISC, default link parameters */
+		_hdlc_build_short(ptr_tx_serial, HDLC_CONTROL_UA | HDLC_CONTROL_PF);
+		hdlc_link.ua_pending = 0;
+		return 1;
+	}
+
+	if (!hdlc_rx.ack_pending) {
+		return 0;
+	}
+
+	_hdlc_build_short(ptr_tx_serial, HDLC_CONTROL_RR | HDLC_CONTROL_PF | (hdlc_rx.vr << 5));
+	hdlc_rx.ack_pending = 0;
+	hdlc_rx.unacked = 0;
+
+	return 1;
+}
+
+/*
+ * Function: hdlc_TxProcess
+ *  Description: Builds next frame of the APDU. APDUs longer than
+ *  HDLC_MAX_INFO_TX are sent as segments: call again until it returns 0.
+ *  In UI mode, the APDU todo flag is cleared once its last frame is built.
+ *  In numbered mode, I-frames are sent as the window allows and todo is
+ *  cleared once all of them are acknowledged (or given up after
+ *  HDLC_TX_MAX_RETRIES); the APDU must not be changed until then. A SNRM
+ *  requested by hdlc_Connect goes first.
+ * Arguments:
+ *  struct serial_msg *ptr_tx_serial - serial buffer to fill
+ *  struct dlms_msg *ptr_tx_dlms_msg - APDU to send
+ * Returns:
+ *  uint8_t - 1 if the serial buffer has been filled
+ */
 uint8_t hdlc_TxProcess(struct serial_msg *ptr_tx_serial, struct dlms_msg *ptr_tx_dlms_msg)
 {
-	  
-  if (ptr_tx_dlms_msg->todo){              
-    /* FILL SERIAL DATA BUFFER */
-    /* HDLC FLAG */
-    ptr_tx_serial->buf[0] = HDLC_START_END_FLAG;
-
-    /* FRAME FORMAT */
-    ptr_tx_serial->buf[1] = HDLC_FRAME_FORMAT_WITHOUT_SEGMENTATION;
-
-    /* LENGTH = Length_DLMS_APDU + HDLC_header(14bytes) */
-    ptr_tx_serial->length = ptr_tx_dlms_msg->length + 14;    // FILL SERIAL DATA LENGTH
-    ptr_tx_serial->buf[2] = ptr_tx_serial->length - 2;  // Excluding HDLC_START_END_FLAGs
-
-    /* HDLC ADDRESSES */
-    ptr_tx_serial->buf[3] = HDLC_ADDR_METER; /* DEST ADDR */
-    ptr_tx_serial->buf[4] = HDLC_ADDR_MODEM; /* SOURCE ADDR */
-
-    /* CONTROL (0x13)*/
-    ptr_tx_serial->buf[5] = HDLC_CONTROL;
-
-    /* HCS */
-    hcs = hdlc_ChksumCalculate(0xFFFF, &ptr_tx_serial->buf[1], 5);
-    hcs ^= 0xffff;		/* Complement */
-    ptr_tx_serial->buf[6] = (uint8_t) (hcs & 0x00FF);
-    ptr_tx_serial->buf[7] = (uint8_t) ((hcs & 0xFF00) >> 8);
-
-    /* LLC */
-    ptr_tx_serial->buf[8] = HDLC_LLC_DESTINATION_LSAP;
-    ptr_tx_serial->buf[9] = HDLC_LLC_SOURCE_COMMAND_LSAP;
-    ptr_tx_serial->buf[10] = HDLC_LLC_CONTROL;
-
-    /* HDCL DATA. DLMS APDU */
-    memcpy(&ptr_tx_serial->buf[11], ptr_tx_dlms_msg->buf, ptr_tx_dlms_msg->length);
-
-    hdlc_tail_pos = ptr_tx_dlms_msg->length + 11;
-
-    /* FCS */
-    fcs = hdlc_ChksumCalculate(0xFFFF, &ptr_tx_serial->buf[1], ptr_tx_serial->length - 4);
-    fcs ^= 0xffff;		/* Complement */
-    ptr_tx_serial->buf[hdlc_tail_pos] = (uint8_t) (fcs & 0x00FF);
-    ptr_tx_serial->buf[hdlc_tail_pos + 1] = (uint8_t) ((fcs & 0xFF00) >> 8); 
-        
-    /* HDLC FLAG */
-    ptr_tx_serial->buf[hdlc_tail_pos + 2] = HDLC_START_END_FLAG;
-
-    // FILL SERIAL TODO FLAG
-    ptr_tx_serial->todo = 1;
-#ifdef DUMP_HDLC
-    LogDump(ptr_tx_serial->buf, ptr_tx_serial->length);
-#endif /* DUMP_HDLC */ 	            
+  uint16_t info_len;
+  uint16_t apdu_len;
+  uint16_t frame_len;
+  uint8_t outstanding;
+  uint8_t *info;
+
+  if (!ptr_tx_dlms_msg->todo) {
+    return 0;
   }
- 
-  return ptr_tx_serial->todo;
 
-}
+  if (ptr_tx_dlms_msg->length == 0) {
+    /* Nothing to send */
+    ptr_tx_dlms_msg->todo = 0;
+    return 0;
+  }
+
+  if (hdlc_link.snrm_pending) {
+    hdlc_link.snrm_pending = 0;
+    hdlc_link.ua_tout = HDLC_TX_ACK_TIMEOUT;
+    _hdlc_build_short(ptr_tx_serial, HDLC_CONTROL_SNRM | HDLC_CONTROL_PF);
+    return 1;
+  }
+
+  if (hdlc_link.ua_tout) {
+    /* Waiting for UA */
+    return 0;
+  }
+
+  if (hdlc_tx.apdu != ptr_tx_dlms_msg) {
+    /* New APDU */
+    hdlc_tx.apdu = ptr_tx_dlms_msg;
+    hdlc_tx.offset = 0;
+    hdlc_tx.acked = 0;
+    hdlc_tx.retries = 0;
+  }
+
+  outstanding = (hdlc_tx.vs - hdlc_tx.va) & 0x07;
+  if (hdlc_tx.offset >= ptr_tx_dlms_msg->length) {
+    /* Everything sent, waiting for acknowledgement */
+    return 0;
+  }
+
+  if (hdlc_link.numbered && (outstanding >= HDLC_TX_WINDOW)) {
+    /* Window full, waiting for acknowledgement */
+    return 0;
+  }
+
+  /* HDLC FLAG */
+  ptr_tx_serial->buf[0] = HDLC_START_END_FLAG;
+
+  /* HDLC ADDRESSES */
+  ptr_tx_serial->buf[3] = HDLC_ADDR_METER; /* DEST ADDR */
+  ptr_tx_serial->buf[4] = HDLC_ADDR_MODEM; /* SOURCE ADDR */
+
+  info = &ptr_tx_serial->buf[8];
+  info_len = 0;
+  if (hdlc_tx.offset == 0) {
+    /* LLC, only in first segment */
+    info[info_len++] = HDLC_LLC_DESTINATION_LSAP;
+    info[info_len++] = HDLC_LLC_SOURCE_COMMAND_LSAP;
+    info[info_len++] = HDLC_LLC_CONTROL;
+  }
 
+  /* HDCL DATA. DLMS APDU */
+  apdu_len = ptr_tx_dlms_msg->length - hdlc_tx.offset;
+  if (apdu_len > HDLC_MAX_INFO_TX - info_len) {
+    apdu_len = HDLC_MAX_INFO_TX - info_len;
+  }
+
+  memcpy(&info[info_len], &ptr_tx_dlms_msg->buf[hdlc_tx.offset], apdu_len);
+  info_len += apdu_len;
+  hdlc_tx.seg_offset[hdlc_tx.vs] = hdlc_tx.offset;
+  hdlc_tx.offset += apdu_len;
 
+  if (hdlc_link.numbered) {
+    /* CONTROL: I-frame with N(R) and N(S). Poll on the last segment and when the window is full */
+    ptr_tx_serial->buf[5] = (uint8_t)((hdlc_rx.vr << 5) | (hdlc_tx.vs << 1));
+    if ((hdlc_tx.offset >= ptr_tx_dlms_msg->length) || (outstanding + 1 >= HDLC_TX_WINDOW)) {
+      ptr_tx_serial->buf[5] |= HDLC_CONTROL_PF;
+    }
 
+    hdlc_tx.vs = (hdlc_tx.vs + 1) & 0x07;
+    hdlc_tx.ack_tout = HDLC_TX_ACK_TIMEOUT;
+  } else {
+    /* CONTROL (0x13): UI frame, poll on the last segment. Not acknowledged */
+    ptr_tx_serial->buf[5] = HDLC_CONTROL_UI;
+    if (hdlc_tx.offset >= ptr_tx_dlms_msg->length) {
+      ptr_tx_serial->buf[5] |= HDLC_CONTROL_PF;
+      ptr_tx_dlms_msg->todo = 0;
+      hdlc_tx.apdu = NULL;
+    }
+  }
+
+  /* FRAME FORMAT AND LENGTH (11 bits, excluding HDLC_START_END_FLAGs) */
+  frame_len = info_len + 9;
+  ptr_tx_serial->buf[1] = HDLC_FRAME_FORMAT_WITHOUT_SEGMENTATION | (uint8_t)((frame_len >> 8) & 0x07);
+  if (hdlc_tx.offset < ptr_tx_dlms_msg->length) {
+    ptr_tx_serial->buf[1] |= HDLC_FRAME_FORMAT_SEGMENTATION;
+  }
 
+  ptr_tx_serial->buf[2] = (uint8_t)(frame_len & 0xFF);
+  ptr_tx_serial->length = frame_len + 2;    // FILL SERIAL DATA LENGTH
 
+  /* HCS */
+  hcs = hdlc_ChksumCalculate(0xFFFF, &ptr_tx_serial->buf[1], 5);
+  hcs ^= 0xffff;		/* Complement */
+  ptr_tx_serial->buf[6] = (uint8_t) (hcs & 0x00FF);
+  ptr_tx_serial->buf[7] = (uint8_t) ((hcs & 0xFF00) >> 8);
 
+  hdlc_tail_pos = info_len + 8;
+
+  /* FCS, going on from the HCS computation state */
+  fcs = hdlc_ChksumCalculate(hcs ^ 0xffff, &ptr_tx_serial->buf[6], info_len + 2);
+  fcs ^= 0xffff;		/* Complement */
+  ptr_tx_serial->buf[hdlc_tail_pos] = (uint8_t) (fcs & 0x00FF);
+  ptr_tx_serial->buf[hdlc_tail_pos + 1] = (uint8_t) ((fcs & 0xFF00) >> 8);
+
+  /* HDLC FLAG */
+  ptr_tx_serial->buf[hdlc_tail_pos + 2] = HDLC_START_END_FLAG;
+
+  // FILL SERIAL TODO FLAG
+  ptr_tx_serial->todo = 1;
+#ifdef DUMP_HDLC
+  LogDump(ptr_tx_serial->buf, ptr_tx_serial->length);
+#endif /* DUMP_HDLC */
+
+  return 1;
+}
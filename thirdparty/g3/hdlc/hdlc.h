@@ -59,9 +59,23 @@
 /*** Constants *************************************************************/
 #define HDLC_START_END_FLAG 			0x7E
 #define HDLC_FRAME_FORMAT_WITHOUT_SEGMENTATION 	0xA0
+#define HDLC_FRAME_FORMAT_TYPE_MASK 		0xF0
+#define HDLC_FRAME_FORMAT_SEGMENTATION 		0x08
+#define HDLC_FRAME_LENGTH_MASK 			0x07FF
 #define HDLC_ADDR_METER 			0x03
 #define HDLC_ADDR_MODEM 			0xFD
 #define HDLC_CONTROL 				0x13
+#define HDLC_CONTROL_PF 			0x10
+#define HDLC_CONTROL_RR 			0x01
+#define HDLC_CONTROL_S_MASK 			0x0F
+#define HDLC_CONTROL_UI 			0x03
+#define HDLC_CONTROL_SNRM 			0x83
+#define HDLC_CONTROL_DISC 			0x43
+#define HDLC_CONTROL_UA 			0x63
+#define HDLC_CONTROL_DM 			0x0F
+
+/* Residue of the FCS computed over a frame including its valid FCS */
+#define HDLC_FCS_GOOD 				0xF0B8
 
 #define HDLC_LLC_DESTINATION_LSAP 		0xE6
 #define HDLC_LLC_SOURCE_COMMAND_LSAP  		0xE6
@@ -72,9 +86,52 @@
 
 #define HDLC_INTERFRAME_TIMEOUT			200
 
-/* Maximum length of DLMS APDU over serial_if */
+/* Maximum length of DLMS APDU over serial_if. APDUs longer than a frame */
+/* are reassembled from / split into segments */
+#ifndef DLMS_BUF_SIZE
+#define DLMS_BUF_SIZE 				2048
+#endif
+
+/* Maximum information field length per transmitted frame (IEC 62056-46 */
+/* default). Longer APDUs are sent as a sequence of segments (S bit set in */
+/* all but the last one) */
+#ifndef HDLC_MAX_INFO_TX
+#define HDLC_MAX_INFO_TX 			128
+#endif
+
+/* Number of I-frames received before acknowledging with RR (a frame with */
+/* the poll bit set is always acknowledged) */
+#ifndef HDLC_RX_WINDOW
+#define HDLC_RX_WINDOW 				1
+#endif
+
+/* Numbered mode (I-frames, RR acknowledgement and window) is only used once */
+/* the link is set up with SNRM/UA, or the peer sends I-frames. Otherwise */
+/* APDUs are sent in UI frames and not acknowledged, as UI-only peers expect */
+
+/* Number of I-frames sent before waiting for acknowledgement (1 to 7) */
+#ifndef HDLC_TX_WINDOW
+#define HDLC_TX_WINDOW 				1
+#endif
+
+/* Time (ms) to wait for acknowledgement before sending I-frames again, */
+/* and for UA after SNRM before falling back to UI frames */
+#ifndef HDLC_TX_ACK_TIMEOUT
+#define HDLC_TX_ACK_TIMEOUT 			1000
+#endif
+
+/* Times I-frames are sent again before the APDU is given up */
+#ifndef HDLC_TX_MAX_RETRIES
+#define HDLC_TX_MAX_RETRIES 			3
+#endif
+
+/* Time (ms) to wait for next segment before a partial APDU is dropped */
+#ifndef HDLC_RX_APDU_TIMEOUT
+#define HDLC_RX_APDU_TIMEOUT 			2000
+#endif
+
+/* HDLC overhead of a frame: flags, format, addresses, control, HCS, LLC and FCS */
 #define OVERHEAD_HDLC 			14
-#define DLMS_BUF_SIZE   (SERIAL_BUF_SIZE - OVERHEAD_HDLC)
 
 /*** Structs *************************************************************/
 struct dlms_msg
@@ -87,8 +144,11 @@ struct dlms_msg
 /*** Functions prototypes **************************************************/
 void HDLC_iframe_tout_init(uint16_t *ptr_HDLC_iframe_tout);
 void hdlc_init(void);
+void hdlc_Connect(void);
 uint8_t hdlc_RxProcess(struct dlms_msg *ptr_rx_dlms_msg, struct serial_msg *ptr_rx_serial);
 uint8_t hdlc_TxProcess(struct serial_msg *ptr_tx_serial, struct dlms_msg *ptr_tx_dlms_msg);
+uint8_t hdlc_AckProcess(struct serial_msg *ptr_tx_serial);
+void hdlc_TimersUpdate(void);
 
 #endif
 
@@ -0,0 +1,8 @@
+#ifndef LOGGER_H_INCLUDED
+#define LOGGER_H_INCLUDED
+
+#include <stdint.h>
+
+#define LogDump(buf, len)
+
+#endif
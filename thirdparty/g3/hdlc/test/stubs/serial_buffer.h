@@ -0,0 +1,14 @@
+#ifndef SERIAL_BUFFER_H_INCLUDED
+#define SERIAL_BUFFER_H_INCLUDED
+
+#include <stdint.h>
+
+#define SERIAL_BUF_SIZE   1024
+
+struct serial_msg {
+	uint8_t todo;
+	uint8_t buf[SERIAL_BUF_SIZE];
+	uint16_t length;
+};
+
+#endif
@@ -0,0 +1,501 @@
+/**
+ * \file
+ *
+ * \brief Host test of the HDLC layer.
+ *
+ * The layer is looped back on itself, in numbered mode once a SNRM has been
+ * answered: I-frames built by hdlc_TxProcess and RR frames built by
+ * hdlc_AckProcess are fed to hdlc_RxProcess, each serial message made of
+ * whole frames as the dispatchers route them. Frames can be dropped or cut
+ * to check that every APDU is delivered once and intact, and that partial
+ * APDUs do not outlive their timeout. A peer that only takes UI frames gets
+ * every APDU once, in UI frames, whether SNRM has been tried or not.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Small frames and a window of several frames, so that APDUs are segmented */
+#define HDLC_MAX_INFO_TX   64
+#define HDLC_TX_WINDOW     3
+#define HDLC_RX_WINDOW     2
+
+#include "../hdlc.c"
+
+#define RR_FIFO_SIZE   8
+
+static int si_failures;
+
+#define CHECK(cond) do { \
+		if (!(cond)) { \
+			printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+			si_failures++; \
+		} \
+	} while (0)
+
+static struct dlms_msg sx_tx;
+static struct dlms_msg sx_rx;
+static struct serial_msg sx_ser;
+
+/* APDU being sent, as it has to be delivered */
+static uint8_t suc_expected[DLMS_BUF_SIZE];
+static uint16_t sus_expected_len;
+static bool sb_expected;
+static uint32_t sul_delivered;
+
+/* RR frames on their way back */
+static struct serial_msg sx_rr_fifo[RR_FIFO_SIZE];
+static int si_rr_count;
+
+/* Frames sent, and the one of each kind to drop (-1 for none) */
+static uint32_t sul_iframes;
+static uint32_t sul_rrs;
+static uint32_t sul_uas;
+static int32_t sl_drop_iframe;
+static int32_t sl_drop_rr;
+/* I-frames from this one on are lost */
+static uint32_t sul_iframe_cut;
+/* N(S) expected in next I-frame, checked while there are no losses */
+static bool sb_check_ns;
+static uint8_t suc_next_ns;
+
+uint16_t pcrc_crc16_x25_update(uint16_t us_crc, const uint8_t *puc_buf, uint32_t ul_len)
+{
+	uint8_t uc_bit;
+
+	while (ul_len--) {
+		us_crc ^= *puc_buf++;
+		for (uc_bit = 0; uc_bit < 8; uc_bit++) {
+			us_crc = (us_crc & 0x0001) ? (uint16_t)((us_crc >> 1) ^ 0x8408) : (uint16_t)(us_crc >> 1);
+		}
+	}
+
+	return us_crc;
+}
+
+static void _check_apdu(void)
+{
+	CHECK(sb_expected);
+	CHECK(sx_rx.length == sus_expected_len);
+	CHECK(memcmp(sx_rx.buf, suc_expected, sus_expected_len) == 0);
+	sb_expected = false;
+	sul_delivered++;
+}
+
+/* Passes a serial message to the receiver, as the dispatchers do */
+static void _deliver(const struct serial_msg *px_msg)
+{
+	struct serial_msg *px_rr;
+
+	sx_ser = *px_msg;
+	sx_ser.todo = 1;
+	do {
+		hdlc_RxProcess(&sx_rx, &sx_ser);
+		px_rr = &sx_rr_fifo[si_rr_count];
+		if ((si_rr_count < RR_FIFO_SIZE) && hdlc_AckProcess(px_rr)) {
+			CHECK(px_rr->length == 9);
+			if (px_rr->buf[5] == (HDLC_CONTROL_UA | HDLC_CONTROL_PF)) {
+				sul_uas++;
+				si_rr_count++;
+			} else {
+				CHECK((px_rr->buf[5] & 0x1F) == (HDLC_CONTROL_RR | HDLC_CONTROL_PF));
+				if ((int32_t)sul_rrs++ != sl_drop_rr) {
+					si_rr_count++;
+				}
+			}
+		}
+
+		if (sx_rx.todo) {
+			_check_apdu();
+			sx_rx.todo = 0;
+		}
+	} while (sx_ser.todo);
+}
+
+static void _deliver_rrs(void)
+{
+	int i;
+	int i_count = si_rr_count;
+
+	si_rr_count = 0;
+	for (i = 0; i < i_count; i++) {
+		_deliver(&sx_rr_fifo[i]);
+	}
+}
+
+/*
+ * Sends the pending APDU, I-frames of a window in one serial message.
+ * Returns the time (ms) it took, or -1 if it did not end in i_max_ms.
+ */
+static int _run(int i_max_ms)
+{
+	struct serial_msg x_frame;
+	struct serial_msg x_msg;
+	bool b_progress;
+	int i_ms = 0;
+	uint8_t uc_control;
+
+	while (sx_tx.todo) {
+		b_progress = false;
+		x_msg.length = 0;
+		while (hdlc_TxProcess(&x_frame, &sx_tx)) {
+			uc_control = x_frame.buf[5];
+			/* I-frames only, format and flags in place */
+			CHECK(!(uc_control & 0x01));
+			CHECK(x_frame.buf[0] == HDLC_START_END_FLAG);
+			CHECK(x_frame.buf[x_frame.length - 1] == HDLC_START_END_FLAG);
+			CHECK((x_frame.buf[1] & HDLC_FRAME_FORMAT_TYPE_MASK) == HDLC_FRAME_FORMAT_WITHOUT_SEGMENTATION);
+			CHECK(x_frame.length <= HDLC_MAX_INFO_TX + 11);
+			if (sb_check_ns) {
+				CHECK(((uc_control >> 1) & 0x07) == suc_next_ns);
+				suc_next_ns = (suc_next_ns + 1) & 0x07;
+			}
+
+			b_progress = true;
+			sul_iframes++;
+			if (((int32_t)sul_iframes - 1 == sl_drop_iframe) || (sul_iframes > sul_iframe_cut)) {
+				continue;
+			}
+
+			CHECK(x_msg.length + x_frame.length <= SERIAL_BUF_SIZE);
+			memcpy(&x_msg.buf[x_msg.length], x_frame.buf, x_frame.length);
+			x_msg.length += x_frame.length;
+		}
+
+		if (x_msg.length) {
+			_deliver(&x_msg);
+		}
+
+		if (si_rr_count) {
+			_deliver_rrs();
+			b_progress = true;
+		}
+
+		if (!b_progress && sx_tx.todo) {
+			if (++i_ms > i_max_ms) {
+				return -1;
+			}
+
+			hdlc_TimersUpdate();
+		}
+	}
+
+	return i_ms;
+}
+
+static void _send(uint16_t us_len, uint32_t ul_seed)
+{
+	uint16_t us_i;
+
+	for (us_i = 0; us_i < us_len; us_i++) {
+		sx_tx.buf[us_i] = (uint8_t)((ul_seed * 131 + us_i * 7) ^ (us_i >> 3));
+	}
+
+	sx_tx.length = us_len;
+	sx_tx.todo = 1;
+	memcpy(suc_expected, sx_tx.buf, us_len);
+	sus_expected_len = us_len;
+	sb_expected = true;
+}
+
+/* Starts again in UI mode */
+static void _reset_ui(void)
+{
+	hdlc_init();
+	memset(&sx_tx, 0, sizeof(sx_tx));
+	memset(&sx_rx, 0, sizeof(sx_rx));
+	sb_expected = false;
+	sul_delivered = 0;
+	si_rr_count = 0;
+	sul_iframes = 0;
+	sul_rrs = 0;
+	sul_uas = 0;
+	sl_drop_iframe = -1;
+	sl_drop_rr = -1;
+	sul_iframe_cut = UINT32_MAX;
+	sb_check_ns = false;
+	suc_next_ns = 0;
+}
+
+/* Starts again in numbered mode: SNRM received and answered with UA */
+static void _reset(void)
+{
+	struct serial_msg x_snrm;
+
+	_reset_ui();
+	_hdlc_build_short(&x_snrm, HDLC_CONTROL_SNRM | HDLC_CONTROL_PF);
+	_deliver(&x_snrm);
+	CHECK(sul_uas == 1);
+	CHECK(hdlc_link.numbered);
+	_deliver_rrs();
+	CHECK(hdlc_link.numbered);
+	CHECK((hdlc_tx.vs == 0) && (hdlc_rx.vr == 0));
+}
+
+/* 64 KB of APDUs of any length, without losses: no timeout is needed */
+static void test_stream(void)
+{
+	uint32_t ul_bytes = 0;
+	uint32_t ul_apdus = 0;
+	uint16_t us_len;
+
+	_reset();
+	sb_check_ns = true;
+	srand(3);
+	while (ul_bytes < 65536) {
+		us_len = 1 + rand() % DLMS_BUF_SIZE;
+		_send(us_len, ul_apdus);
+		CHECK(_run(0) == 0);
+		CHECK(!sb_expected);
+		ul_bytes += us_len;
+		ul_apdus++;
+	}
+
+	CHECK(sul_delivered == ul_apdus);
+	CHECK(sul_iframes > ul_apdus * 2);
+	CHECK(sul_rrs > 0);
+	CHECK(hdlc_tx.va == hdlc_tx.vs);
+	CHECK(hdlc_tx.apdu == NULL);
+
+	/* Longest APDU still fits */
+	_send(DLMS_BUF_SIZE, 1);
+	CHECK(_run(0) == 0);
+	CHECK(sul_delivered == ul_apdus + 1);
+}
+
+/* A lost I-frame is sent again after the acknowledgement timeout */
+static void test_lost_iframe(void)
+{
+	int i_drop;
+	int i_ms;
+
+	for (i_drop = 0; i_drop < 7; i_drop++) {
+		_reset();
+		_send(100, 5);
+		CHECK(_run(0) == 0);
+
+		sl_drop_iframe = sul_iframes + i_drop;
+		_send(400, 7);
+		i_ms = _run(10 * HDLC_TX_ACK_TIMEOUT);
+		CHECK(i_ms >= HDLC_TX_ACK_TIMEOUT);
+		CHECK(!sb_expected);
+		CHECK(sul_delivered == 2);
+
+		/* Next one goes straight */
+		_send(300, 9);
+		CHECK(_run(0) == 0);
+		CHECK(sul_delivered == 3);
+	}
+}
+
+/* A lost RR makes the sender repeat frames already received: they are dropped */
+static void test_lost_rr(void)
+{
+	uint32_t ul_frames;
+	int i_drop;
+
+	for (i_drop = 0; i_drop < 4; i_drop++) {
+		_reset();
+		sl_drop_rr = i_drop;
+		_send(600, 11);
+		ul_frames = (600 + 3 + HDLC_MAX_INFO_TX - 1) / HDLC_MAX_INFO_TX;
+		CHECK(_run(10 * HDLC_TX_ACK_TIMEOUT) >= HDLC_TX_ACK_TIMEOUT);
+		CHECK(sul_iframes > ul_frames);
+		CHECK(sul_delivered == 1);
+
+		_send(50, 13);
+		CHECK(_run(0) == 0);
+		CHECK(sul_delivered == 2);
+	}
+}
+
+/* Peer gone in the middle of an APDU: both sides give it up */
+static void test_partial_apdu_timeout(void)
+{
+	_reset();
+	/* Only the first segment reaches the receiver */
+	sul_iframe_cut = 1;
+	sl_drop_rr = 0;
+	_send(500, 17);
+	CHECK(_run(10 * HDLC_TX_ACK_TIMEOUT) >= (HDLC_TX_MAX_RETRIES + 1) * HDLC_TX_ACK_TIMEOUT);
+	/* Sender gave up after HDLC_TX_MAX_RETRIES, receiver dropped the segment */
+	CHECK(hdlc_tx.apdu == NULL);
+	CHECK(hdlc_rx.apdu_len == 0);
+	CHECK(!hdlc_rx.discard);
+	CHECK(sul_delivered == 0);
+	sb_expected = false;
+
+	/* Next APDU is not appended to the old segment */
+	sul_iframe_cut = UINT32_MAX;
+	sl_drop_rr = -1;
+	_send(200, 19);
+	CHECK(_run(0) == 0);
+	CHECK(sul_delivered == 1);
+}
+
+/* Receiver restarted: sender follows N(R) and sends the APDU again from the start */
+static void test_peer_restart(void)
+{
+	_reset();
+	_send(250, 23);
+	CHECK(_run(0) == 0);
+	CHECK(hdlc_tx.vs != 0);
+
+	hdlc_rx.vr = 0;
+	_send(250, 29);
+	CHECK(_run(0) == 0);
+	CHECK(sul_delivered == 2);
+	CHECK(hdlc_tx.vs == hdlc_rx.vr);
+}
+
+/* A frame cut at the end of a serial message does not swallow the next one */
+static void test_frame_cut(void)
+{
+	struct serial_msg x_frame;
+	struct serial_msg x_msg;
+
+	_reset();
+	_send(40, 31);
+	CHECK(hdlc_TxProcess(&x_frame, &sx_tx));
+	/* Frame, then the beginning of another one */
+	x_msg = x_frame;
+	memcpy(&x_msg.buf[x_frame.length], x_frame.buf, 6);
+	x_msg.length = x_frame.length + 6;
+	_deliver(&x_msg);
+	CHECK(sul_delivered == 1);
+	_deliver_rrs();
+	CHECK(!sx_tx.todo);
+
+	_send(40, 37);
+	CHECK(_run(0) == 0);
+	CHECK(sul_delivered == 2);
+
+	/* Cut in the middle of a segmented APDU: recovered by sending again */
+	_send(300, 41);
+	CHECK(hdlc_TxProcess(&x_frame, &sx_tx));
+	_deliver(&x_frame);
+	CHECK(hdlc_TxProcess(&x_frame, &sx_tx));
+	x_frame.length -= 10;
+	_deliver(&x_frame);
+	CHECK(_run(10 * HDLC_TX_ACK_TIMEOUT) >= HDLC_TX_ACK_TIMEOUT);
+	CHECK(sul_delivered == 3);
+}
+
+/*
+ * Sends the pending APDU to a peer that only takes UI frames and never
+ * answers. Returns the number of frames sent.
+ */
+static uint32_t _run_ui(void)
+{
+	struct serial_msg x_frame;
+	uint32_t ul_frames = 0;
+	uint8_t uc_control;
+	int i_ms;
+
+	while (hdlc_TxProcess(&x_frame, &sx_tx)) {
+		uc_control = x_frame.buf[5];
+		CHECK((uc_control & ~HDLC_CONTROL_PF) == HDLC_CONTROL_UI);
+		/* Poll on the last segment only, which is the one that completes the APDU */
+		CHECK(((uc_control & HDLC_CONTROL_PF) != 0) == !(x_frame.buf[1] & HDLC_FRAME_FORMAT_SEGMENTATION));
+		CHECK(((uc_control & HDLC_CONTROL_PF) != 0) == !sx_tx.todo);
+		CHECK(x_frame.length <= HDLC_MAX_INFO_TX + 11);
+		ul_frames++;
+		_deliver(&x_frame);
+	}
+
+	/* Nothing to wait for, and nothing sent again later */
+	CHECK(!sx_tx.todo);
+	CHECK(si_rr_count == 0);
+	for (i_ms = 0; i_ms < 10 * HDLC_TX_ACK_TIMEOUT; i_ms++) {
+		hdlc_TimersUpdate();
+	}
+
+	sx_tx.todo = 0;
+	CHECK(!hdlc_TxProcess(&x_frame, &sx_tx));
+
+	return ul_frames;
+}
+
+/* UI-only peer: APDUs in UI frames, each one sent and delivered once */
+static void test_ui_peer(void)
+{
+	struct serial_msg x_frame;
+	uint32_t ul_apdus;
+	uint32_t ul_frames = 0;
+	uint16_t us_len;
+	int i_ms;
+
+	_reset_ui();
+	srand(43);
+	for (ul_apdus = 0; ul_apdus < 200; ul_apdus++) {
+		us_len = 1 + rand() % DLMS_BUF_SIZE;
+		_send(us_len, ul_apdus);
+		ul_frames += _run_ui();
+		CHECK(!sb_expected);
+		CHECK(sul_delivered == ul_apdus + 1);
+	}
+
+	CHECK(ul_frames > ul_apdus * 2);
+	CHECK(!hdlc_link.numbered);
+	CHECK(sul_rrs == 0);
+
+	/* SNRM not answered: UI frames after the timeout */
+	_reset_ui();
+	hdlc_Connect();
+	_send(700, 47);
+	CHECK(hdlc_TxProcess(&x_frame, &sx_tx));
+	CHECK(x_frame.length == 9);
+	CHECK(x_frame.buf[5] == (HDLC_CONTROL_SNRM | HDLC_CONTROL_PF));
+	for (i_ms = 0; hdlc_link.ua_tout; i_ms++) {
+		CHECK(!hdlc_TxProcess(&x_frame, &sx_tx));
+		hdlc_TimersUpdate();
+	}
+
+	CHECK(i_ms == HDLC_TX_ACK_TIMEOUT);
+	CHECK(!hdlc_link.numbered);
+	CHECK(_run_ui() == (700 + 3 + HDLC_MAX_INFO_TX - 1) / HDLC_MAX_INFO_TX);
+	CHECK(sul_delivered == 1);
+
+	/* SNRM answered with DM: UI frames straight away */
+	_reset_ui();
+	hdlc_Connect();
+	_send(90, 53);
+	CHECK(hdlc_TxProcess(&x_frame, &sx_tx));
+	_hdlc_build_short(&x_frame, HDLC_CONTROL_DM | HDLC_CONTROL_PF);
+	_deliver(&x_frame);
+	CHECK(!hdlc_link.ua_tout);
+	CHECK(_run_ui() == (90 + 3 + HDLC_MAX_INFO_TX - 1) / HDLC_MAX_INFO_TX);
+	CHECK(sul_delivered == 1);
+
+	/* SNRM answered with UA: numbered mode */
+	_reset_ui();
+	hdlc_Connect();
+	_send(300, 59);
+	CHECK(hdlc_TxProcess(&x_frame, &sx_tx));
+	_hdlc_build_short(&x_frame, HDLC_CONTROL_UA | HDLC_CONTROL_PF);
+	_deliver(&x_frame);
+	CHECK(hdlc_link.numbered);
+	CHECK(_run(0) == 0);
+	CHECK(sul_delivered == 1);
+	CHECK(sul_iframes > 1);
+}
+
+int main(void)
+{
+	test_stream();
+	test_lost_iframe();
+	test_lost_rr();
+	test_partial_apdu_timeout();
+	test_peer_restart();
+	test_frame_cut();
+	test_ui_peer();
+
+	if (si_failures) {
+		printf("%d failure(s)\n", si_failures);
+		return 1;
+	}
+
+	printf("OK\n");
+	return 0;
+}
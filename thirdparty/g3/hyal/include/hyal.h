@@ -18,6 +18,18 @@
 
 struct THyALNotifications;
 
+/* HyAL attributes. Handled by HyAL itself through HyALGet/SetRequest, not forwarded to the MACs */
+/* Number of received frames remembered to discard duplicates from the other medium. 16 bits */
+#define HYAL_PIB_DUPLICATES_TABLE_SIZE   0x08000400
+/* Lifetime of remembered frames in ms, 0 to never expire. 32 bits */
+#define HYAL_PIB_DUPLICATES_TTL          0x08000401
+/* Data requests rejected because all request entries were in use. 32 bits (set any value to reset counters) */
+#define HYAL_PIB_DATA_QUEUE_FULL_COUNT   0x08000402
+/* Data requests sent without backup medium because no payload could be kept. 32 bits (set any value to reset counters) */
+#define HYAL_PIB_BACKUP_UNAVAILABLE_COUNT   0x08000403
+#define HYAL_PIB_FIRST                   HYAL_PIB_DUPLICATES_TABLE_SIZE
+#define HYAL_PIB_LAST                    HYAL_PIB_BACKUP_UNAVAILABLE_COUNT
+
 enum EHyALMediaTypeRequest {
 	HYAL_MEDIA_TYPE_REQ_PLC_BACKUP_RF = 0x00,
 	HYAL_MEDIA_TYPE_REQ_RF_BACKUP_PLC = 0x01,
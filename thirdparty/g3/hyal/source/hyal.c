@@ -6,6 +6,9 @@
 #include "hyal.h"
 #include "mac_wrapper.h"
 #include "mac_wrapper_defs.h"
+#include "pcrc.h"
+#include "oss_if.h"
+#include "QueueMng.h"
 
 #define LOG_LEVEL LOG_LVL_INFO
 #include <Logger.h>
@@ -13,64 +16,98 @@
 /* Buffer size to store data to be sent as Mac Data Request */
 #define HYAL_BACKUP_BUF_SIZE   400
 
-static const uint16_t crc16_tab[256] = {
-  0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50a5, 0x60c6, 0x70e7,
-  0x8108, 0x9129, 0xa14a, 0xb16b, 0xc18c, 0xd1ad, 0xe1ce, 0xf1ef,
-  0x1231, 0x0210, 0x3273, 0x2252, 0x52b5, 0x4294, 0x72f7, 0x62d6,
-  0x9339, 0x8318, 0xb37b, 0xa35a, 0xd3bd, 0xc39c, 0xf3ff, 0xe3de,
-  0x2462, 0x3443, 0x0420, 0x1401, 0x64e6, 0x74c7, 0x44a4, 0x5485,
-  0xa56a, 0xb54b, 0x8528, 0x9509, 0xe5ee, 0xf5cf, 0xc5ac, 0xd58d,
-  0x3653, 0x2672, 0x1611, 0x0630, 0x76d7, 0x66f6, 0x5695, 0x46b4,
-  0xb75b, 0xa77a, 0x9719, 0x8738, 0xf7df, 0xe7fe, 0xd79d, 0xc7bc,
-  0x48c4, 0x58e5, 0x6886, 0x78a7, 0x0840, 0x1861, 0x2802, 0x3823,
-  0xc9cc, 0xd9ed, 0xe98e, 0xf9af, 0x8948, 0x9969, 0xa90a, 0xb92b,
-  0x5af5, 0x4ad4, 0x7ab7, 0x6a96, 0x1a71, 0x0a50, 0x3a33, 0x2a12,
-  0xdbfd, 0xcbdc, 0xfbbf, 0xeb9e, 0x9b79, 0x8b58, 0xbb3b, 0xab1a,
-  0x6ca6, 0x7c87, 0x4ce4, 0x5cc5, 0x2c22, 0x3c03, 0x0c60, 0x1c41,
-  0xedae, 0xfd8f, 0xcdec, 0xddcd, 0xad2a, 0xbd0b, 0x8d68, 0x9d49,
-  0x7e97, 0x6eb6, 0x5ed5, 0x4ef4, 0x3e13, 0x2e32, 0x1e51, 0x0e70,
-  0xff9f, 0xefbe, 0xdfdd, 0xcffc, 0xbf1b, 0xaf3a, 0x9f59, 0x8f78,
-  0x9188, 0x81a9, 0xb1ca, 0xa1eb, 0xd10c, 0xc12d, 0xf14e, 0xe16f,
-  0x1080, 0x00a1, 0x30c2, 0x20e3, 0x5004, 0x4025, 0x7046, 0x6067,
-  0x83b9, 0x9398, 0xa3fb, 0xb3da, 0xc33d, 0xd31c, 0xe37f, 0xf35e,
-  0x02b1, 0x1290, 0x22f3, 0x32d2, 0x4235, 0x5214, 0x6277, 0x7256,
-  0xb5ea, 0xa5cb, 0x95a8, 0x8589, 0xf56e, 0xe54f, 0xd52c, 0xc50d,
-  0x34e2, 0x24c3, 0x14a0, 0x0481, 0x7466, 0x6447, 0x5424, 0x4405,
-  0xa7db, 0xb7fa, 0x8799, 0x97b8, 0xe75f, 0xf77e, 0xc71d, 0xd73c,
-  0x26d3, 0x36f2, 0x0691, 0x16b0, 0x6657, 0x7676, 0x4615, 0x5634,
-  0xd94c, 0xc96d, 0xf90e, 0xe92f, 0x99c8, 0x89e9, 0xb98a, 0xa9ab,
-  0x5844, 0x4865, 0x7806, 0x6827, 0x18c0, 0x08e1, 0x3882, 0x28a3,
-  0xcb7d, 0xdb5c, 0xeb3f, 0xfb1e, 0x8bf9, 0x9bd8, 0xabbb, 0xbb9a,
-  0x4a75, 0x5a54, 0x6a37, 0x7a16, 0x0af1, 0x1ad0, 0x2ab3, 0x3a92,
-  0xfd2e, 0xed0f, 0xdd6c, 0xcd4d, 0xbdaa, 0xad8b, 0x9de8, 0x8dc9,
-  0x7c26, 0x6c07, 0x5c64, 0x4c45, 0x3ca2, 0x2c83, 0x1ce0, 0x0cc1,
-  0xef1f, 0xff3e, 0xcf5d, 0xdf7c, 0xaf9b, 0xbfba, 0x8fd9, 0x9ff8,
-  0x6e17, 0x7e36, 0x4e55, 0x5e74, 0x2e93, 0x3eb2, 0x0ed1, 0x1ef0,
-};
-
 struct THyALDuplicatesEntry {
+	uint32_t m_u32Timestamp;
 	uint16_t m_u16SrcAddr;
 	uint16_t m_u16MsduLen;
 	uint16_t m_u16Crc;
 	uint8_t m_u8MediaType;
+	uint8_t m_u8Next;
 };
 
+/* Default number of frames remembered to detect duplicates (runtime configurable) */
+#ifndef HYAL_DUPLICATES_TABLE_SIZE
 #define HYAL_DUPLICATES_TABLE_SIZE   3
+#endif
+
+/* Maximum number of frames that can be remembered (storage reserved) */
+#ifndef HYAL_DUPLICATES_TABLE_MAX_SIZE
+#define HYAL_DUPLICATES_TABLE_MAX_SIZE   32
+#endif
+
+/* Default lifetime of remembered frames in ms (0: never expire) */
+#ifndef HYAL_DUPLICATES_TTL_MS
+#define HYAL_DUPLICATES_TTL_MS   0
+#endif
 
-static struct THyALDuplicatesEntry hyALDuplicatesTable[HYAL_DUPLICATES_TABLE_SIZE] = {{0}};
+/* Number of hash buckets, power of 2 */
+#if (HYAL_DUPLICATES_TABLE_MAX_SIZE <= 16)
+#define HYAL_DUPLICATES_HASH_SIZE   16
+#elif (HYAL_DUPLICATES_TABLE_MAX_SIZE <= 32)
+#define HYAL_DUPLICATES_HASH_SIZE   32
+#elif (HYAL_DUPLICATES_TABLE_MAX_SIZE <= 64)
+#define HYAL_DUPLICATES_HASH_SIZE   64
+#elif (HYAL_DUPLICATES_TABLE_MAX_SIZE <= 128)
+#define HYAL_DUPLICATES_HASH_SIZE   128
+#elif (HYAL_DUPLICATES_TABLE_MAX_SIZE < 255)
+#define HYAL_DUPLICATES_HASH_SIZE   256
+#else
+#error "HYAL_DUPLICATES_TABLE_MAX_SIZE must be lower than 255"
+#endif
+
+#if (HYAL_DUPLICATES_TABLE_SIZE < 1) || (HYAL_DUPLICATES_TABLE_SIZE > HYAL_DUPLICATES_TABLE_MAX_SIZE)
+#error "HYAL_DUPLICATES_TABLE_SIZE out of range"
+#endif
+
+/* End of hash chain / empty bucket */
+#define HYAL_DUPLICATES_NONE   0xFF
+
+/* Duplicates Table: ring of entries chained by hash of (src, len, crc) */
+struct THyALDuplicatesTable {
+	struct THyALDuplicatesEntry m_aEntries[HYAL_DUPLICATES_TABLE_MAX_SIZE];
+	uint8_t m_au8Buckets[HYAL_DUPLICATES_HASH_SIZE];
+	uint32_t m_u32TtlMs;
+	uint8_t m_u8Size;
+	uint8_t m_u8Count;
+	uint8_t m_u8Next;
+};
+
+static struct THyALDuplicatesTable hyALDuplicatesTable;
 
 static struct THyALNotifications sUpperLayerNotifications;
 
+/* Payload kept to retry a request on the backup medium */
+struct THyALPayload {
+  uint8_t m_au8Data[HYAL_BACKUP_BUF_SIZE];
+  uint8_t m_u8RefCount;
+};
+
 struct THyALDataReq {
+  struct TQueueElement m_FreeElement;
   struct TMacWrpDataRequest m_sDataReqParameters;
   enum EHyALMediaTypeRequest m_eDataReqMediaType;
-  uint8_t m_au8BackupBuffer[HYAL_BACKUP_BUF_SIZE];
+  struct THyALPayload *m_pPayload;
   enum EMacWrpStatus m_eFirstConfirmStatus;
   bool bWaitingSecondConfirm;
   bool bUsed;
 };
 
-#define HYAL_DATA_REQ_QUEUE_SIZE   2
+/* Number of data requests that can be in flight across PLC and RF */
+#ifndef HYAL_DATA_REQ_QUEUE_SIZE
+#define HYAL_DATA_REQ_QUEUE_SIZE   4
+#endif
+
+/* Number of payloads that can be kept for requests with backup medium */
+#ifndef HYAL_BACKUP_POOL_SIZE
+#define HYAL_BACKUP_POOL_SIZE   2
+#endif
+
+#if (HYAL_DATA_REQ_QUEUE_SIZE > 254)
+#error "HYAL_DATA_REQ_QUEUE_SIZE must be lower than 255"
+#endif
+
+/* Msdu handle not mapped to any data request */
+#define HYAL_HANDLE_NOT_MAPPED   0xFF
 
 struct THyALData {
   // Data Service Control
@@ -81,100 +118,211 @@ struct THyALData {
   bool bWaitingSecondResetConfirm;
   enum EMacWrpStatus m_eFirstStartConfirmStatus;
   bool bWaitingSecondStartConfirm;
+  // Data request pool
+  struct THyALPayload m_aPayloadPool[HYAL_BACKUP_POOL_SIZE];
+  struct TQueue m_FreeDataReq;
+  uint8_t m_au8HandleMap[256];
+  // Statistics
+  uint32_t m_u32QueueFullCount;
+  uint32_t m_u32BackupUnavailableCount;
 };
 
 static const struct THyALData g_HyALDefaults = {
-  {{{{MAC_WRP_ADDRESS_MODE_NO_ADDRESS}}}}, // m_DataReqQueue
+  {{{NULL}}}, // m_DataReqQueue
   MAC_WRP_STATUS_SUCCESS, // m_eFirstScanConfirmStatus
   false, // bWaitingSecondScanConfirm
   MAC_WRP_STATUS_SUCCESS, // m_eFirstResetConfirmStatus
   false, // bWaitingSecondResetConfirm
   MAC_WRP_STATUS_SUCCESS, // m_eFirstStartConfirmStatus
   false, // bWaitingSecondStartConfirm
+  {{{0}}}, // m_aPayloadPool
+  {NULL}, // m_FreeDataReq (filled on init)
+  {0}, // m_au8HandleMap (filled on init)
+  0, // m_u32QueueFullCount
+  0, // m_u32BackupUnavailableCount
 };
 
 static struct THyALData g_HyAL;
 
 static uint16_t _HyALCrc16(const uint8_t *pu8Data, uint32_t u32Length)
 {
-	uint16_t u16Crc = 0;
-
 	// polynom(16): X16 + X12 + X5 + 1 = 0x1021
-	while (u32Length--) {
-		u16Crc = crc16_tab[(u16Crc >> 8) ^ (*pu8Data ++)] ^ ((u16Crc & 0xFF) << 8);
+	return pcrc_crc16_ccitt_update(0, pu8Data, u32Length);
+}
+
+static uint8_t _duplicatesHash(uint16_t u16SrcAddr, uint16_t u16MsduLen, uint16_t u16Crc)
+{
+	uint32_t u32Hash;
+
+	u32Hash = (((uint32_t)u16SrcAddr << 16) | u16MsduLen) ^ u16Crc;
+	u32Hash *= 0x9E3779B1;
+	return (uint8_t)((u32Hash >> 24) & (HYAL_DUPLICATES_HASH_SIZE - 1));
+}
+
+static void _resetDuplicates(uint8_t u8Size)
+{
+	memset(hyALDuplicatesTable.m_au8Buckets, HYAL_DUPLICATES_NONE, sizeof(hyALDuplicatesTable.m_au8Buckets));
+	hyALDuplicatesTable.m_u8Size = u8Size;
+	hyALDuplicatesTable.m_u8Count = 0;
+	hyALDuplicatesTable.m_u8Next = 0;
+}
+
+static void _unlinkDuplicate(uint8_t u8Index)
+{
+	struct THyALDuplicatesEntry *pEntry = &hyALDuplicatesTable.m_aEntries[u8Index];
+	uint8_t *pu8Link;
+
+	pu8Link = &hyALDuplicatesTable.m_au8Buckets[_duplicatesHash(pEntry->m_u16SrcAddr, pEntry->m_u16MsduLen, pEntry->m_u16Crc)];
+	while (*pu8Link != HYAL_DUPLICATES_NONE) {
+		if (*pu8Link == u8Index) {
+			*pu8Link = pEntry->m_u8Next;
+			break;
+		}
+		pu8Link = &hyALDuplicatesTable.m_aEntries[*pu8Link].m_u8Next;
 	}
-	return u16Crc;
 }
 
 static bool _checkDuplicates(uint16_t u16SrcAddr, uint8_t *pMsdu, uint16_t u16MsduLen, uint8_t u8MediaType)
 {
-	bool bDuplicate = false;
-	uint8_t u8Index = 0;
+	struct THyALDuplicatesEntry *pEntry;
+	uint32_t u32Now;
 	uint16_t u16Crc;
+	uint8_t u8Bucket;
+	uint8_t u8Index;
 
 	// Calculate CRC for incoming frame
 	u16Crc = _HyALCrc16(pMsdu, u16MsduLen);
+	u32Now = oss_get_up_time_ms();
+	u8Bucket = _duplicatesHash(u16SrcAddr, u16MsduLen, u16Crc);
 
-	// Look for entry in the Duplicates Table
-	struct THyALDuplicatesEntry *pEntry = &hyALDuplicatesTable[0];
-	while (u8Index < HYAL_DUPLICATES_TABLE_SIZE) {
+	// Look for entry in the Duplicates Table, only along its hash chain
+	u8Index = hyALDuplicatesTable.m_au8Buckets[u8Bucket];
+	while (u8Index != HYAL_DUPLICATES_NONE) {
+		pEntry = &hyALDuplicatesTable.m_aEntries[u8Index];
 		// Look for same fields and different MediaType
-		if ((pEntry->m_u16SrcAddr == u16SrcAddr) && (pEntry->m_u16MsduLen == u16MsduLen) && 
-				(pEntry->m_u16Crc == u16Crc) && (pEntry->m_u8MediaType != u8MediaType)) {
-			bDuplicate = true;
-			break;
+		if ((pEntry->m_u16SrcAddr == u16SrcAddr) && (pEntry->m_u16MsduLen == u16MsduLen) &&
+				(pEntry->m_u16Crc == u16Crc) && (pEntry->m_u8MediaType != u8MediaType) &&
+				((hyALDuplicatesTable.m_u32TtlMs == 0) ||
+				((uint32_t)(u32Now - pEntry->m_u32Timestamp) < hyALDuplicatesTable.m_u32TtlMs))) {
+			return true;
 		}
-		u8Index ++;
-		pEntry ++;
+		u8Index = pEntry->m_u8Next;
 	}
 
-	if (!bDuplicate) {
-		// Entry not found, store it
-		memmove(&hyALDuplicatesTable[1], &hyALDuplicatesTable[0],
-			(HYAL_DUPLICATES_TABLE_SIZE - 1) * sizeof(struct THyALDuplicatesEntry));
-		// Populate the new entry.
-		hyALDuplicatesTable[0].m_u16SrcAddr = u16SrcAddr;
-		hyALDuplicatesTable[0].m_u16MsduLen = u16MsduLen;
-		hyALDuplicatesTable[0].m_u16Crc = u16Crc;
-		hyALDuplicatesTable[0].m_u8MediaType = u8MediaType;
+	// Entry not found, store it replacing the oldest one if the ring is full
+	u8Index = hyALDuplicatesTable.m_u8Next;
+	if (hyALDuplicatesTable.m_u8Count == hyALDuplicatesTable.m_u8Size) {
+		_unlinkDuplicate(u8Index);
+	}
+	else {
+		hyALDuplicatesTable.m_u8Count++;
 	}
 
-	// Return duplicate or not
-	return bDuplicate;
+	if (++hyALDuplicatesTable.m_u8Next == hyALDuplicatesTable.m_u8Size) {
+		hyALDuplicatesTable.m_u8Next = 0;
+	}
+
+	// Populate the new entry.
+	pEntry = &hyALDuplicatesTable.m_aEntries[u8Index];
+	pEntry->m_u32Timestamp = u32Now;
+	pEntry->m_u16SrcAddr = u16SrcAddr;
+	pEntry->m_u16MsduLen = u16MsduLen;
+	pEntry->m_u16Crc = u16Crc;
+	pEntry->m_u8MediaType = u8MediaType;
+	pEntry->m_u8Next = hyALDuplicatesTable.m_au8Buckets[u8Bucket];
+	hyALDuplicatesTable.m_au8Buckets[u8Bucket] = u8Index;
+
+	return false;
 }
 
-static struct THyALDataReq *_getFreeDataReqEntry(void)
+static void _initDataReqPool(void)
 {
 	uint8_t u8Idx;
-	struct THyALDataReq *pFound = NULL;
 
+	Queue_Init(&g_HyAL.m_FreeDataReq);
 	for (u8Idx = 0; u8Idx < HYAL_DATA_REQ_QUEUE_SIZE; u8Idx++) {
-		if (!g_HyAL.m_DataReqQueue[u8Idx].bUsed) {
-			pFound = &g_HyAL.m_DataReqQueue[u8Idx];
-			g_HyAL.m_DataReqQueue[u8Idx].bUsed = true;
-			LOG_INFO(Log("_getFreeDataReqEntry() Found free HyALDataReqQueueEntry on index %u", u8Idx));
-			break;
-		}
+		Queue_InitElement(&g_HyAL.m_DataReqQueue[u8Idx].m_FreeElement, &g_HyAL.m_DataReqQueue[u8Idx]);
+		Queue_PushTail(&g_HyAL.m_FreeDataReq, &g_HyAL.m_DataReqQueue[u8Idx].m_FreeElement);
+	}
+	memset(g_HyAL.m_au8HandleMap, HYAL_HANDLE_NOT_MAPPED, sizeof(g_HyAL.m_au8HandleMap));
+}
+
+static struct THyALDataReq *_getFreeDataReqEntry(uint8_t u8Handle)
+{
+	uint8_t u8Idx;
+	struct TQueueElement *pElement;
+	struct THyALDataReq *pFound;
+
+	pElement = Queue_PopHead(&g_HyAL.m_FreeDataReq);
+	if (pElement == NULL) {
+		g_HyAL.m_u32QueueFullCount++;
+		return NULL;
 	}
 
+	pFound = (struct THyALDataReq *)pElement->m_pUserData;
+	u8Idx = pFound - &g_HyAL.m_DataReqQueue[0];
+	pFound->bUsed = true;
+	pFound->m_pPayload = NULL;
+	g_HyAL.m_au8HandleMap[u8Handle] = u8Idx;
+	LOG_INFO(Log("_getFreeDataReqEntry() Found free HyALDataReqQueueEntry on index %u", u8Idx));
+
 	return pFound;
 }
 
 static struct THyALDataReq *_getDataReqEntryByHandler(uint8_t u8Handle)
 {
 	uint8_t u8Idx;
-	struct THyALDataReq *pFound = NULL;
 
-	for (u8Idx = 0; u8Idx < HYAL_DATA_REQ_QUEUE_SIZE; u8Idx++) {
-		if (g_HyAL.m_DataReqQueue[u8Idx].bUsed && 
-				(g_HyAL.m_DataReqQueue[u8Idx].m_sDataReqParameters.m_u8MsduHandle == u8Handle)) {
-			pFound = &g_HyAL.m_DataReqQueue[u8Idx];
-			LOG_INFO(Log("_getDataReqEntryByHandler() Found matching HyALDataReqQueueEntry on index %u, Handle: 0x%02X", u8Idx, u8Handle));
-			break;
+	u8Idx = g_HyAL.m_au8HandleMap[u8Handle];
+	if ((u8Idx == HYAL_HANDLE_NOT_MAPPED) || !g_HyAL.m_DataReqQueue[u8Idx].bUsed) {
+		return NULL;
+	}
+
+	LOG_INFO(Log("_getDataReqEntryByHandler() Found matching HyALDataReqQueueEntry on index %u, Handle: 0x%02X", u8Idx, u8Handle));
+	return &g_HyAL.m_DataReqQueue[u8Idx];
+}
+
+static struct THyALPayload *_acquirePayload(const uint8_t *pMsdu, uint16_t u16MsduLength)
+{
+	uint8_t u8Idx;
+
+	if (u16MsduLength > HYAL_BACKUP_BUF_SIZE) {
+		return NULL;
+	}
+
+	for (u8Idx = 0; u8Idx < HYAL_BACKUP_POOL_SIZE; u8Idx++) {
+		if (g_HyAL.m_aPayloadPool[u8Idx].m_u8RefCount == 0) {
+			g_HyAL.m_aPayloadPool[u8Idx].m_u8RefCount = 1;
+			memcpy(g_HyAL.m_aPayloadPool[u8Idx].m_au8Data, pMsdu, u16MsduLength);
+			return &g_HyAL.m_aPayloadPool[u8Idx];
 		}
 	}
 
-	return pFound;
+	return NULL;
+}
+
+static void _releasePayload(struct THyALPayload *pPayload)
+{
+	if ((pPayload != NULL) && (pPayload->m_u8RefCount > 0)) {
+		pPayload->m_u8RefCount--;
+	}
+}
+
+static void _releaseDataReqEntry(struct THyALDataReq *pDataReq)
+{
+	uint8_t u8Idx = pDataReq - &g_HyAL.m_DataReqQueue[0];
+
+	if (!pDataReq->bUsed) {
+		return;
+	}
+
+	_releasePayload(pDataReq->m_pPayload);
+	pDataReq->m_pPayload = NULL;
+	pDataReq->bUsed = false;
+	if (g_HyAL.m_au8HandleMap[pDataReq->m_sDataReqParameters.m_u8MsduHandle] == u8Idx) {
+		g_HyAL.m_au8HandleMap[pDataReq->m_sDataReqParameters.m_u8MsduHandle] = HYAL_HANDLE_NOT_MAPPED;
+	}
+	Queue_PushTail(&g_HyAL.m_FreeDataReq, &pDataReq->m_FreeElement);
 }
 
 /* ------------------------------------------------ */
@@ -208,7 +356,7 @@ static void _Callback_HyALMacWrpDataConfirm(struct TMacWrpDataConfirm *pParamete
 				/* Send confirm to upper layer */
 				confParameters.m_eMediaType = HYAL_MEDIA_TYPE_CONF_PLC;
 				/* Release Data Req entry and send confirm */
-				pMatchingDataReq->bUsed = false;
+				_releaseDataReqEntry(pMatchingDataReq);
 				if (sUpperLayerNotifications.m_HyALDataConfirm != NULL) {
 					sUpperLayerNotifications.m_HyALDataConfirm(&confParameters);
 				}
@@ -227,8 +375,8 @@ static void _Callback_HyALMacWrpDataConfirm(struct TMacWrpDataConfirm *pParamete
 				if (status == MAC_WRP_STATUS_SUCCESS) {
 					/* Try on backup medium */
 					LOG_INFO(Log("Try RF as Backup Meduim"));
-					/* Set Msdu pointer to backup buffer, as current pointer is no longer valid */
-					pMatchingDataReq->m_sDataReqParameters.m_pMsdu = pMatchingDataReq->m_au8BackupBuffer;
+					/* Set Msdu pointer to kept payload, as current pointer is no longer valid */
+					pMatchingDataReq->m_sDataReqParameters.m_pMsdu = pMatchingDataReq->m_pPayload->m_au8Data;
 					MacWrapperMcpsDataRequestRF(&pMatchingDataReq->m_sDataReqParameters);
 				}
 				else {
@@ -236,7 +384,7 @@ static void _Callback_HyALMacWrpDataConfirm(struct TMacWrpDataConfirm *pParamete
 					/* Send confirm to upper layer */
 					confParameters.m_eMediaType = HYAL_MEDIA_TYPE_CONF_PLC;
 					/* Release Data Req entry and send confirm */
-					pMatchingDataReq->bUsed = false;
+					_releaseDataReqEntry(pMatchingDataReq);
 					if (sUpperLayerNotifications.m_HyALDataConfirm != NULL) {
 						sUpperLayerNotifications.m_HyALDataConfirm(&confParameters);
 					}
@@ -247,7 +395,7 @@ static void _Callback_HyALMacWrpDataConfirm(struct TMacWrpDataConfirm *pParamete
 			/* PLC was used as backup medium. Send confirm to upper layer */
 			confParameters.m_eMediaType = HYAL_MEDIA_TYPE_CONF_PLC_AS_BACKUP;
 			/* Release Data Req entry and send confirm */
-			pMatchingDataReq->bUsed = false;
+			_releaseDataReqEntry(pMatchingDataReq);
 			if (sUpperLayerNotifications.m_HyALDataConfirm != NULL) {
 				sUpperLayerNotifications.m_HyALDataConfirm(&confParameters);
 			}
@@ -261,7 +409,7 @@ static void _Callback_HyALMacWrpDataConfirm(struct TMacWrpDataConfirm *pParamete
 					/* At least one SUCCESS, send confirm with SUCCESS */
 					confParameters.m_eStatus = MAC_WRP_STATUS_SUCCESS;
 					/* Release Data Req entry and send confirm */
-					pMatchingDataReq->bUsed = false;
+					_releaseDataReqEntry(pMatchingDataReq);
 					if (sUpperLayerNotifications.m_HyALDataConfirm != NULL) {
 						sUpperLayerNotifications.m_HyALDataConfirm(&confParameters);
 					}
@@ -270,7 +418,7 @@ static void _Callback_HyALMacWrpDataConfirm(struct TMacWrpDataConfirm *pParamete
 					/* None SUCCESS. Return result from second confirm */
 					confParameters.m_eStatus = pParameters->m_eStatus;
 					/* Release Data Req entry and send confirm */
-					pMatchingDataReq->bUsed = false;
+					_releaseDataReqEntry(pMatchingDataReq);
 					if (sUpperLayerNotifications.m_HyALDataConfirm != NULL) {
 						sUpperLayerNotifications.m_HyALDataConfirm(&confParameters);
 					}
@@ -286,7 +434,7 @@ static void _Callback_HyALMacWrpDataConfirm(struct TMacWrpDataConfirm *pParamete
 			/* Send confirm to upper layer */
 			confParameters.m_eMediaType = HYAL_MEDIA_TYPE_CONF_PLC;
 			/* Release Data Req entry and send confirm */
-			pMatchingDataReq->bUsed = false;
+			_releaseDataReqEntry(pMatchingDataReq);
 			if (sUpperLayerNotifications.m_HyALDataConfirm != NULL) {
 				sUpperLayerNotifications.m_HyALDataConfirm(&confParameters);
 			}
@@ -297,7 +445,7 @@ static void _Callback_HyALMacWrpDataConfirm(struct TMacWrpDataConfirm *pParamete
 		default: /* PLC only */
 			confParameters.m_eMediaType = HYAL_MEDIA_TYPE_CONF_PLC;
 			/* Release Data Req entry and send confirm */
-			pMatchingDataReq->bUsed = false;
+			_releaseDataReqEntry(pMatchingDataReq);
 			if (sUpperLayerNotifications.m_HyALDataConfirm != NULL) {
 				sUpperLayerNotifications.m_HyALDataConfirm(&confParameters);
 			}
@@ -331,7 +479,7 @@ static void _Callback_HyALMacWrpDataConfirmRF(struct TMacWrpDataConfirm *pParame
 			/* RF was used as backup medium. Send confirm to upper layer */
 			confParameters.m_eMediaType = HYAL_MEDIA_TYPE_CONF_RF_AS_BACKUP;
 			/* Release Data Req entry and send confirm */
-			pMatchingDataReq->bUsed = false;
+			_releaseDataReqEntry(pMatchingDataReq);
 			if (sUpperLayerNotifications.m_HyALDataConfirm != NULL) {
 				sUpperLayerNotifications.m_HyALDataConfirm(&confParameters);
 			}
@@ -341,7 +489,7 @@ static void _Callback_HyALMacWrpDataConfirmRF(struct TMacWrpDataConfirm *pParame
 				/* Send confirm to upper layer */
 				confParameters.m_eMediaType = HYAL_MEDIA_TYPE_CONF_RF;
 				/* Release Data Req entry and send confirm */
-				pMatchingDataReq->bUsed = false;
+				_releaseDataReqEntry(pMatchingDataReq);
 				if (sUpperLayerNotifications.m_HyALDataConfirm != NULL) {
 					sUpperLayerNotifications.m_HyALDataConfirm(&confParameters);
 				}
@@ -360,8 +508,8 @@ static void _Callback_HyALMacWrpDataConfirmRF(struct TMacWrpDataConfirm *pParame
 				if (status == MAC_WRP_STATUS_SUCCESS) {
 					/* Try on backup medium */
 					LOG_INFO(Log("Try PLC as Backup Meduim"));
-					/* Set Msdu pointer to backup buffer, as current pointer is no longer valid */
-					pMatchingDataReq->m_sDataReqParameters.m_pMsdu = pMatchingDataReq->m_au8BackupBuffer;
+					/* Set Msdu pointer to kept payload, as current pointer is no longer valid */
+					pMatchingDataReq->m_sDataReqParameters.m_pMsdu = pMatchingDataReq->m_pPayload->m_au8Data;
 					MacWrapperMcpsDataRequest(&pMatchingDataReq->m_sDataReqParameters);
 				}
 				else {
@@ -369,7 +517,7 @@ static void _Callback_HyALMacWrpDataConfirmRF(struct TMacWrpDataConfirm *pParame
 					/* Send confirm to upper layer */
 					confParameters.m_eMediaType = HYAL_MEDIA_TYPE_CONF_RF;
 					/* Release Data Req entry and send confirm */
-					pMatchingDataReq->bUsed = false;
+					_releaseDataReqEntry(pMatchingDataReq);
 					if (sUpperLayerNotifications.m_HyALDataConfirm != NULL) {
 						sUpperLayerNotifications.m_HyALDataConfirm(&confParameters);
 					}
@@ -385,7 +533,7 @@ static void _Callback_HyALMacWrpDataConfirmRF(struct TMacWrpDataConfirm *pParame
 					/* At least one SUCCESS, send confirm with SUCCESS */
 					confParameters.m_eStatus = MAC_WRP_STATUS_SUCCESS;
 					/* Release Data Req entry and send confirm */
-					pMatchingDataReq->bUsed = false;
+					_releaseDataReqEntry(pMatchingDataReq);
 					if (sUpperLayerNotifications.m_HyALDataConfirm != NULL) {
 						sUpperLayerNotifications.m_HyALDataConfirm(&confParameters);
 					}
@@ -394,7 +542,7 @@ static void _Callback_HyALMacWrpDataConfirmRF(struct TMacWrpDataConfirm *pParame
 					/* None SUCCESS. Return result from second confirm */
 					confParameters.m_eStatus = pParameters->m_eStatus;
 					/* Release Data Req entry and send confirm */
-					pMatchingDataReq->bUsed = false;
+					_releaseDataReqEntry(pMatchingDataReq);
 					if (sUpperLayerNotifications.m_HyALDataConfirm != NULL) {
 						sUpperLayerNotifications.m_HyALDataConfirm(&confParameters);
 					}
@@ -413,7 +561,7 @@ static void _Callback_HyALMacWrpDataConfirmRF(struct TMacWrpDataConfirm *pParame
 			/* Send confirm to upper layer */
 			confParameters.m_eMediaType = HYAL_MEDIA_TYPE_CONF_RF;
 			/* Release Data Req entry and send confirm */
-			pMatchingDataReq->bUsed = false;
+			_releaseDataReqEntry(pMatchingDataReq);
 			if (sUpperLayerNotifications.m_HyALDataConfirm != NULL) {
 				sUpperLayerNotifications.m_HyALDataConfirm(&confParameters);
 			}
@@ -421,7 +569,7 @@ static void _Callback_HyALMacWrpDataConfirmRF(struct TMacWrpDataConfirm *pParame
 		default: /* RF only */
 			confParameters.m_eMediaType = HYAL_MEDIA_TYPE_CONF_RF;
 			/* Release Data Req entry and send confirm */
-			pMatchingDataReq->bUsed = false;
+			_releaseDataReqEntry(pMatchingDataReq);
 			if (sUpperLayerNotifications.m_HyALDataConfirm != NULL) {
 				sUpperLayerNotifications.m_HyALDataConfirm(&confParameters);
 			}
@@ -835,6 +983,9 @@ void HyALInitialize(struct THyALNotifications *pNotifications, uint8_t u8Band)
 	
 	/* Set default module variables */
 	g_HyAL = g_HyALDefaults;
+	_initDataReqPool();
+	hyALDuplicatesTable.m_u32TtlMs = HYAL_DUPLICATES_TTL_MS;
+	_resetDuplicates(HYAL_DUPLICATES_TABLE_SIZE);
 
 	/* Define callbacks coming from Mac Wrapper (PLC) */
 	hyALNotifications.m_MacWrpDataConfirm = _Callback_HyALMacWrpDataConfirm;
@@ -1146,7 +1297,7 @@ void HyALDataRequest(struct THyALDataRequest *pParameters)
 	LOG_INFO(LogBuffer(pParameters->m_pMsdu, pParameters->m_u16MsduLength, "HyALDataRequest (Handle: 0x%02X Media Type: %02X): ", pParameters->m_u8MsduHandle, pParameters->m_eMediaType));
 
 	/* Look for free Data Request Entry */
-	pDataReq = _getFreeDataReqEntry();
+	pDataReq = _getFreeDataReqEntry(pParameters->m_u8MsduHandle);
 	
 	if (pDataReq == NULL) {
 		/* Too many data requests */
@@ -1167,9 +1318,21 @@ void HyALDataRequest(struct THyALDataRequest *pParameters)
 		memcpy(&pDataReq->m_sDataReqParameters, pParameters, sizeof(struct TMacWrpDataRequest));
 		/* Store Media Type on module variable */
 		pDataReq->m_eDataReqMediaType = pParameters->m_eMediaType;
-		/* Copy data to backup buffer, just in case backup media has to be used, current pointer will not be valid later */
-		if (pParameters->m_u16MsduLength <= HYAL_BACKUP_BUF_SIZE) {
-			memcpy(pDataReq->m_au8BackupBuffer, pParameters->m_pMsdu, pParameters->m_u16MsduLength);
+		/* Keep a copy of the data only if backup media may be used, current pointer will not be valid later */
+		if ((pDataReq->m_eDataReqMediaType == HYAL_MEDIA_TYPE_REQ_PLC_BACKUP_RF) ||
+				(pDataReq->m_eDataReqMediaType == HYAL_MEDIA_TYPE_REQ_RF_BACKUP_PLC)) {
+			pDataReq->m_pPayload = _acquirePayload(pParameters->m_pMsdu, pParameters->m_u16MsduLength);
+			if (pDataReq->m_pPayload == NULL) {
+				/* No room to keep the data: send without backup medium */
+				g_HyAL.m_u32BackupUnavailableCount++;
+				LOG_INFO(Log("HyALDataRequest() No backup payload available, backup medium disabled"));
+				if (pDataReq->m_eDataReqMediaType == HYAL_MEDIA_TYPE_REQ_PLC_BACKUP_RF) {
+					pDataReq->m_eDataReqMediaType = HYAL_MEDIA_TYPE_REQ_PLC_NO_BACKUP;
+				}
+				else {
+					pDataReq->m_eDataReqMediaType = HYAL_MEDIA_TYPE_REQ_RF_NO_BACKUP;
+				}
+			}
 		}
 
 		/* Different handling for Broadcast and Unicast requests */
@@ -1269,12 +1432,105 @@ static bool _IsAttributeInPLCRange(enum EMacWrpPibAttribute eAttribute)
 	}
 }
 
+static bool _IsAttributeInHyALRange(enum EMacWrpPibAttribute eAttribute)
+{
+	/* HyAL attributes are handled locally, not by any MAC */
+	return ((uint32_t)eAttribute >= HYAL_PIB_FIRST) && ((uint32_t)eAttribute <= HYAL_PIB_LAST);
+}
+
+static enum EMacWrpStatus _HyALGetAttribute(enum EMacWrpPibAttribute eAttribute, uint16_t u16Index, struct TMacWrpPibValue *pValue)
+{
+	uint16_t u16Value;
+
+	if (u16Index != 0) {
+		return MAC_WRP_STATUS_INVALID_INDEX;
+	}
+
+	switch ((uint32_t)eAttribute) {
+	case HYAL_PIB_DUPLICATES_TABLE_SIZE:
+		u16Value = hyALDuplicatesTable.m_u8Size;
+		pValue->m_u8Length = sizeof(u16Value);
+		memcpy(pValue->m_au8Value, &u16Value, sizeof(u16Value));
+		return MAC_WRP_STATUS_SUCCESS;
+
+	case HYAL_PIB_DUPLICATES_TTL:
+		pValue->m_u8Length = sizeof(hyALDuplicatesTable.m_u32TtlMs);
+		memcpy(pValue->m_au8Value, &hyALDuplicatesTable.m_u32TtlMs, sizeof(hyALDuplicatesTable.m_u32TtlMs));
+		return MAC_WRP_STATUS_SUCCESS;
+
+	case HYAL_PIB_DATA_QUEUE_FULL_COUNT:
+		pValue->m_u8Length = sizeof(g_HyAL.m_u32QueueFullCount);
+		memcpy(pValue->m_au8Value, &g_HyAL.m_u32QueueFullCount, sizeof(g_HyAL.m_u32QueueFullCount));
+		return MAC_WRP_STATUS_SUCCESS;
+
+	case HYAL_PIB_BACKUP_UNAVAILABLE_COUNT:
+		pValue->m_u8Length = sizeof(g_HyAL.m_u32BackupUnavailableCount);
+		memcpy(pValue->m_au8Value, &g_HyAL.m_u32BackupUnavailableCount, sizeof(g_HyAL.m_u32BackupUnavailableCount));
+		return MAC_WRP_STATUS_SUCCESS;
+
+	default:
+		pValue->m_u8Length = 0;
+		return MAC_WRP_STATUS_UNSUPPORTED_ATTRIBUTE;
+	}
+}
+
+static enum EMacWrpStatus _HyALSetAttribute(enum EMacWrpPibAttribute eAttribute, uint16_t u16Index, const struct TMacWrpPibValue *pValue)
+{
+	uint16_t u16Value;
+
+	if (u16Index != 0) {
+		return MAC_WRP_STATUS_INVALID_INDEX;
+	}
+
+	switch ((uint32_t)eAttribute) {
+	case HYAL_PIB_DUPLICATES_TABLE_SIZE:
+		if (pValue->m_u8Length != sizeof(u16Value)) {
+			return MAC_WRP_STATUS_INVALID_PARAMETER;
+		}
+		memcpy(&u16Value, pValue->m_au8Value, sizeof(u16Value));
+		if ((u16Value == 0) || (u16Value > HYAL_DUPLICATES_TABLE_MAX_SIZE)) {
+			return MAC_WRP_STATUS_INVALID_PARAMETER;
+		}
+		/* Table is emptied on resize */
+		_resetDuplicates((uint8_t)u16Value);
+		return MAC_WRP_STATUS_SUCCESS;
+
+	case HYAL_PIB_DUPLICATES_TTL:
+		if (pValue->m_u8Length != sizeof(hyALDuplicatesTable.m_u32TtlMs)) {
+			return MAC_WRP_STATUS_INVALID_PARAMETER;
+		}
+		memcpy(&hyALDuplicatesTable.m_u32TtlMs, pValue->m_au8Value, sizeof(hyALDuplicatesTable.m_u32TtlMs));
+		return MAC_WRP_STATUS_SUCCESS;
+
+	case HYAL_PIB_DATA_QUEUE_FULL_COUNT:
+	case HYAL_PIB_BACKUP_UNAVAILABLE_COUNT:
+		/* Counters can only be reset */
+		g_HyAL.m_u32QueueFullCount = 0;
+		g_HyAL.m_u32BackupUnavailableCount = 0;
+		return MAC_WRP_STATUS_SUCCESS;
+
+	default:
+		return MAC_WRP_STATUS_UNSUPPORTED_ATTRIBUTE;
+	}
+}
+
 void HyALGetRequest(struct THyALGetRequest *pParameters)
 {
 	LOG_DBG(Log("HyALGetRequest: Attribute: %08X; Index: %u", pParameters->m_ePibAttribute, pParameters->m_u16PibAttributeIndex));
 
-	/* Check attribute ID range to redirect to PLC or RF MAC */
-	if (_IsAttributeInPLCRange(pParameters->m_ePibAttribute)) {
+	/* Check attribute ID range to redirect to HyAL, PLC or RF MAC */
+	if (_IsAttributeInHyALRange(pParameters->m_ePibAttribute)) {
+		struct THyALGetConfirm getConfirm;
+
+		getConfirm.m_ePibAttribute = pParameters->m_ePibAttribute;
+		getConfirm.m_u16PibAttributeIndex = pParameters->m_u16PibAttributeIndex;
+		getConfirm.m_eStatus = _HyALGetAttribute(pParameters->m_ePibAttribute,
+				pParameters->m_u16PibAttributeIndex, &getConfirm.m_PibAttributeValue);
+		if (sUpperLayerNotifications.m_HyALGetConfirm != NULL) {
+			sUpperLayerNotifications.m_HyALGetConfirm(&getConfirm);
+		}
+	}
+	else if (_IsAttributeInPLCRange(pParameters->m_ePibAttribute)) {
 		/* Get from PLC MAC */
 		MacWrapperMlmeGetRequest((struct TMacWrpGetRequest *)pParameters);
 	}
@@ -1288,8 +1544,11 @@ enum EMacWrpStatus HyALGetRequestSync(enum EMacWrpPibAttribute eAttribute, uint1
 {
 	LOG_DBG(Log("HyALGetRequestSync: Attribute: %08X; Index: %u", eAttribute, u16Index));
 
-	/* Check attribute ID range to redirect to PLC or RF MAC */
-	if (_IsAttributeInPLCRange(eAttribute)) {
+	/* Check attribute ID range to redirect to HyAL, PLC or RF MAC */
+	if (_IsAttributeInHyALRange(eAttribute)) {
+		return _HyALGetAttribute(eAttribute, u16Index, pValue);
+	}
+	else if (_IsAttributeInPLCRange(eAttribute)) {
 		/* Get from PLC MAC */
 		return MacWrapperMlmeGetRequestSync(eAttribute, u16Index, pValue);
 	}
@@ -1303,8 +1562,19 @@ void HyALSetRequest(struct THyALSetRequest *pParameters)
 {
 	LOG_DBG(Log("HyALSetRequest: Attribute: %08X; Index: %u", pParameters->m_ePibAttribute, pParameters->m_u16PibAttributeIndex));
 
-	/* Check attribute ID range to redirect to PLC or RF MAC */
-	if (_IsAttributeInPLCRange(pParameters->m_ePibAttribute)) {
+	/* Check attribute ID range to redirect to HyAL, PLC or RF MAC */
+	if (_IsAttributeInHyALRange(pParameters->m_ePibAttribute)) {
+		struct THyALSetConfirm setConfirm;
+
+		setConfirm.m_ePibAttribute = pParameters->m_ePibAttribute;
+		setConfirm.m_u16PibAttributeIndex = pParameters->m_u16PibAttributeIndex;
+		setConfirm.m_eStatus = _HyALSetAttribute(pParameters->m_ePibAttribute,
+				pParameters->m_u16PibAttributeIndex, &pParameters->m_PibAttributeValue);
+		if (sUpperLayerNotifications.m_HyALSetConfirm != NULL) {
+			sUpperLayerNotifications.m_HyALSetConfirm(&setConfirm);
+		}
+	}
+	else if (_IsAttributeInPLCRange(pParameters->m_ePibAttribute)) {
 		/* Set to PLC MAC */
 		MacWrapperMlmeSetRequest((struct TMacWrpSetRequest *)pParameters);
 	}
@@ -1318,8 +1588,11 @@ enum EMacWrpStatus HyALSetRequestSync(enum EMacWrpPibAttribute eAttribute, uint1
 {
 	LOG_DBG(Log("HyALSetRequestSync: Attribute: %08X; Index: %u", eAttribute, u16Index));
 
-	/* Check attribute ID range to redirect to PLC or RF MAC */
-	if (_IsAttributeInPLCRange(eAttribute)) {
+	/* Check attribute ID range to redirect to HyAL, PLC or RF MAC */
+	if (_IsAttributeInHyALRange(eAttribute)) {
+		return _HyALSetAttribute(eAttribute, u16Index, pValue);
+	}
+	else if (_IsAttributeInPLCRange(eAttribute)) {
 		/* Set to PLC MAC */
 		return MacWrapperMlmeSetRequestSync(eAttribute, u16Index, pValue);
 	}
@@ -45,6 +45,18 @@ struct TMacRtDataIndication {
   uint8_t *m_pPsdu;
 };
 
+struct TMacRtTxQueueStats {
+  uint32_t m_u32ConfirmCount;
+  uint32_t m_u32OverflowCount;
+  // Time from MacRtTxRequest() to its confirm, in microseconds.
+  uint32_t m_u32LastServiceTime;
+  uint32_t m_u32MaxServiceTime;
+  // Requests waiting behind the one in progress.
+  uint8_t m_u8HighPriorityDepth;
+  uint8_t m_u8NormalPriorityDepth;
+  uint8_t m_u8MaxDepth;
+};
+
 struct TMacRtNotifications;
 
 void MacRtInitialize(uint8_t u8Band, struct TMacRtNotifications *pNotifications, uint8_t u8SpecCompliance);
@@ -54,10 +66,19 @@ typedef void (*MacRtProcessFrame)(struct TMacRtFrame *pFrame, struct TMacRtDataI
 typedef void (*MacRtTxConfirm)(enum EMacRtStatus eStatus, bool bUpdateTimestamp, enum ERtModulationType eModType);
 typedef void (*MacRtPlmeGetConfirm)(struct TMacRtPlmeGetConfirm *pParameters);
 
+// The MSDU is copied before returning. One confirm is delivered per request, in request order.
 void MacRtTxRequest(struct TMacRtTxRequest *pTxRequest, struct TMacRtMhr *pMhr);
 void MacRtResetRequest(bool bResetMib);
 void MacRtGetToneMapResponseData(struct TRtToneMapResponseData *pParameters);
 uint32_t MacRtGetPhyTime(void);
+void MacRtGetTxQueueStats(struct TMacRtTxQueueStats *pStats);
+void MacRtClearTxQueueStats(void);
+
+#ifdef MAC_RT_CONTEXT_SWITCH
+uint32_t MacRtGetContextSize(void);
+void MacRtSaveContext(void *pContext);
+void MacRtRestoreContext(const void *pContext);
+#endif
 
 struct TMacRtNotifications {
   MacRtProcessFrame m_pProcessFrame;
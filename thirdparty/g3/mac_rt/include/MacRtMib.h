@@ -62,6 +62,8 @@ enum EMacRtPibAttribute {
   MAC_RT_PIB_DEBUG_SET = 0x08000025,
   // Read PL360 Debug Information
   MAC_RT_PIB_DEBUG_READ = 0x08000026,
+  // Gets TX queue statistics (struct TMacRtTxQueueStats). Setting it clears them.
+  MAC_RT_PIB_MANUF_TX_QUEUE_STATS = 0x08000027,
   // IB used to set the complete MIB structure at once
   MAC_RT_PIB_GET_SET_ALL_MIB = 0x08000100,
   // Gets or sets a parameter in Phy layer. Index will be used to contain PHY parameter ID.
@@ -0,0 +1,1143 @@
+/**
+ * \file
+ *
+ * \brief Discrete-event simulator of a G3 PLC cell running MAC RT.
+ *
+ * Every node runs the MAC RT code itself (CSMA-CA backoff, ACK timing,
+ * segmentation, transmission queue) over a simulated PHY. Instances are
+ * switched with MacRtSaveContext() / MacRtRestoreContext(), and a node is only
+ * run when its state timers expire or the PHY or the traffic source calls it,
+ * so large cells run much faster than real time.
+ *
+ * PHY model:
+ * - Attenuation and noise matrix (sim_channel.h), loaded or generated.
+ * - A frame is received when its SNR at the start is above the detection
+ *   threshold and the receiver is idle, and decoded when its SINR against the
+ *   strongest interference during the frame is above the decoding threshold.
+ *   Interference is the sum of all overlapping transmissions, so collisions
+ *   and capture follow from the powers.
+ * - Half-duplex. A scheduled transmission fails with BUSY_RX if a reception is
+ *   in progress and with BUSY if carrier sense detects energy.
+ * - Frame duration from the PSDU length, modulation and tone map.
+ *
+ * For each MinBe / MaxBe / high priority window / fairness limit combination
+ * the cell is run with the same topology and seed, and goodput, latency,
+ * fairness and failure counts are reported.
+ *
+ * Host tool only, not part of the firmware build. See Makefile for usage.
+ *
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../source/MacRt.c"
+#include "sim_channel.h"
+
+#define SIM_PAN_ID            0x781D
+#define SIM_BAND              PHY_BAND_CENELEC_A
+#define SIM_APP_QUEUE_SIZE    32
+#define SIM_MAX_LIST          16
+#define SIM_NEVER             UINT64_MAX
+/* PHY time starts close to the 32-bit wrap, so that every run crosses it */
+#define SIM_TIME_START        (0x100000000ULL - 5000000ULL)
+
+enum sim_event_type {
+	/* Order of events at the same time */
+	SIM_EV_TX_END,
+	SIM_EV_TX_START,
+	SIM_EV_ACK_START,
+	SIM_EV_WAKE,
+	SIM_EV_ARRIVAL,
+};
+
+struct sim_event {
+	uint64_t ull_time;
+	uint32_t ul_seq;
+	uint32_t ul_gen;
+	uint16_t us_node;
+	uint8_t uc_type;
+};
+
+struct sim_frame {
+	uint16_t us_len;
+	uint8_t auc_psdu[MAC_PHY_MAX_PAYLOAD_LENGTH];
+	uint8_t uc_dt;
+	uint32_t ul_duration;
+	int32_t i_dst;
+	bool b_ack;
+	struct TPhyAckFch x_ack_fch;
+};
+
+struct sim_node {
+	uint8_t *puc_ctx;
+	/* Pending PhyPdDataRequest() / PhyPdAckRequest() */
+	struct sim_frame x_req;
+	bool b_req_pending;
+	uint32_t ul_req_gen;
+	struct TPhyAckFch x_ack_fch;
+	bool b_ack_pending;
+	uint32_t ul_ack_gen;
+	/* On air */
+	struct sim_frame x_air;
+	bool b_transmitting;
+	/* Reception: transmitter locked on (-1 for none), its power and the worst interference */
+	int32_t i_locked;
+	double d_sig;
+	double d_max_int;
+	/* Power received from all transmissions */
+	double d_rx_power;
+	/* MAC wake up */
+	uint64_t ull_wake;
+	uint32_t ul_wake_gen;
+	/* Traffic */
+	uint16_t us_dst;
+	uint8_t uc_seq;
+	uint64_t aull_app[SIM_APP_QUEUE_SIZE];
+	bool ab_app_high[SIM_APP_QUEUE_SIZE];
+	uint8_t uc_app_head;
+	uint8_t uc_app_count;
+	uint64_t aull_out[MAC_RT_TX_QUEUE_SIZE + 1];
+	bool ab_out_high[MAC_RT_TX_QUEUE_SIZE + 1];
+	uint8_t uc_out_head;
+	uint8_t uc_out_count;
+	uint32_t ul_offered;
+	uint32_t ul_success;
+};
+
+struct sim_config {
+	uint32_t ul_seconds;
+	double d_load;
+	double d_high_fraction;
+	uint16_t us_payload;
+	enum ERtModulationType e_modulation;
+	double d_detect_snr;
+	double d_decode_snr;
+	double d_cs_snr;
+	uint32_t ul_seed;
+};
+
+struct sim_mac_params {
+	uint8_t uc_min_be;
+	uint8_t uc_max_be;
+	uint8_t uc_hp_window;
+	uint8_t uc_fairness;
+};
+
+struct sim_stats {
+	uint32_t ul_offered;
+	uint32_t ul_dropped;
+	uint32_t ul_success;
+	uint32_t ul_caf;
+	uint32_t ul_no_ack;
+	uint32_t ul_other;
+	uint32_t ul_data_tx;
+	uint32_t ul_ack_tx;
+	uint32_t ul_collisions;
+	uint32_t ul_busy;
+	uint64_t ull_bytes;
+	uint64_t ull_events;
+	uint32_t *pul_latency;
+	uint32_t ul_latency_count;
+	uint32_t ul_latency_size;
+	uint64_t ull_high_latency;
+	uint32_t ul_high_count;
+};
+
+static struct sim_config sx_cfg;
+static struct sim_channel sx_channel;
+static struct sim_node *spx_nodes;
+static uint16_t sus_nodes;
+static int32_t si_cur = -1;
+static uint64_t sull_now;
+static uint64_t sull_end;
+/* Separate generators: every run sees the same traffic whatever the MAC draws */
+static uint64_t sull_mac_rng;
+static uint64_t sull_traffic_rng;
+static struct sim_stats sx_stats;
+static double sd_detect;
+static double sd_decode;
+static double sd_cs;
+
+static struct sim_event *spx_heap;
+static uint32_t sul_heap_count;
+static uint32_t sul_heap_size;
+static uint32_t sul_event_seq;
+
+/* ---------------------------------------------------------------- Helpers */
+
+static uint32_t _rand32(uint64_t *pull_state)
+{
+	*pull_state ^= *pull_state >> 12;
+	*pull_state ^= *pull_state << 25;
+	*pull_state ^= *pull_state >> 27;
+	return (uint32_t)((*pull_state * 2685821657736338717ULL) >> 32);
+}
+
+static double _rand_exp(double d_rate)
+{
+	double d_u = ((double)_rand32(&sull_traffic_rng) + 1.0) / 4294967297.0;
+
+	return -log(d_u) / d_rate;
+}
+
+static bool _event_before(const struct sim_event *px_a, const struct sim_event *px_b)
+{
+	if (px_a->ull_time != px_b->ull_time) {
+		return px_a->ull_time < px_b->ull_time;
+	}
+
+	if (px_a->uc_type != px_b->uc_type) {
+		return px_a->uc_type < px_b->uc_type;
+	}
+
+	return (int32_t)(px_a->ul_seq - px_b->ul_seq) < 0;
+}
+
+static void _push(uint64_t ull_time, enum sim_event_type e_type, uint16_t us_node, uint32_t ul_gen)
+{
+	struct sim_event x_event;
+	uint32_t ul_i;
+
+	if (sul_heap_count == sul_heap_size) {
+		sul_heap_size = sul_heap_size ? 2 * sul_heap_size : 1024;
+		spx_heap = realloc(spx_heap, sul_heap_size * sizeof(struct sim_event));
+		if (spx_heap == NULL) {
+			fprintf(stderr, "out of memory\n");
+			exit(1);
+		}
+	}
+
+	x_event.ull_time = (ull_time < sull_now) ? sull_now : ull_time;
+	x_event.ul_seq = sul_event_seq++;
+	x_event.ul_gen = ul_gen;
+	x_event.us_node = us_node;
+	x_event.uc_type = (uint8_t)e_type;
+
+	ul_i = sul_heap_count++;
+	while (ul_i > 0) {
+		uint32_t ul_parent = (ul_i - 1) / 2;
+
+		if (!_event_before(&x_event, &spx_heap[ul_parent])) {
+			break;
+		}
+
+		spx_heap[ul_i] = spx_heap[ul_parent];
+		ul_i = ul_parent;
+	}
+
+	spx_heap[ul_i] = x_event;
+}
+
+static struct sim_event _pop(void)
+{
+	struct sim_event x_top = spx_heap[0];
+	struct sim_event x_last = spx_heap[--sul_heap_count];
+	uint32_t ul_i = 0;
+	uint32_t ul_child;
+
+	while ((ul_child = 2 * ul_i + 1) < sul_heap_count) {
+		if ((ul_child + 1 < sul_heap_count) && _event_before(&spx_heap[ul_child + 1], &spx_heap[ul_child])) {
+			ul_child++;
+		}
+
+		if (!_event_before(&spx_heap[ul_child], &x_last)) {
+			break;
+		}
+
+		spx_heap[ul_i] = spx_heap[ul_child];
+		ul_i = ul_child;
+	}
+
+	if (sul_heap_count) {
+		spx_heap[ul_i] = x_last;
+	}
+
+	return x_top;
+}
+
+/* MAC time (32-bit, wraps) to simulation time */
+static uint64_t _sim_time(uint32_t ul_mac_time)
+{
+	return sull_now + (int64_t)(int32_t)(ul_mac_time - (uint32_t)sull_now);
+}
+
+static void _select(uint16_t us_node)
+{
+	if (si_cur == us_node) {
+		return;
+	}
+
+	if (si_cur >= 0) {
+		MacRtSaveContext(spx_nodes[si_cur].puc_ctx);
+	}
+
+	MacRtRestoreContext(spx_nodes[us_node].puc_ctx);
+	si_cur = us_node;
+}
+
+/* Next time the MAC of the current node has to run by itself */
+static uint64_t _state_deadline(void)
+{
+	uint32_t ul_wait;
+
+	switch (g_MacRt.m_eState) {
+	case MAC_RT_EIFS:
+		ul_wait = g_u32MacEifsTime;
+		break;
+
+	case MAC_RT_CIFS:
+		ul_wait = g_u32MacCifsTime;
+		break;
+
+	case MAC_RT_CIFS_RETRANSMIT:
+		ul_wait = g_u32MacCifsRetransmitTime;
+		break;
+
+	case MAC_RT_RIFS:
+		ul_wait = g_u32MacRifsTime + g_u32MacAckTime + g_u32MacCifsTime;
+		break;
+
+	case MAC_RT_CP:
+		ul_wait = (1 + g_MacRtMib.m_u8HighPriorityWindowSize + (1u << g_MacRtMib.m_u8MaxBe)) * g_u32MacSlotTime;
+		break;
+
+	default:
+		return SIM_NEVER;
+	}
+
+	return _sim_time(g_MacRt.m_u32ChangeTime + ul_wait);
+}
+
+/*
+ * Called after the current node's MAC was entered. After a callback or a
+ * request it runs right away, as the firmware main loop would; otherwise only
+ * when a state timer expires. A node with nothing to send is left alone, the
+ * MAC catches up with its state timers on the next run.
+ */
+static void _after_mac(bool b_kick)
+{
+	struct sim_node *px_node = &spx_nodes[si_cur];
+	uint64_t ull_wake = SIM_NEVER;
+
+	/* The MAC dropped the scheduled transmission (reception in between) */
+	if (px_node->b_req_pending && (!g_MacRt.m_bTxRequest || (g_MacRt.m_eTxState != MAC_RT_TX_WAIT_CONFIRM))) {
+		px_node->b_req_pending = false;
+	}
+
+	if (g_MacRt.m_bTxRequest) {
+		ull_wake = b_kick ? sull_now : _state_deadline();
+	}
+
+	if (ull_wake == px_node->ull_wake) {
+		return;
+	}
+
+	px_node->ull_wake = ull_wake;
+	px_node->ul_wake_gen++;
+	if (ull_wake != SIM_NEVER) {
+		_push(ull_wake, SIM_EV_WAKE, (uint16_t)si_cur, px_node->ul_wake_gen);
+	}
+}
+
+static uint32_t _frame_duration(uint16_t us_len, struct TPlmeSetRequest *px_params)
+{
+	struct TPhyParameters x_phy = CalculatePhyParameters(px_params);
+	uint32_t ul_rs = x_phy.m_u8RsParity * (px_params->m_TxParameters.m_u8TwoRSBlocks ? 2 : 1);
+	uint32_t ul_bits = (((uint32_t)us_len + ul_rs) * 8 + 6) * 2 * x_phy.m_u8RepCode;
+	uint32_t ul_div = g_PhyBandInformation.m_u8FlBand * x_phy.m_u8SubCarriers * x_phy.m_u8BitsSubcarrier;
+	uint32_t ul_symbols;
+
+	if (ul_div == 0) {
+		ul_div = 4 * 36;
+	}
+
+	ul_symbols = (ul_bits + ul_div - 1) / ul_div * g_PhyBandInformation.m_u8FlBand;
+	/* Preamble and FCH, two coherent reference symbols, payload */
+	return g_u32MacAckTime + (ul_symbols + 2) * (g_u32MacSlotTime / 2);
+}
+
+/* ------------------------------------------------------- PHY and platform */
+
+uint32_t platform_random_32(void)
+{
+	return _rand32(&sull_mac_rng);
+}
+
+uint16_t pcrc_crc16_ccitt_update(uint16_t us_crc, const uint8_t *puc_buf, uint32_t ul_len)
+{
+	uint8_t uc_bit;
+
+	while (ul_len--) {
+		us_crc ^= (uint16_t)(*puc_buf++) << 8;
+		for (uc_bit = 0; uc_bit < 8; uc_bit++) {
+			us_crc = (us_crc & 0x8000) ? (uint16_t)((us_crc << 1) ^ 0x1021) : (uint16_t)(us_crc << 1);
+		}
+	}
+
+	return us_crc;
+}
+
+void PhyEventHandler(void)
+{
+}
+
+uint8_t PhyGetLegacyMode(void)
+{
+	return 0;
+}
+
+uint8_t PhyGetPIBLen(uint16_t us_id)
+{
+	return 0;
+}
+
+enum EPhyGetSetResult PhyGetParam(uint16_t us_id, void *p_val, uint16_t us_len)
+{
+	memset(p_val, 0, us_len);
+	return PHY_GETSET_RESULT_OK;
+}
+
+enum EPhyGetSetResult PhySetParam(uint16_t us_id, void *p_val, uint16_t us_len)
+{
+	return PHY_GETSET_RESULT_OK;
+}
+
+uint32_t PhyGetTime(void)
+{
+	return (uint32_t)sull_now;
+}
+
+void PhyGetToneMapResponseData(struct TPlmeGetToneMapResponseData *pParameters)
+{
+}
+
+void PhyInitialize(struct TPhyNotifications *pNotifications, uint8_t u8Band)
+{
+}
+
+void PhyPlmeGetRequest(struct TPlmeGetRequest *pParameters)
+{
+}
+
+void PhyPlmeResetRequest(void)
+{
+}
+
+void PhyPlmeSetRequest(struct TPlmeSetRequest *pParameters)
+{
+}
+
+void PhySetToneMask(uint8_t *pu8ToneMask)
+{
+}
+
+void PhyPdDataRequest(struct TPdDataRequest *pParameters)
+{
+	struct sim_node *px_node = &spx_nodes[si_cur];
+	struct sim_frame *px_frame = &px_node->x_req;
+	uint16_t us_dst = g_MacRt.m_TxRequest.m_DstAddr.m_nShortAddress;
+
+	px_frame->us_len = pParameters->m_u16PsduLength;
+	memcpy(px_frame->auc_psdu, pParameters->m_pPsdu, px_frame->us_len);
+	px_frame->uc_dt = g_MacRt.m_TxParameters.m_u8Dt;
+	px_frame->ul_duration = _frame_duration(px_frame->us_len, &g_MacRt.m_TxParameters);
+	px_frame->i_dst = ((us_dst >= 1) && (us_dst <= sus_nodes)) ? (int32_t)us_dst - 1 : -1;
+	px_frame->b_ack = false;
+
+	/* A new request replaces the pending one */
+	px_node->b_req_pending = true;
+	px_node->ul_req_gen++;
+	_push(pParameters->m_bDelayed ? _sim_time(pParameters->m_u32Time) : sull_now, SIM_EV_TX_START, (uint16_t)si_cur,
+			px_node->ul_req_gen);
+}
+
+void PhyPdAckRequest(struct TPdAckRequest *pParameters)
+{
+	struct sim_node *px_node = &spx_nodes[si_cur];
+
+	px_node->x_ack_fch = pParameters->m_AckFch;
+	px_node->b_ack_pending = true;
+	px_node->ul_ack_gen++;
+	_push(pParameters->m_bDelayed ? _sim_time(pParameters->m_u32Time) : sull_now, SIM_EV_ACK_START, (uint16_t)si_cur,
+			px_node->ul_ack_gen);
+}
+
+/* ---------------------------------------------------------------- Channel */
+
+static double _gain(uint16_t us_tx, uint16_t us_rx)
+{
+	return sx_channel.pd_gain[(uint32_t)us_tx * sus_nodes + us_rx];
+}
+
+static void _start_tx(uint16_t us_node)
+{
+	struct sim_node *px_node = &spx_nodes[us_node];
+	const uint16_t *pus_hear = sx_channel.ppus_hear[us_node];
+	uint16_t us_count = sx_channel.pus_hear_count[us_node];
+	struct sim_node *px_rx;
+	double d_power;
+	uint16_t us_i;
+
+	/* Half-duplex: a reception in progress is lost */
+	px_node->i_locked = -1;
+	px_node->b_transmitting = true;
+
+	for (us_i = 0; us_i < us_count; us_i++) {
+		px_rx = &spx_nodes[pus_hear[us_i]];
+		d_power = _gain(us_node, pus_hear[us_i]);
+		if (!px_rx->b_transmitting && (px_rx->i_locked < 0) &&
+				(d_power >= sd_detect * (sx_channel.pd_noise[pus_hear[us_i]] + px_rx->d_rx_power))) {
+			px_rx->i_locked = us_node;
+			px_rx->d_sig = d_power;
+			px_rx->d_max_int = px_rx->d_rx_power;
+		}
+
+		px_rx->d_rx_power += d_power;
+		if ((px_rx->i_locked >= 0) && (px_rx->i_locked != us_node) && (px_rx->d_rx_power - px_rx->d_sig > px_rx->d_max_int)) {
+			px_rx->d_max_int = px_rx->d_rx_power - px_rx->d_sig;
+		}
+	}
+
+	_push(sull_now + px_node->x_air.ul_duration, SIM_EV_TX_END, us_node, 0);
+}
+
+static void _deliver(uint16_t us_rx, const struct sim_frame *px_frame)
+{
+	struct TPdDataIndication x_ind;
+	struct TPdAckIndication x_ack_ind;
+	static uint8_t auc_psdu[MAC_PHY_MAX_PAYLOAD_LENGTH];
+
+	_select(us_rx);
+	if (px_frame->b_ack) {
+		x_ack_ind.m_AckFch = px_frame->x_ack_fch;
+		x_ack_ind.m_u32Time = (uint32_t)sull_now;
+		g_MacPhyNotifications.m_pPdAckIndication(&x_ack_ind);
+	} else {
+		memcpy(auc_psdu, px_frame->auc_psdu, px_frame->us_len);
+		x_ind.m_u16PsduLength = px_frame->us_len;
+		x_ind.m_pPsdu = auc_psdu;
+		x_ind.m_u8Dt = px_frame->uc_dt;
+		x_ind.m_u32Time = (uint32_t)sull_now;
+		g_MacPhyNotifications.m_pPdDataIndication(&x_ind);
+	}
+
+	_after_mac(true);
+}
+
+static void _end_tx(uint16_t us_node)
+{
+	struct sim_node *px_node = &spx_nodes[us_node];
+	const struct sim_frame *px_frame = &px_node->x_air;
+	const uint16_t *pus_hear = sx_channel.ppus_hear[us_node];
+	uint16_t us_count = sx_channel.pus_hear_count[us_node];
+	struct sim_node *px_rx;
+	struct TPdDataConfirm x_cfm;
+	struct TPdAckConfirm x_ack_cfm;
+	bool b_dst_ok = false;
+	uint16_t us_i;
+
+	px_node->b_transmitting = false;
+	for (us_i = 0; us_i < us_count; us_i++) {
+		px_rx = &spx_nodes[pus_hear[us_i]];
+		px_rx->d_rx_power -= _gain(us_node, pus_hear[us_i]);
+		if (px_rx->d_rx_power < 0) {
+			px_rx->d_rx_power = 0;
+		}
+	}
+
+	/* Receivers first: the frame is theirs as soon as it ends */
+	for (us_i = 0; us_i < us_count; us_i++) {
+		px_rx = &spx_nodes[pus_hear[us_i]];
+		if (px_rx->i_locked != us_node) {
+			continue;
+		}
+
+		px_rx->i_locked = -1;
+		if (px_rx->d_sig >= sd_decode * (sx_channel.pd_noise[pus_hear[us_i]] + px_rx->d_max_int)) {
+			if (pus_hear[us_i] == px_frame->i_dst) {
+				b_dst_ok = true;
+			}
+
+			_deliver(pus_hear[us_i], px_frame);
+		}
+	}
+
+	if (!px_frame->b_ack && (px_frame->i_dst >= 0) && !b_dst_ok &&
+			(sim_channel_snr_db(&sx_channel, us_node, (uint16_t)px_frame->i_dst) >= sx_cfg.d_decode_snr)) {
+		/* Lost to interference or to a busy destination, not to the link */
+		sx_stats.ul_collisions++;
+	}
+
+	_select(us_node);
+	if (px_frame->b_ack) {
+		x_ack_cfm.m_eStatus = PHY_STATUS_SUCCESS;
+		x_ack_cfm.m_u32Time = (uint32_t)sull_now;
+		g_MacPhyNotifications.m_pPdAckConfirm(&x_ack_cfm);
+	} else {
+		x_cfm.m_eStatus = PHY_STATUS_SUCCESS;
+		x_cfm.m_u32Time = (uint32_t)sull_now;
+		g_MacPhyNotifications.m_pPdDataConfirm(&x_cfm);
+	}
+
+	_after_mac(true);
+}
+
+static void _tx_start_event(uint16_t us_node)
+{
+	struct sim_node *px_node = &spx_nodes[us_node];
+	struct TPdDataConfirm x_cfm;
+
+	px_node->b_req_pending = false;
+	if (!px_node->b_transmitting && (px_node->i_locked < 0) &&
+			(px_node->d_rx_power < sd_cs * sx_channel.pd_noise[us_node])) {
+		px_node->x_air = px_node->x_req;
+		sx_stats.ul_data_tx++;
+		_start_tx(us_node);
+		return;
+	}
+
+	sx_stats.ul_busy++;
+	_select(us_node);
+	x_cfm.m_eStatus = (px_node->i_locked >= 0) ? PHY_STATUS_BUSY_RX : PHY_STATUS_BUSY;
+	x_cfm.m_u32Time = (uint32_t)sull_now;
+	g_MacPhyNotifications.m_pPdDataConfirm(&x_cfm);
+	_after_mac(true);
+}
+
+static void _ack_start_event(uint16_t us_node)
+{
+	struct sim_node *px_node = &spx_nodes[us_node];
+
+	px_node->b_ack_pending = false;
+	if (px_node->b_transmitting) {
+		return;
+	}
+
+	/* No carrier sense for ACKs */
+	memset(&px_node->x_air, 0, sizeof(px_node->x_air));
+	px_node->x_air.b_ack = true;
+	px_node->x_air.x_ack_fch = px_node->x_ack_fch;
+	px_node->x_air.ul_duration = g_u32MacAckTime;
+	px_node->x_air.i_dst = -1;
+	sx_stats.ul_ack_tx++;
+	_start_tx(us_node);
+}
+
+/* ---------------------------------------------------------------- Traffic */
+
+static void _submit(void)
+{
+	struct sim_node *px_node = &spx_nodes[si_cur];
+	static uint8_t auc_msdu[MAC_RT_MAX_PAYLOAD_SIZE];
+	struct TMacRtTxRequest x_req;
+	struct TMacRtMhr x_mhr;
+	uint8_t uc_out;
+	bool b_high;
+
+	/* The MAC queue never overflows: one in progress plus the queue size */
+	while ((px_node->uc_app_count > 0) && (px_node->uc_out_count < MAC_RT_TX_QUEUE_SIZE)) {
+		b_high = px_node->ab_app_high[px_node->uc_app_head];
+		uc_out = (px_node->uc_out_head + px_node->uc_out_count) % (MAC_RT_TX_QUEUE_SIZE + 1);
+		px_node->aull_out[uc_out] = px_node->aull_app[px_node->uc_app_head];
+		px_node->ab_out_high[uc_out] = b_high;
+		px_node->uc_out_count++;
+		px_node->uc_app_head = (px_node->uc_app_head + 1) % SIM_APP_QUEUE_SIZE;
+		px_node->uc_app_count--;
+
+		memset(&x_req, 0, sizeof(x_req));
+		memset(&x_mhr, 0, sizeof(x_mhr));
+		memset(auc_msdu, px_node->uc_seq, sx_cfg.us_payload);
+		x_req.m_DstAddr.m_eAddrMode = MAC_RT_ADDRESS_MODE_SHORT;
+		x_req.m_DstAddr.m_nShortAddress = px_node->us_dst + 1;
+		x_req.m_u16MsduLength = sx_cfg.us_payload;
+		x_req.m_pMsdu = auc_msdu;
+		x_req.m_eModulationType = sx_cfg.e_modulation;
+		x_req.m_eModulationScheme = RT_MODULATION_SCHEME_DIFFERENTIAL;
+		x_req.m_ToneMap = g_RtToneMapDefault;
+		x_req.m_bRequestAck = true;
+		x_req.m_bHighPriority = b_high;
+
+		x_mhr.m_Fc.m_nFrameType = 1;
+		x_mhr.m_Fc.m_nAckRequest = 1;
+		x_mhr.m_Fc.m_nPanIdCompression = 1;
+		x_mhr.m_Fc.m_nDestAddressingMode = MAC_RT_ADDRESS_MODE_SHORT;
+		x_mhr.m_Fc.m_nSrcAddressingMode = MAC_RT_ADDRESS_MODE_SHORT;
+		x_mhr.m_u8SequenceNumber = px_node->uc_seq++;
+		x_mhr.m_nDestinationPanIdentifier = SIM_PAN_ID;
+		x_mhr.m_DestinationAddress = x_req.m_DstAddr;
+		x_mhr.m_nSourcePanIdentifier = SIM_PAN_ID;
+		x_mhr.m_SourceAddress.m_eAddrMode = MAC_RT_ADDRESS_MODE_SHORT;
+		x_mhr.m_SourceAddress.m_nShortAddress = (uint16_t)si_cur + 1;
+
+		MacRtTxRequest(&x_req, &x_mhr);
+	}
+}
+
+static void _arrival_event(uint16_t us_node)
+{
+	struct sim_node *px_node = &spx_nodes[us_node];
+	uint8_t uc_slot;
+
+	if (sull_now < sull_end) {
+		_push(sull_now + (uint64_t)(_rand_exp(sx_cfg.d_load) * 1e6), SIM_EV_ARRIVAL, us_node, 0);
+	}
+
+	sx_stats.ul_offered++;
+	px_node->ul_offered++;
+	if (px_node->uc_app_count == SIM_APP_QUEUE_SIZE) {
+		sx_stats.ul_dropped++;
+		return;
+	}
+
+	uc_slot = (px_node->uc_app_head + px_node->uc_app_count) % SIM_APP_QUEUE_SIZE;
+	px_node->aull_app[uc_slot] = sull_now;
+	px_node->ab_app_high[uc_slot] = (_rand32(&sull_traffic_rng) < (uint32_t)(sx_cfg.d_high_fraction * 4294967295.0));
+	px_node->uc_app_count++;
+
+	_select(us_node);
+	_submit();
+	_after_mac(true);
+}
+
+static void _record_latency(uint64_t ull_latency, bool b_high)
+{
+	if (sx_stats.ul_latency_count == sx_stats.ul_latency_size) {
+		sx_stats.ul_latency_size = sx_stats.ul_latency_size ? 2 * sx_stats.ul_latency_size : 4096;
+		sx_stats.pul_latency = realloc(sx_stats.pul_latency, sx_stats.ul_latency_size * sizeof(uint32_t));
+		if (sx_stats.pul_latency == NULL) {
+			fprintf(stderr, "out of memory\n");
+			exit(1);
+		}
+	}
+
+	sx_stats.pul_latency[sx_stats.ul_latency_count++] = (uint32_t)ull_latency;
+	if (b_high) {
+		sx_stats.ull_high_latency += ull_latency;
+		sx_stats.ul_high_count++;
+	}
+}
+
+/* ------------------------------------------------------------ MAC upcalls */
+
+static void _process_frame(struct TMacRtFrame *pFrame, struct TMacRtDataIndication *pParameters)
+{
+}
+
+static void _tx_confirm(enum EMacRtStatus eStatus, bool bUpdateTimestamp, enum ERtModulationType eModType)
+{
+	struct sim_node *px_node = &spx_nodes[si_cur];
+	uint64_t ull_arrival = px_node->aull_out[px_node->uc_out_head];
+	bool b_high = px_node->ab_out_high[px_node->uc_out_head];
+
+	px_node->uc_out_head = (px_node->uc_out_head + 1) % (MAC_RT_TX_QUEUE_SIZE + 1);
+	px_node->uc_out_count--;
+
+	switch (eStatus) {
+	case MAC_RT_STATUS_SUCCESS:
+		sx_stats.ul_success++;
+		sx_stats.ull_bytes += sx_cfg.us_payload;
+		px_node->ul_success++;
+		_record_latency(sull_now - ull_arrival, b_high);
+		break;
+
+	case MAC_RT_STATUS_CHANNEL_ACCESS_FAILURE:
+		sx_stats.ul_caf++;
+		break;
+
+	case MAC_RT_STATUS_NO_ACK:
+		sx_stats.ul_no_ack++;
+		break;
+
+	default:
+		sx_stats.ul_other++;
+		break;
+	}
+
+	_submit();
+}
+
+/* -------------------------------------------------------------------- Run */
+
+static bool _set_pib(enum EMacRtPibAttribute e_attribute, const void *pv_value, uint8_t uc_len)
+{
+	struct TMacRtPibValue x_value;
+
+	x_value.m_u8Length = uc_len;
+	memcpy(x_value.m_au8Value, pv_value, uc_len);
+	return MacRtSetRequestSync(e_attribute, 0, &x_value) == MAC_RT_STATUS_SUCCESS;
+}
+
+static bool _init_nodes(const struct sim_mac_params *px_params)
+{
+	static struct TMacRtNotifications x_notifications;
+	uint8_t uc_max = 20;
+	uint16_t us_pan = SIM_PAN_ID;
+	uint16_t us_addr;
+	uint16_t us_i;
+	uint16_t us_j;
+	double d_best;
+
+	memset(&x_notifications, 0, sizeof(x_notifications));
+	x_notifications.m_pProcessFrame = _process_frame;
+	x_notifications.m_pMacRtTxConfirm = _tx_confirm;
+
+	for (us_i = 0; us_i < sus_nodes; us_i++) {
+		struct sim_node *px_node = &spx_nodes[us_i];
+		uint8_t *puc_ctx = px_node->puc_ctx;
+
+		memset(px_node, 0, sizeof(*px_node));
+		px_node->puc_ctx = puc_ctx;
+		px_node->i_locked = -1;
+		px_node->ull_wake = SIM_NEVER;
+
+		/* Strongest neighbour as destination */
+		d_best = -1;
+		for (us_j = 0; us_j < sus_nodes; us_j++) {
+			if ((us_j != us_i) && (_gain(us_i, us_j) > d_best)) {
+				d_best = _gain(us_i, us_j);
+				px_node->us_dst = us_j;
+			}
+		}
+
+		si_cur = us_i;
+		MacRtInitialize(SIM_BAND, &x_notifications, MAC_RT_SPEC_COMPLIANCE_17);
+		us_addr = us_i + 1;
+		/* MinBe < MaxBe is checked on every set: open MaxBe first */
+		if (!_set_pib(MAC_RT_PIB_PAN_ID, &us_pan, sizeof(us_pan)) ||
+				!_set_pib(MAC_RT_PIB_SHORT_ADDRESS, &us_addr, sizeof(us_addr)) ||
+				!_set_pib(MAC_RT_PIB_MAX_BE, &uc_max, 1) ||
+				!_set_pib(MAC_RT_PIB_MIN_BE, &px_params->uc_min_be, 1) ||
+				!_set_pib(MAC_RT_PIB_MAX_BE, &px_params->uc_max_be, 1) ||
+				!_set_pib(MAC_RT_PIB_HIGH_PRIORITY_WINDOW_SIZE, &px_params->uc_hp_window, 1) ||
+				!_set_pib(MAC_RT_PIB_CSMA_FAIRNESS_LIMIT, &px_params->uc_fairness, 1)) {
+			si_cur = -1;
+			return false;
+		}
+
+		g_MacRt.m_u32Cw = 1u << g_MacRtMib.m_u8MinBe;
+		MacRtEventHandler();
+		MacRtSaveContext(px_node->puc_ctx);
+	}
+
+	return true;
+}
+
+static int _compare_u32(const void *pv_a, const void *pv_b)
+{
+	uint32_t ul_a = *(const uint32_t *)pv_a;
+	uint32_t ul_b = *(const uint32_t *)pv_b;
+
+	return (ul_a > ul_b) - (ul_a < ul_b);
+}
+
+static double _percentile_ms(double d_percentile)
+{
+	uint32_t ul_index;
+
+	if (sx_stats.ul_latency_count == 0) {
+		return 0;
+	}
+
+	ul_index = (uint32_t)(d_percentile * (sx_stats.ul_latency_count - 1) + 0.5);
+	return sx_stats.pul_latency[ul_index] / 1000.0;
+}
+
+static double _jain_fairness(void)
+{
+	double d_sum = 0;
+	double d_sum_sq = 0;
+	uint32_t ul_n = 0;
+	uint16_t us_i;
+
+	for (us_i = 0; us_i < sus_nodes; us_i++) {
+		if (spx_nodes[us_i].ul_offered) {
+			/* Delivery ratio: Poisson arrivals make raw counts unequal even on a fair channel */
+			double d_x = (double)spx_nodes[us_i].ul_success / spx_nodes[us_i].ul_offered;
+
+			d_sum += d_x;
+			d_sum_sq += d_x * d_x;
+			ul_n++;
+		}
+	}
+
+	return (d_sum_sq > 0) ? (d_sum * d_sum) / (ul_n * d_sum_sq) : 0;
+}
+
+static void _run(const struct sim_mac_params *px_params)
+{
+	struct sim_event x_event;
+	struct sim_node *px_node;
+	uint64_t ull_latency_sum = 0;
+	clock_t x_start;
+	double d_wall;
+	uint32_t ul_i;
+	uint16_t us_i;
+
+	free(sx_stats.pul_latency);
+	memset(&sx_stats, 0, sizeof(sx_stats));
+	sul_heap_count = 0;
+	sul_event_seq = 0;
+	sull_mac_rng = ((uint64_t)sx_cfg.ul_seed << 1) | 1;
+	sull_traffic_rng = ((uint64_t)sx_cfg.ul_seed << 33) | 0x5555;
+	sull_now = SIM_TIME_START;
+	sull_end = SIM_TIME_START + (uint64_t)sx_cfg.ul_seconds * 1000000ULL;
+
+	printf("%5u %5u %3u %4u ", px_params->uc_min_be, px_params->uc_max_be, px_params->uc_hp_window, px_params->uc_fairness);
+	if (!_init_nodes(px_params)) {
+		printf(" invalid MIB combination, skipped\n");
+		return;
+	}
+
+	for (us_i = 0; us_i < sus_nodes; us_i++) {
+		_push(sull_now + (uint64_t)(_rand_exp(sx_cfg.d_load) * 1e6), SIM_EV_ARRIVAL, us_i, 0);
+	}
+
+	x_start = clock();
+	while (sul_heap_count && (spx_heap[0].ull_time < sull_end)) {
+		x_event = _pop();
+		sull_now = x_event.ull_time;
+		px_node = &spx_nodes[x_event.us_node];
+		sx_stats.ull_events++;
+
+		switch (x_event.uc_type) {
+		case SIM_EV_TX_END:
+			_end_tx(x_event.us_node);
+			break;
+
+		case SIM_EV_TX_START:
+			if (px_node->b_req_pending && (x_event.ul_gen == px_node->ul_req_gen)) {
+				_tx_start_event(x_event.us_node);
+			}
+
+			break;
+
+		case SIM_EV_ACK_START:
+			if (px_node->b_ack_pending && (x_event.ul_gen == px_node->ul_ack_gen)) {
+				_ack_start_event(x_event.us_node);
+			}
+
+			break;
+
+		case SIM_EV_WAKE:
+			if (x_event.ul_gen == px_node->ul_wake_gen) {
+				px_node->ull_wake = SIM_NEVER;
+				_select(x_event.us_node);
+				MacRtEventHandler();
+				_after_mac(false);
+			}
+
+			break;
+
+		case SIM_EV_ARRIVAL:
+			_arrival_event(x_event.us_node);
+			break;
+		}
+	}
+
+	d_wall = (double)(clock() - x_start) / CLOCKS_PER_SEC;
+	sull_now = sull_end;
+
+	qsort(sx_stats.pul_latency, sx_stats.ul_latency_count, sizeof(uint32_t), _compare_u32);
+	for (ul_i = 0; ul_i < sx_stats.ul_latency_count; ul_i++) {
+		ull_latency_sum += sx_stats.pul_latency[ul_i];
+	}
+
+	printf("%7u %7u %5u %5u %5u %7.0f %7.1f %7.1f %7.1f %7.1f %5.3f %6u %7u %6.2f\n",
+			sx_stats.ul_offered, sx_stats.ul_success, sx_stats.ul_caf, sx_stats.ul_no_ack,
+			sx_stats.ul_dropped + sx_stats.ul_other,
+			sx_stats.ull_bytes * 8.0 / sx_cfg.ul_seconds,
+			sx_stats.ul_latency_count ? ull_latency_sum / 1000.0 / sx_stats.ul_latency_count : 0.0,
+			_percentile_ms(0.95), _percentile_ms(0.99),
+			sx_stats.ul_high_count ? sx_stats.ull_high_latency / 1000.0 / sx_stats.ul_high_count : 0.0,
+			_jain_fairness(), sx_stats.ul_collisions, sx_stats.ul_busy,
+			d_wall > 0 ? sx_stats.ull_events / d_wall / 1e6 : 0.0);
+	fflush(stdout);
+}
+
+/* ------------------------------------------------------------------- Main */
+
+static uint8_t _parse_list(const char *pc_list, uint8_t *puc_values)
+{
+	char *pc_end;
+	uint8_t uc_count = 0;
+
+	while (*pc_list && (uc_count < SIM_MAX_LIST)) {
+		puc_values[uc_count++] = (uint8_t)strtoul(pc_list, &pc_end, 0);
+		if (pc_end == pc_list) {
+			break;
+		}
+
+		pc_list = (*pc_end == ',') ? pc_end + 1 : pc_end;
+	}
+
+	return uc_count;
+}
+
+static void _usage(const char *pc_name)
+{
+	printf("usage: %s [options]\n"
+			"  -n nodes       generated cell size (default 100)\n"
+			"  -m file        attenuation / noise matrix instead of a generated cell\n"
+			"  -g spacing     mean distance between nodes in the generated cell, m (default 15)\n"
+			"  -t seconds     simulated time per run (default 60)\n"
+			"  -l rate        frames per second per node, Poisson (default 0.02)\n"
+			"  -p bytes       MSDU length (default 100)\n"
+			"  -H fraction    high priority share of the frames (default 0.1)\n"
+			"  -M mod         robo, bpsk, qpsk or 8psk (default robo)\n"
+			"  -d snr         detection threshold, dB (default 0)\n"
+			"  -D snr         decoding threshold, dB (default 3)\n"
+			"  -c snr         carrier sense threshold, dB (default 0)\n"
+			"  -s seed        (default 1)\n"
+			"  -b list        MinBe values, e.g. 2,3,4 (default 3)\n"
+			"  -B list        MaxBe values (default 8)\n"
+			"  -w list        high priority window sizes (default 7)\n"
+			"  -f list        CSMA fairness limits, 0 for 2 * (MaxBe - MinBe) (default 15)\n",
+			pc_name);
+}
+
+int main(int argc, char **argv)
+{
+	struct sim_channel_cell x_cell = {100, 15.0, 20.0, 0.4, 4.0, -60.0, 3.0, 1};
+	const char *pc_matrix = NULL;
+	uint8_t auc_min_be[SIM_MAX_LIST] = {3};
+	uint8_t auc_max_be[SIM_MAX_LIST] = {8};
+	uint8_t auc_hp_window[SIM_MAX_LIST] = {7};
+	uint8_t auc_fairness[SIM_MAX_LIST] = {15};
+	uint8_t uc_min_be_count = 1;
+	uint8_t uc_max_be_count = 1;
+	uint8_t uc_hp_window_count = 1;
+	uint8_t uc_fairness_count = 1;
+	struct sim_mac_params x_params;
+	uint32_t ul_links = 0;
+	uint16_t us_i;
+	int i_opt;
+	int i_a, i_b, i_c, i_d;
+
+	sx_cfg.ul_seconds = 60;
+	sx_cfg.d_load = 0.02;
+	sx_cfg.d_high_fraction = 0.1;
+	sx_cfg.us_payload = 100;
+	sx_cfg.e_modulation = RT_MODULATION_ROBUST;
+	sx_cfg.d_detect_snr = 0;
+	sx_cfg.d_decode_snr = 3;
+	sx_cfg.d_cs_snr = 0;
+	sx_cfg.ul_seed = 1;
+
+	while ((i_opt = getopt(argc, argv, "n:m:g:t:l:p:H:M:d:D:c:s:b:B:w:f:h")) != -1) {
+		switch (i_opt) {
+		case 'n': x_cell.us_nodes = (uint16_t)strtoul(optarg, NULL, 0); break;
+		case 'm': pc_matrix = optarg; break;
+		case 'g': x_cell.d_spacing = strtod(optarg, NULL); break;
+		case 't': sx_cfg.ul_seconds = strtoul(optarg, NULL, 0); break;
+		case 'l': sx_cfg.d_load = strtod(optarg, NULL); break;
+		case 'p': sx_cfg.us_payload = (uint16_t)strtoul(optarg, NULL, 0); break;
+		case 'H': sx_cfg.d_high_fraction = strtod(optarg, NULL); break;
+		case 'd': sx_cfg.d_detect_snr = strtod(optarg, NULL); break;
+		case 'D': sx_cfg.d_decode_snr = strtod(optarg, NULL); break;
+		case 'c': sx_cfg.d_cs_snr = strtod(optarg, NULL); break;
+		case 's': sx_cfg.ul_seed = strtoul(optarg, NULL, 0); break;
+		case 'b': uc_min_be_count = _parse_list(optarg, auc_min_be); break;
+		case 'B': uc_max_be_count = _parse_list(optarg, auc_max_be); break;
+		case 'w': uc_hp_window_count = _parse_list(optarg, auc_hp_window); break;
+		case 'f': uc_fairness_count = _parse_list(optarg, auc_fairness); break;
+		case 'M':
+			if (!strcmp(optarg, "robo")) {
+				sx_cfg.e_modulation = RT_MODULATION_ROBUST;
+			} else if (!strcmp(optarg, "bpsk")) {
+				sx_cfg.e_modulation = RT_MODULATION_DBPSK_BPSK;
+			} else if (!strcmp(optarg, "qpsk")) {
+				sx_cfg.e_modulation = RT_MODULATION_DQPSK_QPSK;
+			} else if (!strcmp(optarg, "8psk")) {
+				sx_cfg.e_modulation = RT_MODULATION_D8PSK_8PSK;
+			} else {
+				_usage(argv[0]);
+				return 1;
+			}
+
+			break;
+
+		default:
+			_usage(argv[0]);
+			return (i_opt == 'h') ? 0 : 1;
+		}
+	}
+
+	if ((sx_cfg.us_payload == 0) || (sx_cfg.us_payload > MAC_RT_MAX_PAYLOAD_SIZE) || (sx_cfg.d_load <= 0) ||
+			(sx_cfg.ul_seconds == 0) || (sx_cfg.ul_seconds > 4000)) {
+		fprintf(stderr, "bad payload, load or time\n");
+		return 1;
+	}
+
+	if (pc_matrix != NULL) {
+		if (!sim_channel_load(&sx_channel, pc_matrix)) {
+			return 1;
+		}
+	} else {
+		if (x_cell.us_nodes < 2) {
+			fprintf(stderr, "at least 2 nodes\n");
+			return 1;
+		}
+
+		x_cell.ul_seed = sx_cfg.ul_seed;
+		sim_channel_generate(&sx_channel, &x_cell);
+	}
+
+	sus_nodes = sx_channel.us_nodes;
+	sd_detect = pow(10.0, sx_cfg.d_detect_snr / 10.0);
+	sd_decode = pow(10.0, sx_cfg.d_decode_snr / 10.0);
+	sd_cs = pow(10.0, sx_cfg.d_cs_snr / 10.0);
+	spx_nodes = calloc(sus_nodes, sizeof(struct sim_node));
+	if (spx_nodes == NULL) {
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+
+	for (us_i = 0; us_i < sus_nodes; us_i++) {
+		spx_nodes[us_i].puc_ctx = malloc(MacRtGetContextSize());
+		if (spx_nodes[us_i].puc_ctx == NULL) {
+			fprintf(stderr, "out of memory\n");
+			return 1;
+		}
+
+		ul_links += sx_channel.pus_hear_count[us_i];
+	}
+
+	printf("%u nodes, %.1f receivers above the floor per node, %u s, %.3f frames/s/node, %u bytes, %.0f%% high priority\n",
+			sus_nodes, (double)ul_links / sus_nodes, sx_cfg.ul_seconds, sx_cfg.d_load, sx_cfg.us_payload,
+			100 * sx_cfg.d_high_fraction);
+	printf("minbe maxbe hpw fair offered      ok   caf noack  drop goodput lat_avg lat_p95 lat_p99  hp_avg  jain   coll    busy Mev/s\n");
+	printf("                                                           b/s      ms      ms      ms      ms\n");
+
+	for (i_a = 0; i_a < uc_min_be_count; i_a++) {
+		for (i_b = 0; i_b < uc_max_be_count; i_b++) {
+			for (i_c = 0; i_c < uc_hp_window_count; i_c++) {
+				for (i_d = 0; i_d < uc_fairness_count; i_d++) {
+					x_params.uc_min_be = auc_min_be[i_a];
+					x_params.uc_max_be = auc_max_be[i_b];
+					x_params.uc_hp_window = auc_hp_window[i_c];
+					x_params.uc_fairness = auc_fairness[i_d];
+					if (x_params.uc_fairness == 0) {
+						x_params.uc_fairness = 2 * (x_params.uc_max_be - x_params.uc_min_be);
+					}
+
+					_run(&x_params);
+				}
+			}
+		}
+	}
+
+	for (us_i = 0; us_i < sus_nodes; us_i++) {
+		free(spx_nodes[us_i].puc_ctx);
+	}
+
+	free(spx_nodes);
+	free(spx_heap);
+	free(sx_stats.pul_latency);
+	sim_channel_free(&sx_channel);
+	return 0;
+}
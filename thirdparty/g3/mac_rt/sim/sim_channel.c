@@ -0,0 +1,237 @@
+/**
+ * \file
+ *
+ * \brief Channel model of the MAC RT cell simulator.
+ *
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sim_channel.h"
+
+static uint64_t sull_rng;
+
+static double _rand_uniform(void)
+{
+	/* xorshift64*, own state so that the cell does not depend on the MAC */
+	sull_rng ^= sull_rng >> 12;
+	sull_rng ^= sull_rng << 25;
+	sull_rng ^= sull_rng >> 27;
+	return (double)((sull_rng * 2685821657736338717ULL) >> 11) / 9007199254740992.0;
+}
+
+static double _rand_normal(void)
+{
+	double d_u1 = _rand_uniform();
+	double d_u2 = _rand_uniform();
+
+	if (d_u1 < 1e-12) {
+		d_u1 = 1e-12;
+	}
+
+	return sqrt(-2.0 * log(d_u1)) * cos(2.0 * M_PI * d_u2);
+}
+
+static double _db_to_linear(double d_db)
+{
+	return pow(10.0, d_db / 10.0);
+}
+
+static void _alloc(struct sim_channel *px_channel, uint16_t us_nodes)
+{
+	px_channel->us_nodes = us_nodes;
+	px_channel->pd_gain = calloc((size_t)us_nodes * us_nodes, sizeof(double));
+	px_channel->pd_noise = calloc(us_nodes, sizeof(double));
+	px_channel->ppus_hear = calloc(us_nodes, sizeof(uint16_t *));
+	px_channel->pus_hear_count = calloc(us_nodes, sizeof(uint16_t));
+	if (!px_channel->pd_gain || !px_channel->pd_noise || !px_channel->ppus_hear || !px_channel->pus_hear_count) {
+		fprintf(stderr, "out of memory\n");
+		exit(1);
+	}
+}
+
+/* Lists, per transmitter, the receivers above the floor */
+static void _build_hear_lists(struct sim_channel *px_channel)
+{
+	uint16_t us_nodes = px_channel->us_nodes;
+	uint16_t us_tx;
+	uint16_t us_rx;
+	uint16_t us_count;
+
+	for (us_tx = 0; us_tx < us_nodes; us_tx++) {
+		px_channel->ppus_hear[us_tx] = malloc(us_nodes * sizeof(uint16_t));
+		us_count = 0;
+		for (us_rx = 0; us_rx < us_nodes; us_rx++) {
+			if ((us_rx != us_tx) && (sim_channel_snr_db(px_channel, us_tx, us_rx) >= SIM_CHANNEL_FLOOR_SNR_DB)) {
+				px_channel->ppus_hear[us_tx][us_count++] = us_rx;
+			}
+		}
+
+		px_channel->pus_hear_count[us_tx] = us_count;
+	}
+}
+
+static int _next_token(FILE *px_file, char *pc_token, size_t ul_size)
+{
+	int i_c;
+	size_t ul_len = 0;
+
+	for (;;) {
+		i_c = fgetc(px_file);
+		if (i_c == '#') {
+			while ((i_c != EOF) && (i_c != '\n')) {
+				i_c = fgetc(px_file);
+			}
+		}
+
+		if (i_c == EOF) {
+			return 0;
+		}
+
+		if ((i_c != ' ') && (i_c != '\t') && (i_c != '\r') && (i_c != '\n')) {
+			break;
+		}
+	}
+
+	while ((i_c != EOF) && (i_c != ' ') && (i_c != '\t') && (i_c != '\r') && (i_c != '\n') && (i_c != '#')) {
+		if (ul_len + 1 < ul_size) {
+			pc_token[ul_len++] = (char)i_c;
+		}
+
+		i_c = fgetc(px_file);
+	}
+
+	if (i_c == '#') {
+		ungetc(i_c, px_file);
+	}
+
+	pc_token[ul_len] = 0;
+	return 1;
+}
+
+bool sim_channel_load(struct sim_channel *px_channel, const char *pc_path)
+{
+	FILE *px_file;
+	char ac_token[64];
+	uint32_t ul_nodes;
+	uint32_t ul_i;
+	bool b_ok = false;
+
+	px_file = fopen(pc_path, "r");
+	if (px_file == NULL) {
+		fprintf(stderr, "%s: cannot open\n", pc_path);
+		return false;
+	}
+
+	if (!_next_token(px_file, ac_token, sizeof(ac_token)) || strcmp(ac_token, "nodes") ||
+			!_next_token(px_file, ac_token, sizeof(ac_token))) {
+		fprintf(stderr, "%s: expected 'nodes <n>'\n", pc_path);
+		goto out;
+	}
+
+	ul_nodes = strtoul(ac_token, NULL, 0);
+	if ((ul_nodes < 2) || (ul_nodes > 0xFFFF)) {
+		fprintf(stderr, "%s: bad node count\n", pc_path);
+		goto out;
+	}
+
+	_alloc(px_channel, (uint16_t)ul_nodes);
+	for (ul_i = 0; ul_i < ul_nodes * ul_nodes; ul_i++) {
+		if (!_next_token(px_file, ac_token, sizeof(ac_token))) {
+			fprintf(stderr, "%s: attenuation matrix too short\n", pc_path);
+			goto out;
+		}
+
+		px_channel->pd_gain[ul_i] = _db_to_linear(-strtod(ac_token, NULL));
+	}
+
+	if (!_next_token(px_file, ac_token, sizeof(ac_token)) || strcmp(ac_token, "noise")) {
+		fprintf(stderr, "%s: expected 'noise'\n", pc_path);
+		goto out;
+	}
+
+	for (ul_i = 0; ul_i < ul_nodes; ul_i++) {
+		if (!_next_token(px_file, ac_token, sizeof(ac_token))) {
+			fprintf(stderr, "%s: noise row too short\n", pc_path);
+			goto out;
+		}
+
+		px_channel->pd_noise[ul_i] = _db_to_linear(strtod(ac_token, NULL));
+	}
+
+	_build_hear_lists(px_channel);
+	b_ok = true;
+
+out:
+	fclose(px_file);
+	return b_ok;
+}
+
+void sim_channel_generate(struct sim_channel *px_channel, const struct sim_channel_cell *px_cell)
+{
+	uint16_t us_nodes = px_cell->us_nodes;
+	double d_side = px_cell->d_spacing * sqrt((double)us_nodes);
+	double *pd_x;
+	double *pd_y;
+	double d_att;
+	uint16_t us_a;
+	uint16_t us_b;
+
+	sull_rng = ((uint64_t)px_cell->ul_seed << 1) | 1;
+	_alloc(px_channel, us_nodes);
+	pd_x = malloc(us_nodes * sizeof(double));
+	pd_y = malloc(us_nodes * sizeof(double));
+
+	for (us_a = 0; us_a < us_nodes; us_a++) {
+		pd_x[us_a] = _rand_uniform() * d_side;
+		pd_y[us_a] = _rand_uniform() * d_side;
+		px_channel->pd_noise[us_a] = _db_to_linear(px_cell->d_noise + px_cell->d_noise_spread * _rand_normal());
+	}
+
+	/* Attenuation is the same both ways, noise is not */
+	for (us_a = 0; us_a < us_nodes; us_a++) {
+		for (us_b = us_a + 1; us_b < us_nodes; us_b++) {
+			d_att = px_cell->d_att_0 + px_cell->d_att_slope * hypot(pd_x[us_a] - pd_x[us_b], pd_y[us_a] - pd_y[us_b]) +
+					px_cell->d_shadowing * _rand_normal();
+			if (d_att < 0) {
+				d_att = 0;
+			}
+
+			px_channel->pd_gain[us_a * us_nodes + us_b] = _db_to_linear(-d_att);
+			px_channel->pd_gain[us_b * us_nodes + us_a] = _db_to_linear(-d_att);
+		}
+	}
+
+	free(pd_x);
+	free(pd_y);
+	_build_hear_lists(px_channel);
+}
+
+void sim_channel_free(struct sim_channel *px_channel)
+{
+	uint16_t us_i;
+
+	for (us_i = 0; us_i < px_channel->us_nodes; us_i++) {
+		free(px_channel->ppus_hear[us_i]);
+	}
+
+	free(px_channel->ppus_hear);
+	free(px_channel->pus_hear_count);
+	free(px_channel->pd_gain);
+	free(px_channel->pd_noise);
+	memset(px_channel, 0, sizeof(*px_channel));
+}
+
+double sim_channel_snr_db(const struct sim_channel *px_channel, uint16_t us_tx, uint16_t us_rx)
+{
+	double d_gain = px_channel->pd_gain[(uint32_t)us_tx * px_channel->us_nodes + us_rx];
+
+	if (d_gain <= 0) {
+		return -1000.0;
+	}
+
+	return 10.0 * log10(d_gain / px_channel->pd_noise[us_rx]);
+}
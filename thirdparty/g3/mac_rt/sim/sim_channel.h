@@ -0,0 +1,61 @@
+/**
+ * \file
+ *
+ * \brief Channel model of the MAC RT cell simulator.
+ *
+ * Attenuation between every pair of nodes and noise at every node, in dB
+ * relative to the transmission level. Either loaded from a text file or
+ * generated from random node positions.
+ *
+ */
+
+#ifndef SIM_CHANNEL_H_INCLUDED
+#define SIM_CHANNEL_H_INCLUDED
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/** Received power below this SNR (dB) is neither decoded nor counted as interference */
+#define SIM_CHANNEL_FLOOR_SNR_DB   (-20.0)
+
+struct sim_channel {
+	uint16_t us_nodes;
+	/** Linear power gain, [tx * us_nodes + rx] */
+	double *pd_gain;
+	/** Linear noise power per node */
+	double *pd_noise;
+	/** Per transmitter, the nodes that receive it above the floor */
+	uint16_t **ppus_hear;
+	uint16_t *pus_hear_count;
+};
+
+/** Parameters of a generated cell */
+struct sim_channel_cell {
+	uint16_t us_nodes;
+	/** Distance between neighbour positions on the grid (m) */
+	double d_spacing;
+	/** Attenuation at zero distance (dB) and per metre (dB/m) */
+	double d_att_0;
+	double d_att_slope;
+	/** Standard deviation of the per link shadowing (dB) */
+	double d_shadowing;
+	/** Mean noise level and spread between nodes (dB) */
+	double d_noise;
+	double d_noise_spread;
+	uint32_t ul_seed;
+};
+
+/*
+ * Matrix file format, '#' starts a comment:
+ *
+ *   nodes <n>
+ *   <n rows of n attenuations in dB, row is the transmitter>
+ *   noise <n noise levels in dB>
+ */
+bool sim_channel_load(struct sim_channel *px_channel, const char *pc_path);
+void sim_channel_generate(struct sim_channel *px_channel, const struct sim_channel_cell *px_cell);
+void sim_channel_free(struct sim_channel *px_channel);
+
+double sim_channel_snr_db(const struct sim_channel *px_channel, uint16_t us_tx, uint16_t us_rx);
+
+#endif /* SIM_CHANNEL_H_INCLUDED */
@@ -6,6 +6,7 @@
 #include <MacRtDefs.h>
 #include <MacRtConstants.h>
 #include <MacRtMib.h>
+#include <pcrc.h>
 #include <string.h>
 #include <stdio.h>
 
@@ -21,6 +22,35 @@ extern uint8_t u8RtMibSpecCompliance;
 
 #define MAC_RT_MINIMAL_TX_DELAY 2500
 
+// Number of TX parameter sets kept to skip CalculateTxParameters() on repeated transmissions (0 disables it).
+#ifndef MAC_RT_TX_PARAM_CACHE_SIZE
+#define MAC_RT_TX_PARAM_CACHE_SIZE 4
+#endif
+
+// Number of transmission requests that can wait, per priority lane, while another one is in progress.
+#ifndef MAC_RT_TX_QUEUE_SIZE
+#define MAC_RT_TX_QUEUE_SIZE 2
+#endif
+
+#if (MAC_RT_TX_QUEUE_SIZE < 1) || (MAC_RT_TX_QUEUE_SIZE > 63)
+#error "MAC_RT_TX_QUEUE_SIZE must be between 1 and 63"
+#endif
+
+// Build the next segment of a segmented frame while the current one is being sent (0 disables it).
+#ifndef MAC_RT_TX_SEGMENT_RUN_AHEAD
+#define MAC_RT_TX_SEGMENT_RUN_AHEAD 1
+#endif
+
+enum EMacRtTxLane {
+  MAC_RT_TX_LANE_HIGH_PRIORITY,
+  MAC_RT_TX_LANE_NORMAL_PRIORITY,
+  MAC_RT_TX_LANES
+};
+
+// Confirms are delivered in request order. A frame sent ahead of an earlier one keeps its confirm until the earlier
+// one is confirmed, so more requests than queue entries can be outstanding.
+#define MAC_RT_TX_CONFIRM_FIFO_SIZE (2 * (MAC_RT_TX_LANES * MAC_RT_TX_QUEUE_SIZE + 1))
+
 enum EMacRtState {
   MAC_RT_IDLE,
   MAC_RT_EIFS,
@@ -95,51 +125,71 @@ static uint8_t *pTxData;
 
 static struct TMacRtData g_MacRt;
 
-static const uint16_t g_Crc16[256] = {
-  0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50a5, 0x60c6, 0x70e7,
-  0x8108, 0x9129, 0xa14a, 0xb16b, 0xc18c, 0xd1ad, 0xe1ce, 0xf1ef,
-  0x1231, 0x0210, 0x3273, 0x2252, 0x52b5, 0x4294, 0x72f7, 0x62d6,
-  0x9339, 0x8318, 0xb37b, 0xa35a, 0xd3bd, 0xc39c, 0xf3ff, 0xe3de,
-  0x2462, 0x3443, 0x0420, 0x1401, 0x64e6, 0x74c7, 0x44a4, 0x5485,
-  0xa56a, 0xb54b, 0x8528, 0x9509, 0xe5ee, 0xf5cf, 0xc5ac, 0xd58d,
-  0x3653, 0x2672, 0x1611, 0x0630, 0x76d7, 0x66f6, 0x5695, 0x46b4,
-  0xb75b, 0xa77a, 0x9719, 0x8738, 0xf7df, 0xe7fe, 0xd79d, 0xc7bc,
-  0x48c4, 0x58e5, 0x6886, 0x78a7, 0x0840, 0x1861, 0x2802, 0x3823,
-  0xc9cc, 0xd9ed, 0xe98e, 0xf9af, 0x8948, 0x9969, 0xa90a, 0xb92b,
-  0x5af5, 0x4ad4, 0x7ab7, 0x6a96, 0x1a71, 0x0a50, 0x3a33, 0x2a12,
-  0xdbfd, 0xcbdc, 0xfbbf, 0xeb9e, 0x9b79, 0x8b58, 0xbb3b, 0xab1a,
-  0x6ca6, 0x7c87, 0x4ce4, 0x5cc5, 0x2c22, 0x3c03, 0x0c60, 0x1c41,
-  0xedae, 0xfd8f, 0xcdec, 0xddcd, 0xad2a, 0xbd0b, 0x8d68, 0x9d49,
-  0x7e97, 0x6eb6, 0x5ed5, 0x4ef4, 0x3e13, 0x2e32, 0x1e51, 0x0e70,
-  0xff9f, 0xefbe, 0xdfdd, 0xcffc, 0xbf1b, 0xaf3a, 0x9f59, 0x8f78,
-  0x9188, 0x81a9, 0xb1ca, 0xa1eb, 0xd10c, 0xc12d, 0xf14e, 0xe16f,
-  0x1080, 0x00a1, 0x30c2, 0x20e3, 0x5004, 0x4025, 0x7046, 0x6067,
-  0x83b9, 0x9398, 0xa3fb, 0xb3da, 0xc33d, 0xd31c, 0xe37f, 0xf35e,
-  0x02b1, 0x1290, 0x22f3, 0x32d2, 0x4235, 0x5214, 0x6277, 0x7256,
-  0xb5ea, 0xa5cb, 0x95a8, 0x8589, 0xf56e, 0xe54f, 0xd52c, 0xc50d,
-  0x34e2, 0x24c3, 0x14a0, 0x0481, 0x7466, 0x6447, 0x5424, 0x4405,
-  0xa7db, 0xb7fa, 0x8799, 0x97b8, 0xe75f, 0xf77e, 0xc71d, 0xd73c,
-  0x26d3, 0x36f2, 0x0691, 0x16b0, 0x6657, 0x7676, 0x4615, 0x5634,
-  0xd94c, 0xc96d, 0xf90e, 0xe92f, 0x99c8, 0x89e9, 0xb98a, 0xa9ab,
-  0x5844, 0x4865, 0x7806, 0x6827, 0x18c0, 0x08e1, 0x3882, 0x28a3,
-  0xcb7d, 0xdb5c, 0xeb3f, 0xfb1e, 0x8bf9, 0x9bd8, 0xabbb, 0xbb9a,
-  0x4a75, 0x5a54, 0x6a37, 0x7a16, 0x0af1, 0x1ad0, 0x2ab3, 0x3a92,
-  0xfd2e, 0xed0f, 0xdd6c, 0xcd4d, 0xbdaa, 0xad8b, 0x9de8, 0x8dc9,
-  0x7c26, 0x6c07, 0x5c64, 0x4c45, 0x3ca2, 0x2c83, 0x1ce0, 0x0cc1,
-  0xef1f, 0xff3e, 0xcf5d, 0xdf7c, 0xaf9b, 0xbfba, 0x8fd9, 0x9ff8,
-  0x6e17, 0x7e36, 0x4e55, 0x5e74, 0x2e93, 0x3eb2, 0x0ed1, 0x1ef0,
-};
-
 static uint8_t u8AvailableRSBlocks;
 static uint8_t au8Gain[PHY_MAX_TONE_GROUPS];
 
+// Transmission request waiting for the one in progress to be confirmed. The MSDU is copied, so the caller can reuse
+// its buffer as soon as MacRtTxRequest() returns.
+struct TMacRtTxQueueEntry {
+  struct TMacRtTxRequest m_TxRequest;
+  struct TMacRtMhr m_Mhr;
+  uint32_t m_u32RequestTime;
+  uint8_t m_u8ConfirmSlot;
+  uint8_t m_au8Msdu[MAC_RT_MAX_PAYLOAD_SIZE];
+};
+
+struct TMacRtTxQueue {
+  struct TMacRtTxQueueEntry m_aEntries[MAC_RT_TX_QUEUE_SIZE];
+  uint8_t m_u8Head;
+  uint8_t m_u8Count;
+};
+
+// Outstanding request, in request order. Its result is kept until every earlier request has been confirmed.
+struct TMacRtTxConfirmSlot {
+  enum EMacRtStatus m_eStatus;
+  enum ERtModulationType m_eModType;
+  bool m_bDone;
+  bool m_bUpdateTimestamp;
+  // Requests refused after this one because the queue was full, confirmed right after it.
+  uint8_t m_u8Overflows;
+  enum ERtModulationType m_eOverflowModType;
+};
+
+struct TMacRtTxConfirmFifo {
+  struct TMacRtTxConfirmSlot m_aSlots[MAC_RT_TX_CONFIRM_FIFO_SIZE];
+  uint8_t m_u8Head;
+  uint8_t m_u8Count;
+};
+
+// FIFO per priority lane, indexed by enum EMacRtTxLane.
+static struct TMacRtTxQueue g_aTxQueue[MAC_RT_TX_LANES];
+static struct TMacRtTxConfirmFifo g_TxConfirmFifo;
+static struct TMacRtTxQueueStats g_TxQueueStats;
+// Time at which the request in progress was passed to MacRtTxRequest(), and its confirm slot.
+static uint32_t u32TxRequestTime;
+static uint8_t u8TxConfirmSlot;
+// Copy of the MSDU in progress, pointed by pTxData.
+static uint8_t au8TxMsdu[MAC_RT_MAX_PAYLOAD_SIZE];
+
+#if MAC_RT_TX_SEGMENT_RUN_AHEAD
+// Next segment of the frame in progress, built while the current one is sent. It is dropped whenever the frame
+// restarts from its first segment, as retries may change the modulation.
+struct TMacRtTxSegmentAhead {
+  bool m_bValid;
+  uint8_t m_u8TwoRSBlocks;
+  uint16_t m_u16SegmentLength;
+  uint16_t m_u16PhyDataLength;
+  struct TMacRtFrame m_Frame;
+  uint8_t m_au8PhyData[MAC_PHY_MAX_PAYLOAD_LENGTH];
+};
+
+static struct TMacRtTxSegmentAhead g_TxSegmentAhead;
+#endif
+
 static uint16_t Crc16Ccitt(const uint8_t *pu8Data, uint32_t u32Length, uint16_t u16Crc)
 {
   // polynom(16): X16 + X12 + X5 + 1 = 0x1021
-  while (u32Length--) {
-    u16Crc = g_Crc16[(u16Crc >> 8) ^ (*pu8Data ++)] ^ ((u16Crc & 0xFF) << 8);
-  }
-  return u16Crc;
+  return pcrc_crc16_ccitt_update(u16Crc, pu8Data, u32Length);
 }
 
 /*
@@ -543,7 +593,7 @@ static uint8_t * EncodeMhr(struct TMacRtMhr *pHeader, uint8_t *pu8Psdu)
   return pu8End;
 }
 
-static void CalculateTxParameters(void)
+static void ComputeTxParameters(void)
 {
   uint8_t u8Idx = 0;
   uint16_t u16SumToneMapBytes = 0;
@@ -810,6 +860,141 @@ static uint16_t CalculateMaxPhyPayload(struct TPhyParameters *pParameters)
   return u32RsBlock - pParameters->m_u8RsParity;
 }
 
+#if MAC_RT_TX_PARAM_CACHE_SIZE > 0
+// Every input of ComputeTxParameters(). Only byte fields, so it can be compared with memcmp.
+struct TMacRtTxParamKey {
+  uint8_t m_au8TxCoef[6];
+  uint8_t m_u8TxGain;
+  uint8_t m_u8TxRes;
+  uint8_t m_u8ModulationType;
+  uint8_t m_u8ModulationScheme;
+  uint8_t m_u8ForcedModType;
+  uint8_t m_u8ForcedModScheme;
+  uint8_t m_u8TransmitAtten;
+  uint8_t m_u8SpecCompliance;
+  uint8_t m_u8Band;
+  struct TRtToneMap m_ToneMap;
+  struct TRtToneMap m_ForcedToneMap;
+  struct TRtToneMask m_ToneMask;
+};
+
+struct TMacRtTxParamCacheEntry {
+  struct TMacRtTxParamKey m_Key;
+  // Result of ComputeTxParameters(). m_u8Dt is set per request.
+  struct TPlmeSetRequest m_TxParameters;
+  // Segment size results for m_TxParameters, filled by the first segment.
+  struct TPhyParameters m_PhyParams;
+  uint16_t m_u16OneRsLength;
+  uint8_t m_u8AvailableRSBlocks;
+  bool m_bSegmentValid;
+  bool m_bValid;
+  uint32_t m_u32LastUse;
+};
+
+static struct TMacRtTxParamCacheEntry g_aTxParamCache[MAC_RT_TX_PARAM_CACHE_SIZE];
+static uint32_t u32TxParamCacheTick;
+// Entry of the transmission in progress.
+static struct TMacRtTxParamCacheEntry *pTxParamCacheEntry;
+
+static void ResetTxParamCache(void)
+{
+  memset(g_aTxParamCache, 0, sizeof(g_aTxParamCache));
+  u32TxParamCacheTick = 0;
+  pTxParamCacheEntry = NULL;
+}
+#endif
+
+static void CalculateTxParameters(void)
+{
+#if MAC_RT_TX_PARAM_CACHE_SIZE > 0
+  struct TMacRtTxParamKey key;
+  struct TMacRtTxParamCacheEntry *pEntry;
+  struct TMacRtTxParamCacheEntry *pVictim = NULL;
+  uint8_t u8Idx;
+
+  memset(&key, 0, sizeof(key));
+  memcpy(key.m_au8TxCoef, g_MacRt.m_TxRequest.m_au8TxCoef, sizeof(key.m_au8TxCoef));
+  key.m_u8TxGain = g_MacRt.m_TxRequest.m_nTxGain;
+  key.m_u8TxRes = g_MacRt.m_TxRequest.m_nTxRes;
+  key.m_u8ModulationType = (uint8_t)g_MacRt.m_TxRequest.m_eModulationType;
+  key.m_u8ModulationScheme = (uint8_t)g_MacRt.m_TxRequest.m_eModulationScheme;
+  key.m_u8ForcedModType = g_MacRtMib.m_u8ForcedModType;
+  key.m_u8ForcedModScheme = g_MacRtMib.m_u8ForcedModScheme;
+  key.m_u8TransmitAtten = g_MacRtMib.m_u8TransmitAtten;
+  key.m_u8SpecCompliance = u8RtMibSpecCompliance;
+  key.m_u8Band = g_PhyBandInformation.m_u8Band;
+  key.m_ToneMap = g_MacRt.m_TxRequest.m_ToneMap;
+  key.m_ForcedToneMap = g_MacRtMib.m_ForcedToneMap;
+  key.m_ToneMask = g_MacRtMib.m_ToneMask;
+
+  u32TxParamCacheTick ++;
+  for (u8Idx = 0; u8Idx < MAC_RT_TX_PARAM_CACHE_SIZE; u8Idx ++) {
+    pEntry = &g_aTxParamCache[u8Idx];
+    if (pEntry->m_bValid && (memcmp(&pEntry->m_Key, &key, sizeof(key)) == 0)) {
+      // Same neighbour parameters as a previous transmission.
+      pEntry->m_u32LastUse = u32TxParamCacheTick;
+      g_MacRt.m_TxParameters = pEntry->m_TxParameters;
+      g_MacRt.m_TxParameters.m_u8Dt = (g_MacRt.m_TxRequest.m_bRequestAck) ? 1 : 0;
+      pTxParamCacheEntry = pEntry;
+      return;
+    }
+    // Replace a free entry, otherwise the least recently used one.
+    if ((pVictim == NULL) || (pVictim->m_bValid &&
+      (!pEntry->m_bValid || ((u32TxParamCacheTick - pEntry->m_u32LastUse) > (u32TxParamCacheTick - pVictim->m_u32LastUse))))) {
+      pVictim = pEntry;
+    }
+  }
+
+  ComputeTxParameters();
+  pVictim->m_Key = key;
+  pVictim->m_TxParameters = g_MacRt.m_TxParameters;
+  pVictim->m_bSegmentValid = false;
+  pVictim->m_bValid = true;
+  pVictim->m_u32LastUse = u32TxParamCacheTick;
+  pTxParamCacheEntry = pVictim;
+#else
+  ComputeTxParameters();
+#endif
+}
+
+static void CalculateSegmentParameters(struct TPhyParameters *pPhyParams, uint16_t *pu16OneRsLength)
+{
+#if MAC_RT_TX_PARAM_CACHE_SIZE > 0
+  struct TMacRtTxParamCacheEntry *pEntry = pTxParamCacheEntry;
+  struct TPhyTxParameters *pTxParameters = &g_MacRt.m_TxParameters.m_TxParameters;
+  bool bCacheable;
+
+  // Retries may have lowered the modulation, results are only cached for the computed parameters.
+  bCacheable = (pEntry != NULL) &&
+    (pEntry->m_TxParameters.m_TxParameters.m_eModulationType == pTxParameters->m_eModulationType) &&
+    (pEntry->m_TxParameters.m_TxParameters.m_eModulationScheme == pTxParameters->m_eModulationScheme) &&
+    (memcmp(&pEntry->m_TxParameters.m_TxParameters.m_ToneMap, &pTxParameters->m_ToneMap, sizeof(pTxParameters->m_ToneMap)) == 0);
+  if (bCacheable && pEntry->m_bSegmentValid) {
+    *pPhyParams = pEntry->m_PhyParams;
+    *pu16OneRsLength = pEntry->m_u16OneRsLength;
+    u8AvailableRSBlocks = pEntry->m_u8AvailableRSBlocks;
+    return;
+  }
+#endif
+
+  *pPhyParams = CalculatePhyParameters(&g_MacRt.m_TxParameters);
+  u8AvailableRSBlocks = g_PhyBandInformation.m_u8MaxRsBlocks;
+  *pu16OneRsLength = CalculateMaxPhyPayload(pPhyParams);
+  if (*pu16OneRsLength == 0) {
+    // Protection, set Cen-A default value for ROBO
+    *pu16OneRsLength = 133;
+  }
+
+#if MAC_RT_TX_PARAM_CACHE_SIZE > 0
+  if (bCacheable) {
+    pEntry->m_PhyParams = *pPhyParams;
+    pEntry->m_u16OneRsLength = *pu16OneRsLength;
+    pEntry->m_u8AvailableRSBlocks = u8AvailableRSBlocks;
+    pEntry->m_bSegmentValid = true;
+  }
+#endif
+}
+
 static uint16_t EncodeFrame(struct TMacRtFrame *pFrame, uint8_t *pu8Psdu)
 {
   uint8_t *pu8End = pu8Psdu;
@@ -972,48 +1157,232 @@ static uint8_t CalculatePadding(struct TPhyParameters *pParameters, uint16_t u16
   return (u32MaxPdu * u8RsBlocks) - u16FrameLength;
 }
 
-static void CreateNextSegment(void)
+static uint16_t BuildSegment(struct TMacRtFrame *pFrame, uint8_t u8Segment, uint16_t u16Offset, uint16_t *pu16SegmentLength,
+  uint8_t *pu8TwoRSBlocks, uint8_t *pu8PhyData)
 {
-  struct TPhyParameters phyParams = CalculatePhyParameters(&g_MacRt.m_TxParameters);
+  struct TPhyParameters phyParams;
   uint8_t u8Overhead;
   bool bLast;
   uint16_t u16OneRsLength = 0;
   uint8_t u8RsBlocks = 0;
+  uint16_t u16SegmentLength;
 
   // Calculate the payload length.
-  u8AvailableRSBlocks = g_PhyBandInformation.m_u8MaxRsBlocks;
-  u16OneRsLength = CalculateMaxPhyPayload(&phyParams);
-  if (u16OneRsLength == 0) {
-    // Protection, set Cen-A default value for ROBO
-    u16OneRsLength = 133;
-  }
-  g_MacRt.m_u16SegmentLength = u16OneRsLength * u8AvailableRSBlocks;
-  g_MacRt.m_TxFrame.m_Header.m_SegmentControl.m_nSc = g_MacRt.m_u8TxSegment;
+  CalculateSegmentParameters(&phyParams, &u16OneRsLength);
+  u16SegmentLength = u16OneRsLength * u8AvailableRSBlocks;
+  pFrame->m_Header.m_SegmentControl.m_nSc = u8Segment;
   // Subtract MAC header and FCS from the segment length.
-  u8Overhead = CalculateFrameOverhead(&g_MacRt.m_TxFrame);
+  u8Overhead = CalculateFrameOverhead(pFrame);
   // TODO: Segment length can be negative here! We have to handle this case.
-  g_MacRt.m_u16SegmentLength -= u8Overhead;
-  bLast = g_MacRt.m_u16SegmentLength >= (g_MacRt.m_TxRequest.m_u16MsduLength - g_MacRt.m_u16TxOffset);
+  u16SegmentLength -= u8Overhead;
+  bLast = u16SegmentLength >= (g_MacRt.m_TxRequest.m_u16MsduLength - u16Offset);
   if (bLast) {
-    g_MacRt.m_u16SegmentLength = g_MacRt.m_TxRequest.m_u16MsduLength - g_MacRt.m_u16TxOffset;
+    u16SegmentLength = g_MacRt.m_TxRequest.m_u16MsduLength - u16Offset;
   }
   // Fill in segment related info.
-  g_MacRt.m_TxFrame.m_Header.m_SegmentControl.m_nTmr = (bLast && g_MacRt.m_TxRequest.m_bToneMapRequest) ? 1 : 0;
-  g_MacRt.m_TxFrame.m_Header.m_SegmentControl.m_nCc = (bLast) ? 0 : 1;
-  g_MacRt.m_TxFrame.m_Header.m_SegmentControl.m_nLsf = (bLast) ? 1 : 0;
-  g_MacRt.m_TxFrame.m_Header.m_SegmentControl.m_nSl = g_MacRt.m_u16SegmentLength;
+  pFrame->m_Header.m_SegmentControl.m_nTmr = (bLast && g_MacRt.m_TxRequest.m_bToneMapRequest) ? 1 : 0;
+  pFrame->m_Header.m_SegmentControl.m_nCc = (bLast) ? 0 : 1;
+  pFrame->m_Header.m_SegmentControl.m_nLsf = (bLast) ? 1 : 0;
+  pFrame->m_Header.m_SegmentControl.m_nSl = u16SegmentLength;
   // Payload.
-  g_MacRt.m_TxFrame.m_u16PayloadLength = g_MacRt.m_u16SegmentLength;
-  g_MacRt.m_TxFrame.m_pu8Payload = (pTxData + g_MacRt.m_u16TxOffset);
+  pFrame->m_u16PayloadLength = u16SegmentLength;
+  pFrame->m_pu8Payload = (pTxData + u16Offset);
   // Add the padding.
-  u8RsBlocks = (g_MacRt.m_u16SegmentLength + u8Overhead + u16OneRsLength - 1) / u16OneRsLength;
-  g_MacRt.m_TxParameters.m_TxParameters.m_u8TwoRSBlocks = u8RsBlocks - 1;
-  g_MacRt.m_TxFrame.m_u8PadLength = CalculatePadding(&phyParams, g_MacRt.m_u16SegmentLength + u8Overhead, u8RsBlocks);
+  u8RsBlocks = (u16SegmentLength + u8Overhead + u16OneRsLength - 1) / u16OneRsLength;
+  *pu8TwoRSBlocks = u8RsBlocks - 1;
+  pFrame->m_u8PadLength = CalculatePadding(&phyParams, u16SegmentLength + u8Overhead, u8RsBlocks);
+  *pu16SegmentLength = u16SegmentLength;
   // Encode the frame.
-  g_MacRt.m_u16TxPhyDataLength = EncodeFrame(&g_MacRt.m_TxFrame, g_MacRt.m_au8TxPhyData);
+  return EncodeFrame(pFrame, pu8PhyData);
+}
+
+static void CreateNextSegment(void)
+{
+#if MAC_RT_TX_SEGMENT_RUN_AHEAD
+  struct TMacRtTxSegmentAhead *pAhead = &g_TxSegmentAhead;
+
+  if (pAhead->m_bValid) {
+    // Already built while the previous segment was sent.
+    pAhead->m_bValid = false;
+    g_MacRt.m_TxFrame = pAhead->m_Frame;
+    g_MacRt.m_u16SegmentLength = pAhead->m_u16SegmentLength;
+    g_MacRt.m_TxParameters.m_TxParameters.m_u8TwoRSBlocks = pAhead->m_u8TwoRSBlocks;
+    memcpy(g_MacRt.m_au8TxPhyData, pAhead->m_au8PhyData, pAhead->m_u16PhyDataLength);
+    g_MacRt.m_u16TxPhyDataLength = pAhead->m_u16PhyDataLength;
+    g_MacRt.m_u16TxFcs = g_MacRt.m_TxFrame.m_u16Fcs;
+    return;
+  }
+#endif
+  g_MacRt.m_u16TxPhyDataLength = BuildSegment(&g_MacRt.m_TxFrame, g_MacRt.m_u8TxSegment, g_MacRt.m_u16TxOffset,
+    &g_MacRt.m_u16SegmentLength, &g_MacRt.m_TxParameters.m_TxParameters.m_u8TwoRSBlocks, g_MacRt.m_au8TxPhyData);
   g_MacRt.m_u16TxFcs = g_MacRt.m_TxFrame.m_u16Fcs;
 }
 
+#if MAC_RT_TX_SEGMENT_RUN_AHEAD
+static void CreateSegmentAhead(void)
+{
+  struct TMacRtTxSegmentAhead *pAhead = &g_TxSegmentAhead;
+
+  // The segment in progress keeps its own buffer, it may still be retried.
+  if (pAhead->m_bValid || g_MacRt.m_TxFrame.m_Header.m_SegmentControl.m_nLsf) {
+    return;
+  }
+  pAhead->m_Frame = g_MacRt.m_TxFrame;
+  pAhead->m_u16PhyDataLength = BuildSegment(&pAhead->m_Frame, g_MacRt.m_u8TxSegment + 1,
+    g_MacRt.m_u16TxOffset + g_MacRt.m_u16SegmentLength, &pAhead->m_u16SegmentLength, &pAhead->m_u8TwoRSBlocks,
+    pAhead->m_au8PhyData);
+  pAhead->m_bValid = true;
+}
+#endif
+
+static void ResetTxQueue(void)
+{
+  memset(g_aTxQueue, 0, sizeof(g_aTxQueue));
+  memset(&g_TxConfirmFifo, 0, sizeof(g_TxConfirmFifo));
+  memset(&g_TxQueueStats, 0, sizeof(g_TxQueueStats));
+#if MAC_RT_TX_SEGMENT_RUN_AHEAD
+  g_TxSegmentAhead.m_bValid = false;
+#endif
+}
+
+static uint8_t GetTxQueueDepth(void)
+{
+  return g_aTxQueue[MAC_RT_TX_LANE_HIGH_PRIORITY].m_u8Count + g_aTxQueue[MAC_RT_TX_LANE_NORMAL_PRIORITY].m_u8Count;
+}
+
+static uint8_t AllocTxConfirmSlot(void)
+{
+  struct TMacRtTxConfirmFifo *pFifo = &g_TxConfirmFifo;
+  uint8_t u8Slot = (pFifo->m_u8Head + pFifo->m_u8Count) % MAC_RT_TX_CONFIRM_FIFO_SIZE;
+
+  memset(&pFifo->m_aSlots[u8Slot], 0, sizeof(struct TMacRtTxConfirmSlot));
+  pFifo->m_u8Count ++;
+  return u8Slot;
+}
+
+static void DeliverTxConfirms(void)
+{
+  struct TMacRtTxConfirmFifo *pFifo = &g_TxConfirmFifo;
+  struct TMacRtTxConfirmSlot slot;
+
+  while ((pFifo->m_u8Count > 0) && pFifo->m_aSlots[pFifo->m_u8Head].m_bDone) {
+    // Release the slot first, the confirm callback may issue a new request.
+    slot = pFifo->m_aSlots[pFifo->m_u8Head];
+    pFifo->m_u8Head = (pFifo->m_u8Head + 1) % MAC_RT_TX_CONFIRM_FIFO_SIZE;
+    pFifo->m_u8Count --;
+    if (g_mac_rt_notifications.m_pMacRtTxConfirm != NULL) {
+      g_mac_rt_notifications.m_pMacRtTxConfirm(slot.m_eStatus, slot.m_bUpdateTimestamp, slot.m_eModType);
+      while (slot.m_u8Overflows > 0) {
+        slot.m_u8Overflows --;
+        g_mac_rt_notifications.m_pMacRtTxConfirm(MAC_RT_STATUS_TRANSACTION_OVERFLOW, false, slot.m_eOverflowModType);
+      }
+    }
+  }
+}
+
+static void LoadTxRequest(struct TMacRtTxRequest *pTxRequest, struct TMacRtMhr *pMhr, uint32_t u32RequestTime,
+  uint8_t u8ConfirmSlot)
+{
+  memcpy(&g_MacRt.m_TxRequest, pTxRequest, sizeof(struct TMacRtTxRequest));
+  memcpy(au8TxMsdu, pTxRequest->m_pMsdu, pTxRequest->m_u16MsduLength);
+  g_MacRt.m_TxRequest.m_pMsdu = au8TxMsdu;
+  pTxData = au8TxMsdu;
+  memcpy(&g_MacRt.m_TxFrame.m_Header, pMhr, sizeof(struct TMacRtMhr));
+  u32TxRequestTime = u32RequestTime;
+  u8TxConfirmSlot = u8ConfirmSlot;
+  g_MacRt.m_bTxRequest = true;
+  g_MacRt.m_eTxState = MAC_RT_TX_START;
+#if MAC_RT_TX_SEGMENT_RUN_AHEAD
+  g_TxSegmentAhead.m_bValid = false;
+#endif
+}
+
+static void EnqueueTxRequest(struct TMacRtTxRequest *pTxRequest, struct TMacRtMhr *pMhr, uint32_t u32RequestTime)
+{
+  struct TMacRtTxQueue *pQueue;
+  struct TMacRtTxQueueEntry *pEntry;
+  struct TMacRtTxConfirmSlot *pTail;
+  uint8_t u8Depth;
+
+  pQueue = &g_aTxQueue[pTxRequest->m_bHighPriority ? MAC_RT_TX_LANE_HIGH_PRIORITY : MAC_RT_TX_LANE_NORMAL_PRIORITY];
+  if ((pQueue->m_u8Count >= MAC_RT_TX_QUEUE_SIZE) || (g_TxConfirmFifo.m_u8Count >= MAC_RT_TX_CONFIRM_FIFO_SIZE)) {
+    // Refused. It is confirmed right after the last outstanding request, which keeps the confirm order and
+    // does not re-enter the upper layer from here. There is always one, as the request in progress is.
+    g_TxQueueStats.m_u32OverflowCount ++;
+    pTail = &g_TxConfirmFifo.m_aSlots[(g_TxConfirmFifo.m_u8Head + g_TxConfirmFifo.m_u8Count - 1) % MAC_RT_TX_CONFIRM_FIFO_SIZE];
+    pTail->m_eOverflowModType = pTxRequest->m_eModulationType;
+    if (pTail->m_u8Overflows < 0xFF) {
+      pTail->m_u8Overflows ++;
+    }
+    return;
+  }
+  pEntry = &pQueue->m_aEntries[(pQueue->m_u8Head + pQueue->m_u8Count) % MAC_RT_TX_QUEUE_SIZE];
+  memcpy(&pEntry->m_TxRequest, pTxRequest, sizeof(struct TMacRtTxRequest));
+  memcpy(pEntry->m_au8Msdu, pTxRequest->m_pMsdu, pTxRequest->m_u16MsduLength);
+  pEntry->m_TxRequest.m_pMsdu = pEntry->m_au8Msdu;
+  memcpy(&pEntry->m_Mhr, pMhr, sizeof(struct TMacRtMhr));
+  pEntry->m_u32RequestTime = u32RequestTime;
+  pEntry->m_u8ConfirmSlot = AllocTxConfirmSlot();
+  pQueue->m_u8Count ++;
+  u8Depth = GetTxQueueDepth();
+  if (u8Depth > g_TxQueueStats.m_u8MaxDepth) {
+    g_TxQueueStats.m_u8MaxDepth = u8Depth;
+  }
+}
+
+static bool DequeueTxRequest(void)
+{
+  struct TMacRtTxQueue *pQueue;
+  struct TMacRtTxQueueEntry *pEntry;
+  uint8_t u8Lane;
+
+  // High priority lane first. A frame in progress is never preempted.
+  for (u8Lane = 0; u8Lane < MAC_RT_TX_LANES; u8Lane ++) {
+    pQueue = &g_aTxQueue[u8Lane];
+    if (pQueue->m_u8Count > 0) {
+      pEntry = &pQueue->m_aEntries[pQueue->m_u8Head];
+      LoadTxRequest(&pEntry->m_TxRequest, &pEntry->m_Mhr, pEntry->m_u32RequestTime, pEntry->m_u8ConfirmSlot);
+      pQueue->m_u8Head = (pQueue->m_u8Head + 1) % MAC_RT_TX_QUEUE_SIZE;
+      pQueue->m_u8Count --;
+      return true;
+    }
+  }
+  return false;
+}
+
+static void StartTxRequest(void)
+{
+  // Initialize transmission.
+  g_MacRt.m_eTxState = MAC_RT_TX_CSMA_CA;
+  g_MacRt.m_u8TxRetries = 0;
+  g_MacRt.m_u16Nb = 0;
+  g_MacRt.m_u32Nbf = 0;
+  CalculateTxParameters();
+}
+
+static void ConfirmTxRequest(enum EMacRtStatus eStatus, bool bUpdateTimestamp)
+{
+  struct TMacRtTxConfirmSlot *pSlot = &g_TxConfirmFifo.m_aSlots[u8TxConfirmSlot];
+  uint32_t u32ServiceTime = PhyGetTime() - u32TxRequestTime;
+
+  g_MacRt.m_bTxRequest = false;
+  pSlot->m_eStatus = eStatus;
+  pSlot->m_bUpdateTimestamp = bUpdateTimestamp;
+  pSlot->m_eModType = (enum ERtModulationType)g_MacRt.m_TxParameters.m_TxParameters.m_eModulationType;
+  pSlot->m_bDone = true;
+  g_TxQueueStats.m_u32ConfirmCount ++;
+  g_TxQueueStats.m_u32LastServiceTime = u32ServiceTime;
+  if (u32ServiceTime > g_TxQueueStats.m_u32MaxServiceTime) {
+    g_TxQueueStats.m_u32MaxServiceTime = u32ServiceTime;
+  }
+  // Start the next queued frame before the confirm is delivered, so that its parameters and first segment
+  // are ready in this same pass instead of waiting for the upper layer to react.
+  if (DequeueTxRequest()) {
+    StartTxRequest();
+  }
+  DeliverTxConfirms();
+}
+
 //#define PRINT_MAC_TEST_VECTORS
 
 static void RequestTransmission(uint32_t u32Time)
@@ -1038,6 +1407,10 @@ static void RequestTransmission(uint32_t u32Time)
 #endif
   PhyPlmeSetRequest(&g_MacRt.m_TxParameters);
   PhyPdDataRequest(&request);
+#if MAC_RT_TX_SEGMENT_RUN_AHEAD
+  // Build the next segment while this one is in the air.
+  CreateSegmentAhead();
+#endif
 }
 
 static void ProcessTxRequest(void)
@@ -1050,27 +1423,16 @@ static void ProcessTxRequest(void)
 
   // Check if a tx was requested.
   if (g_MacRt.m_bTxRequest && (g_MacRt.m_eTxState == MAC_RT_TX_START)) {
-    // Initialize transmission.
-    g_MacRt.m_eTxState = MAC_RT_TX_CSMA_CA;
-    g_MacRt.m_u8TxRetries = 0;
-    g_MacRt.m_u16Nb = 0;
-    g_MacRt.m_u32Nbf = 0;
-    CalculateTxParameters();
+    StartTxRequest();
   }
   if (g_MacRt.m_bTxRequest && (g_MacRt.m_eTxState == MAC_RT_TX_ABORT)) {
     // Unknown error, abort.
-    g_MacRt.m_bTxRequest = false;
-    if (g_mac_rt_notifications.m_pMacRtTxConfirm != NULL) {
-      g_mac_rt_notifications.m_pMacRtTxConfirm(MAC_RT_STATUS_DENIED, false, (enum ERtModulationType)g_MacRt.m_TxParameters.m_TxParameters.m_eModulationType);
-    }
+    ConfirmTxRequest(MAC_RT_STATUS_DENIED, false);
   }
   if (g_MacRt.m_bTxRequest && (g_MacRt.m_eTxState == MAC_RT_TX_BIG_FAIL)) {
     if (g_MacRt.m_u8TxRetries >= g_MacRtMib.m_u8MaxFrameRetries) {
       // Too many retries, abort.
-      g_MacRt.m_bTxRequest = false;
-      if (g_mac_rt_notifications.m_pMacRtTxConfirm != NULL) {
-        g_mac_rt_notifications.m_pMacRtTxConfirm(MAC_RT_STATUS_NO_ACK, false, (enum ERtModulationType)g_MacRt.m_TxParameters.m_TxParameters.m_eModulationType);
-      }
+      ConfirmTxRequest(MAC_RT_STATUS_NO_ACK, false);
     }
     else {
       g_MacRt.m_u8TxRetries ++;
@@ -1126,12 +1488,9 @@ static void ProcessTxRequest(void)
   if (g_MacRt.m_bTxRequest && (g_MacRt.m_eTxState == MAC_RT_TX_LITTLE_FAIL)) {
     if (g_MacRt.m_u8TxRetries >= g_MacRtMib.m_u8MaxFrameRetries) {
       // Too many retries, abort.
-      g_MacRt.m_bTxRequest = false;
       // Go from CIFS_RETRANSMIT to normal CIFS.
       g_MacRt.m_eState = MAC_RT_CIFS;
-      if (g_mac_rt_notifications.m_pMacRtTxConfirm != NULL) {
-        g_mac_rt_notifications.m_pMacRtTxConfirm(MAC_RT_STATUS_NO_ACK, false, (enum ERtModulationType)g_MacRt.m_TxParameters.m_TxParameters.m_eModulationType);
-      }
+      ConfirmTxRequest(MAC_RT_STATUS_NO_ACK, false);
     }
     else {
       g_MacRt.m_u8TxRetries ++;
@@ -1161,10 +1520,7 @@ static void ProcessTxRequest(void)
       }
       LOG_DBG(Log("Updated CW %u", g_MacRt.m_u32Cw));
       // Frame transmission terminated.
-      g_MacRt.m_bTxRequest = false;
-      if (g_mac_rt_notifications.m_pMacRtTxConfirm != NULL) {
-        g_mac_rt_notifications.m_pMacRtTxConfirm(MAC_RT_STATUS_SUCCESS, false, (enum ERtModulationType)g_MacRt.m_TxParameters.m_TxParameters.m_eModulationType);
-      }
+      ConfirmTxRequest(MAC_RT_STATUS_SUCCESS, false);
     }
   }
   if (g_MacRt.m_bTxRequest && (g_MacRt.m_eTxState == MAC_RT_TX_FAIL_CSMA_CA)) {
@@ -1203,10 +1559,7 @@ static void ProcessTxRequest(void)
 
 
       // Backoff limit reached, abort.
-      g_MacRt.m_bTxRequest = false;
-      if (g_mac_rt_notifications.m_pMacRtTxConfirm != NULL) {
-        g_mac_rt_notifications.m_pMacRtTxConfirm(MAC_RT_STATUS_CHANNEL_ACCESS_FAILURE, false, (enum ERtModulationType)g_MacRt.m_TxParameters.m_TxParameters.m_eModulationType);
-      }
+      ConfirmTxRequest(MAC_RT_STATUS_CHANNEL_ACCESS_FAILURE, false);
     }
     else {
       g_MacRt.m_eTxState = MAC_RT_TX_CSMA_CA;
@@ -1217,6 +1570,9 @@ static void ProcessTxRequest(void)
     g_MacRt.m_eTxState = MAC_RT_TX_WAIT_SEND;
     g_MacRt.m_u8TxSegment = 0;
     g_MacRt.m_u16TxOffset = 0;
+#if MAC_RT_TX_SEGMENT_RUN_AHEAD
+    g_TxSegmentAhead.m_bValid = false;
+#endif
     CreateNextSegment();
     CalculateCsmaCaBackoff();
   }
@@ -1263,20 +1619,38 @@ static void ProcessTxRequest(void)
 void MacRtTxRequest(struct TMacRtTxRequest *pTxRequest, struct TMacRtMhr *pMhr)
 {
   if (pTxRequest->m_u16MsduLength <= MAC_RT_MAX_PAYLOAD_SIZE) {
-    pTxData = pTxRequest->m_pMsdu;
-    memcpy(&g_MacRt.m_TxRequest, pTxRequest, sizeof(struct TMacRtTxRequest));
-    memcpy(&g_MacRt.m_TxFrame.m_Header, pMhr, sizeof(struct TMacRtMhr));
-    g_MacRt.m_bTxRequest = true;
-    g_MacRt.m_eTxState = MAC_RT_TX_START;
+    if (!g_MacRt.m_bTxRequest) {
+      LoadTxRequest(pTxRequest, pMhr, PhyGetTime(), AllocTxConfirmSlot());
+    }
+    else {
+      EnqueueTxRequest(pTxRequest, pMhr, PhyGetTime());
+    }
   }
 }
 
+void MacRtGetTxQueueStats(struct TMacRtTxQueueStats *pStats)
+{
+  *pStats = g_TxQueueStats;
+  pStats->m_u8HighPriorityDepth = g_aTxQueue[MAC_RT_TX_LANE_HIGH_PRIORITY].m_u8Count;
+  pStats->m_u8NormalPriorityDepth = g_aTxQueue[MAC_RT_TX_LANE_NORMAL_PRIORITY].m_u8Count;
+}
+
+void MacRtClearTxQueueStats(void)
+{
+  memset(&g_TxQueueStats, 0, sizeof(g_TxQueueStats));
+  g_TxQueueStats.m_u8MaxDepth = GetTxQueueDepth();
+}
+
 void MacRtResetRequest(bool bResetMib)
 {
   if (bResetMib) {
     MacRtMibReset();
   }
   g_MacRt = g_MacRtDefaults;
+#if MAC_RT_TX_PARAM_CACHE_SIZE > 0
+  ResetTxParamCache();
+#endif
+  ResetTxQueue();
   g_MacRt.m_u32Cw = (1 << g_MacRtMib.m_u8MinBe);
   LOG_DBG(Log("Initialization of CW %u", g_MacRt.m_u32Cw));
   PhyPlmeResetRequest();
@@ -1293,6 +1667,89 @@ uint32_t MacRtGetPhyTime(void)
   return PhyGetTime();
 }
 
+#ifdef MAC_RT_CONTEXT_SWITCH
+// Per instance state, so that a host build can run several MAC RT instances over a simulated PHY.
+// Band constants are shared, all instances must use the same band.
+struct TMacRtContext {
+  struct TMacRtData m_MacRt;
+  struct TMacRtMib m_MacRtMib;
+  struct TMacRtNotifications m_Notifications;
+  uint8_t *m_pTxData;
+  uint8_t m_u8AvailableRSBlocks;
+  uint8_t m_au8Gain[PHY_MAX_TONE_GROUPS];
+  uint8_t m_u8SpecCompliance;
+#if MAC_RT_TX_PARAM_CACHE_SIZE > 0
+  struct TMacRtTxParamCacheEntry m_aTxParamCache[MAC_RT_TX_PARAM_CACHE_SIZE];
+  uint32_t m_u32TxParamCacheTick;
+  struct TMacRtTxParamCacheEntry *m_pTxParamCacheEntry;
+#endif
+  struct TMacRtTxQueue m_aTxQueue[MAC_RT_TX_LANES];
+  struct TMacRtTxQueueStats m_TxQueueStats;
+  struct TMacRtTxConfirmFifo m_TxConfirmFifo;
+  uint32_t m_u32TxRequestTime;
+  uint8_t m_u8TxConfirmSlot;
+  uint8_t m_au8TxMsdu[MAC_RT_MAX_PAYLOAD_SIZE];
+};
+
+uint32_t MacRtGetContextSize(void)
+{
+  return sizeof(struct TMacRtContext);
+}
+
+void MacRtSaveContext(void *pContext)
+{
+  struct TMacRtContext *pCtx = (struct TMacRtContext *)pContext;
+
+  pCtx->m_MacRt = g_MacRt;
+  pCtx->m_MacRtMib = g_MacRtMib;
+  pCtx->m_Notifications = g_mac_rt_notifications;
+  pCtx->m_pTxData = pTxData;
+  pCtx->m_u8AvailableRSBlocks = u8AvailableRSBlocks;
+  memcpy(pCtx->m_au8Gain, au8Gain, sizeof(au8Gain));
+  pCtx->m_u8SpecCompliance = u8RtMibSpecCompliance;
+#if MAC_RT_TX_PARAM_CACHE_SIZE > 0
+  memcpy(pCtx->m_aTxParamCache, g_aTxParamCache, sizeof(g_aTxParamCache));
+  pCtx->m_u32TxParamCacheTick = u32TxParamCacheTick;
+  pCtx->m_pTxParamCacheEntry = pTxParamCacheEntry;
+#endif
+  memcpy(pCtx->m_aTxQueue, g_aTxQueue, sizeof(g_aTxQueue));
+  pCtx->m_TxQueueStats = g_TxQueueStats;
+  pCtx->m_TxConfirmFifo = g_TxConfirmFifo;
+  pCtx->m_u32TxRequestTime = u32TxRequestTime;
+  pCtx->m_u8TxConfirmSlot = u8TxConfirmSlot;
+  memcpy(pCtx->m_au8TxMsdu, au8TxMsdu, sizeof(au8TxMsdu));
+}
+
+void MacRtRestoreContext(const void *pContext)
+{
+  const struct TMacRtContext *pCtx = (const struct TMacRtContext *)pContext;
+
+  g_MacRt = pCtx->m_MacRt;
+  g_MacRtMib = pCtx->m_MacRtMib;
+  g_mac_rt_notifications = pCtx->m_Notifications;
+  pTxData = pCtx->m_pTxData;
+  u8AvailableRSBlocks = pCtx->m_u8AvailableRSBlocks;
+  memcpy(au8Gain, pCtx->m_au8Gain, sizeof(au8Gain));
+  u8RtMibSpecCompliance = pCtx->m_u8SpecCompliance;
+#if MAC_RT_TX_PARAM_CACHE_SIZE > 0
+  // The cache entry pointer refers to g_aTxParamCache, which is restored in place.
+  memcpy(g_aTxParamCache, pCtx->m_aTxParamCache, sizeof(g_aTxParamCache));
+  u32TxParamCacheTick = pCtx->m_u32TxParamCacheTick;
+  pTxParamCacheEntry = pCtx->m_pTxParamCacheEntry;
+#endif
+  memcpy(g_aTxQueue, pCtx->m_aTxQueue, sizeof(g_aTxQueue));
+  g_TxQueueStats = pCtx->m_TxQueueStats;
+  g_TxConfirmFifo = pCtx->m_TxConfirmFifo;
+  u32TxRequestTime = pCtx->m_u32TxRequestTime;
+  u8TxConfirmSlot = pCtx->m_u8TxConfirmSlot;
+  memcpy(au8TxMsdu, pCtx->m_au8TxMsdu, sizeof(au8TxMsdu));
+#if MAC_RT_TX_SEGMENT_RUN_AHEAD
+  // Not kept per instance, the segment is built again.
+  g_TxSegmentAhead.m_bValid = false;
+#endif
+}
+#endif
+
 static void MacCbPhyPdDataConfirm(struct TPdDataConfirm *pParameters)
 {
   LOG_INFO(Log("PdDataConfirm. Status: %u; Time: %u", pParameters->m_eStatus, pParameters->m_u32Time));
@@ -1325,10 +1782,7 @@ static void MacCbPhyPdDataConfirm(struct TPdDataConfirm *pParameters)
         break;
       case PHY_STATUS_BUSY_TX:
         // This should not happen, abort transmission.
-        g_MacRt.m_bTxRequest = false;
-        if (g_mac_rt_notifications.m_pMacRtTxConfirm != NULL) {
-          g_mac_rt_notifications.m_pMacRtTxConfirm(MAC_RT_STATUS_TRANSACTION_OVERFLOW, true, (enum ERtModulationType)g_MacRt.m_TxParameters.m_TxParameters.m_eModulationType);
-        }
+        ConfirmTxRequest(MAC_RT_STATUS_TRANSACTION_OVERFLOW, true);
         break;
       case PHY_STATUS_SUCCESS:
         // Success, now wait for ACK or go to the next step.
@@ -1545,6 +1999,10 @@ void MacRtInitialize(uint8_t u8Band, struct TMacRtNotifications *pNotifications,
 
   g_mac_rt_notifications = *pNotifications;
   g_MacRt = g_MacRtDefaults;
+#if MAC_RT_TX_PARAM_CACHE_SIZE > 0
+  ResetTxParamCache();
+#endif
+  ResetTxQueue();
   g_MacRt.m_u32Cw = (1 << g_MacRtMib.m_u8MinBe);
   PhyInitialize(&g_MacPhyNotifications, u8Band);
   g_MacRt.m_u32ChangeTime = PhyGetTime();
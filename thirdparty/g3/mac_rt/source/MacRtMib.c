@@ -1,6 +1,7 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <MacPhyInterface.h>
+#include <MacRt.h>
 #include <MacRtMib.h>
 #include <MacRtConstants.h>
 #include <MacRtVersion.h>
@@ -553,6 +554,28 @@ static enum EMacRtStatus MacPibGetMacRtInternalVersion(struct TMacRtPibValue *pV
   return MAC_RT_STATUS_SUCCESS;
 }
 
+static enum EMacRtStatus MacPibGetTxQueueStats(struct TMacRtPibValue *pValue)
+{
+  struct TMacRtTxQueueStats stats;
+
+  MacRtGetTxQueueStats(&stats);
+  pValue->m_u8Length = sizeof(struct TMacRtTxQueueStats);
+  memcpy(pValue->m_au8Value, &stats, pValue->m_u8Length);
+  return MAC_RT_STATUS_SUCCESS;
+}
+
+static enum EMacRtStatus MacPibSetTxQueueStats(const struct TMacRtPibValue *pValue)
+{
+  enum EMacRtStatus eStatus = MAC_RT_STATUS_SUCCESS;
+  if (pValue->m_u8Length == sizeof(struct TMacRtTxQueueStats)) {
+    MacRtClearTxQueueStats();
+  }
+  else {
+    eStatus = MAC_RT_STATUS_INVALID_PARAMETER;
+  }
+  return eStatus;
+}
+
 static enum EMacRtStatus MacPibGetAllRtMib(struct TMacRtPibValue *pValue)
 {
   pValue->m_u8Length = sizeof(struct TMacRtMib);
@@ -814,6 +837,9 @@ enum EMacRtStatus MacRtGetRequestSync(enum EMacRtPibAttribute eAttribute, uint16
       case MAC_RT_PIB_MANUF_MAC_RT_INTERNAL_VERSION:
         eStatus = MacPibGetMacRtInternalVersion(pValue);
         break;
+      case MAC_RT_PIB_MANUF_TX_QUEUE_STATS:
+        eStatus = MacPibGetTxQueueStats(pValue);
+        break;
       case MAC_RT_PIB_GET_SET_ALL_MIB:
         eStatus = MacPibGetAllRtMib(pValue);
         break;
@@ -918,6 +944,9 @@ enum EMacRtStatus MacRtSetRequestSync(enum EMacRtPibAttribute eAttribute, uint16
       case MAC_RT_PIB_MANUF_RETRIES_LEFT_TO_FORCE_ROBO:
         eStatus = MacPibSetRetriesToForceRobo(pValue);
         break;
+      case MAC_RT_PIB_MANUF_TX_QUEUE_STATS:
+        eStatus = MacPibSetTxQueueStats(pValue);
+        break;
       case MAC_RT_PIB_GET_SET_ALL_MIB:
         eStatus = MacPibSetAllRtMib(pValue);
         break;
@@ -0,0 +1,10 @@
+#ifndef HAL_H_INCLUDED
+#define HAL_H_INCLUDED
+
+#include <stdint.h>
+
+#define UNUSED(v) (void)(v)
+
+uint32_t platform_random_32(void);
+
+#endif
@@ -0,0 +1,8 @@
+#ifndef PCRC_H_INCLUDED
+#define PCRC_H_INCLUDED
+
+#include <stdint.h>
+
+uint16_t pcrc_crc16_ccitt_update(uint16_t us_crc, const uint8_t *puc_buf, uint32_t ul_len);
+
+#endif
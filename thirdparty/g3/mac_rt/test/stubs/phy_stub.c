@@ -0,0 +1,98 @@
+/* PHY and platform stubs for the MAC RT host tests */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <hal/hal.h>
+#include <pcrc.h>
+#include "phy_stub.h"
+
+uint32_t g_u32PhyStubTime;
+uint32_t g_u32PhyStubDataRequests;
+void (*g_pPhyStubDataRequest)(struct TPdDataRequest *pParameters);
+
+uint32_t platform_random_32(void)
+{
+	return (uint32_t)rand();
+}
+
+uint16_t pcrc_crc16_ccitt_update(uint16_t us_crc, const uint8_t *puc_buf, uint32_t ul_len)
+{
+	uint8_t uc_bit;
+
+	while (ul_len--) {
+		us_crc ^= (uint16_t)(*puc_buf++) << 8;
+		for (uc_bit = 0; uc_bit < 8; uc_bit++) {
+			us_crc = (us_crc & 0x8000) ? (uint16_t)((us_crc << 1) ^ 0x1021) : (uint16_t)(us_crc << 1);
+		}
+	}
+
+	return us_crc;
+}
+
+void PhyEventHandler(void)
+{
+}
+
+uint8_t PhyGetLegacyMode(void)
+{
+	return 0;
+}
+
+uint8_t PhyGetPIBLen(uint16_t us_id)
+{
+	return 0;
+}
+
+enum EPhyGetSetResult PhyGetParam(uint16_t us_id, void *p_val, uint16_t us_len)
+{
+	memset(p_val, 0, us_len);
+	return PHY_GETSET_RESULT_OK;
+}
+
+enum EPhyGetSetResult PhySetParam(uint16_t us_id, void *p_val, uint16_t us_len)
+{
+	return PHY_GETSET_RESULT_OK;
+}
+
+uint32_t PhyGetTime(void)
+{
+	return g_u32PhyStubTime;
+}
+
+void PhyGetToneMapResponseData(struct TPlmeGetToneMapResponseData *pParameters)
+{
+}
+
+void PhyInitialize(struct TPhyNotifications *pNotifications, uint8_t u8Band)
+{
+}
+
+void PhyPdAckRequest(struct TPdAckRequest *pParameters)
+{
+}
+
+void PhyPdDataRequest(struct TPdDataRequest *pParameters)
+{
+	g_u32PhyStubDataRequests++;
+	if (g_pPhyStubDataRequest != NULL) {
+		g_pPhyStubDataRequest(pParameters);
+	}
+}
+
+void PhyPlmeGetRequest(struct TPlmeGetRequest *pParameters)
+{
+}
+
+void PhyPlmeResetRequest(void)
+{
+}
+
+void PhyPlmeSetRequest(struct TPlmeSetRequest *pParameters)
+{
+}
+
+void PhySetToneMask(uint8_t *pu8ToneMask)
+{
+}
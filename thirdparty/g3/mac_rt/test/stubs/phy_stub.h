@@ -0,0 +1,13 @@
+#ifndef PHY_STUB_H_INCLUDED
+#define PHY_STUB_H_INCLUDED
+
+#include <stdint.h>
+#include <MacPhyInterface.h>
+
+/* PHY time, advanced by the test */
+extern uint32_t g_u32PhyStubTime;
+/* Number of PhyPdDataRequest() calls, and optional hook to inspect them */
+extern uint32_t g_u32PhyStubDataRequests;
+extern void (*g_pPhyStubDataRequest)(struct TPdDataRequest *pParameters);
+
+#endif
@@ -0,0 +1,249 @@
+/**
+ * \file
+ *
+ * \brief Host test of the MAC RT TX parameter cache.
+ *
+ * Random requests from a few neighbours, with random MIB, band and retry
+ * (lowered modulation) changes in between, must give the same PLME set
+ * request and segment parameters through the cache as computed from
+ * scratch. Also times both paths for a steady set of neighbours.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../source/MacRt.c"
+#include "phy_stub.h"
+
+#define NEIGHBOURS       8
+#define ITERATIONS       500000
+#define BENCH_TX         2000000
+
+static int si_failures;
+
+#define CHECK(cond) do { \
+		if (!(cond)) { \
+			printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+			si_failures++; \
+		} \
+	} while (0)
+
+static struct TMacRtTxRequest sx_neighbours[NEIGHBOURS];
+
+static void _random_request(struct TMacRtTxRequest *px_req)
+{
+	uint8_t uc_i;
+
+	memset(px_req, 0, sizeof(*px_req));
+	for (uc_i = 0; uc_i < sizeof(px_req->m_au8TxCoef); uc_i++) {
+		px_req->m_au8TxCoef[uc_i] = (uint8_t)rand();
+	}
+
+	px_req->m_nTxGain = rand() & 0x0F;
+	px_req->m_nTxRes = rand() & 0x01;
+	px_req->m_eModulationType = (enum ERtModulationType)(rand() % 4);
+	px_req->m_eModulationScheme = (enum ERtModulationScheme)(rand() % 2);
+	for (uc_i = 0; uc_i < sizeof(px_req->m_ToneMap.m_au8Tm); uc_i++) {
+		px_req->m_ToneMap.m_au8Tm[uc_i] = (uint8_t)rand();
+	}
+
+	if ((px_req->m_ToneMap.m_au8Tm[0] | px_req->m_ToneMap.m_au8Tm[1] | px_req->m_ToneMap.m_au8Tm[2]) == 0) {
+		px_req->m_ToneMap.m_au8Tm[0] = 1;
+	}
+
+	px_req->m_DstAddr.m_eAddrMode = MAC_RT_ADDRESS_MODE_SHORT;
+}
+
+/* Retries lower the modulation as the TX path does */
+static void _lower_modulation(int i_mode)
+{
+	struct TPhyTxParameters *px_tx = &g_MacRt.m_TxParameters.m_TxParameters;
+
+	if (i_mode == 1) {
+		px_tx->m_eModulationType = PHY_MODULATION_ROBUST;
+		memcpy(&px_tx->m_ToneMap, &g_RtToneMapDefault, sizeof(struct TPhyToneMap));
+	} else if ((i_mode == 2) && (px_tx->m_eModulationType > PHY_MODULATION_DBPSK_BPSK)) {
+		px_tx->m_eModulationType = PHY_MODULATION_DBPSK_BPSK;
+	}
+}
+
+static bool _same_set_request(const struct TPlmeSetRequest *px_a, const struct TPlmeSetRequest *px_b)
+{
+	const struct TPhyTxParameters *px_x = &px_a->m_TxParameters;
+	const struct TPhyTxParameters *px_y = &px_b->m_TxParameters;
+
+	return (px_a->m_u8Dt == px_b->m_u8Dt) && (px_x->m_u8TxPower == px_y->m_u8TxPower) &&
+			(px_x->m_eModulationType == px_y->m_eModulationType) &&
+			(px_x->m_eModulationScheme == px_y->m_eModulationScheme) &&
+			!memcmp(&px_x->m_ToneMap, &px_y->m_ToneMap, sizeof(px_x->m_ToneMap)) &&
+			!memcmp(&px_x->m_PreEmphasis, &px_y->m_PreEmphasis, sizeof(px_x->m_PreEmphasis)) &&
+			!memcmp(&px_x->m_ToneMask, &px_y->m_ToneMask, sizeof(px_x->m_ToneMask)) &&
+			(px_x->m_u8TwoRSBlocks == px_y->m_u8TwoRSBlocks);
+}
+
+/* Uncached path, as before the cache */
+static void _compute_from_scratch(struct TPhyParameters *px_phy, uint16_t *pus_one_rs_length)
+{
+	*px_phy = CalculatePhyParameters(&g_MacRt.m_TxParameters);
+	u8AvailableRSBlocks = g_PhyBandInformation.m_u8MaxRsBlocks;
+	*pus_one_rs_length = CalculateMaxPhyPayload(px_phy);
+	if (*pus_one_rs_length == 0) {
+		*pus_one_rs_length = 133;
+	}
+}
+
+/* Random MIB or neighbour change, now and then */
+static void _random_change(void)
+{
+	static const uint8_t auc_bands[] = {0, 1, 2, 3};
+
+	switch (rand() % 1000) {
+	case 0:
+		MacRtConstantsInitialize(auc_bands[rand() % 4], NULL);
+		break;
+
+	case 1:
+		g_MacRtMib.m_u8ForcedModType = rand() % 5;
+		break;
+
+	case 2:
+		g_MacRtMib.m_u8ForcedModScheme = rand() % 3;
+		break;
+
+	case 3:
+		g_MacRtMib.m_u8TransmitAtten = rand() % 40;
+		break;
+
+	case 4:
+		g_MacRtMib.m_ToneMask.m_au8ToneMask[rand() % 9] ^= 1 << (rand() % 8);
+		break;
+
+	case 5:
+		g_MacRtMib.m_ForcedToneMap.m_au8Tm[rand() % 3] = (rand() % 4) ? 0 : rand();
+		break;
+
+	case 6:
+		u8RtMibSpecCompliance = (rand() & 1) ? 17 : 15;
+		break;
+
+	case 7:
+		_random_request(&sx_neighbours[rand() % NEIGHBOURS]);
+		break;
+
+	default:
+		break;
+	}
+}
+
+/* Cached results match the ones computed from scratch, whatever changed in between */
+static void test_cache_matches(void)
+{
+	struct TPlmeSetRequest x_cached;
+	struct TPlmeSetRequest x_scratch;
+	struct TPhyParameters x_phy_cached;
+	struct TPhyParameters x_phy_scratch;
+	uint16_t us_len_cached;
+	uint16_t us_len_scratch;
+	uint8_t uc_rs_cached;
+	uint32_t ul_mismatches = 0;
+	uint32_t ul_segment_hits = 0;
+	uint32_t ul_i;
+	int i_lower;
+
+	srand(7);
+	MacRtConstantsInitialize(0, NULL);
+	MacRtMibInitialize(17);
+	ResetTxParamCache();
+	for (ul_i = 0; ul_i < NEIGHBOURS; ul_i++) {
+		_random_request(&sx_neighbours[ul_i]);
+	}
+
+	for (ul_i = 0; ul_i < ITERATIONS; ul_i++) {
+		_random_change();
+		/* Mostly 3 neighbours, so that the cache hits */
+		g_MacRt.m_TxRequest = sx_neighbours[(rand() % 3) ? rand() % 3 : rand() % NEIGHBOURS];
+		g_MacRt.m_TxRequest.m_bRequestAck = rand() & 1;
+		i_lower = rand() % 10;
+
+		CalculateTxParameters();
+		x_cached = g_MacRt.m_TxParameters;
+		_lower_modulation(i_lower);
+		if ((pTxParamCacheEntry != NULL) && pTxParamCacheEntry->m_bSegmentValid) {
+			ul_segment_hits++;
+		}
+
+		CalculateSegmentParameters(&x_phy_cached, &us_len_cached);
+		uc_rs_cached = u8AvailableRSBlocks;
+
+		ComputeTxParameters();
+		x_scratch = g_MacRt.m_TxParameters;
+		_lower_modulation(i_lower);
+		_compute_from_scratch(&x_phy_scratch, &us_len_scratch);
+
+		if (!_same_set_request(&x_cached, &x_scratch) || memcmp(&x_phy_cached, &x_phy_scratch, sizeof(x_phy_cached)) ||
+				(us_len_cached != us_len_scratch) || (uc_rs_cached != u8AvailableRSBlocks)) {
+			ul_mismatches++;
+		}
+	}
+
+	CHECK(ul_mismatches == 0);
+	/* The cache is actually used */
+	CHECK(ul_segment_hits > ITERATIONS / 2);
+	printf("%u requests, %u mismatches, %u segment cache hits\n", (unsigned)ITERATIONS, (unsigned)ul_mismatches,
+			(unsigned)ul_segment_hits);
+}
+
+/* 3 neighbours round robin on the FCC band, steady MIB */
+static void test_bench(void)
+{
+	struct TPhyParameters x_phy;
+	uint16_t us_len;
+	volatile uint32_t ul_sink = 0;
+	clock_t x_start;
+	double d_cached;
+	double d_scratch;
+	uint32_t ul_i;
+
+	MacRtConstantsInitialize(2, NULL);
+	MacRtMibInitialize(17);
+	ResetTxParamCache();
+
+	x_start = clock();
+	for (ul_i = 0; ul_i < BENCH_TX; ul_i++) {
+		g_MacRt.m_TxRequest = sx_neighbours[ul_i % 3];
+		CalculateTxParameters();
+		CalculateSegmentParameters(&x_phy, &us_len);
+		ul_sink += us_len + g_MacRt.m_TxParameters.m_TxParameters.m_u8TxPower;
+	}
+
+	d_cached = (double)(clock() - x_start) / CLOCKS_PER_SEC;
+
+	x_start = clock();
+	for (ul_i = 0; ul_i < BENCH_TX; ul_i++) {
+		g_MacRt.m_TxRequest = sx_neighbours[ul_i % 3];
+		ComputeTxParameters();
+		_compute_from_scratch(&x_phy, &us_len);
+		ul_sink += us_len + g_MacRt.m_TxParameters.m_TxParameters.m_u8TxPower;
+	}
+
+	d_scratch = (double)(clock() - x_start) / CLOCKS_PER_SEC;
+
+	printf("FCC, 3 neighbours: cached %.1f ns/tx, from scratch %.1f ns/tx\n", d_cached * 1e9 / BENCH_TX,
+			d_scratch * 1e9 / BENCH_TX);
+}
+
+int main(void)
+{
+	test_cache_matches();
+	test_bench();
+
+	if (si_failures) {
+		printf("%d failure(s)\n", si_failures);
+		return 1;
+	}
+
+	printf("OK\n");
+	return 0;
+}
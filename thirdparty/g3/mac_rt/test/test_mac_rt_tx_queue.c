@@ -0,0 +1,298 @@
+/**
+ * \file
+ *
+ * \brief Host test of the MAC RT transmission queue.
+ *
+ * Checks that confirms are delivered in request order while high priority
+ * frames go on air first, that refused requests are confirmed after the
+ * outstanding ones, that the MSDU is copied on request, and that every
+ * segment sent (built ahead or not) matches one built from scratch.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../source/MacRt.c"
+#include "phy_stub.h"
+
+#define MAX_REQUESTS   32
+#define SEGMENTED_LEN  300
+
+static int si_failures;
+
+#define CHECK(cond) do { \
+		if (!(cond)) { \
+			printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+			si_failures++; \
+		} \
+	} while (0)
+
+/* Requests in the order they were issued, identified by MHR sequence number */
+static uint8_t suc_requested[MAX_REQUESTS];
+static int si_requested;
+/* Frames whose last segment went on air */
+static bool sb_sent[256];
+/* First segments on air, in order */
+static uint8_t suc_air[MAX_REQUESTS];
+static int si_air;
+/* Confirms received */
+static enum EMacRtStatus se_confirms[MAX_REQUESTS];
+static int si_confirms;
+/* Request issued from the confirm callback, 0 for none */
+static uint8_t suc_reenter_seq;
+static int si_reenter_after;
+/* PHY status for the next data confirms */
+static enum EPhyStatus se_phy_status = PHY_STATUS_SUCCESS;
+static int si_phy_busy_segment = -1;
+static uint32_t sul_segments;
+static uint32_t sul_ahead_checks;
+
+static void _fill_msdu(uint8_t *puc_msdu, uint16_t us_len, uint8_t uc_seq)
+{
+	uint16_t us_i;
+
+	for (us_i = 0; us_i < us_len; us_i++) {
+		puc_msdu[us_i] = (uint8_t)(uc_seq * 7 + us_i);
+	}
+}
+
+static void _request(uint8_t uc_seq, bool b_high, uint16_t us_len)
+{
+	static uint8_t auc_msdu[MAC_RT_MAX_PAYLOAD_SIZE];
+	struct TMacRtTxRequest x_req;
+	struct TMacRtMhr x_mhr;
+
+	memset(&x_req, 0, sizeof(x_req));
+	memset(&x_mhr, 0, sizeof(x_mhr));
+	x_req.m_DstAddr.m_eAddrMode = MAC_RT_ADDRESS_MODE_SHORT;
+	x_req.m_DstAddr.m_nShortAddress = 0x1234;
+	x_req.m_u16MsduLength = us_len;
+	x_req.m_pMsdu = auc_msdu;
+	x_req.m_bHighPriority = b_high;
+	x_req.m_eModulationType = RT_MODULATION_ROBUST;
+	x_req.m_ToneMap.m_au8Tm[0] = 0x3F;
+	x_mhr.m_u8SequenceNumber = uc_seq;
+	x_mhr.m_Fc.m_nFrameType = 1;
+	x_mhr.m_Fc.m_nDestAddressingMode = 2;
+	x_mhr.m_Fc.m_nSrcAddressingMode = 2;
+
+	_fill_msdu(auc_msdu, us_len, uc_seq);
+	suc_requested[si_requested++] = uc_seq;
+	MacRtTxRequest(&x_req, &x_mhr);
+	/* The caller reuses its buffer right away */
+	memset(auc_msdu, 0, sizeof(auc_msdu));
+}
+
+static void _confirm_cb(enum EMacRtStatus eStatus, bool bUpdateTimestamp, enum ERtModulationType eModType)
+{
+	uint8_t uc_seq = suc_requested[si_confirms];
+
+	/* Confirms follow request order: this one must be done already */
+	if (eStatus == MAC_RT_STATUS_SUCCESS) {
+		CHECK(sb_sent[uc_seq]);
+	} else {
+		CHECK(!sb_sent[uc_seq]);
+	}
+
+	se_confirms[si_confirms++] = eStatus;
+	if (suc_reenter_seq && (si_confirms == si_reenter_after)) {
+		uint8_t uc_reenter = suc_reenter_seq;
+
+		suc_reenter_seq = 0;
+		_request(uc_reenter, false, 20);
+	}
+}
+
+static void _data_request_cb(struct TPdDataRequest *pParameters)
+{
+	struct TMacRtFrame x_frame = g_MacRt.m_TxFrame;
+	uint8_t auc_psdu[MAC_PHY_MAX_PAYLOAD_LENGTH];
+	uint8_t auc_msdu[MAC_RT_MAX_PAYLOAD_SIZE];
+	uint16_t us_seg_len;
+	uint8_t uc_two_rs;
+	uint16_t us_len;
+	uint8_t uc_seq = x_frame.m_Header.m_u8SequenceNumber;
+
+	sul_segments++;
+
+	/* Same bytes as a segment built from scratch at this point */
+	us_len = BuildSegment(&x_frame, g_MacRt.m_u8TxSegment, g_MacRt.m_u16TxOffset, &us_seg_len, &uc_two_rs, auc_psdu);
+	CHECK(us_len == pParameters->m_u16PsduLength);
+	CHECK(memcmp(auc_psdu, pParameters->m_pPsdu, us_len) == 0);
+	CHECK(us_seg_len == g_MacRt.m_u16SegmentLength);
+	CHECK(uc_two_rs == g_MacRt.m_TxParameters.m_TxParameters.m_u8TwoRSBlocks);
+
+	/* Payload comes from the copy taken on request */
+	_fill_msdu(auc_msdu, g_MacRt.m_TxRequest.m_u16MsduLength, uc_seq);
+	CHECK(memcmp(g_MacRt.m_TxFrame.m_pu8Payload, &auc_msdu[g_MacRt.m_u16TxOffset], g_MacRt.m_u16SegmentLength) == 0);
+
+	if ((g_MacRt.m_TxFrame.m_Header.m_SegmentControl.m_nSc == 0) && (si_air < MAX_REQUESTS)) {
+		if ((si_air == 0) || (suc_air[si_air - 1] != uc_seq)) {
+			suc_air[si_air++] = uc_seq;
+		}
+	}
+}
+
+/* Runs the MAC, confirming each transmission from the PHY after 5 ms */
+static void _run(int i_steps)
+{
+	struct TPdDataConfirm x_cfm;
+	uint32_t ul_requests;
+	bool b_last;
+	int i_step;
+
+	for (i_step = 0; i_step < i_steps; i_step++) {
+		ul_requests = g_u32PhyStubDataRequests;
+		g_u32PhyStubTime += 1000;
+		MacRtEventHandler();
+		if (g_u32PhyStubDataRequests == ul_requests) {
+			continue;
+		}
+
+#if MAC_RT_TX_SEGMENT_RUN_AHEAD
+		/* Next segment is built while this one is in the air */
+		if (!g_MacRt.m_TxFrame.m_Header.m_SegmentControl.m_nLsf) {
+			CHECK(g_TxSegmentAhead.m_bValid);
+			sul_ahead_checks++;
+		}
+#endif
+
+		x_cfm.m_eStatus = se_phy_status;
+		if ((si_phy_busy_segment >= 0) && (g_MacRt.m_u8TxSegment == si_phy_busy_segment)) {
+			/* Busy once in the middle of a segmented frame: CSMA-CA restarts from segment 0 */
+			x_cfm.m_eStatus = PHY_STATUS_BUSY;
+			si_phy_busy_segment = -1;
+		}
+
+		b_last = g_MacRt.m_TxFrame.m_Header.m_SegmentControl.m_nLsf;
+		if ((x_cfm.m_eStatus == PHY_STATUS_SUCCESS) && b_last) {
+			sb_sent[g_MacRt.m_TxFrame.m_Header.m_u8SequenceNumber] = true;
+		}
+
+		g_u32PhyStubTime += 5000;
+		x_cfm.m_u32Time = g_u32PhyStubTime;
+		g_MacPhyNotifications.m_pPdDataConfirm(&x_cfm);
+	}
+}
+
+static void _reset(void)
+{
+	static struct TMacRtNotifications x_notifications;
+
+	memset(&x_notifications, 0, sizeof(x_notifications));
+	x_notifications.m_pMacRtTxConfirm = _confirm_cb;
+	MacRtInitialize(0, &x_notifications, 17);
+
+	si_requested = 0;
+	si_air = 0;
+	si_confirms = 0;
+	suc_reenter_seq = 0;
+	memset(sb_sent, 0, sizeof(sb_sent));
+	se_phy_status = PHY_STATUS_SUCCESS;
+	si_phy_busy_segment = -1;
+	g_pPhyStubDataRequest = _data_request_cb;
+}
+
+/* High priority frames go first on air, confirms keep the request order */
+static void test_confirm_order(void)
+{
+	static const uint8_t auc_air[] = {1, 3, 6, 2, 4, 9};
+	struct TMacRtTxQueueStats x_stats;
+	int i;
+
+	_reset();
+	_request(1, false, 20);
+	_request(2, false, 20);
+	_request(3, true, 20);
+	_request(4, false, SEGMENTED_LEN);
+	/* Normal lane full */
+	_request(5, false, 20);
+	_request(6, true, 20);
+	/* Issued from the confirm of frame 3, when there is room again */
+	suc_reenter_seq = 9;
+	si_reenter_after = 3;
+
+	_run(2000);
+
+	CHECK(si_air == (int)sizeof(auc_air));
+	for (i = 0; (i < si_air) && (i < (int)sizeof(auc_air)); i++) {
+		CHECK(suc_air[i] == auc_air[i]);
+	}
+
+	CHECK(si_confirms == 7);
+	CHECK(se_confirms[4] == MAC_RT_STATUS_TRANSACTION_OVERFLOW);
+	for (i = 0; i < si_confirms; i++) {
+		if (i != 4) {
+			CHECK(se_confirms[i] == MAC_RT_STATUS_SUCCESS);
+		}
+	}
+
+	MacRtGetTxQueueStats(&x_stats);
+	CHECK(x_stats.m_u32ConfirmCount == 6);
+	CHECK(x_stats.m_u32OverflowCount == 1);
+	CHECK(x_stats.m_u8MaxDepth == 4);
+	CHECK(g_TxConfirmFifo.m_u8Count == 0);
+}
+
+/* A refused request is not confirmed before the frame in progress */
+static void test_overflow_after_in_progress(void)
+{
+	_reset();
+	_request(1, false, 20);
+	_request(2, false, 20);
+	_request(3, false, 20);
+	_request(4, false, 20);
+
+	/* Not even a segment sent yet: nothing to confirm */
+	g_u32PhyStubTime += 1000;
+	MacRtEventHandler();
+	CHECK(si_confirms == 0);
+
+	_run(1000);
+	CHECK(si_confirms == 4);
+	CHECK(se_confirms[0] == MAC_RT_STATUS_SUCCESS);
+	CHECK(se_confirms[2] == MAC_RT_STATUS_SUCCESS);
+	CHECK(se_confirms[3] == MAC_RT_STATUS_TRANSACTION_OVERFLOW);
+}
+
+/* Segments built ahead are dropped when the frame restarts from segment 0 */
+static void test_segment_restart(void)
+{
+	uint32_t ul_segments;
+
+	_reset();
+	_request(1, false, MAC_RT_MAX_PAYLOAD_SIZE);
+	si_phy_busy_segment = 1;
+	_run(1000);
+	CHECK(si_confirms == 1);
+	CHECK(se_confirms[0] == MAC_RT_STATUS_SUCCESS);
+	CHECK(si_phy_busy_segment == -1);
+
+	/* Many segmented frames back to back */
+	_reset();
+	ul_segments = sul_segments;
+	_request(1, false, SEGMENTED_LEN);
+	_request(2, true, MAC_RT_MAX_PAYLOAD_SIZE);
+	_request(3, false, SEGMENTED_LEN);
+	_request(4, true, 50);
+	_run(3000);
+	CHECK(si_confirms == 4);
+	CHECK(sul_segments - ul_segments > 8);
+}
+
+int main(void)
+{
+	test_confirm_order();
+	test_overflow_after_in_progress();
+	test_segment_restart();
+
+	printf("segments %u, built ahead %u\n", (unsigned)sul_segments, (unsigned)sul_ahead_checks);
+	if (si_failures) {
+		printf("%d failure(s)\n", si_failures);
+		return 1;
+	}
+
+	printf("OK\n");
+	return 0;
+}
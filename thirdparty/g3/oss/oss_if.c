@@ -46,6 +46,8 @@
 #include <string.h>
 
 #ifdef _G3_SIM_
+#include <stdio.h>
+#include <time.h>
 #include "oss_if.h"
 #include "led.h"
 #else
@@ -70,10 +72,14 @@
 	#include "FreeRTOS.h"
 	#include "task.h"
 	#include "timers.h"
+#ifdef OSS_EVENT_DRIVEN
+	#include "semphr.h"
+#endif
 #endif
 
 #ifdef OSS_G3_ADP_MAC_SUPPORT
 	#include "AdpApi.h"
+	#include "Timer.h"
 #endif
 
 /* / @cond 0 */
@@ -93,8 +99,96 @@ static uint32_t g_100ms_counter = 0;
 /* Global 10 s counter */
 static uint32_t g_10s_counter = 0;
 
+/* Milliseconds and 100 ms periods not yet carried to the coarser counters */
+static uint32_t sul_oss_ms_rem;
+static uint32_t sul_oss_100ms_rem;
+
+/* OSS time base: host clock in ns, or DWT cycle counter */
+#ifndef OSS_TIMESTAMP
+#ifdef _G3_SIM_
+#define OSS_TIMESTAMP_FREQ         1000000000UL
+#define OSS_TIMESTAMP()            _oss_timestamp()
+
+static uint32_t _oss_timestamp(void)
+{
+	struct timespec x_ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &x_ts);
+	return (uint32_t)(((uint64_t)x_ts.tv_sec * 1000000000ULL) + (uint64_t)x_ts.tv_nsec);
+}
+
+#else
+#define OSS_TIMESTAMP_DWT
+#define OSS_TIMESTAMP_FREQ         SystemCoreClock
+#define OSS_TIMESTAMP()            (DWT->CYCCNT)
+#endif
+#endif
+
+#ifdef OSS_PROFILER
+#ifdef _G3_SIM_
+#define OSS_PROF_CLZ(x)            __builtin_clz(x)
+#else
+#define OSS_PROF_CLZ(x)            __CLZ(x)
+#endif
+#endif
+
+/* Scheduler instrumentation */
+static oss_stats_t sx_oss_stats;
+
+/**
+ * \internal
+ * \brief Account the run time of a timed entry.
+ *
+ */
+static void _oss_stats_record(uint8_t uc_id, uint32_t ul_time)
+{
+	oss_run_stats_t *px_run;
+#ifdef OSS_PROFILER
+	uint32_t ul_bucket;
+#endif
+
+	px_run = &sx_oss_stats.x_run[uc_id];
+	px_run->ul_count++;
+	px_run->ull_total += ul_time;
+	if ((px_run->ul_count == 1) || (ul_time < px_run->ul_min)) {
+		px_run->ul_min = ul_time;
+	}
+
+	if (ul_time > px_run->ul_max) {
+		px_run->ul_max = ul_time;
+	}
+
+#ifdef OSS_PROFILER
+	/* Bucket 0: below 2^SHIFT, bucket n: [2^(SHIFT+n-1), 2^(SHIFT+n)) */
+	ul_bucket = ul_time >> OSS_PROF_HIST_SHIFT;
+	if (ul_bucket) {
+		ul_bucket = 32 - OSS_PROF_CLZ(ul_bucket);
+		if (ul_bucket >= OSS_PROF_HIST_BUCKETS) {
+			ul_bucket = OSS_PROF_HIST_BUCKETS - 1;
+		}
+	}
+
+	px_run->aul_hist[ul_bucket]++;
+#endif
+}
+
+/* Run a call and record its duration */
+#define OSS_STATS_RUN(id, call) \
+	do { \
+		uint32_t ul_stats_start = OSS_TIMESTAMP(); \
+		call; \
+		_oss_stats_record((id), OSS_TIMESTAMP() - ul_stats_start); \
+	} while (0)
+
+/* Events notified and not yet processed by the app loop */
+static volatile uint32_t sul_oss_pending_events;
+
+#ifdef OSS_EVENT_DRIVEN
+/* Time of the first notification not yet seen by the app loop */
+static volatile uint32_t sul_oss_notify_time;
+#endif
+
 /* User registration tasks */
-#define OSS_IF_MAX_TASKS       5
 static uint8_t suc_oss_num_task_registered;
 
 static pfv_t sx_oss_init_tasks[OSS_IF_MAX_TASKS];
@@ -102,6 +196,41 @@ static pfv_t sx_oss_proc_tasks[OSS_IF_MAX_TASKS];
 static pfv_t sx_oss_updt_tasks[OSS_IF_MAX_TASKS];
 static pfv_t sx_oss_proc_prio_tasks[OSS_IF_MAX_TASKS];
 
+#if defined(OSS_EVENT_DRIVEN) && defined(OSS_USE_FREERTOS)
+
+/* Wake-up condition of a process called from the app loop */
+typedef struct {
+	uint32_t ul_events;     /* Events running the process */
+	uint32_t ul_period;     /* Maximum ms between runs, 0: events only */
+	uint32_t ul_next_run;   /* Deadline (ms counter) of the next run */
+} oss_sched_t;
+
+static oss_sched_t sx_oss_task_sched[OSS_IF_MAX_TASKS];
+
+/* Events armed with oss_notify_after(), ul_events 0: free slot */
+typedef struct {
+	uint32_t ul_events;
+	uint32_t ul_deadline;   /* Deadline (ms counter) of the notification */
+} oss_timer_event_t;
+
+static oss_timer_event_t sx_oss_timer_events[OSS_TIMER_EVENT_SLOTS];
+
+/* Elapsed ms whose 1 ms timer callbacks are still to be run by the app loop */
+static volatile uint32_t sul_oss_pending_ms;
+
+/* At least one task has registered a 1 ms timer callback */
+static bool sb_oss_timer_cb;
+
+/* PLC interrupt notified and not yet seen by the G3 stack, and its time */
+static volatile bool sb_oss_stack_notified;
+static volatile uint32_t sul_oss_stack_notify_time;
+#endif
+
+static void _oss_run_task(pfv_t pf_task, uint8_t uc_idx, enum oss_task_type ttype)
+{
+	OSS_STATS_RUN(OSS_STATS_TASK_ID(uc_idx, ttype), pf_task());
+}
+
 static void _oss_execute_tasks(enum oss_task_type ttype)
 {
 	uint8_t uc_idx;
@@ -129,36 +258,78 @@ static void _oss_execute_tasks(enum oss_task_type ttype)
 
 		for (uc_idx = 0; uc_idx < suc_oss_num_task_registered; uc_idx++, pfv++) {
 			if ((pfv != NULL) && (*pfv != NULL)) {
-				(*pfv)();
+				if (ttype != OSS_TASK_INIT) {
+					_oss_run_task(*pfv, uc_idx, ttype);
+				} else {
+					(*pfv)();
+				}
 			}
 		}
 	}
 }
 
-static void _oss_1ms_timer_handler(void)
+/**
+ * \internal
+ * \brief Advance the internal counters by a number of milliseconds.
+ *
+ */
+static void _oss_advance_counters(uint32_t ul_ms)
 {
 	/* update count ms */
-	g_ms_counter++;
+	g_ms_counter += ul_ms;
 
-	if ((g_ms_counter % 100) == 0) {
+	sul_oss_ms_rem += ul_ms;
+	if (sul_oss_ms_rem >= 100) {
 		/* 100 ms elapsed; update counter */
-		g_100ms_counter++;
+		g_100ms_counter += sul_oss_ms_rem / 100;
+		sul_oss_100ms_rem += sul_oss_ms_rem / 100;
+		sul_oss_ms_rem %= 100;
 
-		if ((g_100ms_counter % 100) == 0) {
+		if (sul_oss_100ms_rem >= 100) {
 			/* 10 s elapsed; update counter */
-			g_10s_counter++;
+			g_10s_counter += sul_oss_100ms_rem / 100;
+			sul_oss_100ms_rem %= 100;
 		}
 	}
 
 #ifdef OSS_ENABLE_IPv6_STACK_SUPPORT
 	/* update count ms for IPv6 stack */
-	systemTicks++;
+	systemTicks += ul_ms;
 #endif
+}
+
+#if !defined(OSS_USE_FREERTOS) || (defined(_G3_SIM_) && !defined(OSS_EVENT_DRIVEN))
+static void _oss_1ms_timer_handler(void)
+{
+	_oss_advance_counters(1);
 
 	/* Tasks 1ms timer callback, if registered */
 	_oss_execute_tasks(OSS_TASK_UPDATE);
 }
 
+#endif
+
+#ifdef OSS_EVENT_DRIVEN
+
+/**
+ * \internal
+ * \brief Account a wake-up caused by a notified event.
+ *
+ */
+static void _oss_wake_record(oss_wake_stats_t *px_wake, uint32_t ul_notify_time)
+{
+	uint32_t ul_latency;
+
+	ul_latency = OSS_TIMESTAMP() - ul_notify_time;
+	px_wake->ul_count++;
+	px_wake->ul_last = ul_latency;
+	if (ul_latency > px_wake->ul_max) {
+		px_wake->ul_max = ul_latency;
+	}
+}
+
+#endif
+
 uint32_t oss_get_up_time_ms(void)
 {
 	return g_ms_counter;
@@ -174,6 +345,208 @@ uint32_t oss_get_up_time_10s(void)
 	return g_10s_counter;
 }
 
+/**
+ * Get scheduler instrumentation (wake-ups and per-task run time)
+ */
+const oss_stats_t *oss_get_stats(void)
+{
+	return &sx_oss_stats;
+}
+
+/**
+ * Reset scheduler instrumentation
+ */
+void oss_reset_stats(void)
+{
+	memset(&sx_oss_stats, 0, sizeof(sx_oss_stats));
+}
+
+/**
+ * Get OSS time base frequency (run time and latency units per second)
+ */
+uint32_t oss_get_stats_freq(void)
+{
+	return OSS_TIMESTAMP_FREQ;
+}
+
+#ifdef OSS_PROFILER
+
+/**
+ * Get min/avg/max/p99 of a profiler entry. Returns false if never run.
+ */
+bool oss_prof_get_summary(uint8_t uc_id, oss_prof_summary_t *px_summary)
+{
+	const oss_run_stats_t *px_entry;
+	uint32_t ul_target;
+	uint32_t ul_acc;
+	uint8_t uc_bucket;
+
+	if (uc_id >= OSS_STATS_ENTRIES) {
+		return false;
+	}
+
+	px_entry = &sx_oss_stats.x_run[uc_id];
+	if (px_entry->ul_count == 0) {
+		return false;
+	}
+
+	px_summary->ul_count = px_entry->ul_count;
+	px_summary->ul_min = px_entry->ul_min;
+	px_summary->ul_avg = (uint32_t)(px_entry->ull_total / px_entry->ul_count);
+	px_summary->ul_max = px_entry->ul_max;
+
+	/* p99: upper limit of the bucket reaching 99% of the samples, bounded by max */
+	ul_target = px_entry->ul_count - (px_entry->ul_count / 100);
+	ul_acc = 0;
+	px_summary->ul_p99 = px_entry->ul_max;
+	for (uc_bucket = 0; uc_bucket < (OSS_PROF_HIST_BUCKETS - 1); uc_bucket++) {
+		ul_acc += px_entry->aul_hist[uc_bucket];
+		if (ul_acc >= ul_target) {
+			if (((1UL << (OSS_PROF_HIST_SHIFT + uc_bucket)) - 1) < px_entry->ul_max) {
+				px_summary->ul_p99 = (1UL << (OSS_PROF_HIST_SHIFT + uc_bucket)) - 1;
+			}
+
+			break;
+		}
+	}
+
+	return true;
+}
+
+/**
+ * Print profiler entries on console
+ */
+void oss_prof_dump(void)
+{
+	static const char *const spc_type[3] = {"process", "update", "prio"};
+	oss_prof_summary_t x_summary;
+	uint8_t uc_id;
+
+	printf("OSS profile (%lu units/s): count min avg max p99\r\n", (unsigned long)OSS_TIMESTAMP_FREQ);
+	for (uc_id = 0; uc_id < OSS_STATS_ENTRIES; uc_id++) {
+		if (!oss_prof_get_summary(uc_id, &x_summary)) {
+			continue;
+		}
+
+		if (uc_id == OSS_STATS_G3_STACK) {
+			printf("G3 stack       ");
+		} else if (uc_id == OSS_STATS_USI) {
+			printf("USI            ");
+		} else if (uc_id == OSS_STATS_NET) {
+			printf("IPv6 stack     ");
+		} else {
+			printf("Task %u %-8s", (unsigned)((uc_id - OSS_STATS_TASK_BASE) / 3),
+					spc_type[(uc_id - OSS_STATS_TASK_BASE) % 3]);
+		}
+
+		printf(" %lu %lu %lu %lu %lu\r\n", (unsigned long)x_summary.ul_count,
+				(unsigned long)x_summary.ul_min, (unsigned long)x_summary.ul_avg,
+				(unsigned long)x_summary.ul_max, (unsigned long)x_summary.ul_p99);
+	}
+
+	printf("Wake-ups: app %lu (%lu on events, latency last %lu max %lu), stack %lu (%lu on PLC IRQ, latency last %lu max %lu)\r\n",
+			(unsigned long)sx_oss_stats.ul_app_wakeups, (unsigned long)sx_oss_stats.x_app_wake.ul_count,
+			(unsigned long)sx_oss_stats.x_app_wake.ul_last, (unsigned long)sx_oss_stats.x_app_wake.ul_max,
+			(unsigned long)sx_oss_stats.ul_stack_wakeups, (unsigned long)sx_oss_stats.x_stack_wake.ul_count,
+			(unsigned long)sx_oss_stats.x_stack_wake.ul_last, (unsigned long)sx_oss_stats.x_stack_wake.ul_max);
+}
+
+#ifdef NUM_PORTS
+
+/* USI response buffer: command, id, freq, summary and histogram */
+static uint8_t suc_oss_prof_rsp[2 + 4 + (5 * 4) + (OSS_PROF_HIST_BUCKETS * 4)];
+
+static uint16_t _oss_prof_put_u32(uint8_t *puc_buf, uint16_t us_len, uint32_t ul_value)
+{
+	puc_buf[us_len++] = (uint8_t)((ul_value >> 24) & 0xFF);
+	puc_buf[us_len++] = (uint8_t)((ul_value >> 16) & 0xFF);
+	puc_buf[us_len++] = (uint8_t)((ul_value >> 8) & 0xFF);
+	puc_buf[us_len++] = (uint8_t)(ul_value & 0xFF);
+
+	return us_len;
+}
+
+/**
+ * \internal
+ * \brief Send one profiler entry through USI.
+ *
+ * Response: cmd, id, freq, count, min, avg, max, p99, histogram (big endian)
+ *
+ */
+static bool _oss_prof_usi_send_entry(uint8_t uc_id)
+{
+	x_usi_serial_cmd_params_t x_msg;
+	oss_prof_summary_t x_summary;
+	uint16_t us_len;
+	uint8_t uc_bucket;
+
+	if (!oss_prof_get_summary(uc_id, &x_summary)) {
+		return true;
+	}
+
+	us_len = 0;
+	suc_oss_prof_rsp[us_len++] = OSS_PROF_CMD_GET;
+	suc_oss_prof_rsp[us_len++] = uc_id;
+	us_len = _oss_prof_put_u32(suc_oss_prof_rsp, us_len, OSS_TIMESTAMP_FREQ);
+	us_len = _oss_prof_put_u32(suc_oss_prof_rsp, us_len, x_summary.ul_count);
+	us_len = _oss_prof_put_u32(suc_oss_prof_rsp, us_len, x_summary.ul_min);
+	us_len = _oss_prof_put_u32(suc_oss_prof_rsp, us_len, x_summary.ul_avg);
+	us_len = _oss_prof_put_u32(suc_oss_prof_rsp, us_len, x_summary.ul_max);
+	us_len = _oss_prof_put_u32(suc_oss_prof_rsp, us_len, x_summary.ul_p99);
+	for (uc_bucket = 0; uc_bucket < OSS_PROF_HIST_BUCKETS; uc_bucket++) {
+		us_len = _oss_prof_put_u32(suc_oss_prof_rsp, us_len, sx_oss_stats.x_run[uc_id].aul_hist[uc_bucket]);
+	}
+
+	x_msg.uc_protocol_type = PROTOCOL_INTERNAL;
+	x_msg.ptr_buf = suc_oss_prof_rsp;
+	x_msg.us_len = us_len;
+
+	return (usi_send_cmd(&x_msg) == USI_STATUS_OK);
+}
+
+/**
+ * \internal
+ * \brief USI handler of profiler commands.
+ *
+ * OSS_PROF_CMD_GET [id]: one response per entry run at least once (all if no id).
+ * OSS_PROF_CMD_RESET: reset entries.
+ *
+ */
+static uint8_t _oss_prof_usi_handler(uint8_t *puc_rx_msg, uint16_t us_len)
+{
+	uint8_t uc_id;
+
+	if (us_len == 0) {
+		return false;
+	}
+
+	switch (puc_rx_msg[0]) {
+	case OSS_PROF_CMD_GET:
+		if (us_len > 1) {
+			return _oss_prof_usi_send_entry(puc_rx_msg[1]);
+		}
+
+		for (uc_id = 0; uc_id < OSS_STATS_ENTRIES; uc_id++) {
+			if (!_oss_prof_usi_send_entry(uc_id)) {
+				return false;
+			}
+		}
+
+		return true;
+
+	case OSS_PROF_CMD_RESET:
+		oss_reset_stats();
+		return true;
+
+	default:
+		return false;
+	}
+}
+
+#endif /* NUM_PORTS */
+
+#endif /* OSS_PROFILER */
+
 /**
  * Register new Task in OSS
  */
@@ -188,6 +561,23 @@ int oss_register_task(oss_task_t *app_task)
 	sx_oss_updt_tasks[suc_oss_num_task_registered] = app_task->task_1ms_timer_cb;
 	sx_oss_proc_prio_tasks[suc_oss_num_task_registered] = app_task->task_process_prio;
 
+#if defined(OSS_EVENT_DRIVEN) && defined(OSS_USE_FREERTOS)
+	if (app_task->ul_wake_events == 0) {
+		/* Task without wake sources: keep it polled at the fixed app rate */
+		sx_oss_task_sched[suc_oss_num_task_registered].ul_events = OSS_EVENT_ALL;
+		sx_oss_task_sched[suc_oss_num_task_registered].ul_period = OSS_APP_EXEC_RATE;
+	} else {
+		sx_oss_task_sched[suc_oss_num_task_registered].ul_events = app_task->ul_wake_events;
+		sx_oss_task_sched[suc_oss_num_task_registered].ul_period = app_task->ul_poll_period;
+	}
+
+	sx_oss_task_sched[suc_oss_num_task_registered].ul_next_run = 0;
+
+	if (app_task->task_1ms_timer_cb != NULL) {
+		sb_oss_timer_cb = true;
+	}
+#endif
+
 	suc_oss_num_task_registered++;
 
 	return 0;
@@ -214,6 +604,22 @@ void oss_init(void)
 	memset(&sx_oss_proc_prio_tasks, 0, sizeof(sx_oss_proc_prio_tasks));
 
 	suc_oss_num_task_registered = 0;
+	sul_oss_pending_events = 0;
+	memset(&sx_oss_stats, 0, sizeof(sx_oss_stats));
+
+#if defined(OSS_EVENT_DRIVEN) && defined(OSS_USE_FREERTOS)
+	memset(sx_oss_timer_events, 0, sizeof(sx_oss_timer_events));
+	sul_oss_pending_ms = 0;
+	sb_oss_timer_cb = false;
+	sb_oss_stack_notified = false;
+#endif
+
+#ifdef OSS_TIMESTAMP_DWT
+	/* Enable DWT cycle counter as OSS time base */
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CYCCNT = 0;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
 }
 
 #ifdef OSS_USE_FREERTOS
@@ -225,6 +631,28 @@ xTaskHandle xG3AppHnd;
 xTimerHandle xUpdateTimer;
 xTimerHandle xLEDTimer;
 
+#ifdef OSS_EVENT_DRIVEN
+/* Wake-up semaphores of G3 tasks */
+static xSemaphoreHandle sx_g3_app_sem;
+static xSemaphoreHandle sx_g3_stack_sem;
+
+/* Tick of the last internal G3 systick update */
+static portTickType sx_last_update_tick;
+
+/* Wake-up conditions of USI and IPv6 stack */
+#ifdef NUM_PORTS
+static oss_sched_t sx_oss_usi_sched = {OSS_EVENT_USI_RX, OSS_USI_POLL_PERIOD, 0};
+#endif
+#ifdef OSS_ENABLE_IPv6_STACK_SUPPORT
+#if OSS_NET_POLL_PERIOD
+static oss_sched_t sx_oss_net_sched = {OSS_EVENT_NET, OSS_NET_POLL_PERIOD, 0};
+#else
+/* Nothing notifies the expiration of IPv6 stack timers: run it on their tick */
+static oss_sched_t sx_oss_net_sched = {OSS_EVENT_NET, NET_TICK_INTERVAL, 0};
+#endif
+#endif
+#endif
+
 /* FreeRTOS utils */
 void vApplicationIdleHook( void );
 void vApplicationMallocFailedHook( void );
@@ -294,7 +722,7 @@ void vApplicationTickHook( void )
 	* functions can be used (those that end in FromISR()). */
 }
 
-#ifndef _G3_SIM_
+#if !defined(_G3_SIM_) && !defined(OSS_EVENT_DRIVEN)
 
 /**
  * \internal
@@ -307,12 +735,18 @@ static void _update_1ms_proc(xTimerHandle pxTimer)
 {
 	UNUSED(pxTimer);
 	taskENTER_CRITICAL();
-
-	_oss_1ms_timer_handler();
-
+	_oss_advance_counters(1);
 	taskEXIT_CRITICAL();
+
+	/* Tasks 1ms timer callback, if registered. The timer service task is */
+	/* not preempted by the G3 tasks, so callbacks need no critical section */
+	_oss_execute_tasks(OSS_TASK_UPDATE);
 }
 
+#endif
+
+#ifndef _G3_SIM_
+
 /**
  * \internal
  * \brief Task to blink board LED.
@@ -332,97 +766,652 @@ static void _blink_led(xTimerHandle pxTimer)
 
 #endif /* _G3_SIM_ */
 
+#ifdef OSS_EVENT_DRIVEN
+
 /**
- * \internal
- * \brief Periodic task to process G3 App.
- *
+ * Notify events to G3 tasks from task context
  */
-static void _g3_app_process(void *pvParameters)
+void oss_notify(uint32_t ul_events)
 {
-	static portTickType xLastWakeTime;
-	static portTickType xPeriod;
+	uint32_t ul_now;
 
-	/* App initialization (internally initializes G3 stack layers) */
-#ifdef NUM_PORTS
-	usi_init();
-#endif
+	ul_now = OSS_TIMESTAMP();
 
-	/* Task-registered initialization */
-	_oss_execute_tasks(OSS_TASK_INIT);
+	taskENTER_CRITICAL();
+	if (sul_oss_pending_events == 0) {
+		sul_oss_notify_time = ul_now;
+	}
 
-	xPeriod = G3_APP_PROCESS_EXEC_RATE;
-	xLastWakeTime = xTaskGetTickCount();
-	for (;;) {
-		/* Task-registered PRIO processes */
-		_oss_execute_tasks(OSS_TASK_PROCESS_PRIO);
-		/* Task-registered processes */
-		_oss_execute_tasks(OSS_TASK_PROCESS);
+	sul_oss_pending_events |= ul_events;
+	if ((ul_events & OSS_EVENT_PLC_IRQ) && !sb_oss_stack_notified) {
+		sb_oss_stack_notified = true;
+		sul_oss_stack_notify_time = ul_now;
+	}
 
-#ifdef NUM_PORTS
-		usi_process();
-#endif
+	taskEXIT_CRITICAL();
 
-#ifdef OSS_ENABLE_IPv6_STACK_SUPPORT
-		netTask();
-#endif
+	if ((ul_events & OSS_EVENT_PLC_IRQ) && (sx_g3_stack_sem != NULL)) {
+		xSemaphoreGive(sx_g3_stack_sem);
+	}
 
-		xLastWakeTime = xTaskGetTickCount();
-		vTaskDelayUntil(&xLastWakeTime, xPeriod);
+	if (sx_g3_app_sem != NULL) {
+		xSemaphoreGive(sx_g3_app_sem);
 	}
 }
 
 /**
- * \internal
- * \brief Periodic task to process G3. Initialize and start every layers.
- * \note Please see conf_oss file in order to configure the layers to execute.
- *
+ * Notify events to G3 tasks from interrupt context
  */
-static void _g3_stack_process(void *pvParameters)
+void oss_notify_from_isr(uint32_t ul_events)
 {
-	static portTickType xLastWakeTime;
-	static portTickType xPeriod;
-
-	UNUSED(pvParameters);
+	unsigned portBASE_TYPE ux_mask;
+	portBASE_TYPE x_woken = pdFALSE;
+	uint32_t ul_now;
 
-#ifndef _G3_SIM_
-	/* Start timer to update counters */
-	xTimerStart(xUpdateTimer, G3_UPDATE_TIMERS_RATE);
-	/* Start timer to blink led */
-	xTimerStart(xLEDTimer, G3_LED_PROCESS_TIMER_RATE);
-#endif
+	ul_now = OSS_TIMESTAMP();
 
-	/* Initial delay on G3 process to allow for correct initialization */
-	xPeriod = G3_PROCESS_INITIAL_DELAY;
-	xLastWakeTime = xTaskGetTickCount();
-	vTaskDelayUntil(&xLastWakeTime, xPeriod);
+	ux_mask = portSET_INTERRUPT_MASK_FROM_ISR();
+	if (sul_oss_pending_events == 0) {
+		sul_oss_notify_time = ul_now;
+	}
 
-	xPeriod = G3_PROCESS_EXEC_RATE;
-	xLastWakeTime = xTaskGetTickCount();
-	for (;;) {
-		/* Reset watchdog */
-		RESET_WATCHDOG;
+	sul_oss_pending_events |= ul_events;
+	if ((ul_events & OSS_EVENT_PLC_IRQ) && !sb_oss_stack_notified) {
+		sb_oss_stack_notified = true;
+		sul_oss_stack_notify_time = ul_now;
+	}
 
-		vTaskDelayUntil(&xLastWakeTime, xPeriod);
+	portCLEAR_INTERRUPT_MASK_FROM_ISR(ux_mask);
 
-#ifdef _G3_SIM_
-		_oss_1ms_timer_handler();
-#endif
+	if ((ul_events & OSS_EVENT_PLC_IRQ) && (sx_g3_stack_sem != NULL)) {
+		xSemaphoreGiveFromISR(sx_g3_stack_sem, &x_woken);
+	}
 
-#ifdef OSS_G3_ADP_MAC_SUPPORT
-		/* Internally calls MAC and PHY Event handlers */
-		AdpEventHandler();
-#endif
+	if (sx_g3_app_sem != NULL) {
+		xSemaphoreGiveFromISR(sx_g3_app_sem, &x_woken);
 	}
+
+	portEND_SWITCHING_ISR(x_woken);
 }
 
 /**
  * \internal
- * \brief Create main G3 task and create timer to update internal counters.
- * \note Please see conf_oss file in order to configure layers in use.
+ * \brief Take and clear pending events.
  *
  */
-void oss_start(void)
+static uint32_t _oss_take_events(void)
 {
+	uint32_t ul_events;
+	uint32_t ul_notify_time;
+
+	taskENTER_CRITICAL();
+	ul_events = sul_oss_pending_events;
+	ul_notify_time = sul_oss_notify_time;
+	sul_oss_pending_events = 0;
+	taskEXIT_CRITICAL();
+
+	if (ul_events) {
+		_oss_wake_record(&sx_oss_stats.x_app_wake, ul_notify_time);
+	}
+
+	return ul_events;
+}
+
+/**
+ * \internal
+ * \brief Account the G3 stack wake-up caused by a PLC interrupt, if any.
+ *
+ */
+static void _oss_take_stack_notify(void)
+{
+	bool b_notified;
+	uint32_t ul_notify_time;
+
+	taskENTER_CRITICAL();
+	b_notified = sb_oss_stack_notified;
+	ul_notify_time = sul_oss_stack_notify_time;
+	sb_oss_stack_notified = false;
+	taskEXIT_CRITICAL();
+
+	if (b_notified) {
+		_oss_wake_record(&sx_oss_stats.x_stack_wake, ul_notify_time);
+	}
+}
+
+/**
+ * \internal
+ * \brief Update internal G3 systick with the ticks elapsed since last call.
+ *
+ * Replaces the 1 ms update timer, so that the kernel is not woken up every
+ * tick while G3 tasks are blocked. Counters are advanced in one step; the
+ * 1 ms timer callbacks are left to _oss_run_timer_callbacks().
+ *
+ */
+static void _oss_update_timers(void)
+{
+	portTickType x_now;
+	uint32_t ul_elapsed_ms;
+
+	taskENTER_CRITICAL();
+
+	x_now = xTaskGetTickCount();
+	ul_elapsed_ms = (uint32_t)(x_now - sx_last_update_tick) * portTICK_RATE_MS;
+	sx_last_update_tick = x_now;
+
+	_oss_advance_counters(ul_elapsed_ms);
+	sul_oss_pending_ms += ul_elapsed_ms;
+
+	taskEXIT_CRITICAL();
+}
+
+/**
+ * \internal
+ * \brief Run the 1 ms timer callbacks once per elapsed ms.
+ *
+ * Called from the app loop only, outside any critical section, so that
+ * callbacks are serialized with the task processes.
+ *
+ */
+static void _oss_run_timer_callbacks(void)
+{
+	uint32_t ul_ms;
+
+	taskENTER_CRITICAL();
+	ul_ms = sul_oss_pending_ms;
+	sul_oss_pending_ms = 0;
+	taskEXIT_CRITICAL();
+
+	while (ul_ms--) {
+		_oss_execute_tasks(OSS_TASK_UPDATE);
+	}
+}
+
+/**
+ * Notify events to the G3 app loop after a delay (ms).
+ *
+ * Arming again the same events moves their deadline. When every slot is in
+ * use, the events are merged into the slot expiring first. Call from a
+ * registered task process.
+ */
+void oss_notify_after(uint32_t ul_events, uint32_t ul_ms)
+{
+	oss_timer_event_t *px_slot;
+	oss_timer_event_t *px_free;
+	uint32_t ul_deadline;
+	uint8_t uc_idx;
+
+	if (ul_ms == 0) {
+		oss_notify(ul_events);
+		return;
+	}
+
+	_oss_update_timers();
+	ul_deadline = g_ms_counter + ul_ms;
+
+	px_slot = NULL;
+	px_free = NULL;
+	for (uc_idx = 0; uc_idx < OSS_TIMER_EVENT_SLOTS; uc_idx++) {
+		if (sx_oss_timer_events[uc_idx].ul_events == ul_events) {
+			px_slot = &sx_oss_timer_events[uc_idx];
+			break;
+		}
+
+		if ((sx_oss_timer_events[uc_idx].ul_events == 0) && (px_free == NULL)) {
+			px_free = &sx_oss_timer_events[uc_idx];
+		}
+	}
+
+	if (px_slot == NULL) {
+		px_slot = px_free;
+	}
+
+	if (px_slot != NULL) {
+		px_slot->ul_events = ul_events;
+		px_slot->ul_deadline = ul_deadline;
+		return;
+	}
+
+	/* No free slot: merge into the slot expiring first */
+	px_slot = &sx_oss_timer_events[0];
+	for (uc_idx = 1; uc_idx < OSS_TIMER_EVENT_SLOTS; uc_idx++) {
+		if ((int32_t)(sx_oss_timer_events[uc_idx].ul_deadline - px_slot->ul_deadline) < 0) {
+			px_slot = &sx_oss_timer_events[uc_idx];
+		}
+	}
+
+	px_slot->ul_events |= ul_events;
+	if ((int32_t)(ul_deadline - px_slot->ul_deadline) < 0) {
+		px_slot->ul_deadline = ul_deadline;
+	}
+}
+
+/**
+ * \internal
+ * \brief Take the events of expired oss_notify_after() slots.
+ *
+ */
+static uint32_t _oss_timer_events_due(void)
+{
+	uint32_t ul_events;
+	uint8_t uc_idx;
+
+	ul_events = 0;
+	for (uc_idx = 0; uc_idx < OSS_TIMER_EVENT_SLOTS; uc_idx++) {
+		if (sx_oss_timer_events[uc_idx].ul_events &&
+				((int32_t)(g_ms_counter - sx_oss_timer_events[uc_idx].ul_deadline) >= 0)) {
+			ul_events |= sx_oss_timer_events[uc_idx].ul_events;
+			sx_oss_timer_events[uc_idx].ul_events = 0;
+		}
+	}
+
+	return ul_events;
+}
+
+/**
+ * \internal
+ * \brief Get the time (ms) until the closest oss_notify_after() deadline.
+ *
+ */
+static uint32_t _oss_timer_events_timeout(uint32_t ul_timeout)
+{
+	int32_t sl_left;
+	uint8_t uc_idx;
+
+	for (uc_idx = 0; uc_idx < OSS_TIMER_EVENT_SLOTS; uc_idx++) {
+		if (sx_oss_timer_events[uc_idx].ul_events) {
+			sl_left = (int32_t)(sx_oss_timer_events[uc_idx].ul_deadline - g_ms_counter);
+			if (sl_left <= 0) {
+				return 0;
+			}
+
+			if ((uint32_t)sl_left < ul_timeout) {
+				ul_timeout = (uint32_t)sl_left;
+			}
+		}
+	}
+
+	return ul_timeout;
+}
+
+/**
+ * \internal
+ * \brief Check whether a process has to run, and set its next deadline.
+ *
+ */
+static bool _oss_sched_due(oss_sched_t *px_sched, uint32_t ul_events)
+{
+	if ((ul_events & px_sched->ul_events) ||
+			(px_sched->ul_period && ((int32_t)(g_ms_counter - px_sched->ul_next_run) >= 0))) {
+		px_sched->ul_next_run = g_ms_counter + px_sched->ul_period;
+		return true;
+	}
+
+	return false;
+}
+
+/**
+ * \internal
+ * \brief Get the time (ms) until the closest deadline.
+ *
+ */
+static uint32_t _oss_sched_timeout(oss_sched_t *px_sched, uint32_t ul_timeout)
+{
+	int32_t sl_left;
+
+	if (px_sched->ul_period) {
+		sl_left = (int32_t)(px_sched->ul_next_run - g_ms_counter);
+		if (sl_left <= 0) {
+			return 0;
+		}
+
+		if ((uint32_t)sl_left < ul_timeout) {
+			return (uint32_t)sl_left;
+		}
+	}
+
+	return ul_timeout;
+}
+
+/**
+ * \internal
+ * \brief Event-driven task to process G3 App.
+ *
+ * Registered processes, USI and IPv6 stack run only on their wake events or
+ * when their poll deadline expires. The task blocks until the next event or
+ * the closest deadline.
+ *
+ */
+static void _g3_app_process(void *pvParameters)
+{
+	uint8_t uc_idx;
+	uint32_t ul_events;
+	uint32_t ul_timeout;
+	bool b_run;
+
+	UNUSED(pvParameters);
+
+	/* App initialization (internally initializes G3 stack layers) */
+#ifdef NUM_PORTS
+	usi_init();
+#ifdef OSS_PROFILER
+	usi_set_callback(PROTOCOL_INTERNAL, _oss_prof_usi_handler, OSS_PROF_SERIAL_PORT);
+#endif
+#endif
+
+	/* Task-registered initialization */
+	_oss_execute_tasks(OSS_TASK_INIT);
+
+	for (;;) {
+		ul_events = _oss_take_events();
+		_oss_update_timers();
+		_oss_run_timer_callbacks();
+		ul_events |= _oss_timer_events_due();
+		sx_oss_stats.ul_app_wakeups++;
+
+		/* Task-registered PRIO processes */
+		_oss_execute_tasks(OSS_TASK_PROCESS_PRIO);
+
+		/* Task-registered processes */
+		b_run = false;
+		for (uc_idx = 0; uc_idx < suc_oss_num_task_registered; uc_idx++) {
+			if ((sx_oss_proc_tasks[uc_idx] != NULL) && _oss_sched_due(&sx_oss_task_sched[uc_idx], ul_events)) {
+				_oss_run_task(sx_oss_proc_tasks[uc_idx], uc_idx, OSS_TASK_PROCESS);
+				b_run = true;
+			}
+		}
+
+#ifdef NUM_PORTS
+		if (_oss_sched_due(&sx_oss_usi_sched, ul_events)) {
+			OSS_STATS_RUN(OSS_STATS_USI, usi_process());
+			b_run = true;
+		}
+#endif
+
+#ifdef OSS_ENABLE_IPv6_STACK_SUPPORT
+		if (_oss_sched_due(&sx_oss_net_sched, ul_events)) {
+			OSS_STATS_RUN(OSS_STATS_NET, netTask());
+			b_run = true;
+		}
+#endif
+
+		/* Processes may have issued G3 requests: run the stack at once */
+		if (b_run) {
+			xSemaphoreGive(sx_g3_stack_sem);
+		}
+
+		/* Block until next event or closest deadline */
+		ul_timeout = 0xFFFFFFFF;
+		for (uc_idx = 0; uc_idx < suc_oss_num_task_registered; uc_idx++) {
+			if (sx_oss_proc_tasks[uc_idx] != NULL) {
+				ul_timeout = _oss_sched_timeout(&sx_oss_task_sched[uc_idx], ul_timeout);
+			}
+		}
+#ifdef NUM_PORTS
+		ul_timeout = _oss_sched_timeout(&sx_oss_usi_sched, ul_timeout);
+#endif
+#ifdef OSS_ENABLE_IPv6_STACK_SUPPORT
+		ul_timeout = _oss_sched_timeout(&sx_oss_net_sched, ul_timeout);
+#endif
+		ul_timeout = _oss_timer_events_timeout(ul_timeout);
+
+		/* Bound the backlog of 1 ms timer callbacks run on next wake-up */
+		if (sb_oss_timer_cb && (ul_timeout > OSS_TIMER_CB_MAX_DELAY)) {
+			ul_timeout = OSS_TIMER_CB_MAX_DELAY;
+		}
+
+		if (ul_timeout == 0xFFFFFFFF) {
+			xSemaphoreTake(sx_g3_app_sem, portMAX_DELAY);
+		} else if (ul_timeout > 0) {
+			xSemaphoreTake(sx_g3_app_sem, (portTickType)(ul_timeout / portTICK_RATE_MS));
+		}
+	}
+}
+
+/**
+ * \internal
+ * \brief Get the time (ms) the G3 stack may block, 0xFFFFFFFF: no deadline.
+ *
+ * The stack keeps running at OSS_G3_STACK_EXEC_RATE until ul_active_end, for
+ * the MAC and PHY timers. Then it only has to run when its next G3 timer
+ * expires, or after OSS_G3_STACK_POLL_PERIOD if set.
+ *
+ */
+static uint32_t _oss_stack_timeout(uint32_t ul_active_end)
+{
+	uint32_t ul_timeout;
+#ifdef OSS_G3_ADP_MAC_SUPPORT
+	uint32_t ul_tenths;
+#endif
+
+	if ((int32_t)(ul_active_end - g_ms_counter) > 0) {
+		return OSS_G3_STACK_EXEC_RATE;
+	}
+
+	ul_timeout = 0xFFFFFFFF;
+#ifdef OSS_G3_ADP_MAC_SUPPORT
+	if (Timer_GetNextExpiration(&ul_tenths)) {
+		/* G3 timers expire on 100 ms counter steps */
+		if (ul_tenths == 0) {
+			ul_timeout = 0;
+		} else if (ul_tenths < (0xFFFFFFFF / 100)) {
+			ul_timeout = (ul_tenths * 100) - sul_oss_ms_rem;
+		}
+	}
+#endif
+
+#if OSS_G3_STACK_POLL_PERIOD
+	if (ul_timeout > OSS_G3_STACK_POLL_PERIOD) {
+		ul_timeout = OSS_G3_STACK_POLL_PERIOD;
+	}
+#endif
+
+#ifdef CONF_BOARD_KEEP_WATCHDOG_AT_INIT
+	if (ul_timeout > OSS_WATCHDOG_MAX_DELAY) {
+		ul_timeout = OSS_WATCHDOG_MAX_DELAY;
+	}
+#endif
+
+	return ul_timeout;
+}
+
+/**
+ * \internal
+ * \brief Event-driven task to process G3. Initialize and start every layers.
+ *
+ * The stack runs on every PLC interrupt notification, after app process runs
+ * and when its next deadline expires (see _oss_stack_timeout()). It blocks
+ * without timeout when there is none.
+ *
+ */
+static void _g3_stack_process(void *pvParameters)
+{
+	portTickType xLastWakeTime;
+	uint32_t ul_active_end;
+	uint32_t ul_timeout;
+	bool b_woken;
+
+	UNUSED(pvParameters);
+
+#ifndef _G3_SIM_
+	/* Start timer to blink led */
+	xTimerStart(xLEDTimer, G3_LED_PROCESS_TIMER_RATE);
+#endif
+
+	/* Initial delay on G3 process to allow for correct initialization */
+	xLastWakeTime = xTaskGetTickCount();
+	vTaskDelayUntil(&xLastWakeTime, G3_PROCESS_INITIAL_DELAY);
+
+	/* Layers are initialized by the app: active from the start */
+	_oss_update_timers();
+	ul_active_end = g_ms_counter + OSS_G3_STACK_ACTIVE_TIME;
+	ul_timeout = 0;
+
+	for (;;) {
+		/* Reset watchdog */
+		RESET_WATCHDOG;
+
+		if (ul_timeout == 0xFFFFFFFF) {
+			b_woken = (xSemaphoreTake(sx_g3_stack_sem, portMAX_DELAY) == pdTRUE);
+		} else {
+			b_woken = (xSemaphoreTake(sx_g3_stack_sem, (portTickType)(ul_timeout / portTICK_RATE_MS)) == pdTRUE);
+		}
+
+		if (b_woken) {
+			_oss_take_stack_notify();
+		}
+
+		_oss_update_timers();
+		if (b_woken) {
+			ul_active_end = g_ms_counter + OSS_G3_STACK_ACTIVE_TIME;
+		}
+
+		sx_oss_stats.ul_stack_wakeups++;
+
+#ifdef OSS_G3_ADP_MAC_SUPPORT
+		/* Internally calls MAC and PHY Event handlers */
+		OSS_STATS_RUN(OSS_STATS_G3_STACK, AdpEventHandler());
+#endif
+
+		ul_timeout = _oss_stack_timeout(ul_active_end);
+	}
+}
+
+#else /* OSS_EVENT_DRIVEN */
+
+/**
+ * Notify events to G3 tasks. Processes are polled at a fixed rate, nothing to do.
+ */
+void oss_notify(uint32_t ul_events)
+{
+	UNUSED(ul_events);
+}
+
+/**
+ * Notify events to G3 tasks from interrupt context
+ */
+void oss_notify_from_isr(uint32_t ul_events)
+{
+	UNUSED(ul_events);
+}
+
+/**
+ * Notify events to G3 tasks after a delay. Processes are polled, nothing to do.
+ */
+void oss_notify_after(uint32_t ul_events, uint32_t ul_ms)
+{
+	UNUSED(ul_events);
+	UNUSED(ul_ms);
+}
+
+/**
+ * \internal
+ * \brief Periodic task to process G3 App.
+ *
+ */
+static void _g3_app_process(void *pvParameters)
+{
+	static portTickType xLastWakeTime;
+	static portTickType xPeriod;
+
+	/* App initialization (internally initializes G3 stack layers) */
+#ifdef NUM_PORTS
+	usi_init();
+#ifdef OSS_PROFILER
+	usi_set_callback(PROTOCOL_INTERNAL, _oss_prof_usi_handler, OSS_PROF_SERIAL_PORT);
+#endif
+#endif
+
+	/* Task-registered initialization */
+	_oss_execute_tasks(OSS_TASK_INIT);
+
+	xPeriod = G3_APP_PROCESS_EXEC_RATE;
+	xLastWakeTime = xTaskGetTickCount();
+	for (;;) {
+		sx_oss_stats.ul_app_wakeups++;
+
+		/* Task-registered PRIO processes */
+		_oss_execute_tasks(OSS_TASK_PROCESS_PRIO);
+		/* Task-registered processes */
+		_oss_execute_tasks(OSS_TASK_PROCESS);
+
+#ifdef NUM_PORTS
+		OSS_STATS_RUN(OSS_STATS_USI, usi_process());
+#endif
+
+#ifdef OSS_ENABLE_IPv6_STACK_SUPPORT
+		OSS_STATS_RUN(OSS_STATS_NET, netTask());
+#endif
+
+		xLastWakeTime = xTaskGetTickCount();
+		vTaskDelayUntil(&xLastWakeTime, xPeriod);
+	}
+}
+
+/**
+ * \internal
+ * \brief Periodic task to process G3. Initialize and start every layers.
+ * \note Please see conf_oss file in order to configure the layers to execute.
+ *
+ */
+static void _g3_stack_process(void *pvParameters)
+{
+	static portTickType xLastWakeTime;
+	static portTickType xPeriod;
+
+	UNUSED(pvParameters);
+
+#ifndef _G3_SIM_
+	/* Start timer to update counters */
+	xTimerStart(xUpdateTimer, G3_UPDATE_TIMERS_RATE);
+	/* Start timer to blink led */
+	xTimerStart(xLEDTimer, G3_LED_PROCESS_TIMER_RATE);
+#endif
+
+	/* Initial delay on G3 process to allow for correct initialization */
+	xPeriod = G3_PROCESS_INITIAL_DELAY;
+	xLastWakeTime = xTaskGetTickCount();
+	vTaskDelayUntil(&xLastWakeTime, xPeriod);
+
+	xPeriod = G3_PROCESS_EXEC_RATE;
+	xLastWakeTime = xTaskGetTickCount();
+	for (;;) {
+		/* Reset watchdog */
+		RESET_WATCHDOG;
+
+		vTaskDelayUntil(&xLastWakeTime, xPeriod);
+		sx_oss_stats.ul_stack_wakeups++;
+
+#ifdef _G3_SIM_
+		_oss_1ms_timer_handler();
+#endif
+
+#ifdef OSS_G3_ADP_MAC_SUPPORT
+		/* Internally calls MAC and PHY Event handlers */
+		OSS_STATS_RUN(OSS_STATS_G3_STACK, AdpEventHandler());
+#endif
+	}
+}
+
+#endif /* OSS_EVENT_DRIVEN */
+
+/**
+ * \internal
+ * \brief Create main G3 task and create timer to update internal counters.
+ * \note Please see conf_oss file in order to configure layers in use.
+ *
+ */
+void oss_start(void)
+{
+#ifdef OSS_EVENT_DRIVEN
+	/* Create wake-up semaphores, initially taken */
+	vSemaphoreCreateBinary(sx_g3_app_sem);
+	vSemaphoreCreateBinary(sx_g3_stack_sem);
+	configASSERT(sx_g3_app_sem);
+	configASSERT(sx_g3_stack_sem);
+	xSemaphoreTake(sx_g3_app_sem, 0);
+	xSemaphoreTake(sx_g3_stack_sem, 0);
+#endif
+
 	/* Create new task to call processes */
 	xTaskCreate(_g3_stack_process, (const signed char *const)"G3Proc",
 			TASK_G3_STACK, NULL, TASK_G3_PRIO, &xG3Hnd);
@@ -432,6 +1421,7 @@ void oss_start(void)
 			TASK_G3_APP, NULL, TASK_G3_APP_PRIO, &xG3AppHnd);
 
 #ifndef _G3_SIM_
+#ifndef OSS_EVENT_DRIVEN
 	/* Create timer to update counters */
 	xUpdateTimer = xTimerCreate((const signed char *const)"UPD timer",  /* A text name, purely to help debugging. */
 			G3_UPDATE_TIMERS_RATE,                                      /* The timer period. */
@@ -439,6 +1429,8 @@ void oss_start(void)
 			NULL,                                                       /* The timer does not use its ID, so the ID is just set to NULL. */
 			_update_1ms_proc                                            /* The function that is called each time the timer expires. */
 			);
+	configASSERT(xUpdateTimer);
+#endif
 	/* Create timer to blink LED */
 	xLEDTimer = xTimerCreate((const signed char *const)"LED blink",     /* A text name, purely to help debugging. */
 			G3_LED_PROCESS_TIMER_RATE,                                  /* The timer period. */
@@ -447,7 +1439,6 @@ void oss_start(void)
 			_blink_led                                                  /* The function that is called each time the timer expires. */
 			);
 
-	configASSERT(xUpdateTimer);
 	configASSERT(xLEDTimer);
 #endif
 
@@ -475,6 +1466,88 @@ void oss_start(void)
 
 #else /* OSS_USE_FREERTOS */
 
+#ifdef OSS_EVENT_DRIVEN
+
+/**
+ * Notify events to G3 tasks. App processes run on the next main loop iteration.
+ */
+void oss_notify(uint32_t ul_events)
+{
+	irqflags_t flags;
+	uint32_t ul_now;
+
+	ul_now = OSS_TIMESTAMP();
+
+	flags = cpu_irq_save();
+	if (sul_oss_pending_events == 0) {
+		sul_oss_notify_time = ul_now;
+	}
+
+	sul_oss_pending_events |= ul_events;
+	cpu_irq_restore(flags);
+}
+
+#else /* OSS_EVENT_DRIVEN */
+
+/**
+ * Notify events to G3 tasks. Processes are polled at a fixed rate, nothing to do.
+ */
+void oss_notify(uint32_t ul_events)
+{
+	UNUSED(ul_events);
+}
+
+#endif /* OSS_EVENT_DRIVEN */
+
+/**
+ * Notify events to G3 tasks from interrupt context
+ */
+void oss_notify_from_isr(uint32_t ul_events)
+{
+	oss_notify(ul_events);
+}
+
+/**
+ * Notify events to G3 tasks after a delay. App processes are polled at
+ * OSS_APP_EXEC_RATE, nothing to do.
+ */
+void oss_notify_after(uint32_t ul_events, uint32_t ul_ms)
+{
+	UNUSED(ul_events);
+	UNUSED(ul_ms);
+}
+
+#ifdef OSS_EVENT_DRIVEN
+
+/**
+ * \internal
+ * \brief Take and clear pending events.
+ *
+ */
+static uint32_t _oss_take_events(void)
+{
+	irqflags_t flags;
+	uint32_t ul_events;
+	uint32_t ul_notify_time;
+
+	flags = cpu_irq_save();
+	ul_events = sul_oss_pending_events;
+	ul_notify_time = sul_oss_notify_time;
+	sul_oss_pending_events = 0;
+	cpu_irq_restore(flags);
+
+	if (ul_events) {
+		_oss_wake_record(&sx_oss_stats.x_app_wake, ul_notify_time);
+		if (ul_events & OSS_EVENT_PLC_IRQ) {
+			_oss_wake_record(&sx_oss_stats.x_stack_wake, ul_notify_time);
+		}
+	}
+
+	return ul_events;
+}
+
+#endif /* OSS_EVENT_DRIVEN */
+
 /**
  * \internal
  * \brief Run G3 stack and App in microcontroller mode (no OS)
@@ -483,6 +1556,8 @@ void oss_start(void)
  */
 void oss_start(void)
 {
+	uint32_t ul_events;
+
 	/* Set up timer interrupt and user defined callback */
 	platform_set_ms_callback(&_oss_1ms_timer_handler);
 	platform_led_cfg_blink_rate(OSS_LED_BLINK_RATE);
@@ -506,6 +1581,9 @@ void oss_start(void)
 #ifdef NUM_PORTS
 	/* Initialize USI */
 	usi_init();
+#ifdef OSS_PROFILER
+	usi_set_callback(PROTOCOL_INTERNAL, _oss_prof_usi_handler, OSS_PROF_SERIAL_PORT);
+#endif
 #endif
 	/* Print Welcome msg */
 	printf("G3 ADP Serialized App\r\n\r\n");
@@ -520,25 +1598,36 @@ void oss_start(void)
 		/* Reset watchdog */
 		RESET_WATCHDOG;
 
-		if (platform_flag_call_process()) {
+#ifdef OSS_EVENT_DRIVEN
+		/* Notified events run the G3 stack and app without waiting for their period */
+		ul_events = _oss_take_events();
+#else
+		ul_events = 0;
+#endif
+
+		if ((ul_events & OSS_EVENT_PLC_IRQ) || platform_flag_call_process()) {
+			sx_oss_stats.ul_stack_wakeups++;
+
 			/* G3 stack process */
 			#ifdef OSS_G3_ADP_MAC_SUPPORT
 			/* Internally calls MAC and PHY Event handlers */
-			AdpEventHandler();
+			OSS_STATS_RUN(OSS_STATS_G3_STACK, AdpEventHandler());
 			#endif
 		}
 
-		if (platform_flag_call_app_process()) {
+		if (ul_events || platform_flag_call_app_process()) {
+			sx_oss_stats.ul_app_wakeups++;
+
 			/* Task-registered processes */
 			_oss_execute_tasks(OSS_TASK_PROCESS);
 
 			#ifdef NUM_PORTS
-			usi_process();
+			OSS_STATS_RUN(OSS_STATS_USI, usi_process());
 			#endif
 
 			/* Handle TCP/IP events */
 			#ifdef OSS_ENABLE_IPv6_STACK_SUPPORT
-			netTask();
+			OSS_STATS_RUN(OSS_STATS_NET, netTask());
 			#endif
 		}
 
@@ -57,6 +57,8 @@ extern "C" {
  * @{
  */
 
+#include <stdbool.h>
+#include <stdint.h>
 #include "conf_oss.h"
 
 /* ! \name G3 Stack priority */
@@ -132,6 +134,99 @@ extern "C" {
 #define G3_APP_PROCESS_EXEC_RATE                (OSS_APP_EXEC_RATE / portTICK_RATE_MS)
 /* @} */
 
+/* ! \name Maximum number of registered tasks */
+/* @{ */
+#ifndef OSS_IF_MAX_TASKS
+#define OSS_IF_MAX_TASKS                        5
+#endif
+/* @} */
+
+/* ! \name Wake-up events (event-driven mode) */
+/* ! \note Define OSS_EVENT_DRIVEN in conf_oss.h to run the G3 tasks on */
+/* ! notified events. With FreeRTOS, the G3 tasks block until an event is */
+/* ! notified or their next deadline expires (G3 stack timers, IPv6 stack */
+/* ! tick, task poll periods), and forever when there is none, instead of */
+/* ! running every task at a fixed rate. Without OS, the main loop keeps its */
+/* ! fixed rates and also runs the G3 stack on OSS_EVENT_PLC_IRQ and the app */
+/* ! processes on any notified event at once. Drivers signal events with */
+/* ! oss_notify_from_isr() from their interrupt handlers: OSS_EVENT_PLC_IRQ from */
+/* ! the PLC external interrupt, and OSS_EVENT_USI_RX from the serial RX */
+/* ! interrupts through the BUSART_RX_NOTIFY/BUART_RX_NOTIFY hooks of */
+/* ! conf_busart_if.h/conf_buart_if.h. With FreeRTOS, those interrupts must */
+/* ! have a priority value not lower than */
+/* ! configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY (see PPLC_PRIO). Tasks arm */
+/* ! timed events with oss_notify_after(). */
+/* @{ */
+#define OSS_EVENT_USI_RX                        (1u << 0)
+#define OSS_EVENT_PLC_IRQ                       (1u << 1)
+#define OSS_EVENT_TIMER                         (1u << 2)
+#define OSS_EVENT_NET                           (1u << 3)
+#define OSS_EVENT_USER                          (1u << 4)
+#define OSS_EVENT_ALL                           0xFFFFFFFFu
+/* @} */
+
+/* ! \name Event-driven mode: number of pending oss_notify_after() events */
+/* @{ */
+#ifndef OSS_TIMER_EVENT_SLOTS
+#define OSS_TIMER_EVENT_SLOTS                   4
+#endif
+/* @} */
+
+/* ! \name Event-driven mode: maximum time (ms) the app loop blocks while */
+/* ! 1 ms timer callbacks are registered (they run from the app loop) */
+/* @{ */
+#ifndef OSS_TIMER_CB_MAX_DELAY
+#define OSS_TIMER_CB_MAX_DELAY                  100
+#endif
+/* @} */
+
+/* ! \name Event-driven mode: time (ms) the G3 stack keeps running at */
+/* ! OSS_G3_STACK_EXEC_RATE after a PLC interrupt or an app process run */
+/* ! \note MAC and PHY timers (backoff, acknowledgement wait...) are not */
+/* ! registered with the G3 timers, so their deadline is unknown. 0 lets the */
+/* ! stack sleep until its next G3 timer right after every run */
+/* @{ */
+#ifndef OSS_G3_STACK_ACTIVE_TIME
+#define OSS_G3_STACK_ACTIVE_TIME                1000
+#endif
+/* @} */
+
+/* ! \name Event-driven mode: maximum time (ms) between G3 stack runs */
+/* ! \note 0 (default): no periodic run. The stack runs on every */
+/* ! OSS_EVENT_PLC_IRQ, after app process runs, and when its next G3 timer */
+/* ! expires */
+/* @{ */
+#ifndef OSS_G3_STACK_POLL_PERIOD
+#define OSS_G3_STACK_POLL_PERIOD                0
+#endif
+/* @} */
+
+/* ! \name Event-driven mode: maximum time (ms) between USI runs */
+/* ! \note 0 (default): USI only runs on OSS_EVENT_USI_RX. Set it for ports */
+/* ! without RX notification (USB CDC) */
+/* @{ */
+#ifndef OSS_USI_POLL_PERIOD
+#define OSS_USI_POLL_PERIOD                     0
+#endif
+/* @} */
+
+/* ! \name Event-driven mode: maximum time (ms) between IPv6 stack runs */
+/* ! \note 0 (default): the IPv6 stack runs on OSS_EVENT_NET and every */
+/* ! NET_TICK_INTERVAL ms, the period of its own timers */
+/* @{ */
+#ifndef OSS_NET_POLL_PERIOD
+#define OSS_NET_POLL_PERIOD                     0
+#endif
+/* @} */
+
+/* ! \name Event-driven mode: maximum time (ms) the G3 stack blocks while the */
+/* ! watchdog is kept enabled (CONF_BOARD_KEEP_WATCHDOG_AT_INIT) */
+/* @{ */
+#ifndef OSS_WATCHDOG_MAX_DELAY
+#define OSS_WATCHDOG_MAX_DELAY                  1000
+#endif
+/* @} */
+
 typedef void (*pfv_t)(void);
 
 enum oss_task_type {
@@ -146,8 +241,82 @@ typedef struct oss_task {
 	pfv_t task_process;
 	pfv_t task_1ms_timer_cb;
 	pfv_t task_process_prio;
+	/* Event-driven mode: OSS_EVENT_* waking task_process. */
+	/* 0 keeps the task polled at OSS_APP_EXEC_RATE */
+	uint32_t ul_wake_events;
+	/* Event-driven mode: maximum time (ms) between task_process runs. */
+	/* 0 runs the task only on its wake events */
+	uint32_t ul_poll_period;
 } oss_task_t;
 
+/* ! \name Run-time statistics */
+/* ! \note Every G3 stack, USI, IPv6 stack and task call is timed with the */
+/* ! OSS time base (DWT cycle counter on target, clock_gettime on host, or */
+/* ! OSS_TIMESTAMP/OSS_TIMESTAMP_FREQ from conf_oss.h). Define OSS_PROFILER */
+/* ! in conf_oss.h to also keep a log2 histogram of every entry (p99), and to */
+/* ! export results through USI protocol PROTOCOL_INTERNAL and oss_prof_dump(). */
+/* @{ */
+#ifndef OSS_PROF_HIST_BUCKETS
+#define OSS_PROF_HIST_BUCKETS                   16
+#endif
+
+/* First bucket upper limit is 2^OSS_PROF_HIST_SHIFT; each next one doubles it */
+#ifndef OSS_PROF_HIST_SHIFT
+#define OSS_PROF_HIST_SHIFT                     6
+#endif
+
+#ifndef OSS_PROF_SERIAL_PORT
+#define OSS_PROF_SERIAL_PORT                    0
+#endif
+
+/* Timed entries: G3 stack, USI, IPv6 stack, then process/update/prio per task */
+enum oss_stats_id {
+	OSS_STATS_G3_STACK,
+	OSS_STATS_USI,
+	OSS_STATS_NET,
+	OSS_STATS_TASK_BASE,
+};
+
+#define OSS_STATS_TASK_ID(idx, ttype)           (OSS_STATS_TASK_BASE + ((idx) * 3) + ((ttype) - OSS_TASK_PROCESS))
+#define OSS_STATS_ENTRIES                       (OSS_STATS_TASK_BASE + (OSS_IF_MAX_TASKS * 3))
+
+/* USI commands (PROTOCOL_INTERNAL) */
+#define OSS_PROF_CMD_GET                        0x00
+#define OSS_PROF_CMD_RESET                      0x01
+
+typedef struct oss_run_stats {
+	uint32_t ul_count;      /* Calls */
+	uint32_t ul_min;        /* Run time of a call, in OSS time base units */
+	uint32_t ul_max;
+	uint64_t ull_total;
+#ifdef OSS_PROFILER
+	uint32_t aul_hist[OSS_PROF_HIST_BUCKETS];
+#endif
+} oss_run_stats_t;
+
+typedef struct oss_wake_stats {
+	uint32_t ul_count;      /* Wake-ups caused by a notified event */
+	uint32_t ul_last;       /* Notification to wake-up latency, in OSS time base units */
+	uint32_t ul_max;
+} oss_wake_stats_t;
+
+typedef struct oss_stats {
+	uint32_t ul_app_wakeups;      /* App loop iterations */
+	uint32_t ul_stack_wakeups;    /* G3 stack loop iterations */
+	oss_wake_stats_t x_app_wake;  /* App loop wake-ups on notified events */
+	oss_wake_stats_t x_stack_wake; /* G3 stack wake-ups on OSS_EVENT_PLC_IRQ */
+	oss_run_stats_t x_run[OSS_STATS_ENTRIES];
+} oss_stats_t;
+
+typedef struct oss_prof_summary {
+	uint32_t ul_count;
+	uint32_t ul_min;
+	uint32_t ul_avg;
+	uint32_t ul_max;
+	uint32_t ul_p99;     /* Upper limit of the histogram bucket holding the 99th percentile */
+} oss_prof_summary_t;
+/* @} */
+
 /* ! \name G3 OSS interface API */
 /* @{ */
 uint32_t oss_get_up_time_ms(void);
@@ -158,6 +327,18 @@ void oss_init(void);
 void oss_start(void);
 int oss_register_task(oss_task_t *app_task);
 
+void oss_notify(uint32_t ul_events);
+void oss_notify_from_isr(uint32_t ul_events);
+void oss_notify_after(uint32_t ul_events, uint32_t ul_ms);
+const oss_stats_t *oss_get_stats(void);
+uint32_t oss_get_stats_freq(void);
+void oss_reset_stats(void);
+
+#ifdef OSS_PROFILER
+bool oss_prof_get_summary(uint8_t uc_id, oss_prof_summary_t *px_summary);
+void oss_prof_dump(void);
+#endif
+
 /* @} */
 /* ! @} */
 
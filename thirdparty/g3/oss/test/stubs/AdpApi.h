@@ -0,0 +1,7 @@
+/* Host stub of the ADP API used by oss_if.c */
+#ifndef ADP_API_STUB_H
+#define ADP_API_STUB_H
+
+void AdpEventHandler(void);
+
+#endif /* ADP_API_STUB_H */
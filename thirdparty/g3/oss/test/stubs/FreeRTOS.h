@@ -0,0 +1,50 @@
+/* Host stub of the FreeRTOS 7.3 API used by oss_if.c */
+#ifndef FREERTOS_STUB_H
+#define FREERTOS_STUB_H
+
+#include <stdint.h>
+
+#define portBASE_TYPE                           long
+typedef uint32_t portTickType;
+typedef void *xTaskHandle;
+typedef void *xTimerHandle;
+typedef struct stub_sem *xSemaphoreHandle;
+
+#define portTICK_RATE_MS                        ((portTickType)1)
+#define portMAX_DELAY                           ((portTickType)0xFFFFFFFF)
+#define pdTRUE                                  1
+#define pdFALSE                                 0
+#define tskIDLE_PRIORITY                        0
+#define configMINIMAL_STACK_SIZE                100
+#define configGENERATE_RUN_TIME_STATS           0
+#define configASSERT(x)                         do { if (!(x)) { stub_assert_failed(__FILE__, __LINE__); } } while (0)
+
+/* Critical sections and interrupt masking only track the nesting level */
+extern int stub_crit_nesting;
+#define taskENTER_CRITICAL()                    (stub_crit_nesting++)
+#define taskEXIT_CRITICAL()                     (stub_crit_nesting--)
+#define taskDISABLE_INTERRUPTS()
+#define portSET_INTERRUPT_MASK_FROM_ISR()       (stub_crit_nesting++)
+#define portCLEAR_INTERRUPT_MASK_FROM_ISR(x)    ((void)(x), stub_crit_nesting--)
+#define portEND_SWITCHING_ISR(x)                (void)(x)
+
+struct stub_sem {
+	int given;
+};
+
+void stub_assert_failed(const char *file, int line);
+
+portTickType xTaskGetTickCount(void);
+void vTaskDelayUntil(portTickType *px_prev, portTickType x_inc);
+portBASE_TYPE xTaskCreate(void (*pf_task)(void *), const signed char *const name, int stack, void *param, int prio, xTaskHandle *px_hnd);
+void vTaskStartScheduler(void);
+xTimerHandle xTimerCreate(const signed char *const name, portTickType period, int reload, void *id, void (*pf_cb)(xTimerHandle));
+portBASE_TYPE xTimerStart(xTimerHandle x_timer, portTickType x_block);
+
+#define vSemaphoreCreateBinary(s)               ((s) = stub_sem_create())
+xSemaphoreHandle stub_sem_create(void);
+portBASE_TYPE xSemaphoreTake(xSemaphoreHandle x_sem, portTickType x_block);
+portBASE_TYPE xSemaphoreGive(xSemaphoreHandle x_sem);
+portBASE_TYPE xSemaphoreGiveFromISR(xSemaphoreHandle x_sem, portBASE_TYPE *px_woken);
+
+#endif /* FREERTOS_STUB_H */
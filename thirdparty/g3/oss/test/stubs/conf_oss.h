@@ -0,0 +1,13 @@
+/* Host test configuration of the OSS */
+#ifndef CONF_OSS_H_INCLUDE
+#define CONF_OSS_H_INCLUDE
+
+#define OSS_LED_BLINK_RATE        300
+#define OSS_G3_ADP_MAC_SUPPORT
+
+/* OSS time base: test clock */
+uint32_t stub_timestamp(void);
+#define OSS_TIMESTAMP()           stub_timestamp()
+#define OSS_TIMESTAMP_FREQ        1000000UL
+
+#endif  /* CONF_OSS_H_INCLUDE */
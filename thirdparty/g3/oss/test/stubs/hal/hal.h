@@ -0,0 +1,8 @@
+/* Host stub of the HAL definitions used by oss_if.c */
+#ifndef HAL_STUB_H
+#define HAL_STUB_H
+
+#define UNUSED(v)                 (void)(v)
+#define RESET_WATCHDOG
+
+#endif /* HAL_STUB_H */
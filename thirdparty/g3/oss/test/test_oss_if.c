@@ -0,0 +1,658 @@
+/**
+ * \file
+ *
+ * \brief OSS event-driven scheduler host test.
+ *
+ * Builds oss_if.c with OSS_EVENT_DRIVEN on top of FreeRTOS stubs and checks:
+ * - counters advanced in one step match the per-ms update,
+ * - 1 ms timer callbacks run outside critical sections, once per elapsed ms,
+ * - notified events wake the app loop and the G3 stack at once, and the
+ *   notification to wake-up latency is accounted,
+ * - app process runs wake the G3 stack, 1 ms timer callbacks do not,
+ * - the G3 stack keeps running at its rate for OSS_G3_STACK_ACTIVE_TIME after
+ *   a wake-up, then blocks until its next G3 timer, or forever when there is
+ *   none (at most OSS_G3_STACK_POLL_PERIOD when it is set),
+ * - oss_notify_after() events wake the app loop at their deadline,
+ * - run times are accounted per entry, and no timestamp is taken inside a
+ *   critical section,
+ * - with OSS_PROFILER, the histogram gives the p99 of every entry.
+ *
+ * The blocking calls of the G3 tasks are driven by a per-test scenario; the
+ * task loops are left with longjmp() when the scenario ends.
+ *
+ */
+
+#include <setjmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "FreeRTOS.h"
+#include "oss_if.h"
+
+int stub_crit_nesting;
+
+static jmp_buf sx_exit;
+static portTickType sx_tick;
+static uint32_t sul_run_time;
+static uint32_t sul_ts_in_critical;
+static struct stub_sem sx_sems[2];
+static uint8_t suc_sems;
+static int si_failures;
+
+/* Scenario run on every block: returns false to leave the task loop */
+static bool (*spf_block)(xSemaphoreHandle x_sem, portTickType x_block);
+
+#define CHECK(cond) \
+	do { \
+		if (!(cond)) { \
+			printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+			si_failures++; \
+		} \
+	} while (0)
+
+void stub_assert_failed(const char *file, int line)
+{
+	printf("  ASSERT %s:%d\n", file, line);
+	si_failures++;
+}
+
+uint32_t stub_timestamp(void)
+{
+	if (stub_crit_nesting) {
+		sul_ts_in_critical++;
+	}
+
+	return sul_run_time;
+}
+
+portTickType xTaskGetTickCount(void)
+{
+	return sx_tick;
+}
+
+void vTaskDelayUntil(portTickType *px_prev, portTickType x_inc)
+{
+	sx_tick = *px_prev + x_inc;
+	*px_prev = sx_tick;
+}
+
+portBASE_TYPE xTaskCreate(void (*pf_task)(void *), const signed char *const name, int stack, void *param, int prio, xTaskHandle *px_hnd)
+{
+	(void)pf_task; (void)name; (void)stack; (void)param; (void)prio; (void)px_hnd;
+	return pdTRUE;
+}
+
+void vTaskStartScheduler(void)
+{
+}
+
+xTimerHandle xTimerCreate(const signed char *const name, portTickType period, int reload, void *id, void (*pf_cb)(xTimerHandle))
+{
+	(void)name; (void)period; (void)reload; (void)id; (void)pf_cb;
+	return NULL;
+}
+
+portBASE_TYPE xTimerStart(xTimerHandle x_timer, portTickType x_block)
+{
+	(void)x_timer; (void)x_block;
+	return pdTRUE;
+}
+
+xSemaphoreHandle stub_sem_create(void)
+{
+	sx_sems[suc_sems].given = 1;
+	return &sx_sems[suc_sems++];
+}
+
+portBASE_TYPE xSemaphoreGive(xSemaphoreHandle x_sem)
+{
+	x_sem->given = 1;
+	return pdTRUE;
+}
+
+portBASE_TYPE xSemaphoreGiveFromISR(xSemaphoreHandle x_sem, portBASE_TYPE *px_woken)
+{
+	x_sem->given = 1;
+	*px_woken = pdTRUE;
+	return pdTRUE;
+}
+
+portBASE_TYPE xSemaphoreTake(xSemaphoreHandle x_sem, portTickType x_block)
+{
+	CHECK(stub_crit_nesting == 0);
+
+	if (x_sem->given) {
+		x_sem->given = 0;
+		return pdTRUE;
+	}
+
+	if (x_block == 0) {
+		return pdFALSE;
+	}
+
+	if (!spf_block(x_sem, x_block)) {
+		longjmp(sx_exit, 1);
+	}
+
+	if (x_sem->given) {
+		x_sem->given = 0;
+		return pdTRUE;
+	}
+
+	return pdFALSE;
+}
+
+static uint32_t sul_stack_runs;
+
+/* G3 timer of the stack: deadline on the 100 ms counter, and its fire times */
+static bool sb_g3_timer;
+static uint32_t sul_g3_timer_deadline;
+static uint32_t saul_g3_fire_ms[4];
+static uint32_t sul_g3_fires;
+
+bool Timer_GetNextExpiration(uint32_t *pu32TenthsSeconds)
+{
+	int32_t sl_left;
+
+	if (!sb_g3_timer) {
+		return false;
+	}
+
+	sl_left = (int32_t)(sul_g3_timer_deadline - oss_get_up_time_100ms());
+	*pu32TenthsSeconds = (sl_left > 0) ? (uint32_t)sl_left : 0;
+	return true;
+}
+
+void AdpEventHandler(void)
+{
+	sul_stack_runs++;
+	if (sb_g3_timer && ((int32_t)(oss_get_up_time_100ms() - sul_g3_timer_deadline) >= 0)) {
+		sb_g3_timer = false;
+		if (sul_g3_fires < 4) {
+			saul_g3_fire_ms[sul_g3_fires] = oss_get_up_time_ms();
+		}
+
+		sul_g3_fires++;
+	}
+}
+
+/* Include the module under test to reach its internal state */
+#include "../oss_if.c"
+
+/* Restart the OSS as after reset */
+static void _reset(void)
+{
+	oss_init();
+	g_ms_counter = 0;
+	g_100ms_counter = 0;
+	g_10s_counter = 0;
+	sul_oss_ms_rem = 0;
+	sul_oss_100ms_rem = 0;
+	sx_last_update_tick = 0;
+	sx_tick = 0;
+	sul_run_time = 0;
+	sul_ts_in_critical = 0;
+	suc_sems = 0;
+	stub_crit_nesting = 0;
+	sul_stack_runs = 0;
+	sb_g3_timer = false;
+	sul_g3_fires = 0;
+	vSemaphoreCreateBinary(sx_g3_app_sem);
+	vSemaphoreCreateBinary(sx_g3_stack_sem);
+	xSemaphoreTake(sx_g3_app_sem, 0);
+	xSemaphoreTake(sx_g3_stack_sem, 0);
+}
+
+static void _run_app_loop(bool (*pf_block)(xSemaphoreHandle, portTickType))
+{
+	spf_block = pf_block;
+	if (!setjmp(sx_exit)) {
+		_g3_app_process(NULL);
+	}
+
+	CHECK(stub_crit_nesting == 0);
+	CHECK(sul_ts_in_critical == 0);
+}
+
+static void _run_stack_loop(bool (*pf_block)(xSemaphoreHandle, portTickType))
+{
+	spf_block = pf_block;
+	if (!setjmp(sx_exit)) {
+		_g3_stack_process(NULL);
+	}
+
+	CHECK(stub_crit_nesting == 0);
+	CHECK(sul_ts_in_critical == 0);
+}
+
+/*
+ * Counters: one-step advance against the per-ms reference
+ */
+static void test_counters(void)
+{
+	uint32_t ul_ref_ms = 0, ul_ref_100ms = 0, ul_ref_10s = 0;
+	uint32_t ul_step, ul_i;
+	int i_iter;
+
+	printf("counters\n");
+	_reset();
+	srand(1);
+	for (i_iter = 0; i_iter < 2000; i_iter++) {
+		ul_step = (i_iter % 10 == 0) ? (uint32_t)(rand() % 30000) : (uint32_t)(rand() % 150);
+		for (ul_i = 0; ul_i < ul_step; ul_i++) {
+			ul_ref_ms++;
+			if ((ul_ref_ms % 100) == 0) {
+				ul_ref_100ms++;
+				if ((ul_ref_100ms % 100) == 0) {
+					ul_ref_10s++;
+				}
+			}
+		}
+
+		_oss_advance_counters(ul_step);
+		if ((oss_get_up_time_ms() != ul_ref_ms) || (oss_get_up_time_100ms() != ul_ref_100ms) ||
+				(oss_get_up_time_10s() != ul_ref_10s)) {
+			break;
+		}
+	}
+
+	CHECK(oss_get_up_time_ms() == ul_ref_ms);
+	CHECK(oss_get_up_time_100ms() == ul_ref_100ms);
+	CHECK(oss_get_up_time_10s() == ul_ref_10s);
+	printf("  %u ms, %u x 100 ms, %u x 10 s\n", ul_ref_ms, ul_ref_100ms, ul_ref_10s);
+}
+
+/*
+ * 1 ms timer callbacks: outside critical sections, once per elapsed ms
+ */
+static uint32_t sul_cb_runs;
+static uint32_t sul_cb_in_critical;
+static uint32_t sul_max_block;
+static uint32_t sul_blocks;
+
+static void _timer_cb(void)
+{
+	sul_cb_runs++;
+	if (stub_crit_nesting) {
+		sul_cb_in_critical++;
+	}
+}
+
+static void _idle_process(void)
+{
+}
+
+static bool _block_timer_cb(xSemaphoreHandle x_sem, portTickType x_block)
+{
+	(void)x_sem;
+
+	if (++sul_blocks > 50) {
+		return false;
+	}
+
+	if (x_block > sul_max_block) {
+		sul_max_block = x_block;
+	}
+
+	sx_tick += x_block;
+	return true;
+}
+
+static void test_timer_callbacks(void)
+{
+	oss_task_t x_task = {0};
+
+	printf("timer callbacks\n");
+	_reset();
+	sul_cb_runs = 0;
+	sul_cb_in_critical = 0;
+	sul_max_block = 0;
+	sul_blocks = 0;
+
+	x_task.task_process = _idle_process;
+	x_task.task_1ms_timer_cb = _timer_cb;
+	x_task.ul_wake_events = OSS_EVENT_USER;
+	oss_register_task(&x_task);
+	_run_app_loop(_block_timer_cb);
+
+	/* The last block does not return: its time is not elapsed */
+	CHECK(sul_cb_runs == oss_get_up_time_ms());
+	CHECK(sul_cb_in_critical == 0);
+	CHECK(sul_max_block == OSS_TIMER_CB_MAX_DELAY);
+	/* No process has run: nothing for the G3 stack */
+	CHECK(!sx_g3_stack_sem->given);
+	printf("  %u callbacks in %u ms, %u in critical section, max block %u ms\n",
+			sul_cb_runs, oss_get_up_time_ms(), sul_cb_in_critical, sul_max_block);
+}
+
+/*
+ * Notified events: wake-up on the event only, latency accounted
+ */
+#define TEST_NOTIFY_PERIOD_MS      40
+#define TEST_WAKE_LATENCY          25
+#define TEST_NOTIFICATIONS         20
+
+static uint32_t sul_proc_runs;
+static uint32_t sul_notifications;
+
+static void _count_process(void)
+{
+	sul_proc_runs++;
+}
+
+static bool _block_usi_rx(xSemaphoreHandle x_sem, portTickType x_block)
+{
+	(void)x_sem;
+
+	/* Event-only task: the app loop blocks without timeout */
+	CHECK(x_block == portMAX_DELAY);
+	if (sul_notifications == TEST_NOTIFICATIONS) {
+		return false;
+	}
+
+	/* Serial RX interrupt, then the app task is scheduled */
+	sx_tick += TEST_NOTIFY_PERIOD_MS;
+	sul_run_time += 1000;
+	oss_notify_from_isr(OSS_EVENT_USI_RX);
+	sul_notifications++;
+	sul_run_time += TEST_WAKE_LATENCY + sul_notifications;
+	return true;
+}
+
+static void test_event_wake(void)
+{
+	oss_task_t x_task = {0};
+
+	printf("event wake-up\n");
+	_reset();
+	sul_proc_runs = 0;
+	sul_notifications = 0;
+
+	x_task.task_process = _count_process;
+	x_task.ul_wake_events = OSS_EVENT_USI_RX;
+	oss_register_task(&x_task);
+	_run_app_loop(_block_usi_rx);
+
+	/* Event-only task: no run on the initial pass, then one per notification */
+	CHECK(sul_proc_runs == TEST_NOTIFICATIONS);
+	CHECK(oss_get_stats()->ul_app_wakeups == TEST_NOTIFICATIONS + 1);
+	CHECK(oss_get_stats()->x_app_wake.ul_count == TEST_NOTIFICATIONS);
+	CHECK(oss_get_stats()->x_app_wake.ul_last == TEST_WAKE_LATENCY + TEST_NOTIFICATIONS);
+	CHECK(oss_get_stats()->x_app_wake.ul_max == TEST_WAKE_LATENCY + TEST_NOTIFICATIONS);
+	/* The process may have issued G3 requests: the stack is woken */
+	CHECK(sx_g3_stack_sem->given);
+	printf("  %u runs for %u notifications, wake latency last %u max %u\n", sul_proc_runs,
+			sul_notifications, oss_get_stats()->x_app_wake.ul_last, oss_get_stats()->x_app_wake.ul_max);
+}
+
+/*
+ * oss_notify_after(): the app loop wakes at the deadline
+ */
+#define TEST_TIMER_MS              30
+
+static uint32_t saul_run_ms[8];
+
+static void _timer_process(void)
+{
+	if (sul_proc_runs < 8) {
+		saul_run_ms[sul_proc_runs] = oss_get_up_time_ms();
+	}
+
+	sul_proc_runs++;
+	oss_notify_after(OSS_EVENT_TIMER, TEST_TIMER_MS);
+}
+
+static bool _block_timer_event(xSemaphoreHandle x_sem, portTickType x_block)
+{
+	(void)x_sem;
+
+	if (sul_proc_runs == 4) {
+		return false;
+	}
+
+	CHECK(x_block == TEST_TIMER_MS);
+	sx_tick += x_block;
+	return true;
+}
+
+static void test_notify_after(void)
+{
+	oss_task_t x_task = {0};
+	uint32_t ul_i;
+
+	printf("notify after\n");
+	_reset();
+	sul_proc_runs = 0;
+
+	x_task.task_process = _timer_process;
+	x_task.ul_wake_events = OSS_EVENT_TIMER;
+	oss_register_task(&x_task);
+	/* First run on a notified event, next ones on the armed timer */
+	oss_notify(OSS_EVENT_TIMER);
+	_run_app_loop(_block_timer_event);
+
+	CHECK(sul_proc_runs == 4);
+	for (ul_i = 0; ul_i < 4; ul_i++) {
+		CHECK(saul_run_ms[ul_i] == ul_i * TEST_TIMER_MS);
+	}
+
+	printf("  runs at %u, %u, %u, %u ms\n", saul_run_ms[0], saul_run_ms[1], saul_run_ms[2], saul_run_ms[3]);
+}
+
+/*
+ * PLC interrupt: the G3 stack wakes at once, latency accounted
+ */
+static bool _block_plc_irq(xSemaphoreHandle x_sem, portTickType x_block)
+{
+	(void)x_sem;
+
+	/* Active after every PLC interrupt */
+	CHECK(x_block == OSS_G3_STACK_EXEC_RATE);
+	if (sul_notifications == TEST_NOTIFICATIONS) {
+		return false;
+	}
+
+	/* PLC interrupt before the next run */
+	sul_run_time += 1000;
+	oss_notify_from_isr(OSS_EVENT_PLC_IRQ);
+	sul_notifications++;
+	sul_run_time += TEST_WAKE_LATENCY;
+	return true;
+}
+
+static void test_stack_wake(void)
+{
+	printf("stack wake-up\n");
+	_reset();
+	sul_notifications = 0;
+
+	_run_stack_loop(_block_plc_irq);
+
+	/* First run at start, then one per notification */
+	CHECK(sul_stack_runs == TEST_NOTIFICATIONS + 1);
+	CHECK(oss_get_stats()->x_stack_wake.ul_count == TEST_NOTIFICATIONS);
+	CHECK(oss_get_stats()->x_stack_wake.ul_max == TEST_WAKE_LATENCY);
+	/* The app loop is notified too, for processes waiting on OSS_EVENT_PLC_IRQ */
+	CHECK(sul_oss_pending_events == OSS_EVENT_PLC_IRQ);
+	printf("  %u stack runs, wake latency last %u max %u\n", sul_stack_runs,
+			oss_get_stats()->x_stack_wake.ul_last, oss_get_stats()->x_stack_wake.ul_max);
+}
+
+/*
+ * G3 stack: active after a wake-up, then blocked until its next G3 timer
+ */
+#define TEST_G3_TIMER_1            37      /* 100 ms counter */
+#define TEST_G3_TIMER_2            120
+#define TEST_PLC_IRQ_MS            8737
+#define TEST_STACK_END_MS          20000
+
+static uint32_t sul_active_blocks;
+static uint32_t sul_forever_blocks;
+static uint32_t sul_sleep_max_block;
+static bool sb_plc_irq_sent;
+
+static bool _block_stack_sleep(xSemaphoreHandle x_sem, portTickType x_block)
+{
+	(void)x_sem;
+
+	if (sx_tick >= TEST_STACK_END_MS) {
+		return false;
+	}
+
+	if (x_block == OSS_G3_STACK_EXEC_RATE) {
+		sul_active_blocks++;
+	} else if ((x_block != portMAX_DELAY) && (x_block > sul_sleep_max_block)) {
+		sul_sleep_max_block = x_block;
+	}
+
+	/* PLC interrupt, then the MAC registers a new G3 timer */
+	if (!sb_plc_irq_sent && ((x_block == portMAX_DELAY) || (sx_tick + x_block >= TEST_PLC_IRQ_MS))) {
+		sx_tick = TEST_PLC_IRQ_MS;
+		oss_notify_from_isr(OSS_EVENT_PLC_IRQ);
+		sb_plc_irq_sent = true;
+		sb_g3_timer = true;
+		sul_g3_timer_deadline = TEST_G3_TIMER_2;
+		return true;
+	}
+
+	if (x_block == portMAX_DELAY) {
+		sul_forever_blocks++;
+		sx_tick = TEST_STACK_END_MS;
+	} else {
+		sx_tick += x_block;
+	}
+
+	return true;
+}
+
+static void test_stack_sleep(void)
+{
+	printf("stack sleep\n");
+	_reset();
+	sul_active_blocks = 0;
+	sul_forever_blocks = 0;
+	sul_sleep_max_block = 0;
+	sb_plc_irq_sent = false;
+	sb_g3_timer = true;
+	sul_g3_timer_deadline = TEST_G3_TIMER_1;
+
+	_run_stack_loop(_block_stack_sleep);
+
+	/* Active from the start and after the PLC interrupt */
+	CHECK(sul_active_blocks == 2 * (OSS_G3_STACK_ACTIVE_TIME / OSS_G3_STACK_EXEC_RATE));
+	/* G3 timers run on their 100 ms step, even when armed between two steps */
+	CHECK(sul_g3_fires == 2);
+	CHECK(saul_g3_fire_ms[0] == TEST_G3_TIMER_1 * 100);
+	CHECK(saul_g3_fire_ms[1] == TEST_G3_TIMER_2 * 100);
+	CHECK(oss_get_stats()->x_stack_wake.ul_count == 1);
+#if OSS_G3_STACK_POLL_PERIOD
+	CHECK(sul_sleep_max_block == OSS_G3_STACK_POLL_PERIOD);
+	CHECK(sul_forever_blocks == 0);
+#else
+	CHECK(sul_sleep_max_block == (TEST_G3_TIMER_1 * 100) - G3_PROCESS_INITIAL_DELAY - OSS_G3_STACK_ACTIVE_TIME);
+	CHECK(sul_forever_blocks == 1);
+#endif
+
+	/* Counters updated by the app loop after the G3 stack run: timer already due */
+	sb_g3_timer = true;
+	sul_g3_timer_deadline = oss_get_up_time_100ms();
+	_oss_advance_counters(37);
+	CHECK(_oss_stack_timeout(0) == 0);
+	/* Deadline beyond the ms range: no timeout */
+	sul_g3_timer_deadline = oss_get_up_time_100ms() + 0x7FFFFFFF;
+#if OSS_G3_STACK_POLL_PERIOD
+	CHECK(_oss_stack_timeout(0) == OSS_G3_STACK_POLL_PERIOD);
+#else
+	CHECK(_oss_stack_timeout(0) == 0xFFFFFFFF);
+#endif
+
+	printf("  %u stack runs in %u ms: %u active, G3 timers at %u and %u ms, max sleep %u ms, %u without timeout\n",
+			sul_stack_runs, oss_get_up_time_ms(), sul_active_blocks, saul_g3_fire_ms[0], saul_g3_fire_ms[1],
+			sul_sleep_max_block, sul_forever_blocks);
+}
+
+/*
+ * Run-time statistics: one entry per task and call type
+ */
+#define TEST_RUNS                  200
+
+static void _busy_process(void)
+{
+	/* 1% of the calls last 5000 units, the rest 10 to 109 */
+	sul_proc_runs++;
+	sul_run_time += (sul_proc_runs % 100 == 0) ? 5000 : (10 + (sul_proc_runs % 100));
+}
+
+static bool _block_busy(xSemaphoreHandle x_sem, portTickType x_block)
+{
+	(void)x_sem;
+
+	if (sul_proc_runs == TEST_RUNS) {
+		return false;
+	}
+
+	sx_tick += x_block;
+	return true;
+}
+
+static void test_run_stats(void)
+{
+	oss_task_t x_task = {0};
+	const oss_run_stats_t *px_run;
+#ifdef OSS_PROFILER
+	oss_prof_summary_t x_summary;
+#endif
+
+	printf("run-time statistics\n");
+	_reset();
+	sul_proc_runs = 0;
+
+	x_task.task_process = _idle_process;
+	oss_register_task(&x_task);
+	x_task.task_process = _busy_process;
+	x_task.ul_wake_events = OSS_EVENT_USER;
+	x_task.ul_poll_period = 1;
+	oss_register_task(&x_task);
+	_run_app_loop(_block_busy);
+
+	px_run = &oss_get_stats()->x_run[OSS_STATS_TASK_ID(1, OSS_TASK_PROCESS)];
+	CHECK(oss_get_stats_freq() == 1000000UL);
+	CHECK(px_run->ul_count == TEST_RUNS);
+	CHECK(px_run->ul_min == 11);
+	CHECK(px_run->ul_max == 5000);
+	CHECK(px_run->ull_total == (2 * (5000 + 4950 + 10 * 99)));
+	CHECK(oss_get_stats()->x_run[OSS_STATS_TASK_ID(0, OSS_TASK_PROCESS)].ul_count > 0);
+	CHECK(oss_get_stats()->x_run[OSS_STATS_TASK_ID(0, OSS_TASK_PROCESS_PRIO)].ul_count == 0);
+	printf("  task 1: %u runs, min %u max %u total %llu\n", px_run->ul_count, px_run->ul_min,
+			px_run->ul_max, (unsigned long long)px_run->ull_total);
+
+#ifdef OSS_PROFILER
+	/* 99% of the calls are below 128 units: p99 is the upper limit of its bucket */
+	CHECK(oss_prof_get_summary(OSS_STATS_TASK_ID(1, OSS_TASK_PROCESS), &x_summary));
+	CHECK(x_summary.ul_p99 == 127);
+	CHECK(!oss_prof_get_summary(OSS_STATS_TASK_ID(0, OSS_TASK_PROCESS_PRIO), &x_summary));
+	oss_prof_dump();
+#endif
+
+	oss_reset_stats();
+	CHECK(oss_get_stats()->x_run[OSS_STATS_TASK_ID(1, OSS_TASK_PROCESS)].ul_count == 0);
+}
+
+int main(void)
+{
+	test_counters();
+	test_timer_callbacks();
+	test_event_wake();
+	test_notify_after();
+	test_stack_wake();
+	test_stack_sleep();
+	test_run_stats();
+
+	if (si_failures) {
+		printf("FAILED: %d checks\n", si_failures);
+		return 1;
+	}
+
+	printf("OK\n");
+	return 0;
+}
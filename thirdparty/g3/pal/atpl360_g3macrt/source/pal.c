@@ -21,6 +21,9 @@
 /* Mac includes */
 #include "mac_wrapper_defs.h"
 
+/* OSS includes */
+#include "oss_if.h"
+
 #define AD_HOC_PAL_DEBUG 0
 
 #ifdef PAL_DEBUG_ENABLE
@@ -111,6 +114,24 @@ static uint8_t spuc_phy_sniffer_buf[div8_ceil(sizeof(phy_snf_frm_t)) << 3];
 static bool sb_phy_sniffer_pend;
 //#endif
 
+/* ATPL360 external interrupt handler, wrapped to wake the G3 stack */
+static void (*spf_plc_handler)(void);
+
+static void _plc_int_handler(void)
+{
+	if (spf_plc_handler != NULL) {
+		spf_plc_handler();
+	}
+
+	oss_notify_from_isr(OSS_EVENT_PLC_IRQ);
+}
+
+static void _plc_set_handler(void (*p_handler)(void))
+{
+	spf_plc_handler = p_handler;
+	pplc_if_set_handler(_plc_int_handler);
+}
+
 static void _exception_event_cb(atpl360_exception_t exception)
 {
 	switch (exception) {
@@ -475,7 +496,7 @@ void MacRtInitialize(uint8_t u8Band, struct TMacRtNotifications *pNotifications,
 	sx_atpl360_hal_wrp.plc_init = pplc_if_init;
 	sx_atpl360_hal_wrp.plc_reset = pplc_if_reset;
 	sx_atpl360_hal_wrp.plc_set_stby_mode = pplc_if_set_stby_mode;
-	sx_atpl360_hal_wrp.plc_set_handler = pplc_if_set_handler;
+	sx_atpl360_hal_wrp.plc_set_handler = _plc_set_handler;
 	sx_atpl360_hal_wrp.plc_send_boot_cmd = pplc_if_send_boot_cmd;
 	sx_atpl360_hal_wrp.plc_write_read_cmd = pplc_if_send_wrrd_cmd;
 	sx_atpl360_hal_wrp.plc_enable_int = pplc_if_enable_interrupt;
@@ -5493,6 +5493,7 @@ void phy_interrupt(void)
 	if (atpl250_spi_comm_corrupted()) {
 		/* Set flag to reset ATPL250 and return */
 		uc_phy_generic_flags |= PHY_GENERIC_FLAG_RESET_PHY;
+		oss_notify_from_isr(OSS_EVENT_PLC_IRQ);
 		return;
 	}
 
@@ -5529,6 +5530,9 @@ void phy_interrupt(void)
 	}
 
 	platform_led_int_toggle();
+
+	/* Wake the G3 stack to process the interrupt sources */
+	oss_notify_from_isr(OSS_EVENT_PLC_IRQ);
 }
 
 /**
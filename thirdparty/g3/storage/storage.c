@@ -47,6 +47,7 @@
 #include <conf_hal.h>
 #include <gpbr.h>
 #include <oss_if.h>
+#include <pcrc.h>
 #include <string.h>
 
 /* Storage includes */
@@ -64,12 +65,22 @@
 
 static struct TPersistentInfo persistentInfo;
 
-static uint16_t Crc16(const uint8_t *pu8Data, uint32_t u32Length, uint16_t u16Poly, uint16_t u16Crc);
+#ifndef STORAGE_JOURNAL_DISABLE
+/* Copy of the journal in storage, and index of next free record */
+static struct TPersistentJournal persistentJournal;
+static uint8_t persistentJournalNext;
+#endif
+
 static void _get_persistent_data(struct TPersistentData *data);
 static void _set_persistent_data(struct TPersistentData *data);
 static void _read_persistent_data_GPBR(struct TPersistentData *data);
 static void _write_persistent_data_GPBR(struct TPersistentData *data);
 static bool _update_persistent_data_GPBR(struct TPersistentData *data, bool b_upd_info);
+#ifndef STORAGE_JOURNAL_DISABLE
+static bool _load_persistent_journal(void);
+static void _append_persistent_journal(void);
+static void _compact_persistent_journal(bool b_keep_info);
+#endif
 
 /**
  * \brief Stores persistent data.
@@ -82,13 +93,23 @@ void store_persistent_info(void)
 	LOG_STORAGE(("PDD_CB: Persistent data stored.\r\n"));
 	_get_persistent_data(&persistentInfo.m_data);
 
+#ifndef STORAGE_JOURNAL_DISABLE
+	/* Room for the stores of one boot is reserved on load. If more stores than */
+	/* expected are done, erase the journal rather than losing the newest data */
+	if (persistentJournalNext >= STORAGE_JOURNAL_RECORDS) {
+		LOG_STORAGE(("store_persistent_info() journal full, compacting.\r\n"));
+		_compact_persistent_journal(true);
+	} else {
+		_append_persistent_journal();
+	}
+#else
 	/* Persistent info Header */
 	persistentInfo.m_u16Version = STORAGE_VERSION;
-	persistentInfo.m_u16Crc16 = Crc16((const uint8_t *)(&persistentInfo.m_data), sizeof(struct TPersistentData), 0x1021, 0xFFFF);
+	persistentInfo.m_u16Crc16 = pcrc_crc16_ccitt_update(0xFFFF, (const uint8_t *)(&persistentInfo.m_data), sizeof(struct TPersistentData));
 
 	/* Write internal data to the persistent storage */
 	platform_write_storage(sizeof(struct TPersistentInfo), &persistentInfo);
-	
+#endif
 }
 
 /**
@@ -131,10 +152,14 @@ void load_persistent_info(void)
 
 	platform_init_storage();
 
+#ifndef STORAGE_JOURNAL_DISABLE
+	/* Read the persistent storage and look for newest valid record */
+	b_upd_info = _load_persistent_journal();
+#else
 	/* Read the persistent storage */
 	if (platform_read_storage(sizeof(struct TPersistentInfo), &persistentInfo)) {
 		/* Check the CRC */
-		uint16_t u16Crc16 = Crc16((const uint8_t *)(&persistentInfo.m_data), sizeof(struct TPersistentData), 0x1021, 0xFFFF);
+		uint16_t u16Crc16 = pcrc_crc16_ccitt_update(0xFFFF, (const uint8_t *)(&persistentInfo.m_data), sizeof(struct TPersistentData));
 
 		if (persistentInfo.m_u16Crc16 != u16Crc16) {
 			LOG_STORAGE(("load_persistent_info() CRC error. Read: %u, Calc: %u\r\n", persistentInfo.m_u16Crc16, u16Crc16));
@@ -147,12 +172,14 @@ void load_persistent_info(void)
 		LOG_STORAGE(("load_persistent_info() unable to read storage.\r\n"));
 		b_upd_info = false;
 	}
-	
+#endif
+
 	/* Increment startup counter */
 	persistentInfo.m_u32StartupCounter++;
 	
 	/* Set Values to G3 Stack */
-	if (_update_persistent_data_GPBR(&persistentInfo.m_data, b_upd_info)) {
+	b_upd_info = _update_persistent_data_GPBR(&persistentInfo.m_data, b_upd_info);
+	if (b_upd_info) {
 		_set_persistent_data(&persistentInfo.m_data);
 		LOG_STORAGE(("Persistent data loaded. m_u32StartupCounter: %d\r\n", persistentInfo.m_u32StartupCounter));
 		LOG_STORAGE(("Persistent data loaded. m_u16Version: %d\r\n", persistentInfo.m_u16Version));
@@ -163,24 +190,19 @@ void load_persistent_info(void)
 		LOG_STORAGE(("Persistent data loaded. m_u8BroadcastSeqNumber: %d\r\n", persistentInfo.m_data.m_u8BroadcastSeqNumber));	
 	}
 
+#ifndef STORAGE_JOURNAL_DISABLE
+	/* Write the incremented startup counter now, so it advances on every boot */
+	/* even if nothing is stored on power-down. Erase only if there would be no */
+	/* room left for the stores of this boot */
+	if (!b_upd_info || (persistentJournalNext + 1 + STORAGE_JOURNAL_STORES_PER_BOOT > STORAGE_JOURNAL_RECORDS)) {
+		_compact_persistent_journal(b_upd_info);
+	} else {
+		_append_persistent_journal();
+	}
+#else
 	/* Pre-erase flash page for further quick writing on power-down */
 	platform_erase_storage(sizeof(struct TPersistentInfo));
-}
-
-/**
- * \brief Calculates CRC-16
- *
- */
-static uint16_t Crc16(const uint8_t *pu8Data, uint32_t u32Length, uint16_t u16Poly, uint16_t u16Crc)
-{
-	uint8_t u8Index;
-	while (u32Length--) {
-		u16Crc ^= (*pu8Data++) << 8;
-		for (u8Index = 0; u8Index < 8; u8Index++) {
-			u16Crc = (u16Crc << 1) ^ ((u16Crc & 0x8000U) ? u16Poly : 0);
-		}
-	}
-	return u16Crc;
+#endif
 }
 
 /**
@@ -317,3 +339,136 @@ static bool _update_persistent_data_GPBR(struct TPersistentData *data, bool b_up
 	
 	return res;
 }
+
+#ifndef STORAGE_JOURNAL_DISABLE
+
+/**
+ * \brief Checks whether a journal record has never been written.
+ *
+ * \param record     Pointer to the record
+ *
+ */
+static bool _is_erased_record(const struct TPersistentInfo *record)
+{
+	const uint8_t *puc_data = (const uint8_t *)record;
+	uint16_t us_i;
+
+	for (us_i = 0; us_i < sizeof(struct TPersistentInfo); us_i++) {
+		if (puc_data[us_i] != 0xFF) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+ * \brief Checks integrity of a persistent info record.
+ *
+ * \param record     Pointer to the record
+ *
+ */
+static bool _is_valid_record(const struct TPersistentInfo *record)
+{
+	uint16_t u16Crc16 = pcrc_crc16_ccitt_update(0xFFFF, (const uint8_t *)(&record->m_data), sizeof(struct TPersistentData));
+
+	return ((record->m_u16Crc16 == u16Crc16) && (record->m_u16Version == STORAGE_VERSION));
+}
+
+/**
+ * \brief Reads the journal and gets the newest valid record.
+ *
+ * \remarks Records are appended in order, so the newest one is the last valid
+ * one. A record torn by a power loss fails its CRC and is skipped. The journal
+ * is recreated if the storage does not hold one, keeping data from a single
+ * record written by a previous version.
+ *
+ * \return true if valid persistent info has been found
+ */
+static bool _load_persistent_journal(void)
+{
+	uint8_t uc_i;
+	bool b_found = false;
+
+	if (!platform_read_storage(sizeof(struct TPersistentJournal), &persistentJournal)) {
+		LOG_STORAGE(("load_persistent_info() unable to read storage.\r\n"));
+		memset(&persistentJournal, 0xFF, sizeof(persistentJournal));
+		persistentJournalNext = STORAGE_JOURNAL_RECORDS;
+		return false;
+	}
+
+	if ((persistentJournal.m_header.m_u16Magic != STORAGE_JOURNAL_MAGIC) ||
+			(persistentJournal.m_header.m_u16Version != STORAGE_VERSION)) {
+		/* No journal: check for a single record at the beginning of the storage */
+		memcpy(&persistentInfo, &persistentJournal, sizeof(struct TPersistentInfo));
+		b_found = _is_valid_record(&persistentInfo);
+		LOG_STORAGE(("load_persistent_info() no journal found, record %s.\r\n", b_found ? "valid" : "invalid"));
+		/* Force compaction to create the journal */
+		persistentJournalNext = STORAGE_JOURNAL_RECORDS;
+		return b_found;
+	}
+
+	persistentInfo.m_u32StartupCounter = persistentJournal.m_header.m_u32StartupCounter;
+	persistentJournalNext = STORAGE_JOURNAL_RECORDS;
+	for (uc_i = 0; uc_i < STORAGE_JOURNAL_RECORDS; uc_i++) {
+		if (_is_erased_record(&persistentJournal.m_records[uc_i])) {
+			/* End of journal. Following records are not used */
+			persistentJournalNext = uc_i;
+			break;
+		}
+
+		if (_is_valid_record(&persistentJournal.m_records[uc_i])) {
+			persistentInfo = persistentJournal.m_records[uc_i];
+			b_found = true;
+		} else {
+			LOG_STORAGE(("load_persistent_info() CRC error on journal record %u.\r\n", uc_i));
+		}
+	}
+
+	return b_found;
+}
+
+/**
+ * \brief Appends current persistent info as a new journal record.
+ *
+ * \remarks The caller checks there is an erased record left.
+ */
+static void _append_persistent_journal(void)
+{
+	persistentInfo.m_u16Version = STORAGE_VERSION;
+	persistentInfo.m_u16Crc16 = pcrc_crc16_ccitt_update(0xFFFF, (const uint8_t *)(&persistentInfo.m_data), sizeof(struct TPersistentData));
+	persistentJournal.m_records[persistentJournalNext++] = persistentInfo;
+
+	/* Write journal to the persistent storage. Only the new record changes erased bytes */
+	platform_write_storage(sizeof(struct TPersistentJournal), &persistentJournal);
+}
+
+/**
+ * \brief Erases the journal and writes it back with the current persistent info
+ * as its only record, leaving room for next records.
+ *
+ * \param b_keep_info     Whether current persistent info is valid and has to be kept
+ *
+ */
+static void _compact_persistent_journal(bool b_keep_info)
+{
+	LOG_STORAGE(("Compacting persistent data journal.\r\n"));
+
+	memset(&persistentJournal, 0xFF, sizeof(persistentJournal));
+	persistentJournal.m_header.m_u32StartupCounter = persistentInfo.m_u32StartupCounter;
+	persistentJournal.m_header.m_u16Version = STORAGE_VERSION;
+	persistentJournal.m_header.m_u16Magic = STORAGE_JOURNAL_MAGIC;
+	persistentJournalNext = 0;
+
+	platform_erase_storage(sizeof(struct TPersistentJournal));
+
+	/* Keep current info, if valid, as first record. Otherwise only the header */
+	/* is written, which still holds the startup counter */
+	if (b_keep_info) {
+		_append_persistent_journal();
+	} else {
+		platform_write_storage(sizeof(struct TPersistentJournal), &persistentJournal);
+	}
+}
+
+#endif
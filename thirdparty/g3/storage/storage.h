@@ -70,6 +70,36 @@ struct TPersistentInfo {
 	struct TPersistentData m_data;
 };
 
+/* Persistent info is kept as a journal: a header followed by records appended */
+/* on each load (to keep the startup counter) and on each store. The region is */
+/* only erased on load when the records left could not hold the stores of one */
+/* boot, instead of on every startup. Define STORAGE_JOURNAL_DISABLE to keep */
+/* a single record rewritten in place. */
+#ifndef STORAGE_JOURNAL_RECORDS
+#define STORAGE_JOURNAL_RECORDS 16
+#endif
+
+/* Stores expected per boot (power-down and reset callbacks). Extra stores */
+/* erase the journal on the spot instead of being dropped */
+#ifndef STORAGE_JOURNAL_STORES_PER_BOOT
+#define STORAGE_JOURNAL_STORES_PER_BOOT 2
+#endif
+
+#define STORAGE_JOURNAL_MAGIC 0x4A4C
+
+/* struct to identify the journal. Startup counter kept first for the platform */
+struct TPersistentJournalHeader {
+	uint32_t m_u32StartupCounter;
+	uint16_t m_u16Version;
+	uint16_t m_u16Magic;
+};
+
+/* struct to store persistent journal: header + records (erased records are 0xFF) */
+struct TPersistentJournal {
+	struct TPersistentJournalHeader m_header;
+	struct TPersistentInfo m_records[STORAGE_JOURNAL_RECORDS];
+};
+
 void store_persistent_data_GPBR(void);
 void store_persistent_info(void);
 void load_persistent_info(void);
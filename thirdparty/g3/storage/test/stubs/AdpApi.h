@@ -0,0 +1,41 @@
+#ifndef ADP_API_H_INCLUDED
+#define ADP_API_H_INCLUDED
+
+#include <stdint.h>
+#include <mac_wrapper.h>
+
+#define ADP_IB_MANUF_BROADCAST_SEQUENCE_NUMBER 0x080000C4
+#define ADP_IB_MANUF_DISCOVER_SEQUENCE_NUMBER 0x080000C9
+
+struct TAdpMacGetConfirm {
+	uint8_t m_u8Status;
+	uint32_t m_u32AttributeId;
+	uint16_t m_u16AttributeIndex;
+	uint8_t m_u8AttributeLength;
+	uint8_t m_au8AttributeValue[64];
+};
+
+struct TAdpGetConfirm {
+	uint8_t m_u8Status;
+	uint32_t m_u32AttributeId;
+	uint16_t m_u16AttributeIndex;
+	uint8_t m_u8AttributeLength;
+	uint8_t m_au8AttributeValue[64];
+};
+
+struct TAdpMacSetConfirm {
+	uint8_t m_u8Status;
+};
+
+struct TAdpSetConfirm {
+	uint8_t m_u8Status;
+};
+
+void AdpMacGetRequestSync(uint32_t u32AttributeId, uint16_t u16AttributeIndex, struct TAdpMacGetConfirm *pGetConfirm);
+void AdpGetRequestSync(uint32_t u32AttributeId, uint16_t u16AttributeIndex, struct TAdpGetConfirm *pGetConfirm);
+void AdpMacSetRequestSync(uint32_t u32AttributeId, uint16_t u16AttributeIndex, uint8_t u8AttributeLength,
+		const uint8_t *pu8AttributeValue, struct TAdpMacSetConfirm *pSetConfirm);
+void AdpSetRequestSync(uint32_t u32AttributeId, uint16_t u16AttributeIndex, uint8_t u8AttributeLength,
+		const uint8_t *pu8AttributeValue, struct TAdpSetConfirm *pSetConfirm);
+
+#endif
@@ -0,0 +1,8 @@
+#ifndef CONF_HAL_H_INCLUDED
+#define CONF_HAL_H_INCLUDED
+
+/* Both store callbacks, as on boards with power-down and reset detection */
+#define PLATFORM_PDD_INTERNAL_SUPPLY_MONITOR
+#define PLATFORM_RST_INTERRUPT
+
+#endif
@@ -0,0 +1,11 @@
+#ifndef GPBR_H_INCLUDED
+#define GPBR_H_INCLUDED
+
+#include <stdint.h>
+
+typedef enum { GPBR0, GPBR1, GPBR2, GPBR_NUM } gpbr_num_t;
+
+uint32_t gpbr_read(gpbr_num_t ul_reg_num);
+void gpbr_write(gpbr_num_t ul_reg_num, uint32_t ul_value);
+
+#endif
@@ -0,0 +1,15 @@
+#ifndef HAL_H_INCLUDED
+#define HAL_H_INCLUDED
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+void platform_init_storage(void);
+bool platform_write_storage(uint32_t u32Length, const void *pData);
+bool platform_read_storage(uint32_t u32Length, void *pData);
+void platform_erase_storage(uint32_t u32Length);
+void platform_set_pdd_callback(void (*pf_user_callback)(void));
+void platform_set_reset_callback(void (*pf_user_callback)(void));
+
+#endif
@@ -0,0 +1,11 @@
+#ifndef MAC_WRAPPER_H_INCLUDED
+#define MAC_WRAPPER_H_INCLUDED
+
+#include <stdint.h>
+
+enum EMacWrpPibAttribute {
+	MAC_WRP_PIB_FRAME_COUNTER = 0x00000077,
+	MAC_WRP_PIB_FRAME_COUNTER_RF = 0x00000277,
+};
+
+#endif
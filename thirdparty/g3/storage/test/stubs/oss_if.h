@@ -0,0 +1,3 @@
+#ifndef OSS_IF_H_INCLUDED
+#define OSS_IF_H_INCLUDED
+#endif
@@ -0,0 +1,344 @@
+/**
+ * \file
+ *
+ * \brief Host test of the persistent data journal.
+ *
+ * The storage is modelled as NOR flash: writes can only clear bits and only an
+ * erase sets them back. Boots are simulated by clearing the RAM state of the
+ * module and calling load_persistent_info() again.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../storage.c"
+
+#define FLASH_SIZE   512
+
+static int si_failures;
+
+#define CHECK(cond) do { \
+		if (!(cond)) { \
+			printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+			si_failures++; \
+		} \
+	} while (0)
+
+/* Flash model */
+static uint8_t suc_flash[FLASH_SIZE];
+static uint32_t sul_erases;
+static uint32_t sul_bit_sets;
+/* Bytes written before power is lost in next write (0 for no tear) */
+static uint32_t sul_tear_after;
+
+/* Stack and GPBR model */
+static uint32_t sul_frame_counter;
+static uint16_t sus_discover_seq;
+static uint8_t suc_broadcast_seq;
+static uint32_t sul_gpbr[GPBR_NUM];
+static void (*spf_pdd_cb)(void);
+static void (*spf_rst_cb)(void);
+
+uint16_t pcrc_crc16_ccitt_update(uint16_t us_crc, const uint8_t *puc_buf, uint32_t ul_len)
+{
+	uint8_t uc_bit;
+
+	while (ul_len--) {
+		us_crc ^= (uint16_t)(*puc_buf++) << 8;
+		for (uc_bit = 0; uc_bit < 8; uc_bit++) {
+			us_crc = (us_crc & 0x8000) ? (uint16_t)((us_crc << 1) ^ 0x1021) : (uint16_t)(us_crc << 1);
+		}
+	}
+
+	return us_crc;
+}
+
+void platform_init_storage(void)
+{
+}
+
+bool platform_write_storage(uint32_t u32Length, const void *pData)
+{
+	const uint8_t *puc_data = pData;
+	uint32_t ul_i;
+
+	if (u32Length > FLASH_SIZE) {
+		return false;
+	}
+
+	for (ul_i = 0; ul_i < u32Length; ul_i++) {
+		if (sul_tear_after && (ul_i >= sul_tear_after)) {
+			break;
+		}
+
+		if (puc_data[ul_i] & ~suc_flash[ul_i]) {
+			/* Would need an erase: real flash keeps the bits cleared */
+			sul_bit_sets++;
+		}
+
+		suc_flash[ul_i] &= puc_data[ul_i];
+	}
+
+	sul_tear_after = 0;
+	return true;
+}
+
+bool platform_read_storage(uint32_t u32Length, void *pData)
+{
+	if (u32Length > FLASH_SIZE) {
+		return false;
+	}
+
+	memcpy(pData, suc_flash, u32Length);
+	return true;
+}
+
+void platform_erase_storage(uint32_t u32Length)
+{
+	memset(suc_flash, 0xFF, sizeof(suc_flash));
+	sul_erases++;
+}
+
+void platform_set_pdd_callback(void (*pf_user_callback)(void))
+{
+	spf_pdd_cb = pf_user_callback;
+}
+
+void platform_set_reset_callback(void (*pf_user_callback)(void))
+{
+	spf_rst_cb = pf_user_callback;
+}
+
+uint32_t gpbr_read(gpbr_num_t ul_reg_num)
+{
+	return sul_gpbr[ul_reg_num];
+}
+
+void gpbr_write(gpbr_num_t ul_reg_num, uint32_t ul_value)
+{
+	sul_gpbr[ul_reg_num] = ul_value;
+}
+
+void AdpMacGetRequestSync(uint32_t u32AttributeId, uint16_t u16AttributeIndex, struct TAdpMacGetConfirm *pGetConfirm)
+{
+	pGetConfirm->m_u8AttributeLength = sizeof(sul_frame_counter);
+	memcpy(pGetConfirm->m_au8AttributeValue, &sul_frame_counter, sizeof(sul_frame_counter));
+}
+
+void AdpGetRequestSync(uint32_t u32AttributeId, uint16_t u16AttributeIndex, struct TAdpGetConfirm *pGetConfirm)
+{
+	if (u32AttributeId == ADP_IB_MANUF_DISCOVER_SEQUENCE_NUMBER) {
+		pGetConfirm->m_u8AttributeLength = sizeof(sus_discover_seq);
+		memcpy(pGetConfirm->m_au8AttributeValue, &sus_discover_seq, sizeof(sus_discover_seq));
+	} else {
+		pGetConfirm->m_u8AttributeLength = sizeof(suc_broadcast_seq);
+		memcpy(pGetConfirm->m_au8AttributeValue, &suc_broadcast_seq, sizeof(suc_broadcast_seq));
+	}
+}
+
+void AdpMacSetRequestSync(uint32_t u32AttributeId, uint16_t u16AttributeIndex, uint8_t u8AttributeLength,
+		const uint8_t *pu8AttributeValue, struct TAdpMacSetConfirm *pSetConfirm)
+{
+	memcpy(&sul_frame_counter, pu8AttributeValue, u8AttributeLength);
+}
+
+void AdpSetRequestSync(uint32_t u32AttributeId, uint16_t u16AttributeIndex, uint8_t u8AttributeLength,
+		const uint8_t *pu8AttributeValue, struct TAdpSetConfirm *pSetConfirm)
+{
+	if (u32AttributeId == ADP_IB_MANUF_DISCOVER_SEQUENCE_NUMBER) {
+		memcpy(&sus_discover_seq, pu8AttributeValue, u8AttributeLength);
+	} else {
+		memcpy(&suc_broadcast_seq, pu8AttributeValue, u8AttributeLength);
+	}
+}
+
+/* Power cycle: RAM state of the module and the stack is lost, GPBR too */
+static void _power_cycle(void)
+{
+	memset(&persistentInfo, 0, sizeof(persistentInfo));
+	memset(&persistentJournal, 0, sizeof(persistentJournal));
+	persistentJournalNext = 0;
+	spf_pdd_cb = NULL;
+	spf_rst_cb = NULL;
+	sul_frame_counter = 0;
+	sus_discover_seq = 0;
+	suc_broadcast_seq = 0;
+	memset(sul_gpbr, 0xFF, sizeof(sul_gpbr));
+}
+
+/* Startup counter of the newest valid record, or of the header if none */
+static uint32_t _stored_startup_counter(void)
+{
+	struct TPersistentJournal x_journal;
+	uint32_t ul_counter;
+	uint8_t uc_i;
+
+	memcpy(&x_journal, suc_flash, sizeof(x_journal));
+	ul_counter = x_journal.m_header.m_u32StartupCounter;
+	for (uc_i = 0; uc_i < STORAGE_JOURNAL_RECORDS; uc_i++) {
+		if (_is_erased_record(&x_journal.m_records[uc_i])) {
+			break;
+		}
+
+		if (_is_valid_record(&x_journal.m_records[uc_i])) {
+			ul_counter = x_journal.m_records[uc_i].m_u32StartupCounter;
+		}
+	}
+
+	return ul_counter;
+}
+
+static void _boot(void)
+{
+	_power_cycle();
+	load_persistent_info();
+}
+
+static void test_fresh_storage(void)
+{
+	memset(suc_flash, 0xFF, sizeof(suc_flash));
+	sul_erases = 0;
+	sul_bit_sets = 0;
+
+	_boot();
+	CHECK(spf_pdd_cb == store_persistent_info);
+	CHECK(spf_rst_cb == store_persistent_info);
+	CHECK(sul_bit_sets == 0);
+
+	/* Nothing stored yet: the stack keeps its own values */
+	CHECK(sul_frame_counter == 0);
+	CHECK(persistentJournalNext + STORAGE_JOURNAL_STORES_PER_BOOT <= STORAGE_JOURNAL_RECORDS);
+}
+
+/* The counter and the storage contents must change on every boot, even if */
+/* power is cut without any store, as the random seed is taken from them */
+static void test_counter_advances_without_stores(void)
+{
+	static uint8_t auc_prev[sizeof(struct TPersistentJournal)];
+	uint32_t ul_prev;
+	uint32_t ul_boot;
+
+	_boot();
+	ul_prev = _stored_startup_counter();
+	memcpy(auc_prev, suc_flash, sizeof(auc_prev));
+
+	for (ul_boot = 0; ul_boot < 100; ul_boot++) {
+		_boot();
+		CHECK(_stored_startup_counter() == ul_prev + 1);
+		CHECK(memcmp(auc_prev, suc_flash, sizeof(auc_prev)) != 0);
+		ul_prev = _stored_startup_counter();
+		memcpy(auc_prev, suc_flash, sizeof(auc_prev));
+	}
+
+	CHECK(sul_bit_sets == 0);
+}
+
+/* Power-down and reset stores on every boot are all kept */
+static void test_stores_per_boot(void)
+{
+	uint32_t ul_boot;
+	uint32_t ul_expected = 1000;
+
+	sul_erases = 0;
+	_boot();
+	for (ul_boot = 0; ul_boot < 200; ul_boot++) {
+		sul_frame_counter = ul_expected + 10;
+		spf_pdd_cb();
+		ul_expected = sul_frame_counter + 7;
+		sul_frame_counter = ul_expected;
+		sus_discover_seq = (uint16_t)ul_boot;
+		suc_broadcast_seq = (uint8_t)ul_boot;
+		spf_rst_cb();
+
+		_boot();
+		CHECK(sul_frame_counter == ul_expected);
+		CHECK(sus_discover_seq == (uint16_t)ul_boot);
+		CHECK(suc_broadcast_seq == (uint8_t)ul_boot);
+	}
+
+	CHECK(sul_bit_sets == 0);
+	/* One erase every (records / (stores + boot record)) boots at most */
+	CHECK(sul_erases <= 200 / (STORAGE_JOURNAL_RECORDS / (STORAGE_JOURNAL_STORES_PER_BOOT + 1)) + 1);
+	printf("stores per boot: %u erases in 200 boots\n", (unsigned)sul_erases);
+}
+
+/* More stores than expected in one boot must not drop the newest data */
+static void test_extra_stores(void)
+{
+	uint32_t ul_i;
+
+	_boot();
+	for (ul_i = 0; ul_i < 3 * STORAGE_JOURNAL_RECORDS; ul_i++) {
+		sul_frame_counter = 50000 + ul_i;
+		spf_pdd_cb();
+	}
+
+	_boot();
+	CHECK(sul_frame_counter == 50000 + 3 * STORAGE_JOURNAL_RECORDS - 1);
+	CHECK(sul_bit_sets == 0);
+}
+
+/* A record torn by a power loss is skipped, previous one is used */
+static void test_torn_record(void)
+{
+	uint32_t ul_counter;
+
+	_boot();
+	sul_frame_counter = 70000;
+	spf_pdd_cb();
+	ul_counter = _stored_startup_counter();
+
+	/* Journal is written from its start, tear in the middle of the new record */
+	sul_frame_counter = 80000;
+	sul_tear_after = sizeof(struct TPersistentJournalHeader) +
+			persistentJournalNext * sizeof(struct TPersistentInfo) + 9;
+	spf_pdd_cb();
+
+	_boot();
+	CHECK(sul_frame_counter == 70000);
+	CHECK(_stored_startup_counter() == ul_counter + 1);
+	CHECK(sul_bit_sets == 0);
+}
+
+/* Storage written by a version without journal is taken and converted */
+static void test_single_record(void)
+{
+	struct TPersistentInfo x_info;
+
+	memset(suc_flash, 0xFF, sizeof(suc_flash));
+	memset(&x_info, 0, sizeof(x_info));
+	x_info.m_u32StartupCounter = 41;
+	x_info.m_u16Version = STORAGE_VERSION;
+	x_info.m_data.m_u32FrameCounter = 123456;
+	x_info.m_u16Crc16 = pcrc_crc16_ccitt_update(0xFFFF, (const uint8_t *)&x_info.m_data, sizeof(x_info.m_data));
+	memcpy(suc_flash, &x_info, sizeof(x_info));
+
+	_boot();
+	CHECK(sul_frame_counter == 123456);
+	CHECK(_stored_startup_counter() == 42);
+	CHECK(persistentJournal.m_header.m_u16Magic == STORAGE_JOURNAL_MAGIC);
+
+	_boot();
+	CHECK(sul_frame_counter == 123456);
+	CHECK(_stored_startup_counter() == 43);
+}
+
+int main(void)
+{
+	test_fresh_storage();
+	test_counter_advances_without_stores();
+	test_stores_per_boot();
+	test_extra_stores();
+	test_torn_record();
+	test_single_record();
+
+	if (si_failures) {
+		printf("%d failure(s)\n", si_failures);
+		return 1;
+	}
+
+	printf("OK\n");
+	return 0;
+}
@@ -255,6 +255,9 @@ static void SetConfirm(uint8_t u8Status, uint32_t u32AttributeId, uint16_t u16At
 
 static void AppAdpDataConfirm(struct TAdpDataConfirm *pDataConfirm)
 {
+	/* Release the SDU held by the network adapter */
+	ipv6_send_confirm(pDataConfirm);
+
 	if (pDataConfirm->m_u8Status != G3_SUCCESS) {
 		LOG_APP_DEBUG(("ERR[AppAdpDataConfirm] NsduHandle: %hu Status: %hu\r\n", pDataConfirm->m_u8NsduHandle, pDataConfirm->m_u8Status));
 	}